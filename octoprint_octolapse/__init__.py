@@ -1979,6 +1979,9 @@ class OctolapsePlugin(
     def get_settings_file_path(self):
         return os.path.join(self.get_plugin_data_folder(), "settings.json")
 
+    def get_snapshot_plan_cache_directory(self):
+        return os.path.join(self.get_plugin_data_folder(), "snapshot_plan_cache")
+
     def get_log_file_path(self):
         return self._settings.get_plugin_logfile_path()
 
@@ -2768,13 +2771,14 @@ class OctolapsePlugin(
         return_value["gcode_file_path"] = gcode_file_path
         return return_value
 
-    def start_timelapse(self, timelapse_settings, snapshot_plans=None):
+    def start_timelapse(self, timelapse_settings, snapshot_plans=None, plan_pipeline=None):
         try:
             self._timelapse.start_timelapse(
                 timelapse_settings["settings"],
                 timelapse_settings["overridable_printer_profile_settings"],
                 timelapse_settings["gcode_file_path"],
-                snapshot_plans=snapshot_plans
+                snapshot_plans=snapshot_plans,
+                plan_pipeline=plan_pipeline
             )
         except TimelapseStartException as e:
             logger.exception("Unable to start the timelapse.  Error Details: %s", e.message)
@@ -2855,11 +2859,38 @@ class OctolapsePlugin(
             self._preprocessing_cancel_event,
             parsed_command,
             notification_period_seconds=self.PREPROCESSING_NOTIFICATION_PERIOD_SECONDS,
-
+            cache_directory=self.get_snapshot_plan_cache_directory()
         )
+        main_settings = timelapse_settings["settings"].main_settings
+        if (
+            main_settings.pipelined_preprocessing and
+            not main_settings.preview_snapshot_plans and
+            StabilizationPreprocessingThread.is_pipeline_supported(
+                timelapse_settings["settings"].profiles.current_trigger()
+            ) and
+            self.start_pipelined_timelapse(timelapse_settings, parsed_command)
+        ):
+            return
         self._stabilization_preprocessor_thread.daemon = True
         self._stabilization_preprocessor_thread.start()
 
+    def start_pipelined_timelapse(self, timelapse_settings, parsed_command):
+        # Starts the print while the snapshot plans are created on a native thread.  Returns False if the gcode
+        # should be preprocessed before printing instead.
+        try:
+            plan_pipeline = self._stabilization_preprocessor_thread.start_pipeline()
+        except Exception as e:
+            logger.exception("Unable to start the plan pipeline, the gcode will be preprocessed before printing.")
+            return False
+        if plan_pipeline is None:
+            return False
+        # The preprocessor thread is never started, so it must not be joined.
+        self._stabilization_preprocessor_thread = None
+        logger.info("Starting the print while the snapshot plans are created.")
+        if self.start_timelapse(timelapse_settings, plan_pipeline=plan_pipeline):
+            self._timelapse.release_job_on_hold_lock(parsed_command=parsed_command)
+        return True
+
     def pre_preocessing_complete(self, success, is_cancelled, snapshot_plans, seconds_elapsed,
                                  gcodes_processed, lines_processed, missed_snapshots, quality_issues,
                                  processing_issues, timelapse_settings, parsed_command):
@@ -2880,6 +2911,8 @@ class OctolapsePlugin(
     def reset_preprocessing(self):
         if self.preprocessing_job_guid is not None:
             self._preprocessing_cancel_event.clear()
+            if self._stabilization_preprocessor_thread is not None:
+                self._stabilization_preprocessor_thread.cancel()
             self.preprocessing_job_guid = None
             self.saved_timelapse_settings = None
             self.saved_snapshot_plans = None
@@ -0,0 +1,462 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "async_tracker.h"
+#include "logging.h"
+#include "python_helpers.h"
+
+#if OCTOLAPSE_HAS_THREADS
+
+async_tracker_position::async_tracker_position()
+{
+	lines_processed = 0;
+	x = 0;
+	y = 0;
+	z = 0;
+	f = 0;
+	e = 0;
+	height = 0;
+	layer = 0;
+	current_tool = 0;
+	has_definite_position = false;
+	is_layer_change = false;
+	is_in_bounds = false;
+	is_trigger_pending = false;
+}
+
+PyObject* async_tracker_position::to_py_tuple() const
+{
+	PyObject* py_position = Py_BuildValue(
+		"lddddddllllll",
+		lines_processed,
+		x,
+		y,
+		z,
+		f,
+		e,
+		height,
+		layer,
+		(long)current_tool,
+		(long)has_definite_position,
+		(long)is_layer_change,
+		(long)is_in_bounds,
+		(long)is_trigger_pending
+	);
+	if (py_position == NULL)
+	{
+		std::string message = "async_tracker_position.to_py_tuple: Unable to convert the position to a PyObject tuple via Py_BuildValue.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+	}
+	return py_position;
+}
+
+async_tracker::async_tracker(const gcode_position_args& position_args, const snapshot_trigger_args* p_trigger_args, int queue_size) : gcode_position_(position_args)
+{
+	p_trigger_ = NULL;
+	if (p_trigger_args != NULL)
+		p_trigger_ = new snapshot_trigger(*p_trigger_args);
+	if (queue_size < 2)
+		queue_size = 2;
+	else if (queue_size > ASYNC_TRACKER_MAX_QUEUE_SIZE)
+		queue_size = ASYNC_TRACKER_MAX_QUEUE_SIZE;
+	unsigned long capacity = 2;
+	while (capacity < static_cast<unsigned long>(queue_size))
+		capacity <<= 1;
+	lines_.resize(capacity);
+	mask_ = capacity - 1;
+	head_.store(0);
+	tail_.store(0);
+	is_trigger_pending_.store(false);
+	is_stop_requested_.store(false);
+	is_worker_sleeping_.store(false);
+	sequence_.store(0);
+	lines_processed_ = 0;
+	thread_ = std::thread(&async_tracker::run, this);
+}
+
+async_tracker::~async_tracker()
+{
+	stop();
+	if (p_trigger_ != NULL)
+	{
+		delete p_trigger_;
+		p_trigger_ = NULL;
+	}
+}
+
+bool async_tracker::try_push(const char* gcode)
+{
+	const unsigned long head = head_.load(std::memory_order_relaxed);
+	if (head - tail_.load(std::memory_order_acquire) > mask_)
+		return false;
+	lines_[head & mask_].assign(gcode);
+	// seq_cst, so that either the tracking thread sees the line before it sleeps, or we see that it is sleeping.
+	head_.store(head + 1);
+	if (is_worker_sleeping_.load())
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		work_condition_.notify_one();
+	}
+	return true;
+}
+
+bool async_tracker::push(const char* gcode)
+{
+	while (!try_push(gcode))
+	{
+		if (is_stop_requested_.load())
+			return true;
+		if (is_trigger_pending_.load())
+			return false;
+		std::this_thread::yield();
+	}
+	return true;
+}
+
+void async_tracker::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!is_stop_requested_.load() && !(is_worker_sleeping_.load() && is_idle()))
+		idle_condition_.wait(lock);
+}
+
+bool async_tracker::is_trigger_pending() const
+{
+	return is_trigger_pending_.load();
+}
+
+void async_tracker::resume()
+{
+	if (!is_trigger_pending_.load())
+		return;
+	is_trigger_pending_.store(false);
+	if (is_worker_sleeping_.load())
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		work_condition_.notify_one();
+	}
+}
+
+void async_tracker::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		is_stop_requested_.store(true);
+		work_condition_.notify_one();
+		idle_condition_.notify_all();
+	}
+	if (thread_.joinable())
+		thread_.join();
+}
+
+void async_tracker::get_latest_position(async_tracker_position& pos) const
+{
+	// Read the flag first.  The trigger line is published before the flag is set, and the tracking thread waits
+	// on that line until resume, so a pending trigger always comes with its own position.
+	const bool is_trigger_pending = is_trigger_pending_.load();
+	while (true)
+	{
+		const unsigned int start_sequence = sequence_.load(std::memory_order_acquire);
+		if ((start_sequence & 1) == 0)
+		{
+			pos = latest_;
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence_.load(std::memory_order_relaxed) == start_sequence)
+			{
+				pos.is_trigger_pending = is_trigger_pending;
+				return;
+			}
+		}
+		std::this_thread::yield();
+	}
+}
+
+long async_tracker::get_lines_pushed() const
+{
+	return static_cast<long>(head_.load());
+}
+
+gcode_position* async_tracker::get_gcode_position()
+{
+	return &gcode_position_;
+}
+
+snapshot_trigger* async_tracker::get_trigger()
+{
+	return p_trigger_;
+}
+
+bool async_tracker::has_work() const
+{
+	return !is_trigger_pending_.load() && tail_.load(std::memory_order_relaxed) != head_.load();
+}
+
+bool async_tracker::is_idle() const
+{
+	return is_trigger_pending_.load() || tail_.load() == head_.load();
+}
+
+void async_tracker::run()
+{
+	// Every record goes to python in batches, so that the tracking thread rarely needs the GIL.
+	octolapse_log_buffer_begin();
+	while (!is_stop_requested_.load())
+	{
+		if (!has_work())
+		{
+			octolapse_log_buffer_flush();
+			std::unique_lock<std::mutex> lock(mutex_);
+			is_worker_sleeping_.store(true);
+			idle_condition_.notify_all();
+			while (!is_stop_requested_.load() && !has_work())
+				work_condition_.wait(lock);
+			is_worker_sleeping_.store(false);
+			continue;
+		}
+		const unsigned long tail = tail_.load(std::memory_order_relaxed);
+		process_line(lines_[tail & mask_]);
+		// The slot can only be reused once we are done with the line.
+		tail_.store(tail + 1, std::memory_order_release);
+	}
+	octolapse_log_buffer_end();
+}
+
+void async_tracker::process_line(std::string& gcode)
+{
+	parsed_command command;
+	parser_.try_parse_gcode(gcode.c_str(), command);
+	lines_processed_++;
+	gcode_position_.update(command, lines_processed_, -1, -1);
+	bool is_triggered = false;
+	if (p_trigger_ != NULL)
+	{
+		is_triggered = p_trigger_->update(gcode_position_.get_current_position_ptr(), gcode_position_.get_previous_position_ptr())
+			&& p_trigger_->get_state().is_triggered;
+	}
+	publish();
+	if (is_triggered)
+		is_trigger_pending_.store(true);
+}
+
+void async_tracker::publish()
+{
+	const unsigned int sequence = sequence_.load(std::memory_order_relaxed);
+	sequence_.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	const position* p_current_pos = gcode_position_.get_current_position_ptr();
+	latest_.lines_processed = lines_processed_;
+	latest_.x = p_current_pos->x;
+	latest_.y = p_current_pos->y;
+	latest_.z = p_current_pos->z;
+	latest_.f = p_current_pos->f;
+	latest_.e = p_current_pos->get_current_extruder().e;
+	latest_.height = p_current_pos->height;
+	latest_.layer = p_current_pos->layer;
+	latest_.current_tool = p_current_pos->current_tool;
+	latest_.has_definite_position = p_current_pos->has_definite_position;
+	latest_.is_layer_change = p_current_pos->is_layer_change;
+	latest_.is_in_bounds = p_current_pos->is_in_bounds;
+	sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+static async_tracker * async_tracker_get(PyObject * self)
+{
+	return reinterpret_cast<async_tracker_object*>(self)->p_tracker;
+}
+
+static void async_tracker_wait_without_gil(async_tracker * p_tracker)
+{
+	Py_BEGIN_ALLOW_THREADS
+	p_tracker->wait();
+	Py_END_ALLOW_THREADS
+}
+
+static PyObject * async_tracker_Push(PyObject * self, PyObject * py_gcode)
+{
+	const char * gcode = PyUnicode_SafeAsString(py_gcode);
+	if (gcode == NULL)
+	{
+		std::string message = "GcodePositionProcessor.AsyncTracker.Push - Error parsing parameters.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return NULL;
+	}
+	async_tracker * p_tracker = async_tracker_get(self);
+	bool is_queued = p_tracker->try_push(gcode);
+	if (!is_queued)
+	{
+		// The ring is full, so let the tracking thread catch up.  gcode belongs to py_gcode, which the caller holds.
+		Py_BEGIN_ALLOW_THREADS
+		is_queued = p_tracker->push(gcode);
+		Py_END_ALLOW_THREADS
+	}
+	return Py_BuildValue("O", is_queued ? Py_True : Py_False);
+}
+
+static PyObject * async_tracker_Wait(PyObject * self, PyObject * args)
+{
+	async_tracker * p_tracker = async_tracker_get(self);
+	async_tracker_wait_without_gil(p_tracker);
+	return Py_BuildValue("O", p_tracker->is_trigger_pending() ? Py_True : Py_False);
+}
+
+static PyObject * async_tracker_IsTriggerPending(PyObject * self, PyObject * args)
+{
+	return Py_BuildValue("O", async_tracker_get(self)->is_trigger_pending() ? Py_True : Py_False);
+}
+
+static PyObject * async_tracker_Resume(PyObject * self, PyObject * args)
+{
+	async_tracker_get(self)->resume();
+	return Py_BuildValue("O", Py_True);
+}
+
+static PyObject * async_tracker_GetLatestPosition(PyObject * self, PyObject * args)
+{
+	async_tracker_position pos;
+	async_tracker_get(self)->get_latest_position(pos);
+	return pos.to_py_tuple();
+}
+
+static PyObject * async_tracker_GetLinesPushed(PyObject * self, PyObject * args)
+{
+	return PyLong_FromLong(async_tracker_get(self)->get_lines_pushed());
+}
+
+static PyObject * async_tracker_GetCurrentPositionTuple(PyObject * self, PyObject * args)
+{
+	async_tracker * p_tracker = async_tracker_get(self);
+	async_tracker_wait_without_gil(p_tracker);
+	return p_tracker->get_gcode_position()->get_current_position_ptr()->to_py_tuple();
+}
+
+static PyObject * async_tracker_GetPreviousPositionTuple(PyObject * self, PyObject * args)
+{
+	async_tracker * p_tracker = async_tracker_get(self);
+	async_tracker_wait_without_gil(p_tracker);
+	return p_tracker->get_gcode_position()->get_previous_position_ptr()->to_py_tuple();
+}
+
+static PyObject * async_tracker_GetTriggerState(PyObject * self, PyObject * args)
+{
+	async_tracker * p_tracker = async_tracker_get(self);
+	async_tracker_wait_without_gil(p_tracker);
+	snapshot_trigger * p_trigger = p_tracker->get_trigger();
+	if (p_trigger == NULL)
+	{
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	return p_trigger->get_state().to_py_tuple(p_trigger->get_trigger_count());
+}
+
+static PyObject * async_tracker_Stop(PyObject * self, PyObject * args)
+{
+	async_tracker * p_tracker = async_tracker_get(self);
+	Py_BEGIN_ALLOW_THREADS
+	p_tracker->stop();
+	Py_END_ALLOW_THREADS
+	return Py_BuildValue("O", Py_True);
+}
+
+static void async_tracker_dealloc(PyObject * self)
+{
+	async_tracker * p_tracker = async_tracker_get(self);
+	if (p_tracker != NULL)
+	{
+		// The tracking thread may need the GIL to send its last log records.
+		Py_BEGIN_ALLOW_THREADS
+		delete p_tracker;
+		Py_END_ALLOW_THREADS
+	}
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyMethodDef async_tracker_methods[] = {
+	{ "Push", (PyCFunction)async_tracker_Push, METH_O, "Queue a line of gcode for the tracking thread.  Only waits if the queue is full.  Returns False without queuing the line if the queue is full and the trigger is pending, so call Resume and push it again." },
+	{ "Wait", (PyCFunction)async_tracker_Wait, METH_NOARGS, "Wait until every queued line has been processed or the trigger fires.  Returns True if the trigger is pending." },
+	{ "IsTriggerPending", (PyCFunction)async_tracker_IsTriggerPending, METH_NOARGS, "Returns True if the trigger fired and the tracking thread is waiting for Resume." },
+	{ "Resume", (PyCFunction)async_tracker_Resume, METH_NOARGS, "Continue processing queued lines after the trigger fired." },
+	{ "GetLatestPosition", (PyCFunction)async_tracker_GetLatestPosition, METH_NOARGS, "Returns the latest published (lines_processed, x, y, z, f, e, height, layer, current_tool, has_definite_position, is_layer_change, is_in_bounds, is_trigger_pending) without waiting." },
+	{ "GetLinesPushed", (PyCFunction)async_tracker_GetLinesPushed, METH_NOARGS, "Returns the number of lines pushed so far." },
+	{ "GetCurrentPositionTuple", (PyCFunction)async_tracker_GetCurrentPositionTuple, METH_NOARGS, "Wait, then return the current position in tuple form." },
+	{ "GetPreviousPositionTuple", (PyCFunction)async_tracker_GetPreviousPositionTuple, METH_NOARGS, "Wait, then return the previous position in tuple form." },
+	{ "GetTriggerState", (PyCFunction)async_tracker_GetTriggerState, METH_NOARGS, "Wait, then return the trigger state tuple, or None if there is no trigger." },
+	{ "Stop", (PyCFunction)async_tracker_Stop, METH_NOARGS, "Stop the tracking thread, discarding any lines that were not processed." },
+	{ NULL, NULL, 0, NULL }
+};
+
+PyTypeObject async_tracker_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.AsyncTracker"
+};
+
+bool async_tracker_add_type(PyObject * module)
+{
+	async_tracker_type.tp_basicsize = sizeof(async_tracker_object);
+	async_tracker_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	async_tracker_type.tp_doc = "Tracks the live position on a native thread.  Returned by CreateAsyncTracker.";
+	async_tracker_type.tp_dealloc = async_tracker_dealloc;
+	async_tracker_type.tp_methods = async_tracker_methods;
+	if (PyType_Ready(&async_tracker_type) < 0)
+	{
+		std::string message = "async_tracker_add_type - Unable to ready the AsyncTracker type.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	Py_INCREF(&async_tracker_type);
+	if (PyModule_AddObject(module, "AsyncTracker", reinterpret_cast<PyObject*>(&async_tracker_type)) < 0)
+	{
+		Py_DECREF(&async_tracker_type);
+		std::string message = "async_tracker_add_type - Unable to add the AsyncTracker type to the module.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	return true;
+}
+
+PyObject * async_tracker_create(const gcode_position_args& position_args, const snapshot_trigger_args* p_trigger_args, int queue_size)
+{
+	PyObject * py_tracker = async_tracker_type.tp_alloc(&async_tracker_type, 0);
+	if (py_tracker == NULL)
+	{
+		std::string message = "async_tracker_create - Unable to allocate an AsyncTracker.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return NULL;
+	}
+	reinterpret_cast<async_tracker_object*>(py_tracker)->p_tracker = new async_tracker(position_args, p_trigger_args, queue_size);
+	return py_tracker;
+}
+#else
+bool async_tracker_add_type(PyObject * module)
+{
+	// The AsyncTracker type is left out, and python tracks the position synchronously.
+	return true;
+}
+
+PyObject * async_tracker_create(const gcode_position_args& position_args, const snapshot_trigger_args* p_trigger_args, int queue_size)
+{
+	std::string message = "GcodePositionProcessor.CreateAsyncTracker - This build has no native thread support.";
+	PyErr_SetString(PyExc_NotImplementedError, message.c_str());
+	octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+	return NULL;
+}
+#endif
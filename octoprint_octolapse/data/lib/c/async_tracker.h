@@ -0,0 +1,175 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ASYNC_TRACKER_H
+#define ASYNC_TRACKER_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <string>
+#include <vector>
+#include "threads.h"
+#include "gcode_position.h"
+#include "gcode_parser.h"
+#include "snapshot_trigger.h"
+
+#define ASYNC_TRACKER_DEFAULT_QUEUE_SIZE 1024
+#define ASYNC_TRACKER_MAX_QUEUE_SIZE 1048576
+
+#if OCTOLAPSE_HAS_THREADS
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/**
+ * \brief The latest position published by the tracking thread.  It only holds plain values so that it can be copied
+ * through the seqlock.
+ */
+struct async_tracker_position
+{
+	async_tracker_position();
+	/**
+	 * \brief Returns (lines_processed, x, y, z, f, e, height, layer, current_tool, has_definite_position,
+	 * is_layer_change, is_in_bounds, is_trigger_pending).
+	 */
+	PyObject* to_py_tuple() const;
+	long lines_processed;
+	double x;
+	double y;
+	double z;
+	double f;
+	double e;
+	double height;
+	long layer;
+	int current_tool;
+	bool has_definite_position;
+	bool is_layer_change;
+	bool is_in_bounds;
+	bool is_trigger_pending;
+};
+
+/**
+ * \brief Tracks the position of the live print on its own thread.  The sending thread pushes gcode into a
+ * single producer, single consumer ring, so it never waits on the parser or the position unless the ring is full.
+ * The tracking thread parses each line, updates its gcode_position and its optional native trigger, and publishes
+ * the latest position through a seqlock.  When the trigger fires the tracking thread stops taking lines, so the
+ * position stays on the line that fired until resume is called.
+ * Only one thread may push, wait, resume or stop.
+ */
+class async_tracker
+{
+public:
+	// p_trigger_args may be NULL to track the position without a trigger.  queue_size is rounded up to a power of 2.
+	async_tracker(const gcode_position_args& position_args, const snapshot_trigger_args* p_trigger_args, int queue_size);
+	~async_tracker();
+	/**
+	 * \brief Queues a line for the tracking thread.  Returns false if the ring is full.
+	 */
+	bool try_push(const char* gcode);
+	/**
+	 * \brief Queues a line, waiting for room if the ring is full.  Returns false without queuing the line if the
+	 * ring is full and the trigger is pending, since the tracking thread won't make room until resume.  Call without
+	 * holding the GIL.
+	 */
+	bool push(const char* gcode);
+	/**
+	 * \brief Waits until every pushed line has been processed, or until the trigger fires.  Afterwards the position
+	 * and the trigger may be read from the calling thread until the next push or resume.  Call without holding the GIL.
+	 */
+	void wait();
+	/**
+	 * \brief Returns true if the trigger has fired and the tracking thread is waiting for resume.
+	 */
+	bool is_trigger_pending() const;
+	/**
+	 * \brief Starts the tracking thread again after the trigger fired.
+	 */
+	void resume();
+	/**
+	 * \brief Stops the tracking thread.  Lines that have not been processed are discarded.  Call without holding the GIL.
+	 */
+	void stop();
+	/**
+	 * \brief Copies the latest published position.  Never waits on the tracking thread.
+	 */
+	void get_latest_position(async_tracker_position& pos) const;
+	long get_lines_pushed() const;
+	// Only read these after wait.
+	gcode_position* get_gcode_position();
+	// NULL if the tracker has no trigger
+	snapshot_trigger* get_trigger();
+private:
+	async_tracker(const async_tracker& source);
+	void run();
+	void process_line(std::string& gcode);
+	void publish();
+	bool has_work() const;
+	bool is_idle() const;
+	gcode_parser parser_;
+	gcode_position gcode_position_;
+	snapshot_trigger* p_trigger_;
+	// The ring.  head_ is only written by the pushing thread and tail_ by the tracking thread.
+	std::vector<std::string> lines_;
+	unsigned long mask_;
+	std::atomic<unsigned long> head_;
+	std::atomic<unsigned long> tail_;
+	std::atomic<bool> is_trigger_pending_;
+	std::atomic<bool> is_stop_requested_;
+	// Set by the tracking thread, with mutex_ held, while it waits for work.  The pushing thread reads it so that it
+	// only takes the lock when there is a thread to wake.
+	std::atomic<bool> is_worker_sleeping_;
+	std::mutex mutex_;
+	std::condition_variable work_condition_;
+	std::condition_variable idle_condition_;
+	// The seqlock.  sequence_ is odd while latest_ is being written.
+	std::atomic<unsigned int> sequence_;
+	async_tracker_position latest_;
+	long lines_processed_;
+	std::thread thread_;
+};
+
+/**
+ * \brief A python object that owns an async_tracker.  Returned by CreateAsyncTracker.
+ */
+typedef struct {
+	PyObject_HEAD
+	async_tracker * p_tracker;
+} async_tracker_object;
+
+extern PyTypeObject async_tracker_type;
+#endif
+
+/**
+ * \brief Readies the AsyncTracker type and adds it to the module.  Returns false on failure.
+ */
+bool async_tracker_add_type(PyObject * module);
+/**
+ * \brief Creates an AsyncTracker and starts its tracking thread.  p_trigger_args may be NULL.  Without native threads
+ * this sets NotImplementedError and returns NULL.
+ */
+PyObject * async_tracker_create(const gcode_position_args& position_args, const snapshot_trigger_args* p_trigger_args, int queue_size);
+#endif
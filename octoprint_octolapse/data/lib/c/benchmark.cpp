@@ -0,0 +1,907 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// A standalone benchmark for the native gcode processing hot paths.  It does not need OctoPrint or a running Python
+// interpreter, but it links against libpython since the shared sources reference the Python API.  Build it from this
+// directory with the sources listed in setup.py, except gcode_position_processor.cpp and position_view.cpp (which
+// contain the python module and its main), all on one line:
+//
+//   g++ -O3 -std=c++11 $(python3-config --includes) -o octolapse_benchmark benchmark.cpp binary_stream.cpp extruder.cpp
+//     gcode_arc.cpp gcode_comment_processor.cpp gcode_decompression.cpp gcode_file_source.cpp gcode_input_stream.cpp
+//     gcode_parser.cpp gcode_position.cpp logging.cpp parsed_command.cpp parsed_command_parameter.cpp position.cpp
+//     position_checkpoint.cpp position_trace.cpp print_time_estimator.cpp processing_progress.cpp processing_stats.cpp
+//     python_helpers.cpp slicer_settings_extractor.cpp snapshot_gcode_generator.cpp snapshot_plan.cpp
+//     snapshot_plan_cache.cpp snapshot_plan_queue.cpp snapshot_plan_step.cpp snapshot_trigger.cpp stabilization.cpp
+//     stabilization_results.cpp stabilization_smart_gcode.cpp stabilization_smart_layer.cpp
+//     stabilization_smart_timer.cpp toolpath_recorder.cpp trigger_position.cpp utilities.cpp
+//     $(python3-config --ldflags --embed)
+//
+// Usage:  octolapse_benchmark [-i iterations] [-t trace_directory] [-v] [gcode_file ...]
+// When no files are given, a canned corpus is generated for each supported slicer style.  When a trace directory is
+// given, replaying a position trace is benchmarked too, and the traces are left in the directory.  -v skips the
+// benchmarks and instead checks that gcode_parser::try_extract_double matches the reference number parser bit for bit,
+// for a set of edge cases and for every number in the corpora.  It returns a non zero exit code on any difference.
+
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "gcode_parser.h"
+#include "gcode_position.h"
+#include "trigger_position.h"
+#include "stabilization.h"
+#include "stabilization_smart_layer.h"
+#include "stabilization_smart_gcode.h"
+#include "stabilization_smart_timer.h"
+
+#pragma region Allocation Counting
+static unsigned long long benchmark_allocations = 0;
+
+void* operator new(std::size_t size)
+{
+	benchmark_allocations++;
+	void* p = std::malloc(size == 0 ? 1 : size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	benchmark_allocations++;
+	void* p = std::malloc(size == 0 ? 1 : size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+#pragma endregion Allocation Counting
+
+#pragma region Corpus
+struct benchmark_corpus
+{
+	std::string name;
+	std::string text;
+	int num_extruders;
+	bool shared_extruder;
+};
+
+static void append_line(std::string& text, const char* format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	text += buffer;
+	text += '\n';
+}
+
+// Appends the points of a square loop around the bed center.  Returns the new absolute e value.
+static double append_loop(std::string& text, double size, double e, double e_per_mm, bool relative_e, const char* comment)
+{
+	const double center = 100.0;
+	const double half = size / 2.0;
+	const double corners[4][2] = {
+		{ center - half, center - half }, { center + half, center - half },
+		{ center + half, center + half }, { center - half, center + half }
+	};
+	// Split each side into segments, like a slicer does for curved outlines.
+	const int segments_per_side = 8;
+	for (int side = 0; side < 4; side++)
+	{
+		const double* p_start = corners[side];
+		const double* p_end = corners[(side + 1) % 4];
+		for (int segment = 1; segment <= segments_per_side; segment++)
+		{
+			const double t = static_cast<double>(segment) / segments_per_side;
+			const double x = p_start[0] + (p_end[0] - p_start[0]) * t;
+			const double y = p_start[1] + (p_end[1] - p_start[1]) * t;
+			const double e_delta = size / segments_per_side * e_per_mm;
+			e += e_delta;
+			if (comment != NULL)
+				append_line(text, "G1 X%.3f Y%.3f E%.5f ; %s", x, y, relative_e ? e_delta : e, comment);
+			else
+				append_line(text, "G1 X%.3f Y%.3f E%.5f", x, y, relative_e ? e_delta : e);
+		}
+	}
+	return e;
+}
+
+static benchmark_corpus create_cura_corpus(int layers)
+{
+	benchmark_corpus corpus;
+	corpus.name = "Cura";
+	corpus.num_extruders = 1;
+	corpus.shared_extruder = true;
+	std::string& text = corpus.text;
+	append_line(text, ";FLAVOR:Marlin");
+	append_line(text, ";Generated with Cura_SteamEngine 4.1.0");
+	append_line(text, "M140 S60");
+	append_line(text, "M104 S200");
+	append_line(text, "M190 S60");
+	append_line(text, "M109 S200");
+	append_line(text, "M82 ;absolute extrusion mode");
+	append_line(text, "G28 ;Home");
+	append_line(text, "G92 E0");
+	append_line(text, "G1 Z15.0 F6000 ;Move the platform down 15mm");
+	append_line(text, ";LAYER_COUNT:%d", layers);
+	double e = 0;
+	for (int layer = 0; layer < layers; layer++)
+	{
+		const double z = 0.2 + layer * 0.2;
+		append_line(text, ";LAYER:%d", layer);
+		append_line(text, "G0 F7200 X80.000 Y80.000 Z%.3f", z);
+		append_line(text, ";TYPE:WALL-OUTER");
+		append_line(text, "G1 F2700 E%.5f", e);
+		e = append_loop(text, 40.0, e, 0.033, false, NULL);
+		append_line(text, ";TYPE:WALL-INNER");
+		e = append_loop(text, 39.2, e, 0.033, false, NULL);
+		append_line(text, ";TYPE:FILL");
+		for (int line = 0; line < 20; line++)
+		{
+			append_line(text, "G0 F7200 X%.3f Y81.000", 81.0 + line * 1.9);
+			e += 1.2;
+			append_line(text, "G1 F1800 X%.3f Y119.000 E%.5f", 81.0 + line * 1.9, e);
+		}
+		append_line(text, "G1 F2700 E%.5f", e - 6.5);
+		append_line(text, ";MESH:NONMESH");
+		append_line(text, "G0 F300 X80.000 Y80.000 Z%.3f", z + 0.2);
+	}
+	append_line(text, "M140 S0");
+	append_line(text, "M107");
+	return corpus;
+}
+
+static benchmark_corpus create_slic3r_pe_corpus(int layers)
+{
+	benchmark_corpus corpus;
+	corpus.name = "Slic3r PE";
+	corpus.num_extruders = 1;
+	corpus.shared_extruder = true;
+	std::string& text = corpus.text;
+	append_line(text, "; generated by Slic3r Prusa Edition 1.41.3+ on 2019-04-28 at 15:57:39");
+	append_line(text, "M107");
+	append_line(text, "M190 S60 ; set bed temperature and wait for it to be reached");
+	append_line(text, "M104 S215 ; set temperature");
+	append_line(text, "G28 ; home all axes");
+	append_line(text, "M109 S215 ; set temperature and wait for it to be reached");
+	append_line(text, "G21 ; set units to millimeters");
+	append_line(text, "G90 ; use absolute coordinates");
+	append_line(text, "M83 ; use relative distances for extrusion");
+	double e = 0;
+	for (int layer = 0; layer < layers; layer++)
+	{
+		const double z = 0.2 + layer * 0.2;
+		append_line(text, "G1 Z%.3f F10800.000", z);
+		append_line(text, "G1 X80.000 Y80.000");
+		append_line(text, "G1 E0.80000 F2100.00000");
+		append_line(text, "G1 F1200");
+		e = append_loop(text, 40.0, e, 0.033, true, "perimeter");
+		e = append_loop(text, 39.2, e, 0.033, true, "perimeter");
+		append_line(text, "G1 E-0.80000 F2100.00000");
+		append_line(text, "G1 Z%.3f F10800.000", z + 0.6);
+		append_line(text, "G1 X81.000 Y81.000 ; move to first infill point");
+		append_line(text, "G1 Z%.3f", z);
+		append_line(text, "G1 E0.80000 F2100.00000");
+		for (int line = 0; line < 20; line++)
+		{
+			append_line(text, "G1 X%.3f Y81.000 F10800.000", 81.0 + line * 1.9);
+			append_line(text, "G1 X%.3f Y119.000 E1.20000 F1800.000 ; infill", 81.0 + line * 1.9);
+		}
+		append_line(text, "G1 E-0.80000 F2100.00000");
+		append_line(text, "G1 Z%.3f F10800.000", z + 0.6);
+	}
+	append_line(text, "M107");
+	append_line(text, "M104 S0 ; turn off temperature");
+	return corpus;
+}
+
+static benchmark_corpus create_simplify_3d_corpus(int layers)
+{
+	benchmark_corpus corpus;
+	corpus.name = "Simplify3D";
+	corpus.num_extruders = 1;
+	corpus.shared_extruder = true;
+	std::string& text = corpus.text;
+	append_line(text, "; G-Code generated by Simplify3D(R) Version 4.1.2");
+	append_line(text, ";   layerHeight,0.2");
+	append_line(text, "G90");
+	append_line(text, "M82");
+	append_line(text, "M106 S0");
+	append_line(text, "M140 S60");
+	append_line(text, "M190 S60");
+	append_line(text, "M104 S210 T0");
+	append_line(text, "M109 S210 T0");
+	append_line(text, "G28 ; home all axes");
+	double e = 0;
+	for (int layer = 1; layer <= layers; layer++)
+	{
+		const double z = layer * 0.2;
+		append_line(text, "; layer %d, Z = %.3f", layer, z);
+		append_line(text, "T0");
+		append_line(text, "G92 E0.0000");
+		e = 0;
+		append_line(text, "G1 E-1.0000 F1800");
+		append_line(text, "; feature outer perimeter");
+		append_line(text, "; tool H0.200 W0.400");
+		append_line(text, "G1 Z%.3f F1000", z);
+		append_line(text, "G1 X80.000 Y80.000 F4800");
+		append_line(text, "G1 E0.0000 F540");
+		append_line(text, "G92 E0.0000");
+		e = append_loop(text, 40.0, e, 0.033, false, NULL);
+		append_line(text, "; feature inner perimeter");
+		e = append_loop(text, 39.2, e, 0.033, false, NULL);
+		append_line(text, "; feature solid layer");
+		for (int line = 0; line < 20; line++)
+		{
+			append_line(text, "G1 X%.3f Y81.000 F4800", 81.0 + line * 1.9);
+			e += 1.2;
+			append_line(text, "G1 X%.3f Y119.000 E%.4f F1800", 81.0 + line * 1.9, e);
+		}
+		append_line(text, "G1 E%.4f F1800", e - 1.0);
+	}
+	append_line(text, "M104 S0 ; turn off extruder");
+	return corpus;
+}
+
+static benchmark_corpus create_vase_corpus(int layers)
+{
+	benchmark_corpus corpus;
+	corpus.name = "Vase Mode";
+	corpus.num_extruders = 1;
+	corpus.shared_extruder = true;
+	std::string& text = corpus.text;
+	append_line(text, ";FLAVOR:Marlin");
+	append_line(text, ";Generated with Cura_SteamEngine 4.1.0");
+	append_line(text, "M82");
+	append_line(text, "G28");
+	append_line(text, "G92 E0");
+	double e = 0;
+	const int points_per_layer = 64;
+	for (int layer = 0; layer < layers; layer++)
+	{
+		append_line(text, ";LAYER:%d", layer);
+		append_line(text, ";TYPE:WALL-OUTER");
+		// A spiral, so z rises continuously within every layer.
+		for (int point = 0; point < points_per_layer; point++)
+		{
+			const double angle = 6.283185307179586 * point / points_per_layer;
+			const double z = 0.2 + (layer + static_cast<double>(point) / points_per_layer) * 0.2;
+			e += 0.1;
+			append_line(text, "G1 X%.3f Y%.3f Z%.3f E%.5f", 100.0 + 30.0 * cos(angle), 100.0 + 30.0 * sin(angle), z, e);
+		}
+	}
+	return corpus;
+}
+
+static benchmark_corpus create_arc_welder_corpus(int layers)
+{
+	benchmark_corpus corpus;
+	corpus.name = "Arc Welder";
+	corpus.num_extruders = 1;
+	corpus.shared_extruder = true;
+	std::string& text = corpus.text;
+	append_line(text, ";FLAVOR:Marlin");
+	append_line(text, ";Generated with Cura_SteamEngine 4.1.0");
+	append_line(text, "; Postprocessed by [ArcWelder](https://github.com/FormerLurker/ArcWelderLib)");
+	append_line(text, "M82 ;absolute extrusion mode");
+	append_line(text, "G28 ;Home");
+	append_line(text, "G92 E0");
+	double e = 0;
+	for (int layer = 0; layer < layers; layer++)
+	{
+		const double z = 0.2 + layer * 0.2;
+		append_line(text, ";LAYER:%d", layer);
+		append_line(text, "G0 F7200 X80.000 Y100.000 Z%.3f", z);
+		append_line(text, ";TYPE:WALL-OUTER");
+		append_line(text, "G1 F2700 E%.5f", e);
+		// Circular outlines, each replaced by quarter arcs in alternating directions.
+		for (int wall = 0; wall < 4; wall++)
+		{
+			const double radius = 20.0 - wall * 0.4;
+			const double quarter_e = 1.5707963267948966 * radius * 0.033;
+			const bool clockwise = wall % 2 == 1;
+			const double corners[4][2] = { { -radius, 0 }, { 0, -radius }, { radius, 0 }, { 0, radius } };
+			append_line(text, "G0 X%.3f Y100.000", 100.0 - radius);
+			for (int quarter = 1; quarter <= 4; quarter++)
+			{
+				const int from = clockwise ? (4 - quarter + 1) % 4 : quarter - 1;
+				const int to = clockwise ? (4 - quarter) % 4 : quarter % 4;
+				e += quarter_e;
+				append_line(
+					text, "%s X%.3f Y%.3f I%.3f J%.3f E%.5f", clockwise ? "G2" : "G3", 100.0 + corners[to][0],
+					100.0 + corners[to][1], -corners[from][0], -corners[from][1], e
+				);
+			}
+		}
+		append_line(text, "G1 F2700 E%.5f", e - 6.5);
+		append_line(text, "G0 F300 X80.000 Y100.000 Z%.3f", z + 0.2);
+		append_line(text, "G1 F2700 E%.5f", e);
+	}
+	return corpus;
+}
+
+static benchmark_corpus create_multi_extruder_corpus(int layers)
+{
+	benchmark_corpus corpus;
+	corpus.name = "Multi Extruder";
+	corpus.num_extruders = 2;
+	corpus.shared_extruder = false;
+	std::string& text = corpus.text;
+	append_line(text, "; generated by Slic3r Prusa Edition 1.41.3+ on 2019-04-28 at 15:57:39");
+	append_line(text, "M104 S215 T0");
+	append_line(text, "M104 S215 T1");
+	append_line(text, "G28");
+	append_line(text, "G21");
+	append_line(text, "G90");
+	append_line(text, "M83");
+	append_line(text, "T0");
+	double e = 0;
+	for (int layer = 0; layer < layers; layer++)
+	{
+		const double z = 0.2 + layer * 0.2;
+		append_line(text, "G1 Z%.3f F10800.000", z);
+		for (int tool = 0; tool < 2; tool++)
+		{
+			append_line(text, "T%d", tool);
+			append_line(text, "G1 E-4.00000 F2400.00000");
+			// Wipe tower
+			append_line(text, "G1 X170.000 Y170.000 F10800.000");
+			append_line(text, "G1 E4.00000 F2400.00000");
+			for (int line = 0; line < 6; line++)
+			{
+				append_line(text, "G1 X%.3f Y170.000 E0.20000 F1800.000", line % 2 == 0 ? 190.0 : 170.0);
+				append_line(text, "G1 Y%.3f", 170.0 + line * 0.5);
+			}
+			append_line(text, "G1 E-0.80000 F2100.00000");
+			append_line(text, "G1 X80.000 Y80.000 F10800.000");
+			append_line(text, "G1 E0.80000 F2100.00000");
+			e = append_loop(text, tool == 0 ? 40.0 : 30.0, e, 0.033, true, "perimeter");
+			e = append_loop(text, tool == 0 ? 39.2 : 29.2, e, 0.033, true, "perimeter");
+		}
+	}
+	append_line(text, "M104 S0 T0");
+	append_line(text, "M104 S0 T1");
+	return corpus;
+}
+
+static bool load_corpus_file(const std::string& path, benchmark_corpus& corpus)
+{
+	std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+	if (!file.is_open())
+		return false;
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	corpus.name = path;
+	corpus.text = buffer.str();
+	corpus.num_extruders = 1;
+	corpus.shared_extruder = true;
+	return true;
+}
+#pragma endregion Corpus
+
+#pragma region Benchmarks
+struct benchmark_line
+{
+	const char* p_line;
+	size_t length;
+};
+
+static std::vector<benchmark_line> split_lines(const std::string& text)
+{
+	std::vector<benchmark_line> lines;
+	const char* p_cur = text.c_str();
+	const char* p_end = p_cur + text.length();
+	while (p_cur < p_end)
+	{
+		const char* p_newline = static_cast<const char*>(memchr(p_cur, '\n', p_end - p_cur));
+		const char* p_line_end = p_newline == NULL ? p_end : p_newline;
+		benchmark_line line;
+		line.p_line = p_cur;
+		line.length = p_line_end - p_cur;
+		lines.push_back(line);
+		p_cur = p_line_end + 1;
+	}
+	return lines;
+}
+
+static gcode_position_args get_position_args(const benchmark_corpus& corpus)
+{
+	gcode_position_args args;
+	args.autodetect_position = true;
+	args.priming_height = 0.75;
+	args.minimum_layer_height = 0.05;
+	args.shared_extruder = corpus.shared_extruder;
+	args.set_num_extruders(corpus.num_extruders);
+	for (int index = 0; index < corpus.num_extruders; index++)
+	{
+		args.retraction_lengths[index] = 0.8;
+		args.z_lift_heights[index] = 0.6;
+		args.x_firmware_offsets[index] = 0;
+		args.y_firmware_offsets[index] = 0;
+	}
+	args.x_min = 0;
+	args.x_max = 250;
+	args.y_min = 0;
+	args.y_max = 210;
+	args.z_min = 0;
+	args.z_max = 200;
+	args.snapshot_x_min = args.x_min;
+	args.snapshot_x_max = args.x_max;
+	args.snapshot_y_min = args.y_min;
+	args.snapshot_y_max = args.y_max;
+	args.snapshot_z_min = args.z_min;
+	args.snapshot_z_max = args.z_max;
+	return args;
+}
+
+struct benchmark_result
+{
+	benchmark_result()
+	{
+		lines = 0;
+		seconds = 0;
+		allocations = 0;
+	}
+	unsigned long long lines;
+	double seconds;
+	unsigned long long allocations;
+};
+
+typedef std::chrono::steady_clock benchmark_clock;
+
+static double get_seconds(benchmark_clock::time_point start, benchmark_clock::time_point end)
+{
+	return std::chrono::duration<double>(end - start).count();
+}
+
+static void print_result(const std::string& corpus_name, const std::string& benchmark_name, const benchmark_result& result)
+{
+	const double lines = result.lines > 0 ? static_cast<double>(result.lines) : 1.0;
+	printf("%-16s %-28s %10llu lines %14.0f lines/sec %10.1f ns/line %8.3f allocs/line\n",
+		corpus_name.c_str(),
+		benchmark_name.c_str(),
+		result.lines,
+		result.seconds > 0 ? lines / result.seconds : 0.0,
+		result.seconds * 1e9 / lines,
+		static_cast<double>(result.allocations) / lines
+	);
+}
+
+static benchmark_result benchmark_parser(const std::vector<benchmark_line>& lines, int iterations)
+{
+	benchmark_result result;
+	gcode_parser parser;
+	parsed_command command;
+	const unsigned long long start_allocations = benchmark_allocations;
+	const benchmark_clock::time_point start = benchmark_clock::now();
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		for (unsigned int index = 0; index < lines.size(); index++)
+		{
+			command.clear();
+			parser.try_parse_gcode(lines[index].p_line, lines[index].length, command);
+		}
+	}
+	result.seconds = get_seconds(start, benchmark_clock::now());
+	result.allocations = benchmark_allocations - start_allocations;
+	result.lines = static_cast<unsigned long long>(lines.size()) * iterations;
+	return result;
+}
+
+static std::vector<parsed_command> parse_all(const std::vector<benchmark_line>& lines)
+{
+	gcode_parser parser;
+	std::vector<parsed_command> commands(lines.size());
+	for (unsigned int index = 0; index < lines.size(); index++)
+	{
+		parser.try_parse_gcode(lines[index].p_line, lines[index].length, commands[index]);
+	}
+	return commands;
+}
+
+static benchmark_result benchmark_position_update(const benchmark_corpus& corpus, std::vector<parsed_command>& commands, int iterations, int tracking_mask = position_tracking_all)
+{
+	benchmark_result result;
+	gcode_position_args args = get_position_args(corpus);
+	args.tracking_mask = tracking_mask;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		gcode_position position_processor(args);
+		const unsigned long long start_allocations = benchmark_allocations;
+		const benchmark_clock::time_point start = benchmark_clock::now();
+		for (unsigned int index = 0; index < commands.size(); index++)
+		{
+			position_processor.update(commands[index], index + 1, index + 1, -1);
+		}
+		result.seconds += get_seconds(start, benchmark_clock::now());
+		result.allocations += benchmark_allocations - start_allocations;
+		result.lines += commands.size();
+	}
+	return result;
+}
+
+static benchmark_result benchmark_trigger_positions(const benchmark_corpus& corpus, std::vector<parsed_command>& commands, int iterations)
+{
+	// Positions are captured in windows, outside of the timed region, so that only try_add is measured.
+	const unsigned int window_size = 1024;
+	benchmark_result result;
+	std::vector<position> current_positions(window_size);
+	std::vector<position> previous_positions(window_size);
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		gcode_position position_processor(get_position_args(corpus));
+		trigger_position_args args;
+		args.type = trigger_type_compatibility;
+		args.x_stabilization_disabled = false;
+		args.y_stabilization_disabled = false;
+		trigger_positions positions;
+		positions.initialize(args);
+		positions.set_stabilization_coordinates(100, 100);
+		unsigned int index = 0;
+		while (index < commands.size())
+		{
+			unsigned int window_count = 0;
+			for (; index < commands.size() && window_count < window_size; index++)
+			{
+				position_processor.update(commands[index], index + 1, index + 1, -1);
+				if (commands[index].command.length() == 0)
+					continue;
+				current_positions[window_count] = *position_processor.get_current_position_ptr();
+				previous_positions[window_count] = *position_processor.get_previous_position_ptr();
+				window_count++;
+			}
+			const unsigned long long start_allocations = benchmark_allocations;
+			const benchmark_clock::time_point start = benchmark_clock::now();
+			for (unsigned int window_index = 0; window_index < window_count; window_index++)
+			{
+				if (current_positions[window_index].is_layer_change)
+					positions.clear();
+				positions.try_add(&current_positions[window_index], &previous_positions[window_index]);
+			}
+			result.seconds += get_seconds(start, benchmark_clock::now());
+			result.allocations += benchmark_allocations - start_allocations;
+			result.lines += window_count;
+		}
+	}
+	return result;
+}
+
+static bool benchmark_progress_callback(double percent_complete, double seconds_elapsed, double estimated_seconds_remaining, long gcodes_processed, long lines_processed)
+{
+	return true;
+}
+
+static stabilization_args get_stabilization_args(const std::string& file_path, const std::string& trace_directory = "")
+{
+	stabilization_args args;
+	args.trace_directory = trace_directory;
+	args.file_path = file_path;
+	args.x_coordinate = 100;
+	args.y_coordinate = 100;
+	args.notification_period_seconds = 1;
+	return args;
+}
+
+static benchmark_result benchmark_smart_layer(const benchmark_corpus& corpus, const std::string& file_path, int iterations, const std::string& trace_directory = "")
+{
+	benchmark_result result;
+	if (!trace_directory.empty())
+	{
+		// Write the trace before timing the replays.
+		smart_layer_args mt_args;
+		stabilization_smart_layer stabilization(get_position_args(corpus), get_stabilization_args(file_path, trace_directory), mt_args, benchmark_progress_callback);
+		stabilization.process_file();
+	}
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		smart_layer_args mt_args;
+		mt_args.smart_layer_trigger_type = trigger_type_compatibility;
+		const unsigned long long start_allocations = benchmark_allocations;
+		const benchmark_clock::time_point start = benchmark_clock::now();
+		stabilization_smart_layer stabilization(get_position_args(corpus), get_stabilization_args(file_path, trace_directory), mt_args, benchmark_progress_callback);
+		stabilization_results results = stabilization.process_file();
+		result.seconds += get_seconds(start, benchmark_clock::now());
+		result.allocations += benchmark_allocations - start_allocations;
+		result.lines += results.lines_processed;
+	}
+	return result;
+}
+
+static benchmark_result benchmark_smart_layer_multiple(const benchmark_corpus& corpus, const std::string& file_path, int iterations)
+{
+	// Every trigger type from a single pass through the file.
+	const trigger_type trigger_types[] = { trigger_type_fast, trigger_type_compatibility, trigger_type_high_quality, trigger_type_snap_to_print };
+	const int num_trigger_types = sizeof(trigger_types) / sizeof(trigger_types[0]);
+	benchmark_result result;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		const unsigned long long start_allocations = benchmark_allocations;
+		const benchmark_clock::time_point start = benchmark_clock::now();
+		std::vector<stabilization*> stabilizations;
+		for (int index = 0; index < num_trigger_types; index++)
+		{
+			smart_layer_args mt_args;
+			mt_args.smart_layer_trigger_type = trigger_types[index];
+			stabilizations.push_back(new stabilization_smart_layer(get_position_args(corpus), get_stabilization_args(file_path), mt_args, benchmark_progress_callback));
+		}
+		std::vector<stabilization_results> results = stabilization::process_file_multiple(stabilizations);
+		for (int index = 0; index < num_trigger_types; index++)
+			delete stabilizations[index];
+		result.seconds += get_seconds(start, benchmark_clock::now());
+		result.allocations += benchmark_allocations - start_allocations;
+		result.lines += results[0].lines_processed;
+	}
+	return result;
+}
+
+static benchmark_result benchmark_smart_gcode(const benchmark_corpus& corpus, const std::string& file_path, int iterations)
+{
+	benchmark_result result;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		smart_gcode_args mt_args;
+		const unsigned long long start_allocations = benchmark_allocations;
+		const benchmark_clock::time_point start = benchmark_clock::now();
+		stabilization_smart_gcode stabilization(get_position_args(corpus), get_stabilization_args(file_path), mt_args, benchmark_progress_callback);
+		stabilization_results results = stabilization.process_file();
+		result.seconds += get_seconds(start, benchmark_clock::now());
+		result.allocations += benchmark_allocations - start_allocations;
+		result.lines += results.lines_processed;
+	}
+	return result;
+}
+
+static benchmark_result benchmark_smart_timer(const benchmark_corpus& corpus, const std::string& file_path, int iterations)
+{
+	benchmark_result result;
+	for (int iteration = 0; iteration < iterations; iteration++)
+	{
+		smart_timer_args mt_args;
+		mt_args.smart_timer_trigger_type = trigger_type_compatibility;
+		mt_args.interval_seconds = 10;
+		const unsigned long long start_allocations = benchmark_allocations;
+		const benchmark_clock::time_point start = benchmark_clock::now();
+		stabilization_smart_timer stabilization(get_position_args(corpus), get_stabilization_args(file_path), mt_args, benchmark_progress_callback);
+		stabilization_results results = stabilization.process_file();
+		result.seconds += get_seconds(start, benchmark_clock::now());
+		result.allocations += benchmark_allocations - start_allocations;
+		result.lines += results.lines_processed;
+	}
+	return result;
+}
+
+static void run_corpus_benchmarks(const benchmark_corpus& corpus, const std::string& file_path, int iterations, const std::string& trace_directory)
+{
+	std::vector<benchmark_line> lines = split_lines(corpus.text);
+	std::vector<parsed_command> commands = parse_all(lines);
+	print_result(corpus.name, "gcode_parser::try_parse_gcode", benchmark_parser(lines, iterations));
+	print_result(corpus.name, "gcode_position::update", benchmark_position_update(corpus, commands, iterations));
+	print_result(corpus.name, "gcode_position::update (no tags)", benchmark_position_update(corpus, commands, iterations, position_tracking_all & ~position_tracking_comments));
+	print_result(corpus.name, "gcode_position::update (xyz)", benchmark_position_update(corpus, commands, iterations, position_tracking_none));
+	print_result(corpus.name, "trigger_positions::try_add", benchmark_trigger_positions(corpus, commands, iterations));
+	print_result(corpus.name, "smart layer", benchmark_smart_layer(corpus, file_path, iterations));
+	print_result(corpus.name, "smart layer (4 triggers, 1 pass)", benchmark_smart_layer_multiple(corpus, file_path, iterations));
+	print_result(corpus.name, "smart gcode", benchmark_smart_gcode(corpus, file_path, iterations));
+	print_result(corpus.name, "smart timer", benchmark_smart_timer(corpus, file_path, iterations));
+	if (!trace_directory.empty())
+		print_result(corpus.name, "smart layer (trace replay)", benchmark_smart_layer(corpus, file_path, iterations, trace_directory));
+}
+#pragma endregion Benchmarks
+
+#pragma region Number Parser Verification
+// Compares the fast number parser with the reference at the start of text.  Returns false and prints the text if the
+// result, the value's bits or the number of characters consumed differ.
+static bool verify_number(const char* p_text, size_t length)
+{
+	const char* p_end = p_text + length;
+	char* p_fast = const_cast<char*>(p_text);
+	char* p_reference = const_cast<char*>(p_text);
+	double fast_value = 0;
+	double reference_value = 0;
+	const bool fast_result = gcode_parser::try_extract_double(&p_fast, p_end, &fast_value);
+	const bool reference_result = gcode_parser::try_extract_double_reference(&p_reference, p_end, &reference_value);
+	if (
+		fast_result == reference_result
+		&& p_fast == p_reference
+		&& memcmp(&fast_value, &reference_value, sizeof(double)) == 0
+	)
+		return true;
+	printf("Number parser mismatch for '%s': fast %d %.17g (%d chars), reference %d %.17g (%d chars)\n",
+		std::string(p_text, length).c_str(),
+		fast_result, fast_value, static_cast<int>(p_fast - p_text),
+		reference_result, reference_value, static_cast<int>(p_reference - p_text)
+	);
+	return false;
+}
+
+// Checks every suffix of the text that follows a parameter letter, which covers every number in a gcode file.
+static unsigned long long verify_numbers_in_text(const std::string& text, unsigned long long& failures)
+{
+	unsigned long long checked = 0;
+	std::vector<benchmark_line> lines = split_lines(text);
+	for (unsigned int line_index = 0; line_index < lines.size(); line_index++)
+	{
+		const benchmark_line& line = lines[line_index];
+		for (size_t index = 0; index < line.length; index++)
+		{
+			const char c = line.p_line[index];
+			if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'))
+			{
+				++checked;
+				if (!verify_number(line.p_line + index + 1, line.length - index - 1))
+					++failures;
+			}
+		}
+	}
+	return checked;
+}
+
+static int verify_number_parser(const std::vector<benchmark_corpus>& corpora)
+{
+	static const char* edge_cases[] = {
+		"", "-", "+", ".", "-.", " ", "0", "-0", "+0", "0.", ".0", "-.5", "1.", "12345678", "123456789", "1234567.8",
+		"12345678.12345678", "123456789012345", "1234567890123456", "12345678901234567890", "0.123456789012345",
+		"0.1234567890123456", "0.000000000000001", "9999999999999999", "999999999999999.999999999999999",
+		"1 2.3", "12 .5", "1. 5", "1.5 6", "1.5 .6", "1.5 X2", "  -  12.5", "- 1", "-1-1", "1.2.3", "1e5", "0x10",
+		"12;comment", "12\r", "12\t3", "5.25 ", "  7", "00000000000000000001", "0.00000000", "3.14159265358979",
+		"10.000000000000001", "1234567.\0", "abc", "X10", "12345678\n", "1234567-", "12345678/", "12345678:"
+	};
+	unsigned long long checked = 0;
+	unsigned long long failures = 0;
+	for (unsigned int index = 0; index < sizeof(edge_cases) / sizeof(edge_cases[0]); index++)
+	{
+		// Check with the end of the buffer right after the text, and with more gcode after it.
+		const std::string text = edge_cases[index];
+		const std::string padded = text + " Y7.5 Z0.2 ; 12345678";
+		checked += 2;
+		if (!verify_number(text.c_str(), text.length()))
+			++failures;
+		if (!verify_number(padded.c_str(), padded.length()))
+			++failures;
+	}
+	// Random digit strings of every shape, including the 8 character boundaries of the fast path.
+	srand(12345);
+	for (int index = 0; index < 200000; index++)
+	{
+		std::string text;
+		if (rand() % 4 == 0)
+			text += rand() % 2 == 0 ? '-' : '+';
+		const int integer_digits = rand() % 20;
+		for (int digit = 0; digit < integer_digits; digit++)
+			text += static_cast<char>('0' + rand() % 10);
+		if (rand() % 3 != 0)
+		{
+			text += '.';
+			const int fraction_digits = rand() % 20;
+			for (int digit = 0; digit < fraction_digits; digit++)
+				text += static_cast<char>('0' + rand() % 10);
+		}
+		static const char terminators[] = " X;\r\n.-\t";
+		if (rand() % 2 == 0)
+			text += terminators[rand() % (sizeof(terminators) - 1)];
+		++checked;
+		if (!verify_number(text.c_str(), text.length()))
+			++failures;
+	}
+	for (unsigned int index = 0; index < corpora.size(); index++)
+		checked += verify_numbers_in_text(corpora[index].text, failures);
+	printf("Number parser verification: %llu checked, %llu mismatches\n", checked, failures);
+	return failures == 0 ? 0 : 1;
+}
+#pragma endregion Number Parser Verification
+
+int main(int argc, char* argv[])
+{
+	int iterations = 3;
+	std::string trace_directory;
+	bool verify_parser = false;
+	std::vector<std::string> file_paths;
+	for (int index = 1; index < argc; index++)
+	{
+		if (strcmp(argv[index], "-i") == 0 && index + 1 < argc)
+		{
+			iterations = atoi(argv[++index]);
+			if (iterations < 1)
+				iterations = 1;
+		}
+		else if (strcmp(argv[index], "-t") == 0 && index + 1 < argc)
+		{
+			trace_directory = argv[++index];
+		}
+		else if (strcmp(argv[index], "-v") == 0)
+		{
+			verify_parser = true;
+		}
+		else
+		{
+			file_paths.push_back(argv[index]);
+		}
+	}
+
+	if (!file_paths.empty())
+	{
+		std::vector<benchmark_corpus> file_corpora(file_paths.size());
+		for (unsigned int index = 0; index < file_paths.size(); index++)
+		{
+			if (!load_corpus_file(file_paths[index], file_corpora[index]))
+			{
+				std::cerr << "Unable to read " << file_paths[index] << "\n";
+				return 1;
+			}
+		}
+		if (verify_parser)
+			return verify_number_parser(file_corpora);
+		for (unsigned int index = 0; index < file_paths.size(); index++)
+			run_corpus_benchmarks(file_corpora[index], file_paths[index], iterations, trace_directory);
+		return 0;
+	}
+
+	std::vector<benchmark_corpus> corpora;
+	corpora.push_back(create_cura_corpus(500));
+	corpora.push_back(create_slic3r_pe_corpus(500));
+	corpora.push_back(create_simplify_3d_corpus(500));
+	corpora.push_back(create_vase_corpus(1500));
+	corpora.push_back(create_arc_welder_corpus(1500));
+	corpora.push_back(create_multi_extruder_corpus(300));
+	if (verify_parser)
+		return verify_number_parser(corpora);
+	const std::string file_path = "octolapse_benchmark.gcode";
+	for (unsigned int index = 0; index < corpora.size(); index++)
+	{
+		// The preprocessing benchmarks read from disk, just like a real print.
+		std::ofstream file(file_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		file << corpora[index].text;
+		file.close();
+		run_corpus_benchmarks(corpora[index], file_path, iterations, trace_directory);
+	}
+	std::remove(file_path.c_str());
+	return 0;
+}
@@ -0,0 +1,129 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "binary_stream.h"
+#include <cstring>
+
+binary_writer::binary_writer()
+{
+}
+
+void binary_writer::write_bool(bool value)
+{
+	buffer_.push_back(value ? 1 : 0);
+}
+
+void binary_writer::write_char(char value)
+{
+	buffer_.push_back(value);
+}
+
+void binary_writer::write_int(int value)
+{
+	write_bytes(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void binary_writer::write_long(long value)
+{
+	// long is 32 bits on Windows and 64 bits on most other platforms, so always write 64 bits.
+	const long long value_64 = value;
+	write_bytes(reinterpret_cast<const char*>(&value_64), sizeof(value_64));
+}
+
+void binary_writer::write_double(double value)
+{
+	write_bytes(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void binary_writer::write_string(const std::string& value)
+{
+	write_int(static_cast<int>(value.size()));
+	buffer_.append(value);
+}
+
+void binary_writer::write_bytes(const char* p_data, size_t length)
+{
+	buffer_.append(p_data, length);
+}
+
+void binary_writer::replace_bytes(size_t position, const char* p_data, size_t length)
+{
+	buffer_.replace(position, length, p_data, length);
+}
+
+const std::string& binary_writer::get_buffer() const
+{
+	return buffer_;
+}
+
+void binary_writer::take_buffer(std::string& buffer)
+{
+	buffer.clear();
+	buffer.swap(buffer_);
+}
+
+void binary_writer::clear()
+{
+	buffer_.clear();
+}
+
+binary_reader::binary_reader(const char* p_data, size_t length)
+{
+	p_data_ = p_data;
+	length_ = length;
+	position_ = 0;
+}
+
+bool binary_reader::read_string(std::string& value)
+{
+	int length;
+	if (!read_int(length) || length < 0 || static_cast<size_t>(length) > length_ - position_)
+		return false;
+	value.assign(p_data_ + position_, static_cast<size_t>(length));
+	position_ += static_cast<size_t>(length);
+	return true;
+}
+
+bool binary_reader::read_count(int& count)
+{
+	return read_int(count) && count >= 0 && static_cast<size_t>(count) <= length_ - position_;
+}
+
+bool binary_reader::is_at_end() const
+{
+	return position_ >= length_;
+}
+
+size_t binary_reader::get_position() const
+{
+	return position_;
+}
+
+unsigned long long binary_hash(const char* p_data, size_t length, unsigned long long seed)
+{
+	unsigned long long hash = seed;
+	for (size_t index = 0; index < length; index++)
+	{
+		hash ^= static_cast<unsigned char>(p_data[index]);
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
@@ -0,0 +1,122 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef BINARY_STREAM_H
+#define BINARY_STREAM_H
+#include <string>
+#include <cstddef>
+#include <cstring>
+
+/**
+ * \brief Appends values to an in memory buffer in a compact binary form.  Values are written in the native byte order,
+ * so the output is only meant to be read back on the machine that wrote it (caches and traces, not exchange files).
+ */
+class binary_writer
+{
+public:
+	binary_writer();
+	void write_bool(bool value);
+	void write_char(char value);
+	void write_int(int value);
+	void write_long(long value);
+	void write_double(double value);
+	void write_string(const std::string& value);
+	void write_bytes(const char* p_data, size_t length);
+	/**
+	 * \brief Overwrites bytes that were already written, for values that are only known later, like counts.
+	 */
+	void replace_bytes(size_t position, const char* p_data, size_t length);
+	const std::string& get_buffer() const;
+	/**
+	 * \brief Moves the written bytes into buffer without copying them and leaves the writer empty.
+	 */
+	void take_buffer(std::string& buffer);
+	void clear();
+private:
+	std::string buffer_;
+};
+
+/**
+ * \brief Reads values written by a binary_writer.  Every read returns false once the data is exhausted, so reads can
+ * be chained with && and checked once.  The buffer is not copied and must outlive the reader.  The fixed size reads
+ * are defined here so that they are inlined, since a position trace makes dozens of them per line.
+ */
+class binary_reader
+{
+public:
+	binary_reader(const char* p_data, size_t length);
+	bool read_bool(bool& value)
+	{
+		char char_value;
+		if (!read_char(char_value))
+			return false;
+		value = char_value != 0;
+		return true;
+	}
+	bool read_char(char& value)
+	{
+		return read_bytes(&value, sizeof(value));
+	}
+	bool read_int(int& value)
+	{
+		return read_bytes(reinterpret_cast<char*>(&value), sizeof(value));
+	}
+	bool read_long(long& value)
+	{
+		long long value_64;
+		if (!read_bytes(reinterpret_cast<char*>(&value_64), sizeof(value_64)))
+			return false;
+		value = static_cast<long>(value_64);
+		return true;
+	}
+	bool read_double(double& value)
+	{
+		return read_bytes(reinterpret_cast<char*>(&value), sizeof(value));
+	}
+	bool read_string(std::string& value);
+	/**
+	 * \brief Reads the number of items that follow.  Fails if the count is negative or larger than the remaining
+	 * data, so corrupt input can't cause huge allocations.
+	 */
+	bool read_count(int& count);
+	bool read_bytes(char* p_data, size_t length)
+	{
+		if (length > length_ - position_)
+			return false;
+		memcpy(p_data, p_data_ + position_, length);
+		position_ += length;
+		return true;
+	}
+	bool is_at_end() const;
+	size_t get_position() const;
+private:
+	const char* p_data_;
+	size_t length_;
+	size_t position_;
+};
+
+/**
+ * \brief Returns the 64 bit FNV-1a hash of the data.  Pass a previous result as the seed to hash several blocks.
+ */
+unsigned long long binary_hash(const char* p_data, size_t length, unsigned long long seed = 14695981039346656037ULL);
+
+#endif
@@ -159,4 +159,54 @@ PyObject * extruder::build_py_object(extruder* p_extruders, const unsigned int n
 	}
 
 	return py_extruders;
-}
\ No newline at end of file
+}
+
+void extruder::serialize(binary_writer& writer) const
+{
+	writer.write_double(x_firmware_offset);
+	writer.write_double(y_firmware_offset);
+	writer.write_double(z_firmware_offset);
+	writer.write_double(e);
+	writer.write_double(e_offset);
+	writer.write_double(e_relative);
+	writer.write_double(extrusion_length);
+	writer.write_double(extrusion_length_total);
+	writer.write_double(retraction_length);
+	writer.write_double(deretraction_length);
+	writer.write_bool(is_extruding_start);
+	writer.write_bool(is_extruding);
+	writer.write_bool(is_primed);
+	writer.write_bool(is_retracting_start);
+	writer.write_bool(is_retracting);
+	writer.write_bool(is_retracted);
+	writer.write_bool(is_partially_retracted);
+	writer.write_bool(is_deretracting_start);
+	writer.write_bool(is_deretracting);
+	writer.write_bool(is_deretracted);
+}
+
+bool extruder::deserialize(binary_reader& reader)
+{
+	return (
+		reader.read_double(x_firmware_offset) &&
+		reader.read_double(y_firmware_offset) &&
+		reader.read_double(z_firmware_offset) &&
+		reader.read_double(e) &&
+		reader.read_double(e_offset) &&
+		reader.read_double(e_relative) &&
+		reader.read_double(extrusion_length) &&
+		reader.read_double(extrusion_length_total) &&
+		reader.read_double(retraction_length) &&
+		reader.read_double(deretraction_length) &&
+		reader.read_bool(is_extruding_start) &&
+		reader.read_bool(is_extruding) &&
+		reader.read_bool(is_primed) &&
+		reader.read_bool(is_retracting_start) &&
+		reader.read_bool(is_retracting) &&
+		reader.read_bool(is_retracted) &&
+		reader.read_bool(is_partially_retracted) &&
+		reader.read_bool(is_deretracting_start) &&
+		reader.read_bool(is_deretracting) &&
+		reader.read_bool(is_deretracted)
+	);
+}
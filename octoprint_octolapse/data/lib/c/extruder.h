@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include "binary_stream.h"
 #ifdef _DEBUG
 #undef _DEBUG
 #include <Python.h>
@@ -34,5 +35,7 @@ struct extruder
 	PyObject * to_py_tuple() const;
 	PyObject* to_py_dict() const;
 	static PyObject * build_py_object(extruder* p_extruders, unsigned int num_extruders);
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
 };
 
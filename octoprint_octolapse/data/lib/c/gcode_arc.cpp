@@ -0,0 +1,256 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "gcode_arc.h"
+#include "utilities.h"
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+
+static const double two_pi = 6.283185307179586476925286766559;
+
+gcode_arc::gcode_arc()
+{
+	center_x = 0;
+	center_y = 0;
+	radius = 0;
+	start_angle = 0;
+	sweep_angle = 0;
+	length = 0;
+	is_clockwise = false;
+	has_e = false;
+	has_f = false;
+	start_x_ = 0;
+	start_y_ = 0;
+	end_x_ = 0;
+	end_y_ = 0;
+	is_full_circle_ = false;
+}
+
+bool gcode_arc::try_set_circle(const parsed_command& cmd, const double start_x, const double start_y, const double end_x, const double end_y)
+{
+	if (cmd.opcode != gcode_opcode_g2 && cmd.opcode != gcode_opcode_g3)
+		return false;
+	is_clockwise = cmd.opcode == gcode_opcode_g2;
+	has_e = false;
+	has_f = false;
+	bool has_offset = false;
+	bool has_r = false;
+	double i = 0;
+	double j = 0;
+	double r = 0;
+	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
+	{
+		const parsed_command_parameter& p_cur_param = cmd.parameters[index];
+		switch (p_cur_param.name)
+		{
+		case 'X':
+		case 'Y':
+			break;
+		case 'I':
+			has_offset = true;
+			i = p_cur_param.double_value;
+			break;
+		case 'J':
+			has_offset = true;
+			j = p_cur_param.double_value;
+			break;
+		case 'R':
+			has_r = true;
+			r = p_cur_param.double_value;
+			break;
+		case 'E':
+			has_e = true;
+			break;
+		case 'F':
+			has_f = true;
+			break;
+		default:
+			// Z (helical arcs), P (repeated circles) and anything else would not survive being split in two.
+			return false;
+		}
+	}
+
+	is_full_circle_ = utilities::is_equal(start_x, end_x) && utilities::is_equal(start_y, end_y);
+	if (has_r)
+	{
+		// The center is on the perpendicular bisector of the chord.  A positive radius selects the shorter of the two
+		// possible arcs, and a negative radius the longer one.
+		if (is_full_circle_)
+			return false;
+		const double dx = end_x - start_x;
+		const double dy = end_y - start_y;
+		const double chord = sqrt(dx * dx + dy * dy);
+		double h = r * r - chord * chord / 4.0;
+		if (h < 0)
+		{
+			// Allow a radius that is a little too short to describe a half circle.
+			if (utilities::less_than(fabs(r), chord / 2.0))
+				return false;
+			h = 0;
+		}
+		h = sqrt(h);
+		const double side = (is_clockwise != (r < 0)) ? -1.0 : 1.0;
+		center_x = (start_x + end_x) / 2.0 - side * h * dy / chord;
+		center_y = (start_y + end_y) / 2.0 + side * h * dx / chord;
+	}
+	else if (has_offset)
+	{
+		center_x = start_x + i;
+		center_y = start_y + j;
+	}
+	else
+		return false;
+
+	radius = utilities::get_cartesian_distance(start_x, start_y, center_x, center_y);
+	if (utilities::is_zero(radius))
+		return false;
+	start_x_ = start_x;
+	start_y_ = start_y;
+	end_x_ = end_x;
+	end_y_ = end_y;
+	return true;
+}
+
+void gcode_arc::set_sweep()
+{
+	start_angle = atan2(start_y_ - center_y, start_x_ - center_x);
+	if (is_full_circle_)
+		sweep_angle = is_clockwise ? -two_pi : two_pi;
+	else
+	{
+		sweep_angle = atan2(end_y_ - center_y, end_x_ - center_x) - start_angle;
+		if (is_clockwise && sweep_angle >= 0)
+			sweep_angle -= two_pi;
+		else if (!is_clockwise && sweep_angle <= 0)
+			sweep_angle += two_pi;
+	}
+	length = fabs(sweep_angle) * radius;
+}
+
+double gcode_arc::get_circle_distance_squared(const double x, const double y) const
+{
+	const double distance = utilities::get_cartesian_distance(x, y, center_x, center_y) - radius;
+	return distance * distance;
+}
+
+void gcode_arc::get_point(const double fraction, double& x, double& y) const
+{
+	const double angle = start_angle + sweep_angle * fraction;
+	x = center_x + radius * cos(angle);
+	y = center_y + radius * sin(angle);
+}
+
+double gcode_arc::get_closest_fraction(const double x, const double y) const
+{
+	const double dx = x - center_x;
+	const double dy = y - center_y;
+	// Every point on the arc is equally close to its center
+	if (utilities::is_zero(dx) && utilities::is_zero(dy))
+		return 0;
+
+	// The angle travelled from the start of the arc to the point's direction from the center, in the arc's direction.
+	double travelled = atan2(dy, dx) - start_angle;
+	if (is_clockwise)
+		travelled = -travelled;
+	travelled = fmod(travelled, two_pi);
+	if (travelled < 0)
+		travelled += two_pi;
+
+	const double sweep = fabs(sweep_angle);
+	if (travelled <= sweep)
+		return travelled / sweep;
+
+	// The closest point on the circle isn't on the arc, so the closest point on the arc is one of its ends.
+	return utilities::get_cartesian_distance_squared(x, y, start_x_, start_y_) <= utilities::get_cartesian_distance_squared(x, y, end_x_, end_y_) ? 0 : 1;
+}
+
+bool gcode_arc::split(const position& start_pos, const position& end_pos, const double fraction, position& split_pos, parsed_command& start_command, parsed_command& end_command) const
+{
+	const extruder& end_extruder = end_pos.get_current_extruder();
+	// Only plain extrusions and travels divide evenly along the arc.  Retractions, deretractions and the start of an
+	// extrusion depend on the state before the move.
+	if (!utilities::is_zero(end_extruder.e_relative) && (!end_extruder.is_extruding || end_extruder.is_extruding_start))
+		return false;
+
+	split_pos = end_pos;
+	get_point(fraction, split_pos.x, split_pos.y);
+	extruder& split_extruder = split_pos.get_current_extruder();
+	if (!utilities::is_zero(end_extruder.e_relative))
+	{
+		const double remaining_e = end_extruder.e_relative * (1.0 - fraction);
+		split_extruder.e -= remaining_e;
+		split_extruder.e_relative -= remaining_e;
+		split_extruder.extrusion_length -= remaining_e;
+		split_extruder.extrusion_length_total -= remaining_e;
+	}
+
+	if (end_pos.is_extruder_relative)
+	{
+		set_command(start_pos, split_pos, split_extruder.e_relative, start_command);
+		set_command(split_pos, end_pos, end_extruder.e_relative - split_extruder.e_relative, end_command);
+	}
+	else
+	{
+		set_command(start_pos, split_pos, split_extruder.get_offset_e(), start_command);
+		set_command(split_pos, end_pos, end_extruder.get_offset_e(), end_command);
+	}
+	return true;
+}
+
+void gcode_arc::set_command(const position& from_pos, const position& to_pos, const double e, parsed_command& cmd) const
+{
+	cmd.clear();
+	cmd.command = is_clockwise ? "G2" : "G3";
+	cmd.opcode = is_clockwise ? gcode_opcode_g2 : gcode_opcode_g3;
+	cmd.is_known_command = true;
+	cmd.is_empty = false;
+
+	double x, y;
+	if (to_pos.is_relative)
+	{
+		x = to_pos.x - from_pos.x;
+		y = to_pos.y - from_pos.y;
+	}
+	else
+	{
+		x = to_pos.get_gcode_x();
+		y = to_pos.get_gcode_y();
+	}
+	// The center is always given as an offset, since a radius can't describe both halves of a long arc.
+	cmd.parameters.push_back(parsed_command_parameter('X', x));
+	cmd.parameters.push_back(parsed_command_parameter('Y', y));
+	cmd.parameters.push_back(parsed_command_parameter('I', center_x - from_pos.x));
+	cmd.parameters.push_back(parsed_command_parameter('J', center_y - from_pos.y));
+	if (has_e)
+		cmd.parameters.push_back(parsed_command_parameter('E', e));
+	if (has_f)
+		cmd.parameters.push_back(parsed_command_parameter('F', to_pos.f));
+
+	std::stringstream stream;
+	stream << std::fixed << cmd.command;
+	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
+	{
+		const parsed_command_parameter& parameter = cmd.parameters[index];
+		stream << " " << parameter.name << std::setprecision(parameter.name == 'E' ? 5 : 3) << parameter.double_value;
+	}
+	cmd.gcode = stream.str();
+}
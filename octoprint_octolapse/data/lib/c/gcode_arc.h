@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GCODE_ARC_H
+#define GCODE_ARC_H
+#include "parsed_command.h"
+#include "position.h"
+
+/**
+ * \brief The planar geometry of a G2 (clockwise) or G3 (counter-clockwise) move, so that points along the arc can be
+ * found without expanding it into line segments.  Angles are in radians, and the sweep is negative for clockwise arcs.
+ */
+struct gcode_arc
+{
+	gcode_arc();
+	/**
+	 * \brief Computes the circle of a G2/G3 command from the start point to the end point, using the I/J center
+	 * offsets or the R radius form.  Returns false if the command is not an arc, or if it is an arc that can't be
+	 * split in the xy plane (helical arcs, repeated full circles, or an invalid radius).
+	 */
+	bool try_set_circle(const parsed_command& cmd, double start_x, double start_y, double end_x, double end_y);
+	/**
+	 * \brief Computes the angles and length of the arc after try_set_circle succeeds.  This takes a few
+	 * trigonometric functions, so it is left until the arc is needed.
+	 */
+	void set_sweep();
+	/**
+	 * \brief Returns the squared distance from (x, y) to the closest point on the circle, which no point on the arc
+	 * is closer than.  Only the circle needs to be set.
+	 */
+	double get_circle_distance_squared(double x, double y) const;
+	/**
+	 * \brief Gets the point that is the given fraction (0-1) of the way along the arc.
+	 */
+	void get_point(double fraction, double& x, double& y) const;
+	/**
+	 * \brief Returns the fraction (0-1) of the way along the arc of the point on the arc closest to (x, y).
+	 */
+	double get_closest_fraction(double x, double y) const;
+	/**
+	 * \brief Splits the arc move from start_pos to end_pos at the given fraction.  split_pos receives the position at
+	 * the split point, start_command the first part of the arc and end_command the rest of it.  Returns false if the
+	 * move's extrusion can't be divided.
+	 */
+	bool split(const position& start_pos, const position& end_pos, double fraction, position& split_pos, parsed_command& start_command, parsed_command& end_command) const;
+	double center_x;
+	double center_y;
+	double radius;
+	double start_angle;
+	double sweep_angle;
+	double length;
+	bool is_clockwise;
+	bool has_e;
+	bool has_f;
+private:
+	double start_x_;
+	double start_y_;
+	double end_x_;
+	double end_y_;
+	bool is_full_circle_;
+	void set_command(const position& from_pos, const position& to_pos, double e, parsed_command& cmd) const;
+};
+#endif
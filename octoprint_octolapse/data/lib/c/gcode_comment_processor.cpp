@@ -1,9 +1,163 @@
 #include "gcode_comment_processor.h"
+#include <cstring>
+
+// How a comment affects one slicer's section tracking
+enum comment_marker_action
+{
+	// The comment means nothing to this slicer
+	comment_marker_action_none,
+	// The comment starts a section and identifies the slicer
+	comment_marker_action_section,
+	// The comment ends the current section, but doesn't identify the slicer
+	comment_marker_action_reset
+};
+
+struct comment_marker_slicer_action
+{
+	comment_marker_action action;
+	section_type section;
+};
+
+// Every comment the processor reacts to.  Each marker is matched once, and the result says what it
+// means to every slicer, so classifying a comment never needs more than one pass over the marker list.
+struct comment_marker
+{
+	const char* text;
+	// If true, any comment that starts with the text matches
+	bool is_prefix;
+	comment_marker_slicer_action cura;
+	comment_marker_slicer_action simplify_3d;
+	comment_marker_slicer_action slic3r_pe;
+	// Slic3r PE tags individual moves rather than sections
+	bool is_slic3r_pe_feature;
+	feature_type slic3r_pe_feature;
+	// The slicer identified by a header comment, or comment_process_type_unknown if this isn't a header
+	comment_process_type header_slicer;
+};
+
+#define NO_ACTION { comment_marker_action_none, section_type_no_section }
+#define SECTION(section) { comment_marker_action_section, section }
+#define RESET { comment_marker_action_reset, section_type_no_section }
+#define NO_FEATURE false, feature_type_unknown_feature
+#define FEATURE(feature) true, feature
+
+static const comment_marker comment_markers[] = {
+	// Cura
+	{ "TYPE:WALL-OUTER", false, SECTION(section_type_outer_perimeter_section), NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "TYPE:WALL-INNER", false, SECTION(section_type_inner_perimeter_section), NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "TYPE:FILL", false, SECTION(section_type_infill_section), NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "TYPE:SKIN", false, SECTION(section_type_solid_infill_section), NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "TYPE:SKIRT", false, SECTION(section_type_skirt_section), NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "LAYER:", true, RESET, NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ ";MESH:NONMESH", true, RESET, NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	// Simplify 3d.  Apparently simplify 3d added the word 'feature' to the their feature comments
+	// at some point to make my life more difficult :P
+	{ "feature outer perimeter", false, NO_ACTION, SECTION(section_type_outer_perimeter_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "feature inner perimeter", false, NO_ACTION, SECTION(section_type_inner_perimeter_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "feature infill", false, NO_ACTION, SECTION(section_type_infill_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "feature solid layer", false, NO_ACTION, SECTION(section_type_solid_infill_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "feature skirt", false, NO_ACTION, SECTION(section_type_skirt_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "feature ooze shield", false, NO_ACTION, SECTION(section_type_ooze_shield_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "feature prime pillar", false, NO_ACTION, SECTION(section_type_prime_pillar_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "feature gap fill", false, NO_ACTION, SECTION(section_type_gap_fill_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "outer perimeter", false, NO_ACTION, SECTION(section_type_outer_perimeter_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "inner perimeter", false, NO_ACTION, SECTION(section_type_inner_perimeter_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "infill", false, NO_ACTION, SECTION(section_type_infill_section), NO_ACTION, FEATURE(feature_type_infill_feature), comment_process_type_unknown },
+	{ "solid layer", false, NO_ACTION, SECTION(section_type_solid_infill_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "skirt", false, NO_ACTION, SECTION(section_type_skirt_section), NO_ACTION, FEATURE(feature_type_skirt_feature), comment_process_type_unknown },
+	{ "ooze shield", false, NO_ACTION, SECTION(section_type_ooze_shield_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "prime pillar", false, NO_ACTION, SECTION(section_type_prime_pillar_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	{ "gap fill", false, NO_ACTION, SECTION(section_type_gap_fill_section), NO_ACTION, NO_FEATURE, comment_process_type_unknown },
+	// Slic3r PE sections
+	{ "CP TOOLCHANGE WIPE", false, NO_ACTION, NO_ACTION, SECTION(section_type_prime_pillar_section), NO_FEATURE, comment_process_type_unknown },
+	{ "CP TOOLCHANGE END", false, NO_ACTION, NO_ACTION, SECTION(section_type_no_section), NO_FEATURE, comment_process_type_unknown },
+	// Slic3r PE features
+	{ "perimeter", false, NO_ACTION, NO_ACTION, NO_ACTION, FEATURE(feature_type_unknown_perimeter_feature), comment_process_type_unknown },
+	{ "move to first perimeter point", false, NO_ACTION, NO_ACTION, NO_ACTION, FEATURE(feature_type_unknown_perimeter_feature), comment_process_type_unknown },
+	{ "move to first infill point", false, NO_ACTION, NO_ACTION, NO_ACTION, FEATURE(feature_type_infill_feature), comment_process_type_unknown },
+	{ "infill(bridge)", false, NO_ACTION, NO_ACTION, NO_ACTION, FEATURE(feature_type_bridge_feature), comment_process_type_unknown },
+	{ "move to first infill(bridge) point", false, NO_ACTION, NO_ACTION, NO_ACTION, FEATURE(feature_type_bridge_feature), comment_process_type_unknown },
+	{ "move to first skirt point", false, NO_ACTION, NO_ACTION, NO_ACTION, FEATURE(feature_type_skirt_feature), comment_process_type_unknown },
+	// File headers
+	{ "Generated with Cura_SteamEngine", true, NO_ACTION, NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_cura },
+	{ "G-Code generated by Simplify3D", true, NO_ACTION, NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_simplify_3d },
+	{ "generated by PrusaSlicer", true, NO_ACTION, NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_slic3r_pe },
+	{ "generated by Slic3r", true, NO_ACTION, NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_slic3r_pe },
+	{ "generated by SuperSlicer", true, NO_ACTION, NO_ACTION, NO_ACTION, NO_FEATURE, comment_process_type_slic3r_pe }
+};
+
+#undef NO_ACTION
+#undef SECTION
+#undef RESET
+#undef NO_FEATURE
+#undef FEATURE
+
+#define NUM_COMMENT_MARKERS (sizeof(comment_markers) / sizeof(comment_markers[0]))
+#define COMMENT_MARKER_NONE -1
+
+// The markers grouped by their first character, so that a comment is only compared with the few markers that
+// could possibly match it.
+struct comment_marker_index
+{
+	comment_marker_index()
+	{
+		for (unsigned int c = 0; c < 256; c++)
+			bucket_start[c] = 0;
+		// Count the markers for each character, then turn the counts into bucket offsets.
+		unsigned int counts[256] = { 0 };
+		for (unsigned int index = 0; index < NUM_COMMENT_MARKERS; index++)
+		{
+			lengths[index] = strlen(comment_markers[index].text);
+			counts[static_cast<unsigned char>(comment_markers[index].text[0])]++;
+		}
+		unsigned int offset = 0;
+		for (unsigned int c = 0; c < 256; c++)
+		{
+			bucket_start[c] = offset;
+			offset += counts[c];
+			counts[c] = bucket_start[c];
+		}
+		bucket_start[256] = offset;
+		for (unsigned int index = 0; index < NUM_COMMENT_MARKERS; index++)
+		{
+			markers[counts[static_cast<unsigned char>(comment_markers[index].text[0])]++] = index;
+		}
+	}
+
+	int find(const std::string& comment) const
+	{
+		if (comment.empty())
+			return COMMENT_MARKER_NONE;
+		const unsigned char first = static_cast<unsigned char>(comment[0]);
+		const size_t length = comment.length();
+		for (unsigned int bucket_index = bucket_start[first]; bucket_index < bucket_start[first + 1]; bucket_index++)
+		{
+			const unsigned int marker_index = markers[bucket_index];
+			const size_t marker_length = lengths[marker_index];
+			if (comment_markers[marker_index].is_prefix ? length < marker_length : length != marker_length)
+				continue;
+			if (memcmp(comment.c_str(), comment_markers[marker_index].text, marker_length) == 0)
+				return static_cast<int>(marker_index);
+		}
+		return COMMENT_MARKER_NONE;
+	}
+
+	unsigned int bucket_start[257];
+	unsigned int markers[NUM_COMMENT_MARKERS];
+	size_t lengths[NUM_COMMENT_MARKERS];
+};
+
+static const comment_marker_index& get_comment_marker_index()
+{
+	static const comment_marker_index index;
+	return index;
+}
 
 gcode_comment_processor::gcode_comment_processor()
 {
 	current_section_ = section_type_no_section;
 	processing_type_ = comment_process_type_unknown;
+	lock_slicer_from_header_ = false;
 }
 
 gcode_comment_processor::~gcode_comment_processor()
@@ -15,6 +169,26 @@ comment_process_type gcode_comment_processor::get_comment_process_type()
 	return processing_type_;
 }
 
+void gcode_comment_processor::set_comment_process_type(comment_process_type type)
+{
+	processing_type_ = type;
+}
+
+section_type gcode_comment_processor::get_current_section() const
+{
+	return current_section_;
+}
+
+void gcode_comment_processor::set_current_section(section_type section)
+{
+	current_section_ = section;
+}
+
+void gcode_comment_processor::set_lock_slicer_from_header(bool lock_slicer_from_header)
+{
+	lock_slicer_from_header_ = lock_slicer_from_header;
+}
+
 void gcode_comment_processor::update(position& pos)
 {
 	if (processing_type_ == comment_process_type_off)
@@ -24,39 +198,23 @@ void gcode_comment_processor::update(position& pos)
 	{
 		update_feature_from_section(pos);
 		return;
-	}		
+	}
 
 	if (processing_type_ == comment_process_type_unknown || processing_type_ == comment_process_type_slic3r_pe)
 	{
 		if (update_feature_for_slic3r_pe_comment(pos, pos.command.comment))
 			processing_type_ = comment_process_type_slic3r_pe;
 	}
-	
+
 }
 
 bool gcode_comment_processor::update_feature_for_slic3r_pe_comment(position& pos, std::string &comment) const
 {
-	if (comment == "perimeter" || comment == "move to first perimeter point")
-	{
-		pos.feature_type_tag = feature_type_unknown_perimeter_feature;
-		return true;
-	}
-	if (comment == "infill" || comment == "move to first infill point")
-	{
-		pos.feature_type_tag = feature_type_infill_feature;
-		return true;
-	}
-	if (comment == "infill(bridge)" || comment == "move to first infill(bridge) point")
-	{
-		pos.feature_type_tag = feature_type_bridge_feature;
-		return true;
-	}
-	if (comment == "skirt" || comment == "move to first skirt point")
-	{
-		pos.feature_type_tag = feature_type_skirt_feature;
-		return true;
-	}
-	return false;
+	const int marker_index = get_comment_marker_index().find(comment);
+	if (marker_index == COMMENT_MARKER_NONE || !comment_markers[marker_index].is_slic3r_pe_feature)
+		return false;
+	pos.feature_type_tag = comment_markers[marker_index].slic3r_pe_feature;
+	return true;
 }
 
 void gcode_comment_processor::update_feature_from_section(position& pos) const
@@ -94,192 +252,68 @@ void gcode_comment_processor::update_feature_from_section(position& pos) const
 
 void gcode_comment_processor::update(std::string & comment)
 {
+	if (processing_type_ == comment_process_type_off)
+		return;
+	const int marker_index = get_comment_marker_index().find(comment);
+	if (marker_index == COMMENT_MARKER_NONE)
+		return;
+	const comment_marker& marker = comment_markers[marker_index];
 	switch(processing_type_)
 	{
-	case comment_process_type_off:
-		break;
 	case comment_process_type_unknown:
-		update_unknown_section(comment);
+		update_unknown_section(marker);
 		break;
 	case comment_process_type_cura:
-		update_cura_section(comment);
+		update_section(marker.cura);
 		break;
 	case comment_process_type_slic3r_pe:
-		update_slic3r_pe_section(comment);
+		update_section(marker.slic3r_pe);
 		break;
 	case comment_process_type_simplify_3d:
-		update_simplify_3d_section(comment);
+		update_section(marker.simplify_3d);
+		break;
+	default:
 		break;
 	}
 }
 
-void gcode_comment_processor::update_unknown_section(std::string & comment)
+void gcode_comment_processor::update_unknown_section(const comment_marker& marker)
 {
-	if (comment.length() == 0)
+	if (lock_slicer_from_header_ && marker.header_slicer != comment_process_type_unknown)
+	{
+		// The header tells us which slicer made the file, so stop guessing.
+		processing_type_ = marker.header_slicer;
 		return;
-
-	if (update_cura_section(comment))
+	}
+	// Try each slicer in turn, the first one that recognizes the section wins.
+	if (update_section(marker.cura))
 	{
 		processing_type_ = comment_process_type_cura;
 		return;
 	}
-		
-	if (update_simplify_3d_section(comment))
+	if (update_section(marker.simplify_3d))
 	{
 		processing_type_ = comment_process_type_simplify_3d;
 		return;
 	}
-	if(update_slic3r_pe_section(comment))
+	if (update_section(marker.slic3r_pe))
 	{
 		processing_type_ = comment_process_type_slic3r_pe;
 		return;
 	}
 }
 
-bool gcode_comment_processor::update_cura_section(std::string &comment)
+bool gcode_comment_processor::update_section(const comment_marker_slicer_action& slicer_action)
 {
-	if (comment == "TYPE:WALL-OUTER")
+	switch (slicer_action.action)
 	{
-		current_section_ = section_type_outer_perimeter_section;
+	case comment_marker_action_section:
+		current_section_ = slicer_action.section;
 		return true;
-	}
-	else if (comment == "TYPE:WALL-INNER")
-	{
-		current_section_ = section_type_inner_perimeter_section;
-		return true;
-	}
-	if (comment == "TYPE:FILL")
-	{
-		current_section_ = section_type_infill_section;
-		return true;
-	}
-	if (comment == "TYPE:SKIN")
-	{
-		current_section_ = section_type_solid_infill_section;
-		return true;
-	}
-	if (comment.rfind("LAYER:", 0) != std::string::npos || comment.rfind(";MESH:NONMESH", 0) != std::string::npos)
-	{
+	case comment_marker_action_reset:
 		current_section_ = section_type_no_section;
 		return false;
+	default:
+		return false;
 	}
-	if (comment == "TYPE:SKIRT")
-	{
-		current_section_ = section_type_skirt_section;
-		return true;
-	}
-	return false;
-}
-
-bool gcode_comment_processor::update_simplify_3d_section(std::string &comment)
-{
-	// Apparently simplify 3d added the word 'feature' to the their feature comments
-	// at some point to make my life more difficult :P
-	if (comment.rfind("feature", 0) != std::string::npos)
-	{
-		if (comment == "feature outer perimeter")
-		{
-			current_section_ = section_type_outer_perimeter_section;
-			return true;
-		}
-		if (comment == "feature inner perimeter")
-		{
-			current_section_ = section_type_inner_perimeter_section;
-			return true;
-		}
-		if (comment == "feature infill")
-		{
-			current_section_ = section_type_infill_section;
-			return true;
-		}
-		if (comment == "feature solid layer")
-		{
-			current_section_ = section_type_solid_infill_section;
-			return true;
-		}
-		if (comment == "feature skirt")
-		{
-			current_section_ = section_type_skirt_section;
-			return true;
-		}
-		if (comment == "feature ooze shield")
-		{
-			current_section_ = section_type_ooze_shield_section;
-			return true;
-		}
-		if (comment == "feature prime pillar")
-		{
-			current_section_ = section_type_prime_pillar_section;
-			return true;
-		}
-		if (comment == "feature gap fill")
-		{
-			current_section_ = section_type_gap_fill_section;
-			return true;
-		}
-	}
-	else
-	{
-		if (comment == "outer perimeter")
-		{
-			current_section_ = section_type_outer_perimeter_section;
-			return true;
-		}
-		if (comment == "inner perimeter")
-		{
-			current_section_ = section_type_inner_perimeter_section;
-			return true;
-		}
-		if (comment == "infill")
-		{
-			current_section_ = section_type_infill_section;
-			return true;
-		}
-		if (comment == "solid layer")
-		{
-			current_section_ = section_type_solid_infill_section;
-			return true;
-		}
-		if (comment == "skirt")
-		{
-			current_section_ = section_type_skirt_section;
-			return true;
-		}
-		if (comment == "ooze shield")
-		{
-			current_section_ = section_type_ooze_shield_section;
-			return true;
-		}
-
-		if (comment == "prime pillar")
-		{
-			current_section_ = section_type_prime_pillar_section;
-			return true;
-		}
-
-		if (comment == "gap fill")
-		{
-			current_section_ = section_type_gap_fill_section;
-			return true;
-		}
-	}
-	
-	
-	return false;
-}
-
-bool gcode_comment_processor::update_slic3r_pe_section(std::string &comment)
-{
-	if (comment == "CP TOOLCHANGE WIPE")
-	{
-		current_section_ = section_type_prime_pillar_section;
-		return true;
-	}
-	if (comment == "CP TOOLCHANGE END")
-	{
-		current_section_ = section_type_no_section;
-		return true;
-	}
-	return false;
 }
-
@@ -40,6 +40,9 @@ enum section_type
 	section_type_prime_pillar_section
 };
 
+struct comment_marker;
+struct comment_marker_slicer_action;
+
 class gcode_comment_processor
 {
 	
@@ -50,20 +53,28 @@ public:
 	void update(position& pos);
 	void update(std::string & comment);
 	comment_process_type get_comment_process_type();
+	/**
+	 * \brief Restores the detected slicer type, for example when replaying a position trace.
+	 */
+	void set_comment_process_type(comment_process_type type);
+	section_type get_current_section() const;
+	/**
+	 * \brief Restores the section that the comments are in, for example when resuming from a position checkpoint.
+	 */
+	void set_current_section(section_type section);
+	/**
+	 * \brief If true, a slicer header comment (for example 'Generated with Cura_SteamEngine') sets the slicer type
+	 * while it is still unknown, so that the comments are never matched against the other slicers.
+	 */
+	void set_lock_slicer_from_header(bool lock_slicer_from_header);
 
 private:
 	section_type current_section_;
 	comment_process_type processing_type_;
+	bool lock_slicer_from_header_;
 	void update_feature_from_section(position& pos) const;
-	bool update_feature_from_section_from_section(position& pos) const;
-	bool update_feature_from_section_for_cura(position& pos) const;
-	bool update_feature_from_section_for_simplify_3d(position& pos) const;
-	bool update_feature_from_section_for_slice3r_pe(position& pos) const;
-	void update_feature_for_unknown_slicer_comment(position& pos, std::string &comment);
 	bool update_feature_for_slic3r_pe_comment(position& pos, std::string &comment) const;
-	void update_unknown_section(std::string & comment);
-	bool update_cura_section(std::string &comment);
-	bool update_simplify_3d_section(std::string &comment);
-	bool update_slic3r_pe_section(std::string &comment);
+	void update_unknown_section(const comment_marker& marker);
+	bool update_section(const comment_marker_slicer_action& slicer_action);
 };
 
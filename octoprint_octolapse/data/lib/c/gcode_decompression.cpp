@@ -0,0 +1,956 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "gcode_decompression.h"
+#include <cstring>
+#include <exception>
+
+#pragma region Checksums
+namespace
+{
+	struct crc32_table
+	{
+		crc32_table()
+		{
+			for (unsigned int index = 0; index < 256; index++)
+			{
+				unsigned int value = index;
+				for (int bit = 0; bit < 8; bit++)
+					value = (value & 1) != 0 ? 0xEDB88320U ^ (value >> 1) : value >> 1;
+				values[index] = value;
+			}
+		}
+		unsigned int values[256];
+	};
+}
+
+unsigned int gcode_crc32(unsigned int crc, const unsigned char* p_data, const size_t length)
+{
+	static const crc32_table table;
+	crc = ~crc;
+	for (size_t index = 0; index < length; index++)
+		crc = table.values[(crc ^ p_data[index]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+unsigned int gcode_adler32(const unsigned int adler, const unsigned char* p_data, size_t length)
+{
+	// 5552 is the most bytes that can be summed before the sums could overflow
+	const unsigned int base = 65521;
+	unsigned int a = adler & 0xFFFF;
+	unsigned int b = adler >> 16;
+	while (length > 0)
+	{
+		const size_t block_length = length < 5552 ? length : 5552;
+		for (size_t index = 0; index < block_length; index++)
+		{
+			a += p_data[index];
+			b += a;
+		}
+		a %= base;
+		b %= base;
+		p_data += block_length;
+		length -= block_length;
+	}
+	return (b << 16) | a;
+}
+#pragma endregion Checksums
+
+#pragma region Byte Reader
+gcode_byte_reader::gcode_byte_reader()
+{
+	p_file_ = NULL;
+	start_ = 0;
+	end_ = 0;
+	file_end_ = 0;
+	buffer_position_ = 0;
+	limit_position_ = -1;
+	is_checksum_active_ = false;
+	checksum_start_ = 0;
+	checksum_ = 0;
+}
+
+gcode_byte_reader::gcode_byte_reader(const gcode_byte_reader &source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+void gcode_byte_reader::open(FILE* p_file)
+{
+	p_file_ = p_file;
+	buffer_.resize(GCODE_BYTE_READER_BUFFER_SIZE);
+	start_ = 0;
+	end_ = 0;
+	file_end_ = 0;
+	buffer_position_ = 0;
+	limit_position_ = -1;
+	is_checksum_active_ = false;
+	checksum_start_ = 0;
+	checksum_ = 0;
+}
+
+bool gcode_byte_reader::rewind()
+{
+	if (p_file_ == NULL || fseek(p_file_, 0, SEEK_SET) != 0)
+		return false;
+	open(p_file_);
+	return true;
+}
+
+bool gcode_byte_reader::try_fill()
+{
+	if (p_file_ == NULL || end_ < file_end_)
+		return false; // the limit was reached
+	if (limit_position_ >= 0 && buffer_position_ + static_cast<long>(start_) >= limit_position_)
+		return false;
+	update_checksum();
+	buffer_position_ += static_cast<long>(file_end_);
+	start_ = 0;
+	checksum_start_ = 0;
+	file_end_ = fread(&buffer_[0], 1, buffer_.size(), p_file_);
+	end_ = file_end_;
+	if (limit_position_ >= 0 && buffer_position_ + static_cast<long>(end_) > limit_position_)
+		end_ = static_cast<size_t>(limit_position_ - buffer_position_);
+	return end_ > 0;
+}
+
+size_t gcode_byte_reader::read(unsigned char* p_buffer, const size_t length)
+{
+	size_t bytes_read = 0;
+	while (bytes_read < length)
+	{
+		if (start_ == end_ && !try_fill())
+			break;
+		size_t count = end_ - start_;
+		if (count > length - bytes_read)
+			count = length - bytes_read;
+		memcpy(p_buffer + bytes_read, &buffer_[0] + start_, count);
+		start_ += count;
+		bytes_read += count;
+	}
+	return bytes_read;
+}
+
+bool gcode_byte_reader::skip(long length)
+{
+	while (length > 0)
+	{
+		if (start_ == end_ && !try_fill())
+			return false;
+		size_t count = end_ - start_;
+		if (static_cast<long>(count) > length)
+			count = static_cast<size_t>(length);
+		start_ += count;
+		length -= static_cast<long>(count);
+	}
+	return true;
+}
+
+long gcode_byte_reader::get_position() const
+{
+	return buffer_position_ + static_cast<long>(start_);
+}
+
+void gcode_byte_reader::set_limit(const long length)
+{
+	end_ = file_end_;
+	if (length < 0)
+	{
+		limit_position_ = -1;
+		return;
+	}
+	limit_position_ = get_position() + length;
+	if (buffer_position_ + static_cast<long>(end_) > limit_position_)
+		end_ = static_cast<size_t>(limit_position_ - buffer_position_);
+}
+
+long gcode_byte_reader::get_remaining_limit() const
+{
+	if (limit_position_ < 0)
+		return -1;
+	return limit_position_ - get_position();
+}
+
+void gcode_byte_reader::update_checksum()
+{
+	if (is_checksum_active_ && start_ > checksum_start_)
+		checksum_ = gcode_crc32(checksum_, &buffer_[0] + checksum_start_, start_ - checksum_start_);
+	checksum_start_ = start_;
+}
+
+void gcode_byte_reader::begin_checksum()
+{
+	is_checksum_active_ = true;
+	checksum_ = 0;
+	checksum_start_ = start_;
+}
+
+unsigned int gcode_byte_reader::end_checksum()
+{
+	update_checksum();
+	is_checksum_active_ = false;
+	return checksum_;
+}
+#pragma endregion Byte Reader
+
+#pragma region Inflate
+namespace
+{
+	const unsigned short length_base[29] = {
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	const unsigned char length_extra_bits[29] = {
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	const unsigned short distance_base[30] = {
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+		6145, 8193, 12289, 16385, 24577
+	};
+	const unsigned char distance_extra_bits[30] = {
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+	// The order that the code length code lengths are stored in
+	const unsigned char code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+}
+
+inflate_decoder::inflate_decoder()
+{
+	p_reader_ = NULL;
+	window_.resize(INFLATE_WINDOW_SIZE);
+	unsigned char lengths[288];
+	for (int symbol = 0; symbol < 144; symbol++)
+		lengths[symbol] = 8;
+	for (int symbol = 144; symbol < 256; symbol++)
+		lengths[symbol] = 9;
+	for (int symbol = 256; symbol < 280; symbol++)
+		lengths[symbol] = 7;
+	for (int symbol = 280; symbol < 288; symbol++)
+		lengths[symbol] = 8;
+	build_table(fixed_length_table_, lengths, 288);
+	for (int symbol = 0; symbol < 30; symbol++)
+		lengths[symbol] = 5;
+	build_table(fixed_distance_table_, lengths, 30);
+	reset(NULL);
+}
+
+inflate_decoder::inflate_decoder(const inflate_decoder &source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+void inflate_decoder::reset(gcode_byte_reader* p_reader)
+{
+	p_reader_ = p_reader;
+	bit_buffer_ = 0;
+	bit_count_ = 0;
+	padding_bits_ = 0;
+	restart();
+}
+
+void inflate_decoder::restart()
+{
+	state_ = inflate_state_block_header;
+	is_final_block_ = false;
+	stored_remaining_ = 0;
+	match_remaining_ = 0;
+	match_distance_ = 0;
+	window_position_ = 0;
+	window_filled_ = 0;
+	p_length_table_ = NULL;
+	p_distance_table_ = NULL;
+	p_error_ = NULL;
+}
+
+bool inflate_decoder::is_finished() const
+{
+	return state_ == inflate_state_finished;
+}
+
+bool inflate_decoder::has_error() const
+{
+	return state_ == inflate_state_error;
+}
+
+const char* inflate_decoder::get_error() const
+{
+	return p_error_ == NULL ? "" : p_error_;
+}
+
+void inflate_decoder::set_error(const char* p_error)
+{
+	p_error_ = p_error;
+	state_ = inflate_state_error;
+}
+
+inline void inflate_decoder::need_bits(const int bits)
+{
+	while (bit_count_ < bits)
+	{
+		int value = p_reader_->read_byte();
+		if (value < 0)
+		{
+			// Pad with zeros so that the table lookups still work at the end of the file, is_truncated catches any
+			// padding that is actually used.
+			value = 0;
+			padding_bits_ += 8;
+		}
+		bit_buffer_ |= static_cast<unsigned long long>(value) << bit_count_;
+		bit_count_ += 8;
+	}
+}
+
+inline unsigned int inflate_decoder::get_bits(const int bits)
+{
+	need_bits(bits);
+	const unsigned int value = static_cast<unsigned int>(bit_buffer_ & ((1ULL << bits) - 1));
+	bit_buffer_ >>= bits;
+	bit_count_ -= bits;
+	return value;
+}
+
+bool inflate_decoder::is_truncated() const
+{
+	// The padding is at the top of the bit buffer, so it has been used once it is larger than what is left.
+	return padding_bits_ > bit_count_;
+}
+
+inline int inflate_decoder::decode_symbol(const inflate_huffman_table& table)
+{
+	need_bits(15);
+	const unsigned int entry = table.fast[bit_buffer_ & ((1U << INFLATE_FAST_BITS) - 1)];
+	if (entry != 0)
+	{
+		const int length = static_cast<int>(entry & 15);
+		bit_buffer_ >>= length;
+		bit_count_ -= length;
+		return static_cast<int>(entry >> 4);
+	}
+	return decode_symbol_slow(table);
+}
+
+int inflate_decoder::decode_symbol_slow(const inflate_huffman_table& table)
+{
+	// Canonical decoding one bit at a time, the bit buffer already holds at least 15 bits.
+	int code = 0;
+	int first = 0;
+	int index = 0;
+	for (int length = 1; length < 16; length++)
+	{
+		code |= static_cast<int>((bit_buffer_ >> (length - 1)) & 1);
+		const int count = table.count[length];
+		if (code - count < first)
+		{
+			bit_buffer_ >>= length;
+			bit_count_ -= length;
+			return table.symbol[index + (code - first)];
+		}
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+bool inflate_decoder::build_table(inflate_huffman_table& table, const unsigned char* p_lengths, const int num_symbols)
+{
+	memset(table.count, 0, sizeof(table.count));
+	memset(table.fast, 0, sizeof(table.fast));
+	for (int symbol = 0; symbol < num_symbols; symbol++)
+		table.count[p_lengths[symbol]]++;
+	table.count[0] = 0;
+	// Make sure the lengths describe a prefix code.  Incomplete codes are allowed, the missing codes are errors.
+	int left = 1;
+	for (int length = 1; length < 16; length++)
+	{
+		left <<= 1;
+		left -= table.count[length];
+		if (left < 0)
+			return false;
+	}
+	short offsets[16];
+	offsets[1] = 0;
+	for (int length = 1; length < 15; length++)
+		offsets[length + 1] = static_cast<short>(offsets[length] + table.count[length]);
+	for (int symbol = 0; symbol < num_symbols; symbol++)
+	{
+		if (p_lengths[symbol] != 0)
+			table.symbol[offsets[p_lengths[symbol]]++] = static_cast<short>(symbol);
+	}
+	// Fill the lookup table.  Deflate sends the code bits starting with the most significant one, so the index is the
+	// reversed code.
+	unsigned int next_code[16];
+	unsigned int code = 0;
+	next_code[0] = 0;
+	for (int length = 1; length < 16; length++)
+	{
+		code = (code + static_cast<unsigned int>(table.count[length - 1])) << 1;
+		next_code[length] = code;
+	}
+	for (int symbol = 0; symbol < num_symbols; symbol++)
+	{
+		const int length = p_lengths[symbol];
+		if (length == 0)
+			continue;
+		const unsigned int symbol_code = next_code[length]++;
+		if (length > INFLATE_FAST_BITS)
+			continue;
+		unsigned int reversed = 0;
+		for (int bit = 0; bit < length; bit++)
+			reversed |= ((symbol_code >> bit) & 1) << (length - 1 - bit);
+		const unsigned short entry = static_cast<unsigned short>((symbol << 4) | length);
+		for (unsigned int index = reversed; index < (1U << INFLATE_FAST_BITS); index += 1U << length)
+			table.fast[index] = entry;
+	}
+	return true;
+}
+
+bool inflate_decoder::read_block_header()
+{
+	is_final_block_ = get_bits(1) != 0;
+	const unsigned int block_type = get_bits(2);
+	switch (block_type)
+	{
+	case 0:
+	{
+		// Stored blocks start at a byte boundary
+		const int extra_bits = bit_count_ & 7;
+		bit_buffer_ >>= extra_bits;
+		bit_count_ -= extra_bits;
+		const unsigned int length = get_bits(16);
+		const unsigned int complement = get_bits(16);
+		if (is_truncated())
+		{
+			set_error("The deflate stream is truncated.");
+			return false;
+		}
+		if ((length ^ 0xFFFF) != complement)
+		{
+			set_error("The deflate stream has an invalid stored block length.");
+			return false;
+		}
+		stored_remaining_ = length;
+		state_ = inflate_state_stored;
+		return true;
+	}
+	case 1:
+		p_length_table_ = &fixed_length_table_;
+		p_distance_table_ = &fixed_distance_table_;
+		state_ = inflate_state_huffman;
+		return true;
+	case 2:
+		if (!read_dynamic_tables())
+			return false;
+		p_length_table_ = &dynamic_length_table_;
+		p_distance_table_ = &dynamic_distance_table_;
+		state_ = inflate_state_huffman;
+		return true;
+	default:
+		set_error("The deflate stream has an invalid block type.");
+		return false;
+	}
+}
+
+bool inflate_decoder::read_dynamic_tables()
+{
+	const int num_lengths = static_cast<int>(get_bits(5)) + 257;
+	const int num_distances = static_cast<int>(get_bits(5)) + 1;
+	const int num_code_lengths = static_cast<int>(get_bits(4)) + 4;
+	if (num_lengths > 286 || num_distances > 30)
+	{
+		set_error("The deflate stream has too many length or distance codes.");
+		return false;
+	}
+	unsigned char lengths[320];
+	memset(lengths, 0, sizeof(lengths));
+	for (int index = 0; index < num_code_lengths; index++)
+		lengths[code_length_order[index]] = static_cast<unsigned char>(get_bits(3));
+	// The code length table is built into the distance table, which isn't needed yet
+	if (!build_table(dynamic_distance_table_, lengths, 19))
+	{
+		set_error("The deflate stream has an invalid code length code.");
+		return false;
+	}
+	const int num_symbols = num_lengths + num_distances;
+	int index = 0;
+	while (index < num_symbols)
+	{
+		const int symbol = decode_symbol(dynamic_distance_table_);
+		if (symbol < 0 || is_truncated())
+		{
+			set_error("The deflate stream has an invalid code length.");
+			return false;
+		}
+		if (symbol < 16)
+		{
+			lengths[index++] = static_cast<unsigned char>(symbol);
+			continue;
+		}
+		unsigned char length = 0;
+		int repeat;
+		if (symbol == 16)
+		{
+			if (index == 0)
+			{
+				set_error("The deflate stream repeats a code length that doesn't exist.");
+				return false;
+			}
+			length = lengths[index - 1];
+			repeat = 3 + static_cast<int>(get_bits(2));
+		}
+		else if (symbol == 17)
+			repeat = 3 + static_cast<int>(get_bits(3));
+		else
+			repeat = 11 + static_cast<int>(get_bits(7));
+		if (index + repeat > num_symbols)
+		{
+			set_error("The deflate stream has too many code lengths.");
+			return false;
+		}
+		while (repeat-- > 0)
+			lengths[index++] = length;
+	}
+	if (lengths[256] == 0)
+	{
+		set_error("The deflate stream has no end of block code.");
+		return false;
+	}
+	if (!build_table(dynamic_length_table_, lengths, num_lengths) || !build_table(dynamic_distance_table_, lengths + num_lengths, num_distances))
+	{
+		set_error("The deflate stream has an invalid huffman code.");
+		return false;
+	}
+	return true;
+}
+
+size_t inflate_decoder::read(char* p_buffer, const size_t size)
+{
+	size_t produced = 0;
+	while (produced < size)
+	{
+		switch (state_)
+		{
+		case inflate_state_block_header:
+			if (is_final_block_)
+			{
+				state_ = inflate_state_finished;
+				break;
+			}
+			read_block_header();
+			break;
+		case inflate_state_stored:
+			produced += read_stored(p_buffer + produced, size - produced);
+			break;
+		case inflate_state_huffman:
+			produced += read_huffman(p_buffer + produced, size - produced);
+			break;
+		case inflate_state_finished:
+		case inflate_state_error:
+			return produced;
+		}
+	}
+	return produced;
+}
+
+size_t inflate_decoder::read_stored(char* p_buffer, const size_t size)
+{
+	size_t count = stored_remaining_ < size ? stored_remaining_ : size;
+	size_t produced = 0;
+	// Use up any whole bytes that are still in the bit buffer first
+	while (produced < count && bit_count_ - padding_bits_ >= 8)
+	{
+		p_buffer[produced++] = static_cast<char>(bit_buffer_ & 0xFF);
+		bit_buffer_ >>= 8;
+		bit_count_ -= 8;
+	}
+	if (produced < count && padding_bits_ == 0)
+		produced += p_reader_->read(reinterpret_cast<unsigned char*>(p_buffer) + produced, count - produced);
+	if (produced < count)
+	{
+		set_error("The deflate stream is truncated.");
+		count = produced;
+	}
+	// Keep the history for the matches in the blocks that follow
+	const unsigned char* p_data = reinterpret_cast<const unsigned char*>(p_buffer);
+	size_t start = count > INFLATE_WINDOW_SIZE ? count - INFLATE_WINDOW_SIZE : 0;
+	for (size_t index = start; index < count; index++)
+	{
+		window_[window_position_] = p_data[index];
+		window_position_ = (window_position_ + 1) & (INFLATE_WINDOW_SIZE - 1);
+	}
+	window_filled_ = window_filled_ + static_cast<unsigned int>(count) > INFLATE_WINDOW_SIZE ? INFLATE_WINDOW_SIZE : window_filled_ + static_cast<unsigned int>(count);
+	stored_remaining_ -= static_cast<unsigned int>(count);
+	if (stored_remaining_ == 0 && state_ == inflate_state_stored)
+		state_ = inflate_state_block_header;
+	return count;
+}
+
+size_t inflate_decoder::read_huffman(char* p_buffer, const size_t size)
+{
+	const unsigned int window_mask = INFLATE_WINDOW_SIZE - 1;
+	unsigned char* p_window = &window_[0];
+	size_t produced = 0;
+	while (produced < size)
+	{
+		if (match_remaining_ > 0)
+		{
+			// Copy as much of the pending match as fits
+			unsigned int count = match_remaining_;
+			if (count > size - produced)
+				count = static_cast<unsigned int>(size - produced);
+			unsigned int source = (window_position_ - match_distance_) & window_mask;
+			for (unsigned int index = 0; index < count; index++)
+			{
+				const unsigned char c = p_window[source];
+				p_window[window_position_] = c;
+				p_buffer[produced++] = static_cast<char>(c);
+				source = (source + 1) & window_mask;
+				window_position_ = (window_position_ + 1) & window_mask;
+			}
+			match_remaining_ -= count;
+			continue;
+		}
+		int symbol = decode_symbol(*p_length_table_);
+		if (symbol < 256)
+		{
+			if (symbol < 0)
+			{
+				set_error("The deflate stream has an invalid literal or length code.");
+				break;
+			}
+			p_window[window_position_] = static_cast<unsigned char>(symbol);
+			window_position_ = (window_position_ + 1) & window_mask;
+			p_buffer[produced++] = static_cast<char>(symbol);
+			if (window_filled_ < INFLATE_WINDOW_SIZE)
+				window_filled_++;
+			continue;
+		}
+		if (symbol == 256)
+		{
+			state_ = inflate_state_block_header;
+			break;
+		}
+		symbol -= 257;
+		if (symbol >= 29)
+		{
+			set_error("The deflate stream has an invalid length code.");
+			break;
+		}
+		const unsigned int length = length_base[symbol] + get_bits(length_extra_bits[symbol]);
+		symbol = decode_symbol(*p_distance_table_);
+		if (symbol < 0 || symbol >= 30)
+		{
+			set_error("The deflate stream has an invalid distance code.");
+			break;
+		}
+		const unsigned int distance = distance_base[symbol] + get_bits(distance_extra_bits[symbol]);
+		if (distance > window_filled_)
+		{
+			set_error("The deflate stream refers to data before its start.");
+			break;
+		}
+		match_remaining_ = length;
+		match_distance_ = distance;
+		window_filled_ = window_filled_ + length > INFLATE_WINDOW_SIZE ? INFLATE_WINDOW_SIZE : window_filled_ + length;
+	}
+	if (padding_bits_ != 0 && is_truncated())
+	{
+		set_error("The deflate stream is truncated.");
+		return 0;
+	}
+	return produced;
+}
+
+int inflate_decoder::read_aligned_byte()
+{
+	const int extra_bits = bit_count_ & 7;
+	bit_buffer_ >>= extra_bits;
+	bit_count_ -= extra_bits;
+	if (bit_count_ >= 8)
+	{
+		const int value = static_cast<int>(bit_buffer_ & 0xFF);
+		bit_buffer_ >>= 8;
+		bit_count_ -= 8;
+		if (is_truncated())
+			return -1;
+		return value;
+	}
+	if (padding_bits_ != 0)
+		return -1;
+	return p_reader_->read_byte();
+}
+#pragma endregion Inflate
+
+#pragma region Heatshrink
+heatshrink_decoder::heatshrink_decoder()
+{
+	reset(NULL, 11, 4);
+}
+
+heatshrink_decoder::heatshrink_decoder(const heatshrink_decoder &source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+void heatshrink_decoder::reset(gcode_byte_reader* p_reader, const int window_bits, const int lookahead_bits)
+{
+	p_reader_ = p_reader;
+	bit_buffer_ = 0;
+	bit_count_ = 0;
+	window_bits_ = window_bits;
+	lookahead_bits_ = lookahead_bits;
+	// The window starts out as zeros, like the reference decoder
+	window_.assign(static_cast<size_t>(1) << window_bits, 0);
+	window_mask_ = (1U << window_bits) - 1;
+	head_ = 0;
+	match_remaining_ = 0;
+	match_offset_ = 0;
+	is_finished_ = false;
+}
+
+inline int heatshrink_decoder::get_bits(const int bits)
+{
+	// The bits are sent starting with the most significant one
+	while (bit_count_ < bits)
+	{
+		const int value = p_reader_->read_byte();
+		if (value < 0)
+			return -1;
+		bit_buffer_ = (bit_buffer_ << 8) | static_cast<unsigned int>(value);
+		bit_count_ += 8;
+	}
+	bit_count_ -= bits;
+	return static_cast<int>((bit_buffer_ >> bit_count_) & ((1U << bits) - 1));
+}
+
+size_t heatshrink_decoder::read(char* p_buffer, const size_t size)
+{
+	unsigned char* p_window = &window_[0];
+	size_t produced = 0;
+	while (produced < size)
+	{
+		if (match_remaining_ > 0)
+		{
+			const unsigned char c = p_window[(head_ - match_offset_) & window_mask_];
+			p_window[head_ & window_mask_] = c;
+			head_++;
+			p_buffer[produced++] = static_cast<char>(c);
+			match_remaining_--;
+			continue;
+		}
+		if (is_finished_)
+			break;
+		// The end of the input may be padded with up to 7 bits, which never form a complete symbol.
+		const int tag = get_bits(1);
+		if (tag < 0)
+		{
+			is_finished_ = true;
+			break;
+		}
+		if (tag != 0)
+		{
+			const int c = get_bits(8);
+			if (c < 0)
+			{
+				is_finished_ = true;
+				break;
+			}
+			p_window[head_ & window_mask_] = static_cast<unsigned char>(c);
+			head_++;
+			p_buffer[produced++] = static_cast<char>(c);
+			continue;
+		}
+		const int index = get_bits(window_bits_);
+		const int count = index < 0 ? -1 : get_bits(lookahead_bits_);
+		if (count < 0)
+		{
+			is_finished_ = true;
+			break;
+		}
+		match_offset_ = static_cast<unsigned int>(index) + 1;
+		match_remaining_ = static_cast<unsigned int>(count) + 1;
+	}
+	return produced;
+}
+#pragma endregion Heatshrink
+
+#pragma region MeatPack
+namespace
+{
+	const unsigned char meatpack_signal_byte = 0xFF;
+	const unsigned char meatpack_command_enable_packing = 251;
+	const unsigned char meatpack_command_disable_packing = 250;
+	const unsigned char meatpack_command_reset_all = 249;
+	const unsigned char meatpack_command_enable_no_spaces = 247;
+	const unsigned char meatpack_command_disable_no_spaces = 246;
+	// The 4 bit codes, 15 means the character is sent in full.  In the 'no spaces' mode the space becomes an 'E'.
+	const char meatpack_characters[15] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '.', ' ', '\n', 'G', 'X' };
+	const unsigned char meatpack_full_char = 15;
+
+	inline bool is_g_parameter(const char c)
+	{
+		switch (c)
+		{
+		case 'X': case 'Y': case 'Z': case 'E': case 'F': case 'I': case 'J': case 'R': case 'P': case 'W': case 'H':
+		case 'C': case 'A':
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+meatpack_decoder::meatpack_decoder()
+{
+	reset();
+}
+
+void meatpack_decoder::reset()
+{
+	is_signal_next_ = false;
+	is_command_next_ = false;
+	is_packing_ = false;
+	is_no_spaces_ = false;
+	full_char_count_ = 0;
+	char_buffer_ = 0;
+	is_line_start_ = true;
+	is_g_line_ = false;
+	is_comment_ = false;
+	last_char_ = '\n';
+}
+
+void meatpack_decoder::decode(const unsigned char* p_data, const size_t length, std::string& output)
+{
+	for (size_t index = 0; index < length; index++)
+	{
+		const unsigned char c = p_data[index];
+		// Two signal bytes start a command
+		if (c == meatpack_signal_byte)
+		{
+			if (is_signal_next_)
+			{
+				is_signal_next_ = false;
+				is_command_next_ = true;
+			}
+			else
+				is_signal_next_ = true;
+			continue;
+		}
+		if (is_command_next_)
+		{
+			is_command_next_ = false;
+			switch (c)
+			{
+			case meatpack_command_enable_packing:
+				is_packing_ = true;
+				break;
+			case meatpack_command_disable_packing:
+				is_packing_ = false;
+				break;
+			case meatpack_command_reset_all:
+				is_packing_ = false;
+				is_no_spaces_ = false;
+				break;
+			case meatpack_command_enable_no_spaces:
+				is_no_spaces_ = true;
+				break;
+			case meatpack_command_disable_no_spaces:
+				is_no_spaces_ = false;
+				break;
+			default:
+				break;
+			}
+			continue;
+		}
+		if (is_signal_next_)
+		{
+			// A single signal byte is data
+			is_signal_next_ = false;
+			decode_byte(meatpack_signal_byte, output);
+		}
+		decode_byte(c, output);
+	}
+}
+
+void meatpack_decoder::decode_byte(const unsigned char c, std::string& output)
+{
+	if (!is_packing_)
+	{
+		output_char(static_cast<char>(c), output);
+		return;
+	}
+	if (full_char_count_ > 0)
+	{
+		output_char(static_cast<char>(c), output);
+		if (char_buffer_ != 0)
+		{
+			output_char(char_buffer_, output);
+			char_buffer_ = 0;
+		}
+		full_char_count_--;
+		return;
+	}
+	// The first character is in the low nibble
+	const unsigned char first = c & 0x0F;
+	const unsigned char second = (c >> 4) & 0x0F;
+	const char space = is_no_spaces_ ? 'E' : ' ';
+	const char first_char = first == 11 ? space : meatpack_characters[first < meatpack_full_char ? first : 0];
+	const char second_char = second == 11 ? space : meatpack_characters[second < meatpack_full_char ? second : 0];
+	if (first == meatpack_full_char)
+	{
+		full_char_count_++;
+		if (second == meatpack_full_char)
+			full_char_count_++;
+		else
+			char_buffer_ = second_char;
+		return;
+	}
+	output_char(first_char, output);
+	// The second nibble of a newline is padding
+	if (first_char == '\n')
+		return;
+	if (second == meatpack_full_char)
+		full_char_count_++;
+	else
+		output_char(second_char, output);
+}
+
+void meatpack_decoder::output_char(const char c, std::string& output)
+{
+	if (is_line_start_)
+	{
+		is_g_line_ = c == 'G';
+		is_comment_ = false;
+		is_line_start_ = false;
+	}
+	if (c == ';')
+		is_comment_ = true;
+	else if (is_no_spaces_ && is_g_line_ && !is_comment_ && last_char_ != ' ' && is_g_parameter(c))
+		output.push_back(' ');
+	output.push_back(c);
+	last_char_ = c;
+	if (c == '\n')
+		is_line_start_ = true;
+}
+#pragma endregion MeatPack
@@ -0,0 +1,253 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GCODE_DECOMPRESSION_H
+#define GCODE_DECOMPRESSION_H
+#define _CRT_SECURE_NO_DEPRECATE
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+
+// The size of the buffer used to read compressed files.
+#define GCODE_BYTE_READER_BUFFER_SIZE 65536
+// The number of code bits resolved with a single table lookup when decoding huffman codes.
+#define INFLATE_FAST_BITS 10
+// The size of the deflate history window.
+#define INFLATE_WINDOW_SIZE 32768
+
+/**
+ * \brief Updates a CRC-32 (the gzip and binary gcode checksum) with the given bytes.  Start with a crc of 0.
+ */
+unsigned int gcode_crc32(unsigned int crc, const unsigned char* p_data, size_t length);
+/**
+ * \brief Updates an Adler-32 (the zlib checksum) with the given bytes.  Start with an adler of 1.
+ */
+unsigned int gcode_adler32(unsigned int adler, const unsigned char* p_data, size_t length);
+
+/**
+ * \brief Reads the bytes of a file through a fixed size buffer, counting the bytes that have been consumed.  A limit
+ * can be set so that a decoder cannot read past the end of the data it was given, and a CRC-32 can be calculated over
+ * the consumed bytes.  The file is not owned by the reader.
+ */
+class gcode_byte_reader
+{
+public:
+	gcode_byte_reader();
+	void open(FILE* p_file);
+	/**
+	 * \brief Starts reading from the beginning of the file again.
+	 */
+	bool rewind();
+	/**
+	 * \brief Reads the next byte.
+	 * \return The byte, or -1 at the end of the file or the limit.
+	 */
+	inline int read_byte()
+	{
+		if (start_ == end_ && !try_fill())
+			return -1;
+		return buffer_[start_++];
+	}
+	/**
+	 * \brief Reads up to length bytes.
+	 * \return The number of bytes read, which is only less than length at the end of the file or the limit.
+	 */
+	size_t read(unsigned char* p_buffer, size_t length);
+	/**
+	 * \brief Skips the next length bytes.
+	 * \return false if the end of the file or the limit was reached first.
+	 */
+	bool skip(long length);
+	/**
+	 * \brief The number of bytes that have been consumed from the start of the file.
+	 */
+	long get_position() const;
+	/**
+	 * \brief Stops reading at the given number of bytes after the current position.  A length of -1 removes the limit.
+	 */
+	void set_limit(long length);
+	long get_remaining_limit() const;
+	/**
+	 * \brief Starts calculating a CRC-32 over the bytes that are consumed from now on.
+	 */
+	void begin_checksum();
+	/**
+	 * \brief Stops calculating the CRC-32 and returns it.
+	 */
+	unsigned int end_checksum();
+private:
+	gcode_byte_reader(const gcode_byte_reader &source); // don't copy me!
+	bool try_fill();
+	void update_checksum();
+	FILE* p_file_;
+	std::vector<unsigned char> buffer_;
+	// The next unread byte, the end of the bytes that may be read and the end of the bytes read from the file
+	size_t start_;
+	size_t end_;
+	size_t file_end_;
+	// The file position of the first byte in the buffer
+	long buffer_position_;
+	// The absolute file position where reading stops, or -1
+	long limit_position_;
+	bool is_checksum_active_;
+	size_t checksum_start_;
+	unsigned int checksum_;
+};
+
+struct inflate_huffman_table
+{
+	// The number of codes of each length, and the symbols ordered by code
+	short count[16];
+	short symbol[288];
+	// (symbol << 4) | length for every code that fits into INFLATE_FAST_BITS, indexed by the (reversed) code bits.
+	// 0 means the code is longer and must be decoded bit by bit.
+	unsigned short fast[1 << INFLATE_FAST_BITS];
+};
+
+/**
+ * \brief Decodes a raw deflate stream (RFC 1951) that is read from a gcode_byte_reader.  Decoding stops whenever the
+ * output buffer is full and continues with the next call, so the memory used does not depend on the size of the
+ * stream.  Only the 32KB history window is kept.
+ */
+class inflate_decoder
+{
+public:
+	inflate_decoder();
+	/**
+	 * \brief Starts decoding a new stream from the reader, discarding any buffered bits.
+	 */
+	void reset(gcode_byte_reader* p_reader);
+	/**
+	 * \brief Starts decoding another stream that immediately follows the current one, like the next member of a gzip
+	 * file.  Bytes that were already buffered are kept.
+	 */
+	void restart();
+	/**
+	 * \brief Decodes up to size bytes.
+	 * \return The number of bytes decoded, which is only less than size at the end of the stream or on an error.
+	 */
+	size_t read(char* p_buffer, size_t size);
+	/**
+	 * \brief Reads the next byte after the deflate data, skipping the bits that remain of the current byte.  Used for
+	 * the headers and trailers that wrap the stream.
+	 * \return The byte, or -1 at the end of the file.
+	 */
+	int read_aligned_byte();
+	bool is_finished() const;
+	bool has_error() const;
+	const char* get_error() const;
+private:
+	inflate_decoder(const inflate_decoder &source); // don't copy me!
+	enum inflate_state { inflate_state_block_header, inflate_state_stored, inflate_state_huffman, inflate_state_finished, inflate_state_error };
+	inline void need_bits(int bits);
+	inline unsigned int get_bits(int bits);
+	inline int decode_symbol(const inflate_huffman_table& table);
+	int decode_symbol_slow(const inflate_huffman_table& table);
+	static bool build_table(inflate_huffman_table& table, const unsigned char* p_lengths, int num_symbols);
+	bool read_block_header();
+	bool read_dynamic_tables();
+	bool is_truncated() const;
+	void set_error(const char* p_error);
+	size_t read_stored(char* p_buffer, size_t size);
+	size_t read_huffman(char* p_buffer, size_t size);
+	gcode_byte_reader* p_reader_;
+	unsigned long long bit_buffer_;
+	int bit_count_;
+	// The number of zero bits that were added to the bit buffer after the end of the file
+	int padding_bits_;
+	inflate_state state_;
+	bool is_final_block_;
+	unsigned int stored_remaining_;
+	unsigned int match_remaining_;
+	unsigned int match_distance_;
+	std::vector<unsigned char> window_;
+	unsigned int window_position_;
+	// The number of bytes in the window, up to INFLATE_WINDOW_SIZE
+	unsigned int window_filled_;
+	const inflate_huffman_table* p_length_table_;
+	const inflate_huffman_table* p_distance_table_;
+	inflate_huffman_table dynamic_length_table_;
+	inflate_huffman_table dynamic_distance_table_;
+	inflate_huffman_table fixed_length_table_;
+	inflate_huffman_table fixed_distance_table_;
+	const char* p_error_;
+};
+
+/**
+ * \brief Decodes heatshrink (an LZSS variant used by binary gcode) data that is read from a gcode_byte_reader, up to the
+ * reader's limit.  Like the inflate_decoder, it stops whenever the output buffer is full.
+ */
+class heatshrink_decoder
+{
+public:
+	heatshrink_decoder();
+	void reset(gcode_byte_reader* p_reader, int window_bits, int lookahead_bits);
+	/**
+	 * \brief Decodes up to size bytes.
+	 * \return The number of bytes decoded, which is only less than size once the input has been used up.
+	 */
+	size_t read(char* p_buffer, size_t size);
+private:
+	heatshrink_decoder(const heatshrink_decoder &source); // don't copy me!
+	inline int get_bits(int bits);
+	gcode_byte_reader* p_reader_;
+	unsigned int bit_buffer_;
+	int bit_count_;
+	int window_bits_;
+	int lookahead_bits_;
+	std::vector<unsigned char> window_;
+	unsigned int window_mask_;
+	unsigned int head_;
+	unsigned int match_remaining_;
+	unsigned int match_offset_;
+	bool is_finished_;
+};
+
+/**
+ * \brief Decodes MeatPack, the packing of the common gcode characters into 4 bits that binary gcode uses for its gcode
+ * blocks.  When the 'no spaces' mode is used the spaces before the parameters of G commands are restored.
+ */
+class meatpack_decoder
+{
+public:
+	meatpack_decoder();
+	void reset();
+	/**
+	 * \brief Decodes the bytes, appending the characters to output.
+	 */
+	void decode(const unsigned char* p_data, size_t length, std::string& output);
+private:
+	void decode_byte(unsigned char c, std::string& output);
+	void output_char(char c, std::string& output);
+	bool is_signal_next_;
+	bool is_command_next_;
+	bool is_packing_;
+	bool is_no_spaces_;
+	int full_char_count_;
+	char char_buffer_;
+	// The state of the current output line, used to restore the spaces
+	bool is_line_start_;
+	bool is_g_line_;
+	bool is_comment_;
+	char last_char_;
+};
+#endif
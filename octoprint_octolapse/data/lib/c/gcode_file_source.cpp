@@ -0,0 +1,542 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "gcode_file_source.h"
+#include <cstring>
+#include <exception>
+#include <algorithm>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+gcode_file_source::gcode_file_source()
+{
+	is_open_ = false;
+	is_memory_mapped_ = false;
+	file_size_ = 0;
+	file_position_ = 0;
+	p_map_begin_ = NULL;
+	p_map_end_ = NULL;
+	p_map_cur_ = NULL;
+	p_map_reverse_cur_ = NULL;
+#ifdef _WIN32
+	file_handle_ = INVALID_HANDLE_VALUE;
+	mapping_handle_ = NULL;
+#endif
+	p_file_ = NULL;
+	buffer_start_ = 0;
+	buffer_end_ = 0;
+	is_eof_ = false;
+	reverse_buffer_end_ = 0;
+	reverse_buffer_file_position_ = 0;
+	is_reverse_started_ = false;
+	p_stream_ = NULL;
+}
+
+gcode_file_source::gcode_file_source(const gcode_file_source &source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+gcode_file_source::~gcode_file_source()
+{
+	close();
+}
+
+bool gcode_file_source::open(const std::string& file_path)
+{
+	close();
+	if (try_map_file(file_path))
+	{
+		const size_t header_length = file_size_ < 4 ? static_cast<size_t>(file_size_) : 4;
+		if (gcode_input_stream::detect_type(reinterpret_cast<const unsigned char*>(p_map_begin_), header_length) == gcode_input_type_text)
+		{
+			is_memory_mapped_ = true;
+			is_open_ = true;
+			return true;
+		}
+		// The file has to be decoded, which is done while it is read in blocks
+		unmap_file();
+		file_size_ = 0;
+	}
+
+	// We could not map the file, fall back to reading it in large blocks
+	p_file_ = fopen(file_path.c_str(), "rb");
+	if (p_file_ == NULL)
+		return false;
+
+	// Get the file size
+	if (fseek(p_file_, 0, SEEK_END) == 0)
+	{
+		const long size = ftell(p_file_);
+		if (size > 0)
+			file_size_ = size;
+	}
+	fseek(p_file_, 0, SEEK_SET);
+	unsigned char header[4];
+	const size_t header_length = fread(header, 1, sizeof(header), p_file_);
+	fseek(p_file_, 0, SEEK_SET);
+	p_stream_ = gcode_input_stream::create(gcode_input_stream::detect_type(header, header_length), p_file_);
+
+	buffer_.resize(GCODE_FILE_SOURCE_BUFFER_SIZE);
+	buffer_start_ = 0;
+	buffer_end_ = 0;
+	is_eof_ = false;
+	reverse_buffer_file_position_ = file_size_;
+	is_open_ = true;
+	return true;
+}
+
+void gcode_file_source::close()
+{
+	unmap_file();
+	if (p_stream_ != NULL)
+	{
+		delete p_stream_;
+		p_stream_ = NULL;
+	}
+	if (p_file_ != NULL)
+	{
+		fclose(p_file_);
+		p_file_ = NULL;
+	}
+	buffer_.clear();
+	buffer_start_ = 0;
+	buffer_end_ = 0;
+	is_eof_ = false;
+	reverse_buffer_.clear();
+	reverse_buffer_end_ = 0;
+	reverse_buffer_file_position_ = 0;
+	is_reverse_started_ = false;
+	is_open_ = false;
+	is_memory_mapped_ = false;
+	file_size_ = 0;
+	file_position_ = 0;
+}
+
+bool gcode_file_source::is_open() const
+{
+	return is_open_;
+}
+
+bool gcode_file_source::is_memory_mapped() const
+{
+	return is_memory_mapped_;
+}
+
+long gcode_file_source::get_file_size() const
+{
+	return file_size_;
+}
+
+long gcode_file_source::get_file_position() const
+{
+	return file_position_;
+}
+
+long gcode_file_source::get_source_position() const
+{
+	if (p_stream_ != NULL)
+		return p_stream_->get_source_position();
+	return file_position_;
+}
+
+const char* gcode_file_source::get_decoder_name() const
+{
+	if (p_stream_ != NULL)
+		return p_stream_->get_name();
+	return NULL;
+}
+
+bool gcode_file_source::has_error() const
+{
+	return p_stream_ != NULL && p_stream_->has_error();
+}
+
+std::string gcode_file_source::get_error() const
+{
+	if (p_stream_ != NULL)
+		return p_stream_->get_error();
+	return "";
+}
+
+bool gcode_file_source::seek(const long file_position)
+{
+	if (!is_open_ || file_position < 0)
+		return false;
+	if (p_stream_ != NULL)
+	{
+		// Decoded files can only be read forward
+		if (file_position < file_position_)
+		{
+			if (!p_stream_->rewind())
+				return false;
+			buffer_start_ = 0;
+			buffer_end_ = 0;
+			is_eof_ = false;
+			file_position_ = 0;
+		}
+		const char* p_line;
+		size_t length;
+		while (file_position_ < file_position)
+		{
+			if (!get_next_line(p_line, length))
+				return false;
+		}
+		return file_position_ == file_position;
+	}
+	if (file_position > file_size_)
+		return false;
+	if (is_memory_mapped_)
+	{
+		p_map_cur_ = p_map_begin_ + file_position;
+	}
+	else
+	{
+		if (fseek(p_file_, file_position, SEEK_SET) != 0)
+			return false;
+		buffer_start_ = 0;
+		buffer_end_ = 0;
+		is_eof_ = false;
+	}
+	file_position_ = file_position;
+	return true;
+}
+
+bool gcode_file_source::get_next_line(const char*& p_line, size_t& length)
+{
+	if (!is_open_)
+		return false;
+
+	if (is_memory_mapped_)
+	{
+		if (p_map_cur_ >= p_map_end_)
+			return false;
+		const size_t remaining = static_cast<size_t>(p_map_end_ - p_map_cur_);
+		const char* p_newline = static_cast<const char*>(memchr(p_map_cur_, '\n', remaining));
+		p_line = p_map_cur_;
+		if (p_newline == NULL)
+		{
+			// The last line has no terminator
+			length = remaining;
+			p_map_cur_ = p_map_end_;
+		}
+		else
+		{
+			length = static_cast<size_t>(p_newline - p_map_cur_);
+			p_map_cur_ = p_newline + 1;
+		}
+		file_position_ = static_cast<long>(p_map_cur_ - p_map_begin_);
+		return true;
+	}
+
+	// Streaming fallback
+	for (;;)
+	{
+		const size_t remaining = buffer_end_ - buffer_start_;
+		const char* p_start = &buffer_[0] + buffer_start_;
+		const char* p_newline = remaining > 0 ? static_cast<const char*>(memchr(p_start, '\n', remaining)) : NULL;
+		if (p_newline != NULL)
+		{
+			p_line = p_start;
+			length = static_cast<size_t>(p_newline - p_start);
+			buffer_start_ += length + 1;
+			file_position_ += static_cast<long>(length + 1);
+			return true;
+		}
+		if (is_eof_)
+		{
+			if (remaining == 0)
+				return false;
+			// The last line has no terminator
+			p_line = p_start;
+			length = remaining;
+			buffer_start_ = buffer_end_;
+			file_position_ += static_cast<long>(length);
+			return true;
+		}
+		if (!try_fill_buffer())
+			is_eof_ = true;
+	}
+}
+
+bool gcode_file_source::get_previous_line(const char*& p_line, size_t& length)
+{
+	if (!is_open_)
+		return false;
+
+	if (is_memory_mapped_)
+	{
+		if (!is_reverse_started_)
+		{
+			is_reverse_started_ = true;
+			p_map_reverse_cur_ = p_map_end_;
+			// Ignore the terminator of the last line
+			if (p_map_reverse_cur_ > p_map_begin_ && *(p_map_reverse_cur_ - 1) == '\n')
+				--p_map_reverse_cur_;
+		}
+		else if (p_map_reverse_cur_ <= p_map_begin_)
+			return false;
+		else
+			--p_map_reverse_cur_; // skip the newline that ended the previous line
+		const char* p_start = p_map_reverse_cur_;
+		while (p_start > p_map_begin_ && *(p_start - 1) != '\n')
+			--p_start;
+		p_line = p_start;
+		length = static_cast<size_t>(p_map_reverse_cur_ - p_start);
+		p_map_reverse_cur_ = p_start;
+		return true;
+	}
+
+	// Streaming fallback, read blocks backwards from the end of the file
+	if (!is_reverse_started_)
+	{
+		is_reverse_started_ = true;
+		if (!try_fill_reverse_buffer())
+			return false;
+		if (reverse_buffer_end_ > 0 && reverse_buffer_[reverse_buffer_end_ - 1] == '\n')
+			--reverse_buffer_end_;
+	}
+	else if (reverse_buffer_end_ == 0)
+		return false;
+	else
+		--reverse_buffer_end_; // skip the newline that ended the previous line
+	for (;;)
+	{
+		const char* p_buffer = &reverse_buffer_[0];
+		const char* p_end = p_buffer + reverse_buffer_end_;
+		const char* p_start = p_end;
+		while (p_start > p_buffer && *(p_start - 1) != '\n')
+			--p_start;
+		if (p_start > p_buffer || reverse_buffer_file_position_ == 0)
+		{
+			p_line = p_start;
+			length = static_cast<size_t>(p_end - p_start);
+			reverse_buffer_end_ = static_cast<size_t>(p_start - p_buffer);
+			return true;
+		}
+		// The line starts before the buffer, read the previous block
+		if (!try_fill_reverse_buffer())
+			return false;
+	}
+}
+
+bool gcode_file_source::try_read_stream_tail()
+{
+	// Only the tail is kept, so there is nothing before it
+	if (!reverse_buffer_.empty())
+		return false;
+	const size_t tail_size = GCODE_FILE_SOURCE_BUFFER_SIZE;
+	std::vector<char> tail(buffer_.begin() + buffer_start_, buffer_.begin() + buffer_end_);
+	long tail_end = file_position_ + static_cast<long>(buffer_end_ - buffer_start_);
+	buffer_start_ = 0;
+	buffer_end_ = 0;
+	is_eof_ = true;
+	std::vector<char> chunk(tail_size);
+	for (;;)
+	{
+		const size_t bytes_read = p_stream_->read(&chunk[0], chunk.size());
+		if (bytes_read == 0)
+			break;
+		tail.insert(tail.end(), chunk.begin(), chunk.begin() + bytes_read);
+		tail_end += static_cast<long>(bytes_read);
+		if (tail.size() > tail_size * 2)
+			tail.erase(tail.begin(), tail.end() - tail_size);
+	}
+	if (tail.size() > tail_size)
+		tail.erase(tail.begin(), tail.end() - tail_size);
+	long tail_start = tail_end - static_cast<long>(tail.size());
+	if (tail_start > 0)
+	{
+		// Start with the newline before the first complete line, so that the first line is returned too.
+		std::vector<char>::iterator it = std::find(tail.begin(), tail.end(), '\n');
+		tail_start += static_cast<long>(it - tail.begin());
+		tail.erase(tail.begin(), it);
+	}
+	file_position_ = tail_end;
+	reverse_buffer_.swap(tail);
+	reverse_buffer_end_ = reverse_buffer_.size();
+	reverse_buffer_file_position_ = tail_start;
+	return !reverse_buffer_.empty();
+}
+
+bool gcode_file_source::try_fill_reverse_buffer()
+{
+	if (p_stream_ != NULL)
+		return try_read_stream_tail();
+	if (reverse_buffer_file_position_ <= 0)
+		return false;
+	const long block_size = reverse_buffer_file_position_ < GCODE_FILE_SOURCE_BUFFER_SIZE
+		? reverse_buffer_file_position_
+		: GCODE_FILE_SOURCE_BUFFER_SIZE;
+	const long block_start = reverse_buffer_file_position_ - block_size;
+	// Keep the unread bytes, which belong after the new block
+	std::vector<char> buffer(static_cast<size_t>(block_size) + reverse_buffer_end_);
+	if (reverse_buffer_end_ > 0)
+		memcpy(&buffer[0] + block_size, &reverse_buffer_[0], reverse_buffer_end_);
+	if (fseek(p_file_, block_start, SEEK_SET) != 0
+		|| fread(&buffer[0], 1, static_cast<size_t>(block_size), p_file_) != static_cast<size_t>(block_size))
+	{
+		// put the forward read position back
+		fseek(p_file_, file_position_ + static_cast<long>(buffer_end_ - buffer_start_), SEEK_SET);
+		return false;
+	}
+	// put the forward read position back
+	fseek(p_file_, file_position_ + static_cast<long>(buffer_end_ - buffer_start_), SEEK_SET);
+	reverse_buffer_.swap(buffer);
+	reverse_buffer_end_ = reverse_buffer_.size();
+	reverse_buffer_file_position_ = block_start;
+	return true;
+}
+
+bool gcode_file_source::try_fill_buffer()
+{
+	// Move any partial line to the front of the buffer
+	const size_t remaining = buffer_end_ - buffer_start_;
+	if (remaining > 0 && buffer_start_ > 0)
+		memmove(&buffer_[0], &buffer_[0] + buffer_start_, remaining);
+	buffer_start_ = 0;
+	buffer_end_ = remaining;
+	// If a single line fills the entire buffer, grow it
+	if (buffer_end_ == buffer_.size())
+		buffer_.resize(buffer_.size() * 2);
+
+	const size_t bytes_read = p_stream_ != NULL
+		? p_stream_->read(&buffer_[0] + buffer_end_, buffer_.size() - buffer_end_)
+		: fread(&buffer_[0] + buffer_end_, 1, buffer_.size() - buffer_end_, p_file_);
+	buffer_end_ += bytes_read;
+	return bytes_read > 0;
+}
+
+#ifdef _WIN32
+bool gcode_file_source::try_map_file(const std::string& file_path)
+{
+	HANDLE file_handle = CreateFileA(
+		file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL
+	);
+	if (file_handle == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	// Empty files cannot be mapped, and files that do not fit into a long are not supported by the mapping.
+	if (!GetFileSizeEx(file_handle, &size) || size.QuadPart <= 0 || size.QuadPart > 0x7FFFFFFF)
+	{
+		CloseHandle(file_handle);
+		return false;
+	}
+
+	HANDLE mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping_handle == NULL)
+	{
+		CloseHandle(file_handle);
+		return false;
+	}
+
+	const void* p_view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	if (p_view == NULL)
+	{
+		CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+		return false;
+	}
+	file_handle_ = file_handle;
+	mapping_handle_ = mapping_handle;
+	file_size_ = static_cast<long>(size.QuadPart);
+	p_map_begin_ = static_cast<const char*>(p_view);
+	p_map_end_ = p_map_begin_ + file_size_;
+	p_map_cur_ = p_map_begin_;
+	file_position_ = 0;
+	return true;
+}
+
+void gcode_file_source::unmap_file()
+{
+	if (p_map_begin_ != NULL)
+	{
+		UnmapViewOfFile(p_map_begin_);
+		p_map_begin_ = NULL;
+	}
+	if (mapping_handle_ != NULL)
+	{
+		CloseHandle(mapping_handle_);
+		mapping_handle_ = NULL;
+	}
+	if (file_handle_ != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file_handle_);
+		file_handle_ = INVALID_HANDLE_VALUE;
+	}
+	p_map_end_ = NULL;
+	p_map_cur_ = NULL;
+}
+#else
+bool gcode_file_source::try_map_file(const std::string& file_path)
+{
+	const int fd = ::open(file_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat file_stat;
+	// Empty files cannot be mapped, and files that do not fit into a long are not supported by the mapping.
+	if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0 || static_cast<unsigned long long>(file_stat.st_size) > 0x7FFFFFFFULL)
+	{
+		::close(fd);
+		return false;
+	}
+
+	const size_t size = static_cast<size_t>(file_stat.st_size);
+	void* p_view = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping holds its own reference to the file, so we can close the descriptor now.
+	::close(fd);
+	if (p_view == MAP_FAILED)
+		return false;
+#ifdef MADV_SEQUENTIAL
+	// We will read the file sequentially, let the kernel read ahead aggressively
+	madvise(p_view, size, MADV_SEQUENTIAL);
+#endif
+	file_size_ = static_cast<long>(size);
+	p_map_begin_ = static_cast<const char*>(p_view);
+	p_map_end_ = p_map_begin_ + size;
+	p_map_cur_ = p_map_begin_;
+	file_position_ = 0;
+	return true;
+}
+
+void gcode_file_source::unmap_file()
+{
+	if (p_map_begin_ != NULL)
+	{
+		munmap(const_cast<char*>(p_map_begin_), static_cast<size_t>(p_map_end_ - p_map_begin_));
+		p_map_begin_ = NULL;
+	}
+	p_map_end_ = NULL;
+	p_map_cur_ = NULL;
+}
+#endif
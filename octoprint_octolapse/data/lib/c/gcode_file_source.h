@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef GCODE_FILE_SOURCE_H
+#define GCODE_FILE_SOURCE_H
+#define _CRT_SECURE_NO_DEPRECATE
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include "gcode_input_stream.h"
+
+// The size of the read buffer used when the file cannot be memory mapped.
+#define GCODE_FILE_SOURCE_BUFFER_SIZE 1048576
+
+/**
+ * \brief Provides the lines of a gcode file as slices of an in memory buffer, tracking the byte offset of each line.
+ * The file is memory mapped if possible (mmap on Linux/macOS, MapViewOfFile on Windows).  If the file cannot be mapped
+ * it is read in large blocks.  Compressed and binary gcode files (see gcode_input_stream) are decoded into the same
+ * block buffer as they are read, and the offsets are those of the decoded text.  The returned slices are NOT null
+ * terminated and do not include the line terminator.  They remain valid until the next call to get_next_line or close.
+ */
+class gcode_file_source
+{
+public:
+	gcode_file_source();
+	~gcode_file_source();
+	bool open(const std::string& file_path);
+	void close();
+	bool is_open() const;
+	/**
+	 * \brief Gets the next line in the file.
+	 * \param p_line Receives a pointer to the first character of the line.
+	 * \param length Receives the length of the line, excluding the newline.
+	 * \return false if there are no more lines to read.
+	 */
+	bool get_next_line(const char*& p_line, size_t& length);
+	/**
+	 * \brief Gets the lines of the file in reverse, starting with the last line.  The reverse cursor is independent of
+	 * get_next_line.  A newline at the very end of the file does not produce an empty last line.  Decoded files can't
+	 * be read backwards, so they are decoded to the end (using up the forward cursor) and only the lines within the last
+	 * GCODE_FILE_SOURCE_BUFFER_SIZE bytes are returned.
+	 * \param p_line Receives a pointer to the first character of the line.
+	 * \param length Receives the length of the line, excluding the newline.
+	 * \return false if there are no more lines to read.
+	 */
+	bool get_previous_line(const char*& p_line, size_t& length);
+	/**
+	 * \brief The total size of the file in bytes.
+	 */
+	long get_file_size() const;
+	/**
+	 * \brief The byte offset of the next unread line, which is the end of the most recently returned line.
+	 */
+	long get_file_position() const;
+	/**
+	 * \brief The number of bytes that have been read from the file, which can be compared with get_file_size to report
+	 * progress.  This is the file position unless the file is decoded.
+	 */
+	long get_source_position() const;
+	/**
+	 * \brief Moves the forward cursor so that get_next_line returns the line starting at file_position, which must be
+	 * the start of a line.  Decoded files are decoded up to the position, starting over if it is behind the cursor.
+	 * \return false if the file isn't open or the position is outside of the file.
+	 */
+	bool seek(long file_position);
+	bool is_memory_mapped() const;
+	/**
+	 * \brief The name of the decoder (gzip, zlib or binary gcode), or NULL if the file is plain text.
+	 */
+	const char* get_decoder_name() const;
+	/**
+	 * \brief True if the file could not be decoded.  The lines that were decoded before the error are still returned.
+	 */
+	bool has_error() const;
+	std::string get_error() const;
+private:
+	gcode_file_source(const gcode_file_source &source); // don't copy me!
+	bool try_map_file(const std::string& file_path);
+	void unmap_file();
+	bool try_fill_buffer();
+	bool try_fill_reverse_buffer();
+	bool try_read_stream_tail();
+	bool is_open_;
+	bool is_memory_mapped_;
+	long file_size_;
+	long file_position_;
+	// memory mapped file
+	const char* p_map_begin_;
+	const char* p_map_end_;
+	const char* p_map_cur_;
+	const char* p_map_reverse_cur_;
+#ifdef _WIN32
+	void* file_handle_;
+	void* mapping_handle_;
+#endif
+	// streaming fallback
+	FILE* p_file_;
+	std::vector<char> buffer_;
+	size_t buffer_start_;
+	size_t buffer_end_;
+	bool is_eof_;
+	// reverse streaming fallback, reverse_buffer_ holds the bytes starting at reverse_buffer_file_position_
+	std::vector<char> reverse_buffer_;
+	size_t reverse_buffer_end_;
+	long reverse_buffer_file_position_;
+	bool is_reverse_started_;
+	// decoder for compressed and binary files, NULL for plain text
+	gcode_input_stream* p_stream_;
+};
+#endif
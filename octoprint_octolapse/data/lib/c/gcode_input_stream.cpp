@@ -0,0 +1,646 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "gcode_input_stream.h"
+#include <cstring>
+#include <exception>
+
+namespace
+{
+	const unsigned char binary_gcode_magic[4] = { 'G', 'C', 'D', 'E' };
+	const unsigned int binary_gcode_version = 1;
+	enum binary_gcode_block_type
+	{
+		binary_gcode_block_file_metadata = 0,
+		binary_gcode_block_gcode = 1,
+		binary_gcode_block_slicer_metadata = 2,
+		binary_gcode_block_printer_metadata = 3,
+		binary_gcode_block_print_metadata = 4,
+		binary_gcode_block_thumbnail = 5
+	};
+	enum binary_gcode_compression
+	{
+		binary_gcode_compression_none = 0,
+		binary_gcode_compression_deflate = 1,
+		binary_gcode_compression_heatshrink_11_4 = 2,
+		binary_gcode_compression_heatshrink_12_4 = 3
+	};
+	enum binary_gcode_encoding
+	{
+		binary_gcode_encoding_none = 0,
+		binary_gcode_encoding_meatpack = 1,
+		binary_gcode_encoding_meatpack_comments = 2
+	};
+
+	inline unsigned int read_uint16(const unsigned char* p_data)
+	{
+		return static_cast<unsigned int>(p_data[0]) | (static_cast<unsigned int>(p_data[1]) << 8);
+	}
+
+	inline unsigned int read_uint32(const unsigned char* p_data)
+	{
+		return read_uint16(p_data) | (read_uint16(p_data + 2) << 16);
+	}
+}
+
+#pragma region gcode_input_stream
+gcode_input_stream::gcode_input_stream(FILE* p_file)
+{
+	reader_.open(p_file);
+}
+
+gcode_input_stream::gcode_input_stream(const gcode_input_stream &source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+gcode_input_stream::~gcode_input_stream()
+{
+	
+}
+
+gcode_input_type gcode_input_stream::detect_type(const unsigned char* p_header, const size_t length)
+{
+	if (length >= 2 && p_header[0] == 0x1F && p_header[1] == 0x8B)
+		return gcode_input_type_gzip;
+	// Only the 32KB window that every zlib encoder uses is accepted, so that text can't be mistaken for zlib.
+	if (length >= 2 && p_header[0] == 0x78 && ((p_header[0] << 8) | p_header[1]) % 31 == 0 && (p_header[1] & 0x20) == 0)
+		return gcode_input_type_zlib;
+	if (length >= 4 && memcmp(p_header, binary_gcode_magic, 4) == 0)
+		return gcode_input_type_binary_gcode;
+	return gcode_input_type_text;
+}
+
+gcode_input_stream* gcode_input_stream::create(const gcode_input_type type, FILE* p_file)
+{
+	switch (type)
+	{
+	case gcode_input_type_gzip:
+		return new deflate_gcode_stream(p_file, true);
+	case gcode_input_type_zlib:
+		return new deflate_gcode_stream(p_file, false);
+	case gcode_input_type_binary_gcode:
+		return new binary_gcode_stream(p_file);
+	default:
+		return NULL;
+	}
+}
+
+long gcode_input_stream::get_source_position() const
+{
+	return reader_.get_position();
+}
+
+bool gcode_input_stream::has_error() const
+{
+	return !error_.empty();
+}
+
+const std::string& gcode_input_stream::get_error() const
+{
+	return error_;
+}
+
+void gcode_input_stream::set_error(const std::string& error)
+{
+	// Keep the first error, the ones after it are usually caused by it.
+	if (error_.empty())
+		error_ = error;
+}
+#pragma endregion gcode_input_stream
+
+#pragma region deflate_gcode_stream
+deflate_gcode_stream::deflate_gcode_stream(FILE* p_file, const bool is_gzip) : gcode_input_stream(p_file)
+{
+	is_gzip_ = is_gzip;
+	state_ = deflate_stream_state_header;
+	decoder_.reset(&reader_);
+	checksum_ = 0;
+	output_size_ = 0;
+	member_count_ = 0;
+}
+
+deflate_gcode_stream::~deflate_gcode_stream()
+{
+	
+}
+
+const char* deflate_gcode_stream::get_name() const
+{
+	return is_gzip_ ? "gzip" : "zlib";
+}
+
+bool deflate_gcode_stream::rewind()
+{
+	error_.clear();
+	if (!reader_.rewind())
+		return false;
+	state_ = deflate_stream_state_header;
+	decoder_.reset(&reader_);
+	checksum_ = 0;
+	output_size_ = 0;
+	member_count_ = 0;
+	return true;
+}
+
+bool deflate_gcode_stream::read_aligned_bytes(unsigned char* p_buffer, const size_t length)
+{
+	for (size_t index = 0; index < length; index++)
+	{
+		const int value = decoder_.read_aligned_byte();
+		if (value < 0)
+			return false;
+		p_buffer[index] = static_cast<unsigned char>(value);
+	}
+	return true;
+}
+
+bool deflate_gcode_stream::read_header()
+{
+	unsigned char header[10];
+	if (!is_gzip_)
+	{
+		if (!read_aligned_bytes(header, 2) || (header[0] & 0x0F) != 8 || ((header[0] << 8) | header[1]) % 31 != 0)
+		{
+			set_error("The zlib header is invalid.");
+			return false;
+		}
+		if ((header[1] & 0x20) != 0)
+		{
+			set_error("Zlib streams with a preset dictionary are not supported.");
+			return false;
+		}
+		checksum_ = 1;
+	}
+	else
+	{
+		const int first = decoder_.read_aligned_byte();
+		if (member_count_ > 0 && first != 0x1F)
+		{
+			// The end of the file, anything after the last member is ignored like gzip does.
+			state_ = deflate_stream_state_finished;
+			return true;
+		}
+		header[0] = static_cast<unsigned char>(first);
+		if (first < 0 || !read_aligned_bytes(header + 1, 9) || header[1] != 0x8B || header[2] != 8)
+		{
+			set_error("The gzip header is invalid.");
+			return false;
+		}
+		const unsigned char flags = header[3];
+		unsigned char bytes[2];
+		bool is_valid = true;
+		if ((flags & 0x04) != 0)
+		{
+			// extra field
+			is_valid = read_aligned_bytes(bytes, 2);
+			unsigned int extra_length = is_valid ? read_uint16(bytes) : 0;
+			while (is_valid && extra_length-- > 0)
+				is_valid = decoder_.read_aligned_byte() >= 0;
+		}
+		// the file name and the comment are null terminated
+		for (int field = 0x08; field <= 0x10; field <<= 1)
+		{
+			if ((flags & field) == 0)
+				continue;
+			int value;
+			do
+			{
+				value = is_valid ? decoder_.read_aligned_byte() : -1;
+			} while (value > 0);
+			is_valid = value == 0;
+		}
+		// header crc
+		if (is_valid && (flags & 0x02) != 0)
+			is_valid = read_aligned_bytes(bytes, 2);
+		if (!is_valid)
+		{
+			set_error("The gzip header is truncated.");
+			return false;
+		}
+		checksum_ = 0;
+	}
+	if (member_count_ > 0)
+		decoder_.restart();
+	output_size_ = 0;
+	member_count_++;
+	state_ = deflate_stream_state_data;
+	return true;
+}
+
+bool deflate_gcode_stream::read_trailer()
+{
+	unsigned char trailer[8];
+	if (is_gzip_)
+	{
+		if (!read_aligned_bytes(trailer, 8))
+		{
+			set_error("The gzip trailer is truncated.");
+			return false;
+		}
+		if (read_uint32(trailer) != checksum_ || read_uint32(trailer + 4) != output_size_)
+		{
+			set_error("The gzip checksum does not match, the file is corrupt.");
+			return false;
+		}
+		state_ = deflate_stream_state_header;
+		return true;
+	}
+	if (!read_aligned_bytes(trailer, 4))
+	{
+		set_error("The zlib trailer is truncated.");
+		return false;
+	}
+	const unsigned int adler = (static_cast<unsigned int>(trailer[0]) << 24) | (static_cast<unsigned int>(trailer[1]) << 16) |
+		(static_cast<unsigned int>(trailer[2]) << 8) | static_cast<unsigned int>(trailer[3]);
+	if (adler != checksum_)
+	{
+		set_error("The zlib checksum does not match, the file is corrupt.");
+		return false;
+	}
+	state_ = deflate_stream_state_finished;
+	return true;
+}
+
+size_t deflate_gcode_stream::read(char* p_buffer, const size_t size)
+{
+	size_t produced = 0;
+	while (produced < size)
+	{
+		bool is_valid = true;
+		switch (state_)
+		{
+		case deflate_stream_state_header:
+			is_valid = read_header();
+			break;
+		case deflate_stream_state_data:
+		{
+			const size_t count = decoder_.read(p_buffer + produced, size - produced);
+			const unsigned char* p_data = reinterpret_cast<const unsigned char*>(p_buffer + produced);
+			checksum_ = is_gzip_ ? gcode_crc32(checksum_, p_data, count) : gcode_adler32(checksum_, p_data, count);
+			// The gzip size is modulo 2^32
+			output_size_ += static_cast<unsigned int>(count);
+			produced += count;
+			if (decoder_.has_error())
+			{
+				set_error(decoder_.get_error());
+				is_valid = false;
+			}
+			else if (decoder_.is_finished())
+				state_ = deflate_stream_state_trailer;
+			break;
+		}
+		case deflate_stream_state_trailer:
+			is_valid = read_trailer();
+			break;
+		case deflate_stream_state_finished:
+			return produced;
+		}
+		if (!is_valid)
+			state_ = deflate_stream_state_finished;
+	}
+	return produced;
+}
+#pragma endregion deflate_gcode_stream
+
+#pragma region binary_gcode_stream
+binary_gcode_stream::binary_gcode_stream(FILE* p_file) : gcode_input_stream(p_file)
+{
+	chunk_.resize(BINARY_GCODE_CHUNK_SIZE);
+	is_header_read_ = false;
+	is_finished_ = false;
+	has_checksums_ = false;
+	is_in_block_ = false;
+	block_type_ = 0;
+	block_compression_ = 0;
+	block_encoding_ = 0;
+	block_remaining_ = 0;
+	block_adler_ = 1;
+	is_metadata_line_start_ = true;
+	is_metadata_value_ = false;
+	text_start_ = 0;
+}
+
+binary_gcode_stream::~binary_gcode_stream()
+{
+	
+}
+
+const char* binary_gcode_stream::get_name() const
+{
+	return "binary gcode";
+}
+
+bool binary_gcode_stream::rewind()
+{
+	error_.clear();
+	if (!reader_.rewind())
+		return false;
+	is_header_read_ = false;
+	is_finished_ = false;
+	is_in_block_ = false;
+	block_remaining_ = 0;
+	text_.clear();
+	text_start_ = 0;
+	return true;
+}
+
+size_t binary_gcode_stream::read(char* p_buffer, const size_t size)
+{
+	size_t produced = 0;
+	while (produced < size)
+	{
+		if (text_start_ < text_.size())
+		{
+			size_t count = text_.size() - text_start_;
+			if (count > size - produced)
+				count = size - produced;
+			memcpy(p_buffer + produced, text_.c_str() + text_start_, count);
+			text_start_ += count;
+			produced += count;
+			if (text_start_ == text_.size())
+			{
+				text_.clear();
+				text_start_ = 0;
+			}
+			continue;
+		}
+		if (is_finished_)
+			break;
+		if (!is_header_read_)
+			is_finished_ = !read_file_header();
+		else if (!is_in_block_)
+			is_finished_ = !read_block_header();
+		else
+			is_finished_ = !read_block_data();
+	}
+	return produced;
+}
+
+bool binary_gcode_stream::read_file_header()
+{
+	unsigned char header[10];
+	if (reader_.read(header, sizeof(header)) != sizeof(header) || memcmp(header, binary_gcode_magic, 4) != 0)
+	{
+		set_error("The binary gcode header is invalid.");
+		return false;
+	}
+	if (read_uint32(header + 4) != binary_gcode_version)
+	{
+		set_error("The binary gcode version is not supported.");
+		return false;
+	}
+	const unsigned int checksum_type = read_uint16(header + 8);
+	if (checksum_type > 1)
+	{
+		set_error("The binary gcode checksum type is not supported.");
+		return false;
+	}
+	has_checksums_ = checksum_type == 1;
+	is_header_read_ = true;
+	return true;
+}
+
+bool binary_gcode_stream::read_block_header()
+{
+	// The checksum covers the block header, the parameters and the data
+	if (has_checksums_)
+		reader_.begin_checksum();
+	unsigned char header[18];
+	const size_t header_size = reader_.read(header, 8);
+	if (header_size == 0)
+		return false; // the end of the file
+	if (header_size != 8)
+	{
+		set_error("The binary gcode file is truncated.");
+		return false;
+	}
+	block_type_ = static_cast<unsigned short>(read_uint16(header));
+	block_compression_ = static_cast<unsigned short>(read_uint16(header + 2));
+	block_remaining_ = read_uint32(header + 4);
+	long data_size = static_cast<long>(block_remaining_);
+	if (block_type_ > binary_gcode_block_thumbnail || block_compression_ > binary_gcode_compression_heatshrink_12_4)
+	{
+		set_error("The binary gcode file contains an unknown block type or compression.");
+		return false;
+	}
+	if (block_compression_ != binary_gcode_compression_none)
+	{
+		if (reader_.read(header + 8, 4) != 4)
+		{
+			set_error("The binary gcode file is truncated.");
+			return false;
+		}
+		data_size = static_cast<long>(read_uint32(header + 8));
+	}
+	// Thumbnails have a format, a width and a height, the other blocks have an encoding.
+	const size_t parameters_size = block_type_ == binary_gcode_block_thumbnail ? 6 : 2;
+	if (reader_.read(header + 12, parameters_size) != parameters_size)
+	{
+		set_error("The binary gcode file is truncated.");
+		return false;
+	}
+	block_encoding_ = static_cast<unsigned short>(read_uint16(header + 12));
+	is_in_block_ = true;
+	reader_.set_limit(data_size);
+	if (block_type_ == binary_gcode_block_thumbnail)
+	{
+		block_remaining_ = 0;
+		if (!reader_.skip(data_size))
+		{
+			set_error("The binary gcode file is truncated.");
+			return false;
+		}
+		return true;
+	}
+	if (
+		(block_type_ == binary_gcode_block_gcode && block_encoding_ > binary_gcode_encoding_meatpack_comments) ||
+		(block_type_ != binary_gcode_block_gcode && block_encoding_ != binary_gcode_encoding_none)
+	)
+	{
+		set_error("The binary gcode file contains an unknown block encoding.");
+		return false;
+	}
+	switch (block_compression_)
+	{
+	case binary_gcode_compression_deflate:
+	{
+		// The deflate data is wrapped in a zlib header and trailer
+		inflate_decoder_.reset(&reader_);
+		const int method = inflate_decoder_.read_aligned_byte();
+		const int flags = inflate_decoder_.read_aligned_byte();
+		if (method < 0 || flags < 0 || (method & 0x0F) != 8 || ((method << 8) | flags) % 31 != 0 || (flags & 0x20) != 0)
+		{
+			set_error("A binary gcode block has an invalid zlib header.");
+			return false;
+		}
+		block_adler_ = 1;
+		break;
+	}
+	case binary_gcode_compression_heatshrink_11_4:
+		heatshrink_decoder_.reset(&reader_, 11, 4);
+		break;
+	case binary_gcode_compression_heatshrink_12_4:
+		heatshrink_decoder_.reset(&reader_, 12, 4);
+		break;
+	default:
+		break;
+	}
+	meatpack_decoder_.reset();
+	is_metadata_line_start_ = true;
+	is_metadata_value_ = false;
+	return true;
+}
+
+size_t binary_gcode_stream::read_decompressed(char* p_buffer, const size_t size)
+{
+	switch (block_compression_)
+	{
+	case binary_gcode_compression_deflate:
+	{
+		const size_t count = inflate_decoder_.read(p_buffer, size);
+		block_adler_ = gcode_adler32(block_adler_, reinterpret_cast<const unsigned char*>(p_buffer), count);
+		return count;
+	}
+	case binary_gcode_compression_heatshrink_11_4:
+	case binary_gcode_compression_heatshrink_12_4:
+		return heatshrink_decoder_.read(p_buffer, size);
+	default:
+		return reader_.read(reinterpret_cast<unsigned char*>(p_buffer), size);
+	}
+}
+
+bool binary_gcode_stream::read_block_data()
+{
+	if (block_remaining_ > 0)
+	{
+		const size_t size = block_remaining_ < chunk_.size() ? block_remaining_ : chunk_.size();
+		const size_t count = read_decompressed(&chunk_[0], size);
+		if (count != size)
+		{
+			std::string error = "A binary gcode block is truncated or corrupt.";
+			if (inflate_decoder_.has_error())
+				error += std::string("  ") + inflate_decoder_.get_error();
+			set_error(error);
+			return false;
+		}
+		block_remaining_ -= static_cast<unsigned int>(count);
+		if (block_type_ == binary_gcode_block_gcode)
+		{
+			if (block_encoding_ == binary_gcode_encoding_none)
+				text_.append(&chunk_[0], count);
+			else
+				meatpack_decoder_.decode(reinterpret_cast<const unsigned char*>(&chunk_[0]), count, text_);
+		}
+		else
+			append_metadata(&chunk_[0], count);
+		if (block_remaining_ > 0)
+			return true;
+	}
+	return finish_block();
+}
+
+void binary_gcode_stream::append_metadata(const char* p_data, const size_t length)
+{
+	// Each key=value line becomes a '; key = value' comment
+	for (size_t index = 0; index < length; index++)
+	{
+		const char c = p_data[index];
+		if (is_metadata_line_start_)
+		{
+			if (c == '\n' || c == '\r')
+				continue;
+			text_.append("; ");
+			is_metadata_line_start_ = false;
+			is_metadata_value_ = false;
+		}
+		if (c == '=' && !is_metadata_value_)
+		{
+			text_.append(" = ");
+			is_metadata_value_ = true;
+			continue;
+		}
+		text_.push_back(c);
+		if (c == '\n')
+			is_metadata_line_start_ = true;
+	}
+}
+
+bool binary_gcode_stream::finish_block()
+{
+	is_in_block_ = false;
+	if (block_type_ != binary_gcode_block_gcode && block_type_ != binary_gcode_block_thumbnail && !is_metadata_line_start_)
+	{
+		text_.push_back('\n');
+		is_metadata_line_start_ = true;
+	}
+	if (block_type_ != binary_gcode_block_thumbnail && block_compression_ == binary_gcode_compression_deflate)
+	{
+		// Decode the end of the deflate stream, there must not be any data left.
+		char extra;
+		if (inflate_decoder_.read(&extra, 1) != 0 || !inflate_decoder_.is_finished())
+		{
+			set_error("A binary gcode block has more data than its size.");
+			return false;
+		}
+		unsigned char trailer[4];
+		for (int index = 0; index < 4; index++)
+		{
+			const int value = inflate_decoder_.read_aligned_byte();
+			if (value < 0)
+			{
+				set_error("A binary gcode block is truncated.");
+				return false;
+			}
+			trailer[index] = static_cast<unsigned char>(value);
+		}
+		const unsigned int adler = (static_cast<unsigned int>(trailer[0]) << 24) | (static_cast<unsigned int>(trailer[1]) << 16) |
+			(static_cast<unsigned int>(trailer[2]) << 8) | static_cast<unsigned int>(trailer[3]);
+		if (adler != block_adler_)
+		{
+			set_error("A binary gcode block checksum does not match, the file is corrupt.");
+			return false;
+		}
+	}
+	// Skip any padding at the end of the data
+	const long remaining = reader_.get_remaining_limit();
+	if (remaining > 0)
+		reader_.skip(remaining);
+	reader_.set_limit(-1);
+	if (has_checksums_)
+	{
+		const unsigned int checksum = reader_.end_checksum();
+		unsigned char bytes[4];
+		if (reader_.read(bytes, 4) != 4)
+		{
+			set_error("The binary gcode file is truncated.");
+			return false;
+		}
+		if (read_uint32(bytes) != checksum)
+		{
+			set_error("A binary gcode block checksum does not match, the file is corrupt.");
+			return false;
+		}
+	}
+	return true;
+}
+#pragma endregion binary_gcode_stream
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GCODE_INPUT_STREAM_H
+#define GCODE_INPUT_STREAM_H
+#include "gcode_decompression.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+
+// The number of bytes that are decompressed at once before they are decoded into gcode text.
+#define BINARY_GCODE_CHUNK_SIZE 65536
+
+enum gcode_input_type
+{
+	gcode_input_type_text,
+	gcode_input_type_gzip,
+	gcode_input_type_zlib,
+	gcode_input_type_binary_gcode
+};
+
+/**
+ * \brief Decodes a gcode file that is not stored as plain text into gcode text.  Files are read and decoded a block at
+ * a time, so memory use doesn't depend on the size of the file.  The stream reads the file from its start, but the
+ * file is not owned by the stream.
+ */
+class gcode_input_stream
+{
+public:
+	virtual ~gcode_input_stream();
+	/**
+	 * \brief Determines the type of a file from its first bytes.
+	 */
+	static gcode_input_type detect_type(const unsigned char* p_header, size_t length);
+	/**
+	 * \brief Creates the stream that decodes files of the given type, or NULL for plain text.
+	 */
+	static gcode_input_stream* create(gcode_input_type type, FILE* p_file);
+	/**
+	 * \brief Decodes up to size bytes of gcode text.
+	 * \return The number of bytes decoded, which is only less than size at the end of the file or on an error.
+	 */
+	virtual size_t read(char* p_buffer, size_t size) = 0;
+	/**
+	 * \brief Starts decoding from the beginning of the file again.
+	 */
+	virtual bool rewind() = 0;
+	virtual const char* get_name() const = 0;
+	/**
+	 * \brief The number of bytes read from the file, which is used to report progress.
+	 */
+	long get_source_position() const;
+	bool has_error() const;
+	const std::string& get_error() const;
+protected:
+	gcode_input_stream(FILE* p_file);
+	void set_error(const std::string& error);
+	gcode_byte_reader reader_;
+	std::string error_;
+private:
+	gcode_input_stream(const gcode_input_stream &source); // don't copy me!
+};
+
+/**
+ * \brief Decodes gzip files, including files with several members, and zlib streams.  The checksums in the trailers
+ * are verified.
+ */
+class deflate_gcode_stream : public gcode_input_stream
+{
+public:
+	deflate_gcode_stream(FILE* p_file, bool is_gzip);
+	virtual ~deflate_gcode_stream();
+	virtual size_t read(char* p_buffer, size_t size);
+	virtual bool rewind();
+	virtual const char* get_name() const;
+private:
+	enum deflate_stream_state { deflate_stream_state_header, deflate_stream_state_data, deflate_stream_state_trailer, deflate_stream_state_finished };
+	bool read_header();
+	bool read_trailer();
+	bool read_aligned_bytes(unsigned char* p_buffer, size_t length);
+	bool is_gzip_;
+	deflate_stream_state state_;
+	inflate_decoder decoder_;
+	unsigned int checksum_;
+	unsigned int output_size_;
+	int member_count_;
+};
+
+/**
+ * \brief Decodes binary gcode (.bgcode) files.  The gcode blocks are decompressed (deflate or heatshrink) and unpacked
+ * (MeatPack) into gcode text.  The metadata blocks become '; key = value' comments, like the text produced by the
+ * slicers, and the thumbnails are skipped.  The block checksums are verified.
+ */
+class binary_gcode_stream : public gcode_input_stream
+{
+public:
+	binary_gcode_stream(FILE* p_file);
+	virtual ~binary_gcode_stream();
+	virtual size_t read(char* p_buffer, size_t size);
+	virtual bool rewind();
+	virtual const char* get_name() const;
+private:
+	bool read_file_header();
+	bool read_block_header();
+	bool read_block_data();
+	bool finish_block();
+	size_t read_decompressed(char* p_buffer, size_t size);
+	void append_metadata(const char* p_data, size_t length);
+	bool is_header_read_;
+	bool is_finished_;
+	bool has_checksums_;
+	bool is_in_block_;
+	unsigned short block_type_;
+	unsigned short block_compression_;
+	unsigned short block_encoding_;
+	unsigned int block_remaining_;
+	inflate_decoder inflate_decoder_;
+	heatshrink_decoder heatshrink_decoder_;
+	meatpack_decoder meatpack_decoder_;
+	unsigned int block_adler_;
+	bool is_metadata_line_start_;
+	bool is_metadata_value_;
+	std::vector<char> chunk_;
+	// Decoded text that has not been read yet
+	std::string text_;
+	size_t text_start_;
+};
+#endif
@@ -24,82 +24,211 @@
 #include "utilities.h"
 #include <cmath>
 #include <iostream>
-gcode_parser::gcode_parser()
+#include <cstring>
+#include <stdint.h>
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+// Read eight characters at a time when scanning digit runs.  This relies on the first character landing in the low
+// byte of the word.
+#define GCODE_PARSER_USE_SWAR
+#endif
+
+// Digit runs up to this length convert to doubles exactly, so the fast path produces the same bits as the reference.
+#define GCODE_PARSER_MAX_FAST_DIGITS 15
+
+static const double exact_powers_of_ten[GCODE_PARSER_MAX_FAST_DIGITS + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+};
+
+// Returns the character at p, or a null terminator if p has reached the end of the gcode.
+// This lets the parser treat length delimited gcode exactly like a null terminated string.
+inline static char get_char(const char * p, const char * p_end)
 {
-	// doesn't work in the ancient version of c++ I am forced to use :(
-	// or at least I don't know how to us a newer one with python 2.7
-	// help...
-	/* 
-	std::vector<std::string> text_only_function_names = { "M117" }; // "M117" is an example of a command that would work here.
-
-	std::vector<std::string> parsable_command_names = {
-		"G0","G1","G2","G3","G10","G11","G20","G21","G28","G29","G80","G90","G91","G92","M82","M83","M104","M105","M106","M109","M114","M116","M140","M141","M190","M191","M207","M208","M240","M400","T"
-	};
-	*/
-	// Have to resort to barbarity.
-	// Text only function names
-	std::vector<std::string> text_only_function_names;
-	text_only_function_names.push_back(("M117"));
-	// parsable_command_names
-	std::vector<std::string> parsable_command_names;
-	parsable_command_names.push_back("G0");
-	parsable_command_names.push_back("G1");
-	parsable_command_names.push_back("G2");
-	parsable_command_names.push_back("G3");
-	parsable_command_names.push_back("G10");
-	parsable_command_names.push_back("G11");
-	parsable_command_names.push_back("G20");
-	parsable_command_names.push_back("G21");
-	parsable_command_names.push_back("G28");
-	parsable_command_names.push_back("G29");
-	parsable_command_names.push_back("G80");
-	parsable_command_names.push_back("G90");
-	parsable_command_names.push_back("G91");
-	parsable_command_names.push_back("G92");
-	parsable_command_names.push_back("M82");
-	parsable_command_names.push_back("M83");
-	parsable_command_names.push_back("M104");
-	parsable_command_names.push_back("M105");
-	parsable_command_names.push_back("M106");
-	parsable_command_names.push_back("M109");
-	parsable_command_names.push_back("M114");
-	parsable_command_names.push_back("M116");
-	parsable_command_names.push_back("M140");
-	parsable_command_names.push_back("M141");
-	parsable_command_names.push_back("M190");
-	parsable_command_names.push_back("M191");
-	parsable_command_names.push_back("M207");
-	parsable_command_names.push_back("M208");
-	parsable_command_names.push_back("M218");
-	parsable_command_names.push_back("M240");
-	parsable_command_names.push_back("M400");
-	parsable_command_names.push_back("M563");
-	parsable_command_names.push_back("T");
-	parsable_command_names.push_back("@OCTOLAPSE");
-
-	for (unsigned int index = 0; index < text_only_function_names.size(); index++)
-	{
-		std::string functionName = text_only_function_names[index];
-		text_only_functions_.insert(functionName);
-	}
-
-	for (unsigned int index = 0; index < parsable_command_names.size(); index++)
-	{
-		std::string commandName = parsable_command_names[index];
-		parsable_commands_.insert(commandName);
+	return p < p_end ? *p : '\0';
+}
+
+inline static size_t get_remaining_length(const char * p, const char * p_end)
+{
+	return p < p_end ? static_cast<size_t>(p_end - p) : 0;
+}
+
+inline static bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// Returns the first ';', null terminator or p_end, whichever comes first.
+inline static const char * find_comment_start(const char * p, const char * p_end)
+{
+	const size_t length = get_remaining_length(p, p_end);
+	if (length == 0)
+		return p_end;
+	const char * p_semicolon = static_cast<const char *>(memchr(p, ';', length));
+	const char * p_stop = p_semicolon == NULL ? p_end : p_semicolon;
+	// A null terminator ends the gcode just like the end of the buffer.
+	const char * p_null = static_cast<const char *>(memchr(p, '\0', p_stop - p));
+	return p_null == NULL ? p_stop : p_null;
+}
+
+#ifdef GCODE_PARSER_USE_SWAR
+// Returns the number of leading digits in the eight characters packed into word.  Subtracting '0' borrows out of
+// every byte below '0' and adding 0x46 carries into the high bit of every byte above '9'.  Borrows and carries only
+// move towards later characters, so the first non digit is always flagged correctly.
+inline static unsigned int count_leading_digits(uint64_t word)
+{
+	const uint64_t non_digits = ((word - 0x3030303030303030ULL) | (word + 0x4646464646464646ULL)) & 0x8080808080808080ULL;
+	if (non_digits == 0)
+		return 8;
+#if defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned int>(__builtin_ctzll(non_digits)) / 8;
+#else
+	unsigned int count = 0;
+	while ((non_digits & (0x80ULL << (count * 8))) == 0)
+		++count;
+	return count;
+#endif
+}
+
+// Converts the eight digits packed into word, the first digit being the most significant.
+inline static uint64_t convert_eight_digits(uint64_t word)
+{
+	word -= 0x3030303030303030ULL;
+	word = (word * 10 + (word >> 8)) & 0x00FF00FF00FF00FFULL;
+	word = (word * 100 + (word >> 16)) & 0x0000FFFF0000FFFFULL;
+	return (word * 10000 + (word >> 32)) & 0x00000000FFFFFFFFULL;
+}
+#endif
+
+// Reads a run of digits into value, stopping at the first non digit or after max_digits + 1 digits.  Returns the
+// number of digits read.
+inline static unsigned int read_digit_run(const char * p, const char * p_end, unsigned int max_digits, uint64_t& value)
+{
+	unsigned int count = 0;
+	value = 0;
+#ifdef GCODE_PARSER_USE_SWAR
+	while (count <= max_digits && get_remaining_length(p + count, p_end) >= 8)
+	{
+		uint64_t word;
+		memcpy(&word, p + count, 8);
+		const unsigned int digits = count_leading_digits(word);
+		if (digits == 8)
+		{
+			value = value * 100000000ULL + convert_eight_digits(word);
+			count += 8;
+			continue;
+		}
+		if (digits > 0)
+		{
+			// Shift the digits to the top of the word so that the empty low bytes act as leading zeros.
+			const unsigned int shift = (8 - digits) * 8;
+			word = (word << shift) | (0x3030303030303030ULL >> (digits * 8));
+			uint64_t multiplier = 1;
+			for (unsigned int index = 0; index < digits; index++)
+				multiplier *= 10;
+			value = value * multiplier + convert_eight_digits(word);
+			count += digits;
+		}
+		return count;
+	}
+#endif
+	while (count <= max_digits && is_digit(get_char(p + count, p_end)))
+	{
+		value = value * 10 + static_cast<uint64_t>(p[count] - '0');
+		++count;
 	}
+	return count;
+}
 
+gcode_parser::gcode_parser() : text_only_functions_(get_text_only_functions())
+{
 }
 
-gcode_parser::gcode_parser(const gcode_parser &source)
+gcode_parser::gcode_parser(const gcode_parser &source) : text_only_functions_(get_text_only_functions())
 {
 	// Private copy constructor - you can't copy this class
 }
 
 gcode_parser::~gcode_parser()
 {
-	text_only_functions_.clear();
-	parsable_commands_.clear();
+}
+
+const std::set<std::string>& gcode_parser::get_text_only_functions()
+{
+	// Text only function names.  Function local statics are initialized once, even when called from several threads.
+	static const char* names[] = { "M117" };
+	static const std::set<std::string> text_only_functions(names, names + sizeof(names) / sizeof(names[0]));
+	return text_only_functions;
+}
+
+gcode_opcode gcode_parser::get_gcode_opcode(const std::string& command)
+{
+	// Only the commands we can extract parameters from have an opcode.
+	const size_t length = command.length();
+	if (length == 0)
+		return gcode_opcode_unknown;
+	const char word = command[0];
+	if (word == 'T')
+		return length == 1 ? gcode_opcode_t : gcode_opcode_unknown;
+	if (word == '@')
+		return command == "@OCTOLAPSE" ? gcode_opcode_octolapse : gcode_opcode_unknown;
+	if ((word != 'G' && word != 'M') || length < 2 || length > 4)
+		return gcode_opcode_unknown;
+	// Convert the address to an integer.  Any non digit (for example G29.1) means we don't know the command.
+	int address = 0;
+	for (size_t index = 1; index < length; index++)
+	{
+		const char c = command[index];
+		if (c < '0' || c > '9')
+			return gcode_opcode_unknown;
+		address = address * 10 + (c - '0');
+	}
+	// Leading zeros (G01) are not known commands.
+	if (length > 2 && command[1] == '0')
+		return gcode_opcode_unknown;
+
+	if (word == 'G')
+	{
+		switch (address)
+		{
+		case 0: return gcode_opcode_g0;
+		case 1: return gcode_opcode_g1;
+		case 2: return gcode_opcode_g2;
+		case 3: return gcode_opcode_g3;
+		case 10: return gcode_opcode_g10;
+		case 11: return gcode_opcode_g11;
+		case 20: return gcode_opcode_g20;
+		case 21: return gcode_opcode_g21;
+		case 28: return gcode_opcode_g28;
+		case 29: return gcode_opcode_g29;
+		case 80: return gcode_opcode_g80;
+		case 90: return gcode_opcode_g90;
+		case 91: return gcode_opcode_g91;
+		case 92: return gcode_opcode_g92;
+		default: return gcode_opcode_unknown;
+		}
+	}
+	switch (address)
+	{
+	case 82: return gcode_opcode_m82;
+	case 83: return gcode_opcode_m83;
+	case 104: return gcode_opcode_m104;
+	case 105: return gcode_opcode_m105;
+	case 106: return gcode_opcode_m106;
+	case 109: return gcode_opcode_m109;
+	case 114: return gcode_opcode_m114;
+	case 116: return gcode_opcode_m116;
+	case 140: return gcode_opcode_m140;
+	case 141: return gcode_opcode_m141;
+	case 190: return gcode_opcode_m190;
+	case 191: return gcode_opcode_m191;
+	case 207: return gcode_opcode_m207;
+	case 208: return gcode_opcode_m208;
+	case 218: return gcode_opcode_m218;
+	case 240: return gcode_opcode_m240;
+	case 400: return gcode_opcode_m400;
+	case 563: return gcode_opcode_m563;
+	default: return gcode_opcode_unknown;
+	}
 }
 
 parsed_command gcode_parser::parse_gcode(const char * gcode)
@@ -110,20 +239,34 @@ parsed_command gcode_parser::parse_gcode(const char * gcode)
 	return p_cmd;
 }
 
-// Superfast gcode parser - v2
+parsed_command gcode_parser::parse_gcode(const char * gcode, size_t length)
+{
+
+	parsed_command p_cmd;
+	try_parse_gcode(gcode, length, p_cmd);
+	return p_cmd;
+}
+
 bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command)
+{
+	return try_parse_gcode(gcode, strlen(gcode), command);
+}
+
+// Superfast gcode parser - v2
+bool gcode_parser::try_parse_gcode(const char * gcode, size_t length, parsed_command & command)
 {
 	// Create a command
-	//octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::VERBOSE, gcode);
+	OCTOLAPSE_LOG(octolapse_log::GCODE_PARSER, octolapse_log::VERBOSE, std::string(gcode, length));
 	char * p_gcode = const_cast<char *>(gcode);
 	char * p = const_cast<char *>(gcode);
+	const char * p_end = gcode + length;
 	command.is_empty = true;
-	command.is_known_command = try_extract_gcode_command(&p, &(command.command));
+	command.is_known_command = try_extract_gcode_command(&p, p_end, &(command.command));
 	if (!command.is_known_command)
 	{
 		while (true)
 		{
-			char c = *p_gcode;
+			char c = get_char(p_gcode, p_end);
 			if (c == '\0' || c == ';' || c == ' ' || c == '\t')
 				break;
 			else if (c > 31)
@@ -143,12 +286,11 @@ bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command)
 		command.is_empty = false;
 
 	bool has_seen_character = false;
-	while (true)
+	const char * p_comment = find_comment_start(p_gcode, p_end);
+	while (p_gcode < p_comment)
 	{
 		char cur_char = *p_gcode;
-		if (cur_char == '\0' || cur_char == ';')
-			break;
-		else if (cur_char > 32 || cur_char == ' ' && has_seen_character)
+		if (cur_char > 32 || cur_char == ' ' && has_seen_character)
 		{
 			if (cur_char >= 'a' && cur_char <= 'z')
 				command.gcode.push_back(cur_char - 32);
@@ -158,14 +300,20 @@ bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command)
 		}
 		p_gcode++;
 	}
-	command.gcode = utilities::rtrim(command.gcode);
+	// Trim in place so that we keep the reserved capacity of the gcode string.  Spaces are
+	// the only whitespace that can be added to the gcode above.
+	const size_t gcode_end = command.gcode.find_last_not_of(' ');
+	if (gcode_end == std::string::npos)
+		command.gcode.clear();
+	else
+		command.gcode.resize(gcode_end + 1);
 
 	if (command.is_known_command)
 	{
 		//command->gcode_ = gcode;
 		//std::vector<parsed_command_parameter> parameters;
-
-		if (parsable_commands_.find(command.command) == parsable_commands_.end())
+		command.opcode = get_gcode_opcode(command.command);
+		if (command.opcode == gcode_opcode_unknown)
 		{
 			// Don't bother logging this.  Too much logging.
 			//std::string message = "The gcode command is not in the parsable commands set: ";
@@ -173,117 +321,99 @@ bool gcode_parser::try_parse_gcode(const char * gcode, parsed_command & command)
 			//octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::VERBOSE, message);
 			return true;
 		}
-		if (command.command.length() > 0 && command.command == "@OCTOLAPSE")
+		// Parameters are extracted directly into the command's (reserved) parameter vector to avoid copies.
+		if (command.opcode == gcode_opcode_octolapse)
 		{
-			
-			parsed_command_parameter octolapse_parameter;
-
-			if (!try_extract_octolapse_parameter(&p, &octolapse_parameter))
+			command.parameters.resize(command.parameters.size() + 1);
+			if (!try_extract_octolapse_parameter(&p, p_end, &command.parameters.back()))
 			{
-				std::string message = "Unable to extract an octolapse parameter from: ";
-				message += p;
-				octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::WARNING, message);
+				command.parameters.pop_back();
+				OCTOLAPSE_LOG(octolapse_log::GCODE_PARSER, octolapse_log::WARNING, "Unable to extract an octolapse parameter from: " << std::string(p, get_remaining_length(p, p_end)));
 				return true;
 			}
-			command.parameters.push_back(octolapse_parameter);
 			// Extract any additional parameters the old way
-			while (true)
-			{
-				//std::cout << "GcodeParser.try_parse_gcode - Trying to extract parameters.\r\n";
-				parsed_command_parameter param;
-				if (try_extract_parameter(&p, &param))
-					command.parameters.push_back(param);
-				else
-				{
-					//std::cout << "GcodeParser.try_parse_gcode - No parameters found.\r\n";
-					break;
-				}
-			}
-
+			try_extract_parameters(&p, p_end, command);
 		}
 		else if (
-			text_only_functions_.find(command.command) != text_only_functions_.end() ||
-			(
-				command.command.length() > 0 && command.command[0] == '@'
-			)
+			(command.command[0] == 'M' && text_only_functions_.find(command.command) != text_only_functions_.end()) ||
+			command.command[0] == '@'
 		){
 			//std::cout << "GcodeParser.try_parse_gcode - Text only parameter found.\r\n";
-			parsed_command_parameter text_command;
-			if (!try_extract_text_parameter(&p, &(text_command.string_value)))
+			command.parameters.resize(command.parameters.size() + 1);
+			parsed_command_parameter& text_command = command.parameters.back();
+			if (!try_extract_text_parameter(&p, p_end, &(text_command.string_value)))
 			{
-				std::string message = "Unable to extract a text parameter from: ";
-				message += p;
-				octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::WARNING, message);
+				command.parameters.pop_back();
+				OCTOLAPSE_LOG(octolapse_log::GCODE_PARSER, octolapse_log::WARNING, "Unable to extract a text parameter from: " << std::string(p, get_remaining_length(p, p_end)));
 				return true;
 			}
 			text_command.name = '\0';
-			command.parameters.push_back(text_command);
 		}
 		else
 		{
-			if (command.command[0] == 'T')
+			if (command.opcode == gcode_opcode_t)
 			{
 				//std::cout << "GcodeParser.try_parse_gcode - T parameter found.\r\n";
-				parsed_command_parameter param;
-
-				if (!try_extract_t_parameter(&p, &param))
+				command.parameters.resize(command.parameters.size() + 1);
+				if (!try_extract_t_parameter(&p, p_end, &command.parameters.back()))
 				{
-					std::string message = "Unable to extract a parameter from the T command: ";
-					message += gcode;
-					octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::ERROR, message);
+					command.parameters.pop_back();
+					OCTOLAPSE_LOG(octolapse_log::GCODE_PARSER, octolapse_log::ERROR, "Unable to extract a parameter from the T command: " << std::string(gcode, length));
 				}
-				else
-					command.parameters.push_back(param);
 			}
 			else
 			{
-				while (true)
-				{
-					//std::cout << "GcodeParser.try_parse_gcode - Trying to extract parameters.\r\n";
-					parsed_command_parameter param;
-					if (try_extract_parameter(&p, &param))
-						command.parameters.push_back(param);
-					else
-					{
-						//std::cout << "GcodeParser.try_parse_gcode - No parameters found.\r\n";
-						break;
-					}
-				}
+				try_extract_parameters(&p, p_end, command);
 			}
 		}
 	}
-	try_extract_comment(&p_gcode, &(command.comment));
+	try_extract_comment(&p_gcode, p_end, &(command.comment));
 		
 
 	return command.is_known_command;
 	
 }
 
-bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_command)
+void gcode_parser::try_extract_parameters(char ** p_p_gcode, const char * p_end, parsed_command & command) const
+{
+	while (true)
+	{
+		//std::cout << "GcodeParser.try_parse_gcode - Trying to extract parameters.\r\n";
+		command.parameters.resize(command.parameters.size() + 1);
+		if (!try_extract_parameter(p_p_gcode, p_end, &command.parameters.back()))
+		{
+			//std::cout << "GcodeParser.try_parse_gcode - No parameters found.\r\n";
+			command.parameters.pop_back();
+			break;
+		}
+	}
+}
+
+bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, const char * p_end, std::string * p_command)
 {
 	char * p = *p_p_gcode;
 	char gcode_word;
 	bool found_command = false;
 
 	// Ignore Leading Spaces
-	while (*p == ' ')
+	while (get_char(p, p_end) == ' ')
 	{
 		p++;
 	}
 	// See if this is an @ command, which can be used in octoprint for controlling octolapse
-	if (*p == '@')
+	if (get_char(p, p_end) == '@')
 	{
-		found_command = gcode_parser::try_extract_at_command(&p, p_command);
+		found_command = gcode_parser::try_extract_at_command(&p, p_end, p_command);
 	}
 	else
 	{
 
 	}
 	// Deal with case sensitivity
-	if (*p >= 'a' && *p <= 'z')
-		gcode_word = *p - 32;
+	if (get_char(p, p_end) >= 'a' && get_char(p, p_end) <= 'z')
+		gcode_word = get_char(p, p_end) - 32;
 	else
-		gcode_word = *p;
+		gcode_word = get_char(p, p_end);
 	if (gcode_word == 'G' || gcode_word == 'M' || gcode_word == 'T')
 	{
 		// Set the gcode word of the new command to the current pointer's location and increment both
@@ -295,8 +425,8 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 			// the T command is special, it has no address
 
 			// Now look for a command address
-			while ((*p >= '0' && *p <= '9') || *p == ' ') {
-				if (*p != ' ')
+			while ((get_char(p, p_end) >= '0' && get_char(p, p_end) <= '9') || get_char(p, p_end) == ' ') {
+				if (get_char(p, p_end) != ' ')
 				{
 					found_command = true;
 					(*p_command).push_back(*p++);
@@ -307,7 +437,7 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 					// but for the command itself, it might be a good idea
 					// to assume the space is important.
 					// instead, keep moving forward until no spaces are found
-					while (*p == ' ')
+					while (get_char(p, p_end) == ' ')
 					{
 						p++;
 					}
@@ -321,11 +451,11 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 					++p;
 				}
 			}
-			if (*p == '.') {
+			if (get_char(p, p_end) == '.') {
 				(*p_command).push_back(*p++);
 				found_command = false;
-				while ((*p >= '0' && *p <= '9') || *p == ' ') {
-					if (*p != ' ')
+				while ((get_char(p, p_end) >= '0' && get_char(p, p_end) <= '9') || get_char(p, p_end) == ' ') {
+					if (get_char(p, p_end) != ' ')
 					{
 						found_command = true;
 						(*p_command).push_back(*p++);
@@ -342,28 +472,28 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 			char * p_t = p;
 			// skip any whitespace
 			// Ignore Leading Spaces
-			while (*p_t == ' ' || *p_t == '\t')
+			while (get_char(p_t, p_end) == ' ' || get_char(p_t, p_end) == '\t')
 			{
 				p_t++;
 			}
 			// create a char to hold the t parameter
 			char t_param = '\0';
 			// 
-			if (*p_t >= 'a' && *p_t <= 'z')
-				t_param = *p_t - 32;
+			if (get_char(p_t, p_end) >= 'a' && get_char(p_t, p_end) <= 'z')
+				t_param = get_char(p_t, p_end) - 32;
 			else
-				t_param = *p_t;
+				t_param = get_char(p_t, p_end);
 
 
 			if (t_param == 'C' || t_param == 'X' || t_param == '?')
 			{
 				p_t++;
 				// The next letter looks good!  Now see if there are any other characters before the end of the line (excluding comments)
-				while (*p_t == ' ' || *p_t == '\t')
+				while (get_char(p_t, p_end) == ' ' || get_char(p_t, p_end) == '\t')
 				{
 					p_t++;
 				}
-				if (*p_t == ';' || *p_t == '\0')
+				if (get_char(p_t, p_end) == ';' || get_char(p_t, p_end) == '\0')
 					found_command = true;
 			}
 			else if (t_param >= '0' && t_param <= '9')
@@ -376,17 +506,17 @@ bool gcode_parser::try_extract_gcode_command(char ** p_p_gcode, std::string * p_
 	return found_command;
 }
 
-bool gcode_parser::try_extract_at_command(char ** p_p_gcode, std::string * p_command)
+bool gcode_parser::try_extract_at_command(char ** p_p_gcode, const char * p_end, std::string * p_command)
 {
 	char *p = *p_p_gcode;
 	bool found_command = false;
-	while (*p != '\0' && *p != ';' && *p!= ' ')
+	while (get_char(p, p_end) != '\0' && get_char(p, p_end) != ';' && get_char(p, p_end)!= ' ')
 	{
 		if (!found_command)
 		{
 			found_command = true;
 		}
-		if (*p >= 'a' && *p <= 'z')
+		if (get_char(p, p_end) >= 'a' && get_char(p, p_end) <= 'z')
 			(*p_command).push_back(*p++ - 32);
 		else
 			(*p_command).push_back(*p++);
@@ -397,16 +527,16 @@ bool gcode_parser::try_extract_at_command(char ** p_p_gcode, std::string * p_com
 
 }
 
-bool gcode_parser::try_extract_unsigned_long(char ** p_p_gcode, unsigned long * p_value) {
+bool gcode_parser::try_extract_unsigned_long(char ** p_p_gcode, const char * p_end, unsigned long * p_value) {
 	char * p = *p_p_gcode;
 	unsigned int r = 0;
 	bool found_numbers = false;
 	// skip any leading whitespace
-	while (*p == ' ')
+	while (get_char(p, p_end) == ' ')
 		++p;
 
-	while ((*p >= '0' && *p <= '9') || *p == ' ') {
-		if (*p != ' ')
+	while ((get_char(p, p_end) >= '0' && get_char(p, p_end) <= '9') || get_char(p, p_end) == ' ') {
+		if (get_char(p, p_end) != ' ')
 		{
 			found_numbers = true;
 			r = static_cast<unsigned int>((r * 10.0) + (*p - '0'));
@@ -433,45 +563,103 @@ double gcode_parser::ten_pow(unsigned short n) {
 	return r;
 }
 
-bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double) const
+bool gcode_parser::try_extract_double(char ** p_p_gcode, const char * p_end, double * p_double)
+{
+	char * p = *p_p_gcode;
+	bool neg = false;
+	// skip any leading whitespace
+	while (get_char(p, p_end) == ' ')
+		++p;
+	// Check for a sign
+	if (get_char(p, p_end) == '-' || get_char(p, p_end) == '+') {
+		neg = *p == '-';
+		++p;
+		while (get_char(p, p_end) == ' ')
+			++p;
+	}
+	// The reference accepts spaces within the number, and too many digits can't be converted exactly here.  Hand
+	// those over to the reference.
+	uint64_t integer_part;
+	const unsigned int integer_digits = read_digit_run(p, p_end, GCODE_PARSER_MAX_FAST_DIGITS, integer_part);
+	if (integer_digits > GCODE_PARSER_MAX_FAST_DIGITS)
+		return try_extract_double_reference(p_p_gcode, p_end, p_double);
+	p += integer_digits;
+	if (get_char(p, p_end) == ' ')
+	{
+		while (get_char(p, p_end) == ' ')
+			++p;
+		if (is_digit(get_char(p, p_end)))
+			return try_extract_double_reference(p_p_gcode, p_end, p_double);
+	}
+	double r = static_cast<double>(integer_part);
+	unsigned int fraction_digits = 0;
+	if (get_char(p, p_end) == '.')
+	{
+		++p;
+		uint64_t fraction_part;
+		fraction_digits = read_digit_run(p, p_end, GCODE_PARSER_MAX_FAST_DIGITS, fraction_part);
+		if (fraction_digits > GCODE_PARSER_MAX_FAST_DIGITS)
+			return try_extract_double_reference(p_p_gcode, p_end, p_double);
+		p += fraction_digits;
+		if (get_char(p, p_end) == ' ')
+		{
+			while (get_char(p, p_end) == ' ')
+				++p;
+			if (is_digit(get_char(p, p_end)))
+				return try_extract_double_reference(p_p_gcode, p_end, p_double);
+		}
+		// Both parts are exact, so this rounds exactly like the reference.
+		r += static_cast<double>(fraction_part) / exact_powers_of_ten[fraction_digits];
+	}
+	if (integer_digits == 0 && fraction_digits == 0)
+		return false;
+	if (neg) {
+		r = -r;
+	}
+	*p_double = r;
+	*p_p_gcode = p;
+	return true;
+}
+
+bool gcode_parser::try_extract_double_reference(char ** p_p_gcode, const char * p_end, double * p_double)
 {
 	char * p = *p_p_gcode;
 	bool neg = false;
 	double r = 0;
 	bool found_numbers = false;
 	// skip any leading whitespace
-	while (*p == ' ')
+	while (get_char(p, p_end) == ' ')
 		++p;
 	// Check for negative sign
-	if (*p == '-') {
+	if (get_char(p, p_end) == '-') {
 		neg = true;
 		++p;
-		while (*p == ' ')
+		while (get_char(p, p_end) == ' ')
 			++p;
 	}
-	else if (*p == '+') {
+	else if (get_char(p, p_end) == '+') {
 		// Positive sign doesn't affect anything since we assume positive
 		++p;
-		while (*p == ' ')
+		while (get_char(p, p_end) == ' ')
 			++p;
 	}
 	// skip any additional whitespace
 	
 
-	while ((*p >= '0' && *p <= '9') || *p == ' ') {
-		if (*p != ' ')
+	while ((get_char(p, p_end) >= '0' && get_char(p, p_end) <= '9') || get_char(p, p_end) == ' ') {
+		if (get_char(p, p_end) != ' ')
 		{
 			found_numbers = true;
 			r = (r*10.0) + (*p - '0');
 		}
 		++p;
 	}
-	if (*p == '.') {
+	if (get_char(p, p_end) == '.') {
 		double f = 0.0;
 		unsigned short n = 0;
 		++p;
-		while ((*p >= '0' && *p <= '9') || *p == ' ') {
-			if (*p != ' ')
+		while ((get_char(p, p_end) >= '0' && get_char(p, p_end) <= '9') || get_char(p, p_end) == ' ') {
+			if (get_char(p, p_end) != ' ')
 			{
 				found_numbers = true;
 				f = (f*10.0) + (*p - '0');
@@ -494,20 +682,20 @@ bool gcode_parser::try_extract_double(char ** p_p_gcode, double * p_double) cons
 	return found_numbers;
 }
 
-bool gcode_parser::try_extract_text_parameter(char ** p_p_gcode, std::string * p_parameter)
+bool gcode_parser::try_extract_text_parameter(char ** p_p_gcode, const char * p_end, std::string * p_parameter)
 {
 	// Skip initial whitespace
 	//std::cout << "GcodeParser.try_extract_parameter - Trying to extract a text parameter from  " << *p_p_gcode << "\r\n";
 	char * p = *p_p_gcode;
 	
 	// Ignore Leading Spaces
-	while (*p == ' ')
+	while (get_char(p, p_end) == ' ')
 	{
 		p++;
 	}
 	// Add all values, stop at end of string or when we hit a ';'
 
-	while (*p != '\0' && *p != ';')
+	while (get_char(p, p_end) != '\0' && get_char(p, p_end) != ';')
 	{
 		(*p_parameter).push_back(*p++);
 	}
@@ -516,46 +704,48 @@ bool gcode_parser::try_extract_text_parameter(char ** p_p_gcode, std::string * p
 
 }
 
-bool gcode_parser::try_extract_octolapse_parameter(char ** p_p_gcode, parsed_command_parameter * p_parameter)
+bool gcode_parser::try_extract_octolapse_parameter(char ** p_p_gcode, const char * p_end, parsed_command_parameter * p_parameter)
 {
-	p_parameter->name = "";
+	// @OCTOLAPSE parameters have no letter, their name is stored in the string value.
+	p_parameter->name = '\0';
 	p_parameter->value_type = 'N';
+	p_parameter->string_value.clear();
 	// Skip initial whitespace
 	//std::cout << "GcodeParser.try_extract_parameter - Trying to extract a text parameter from  " << *p_p_gcode << "\r\n";
 	char * p = *p_p_gcode;
 	bool has_found_parameter = false;
 	// Ignore Leading Spaces
-	while (*p == ' ')
+	while (get_char(p, p_end) == ' ')
 	{
 		p++;
 	}
-	// extract name, make all caps.
-	while (*p != '\0' && *p != ';' && *p != ' ')
+	// extract name, make all caps.  Stop at any whitespace or control character (\r for example).
+	while (get_char(p, p_end) > ' ' && get_char(p, p_end) != ';')
 	{
 		if (!has_found_parameter)
 		{
 			has_found_parameter = true;
 		}
 
-		if (*p >= 'a' && *p <= 'z')
+		if (get_char(p, p_end) >= 'a' && get_char(p, p_end) <= 'z')
 		{
-			p_parameter->name.push_back(*p++ - 32);
+			p_parameter->string_value.push_back(*p++ - 32);
 		}
 		else
 		{
-			p_parameter->name.push_back(*p++);
+			p_parameter->string_value.push_back(*p++);
 		}
 	}
 	// Todo: Handle any otolapse commands require a string parameter
 	/*
 	// Ignore spaces after the command name
-	while (*p == ' ')
+	while (get_char(p, p_end) == ' ')
 	{
 		p++;
 	}
 	// Extract the value (we may do this per command in the future).  This will output mixed case.
 	bool has_parameter_value = false;
-	while (*p != '\0' && *p != ';')
+	while (get_char(p, p_end) != '\0' && get_char(p, p_end) != ';')
 	{
 		if (!has_parameter_value)
 		{
@@ -573,34 +763,34 @@ bool gcode_parser::try_extract_octolapse_parameter(char ** p_p_gcode, parsed_com
 	return has_found_parameter;
 }
 
-bool gcode_parser::try_extract_parameter(char ** p_p_gcode, parsed_command_parameter * parameter) const
+bool gcode_parser::try_extract_parameter(char ** p_p_gcode, const char * p_end, parsed_command_parameter * parameter) const
 {
 	//std::cout << "GcodeParser.try_extract_parameter - Trying to extract a parameter from  " << *p_p_gcode << "\r\n";
 	char * p = *p_p_gcode;
 
 	// Ignore Leading Spaces
-	while (*p == ' ')
+	while (get_char(p, p_end) == ' ')
 	{
 		p++;
 	}
 	
 	// Deal with case sensitivity
-	if (*p >= 'a' && *p <= 'z')
+	if (get_char(p, p_end) >= 'a' && get_char(p, p_end) <= 'z')
 		parameter->name = *p++ - 32;
-	else if (*p >= 'A' && *p <= 'Z')
+	else if (get_char(p, p_end) >= 'A' && get_char(p, p_end) <= 'Z')
 		parameter->name = *p++;
 	else
 		return false;
 	// TODO:  See if unsigned long works....
 
 	// Add all values, stop at end of string or when we hit a ';'
-	if (try_extract_double(&p,&(parameter->double_value)))
+	if (try_extract_double(&p, p_end, &(parameter->double_value)))
 	{
 		parameter->value_type = 'F';
 	}
 	else
 	{
-		if(try_extract_text_parameter(&p, &(parameter->string_value)))
+		if(try_extract_text_parameter(&p, p_end, &(parameter->string_value)))
 		{
 			parameter->value_type = 'S';
 		}
@@ -615,30 +805,30 @@ bool gcode_parser::try_extract_parameter(char ** p_p_gcode, parsed_command_param
 
 }
 
-bool gcode_parser::try_extract_t_parameter(char ** p_p_gcode, parsed_command_parameter * parameter)
+bool gcode_parser::try_extract_t_parameter(char ** p_p_gcode, const char * p_end, parsed_command_parameter * parameter)
 {
 	//std::cout << "Trying to extract a T parameter from " << *p_p_gcode << "\r\n";
 	char * p = *p_p_gcode;
 	parameter->name = 'T';
 	// Ignore Leading Spaces
-	while (*p == L' ')
+	while (get_char(p, p_end) == L' ')
 	{
 		p++;
 	}
 
-	if (*p == L'c' || *p == L'C')
+	if (get_char(p, p_end) == L'c' || get_char(p, p_end) == L'C')
 	{
 		//std::cout << "Found C value for T parameter\r\n";
 		parameter->string_value = "C";
 		parameter->value_type = 'S';
 	}
-	else if (*p == L'x' || *p == L'X')
+	else if (get_char(p, p_end) == L'x' || get_char(p, p_end) == L'X')
 	{
 		//std::cout << "Found X value for T parameter\r\n";
 		parameter->string_value = "X";
 		parameter->value_type = 'S';
 	}
-	else if (*p == L'?')
+	else if (get_char(p, p_end) == L'?')
 	{
 		//std::cout << "Found ? value for T parameter\r\n";
 		parameter->string_value = "?";
@@ -647,10 +837,9 @@ bool gcode_parser::try_extract_t_parameter(char ** p_p_gcode, parsed_command_par
 	else
 	{
 		//std::cout << "No char t parameter found, looking for unsigned int values.\r\n";
-		if(!try_extract_unsigned_long(&p,&(parameter->unsigned_long_value)))
+		if(!try_extract_unsigned_long(&p, p_end, &(parameter->unsigned_long_value)))
 		{
-			std::string message = "GcodeParser.try_extract_t_parameter: Unable to extract parameters from the T command.";
-			octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::WARNING, message);
+			OCTOLAPSE_LOG(octolapse_log::GCODE_PARSER, octolapse_log::WARNING, "GcodeParser.try_extract_t_parameter: Unable to extract parameters from the T command.");
 			//std::cout << "No parameter for the T command.\r\n";
 			return false;
 		}
@@ -659,26 +848,20 @@ bool gcode_parser::try_extract_t_parameter(char ** p_p_gcode, parsed_command_par
 	return true;
 }
 
-bool gcode_parser::try_extract_comment(char ** p_p_gcode, std::string * p_comment)
+bool gcode_parser::try_extract_comment(char ** p_p_gcode, const char * p_end, std::string * p_comment)
 {
 	// Skip initial whitespace
 	//std::cout << "GcodeParser.try_extract_parameter - Trying to extract a text parameter from  " << *p_p_gcode << "\r\n";
-	char * p = *p_p_gcode;
-
-	// Ignore Leading Spaces
-	while (*p != '\0' && *p != ';')
-	{
-		p++;
-	}
+	char * p = const_cast<char *>(find_comment_start(*p_p_gcode, p_end));
 
 	// Add all values, stop at end of string or when we hit a ';'
-	while (*p == ';' || *p == ' ')
+	while (get_char(p, p_end) == ';' || get_char(p, p_end) == ' ')
 	{
 		p++;
 	}
-	while (*p != '\0')
+	while (get_char(p, p_end) != '\0')
 	{
-		if (*p != '\r' && *p != '\n')
+		if (get_char(p, p_end) != '\r' && get_char(p, p_end) != '\n')
 			(*p_comment).push_back(*p++);
 		else
 			p++;
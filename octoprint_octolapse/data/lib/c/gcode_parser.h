@@ -35,22 +35,42 @@ public:
 	gcode_parser();
 	~gcode_parser();
 	bool try_parse_gcode(const char * gcode, parsed_command & command);
+	/**
+	 * \brief Parses gcode that is not null terminated, for example a line within a memory mapped file.
+	 * \param gcode A pointer to the first character of the gcode.
+	 * \param length The number of characters to parse.  Parsing also stops at any null terminator.
+	 * \param command Receives the parsed command.
+	 * \return true if a known command was found.
+	 */
+	bool try_parse_gcode(const char * gcode, size_t length, parsed_command & command);
 	parsed_command parse_gcode(const char * gcode);
+	parsed_command parse_gcode(const char * gcode, size_t length);
+	/**
+	 * \brief Extracts a number, using a fast path for plain digit runs like X123.456 and falling back to
+	 * try_extract_double_reference for anything else.  The results are bit identical to the reference.
+	 */
+	static bool try_extract_double(char ** p_p_gcode, const char * p_end, double * p_double);
+	/**
+	 * \brief The original digit by digit number extraction.  It accepts embedded spaces (X1 2.3) and any number of digits.
+	 */
+	static bool try_extract_double_reference(char ** p_p_gcode, const char * p_end, double * p_double);
 private:
 	gcode_parser(const gcode_parser &source);
 	// Variables and lookups
-	std::set<std::string> text_only_functions_;
-	std::set<std::string> parsable_commands_;
+	// Shared by every parser.  It is built once and never changes, so parsers may be used from any thread.
+	const std::set<std::string>& text_only_functions_;
+	static const std::set<std::string>& get_text_only_functions();
 	// Functions
-	bool try_extract_double(char ** p_p_gcode, double * p_double) const;
-	static bool try_extract_gcode_command(char ** p_p_gcode, std::string * p_command);
-	static bool try_extract_text_parameter(char ** p_p_gcode, std::string * p_parameter);
-	bool try_extract_parameter(char ** p_p_gcode, parsed_command_parameter * parameter) const;
-	static bool try_extract_t_parameter(char ** p_p_gcode, parsed_command_parameter * parameter);
-	static bool try_extract_unsigned_long(char ** p_p_gcode, unsigned long * p_value);
+	static gcode_opcode get_gcode_opcode(const std::string& command);
+	void try_extract_parameters(char ** p_p_gcode, const char * p_end, parsed_command & command) const;
+	static bool try_extract_gcode_command(char ** p_p_gcode, const char * p_end, std::string * p_command);
+	static bool try_extract_text_parameter(char ** p_p_gcode, const char * p_end, std::string * p_parameter);
+	bool try_extract_parameter(char ** p_p_gcode, const char * p_end, parsed_command_parameter * parameter) const;
+	static bool try_extract_t_parameter(char ** p_p_gcode, const char * p_end, parsed_command_parameter * parameter);
+	static bool try_extract_unsigned_long(char ** p_p_gcode, const char * p_end, unsigned long * p_value);
 	double static ten_pow(unsigned short n);
-	bool try_extract_comment(char ** p_p_gcode, std::string * p_comment);
-	static bool try_extract_at_command(char ** p_p_gcode, std::string * p_command);
-	bool try_extract_octolapse_parameter(char ** p_p_gcode, parsed_command_parameter * p_parameter);
+	bool try_extract_comment(char ** p_p_gcode, const char * p_end, std::string * p_comment);
+	static bool try_extract_at_command(char ** p_p_gcode, const char * p_end, std::string * p_command);
+	bool try_extract_octolapse_parameter(char ** p_p_gcode, const char * p_end, parsed_command_parameter * p_parameter);
 };
 #endif
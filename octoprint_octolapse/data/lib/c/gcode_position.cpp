@@ -40,6 +40,7 @@ gcode_position_args::gcode_position_args(const gcode_position_args &pos_args)
 	minimum_layer_height = pos_args.minimum_layer_height;
 	height_increment = pos_args.height_increment;
 	g90_influences_extruder = pos_args.g90_influences_extruder;
+	lock_slicer_from_header = pos_args.lock_slicer_from_header;
 	xyz_axis_default_mode = pos_args.xyz_axis_default_mode;
 	e_axis_default_mode = pos_args.e_axis_default_mode;
 	units_default = pos_args.units_default;
@@ -60,6 +61,7 @@ gcode_position_args::gcode_position_args(const gcode_position_args &pos_args)
 	default_extruder = pos_args.default_extruder;
 	zero_based_extruder = pos_args.zero_based_extruder;
 	num_extruders = pos_args.num_extruders;
+	tracking_mask = pos_args.tracking_mask;
 	retraction_lengths = NULL;
 	z_lift_heights = NULL;
 	x_firmware_offsets = NULL;
@@ -100,6 +102,7 @@ gcode_position_args& gcode_position_args::operator=(const gcode_position_args& p
 	minimum_layer_height = pos_args.minimum_layer_height;
 	height_increment = pos_args.height_increment;
 	g90_influences_extruder = pos_args.g90_influences_extruder;
+	lock_slicer_from_header = pos_args.lock_slicer_from_header;
 	xyz_axis_default_mode = pos_args.xyz_axis_default_mode;
 	e_axis_default_mode = pos_args.e_axis_default_mode;
 	units_default = pos_args.units_default;
@@ -120,6 +123,7 @@ gcode_position_args& gcode_position_args::operator=(const gcode_position_args& p
 	default_extruder = pos_args.default_extruder;
 	zero_based_extruder = pos_args.zero_based_extruder;
 	num_extruders = pos_args.num_extruders;
+	tracking_mask = pos_args.tracking_mask;
 	delete_retraction_lengths();
 	delete_x_firmware_offsets();
 	delete_y_firmware_offsets();
@@ -202,10 +206,61 @@ void gcode_position_args::delete_y_firmware_offsets()
 	}
 }
 
+void gcode_position_args::serialize(binary_writer& writer) const
+{
+	writer.write_bool(autodetect_position);
+	writer.write_bool(is_circular_bed);
+	writer.write_double(home_x);
+	writer.write_double(home_y);
+	writer.write_double(home_z);
+	writer.write_bool(home_x_none);
+	writer.write_bool(home_y_none);
+	writer.write_bool(home_z_none);
+	writer.write_double(priming_height);
+	writer.write_double(minimum_layer_height);
+	writer.write_double(height_increment);
+	writer.write_bool(g90_influences_extruder);
+	writer.write_bool(lock_slicer_from_header);
+	writer.write_bool(is_bound_);
+	writer.write_double(snapshot_x_min);
+	writer.write_double(snapshot_x_max);
+	writer.write_double(snapshot_y_min);
+	writer.write_double(snapshot_y_max);
+	writer.write_double(snapshot_z_min);
+	writer.write_double(snapshot_z_max);
+	writer.write_double(x_min);
+	writer.write_double(x_max);
+	writer.write_double(y_min);
+	writer.write_double(y_max);
+	writer.write_double(z_min);
+	writer.write_double(z_max);
+	writer.write_bool(shared_extruder);
+	writer.write_bool(zero_based_extruder);
+	writer.write_int(num_extruders);
+	writer.write_int(default_extruder);
+	writer.write_int(tracking_mask);
+	writer.write_string(xyz_axis_default_mode);
+	writer.write_string(e_axis_default_mode);
+	writer.write_string(units_default);
+	for (int index = 0; index < num_extruders; index++)
+	{
+		writer.write_double(retraction_lengths[index]);
+		writer.write_double(z_lift_heights[index]);
+		writer.write_double(x_firmware_offsets[index]);
+		writer.write_double(y_firmware_offsets[index]);
+	}
+	writer.write_int(static_cast<int>(location_detection_commands.size()));
+	for (unsigned int index = 0; index < location_detection_commands.size(); index++)
+	{
+		writer.write_string(location_detection_commands[index]);
+	}
+}
+
 gcode_position::gcode_position()
 {
 
 	autodetect_position_ = false;
+	p_processing_stats_ = NULL;
 	home_x_ = 0;
 	home_y_ = 0;
 	home_z_ = 0;
@@ -224,7 +279,7 @@ gcode_position::gcode_position()
 	e_axis_default_mode_ = "absolute";
 	xyz_axis_default_mode_ = "absolute";
 	units_default_ = "millimeters";
-	gcode_functions_ = get_gcode_functions();
+	init_gcode_functions();
 
 	is_bound_ = false;
 	snapshot_x_min_ = 0;
@@ -241,6 +296,8 @@ gcode_position::gcode_position()
 	z_min_ = 0;
 	z_max_ = 0;
 	is_circular_bed_ = false;
+	tracking_mask_ = position_tracking_all;
+	is_tracking_comments_ = true;
 
 	cur_pos_ = 0;
 	
@@ -252,12 +309,14 @@ gcode_position::gcode_position()
 		initial_pos.set_units_default(units_default_);
 		add_position(initial_pos);
 	}
+	select_update_function();
 }
 
 
 gcode_position::gcode_position(gcode_position_args args)
 {
 	autodetect_position_ = args.autodetect_position;
+	p_processing_stats_ = NULL;
 	home_x_ = args.home_x;
 	home_y_ = args.home_y;
 	home_z_ = args.home_z;
@@ -302,10 +361,11 @@ gcode_position::gcode_position(gcode_position_args args)
 	minimum_layer_height_ = args.minimum_layer_height;
 	height_increment_ = args.height_increment;
 	g90_influences_extruder_ = args.g90_influences_extruder;
+	comment_processor_.set_lock_slicer_from_header(args.lock_slicer_from_header);
 	e_axis_default_mode_ = args.e_axis_default_mode;
 	xyz_axis_default_mode_ = args.xyz_axis_default_mode;
 	units_default_ = args.units_default;
-	gcode_functions_ = get_gcode_functions();
+	init_gcode_functions();
 
 	is_bound_ = args.is_bound_;
 	snapshot_x_min_ = args.snapshot_x_min;
@@ -324,6 +384,18 @@ gcode_position::gcode_position(gcode_position_args args)
 
 	is_circular_bed_ = args.is_circular_bed;
 
+	// Add the parts that the requested ones are built on.
+	tracking_mask_ = args.tracking_mask;
+	if ((tracking_mask_ & position_tracking_height_increment) != 0)
+		tracking_mask_ |= position_tracking_layers;
+	if ((tracking_mask_ & position_tracking_layers) != 0)
+		tracking_mask_ |= position_tracking_extruder_state;
+	is_tracking_comments_ = (tracking_mask_ & position_tracking_comments) != 0;
+	if ((tracking_mask_ & position_tracking_bounds) == 0)
+		is_bound_ = false;
+	if ((tracking_mask_ & position_tracking_height_increment) == 0)
+		height_increment_ = 0;
+
 	cur_pos_ = -1;
 	num_extruders_ = args.num_extruders;
 
@@ -333,16 +405,17 @@ gcode_position::gcode_position(gcode_position_args args)
 	initial_pos.set_e_axis_mode(e_axis_default_mode_);
 	initial_pos.set_units_default(units_default_);
 	initial_pos.current_tool = current_extruder;
-	for (int index = 0; index < args.num_extruders; index++)
+	for (int index = 0; index < initial_pos.num_extruders; index++)
 	{
-		initial_pos.p_extruders[index].x_firmware_offset = args.x_firmware_offsets[index];
-		initial_pos.p_extruders[index].y_firmware_offset = args.y_firmware_offsets[index];
+		initial_pos.extruders[index].x_firmware_offset = args.x_firmware_offsets[index];
+		initial_pos.extruders[index].y_firmware_offset = args.y_firmware_offsets[index];
 	}
 
 	for (int index = 0; index < NUM_POSITIONS; index++)
 	{
 		add_position(initial_pos);
 	}
+	select_update_function();
 }
 
 gcode_position::gcode_position(const gcode_position &source)
@@ -400,12 +473,23 @@ void gcode_position::add_position(parsed_command& cmd)
 {
 	const int prev_pos = cur_pos_;
 	cur_pos_ = (++cur_pos_) % NUM_POSITIONS;
-	positions_[cur_pos_] = positions_[prev_pos];
+	// Copy the previous state, but not the previous command since we are about to replace it.
+	positions_[cur_pos_].copy_state(positions_[prev_pos]);
 	positions_[cur_pos_].reset_state();
 	positions_[cur_pos_].command = cmd;
 	positions_[cur_pos_].is_empty = false;
 }
 
+position * gcode_position::get_next_position_ptr()
+{
+	return &positions_[(cur_pos_ + 1) % NUM_POSITIONS];
+}
+
+void gcode_position::advance_position()
+{
+	cur_pos_ = (cur_pos_ + 1) % NUM_POSITIONS;
+}
+
 position gcode_position::get_current_position() const
 {
 	return positions_[cur_pos_];
@@ -427,13 +511,72 @@ position * gcode_position::get_previous_position_ptr()
 	return &positions_[(cur_pos_ - 1 + NUM_POSITIONS) % NUM_POSITIONS];
 }
 
+// With a single extruder every tool index maps to the first extruder, which is what position::get_extruder returns.
+template <bool is_single_extruder>
+inline static extruder& get_tracked_extruder(position* pos, const int index)
+{
+	if (is_single_extruder)
+		return pos->extruders[0];
+	return pos->get_extruder(index);
+}
+
+void gcode_position::clear_untracked_state(position* p_pos) const
+{
+	// The feature tag is reset with the rest of the per command state, see position::reset_state.
+	if ((tracking_mask_ & position_tracking_bounds) == 0)
+		p_pos->is_in_bounds = true;
+	if ((tracking_mask_ & position_tracking_extruder_state) == 0)
+	{
+		for (int index = 0; index < p_pos->num_extruders; index++)
+		{
+			extruder& current_extruder = p_pos->get_extruder(index);
+			current_extruder.extrusion_length = 0;
+			current_extruder.retraction_length = 0;
+			current_extruder.deretraction_length = 0;
+			current_extruder.is_extruding_start = false;
+			current_extruder.is_extruding = false;
+			current_extruder.is_primed = false;
+			current_extruder.is_retracting_start = false;
+			current_extruder.is_retracting = false;
+			current_extruder.is_retracted = false;
+			current_extruder.is_partially_retracted = false;
+			current_extruder.is_deretracting_start = false;
+			current_extruder.is_deretracting = false;
+			current_extruder.is_deretracted = false;
+		}
+	}
+	if ((tracking_mask_ & position_tracking_layers) == 0)
+	{
+		p_pos->is_printer_primed = false;
+		p_pos->last_extrusion_height = 0;
+		p_pos->last_extrusion_height_null = true;
+		p_pos->layer = 0;
+		p_pos->height = 0;
+		p_pos->is_zhop = false;
+	}
+	if ((tracking_mask_ & position_tracking_height_increment) == 0)
+	{
+		p_pos->height_increment = 0;
+		p_pos->height_increment_change_count = 0;
+	}
+}
+
+int gcode_position::get_tracking_mask() const
+{
+	return tracking_mask_;
+}
+
 void gcode_position::update(parsed_command& command, const long file_line_number, const long gcode_number, const long file_position)
 {
 	
 	if (command.is_empty)
 	{
 		// process any comment sections
-		comment_processor_.update(command.comment);
+		if (is_tracking_comments_)
+		{
+			processing_stage_timer timer(p_processing_stats_, processing_stage_comment_processing);
+			comment_processor_.update(command.comment);
+		}
 		return;
 	}
 	
@@ -443,22 +586,45 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 	p_current_pos->file_line_number = file_line_number;
 	p_current_pos->gcode_number = gcode_number;
 	p_current_pos->file_position = file_position;
-	comment_processor_.update(*p_current_pos);
+	if (tracking_mask_ != position_tracking_all)
+		clear_untracked_state(p_current_pos);
+	if (is_tracking_comments_)
+	{
+		processing_stage_timer timer(p_processing_stats_, processing_stage_comment_processing);
+		comment_processor_.update(*p_current_pos);
+	}
 
 	if (!command.is_known_command)
 		return;
 
-	// Does our function exist in our functions map?
-	gcode_functions_iterator_ = gcode_functions_.find(command.command);
+	(this->*update_function_)(p_current_pos, p_previous_pos, command);
+}
 
-	if (gcode_functions_iterator_ != gcode_functions_.end())
+template <bool is_single_extruder, bool is_bound, bool is_circular_bed, bool tracks_extruder_state, bool tracks_layers>
+void gcode_position::update_known_command(position* p_current_pos, position* p_previous_pos, parsed_command& command)
+{
+	// Does our command have a handler?
+	const pos_function_type func = gcode_functions_[command.opcode];
+
+	if (func != NULL)
 	{
 		p_current_pos->gcode_ignored = false;
-		// Execute the function to process this gcode
-		const pos_function_type func = gcode_functions_iterator_->second;
-		(this->*func)(p_current_pos, command);
+		// Execute the function to process this gcode.  G0/G1 are nearly every line, so call them directly.
+		if (command.opcode == gcode_opcode_g0 || command.opcode == gcode_opcode_g1)
+			process_g0_g1<is_single_extruder>(p_current_pos, command);
+		else
+			(this->*func)(p_current_pos, command);
+	}
+
+	// Only the command can change the tool, so the extruders can be looked up once.
+	extruder& current_extruder = get_tracked_extruder<is_single_extruder>(p_current_pos, p_current_pos->current_tool);
+	extruder& previous_tool_extruder = get_tracked_extruder<is_single_extruder>(p_previous_pos, p_current_pos->current_tool);
+	extruder& previous_extruder = get_tracked_extruder<is_single_extruder>(p_previous_pos, p_previous_pos->current_tool);
+
+	if (func != NULL)
+	{
 		// calculate z and e relative distances
-		p_current_pos->get_current_extruder().e_relative = (p_current_pos->get_current_extruder().e - p_previous_pos->get_extruder(p_current_pos->current_tool).e);
+		current_extruder.e_relative = (current_extruder.e - previous_tool_extruder.e);
 		p_current_pos->z_relative = (p_current_pos->z - p_previous_pos->z);
 		// Have the XYZ positions changed after processing a command ?
 
@@ -469,7 +635,7 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 		p_current_pos->has_position_changed = (
 			p_current_pos->has_xy_position_changed ||
 			!utilities::is_equal(p_current_pos->z, p_previous_pos->z) ||
-			!utilities::is_zero(p_current_pos->get_current_extruder().e_relative) ||
+			!utilities::is_zero(current_extruder.e_relative) ||
 			p_current_pos->x_null != p_previous_pos->x_null ||
 			p_current_pos->y_null != p_previous_pos->y_null ||
 			p_current_pos->z_null != p_previous_pos->z_null);
@@ -493,41 +659,45 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 
 	if (p_current_pos->has_position_changed)
 	{
-		p_current_pos->get_current_extruder().extrusion_length_total += p_current_pos->get_current_extruder().e_relative;
+		current_extruder.extrusion_length_total += current_extruder.e_relative;
 
-		if (
-			utilities::greater_than(p_current_pos->get_current_extruder().e_relative, 0) &&
+		if (!tracks_extruder_state)
+		{
+			// The extruder state is not tracked, and was cleared in update.
+		}
+		else if (
+			utilities::greater_than(current_extruder.e_relative, 0) &&
 			p_previous_pos->current_tool == p_current_pos->current_tool &&
 			// notice we can use the previous position's current extruder since we've made sure they are using the same tool
-			p_previous_pos->get_current_extruder().is_extruding &&
-			!p_previous_pos->get_current_extruder().is_extruding_start)
+			previous_extruder.is_extruding &&
+			!previous_extruder.is_extruding_start)
 		{
 			// A little shortcut if we know we were extruding (not starting extruding) in the previous command
 			// This lets us skip a lot of the calculations for the extruder, including the state calculation
-			p_current_pos->get_current_extruder().extrusion_length = p_current_pos->get_current_extruder().e_relative;
+			current_extruder.extrusion_length = current_extruder.e_relative;
 		}
 		else
 		{
 
 			// Update retraction_length and extrusion_length
-			p_current_pos->get_current_extruder().retraction_length = p_current_pos->get_current_extruder().retraction_length - p_current_pos->get_current_extruder().e_relative;
-			if (utilities::less_than_or_equal(p_current_pos->get_current_extruder().retraction_length, 0))
+			current_extruder.retraction_length = current_extruder.retraction_length - current_extruder.e_relative;
+			if (utilities::less_than_or_equal(current_extruder.retraction_length, 0))
 			{
 				// we can use the negative retraction length to calculate our extrusion length!
-				p_current_pos->get_current_extruder().extrusion_length = -1.0 * p_current_pos->get_current_extruder().retraction_length;
+				current_extruder.extrusion_length = -1.0 * current_extruder.retraction_length;
 				// set the retraction length to 0 since we are extruding
-				p_current_pos->get_current_extruder().retraction_length = 0;
+				current_extruder.retraction_length = 0;
 			}
 			else
-				p_current_pos->get_current_extruder().extrusion_length = 0;
+				current_extruder.extrusion_length = 0;
 
 			// calculate deretraction length
-			if (utilities::greater_than(p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length, p_current_pos->get_current_extruder().retraction_length))
+			if (utilities::greater_than(previous_tool_extruder.retraction_length, current_extruder.retraction_length))
 			{
-				p_current_pos->get_current_extruder().deretraction_length = p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length - p_current_pos->get_current_extruder().retraction_length;
+				current_extruder.deretraction_length = previous_tool_extruder.retraction_length - current_extruder.retraction_length;
 			}
 			else
-				p_current_pos->get_current_extruder().deretraction_length = 0;
+				current_extruder.deretraction_length = 0;
 
 			// *************Calculate extruder state*************
 			// rounding should all be done by now
@@ -536,26 +706,26 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				// On a toolchange some flags are not possible, so don't change them.
 				// these flags include like is_extruding, is_extruding_start, is_retracting_start, is_retracting, is_deretracting_start and is_deretracting
 				// Note that it's ok to use the previous pos current extruder since we've  made sure the current tool is identical
-				p_current_pos->get_current_extruder().is_extruding_start = utilities::greater_than(p_current_pos->get_current_extruder().extrusion_length, 0) && !p_previous_pos->get_current_extruder().is_extruding;
-				p_current_pos->get_current_extruder().is_extruding = utilities::greater_than(p_current_pos->get_current_extruder().extrusion_length, 0);
-				p_current_pos->get_current_extruder().is_retracting_start = !p_previous_pos->get_current_extruder().is_retracting && utilities::greater_than(p_current_pos->get_current_extruder().retraction_length, 0);
-				p_current_pos->get_current_extruder().is_retracting = utilities::greater_than(p_current_pos->get_current_extruder().retraction_length, p_previous_pos->get_current_extruder().retraction_length);
-				p_current_pos->get_current_extruder().is_deretracting = utilities::greater_than(p_current_pos->get_current_extruder().deretraction_length, p_previous_pos->get_current_extruder().deretraction_length);
-				p_current_pos->get_current_extruder().is_deretracting_start = utilities::greater_than(p_current_pos->get_current_extruder().deretraction_length, 0) && !p_previous_pos->get_current_extruder().is_deretracting;
+				current_extruder.is_extruding_start = utilities::greater_than(current_extruder.extrusion_length, 0) && !previous_extruder.is_extruding;
+				current_extruder.is_extruding = utilities::greater_than(current_extruder.extrusion_length, 0);
+				current_extruder.is_retracting_start = !previous_extruder.is_retracting && utilities::greater_than(current_extruder.retraction_length, 0);
+				current_extruder.is_retracting = utilities::greater_than(current_extruder.retraction_length, previous_extruder.retraction_length);
+				current_extruder.is_deretracting = utilities::greater_than(current_extruder.deretraction_length, previous_extruder.deretraction_length);
+				current_extruder.is_deretracting_start = utilities::greater_than(current_extruder.deretraction_length, 0) && !previous_extruder.is_deretracting;
 			}
 			else
 			{
-				p_current_pos->get_current_extruder().is_extruding_start = false;
-				p_current_pos->get_current_extruder().is_extruding = false;
-				p_current_pos->get_current_extruder().is_retracting_start = false;
-				p_current_pos->get_current_extruder().is_retracting = false;
-				p_current_pos->get_current_extruder().is_deretracting = false;
-				p_current_pos->get_current_extruder().is_deretracting_start = false;
+				current_extruder.is_extruding_start = false;
+				current_extruder.is_extruding = false;
+				current_extruder.is_retracting_start = false;
+				current_extruder.is_retracting = false;
+				current_extruder.is_deretracting = false;
+				current_extruder.is_deretracting_start = false;
 			}
-			p_current_pos->get_current_extruder().is_primed = utilities::is_zero(p_current_pos->get_current_extruder().extrusion_length) && utilities::is_zero(p_current_pos->get_current_extruder().retraction_length);
-			p_current_pos->get_current_extruder().is_partially_retracted = utilities::greater_than(p_current_pos->get_current_extruder().retraction_length, 0) && utilities::less_than(p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
-			p_current_pos->get_current_extruder().is_retracted = utilities::greater_than_or_equal(p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
-			p_current_pos->get_current_extruder().is_deretracted = utilities::greater_than(p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length, 0) && utilities::is_zero(p_current_pos->get_current_extruder().retraction_length);
+			current_extruder.is_primed = utilities::is_zero(current_extruder.extrusion_length) && utilities::is_zero(current_extruder.retraction_length);
+			current_extruder.is_partially_retracted = utilities::greater_than(current_extruder.retraction_length, 0) && utilities::less_than(current_extruder.retraction_length, retraction_lengths_[p_current_pos->current_tool]);
+			current_extruder.is_retracted = utilities::greater_than_or_equal(current_extruder.retraction_length, retraction_lengths_[p_current_pos->current_tool]);
+			current_extruder.is_deretracted = utilities::greater_than(previous_tool_extruder.retraction_length, 0) && utilities::is_zero(current_extruder.retraction_length);
 			// *************End Calculate extruder state*************
 		}
 
@@ -563,9 +733,9 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 		// TODO:  INCLUDE POSITION RESTRICTION CALCULATIONS!
 		// Set is_in_bounds_ to false if we're not in bounds, it will be true at this point
 		bool is_in_bounds = true;
-		if (is_bound_)
+		if (is_bound)
 		{
-			if (!is_circular_bed_)
+			if (!is_circular_bed)
 			{
 				is_in_bounds = !(
 					utilities::less_than(p_current_pos->x, snapshot_x_min_) ||
@@ -588,6 +758,9 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 			p_current_pos->is_in_bounds = is_in_bounds;
 		}
 
+		if (!tracks_layers)
+			return;
+
 		// calculate last_extrusion_height and height
 		// If we are extruding on a higher level, or if retract is enabled and the nozzle is primed
 		// adjust the last extrusion height
@@ -597,7 +770,7 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 			{
 				// detect layer changes/ printer priming/last extrusion height and height 
 				// Normally we would only want to use is_extruding, but we can also use is_deretracted if the layer is greater than 0
-				if (p_current_pos->get_current_extruder().is_extruding || (p_current_pos->layer >0 && p_current_pos->get_current_extruder().is_deretracted))
+				if (current_extruder.is_extruding || (p_current_pos->layer >0 && current_extruder.is_deretracted))
 				{
 					// Is Primed
 					if (!p_current_pos->is_printer_primed)
@@ -642,7 +815,7 @@ void gcode_position::update(parsed_command& command, const long file_line_number
 				}
 
 				// calculate is_zhop
-				if (p_current_pos->get_current_extruder().is_extruding || p_current_pos->z_null || p_current_pos->last_extrusion_height_null)
+				if (current_extruder.is_extruding || p_current_pos->z_null || p_current_pos->last_extrusion_height_null)
 					p_current_pos->is_zhop = false;
 				else
 					p_current_pos->is_zhop = utilities::greater_than_or_equal(p_current_pos->z - p_current_pos->last_extrusion_height, z_lift_heights_[p_current_pos->current_tool]);
@@ -661,29 +834,72 @@ void gcode_position::undo_update()
 }
 
 // Private Members
-std::map<std::string, gcode_position::pos_function_type> gcode_position::get_gcode_functions()
+void gcode_position::init_gcode_functions()
 {
-	std::map<std::string, pos_function_type> newMap;
-	newMap.insert(std::make_pair("G0", &gcode_position::process_g0_g1));
-	newMap.insert(std::make_pair("G1", &gcode_position::process_g0_g1));
-	newMap.insert(std::make_pair("G2", &gcode_position::process_g2));
-	newMap.insert(std::make_pair("G3", &gcode_position::process_g3));
-	newMap.insert(std::make_pair("G10", &gcode_position::process_g10));
-	newMap.insert(std::make_pair("G11", &gcode_position::process_g11));
-	newMap.insert(std::make_pair("G20", &gcode_position::process_g20));
-	newMap.insert(std::make_pair("G21", &gcode_position::process_g21));
-	newMap.insert(std::make_pair("G28", &gcode_position::process_g28));
-	newMap.insert(std::make_pair("G90", &gcode_position::process_g90));
-	newMap.insert(std::make_pair("G91", &gcode_position::process_g91));
-	newMap.insert(std::make_pair("G92", &gcode_position::process_g92));
-	newMap.insert(std::make_pair("M82", &gcode_position::process_m82));
-	newMap.insert(std::make_pair("M83", &gcode_position::process_m83));
-	newMap.insert(std::make_pair("M207", &gcode_position::process_m207));
-	newMap.insert(std::make_pair("M208", &gcode_position::process_m208));
-	newMap.insert(std::make_pair("M218", &gcode_position::process_m218));
-	newMap.insert(std::make_pair("M563", &gcode_position::process_m563));
-	newMap.insert(std::make_pair("T", &gcode_position::process_t));
-	return newMap;
+	for (int index = 0; index < NUM_GCODE_OPCODES; index++)
+	{
+		gcode_functions_[index] = NULL;
+	}
+	gcode_functions_[gcode_opcode_g0] = &gcode_position::process_g0_g1<false>;
+	gcode_functions_[gcode_opcode_g1] = &gcode_position::process_g0_g1<false>;
+	gcode_functions_[gcode_opcode_g2] = &gcode_position::process_g2;
+	gcode_functions_[gcode_opcode_g3] = &gcode_position::process_g3;
+	gcode_functions_[gcode_opcode_g10] = &gcode_position::process_g10;
+	gcode_functions_[gcode_opcode_g11] = &gcode_position::process_g11;
+	gcode_functions_[gcode_opcode_g20] = &gcode_position::process_g20;
+	gcode_functions_[gcode_opcode_g21] = &gcode_position::process_g21;
+	gcode_functions_[gcode_opcode_g28] = &gcode_position::process_g28;
+	gcode_functions_[gcode_opcode_g90] = &gcode_position::process_g90;
+	gcode_functions_[gcode_opcode_g91] = &gcode_position::process_g91;
+	gcode_functions_[gcode_opcode_g92] = &gcode_position::process_g92;
+	gcode_functions_[gcode_opcode_m82] = &gcode_position::process_m82;
+	gcode_functions_[gcode_opcode_m83] = &gcode_position::process_m83;
+	gcode_functions_[gcode_opcode_m207] = &gcode_position::process_m207;
+	gcode_functions_[gcode_opcode_m208] = &gcode_position::process_m208;
+	gcode_functions_[gcode_opcode_m218] = &gcode_position::process_m218;
+	gcode_functions_[gcode_opcode_m563] = &gcode_position::process_m563;
+	gcode_functions_[gcode_opcode_t] = &gcode_position::process_t;
+}
+
+void gcode_position::select_update_function()
+{
+	// Pick the variant of update_known_command built for this profile, so that the common single extruder and
+	// unbounded cases skip the extruder lookups and bounds checks.
+	const bool is_single_extruder = num_extruders_ <= 1;
+	if (is_single_extruder)
+	{
+		gcode_functions_[gcode_opcode_g0] = &gcode_position::process_g0_g1<true>;
+		gcode_functions_[gcode_opcode_g1] = &gcode_position::process_g0_g1<true>;
+		if (!is_bound_)
+			select_tracking_function<true, false, false>();
+		else if (!is_circular_bed_)
+			select_tracking_function<true, true, false>();
+		else
+			select_tracking_function<true, true, true>();
+	}
+	else
+	{
+		gcode_functions_[gcode_opcode_g0] = &gcode_position::process_g0_g1<false>;
+		gcode_functions_[gcode_opcode_g1] = &gcode_position::process_g0_g1<false>;
+		if (!is_bound_)
+			select_tracking_function<false, false, false>();
+		else if (!is_circular_bed_)
+			select_tracking_function<false, true, false>();
+		else
+			select_tracking_function<false, true, true>();
+	}
+}
+
+template <bool is_single_extruder, bool is_bound, bool is_circular_bed>
+void gcode_position::select_tracking_function()
+{
+	// The layers are only tracked along with the extruder state, see the constructor.
+	if ((tracking_mask_ & position_tracking_extruder_state) == 0)
+		update_function_ = &gcode_position::update_known_command<is_single_extruder, is_bound, is_circular_bed, false, false>;
+	else if ((tracking_mask_ & position_tracking_layers) == 0)
+		update_function_ = &gcode_position::update_known_command<is_single_extruder, is_bound, is_circular_bed, true, false>;
+	else
+		update_function_ = &gcode_position::update_known_command<is_single_extruder, is_bound, is_circular_bed, true, true>;
 }
 
 void gcode_position::update_position(
@@ -700,6 +916,25 @@ void gcode_position::update_position(
 	const bool update_f, 
 	const bool force, 
 	const bool is_g1_g0) const
+{
+	update_tracked_position<false>(pos, x, update_x, y, update_y, z, update_z, e, update_e, f, update_f, force, is_g1_g0);
+}
+
+template <bool is_single_extruder>
+void gcode_position::update_tracked_position(
+	position* pos,
+	const double x,
+	const bool update_x,
+	const double y,
+	const bool update_y,
+	const double z,
+	const bool update_z,
+	const double e,
+	const bool update_e,
+	const double f,
+	const bool update_f,
+	const bool force,
+	const bool is_g1_g0) const
 {
 	if (is_g1_g0)
 	{
@@ -741,7 +976,7 @@ void gcode_position::update_position(
 		}
 		// note that e cannot be null and starts at 0
 		if (update_e)
-			pos->get_current_extruder().e = e + pos->get_current_extruder().e_offset;
+			get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).e = e + get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).e_offset;
 		return;
 	}
 
@@ -754,7 +989,7 @@ void gcode_position::update_position(
 					pos->x = x + pos->x;
 				else
 				{
-					octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.update_position: Cannot update X because the XYZ axis mode is relative and X is null.");
+					OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.update_position: Cannot update X because the XYZ axis mode is relative and X is null.");
 				}
 			}
 			if (update_y)
@@ -763,7 +998,7 @@ void gcode_position::update_position(
 					pos->y = y + pos->y;
 				else
 				{
-					octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.update_position: Cannot update Y because the XYZ axis mode is relative and Y is null.");
+					OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.update_position: Cannot update Y because the XYZ axis mode is relative and Y is null.");
 				}
 			}
 			if (update_z)
@@ -772,7 +1007,7 @@ void gcode_position::update_position(
 					pos->z = z + pos->z;
 				else
 				{
-					octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.update_position: Cannot update Z because the XYZ axis mode is relative and Z is null.");
+					OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.update_position: Cannot update Z because the XYZ axis mode is relative and Z is null.");
 				}
 			}
 		}
@@ -781,19 +1016,19 @@ void gcode_position::update_position(
 
 			if (update_x)
 			{
-				pos->x_firmware_offset = pos->get_current_extruder().x_firmware_offset;
+				pos->x_firmware_offset = get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).x_firmware_offset;
 				pos->x = x + pos->x_offset - pos->x_firmware_offset;
 				pos->x_null = false;
 			}
 			if (update_y)
 			{
-				pos->y_firmware_offset = pos->get_current_extruder().y_firmware_offset;
+				pos->y_firmware_offset = get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).y_firmware_offset;
 				pos->y = y + pos->y_offset - pos->y_firmware_offset;
 				pos->y_null = false;
 			}
 			if (update_z)
 			{
-				pos->z_firmware_offset = pos->get_current_extruder().z_firmware_offset;
+				pos->z_firmware_offset = get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).z_firmware_offset;
 				pos->z = z + pos->z_offset - pos->z_firmware_offset;
 				pos->z_null = false;
 			}
@@ -801,8 +1036,7 @@ void gcode_position::update_position(
 	}
 	else
 	{
-		std::string message = "The XYZ axis mode is not set, cannot update position.";
-		octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
+		OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "The XYZ axis mode is not set, cannot update position.");
 	}
 
 	if (update_e)
@@ -811,22 +1045,22 @@ void gcode_position::update_position(
 		{
 			if (pos->is_extruder_relative)
 			{
-				pos->get_current_extruder().e = e + pos->get_current_extruder().e;
+				get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).e = e + get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).e;
 			}
 			else
 			{
-				pos->get_current_extruder().e = e + pos->get_current_extruder().e_offset;
+				get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).e = e + get_tracked_extruder<is_single_extruder>(pos, pos->current_tool).e_offset;
 			}
 		}
 		else
 		{
-			std::string message = "The E axis mode is not set, cannot update position.";
-			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
+			OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "The E axis mode is not set, cannot update position.");
 		}
 	}
 
 }
 
+template <bool is_single_extruder>
 void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
 {
 	bool update_x = false;
@@ -841,34 +1075,34 @@ void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
 	double f = 0;
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
-		const parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "X")
+		const parsed_command_parameter& p_cur_param = cmd.parameters[index];
+		if (p_cur_param.name == 'X')
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "E")
+		else if (p_cur_param.name == 'E')
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 		{
 			update_z = true;
 			z = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "F")
+		else if (p_cur_param.name == 'F')
 		{
 			update_f = true;
 			f = p_cur_param.double_value;
 		}
 	}
-	update_position(pos, x, update_x, y, update_y, z, update_z, e, update_e, f, update_f, false, true);
+	update_tracked_position<is_single_extruder>(pos, x, update_x, y, update_y, z, update_z, e, update_e, f, update_f, false, true);
 }
 
 void gcode_position::process_g2(position* pos, parsed_command& cmd)
@@ -883,23 +1117,23 @@ void gcode_position::process_g2(position* pos, parsed_command& cmd)
 	double f = 0;
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
-		const parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "X")
+		const parsed_command_parameter& p_cur_param = cmd.parameters[index];
+		if (p_cur_param.name == 'X')
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "E")
+		else if (p_cur_param.name == 'E')
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "F")
+		else if (p_cur_param.name == 'F')
 		{
 			update_f = true;
 			f = p_cur_param.double_value;
@@ -929,8 +1163,8 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 	// Handle extruder offset commands
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
-		parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "S")
+		const parsed_command_parameter& p_cur_param = cmd.parameters[index];
+		if (p_cur_param.name == 'S')
 		{
 			has_s = true;
 			if (p_cur_param.value_type == 'F')
@@ -938,7 +1172,7 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 			else
 				has_s = false;
 		}
-		else if (p_cur_param.name == "P")
+		else if (p_cur_param.name == 'P')
 		{
 			has_p = true;
 			if (p_cur_param.value_type == 'L')
@@ -954,7 +1188,7 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 			else
 				has_p = false;
 		}
-		else if (p_cur_param.name == "X")
+		else if (p_cur_param.name == 'X')
 		{
 			has_x = true;
 			if (p_cur_param.value_type == 'F')
@@ -962,7 +1196,7 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 			else
 				has_x = false;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			has_y = true;
 			if (p_cur_param.value_type == 'F')
@@ -970,7 +1204,7 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 			else
 				has_y = false;
 		}
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 		{
 			has_z = true;
 			if (p_cur_param.value_type == 'F')
@@ -990,12 +1224,12 @@ void gcode_position::process_g10(position* pos, parsed_command& cmd)
 		if (p < 0)
 		{
 			p = 0;
-			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_g10: Selected tool was less than 0.  Setting offset for tool index 0 instead.");
+			OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_g10: Selected tool was less than 0.  Setting offset for tool index 0 instead.");
 		}
 		else if (p > num_extruders_ - 1)
 		{
 			p = num_extruders_ - 1;
-			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_g10: Selected tool was greater than the number of configured tools.  Setting offset for the maximum tool index instead.");
+			OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_g10: Selected tool was greater than the number of configured tools.  Setting offset for the maximum tool index instead.");
 		}
 		if (has_x)
 			pos->get_extruder(p).x_firmware_offset = x;
@@ -1035,12 +1269,12 @@ void gcode_position::process_g28(position* pos, parsed_command& cmd)
 
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
-		parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "X")
+		const parsed_command_parameter& p_cur_param = cmd.parameters[index];
+		if (p_cur_param.name == 'X')
 			has_x = true;
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 			has_y = true;
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 			has_z = true;
 	}
 	if (has_x)
@@ -1139,28 +1373,28 @@ void gcode_position::process_g92(position* pos, parsed_command& cmd)
 	double e = 0;
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
-		parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "X")
+		const parsed_command_parameter& p_cur_param = cmd.parameters[index];
+		if (p_cur_param.name == 'X')
 		{
 			update_x = true;
 			x = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			update_y = true;
 			y = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "E")
+		else if (p_cur_param.name == 'E')
 		{
 			update_e = true;
 			e = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 		{
 			update_z = true;
 			z = p_cur_param.double_value;
 		}
-		else if (p_cur_param.name == "O")
+		else if (p_cur_param.name == 'O')
 		{
 			o_exists = true;
 		}
@@ -1271,9 +1505,9 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 	// Handle extruder offset commands
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
-		parsed_command_parameter p_cur_param = cmd.parameters[index];
+		const parsed_command_parameter& p_cur_param = cmd.parameters[index];
 		
-		if (p_cur_param.name == "T")
+		if (p_cur_param.name == 'T')
 		{
 			has_t = true;
 			if (p_cur_param.value_type == 'L')
@@ -1290,7 +1524,7 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 				has_t = false;
 
 		}
-		else if (p_cur_param.name == "X")
+		else if (p_cur_param.name == 'X')
 		{
 			has_x = true;
 			if (p_cur_param.value_type == 'F')
@@ -1298,7 +1532,7 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 			else
 				has_x = false;
 		}
-		else if (p_cur_param.name == "Y")
+		else if (p_cur_param.name == 'Y')
 		{
 			has_y = true;
 			if (p_cur_param.value_type == 'F')
@@ -1306,7 +1540,7 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 			else
 				has_y = false;
 		}
-		else if (p_cur_param.name == "Z")
+		else if (p_cur_param.name == 'Z')
 		{
 			has_z = true;
 			if (p_cur_param.value_type == 'F')
@@ -1326,12 +1560,12 @@ void gcode_position::process_m218(position* pos, parsed_command& cmd)
 		if (t < 0)
 		{
 			t = 0;
-			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_m218: Selected tool was less than 0.  Setting offset for tool index 0 instead.");
+			OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_m218: Selected tool was less than 0.  Setting offset for tool index 0 instead.");
 		}
 		else if (t > num_extruders_ - 1)
 		{
 			t = num_extruders_ - 1;
-			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_m218: Selected tool was greater than the number of configured tools.  Setting offset for the maximum tool index instead.");
+			OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_m218: Selected tool was greater than the number of configured tools.  Setting offset for the maximum tool index instead.");
 		}
 
 		if (has_x)
@@ -1353,10 +1587,10 @@ void gcode_position::process_t(position* pos, parsed_command& cmd)
 {
 	for (unsigned int index = 0; index < cmd.parameters.size(); index++)
 	{
-		parsed_command_parameter p_cur_param = cmd.parameters[index];
-		if (p_cur_param.name == "T" && p_cur_param.value_type == 'U')
+		const parsed_command_parameter& p_cur_param = cmd.parameters[index];
+		if (p_cur_param.name == 'T' && p_cur_param.value_type == 'U')
 		{
-			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::DEBUG, "GcodePosition.process_t: Tool change Detected.");
+			OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::DEBUG, "GcodePosition.process_t: Tool change Detected.");
 			pos->current_tool = static_cast<int>(p_cur_param.unsigned_long_value);
 			if (!zero_based_extruder_)
 			{
@@ -1365,12 +1599,12 @@ void gcode_position::process_t(position* pos, parsed_command& cmd)
 			if (pos->current_tool < 0)
 			{
 				pos->current_tool = 0;
-				octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_t: The tool index was less than 0.  Setting tool index to 0 instead.");
+				OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_t: The tool index was less than 0.  Setting tool index to 0 instead.");
 			}
 			else if (pos->current_tool > num_extruders_ - 1)
 			{
 				pos->current_tool = num_extruders_ - 1;
-				octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_t: The tool index was greater than the number of available tools.  Setting tool index to the max tool index instead.");
+				OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePosition.process_t: The tool index was greater than the number of available tools.  Setting tool index to the max tool index instead.");
 			}
 			
 			break;
@@ -1381,4 +1615,9 @@ void gcode_position::process_t(position* pos, parsed_command& cmd)
 gcode_comment_processor* gcode_position::get_gcode_comment_processor()
 {
 	return &comment_processor_;
+}
+
+void gcode_position::set_processing_stats(processing_stats* p_stats)
+{
+	p_processing_stats_ = p_stats;
 }
\ No newline at end of file
@@ -27,7 +27,21 @@
 #include "gcode_parser.h"
 #include "position.h"
 #include "gcode_comment_processor.h"
+#include "processing_stats.h"
 #define NUM_POSITIONS 10
+// The parts of the position that are tracked.  A consumer can turn off the ones it never reads, and the fields they
+// would update are cleared on every update (unknown feature, no layer, null last extrusion height, in bounds and no
+// extruder state), so they never hold values from an earlier position.  Height increments need the layers, and the
+// layers need the extruder state.
+enum position_tracking {
+	position_tracking_none = 0,
+	position_tracking_comments = 1,
+	position_tracking_bounds = 2,
+	position_tracking_extruder_state = 4,
+	position_tracking_layers = 8,
+	position_tracking_height_increment = 16,
+	position_tracking_all = 31
+};
 struct gcode_position_args {
 	gcode_position_args() {
 		// Wipe Variables
@@ -48,6 +62,7 @@ struct gcode_position_args {
 		minimum_layer_height = 0;
 		height_increment = 0;
 		g90_influences_extruder = false;
+		lock_slicer_from_header = false;
 		xyz_axis_default_mode = "absolute";
 		e_axis_default_mode = "absolute";
 		units_default = "millimeters";
@@ -67,6 +82,7 @@ struct gcode_position_args {
 		num_extruders = 1;
 		default_extruder = 0;
 		zero_based_extruder = true;
+		tracking_mask = position_tracking_all;
 		std::vector<std::string> location_detection_commands; // Final list of location detection commands
 		set_num_extruders(num_extruders);
 	}
@@ -95,6 +111,8 @@ struct gcode_position_args {
 	double minimum_layer_height;
 	double height_increment;
 	bool g90_influences_extruder;
+	// Take the slicer type from the file header instead of guessing it from the section comments
+	bool lock_slicer_from_header;
 	bool is_bound_;
 	double snapshot_x_min;
 	double snapshot_x_max;
@@ -112,12 +130,18 @@ struct gcode_position_args {
 	bool zero_based_extruder;
 	int num_extruders;
 	int default_extruder;
+	// The position_tracking flags for the parts of the position to track
+	int tracking_mask;
 	std::string xyz_axis_default_mode;
 	std::string e_axis_default_mode;
 	std::string units_default;
 	std::vector<std::string> location_detection_commands; // Final list of location detection commands
 	gcode_position_args& operator=(const gcode_position_args& pos_args);
 	void set_num_extruders(int num_extruders);
+	/**
+	 * \brief Writes every setting, so that the output can be used to tell whether two sets of args are the same.
+	 */
+	void serialize(binary_writer& writer) const;
 	void delete_retraction_lengths();
 	void delete_z_lift_heights();
 	void delete_x_firmware_offsets();
@@ -140,12 +164,36 @@ public:
 	position * get_current_position_ptr();
 	position * get_previous_position_ptr();
 	gcode_comment_processor* get_gcode_comment_processor();
+	/**
+	 * \brief Gets the slot that the next position will be stored in, so that it can be filled in directly, which is
+	 * how a position trace is replayed.  Call advance_position to make it current.
+	 */
+	position * get_next_position_ptr();
+	/**
+	 * \brief Makes the next position current without processing a command.  The current position becomes the
+	 * previous one.
+	 */
+	void advance_position();
+	/**
+	 * \brief Records the comment processing stage in the stats, which are not owned by the gcode_position.  Pass
+	 * NULL to stop recording.
+	 */
+	void set_processing_stats(processing_stats* p_stats);
+	/**
+	 * \brief Gets the position_tracking flags that are in effect, which include the ones the requested flags need.
+	 */
+	int get_tracking_mask() const;
 private:
 	gcode_position(const gcode_position &source);
 	position positions_[static_cast<int>(NUM_POSITIONS)];
 	int cur_pos_;
 	void add_position(parsed_command &);
 	void add_position(position &);
+	/**
+	 * \brief Clears the fields of the parts that aren't tracked.  They could otherwise carry values from a position that
+	 * was restored or set directly, rather than from the gcode.
+	 */
+	void clear_untracked_state(position* p_pos) const;
 	bool autodetect_position_;
 	double priming_height_;
 	double home_x_;
@@ -179,12 +227,31 @@ private:
 	int num_extruders_;
 	bool shared_extruder_;
 	bool zero_based_extruder_;
+	int tracking_mask_;
+	bool is_tracking_comments_;
 
-	std::map<std::string, pos_function_type> gcode_functions_;
-	std::map<std::string, pos_function_type>::iterator gcode_functions_iterator_;
+	// Gcode handlers indexed by the parsed command's opcode, NULL if the command has no handler.
+	pos_function_type gcode_functions_[NUM_GCODE_OPCODES];
+	typedef void(gcode_position::*update_function_type)(position*, position*, parsed_command&);
+	// The variant of update_known_command selected for the extruder count and bounds when constructed.
+	update_function_type update_function_;
 	
-	std::map<std::string, pos_function_type> get_gcode_functions();
+	void init_gcode_functions();
+	void select_update_function();
+	template <bool is_single_extruder, bool is_bound, bool is_circular_bed>
+	void select_tracking_function();
+	/**
+	 * \brief Processes a known command and updates the extruder, bounds, layer and zhop state.  With is_single_extruder
+	 * every extruder lookup goes straight to the first extruder, and the bounds checks are only compiled in when
+	 * is_bound is true.  The extruder state and layer tracking are left out unless tracks_extruder_state and
+	 * tracks_layers are set.
+	 */
+	template <bool is_single_extruder, bool is_bound, bool is_circular_bed, bool tracks_extruder_state, bool tracks_layers>
+	void update_known_command(position* p_current_pos, position* p_previous_pos, parsed_command& command);
+	template <bool is_single_extruder>
+	void update_tracked_position(position *position, double x, bool update_x, double y, bool update_y, double z, bool update_z, double e, bool update_e, double f, bool update_f, bool force, bool is_g1_g0) const;
 	/// Process Gcode Command Functions
+	template <bool is_single_extruder>
 	void process_g0_g1(position*, parsed_command&);
 	void process_g2(position*, parsed_command&);
 	void process_g3(position*, parsed_command&);
@@ -205,6 +272,7 @@ private:
 	void process_t(position*, parsed_command&);
 
 	gcode_comment_processor comment_processor_;
+	processing_stats* p_processing_stats_;
 	void delete_retraction_lengths_();
 	void delete_z_lift_heights_();
 	void set_num_extruders(int num_extruders);
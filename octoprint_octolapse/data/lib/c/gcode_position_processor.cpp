@@ -29,6 +29,15 @@
 #include "stabilization.h"
 #include "logging.h"
 #include "python_helpers.h"
+#include "position_view.h"
+#include "processor_state.h"
+#include "position_handle.h"
+#include "async_tracker.h"
+#include "plan_cursor.h"
+#include "processing_progress.h"
+#include "toolpath_recorder.h"
+#include "plan_pipeline.h"
+#include "threads.h"
 #ifdef _DEBUG
 #include "test.h"
 #endif
@@ -92,17 +101,40 @@ static struct module_state _state;
 
 // Python 2 module method definition
 static PyMethodDef GcodePositionProcessorMethods[] = {
-	{ "Initialize", (PyCFunction)Initialize,  METH_VARARGS  ,"Initialize the internal shared position processor." },
+	{ "Initialize", (PyCFunction)Initialize,  METH_VARARGS  ,"Initialize the internal shared position processor.  Returns a PositionHandle for the key." },
+	{ "GetPositionHandle", (PyCFunction)GetPositionHandle,  METH_VARARGS  ,"Returns a PositionHandle for the position processor with the given key, or False if there is none." },
+	{ "CreateAsyncTracker", (PyCFunction)CreateAsyncTracker,  METH_VARARGS  ,"Creates an AsyncTracker, which follows the live position and an optional native trigger on its own thread." },
+	{ "CreateProcessingProgress", (PyCFunction)CreateProcessingProgress,  METH_NOARGS  ,"Creates a ProcessingProgress, which can be passed to the GetSnapshotPlans functions as 'progress' to read their progress and cancel them from any thread without a progress callback." },
+	{ "CreateToolpath", (PyCFunction)CreateToolpath,  METH_VARARGS  ,"Creates a Toolpath with an optional decimation tolerance in mm, which can be passed to the GetSnapshotPlans functions as 'toolpath' to record the decimated toolpath as columns that support the buffer protocol." },
+	{ "CreatePlanCursor", (PyCFunction)CreatePlanCursor,  METH_VARARGS  ,"Creates a PlanCursor, which follows precalculated snapshot plans by the gcode number of each printed line, and optionally the plans that a PlanPipeline adds after them." },
+	{ "InitializeFromCheckpoint", (PyCFunction)InitializeFromCheckpoint,  METH_VARARGS  ,"Initialize the position processor as if every line of the gcode file before the file position had been processed, starting from the nearest position checkpoint.  Returns (is_checkpoint_used, lines_processed), or False if the gcode file could not be read." },
 	{ "Undo",  (PyCFunction)Undo,  METH_VARARGS  ,"Undo an update made to the current position.  You can only undo once." },
 	{ "Update",  (PyCFunction)Update,  METH_VARARGS  ,"Undo an update made to the current position.  You can only undo once." },
+	{ "UpdateView",  (PyCFunction)UpdateView,  METH_VARARGS  ,"Update the current position from gcode and return it as a PositionView, which only converts the values that are read." },
+	{ "UpdateBatch",  (PyCFunction)UpdateBatch,  METH_VARARGS  ,"Update the current position from a list of gcode lines.  Returns (position, line_flags, layer_change_indexes), each of which is None unless requested." },
 	{ "UpdatePosition",  (PyCFunction)UpdatePosition,  METH_VARARGS  ,"Update x,y,z,e and f for the given position key." },
 	{ "Parse",  (PyCFunction)Parse,  METH_VARARGS  ,"Parse gcode text into a ParsedCommand." },
 	{ "GetCurrentPositionTuple",  (PyCFunction)GetCurrentPositionTuple,  METH_VARARGS  ,"Returns the current position of the global GcodePosition tracker in a faster but harder to handle tuple form." },
 	{ "GetCurrentPositionDict",  (PyCFunction)GetCurrentPositionDict,  METH_VARARGS  ,"Returns the current position of the global GcodePosition tracker in a slower but easier to deal with dict form." },
+	{ "GetCurrentPositionView",  (PyCFunction)GetCurrentPositionView,  METH_VARARGS  ,"Returns the current position of the global GcodePosition tracker as a PositionView, which only converts the values that are read." },
 	{ "GetPreviousPositionTuple",  (PyCFunction)GetPreviousPositionTuple,  METH_VARARGS  ,"Returns the previous position of the global GcodePosition tracker in a faster but harder to handle tuple form." },
+	{ "GetPreviousPositionView",  (PyCFunction)GetPreviousPositionView,  METH_VARARGS  ,"Returns the previous position of the global GcodePosition tracker as a PositionView, which only converts the values that are read." },
 	{ "GetPreviousPositionDict",  (PyCFunction)GetPreviousPositionDict,  METH_VARARGS  ,"Returns the previous position of the global GcodePosition tracker in a slower but easier to deal with dict form." },
 	{ "GetSnapshotPlans_SmartLayer", (PyCFunction)GetSnapshotPlans_SmartLayer, METH_VARARGS, "Parses a gcode file and returns snapshot plans for a 'SmartLayer' stabilization." },
+	{ "StartSnapshotPlans_SmartLayer", (PyCFunction)StartSnapshotPlans_SmartLayer, METH_VARARGS, "Starts creating smart layer snapshot plans on a native thread and returns a PlanPipeline, which hands out each plan as soon as it is complete so that printing can start right away." },
+	{ "GetSnapshotPlans_SmartLayerMultiple", (PyCFunction)GetSnapshotPlans_SmartLayerMultiple, METH_VARARGS, "Parses a gcode file once and returns a list of snapshot plans for each (stabilization_args, smart_layer_args) pair in a list of 'SmartLayer' stabilizations." },
 	{ "GetSnapshotPlans_SmartGcode", (PyCFunction)GetSnapshotPlans_SmartGcode, METH_VARARGS, "Parses a gcode file and returns snapshot plans for a 'SmartGcode' stabilization." },
+	{ "GetSnapshotPlans_SmartTimer", (PyCFunction)GetSnapshotPlans_SmartTimer, METH_VARARGS, "Parses a gcode file and returns snapshot plans for a 'SmartTimer' stabilization, which takes a snapshot every interval of estimated print time." },
+	{ "SetLogLevels", (PyCFunction)SetLogLevels, METH_VARARGS, "Sets the cached (gcode_parser, gcode_position, snapshot_plan) log levels used to discard messages without calling into python." },
+	{ "InvalidateLogLevels", (PyCFunction)InvalidateLogLevels, METH_VARARGS, "Discards the cached log levels so that they are reloaded from the python loggers.  Call whenever the logging settings change." },
+	{ "InitializeTrigger", (PyCFunction)InitializeTrigger, METH_VARARGS, "Creates a native real-time trigger that follows the gcode position with the same key." },
+	{ "UpdateTrigger", (PyCFunction)UpdateTrigger, METH_VARARGS, "Updates the native trigger from its gcode position.  Returns None if the trigger state did not change, else the state tuple." },
+	{ "PauseTrigger", (PyCFunction)PauseTrigger, METH_VARARGS, "Pauses the native timer trigger for the given key." },
+	{ "ResumeTrigger", (PyCFunction)ResumeTrigger, METH_VARARGS, "Resumes the native timer trigger for the given key, keeping the proper interval." },
+	{ "InitializeSnapshotGcodeGenerator", (PyCFunction)InitializeSnapshotGcodeGenerator, METH_VARARGS, "Creates a snapshot gcode generator from the gcode generation settings, which are only passed once." },
+	{ "GetSnapshotGcode", (PyCFunction)GetSnapshotGcode, METH_VARARGS, "Creates the gcode for a SnapshotPlan.  Returns a tuple of (initialization, start, snapshot, return, end) gcode lists, or None if no gcode could be created." },
+	{ "GetStats", (PyCFunction)GetStats, METH_VARARGS, "Returns the timing of Update, UpdateView and UpdateBatch for the given key as a dict of calls, total_ns, ns_per_call, min_ns, max_ns and a histogram of calls by power of two nanoseconds.  UpdateBatch counts every line as a call." },
+	{ "ExtractSlicerSettings", (PyCFunction)ExtractSlicerSettings, METH_VARARGS, "Extracts the slicer settings from the header and footer comments of a gcode file.  Returns a tuple of (is_complete, {slicer name: {'settings': dict, 'version': dict or None}})." },
 	{ NULL, NULL, 0, NULL }
 };
 
@@ -160,8 +192,74 @@ extern "C" void initGcodePositionProcessor(void)
 			Py_DECREF(module);
 			INITERROR;
 		}
+		// Constants for UpdateBatch
+		PyModule_AddIntConstant(module, "UPDATE_BATCH_RETURN_POSITION", update_batch_return_position);
+		PyModule_AddIntConstant(module, "UPDATE_BATCH_RETURN_LINE_FLAGS", update_batch_return_line_flags);
+		PyModule_AddIntConstant(module, "UPDATE_BATCH_RETURN_LAYER_CHANGES", update_batch_return_layer_changes);
+		PyModule_AddIntConstant(module, "LINE_HAS_COMMAND", update_batch_line_has_command);
+		PyModule_AddIntConstant(module, "LINE_POSITION_CHANGED", update_batch_line_position_changed);
+		PyModule_AddIntConstant(module, "LINE_XY_POSITION_CHANGED", update_batch_line_xy_position_changed);
+		PyModule_AddIntConstant(module, "LINE_LAYER_CHANGE", update_batch_line_layer_change);
+		PyModule_AddIntConstant(module, "LINE_HEIGHT_CHANGE", update_batch_line_height_change);
+		PyModule_AddIntConstant(module, "LINE_ZHOP", update_batch_line_zhop);
+		PyModule_AddIntConstant(module, "LINE_XY_TRAVEL", update_batch_line_xy_travel);
+		PyModule_AddIntConstant(module, "LINE_IN_BOUNDS", update_batch_line_in_bounds);
+		// Constants for PlanCursor.Update
+		PyModule_AddIntConstant(module, "PLAN_CURSOR_NONE", plan_cursor_status_none);
+		PyModule_AddIntConstant(module, "PLAN_CURSOR_SKIPPED", plan_cursor_status_skipped);
+		PyModule_AddIntConstant(module, "PLAN_CURSOR_TRIGGER_LINE", plan_cursor_status_trigger_line);
+		PyModule_AddIntConstant(module, "PLAN_CURSOR_PLANS_PENDING", plan_cursor_status_plans_pending);
+		PyModule_AddIntConstant(module, "PLAN_CURSOR_NOT_PLANNED", plan_cursor_status_not_planned);
+		PyModule_AddIntConstant(module, "POSITION_TRACKING_COMMENTS", position_tracking_comments);
+		PyModule_AddIntConstant(module, "POSITION_TRACKING_BOUNDS", position_tracking_bounds);
+		PyModule_AddIntConstant(module, "POSITION_TRACKING_EXTRUDER_STATE", position_tracking_extruder_state);
+		PyModule_AddIntConstant(module, "POSITION_TRACKING_LAYERS", position_tracking_layers);
+		PyModule_AddIntConstant(module, "POSITION_TRACKING_HEIGHT_INCREMENT", position_tracking_height_increment);
+		PyModule_AddIntConstant(module, "POSITION_TRACKING_ALL", position_tracking_all);
+		// 0 if the extension was built without native threads, in which case there is no AsyncTracker or PlanPipeline.
+		PyModule_AddIntConstant(module, "HAS_THREADS", OCTOLAPSE_HAS_THREADS);
+
 		octolapse_initialize_loggers();
-		gpp::parser = new gcode_parser();
+		if (!position_view_add_type(module))
+		{
+			Py_DECREF(module);
+			INITERROR;
+		}
+		if (!position_handle_add_type(module))
+		{
+			Py_DECREF(module);
+			INITERROR;
+		}
+		if (!async_tracker_add_type(module))
+		{
+			Py_DECREF(module);
+			INITERROR;
+		}
+		if (!processing_progress_add_type(module))
+		{
+			Py_DECREF(module);
+			INITERROR;
+		}
+		if (!toolpath_add_types(module))
+		{
+			Py_DECREF(module);
+			INITERROR;
+		}
+		if (!plan_pipeline_add_type(module))
+		{
+			Py_DECREF(module);
+			INITERROR;
+		}
+		if (!plan_cursor_add_type(module))
+		{
+			Py_DECREF(module);
+			INITERROR;
+		}
+		if (!processor_add_type(module, GcodePositionProcessorMethods))
+		{
+			Py_DECREF(module);
+			INITERROR;
+		}
 
 		std::cout << "complete\r\n";
 
@@ -175,7 +273,7 @@ extern "C"
 
 	static PyObject * GetSnapshotPlans_SmartLayer(PyObject *self, PyObject *args)
 	{
-		set_internal_log_levels(true);
+		octolapse_update_log_levels();
 		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Running smart layer stabilization preprocessing.");
 		// TODO:  add error reporting and logging
 		PyObject *py_position_args;
@@ -219,7 +317,6 @@ extern "C"
 		}
 		//std::cout << "Creating Stabilization.\r\n";
 		// Create our stabilization object
-		set_internal_log_levels(false);
 		stabilization_smart_layer stabilization(
 			p_args,
 			s_args,
@@ -229,8 +326,39 @@ extern "C"
 			pythonProgressCallback(ExecuteStabilizationProgressCallback),
 			py_progress_received_callback
 		);
-		stabilization_results results = stabilization.process_file();
-		set_internal_log_levels(true);
+		PyObject* py_snapshot_plans_callback;
+		if (!ParseSnapshotPlansCallback(py_stabilization_args, &py_snapshot_plans_callback))
+		{
+			return NULL;
+		}
+		if (py_snapshot_plans_callback != NULL)
+		{
+			stabilization.set_snapshot_plans_callback(pythonSnapshotPlansCallback(ExecuteSnapshotPlansCallback), py_snapshot_plans_callback);
+		}
+		PyObject* py_progress;
+		if (!ParseProcessingProgress(py_stabilization_args, &py_progress))
+		{
+			return NULL;
+		}
+		if (py_progress != NULL)
+		{
+			stabilization.set_progress(processing_progress_get(py_progress), py_progress);
+		}
+		PyObject* py_toolpath;
+		if (!ParseToolpath(py_stabilization_args, &py_toolpath))
+		{
+			return NULL;
+		}
+		if (py_toolpath != NULL)
+		{
+			stabilization.set_toolpath(toolpath_prepare(py_toolpath), py_toolpath);
+		}
+		// The file scan only needs python for callbacks and logging, which acquire the GIL themselves.
+		stabilization_results results;
+		Py_BEGIN_ALLOW_THREADS
+		results = stabilization.process_file();
+		Py_END_ALLOW_THREADS
+		octolapse_update_log_levels();
 		
 
 		PyObject * py_results = results.to_py_object();
@@ -247,9 +375,216 @@ extern "C"
 		return py_results;
 	}
 
+	static PyObject * StartSnapshotPlans_SmartLayer(PyObject *self, PyObject *args)
+	{
+		octolapse_update_log_levels();
+		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Starting pipelined smart layer stabilization preprocessing.");
+		PyObject *py_position_args;
+		PyObject *py_stabilization_args;
+		PyObject *py_stabilization_type_args;
+		if (!PyArg_ParseTuple(
+			args,
+			"OOO",
+			&py_position_args,
+			&py_stabilization_args,
+			&py_stabilization_type_args))
+		{
+			std::string message = "GcodePositionProcessor.StartSnapshotPlans_SmartLayer - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		gcode_position_args p_args;
+		if (!ParsePositionArgs(py_position_args, &p_args))
+		{
+			return NULL;
+		}
+		stabilization_args s_args;
+		PyObject* py_progress_received_callback = NULL;
+		PyObject* py_snapshot_position_callback = NULL;
+		if (!ParseStabilizationArgs(py_stabilization_args, &s_args, &py_progress_received_callback, &py_snapshot_position_callback))
+		{
+			return NULL;
+		}
+		smart_layer_args mt_args;
+		if (!ParseStabilizationArgs_SmartLayer(py_stabilization_type_args, &mt_args))
+		{
+			return NULL;
+		}
+		// The stabilization outlives this call, so it belongs to the pipeline.
+		stabilization_smart_layer* p_stabilization = new stabilization_smart_layer(
+			p_args,
+			s_args,
+			mt_args,
+			pythonGetCoordinatesCallback(ExecuteGetSnapshotPositionCallback),
+			py_snapshot_position_callback,
+			pythonProgressCallback(ExecuteStabilizationProgressCallback),
+			py_progress_received_callback
+		);
+		// The plans are handed out by the pipeline, so a snapshot plans callback is not used.
+		PyObject* py_progress;
+		if (!ParseProcessingProgress(py_stabilization_args, &py_progress))
+		{
+			delete p_stabilization;
+			return NULL;
+		}
+		processing_progress* p_progress = NULL;
+		if (py_progress != NULL)
+		{
+			p_progress = processing_progress_get(py_progress);
+			p_stabilization->set_progress(p_progress, py_progress);
+		}
+		PyObject* py_toolpath;
+		if (!ParseToolpath(py_stabilization_args, &py_toolpath))
+		{
+			delete p_stabilization;
+			return NULL;
+		}
+		if (py_toolpath != NULL)
+		{
+			p_stabilization->set_toolpath(toolpath_prepare(py_toolpath), py_toolpath);
+		}
+		return plan_pipeline_create(p_stabilization, p_progress);
+	}
+
+	static void DeleteStabilizations(std::vector<stabilization*>& stabilizations)
+	{
+		for (std::vector<stabilization*>::iterator it = stabilizations.begin(); it != stabilizations.end(); ++it)
+			delete *it;
+		stabilizations.clear();
+	}
+
+	static PyObject * GetSnapshotPlans_SmartLayerMultiple(PyObject *self, PyObject *args)
+	{
+		octolapse_update_log_levels();
+		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Running multiple smart layer stabilization preprocessing.");
+		PyObject *py_position_args;
+		PyObject *py_stabilizations;
+		if (!PyArg_ParseTuple(
+			args,
+			"OO",
+			&py_position_args,
+			&py_stabilizations))
+		{
+			std::string message = "GcodePositionProcessor.GetSnapshotPlans_SmartLayerMultiple - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		if (!PyList_Check(py_stabilizations))
+		{
+			std::string message = "GcodePositionProcessor.GetSnapshotPlans_SmartLayerMultiple - The stabilizations must be a list.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		gcode_position_args p_args;
+		if (!ParsePositionArgs(py_position_args, &p_args))
+		{
+			return NULL;
+		}
+
+		std::vector<stabilization*> stabilizations;
+		const Py_ssize_t num_stabilizations = PyList_Size(py_stabilizations);
+		for (Py_ssize_t index = 0; index < num_stabilizations; index++)
+		{
+			// Borrowed reference
+			PyObject* py_stabilization = PyList_GetItem(py_stabilizations, index);
+			PyObject *py_stabilization_args;
+			PyObject *py_stabilization_type_args;
+			if (!PyArg_ParseTuple(py_stabilization, "OO", &py_stabilization_args, &py_stabilization_type_args))
+			{
+				std::string message = "GcodePositionProcessor.GetSnapshotPlans_SmartLayerMultiple - Each stabilization must be a (stabilization_args, smart_layer_args) tuple.";
+				octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+				DeleteStabilizations(stabilizations);
+				return NULL;
+			}
+			stabilization_args s_args;
+			PyObject* py_progress_received_callback = NULL;
+			PyObject* py_snapshot_position_callback = NULL;
+			smart_layer_args mt_args;
+			if (
+				!ParseStabilizationArgs(py_stabilization_args, &s_args, &py_progress_received_callback, &py_snapshot_position_callback)
+				|| !ParseStabilizationArgs_SmartLayer(py_stabilization_type_args, &mt_args)
+			)
+			{
+				// The callbacks are new references that would have been released by the stabilization.
+				Py_XDECREF(py_progress_received_callback);
+				Py_XDECREF(py_snapshot_position_callback);
+				DeleteStabilizations(stabilizations);
+				return NULL;
+			}
+			stabilization* p_stabilization = new stabilization_smart_layer(
+				p_args,
+				s_args,
+				mt_args,
+				pythonGetCoordinatesCallback(ExecuteGetSnapshotPositionCallback),
+				py_snapshot_position_callback,
+				pythonProgressCallback(ExecuteStabilizationProgressCallback),
+				py_progress_received_callback
+			);
+			stabilizations.push_back(p_stabilization);
+			PyObject* py_snapshot_plans_callback;
+			if (!ParseSnapshotPlansCallback(py_stabilization_args, &py_snapshot_plans_callback))
+			{
+				DeleteStabilizations(stabilizations);
+				return NULL;
+			}
+			if (py_snapshot_plans_callback != NULL)
+			{
+				p_stabilization->set_snapshot_plans_callback(pythonSnapshotPlansCallback(ExecuteSnapshotPlansCallback), py_snapshot_plans_callback);
+			}
+			PyObject* py_progress;
+			if (!ParseProcessingProgress(py_stabilization_args, &py_progress))
+			{
+				DeleteStabilizations(stabilizations);
+				return NULL;
+			}
+			if (py_progress != NULL)
+			{
+				p_stabilization->set_progress(processing_progress_get(py_progress), py_progress);
+			}
+			PyObject* py_toolpath;
+			if (!ParseToolpath(py_stabilization_args, &py_toolpath))
+			{
+				DeleteStabilizations(stabilizations);
+				return NULL;
+			}
+			if (py_toolpath != NULL)
+			{
+				p_stabilization->set_toolpath(toolpath_prepare(py_toolpath), py_toolpath);
+			}
+		}
+		// Stabilizations of the same file share a single pass, which only reports progress for the first of them.
+		std::vector<stabilization_results> results;
+		Py_BEGIN_ALLOW_THREADS
+		results = stabilization::process_file_multiple(stabilizations);
+		Py_END_ALLOW_THREADS
+		octolapse_update_log_levels();
+		DeleteStabilizations(stabilizations);
+
+		PyObject * py_results = PyList_New(results.size());
+		if (py_results == NULL)
+		{
+			std::string message = "GcodePositionProcessor.GetSnapshotPlans_SmartLayerMultiple - Unable to create the results list.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		for (unsigned int index = 0; index < results.size(); index++)
+		{
+			PyObject * py_result = results[index].to_py_object();
+			if (py_result == NULL)
+			{
+				Py_DECREF(py_results);
+				return NULL;
+			}
+			// Steals the reference
+			PyList_SetItem(py_results, index, py_result);
+		}
+		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Multiple snapshot plan creation complete, returning plans.");
+		return py_results;
+	}
+
 	static PyObject * GetSnapshotPlans_SmartGcode(PyObject *self, PyObject *args)
 	{
-		set_internal_log_levels(true);
+		octolapse_update_log_levels();
 		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Running smart gcode stabilization preprocessing.");
 		// TODO:  add error reporting and logging
 		PyObject *py_position_args;
@@ -293,7 +628,6 @@ extern "C"
 		}
 		//std::cout << "Creating Stabilization.\r\n";
 		// Create our stabilization object
-		set_internal_log_levels(false);
 		stabilization_smart_gcode stabilization(
 			p_args,
 			s_args,
@@ -303,9 +637,128 @@ extern "C"
 			pythonProgressCallback(ExecuteStabilizationProgressCallback),
 			py_progress_received_callback
 		);
-		stabilization_results results = stabilization.process_file();
-		set_internal_log_levels(true);
+		PyObject* py_snapshot_plans_callback;
+		if (!ParseSnapshotPlansCallback(py_stabilization_args, &py_snapshot_plans_callback))
+		{
+			return NULL;
+		}
+		if (py_snapshot_plans_callback != NULL)
+		{
+			stabilization.set_snapshot_plans_callback(pythonSnapshotPlansCallback(ExecuteSnapshotPlansCallback), py_snapshot_plans_callback);
+		}
+		PyObject* py_progress;
+		if (!ParseProcessingProgress(py_stabilization_args, &py_progress))
+		{
+			return NULL;
+		}
+		if (py_progress != NULL)
+		{
+			stabilization.set_progress(processing_progress_get(py_progress), py_progress);
+		}
+		PyObject* py_toolpath;
+		if (!ParseToolpath(py_stabilization_args, &py_toolpath))
+		{
+			return NULL;
+		}
+		if (py_toolpath != NULL)
+		{
+			stabilization.set_toolpath(toolpath_prepare(py_toolpath), py_toolpath);
+		}
+		// The file scan only needs python for callbacks and logging, which acquire the GIL themselves.
+		stabilization_results results;
+		Py_BEGIN_ALLOW_THREADS
+		results = stabilization.process_file();
+		Py_END_ALLOW_THREADS
+		octolapse_update_log_levels();
+
+
+		PyObject * py_results = results.to_py_object();
+		if (py_results == NULL)
+		{
+			return NULL;
+		}
+		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Snapshot plan creation complete, returning plans.");
+		return py_results;
+	}
+
+	static PyObject * GetSnapshotPlans_SmartTimer(PyObject *self, PyObject *args)
+	{
+		octolapse_update_log_levels();
+		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Running smart timer stabilization preprocessing.");
+		PyObject *py_position_args;
+		PyObject *py_stabilization_args;
+		PyObject *py_stabilization_type_args;
+		if (!PyArg_ParseTuple(
+			args,
+			"OOO",
+			&py_position_args,
+			&py_stabilization_args,
+			&py_stabilization_type_args))
+		{
+			std::string message = "GcodePositionProcessor.GetSnapshotPlans_SmartTimer - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		gcode_position_args p_args;
+		if (!ParsePositionArgs(py_position_args, &p_args))
+		{
+			return NULL;
+		}
 
+		stabilization_args s_args;
+		PyObject* py_progress_received_callback = NULL;
+		PyObject* py_snapshot_position_callback = NULL;
+		if (!ParseStabilizationArgs(py_stabilization_args, &s_args, &py_progress_received_callback, &py_snapshot_position_callback))
+		{
+			return NULL;
+		}
+		smart_timer_args mt_args;
+		if (!ParseStabilizationArgs_SmartTimer(py_stabilization_type_args, &mt_args))
+		{
+			return NULL;
+		}
+		stabilization_smart_timer stabilization(
+			p_args,
+			s_args,
+			mt_args,
+			pythonGetCoordinatesCallback(ExecuteGetSnapshotPositionCallback),
+			py_snapshot_position_callback,
+			pythonProgressCallback(ExecuteStabilizationProgressCallback),
+			py_progress_received_callback
+		);
+		PyObject* py_snapshot_plans_callback;
+		if (!ParseSnapshotPlansCallback(py_stabilization_args, &py_snapshot_plans_callback))
+		{
+			return NULL;
+		}
+		if (py_snapshot_plans_callback != NULL)
+		{
+			stabilization.set_snapshot_plans_callback(pythonSnapshotPlansCallback(ExecuteSnapshotPlansCallback), py_snapshot_plans_callback);
+		}
+		PyObject* py_progress;
+		if (!ParseProcessingProgress(py_stabilization_args, &py_progress))
+		{
+			return NULL;
+		}
+		if (py_progress != NULL)
+		{
+			stabilization.set_progress(processing_progress_get(py_progress), py_progress);
+		}
+		PyObject* py_toolpath;
+		if (!ParseToolpath(py_stabilization_args, &py_toolpath))
+		{
+			return NULL;
+		}
+		if (py_toolpath != NULL)
+		{
+			stabilization.set_toolpath(toolpath_prepare(py_toolpath), py_toolpath);
+		}
+		// The file scan only needs python for callbacks and logging, which acquire the GIL themselves.
+		stabilization_results results;
+		Py_BEGIN_ALLOW_THREADS
+		results = stabilization.process_file();
+		Py_END_ALLOW_THREADS
+		octolapse_update_log_levels();
 
 		PyObject * py_results = results.to_py_object();
 		if (py_results == NULL)
@@ -318,7 +771,8 @@ extern "C"
 
 	static PyObject* Initialize(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
 		// Create the gcode position object 
 		octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Initializing gcode position processor.");
 		const char * pKey;
@@ -345,17 +799,13 @@ extern "C"
 		}
 				
 		// see if we already have a gcode_position object for the given key
-		std::map<std::string, gcode_position*>::iterator gcode_position_iterator = gpp::gcode_positions.find(pKey);
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(pKey);
 		gcode_position* p_gcode_position = NULL;
-		if (gcode_position_iterator != gpp::gcode_positions.end())
+		if (gcode_position_iterator != p_state->gcode_positions.end())
 		{
+			// Any PositionHandle for the old position keeps it alive until the handle is released.
 			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Existing processor found, deleting.");
-			delete gcode_position_iterator->second;
-		}
-		// Separate delete step.  Something is going on here.
-		if (gcode_position_iterator != gpp::gcode_positions.end())
-		{
-			gpp::gcode_positions.erase(gcode_position_iterator);
+			p_state->gcode_positions.erase(gcode_position_iterator);
 		}
 
 		std::string message = "Adding processor with key:";
@@ -365,14 +815,176 @@ extern "C"
 		// Create the new position object
 		gcode_position * p_new_position = new gcode_position(positionArgs);
 		// add the new gcode position to our list of objects
-		gpp::gcode_positions.insert(std::pair<std::string, gcode_position*>(pKey, p_new_position));
-		// Return True
-		return Py_BuildValue("O", Py_True);
+		p_state->gcode_positions.insert(std::pair<std::string, std::shared_ptr<gcode_position> >(pKey, std::shared_ptr<gcode_position>(p_new_position)));
+		p_state->update_stats[pKey].clear();
+		// Return a handle, which is always true, so callers that only check the result still work.
+		return position_handle_create(self, pKey);
+	}
+
+	static PyObject* GetPositionHandle(PyObject* self, PyObject *args)
+	{
+		octolapse_update_log_levels();
+		const char * key;
+		if (!PyArg_ParseTuple(args, "s", &key))
+		{
+			std::string message = "GcodePositionProcessor.GetPositionHandle - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		return position_handle_create(self, key);
+	}
+
+	static PyObject* CreateAsyncTracker(PyObject* self, PyObject *args)
+	{
+		octolapse_update_log_levels();
+		PyObject* py_position_args;
+		PyObject* py_trigger_args;
+		int queue_size;
+		if (!PyArg_ParseTuple(
+			args, "OOi",
+			&py_position_args,
+			&py_trigger_args,
+			&queue_size
+		))
+		{
+			std::string message = "GcodePositionProcessor.CreateAsyncTracker - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		gcode_position_args position_args;
+		if (!ParsePositionArgs(py_position_args, &position_args))
+		{
+			return NULL; // ParsePositionArgs has taken care of the error message
+		}
+		// The trigger is optional
+		snapshot_trigger_args trigger_args;
+		snapshot_trigger_args* p_trigger_args = NULL;
+		if (py_trigger_args != Py_None)
+		{
+			if (!ParseTriggerArgs(py_trigger_args, &trigger_args))
+			{
+				return NULL; // ParseTriggerArgs has taken care of the error message
+			}
+			p_trigger_args = &trigger_args;
+		}
+		octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Starting an asynchronous position tracker.");
+		return async_tracker_create(position_args, p_trigger_args, queue_size);
+	}
+
+	static PyObject* CreateProcessingProgress(PyObject* self, PyObject *args)
+	{
+		return processing_progress_create();
+	}
+
+	static PyObject* CreateToolpath(PyObject* self, PyObject *args)
+	{
+		double tolerance = TOOLPATH_DEFAULT_TOLERANCE;
+		if (!PyArg_ParseTuple(
+			args, "|d",
+			&tolerance
+		))
+		{
+			std::string message = "GcodePositionProcessor.CreateToolpath - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		return toolpath_create(tolerance);
+	}
+
+	static PyObject* CreatePlanCursor(PyObject* self, PyObject *args)
+	{
+		octolapse_update_log_levels();
+		PyObject* py_plans;
+		PyObject* py_pipeline = NULL;
+		if (!PyArg_ParseTuple(
+			args, "O|O",
+			&py_plans,
+			&py_pipeline
+		))
+		{
+			std::string message = "GcodePositionProcessor.CreatePlanCursor - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		if (py_pipeline == Py_None)
+			py_pipeline = NULL;
+		return plan_cursor_create(py_plans, py_pipeline);
+	}
+
+	static PyObject* InitializeFromCheckpoint(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Initializing gcode position processor from a position checkpoint.");
+		const char * pKey;
+		PyObject* py_position_args;
+		const char * checkpoint_directory;
+		const char * file_path;
+		long file_position;
+		if (!PyArg_ParseTuple(
+			args, "sOssl",
+			&pKey,
+			&py_position_args,
+			&checkpoint_directory,
+			&file_path,
+			&file_position
+		))
+		{
+			std::string message = "GcodePositionProcessor.InitializeFromCheckpoint - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+
+		gcode_position_args positionArgs;
+		if (!ParsePositionArgs(py_position_args, &positionArgs))
+		{
+			return NULL; // The call failed, ParseInitializationArgs has taken care of the error message
+		}
+
+		// A missing or outdated index isn't an error, the position is rebuilt from the top of the file instead.
+		position_checkpoint_index index;
+		std::string index_key;
+		const position_checkpoint* p_checkpoint = NULL;
+		if (position_checkpoint_index::create_key(file_path, positionArgs, index_key) &&
+			index.load(position_checkpoint_index::get_index_file_path(checkpoint_directory, index_key), index_key))
+		{
+			p_checkpoint = index.find(file_position);
+		}
+		else
+		{
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "No position checkpoints were found for the gcode file, processing from the start of the file.");
+		}
+
+		gcode_position * p_new_position = new gcode_position(positionArgs);
+		int lines_processed;
+		bool success;
+		Py_BEGIN_ALLOW_THREADS
+		success = position_checkpoint_index::seek(*p_new_position, p_state->parser, file_path, p_checkpoint, file_position, lines_processed);
+		Py_END_ALLOW_THREADS
+		if (!success)
+		{
+			delete p_new_position;
+			std::string message = "GcodePositionProcessor.InitializeFromCheckpoint - Unable to read the gcode file: ";
+			message += file_path;
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
+			return Py_BuildValue("O", Py_False);
+		}
+
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(pKey);
+		if (gcode_position_iterator != p_state->gcode_positions.end())
+		{
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Existing processor found, deleting.");
+			p_state->gcode_positions.erase(gcode_position_iterator);
+		}
+		p_state->gcode_positions.insert(std::pair<std::string, std::shared_ptr<gcode_position> >(pKey, std::shared_ptr<gcode_position>(p_new_position)));
+		p_state->update_stats[pKey].clear();
+		return Py_BuildValue("(O,i)", p_checkpoint != NULL ? Py_True : Py_False, lines_processed);
 	}
 
 	static PyObject* Undo(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
 		octolapse_log(
 			octolapse_log::GCODE_POSITION, octolapse_log::DEBUG,
 			"Undoing the last gcode position update."
@@ -385,56 +997,270 @@ extern "C"
 			return NULL;
 		}
 		// Get the parser
-		std::map<std::string, gcode_position*>::iterator gcode_position_iterator = gpp::gcode_positions.find(key);
-		if (gcode_position_iterator == gpp::gcode_positions.end())
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
+		{
+			return Py_BuildValue("O", Py_False);
+		}
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
+
+		p_gcode_position->undo_update();
+		
+		return Py_BuildValue("O", Py_True);
+	}
+
+	static PyObject* Update(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
+			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
+			"Updating current position from gcode."
+		);
+		const char* key;
+		const char* gcode;
+		if (!PyArg_ParseTuple(args, "ss", &key, &gcode))
+		{
+			std::string message = "GcodePositionProcessor.Update - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		
+		// Get the parser
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
+		{
+			std::string message = "GcodePositionProcessor.Update - No position processor was found for the given key: ";
+			message += key;
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
+			return Py_BuildValue("O", Py_False);
+		}
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
+
+		const long long start_ns = processing_stats_get_time_ns();
+		parsed_command command;
+		p_state->parser.try_parse_gcode(gcode, command);
+		p_gcode_position->update(command, -1, -1, -1);
+		p_state->update_stats[key].add_call(processing_stats_get_time_ns() - start_ns);
+
+		return p_gcode_position->get_current_position_ptr()->to_py_tuple();
+	}
+
+	static PyObject* UpdateView(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
+			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
+			"Updating current position from gcode and returning a position view."
+		);
+		const char* key;
+		const char* gcode;
+		if (!PyArg_ParseTuple(args, "ss", &key, &gcode))
+		{
+			std::string message = "GcodePositionProcessor.UpdateView - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+
+		// Get the parser
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
 		{
+			std::string message = "GcodePositionProcessor.UpdateView - No position processor was found for the given key: ";
+			message += key;
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
 			return Py_BuildValue("O", Py_False);
 		}
-		gcode_position* p_gcode_position = gcode_position_iterator->second;
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
 
-		p_gcode_position->undo_update();
-		
-		return Py_BuildValue("O", Py_True);
+		const long long start_ns = processing_stats_get_time_ns();
+		parsed_command command;
+		p_state->parser.try_parse_gcode(gcode, command);
+		p_gcode_position->update(command, -1, -1, -1);
+		p_state->update_stats[key].add_call(processing_stats_get_time_ns() - start_ns);
+
+		return position_view_create(*p_gcode_position->get_current_position_ptr());
 	}
 
-	static PyObject* Update(PyObject* self, PyObject *args)
+	static PyObject* UpdateBatch(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
-		octolapse_log(
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
 			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
-			"Updating current position from gcode."
+			"Updating current position from a batch of gcode."
 		);
 		const char* key;
-		const char* gcode;
-		if (!PyArg_ParseTuple(args, "ss", &key, &gcode))
+		PyObject* py_gcodes;
+		long return_type = update_batch_return_position;
+		if (!PyArg_ParseTuple(args, "sO|l", &key, &py_gcodes, &return_type))
 		{
-			std::string message = "GcodePositionProcessor.Update - Error parsing parameters.";
+			std::string message = "GcodePositionProcessor.UpdateBatch - Error parsing parameters.";
 			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
 			return NULL;
 		}
-		
+
 		// Get the parser
-		std::map<std::string, gcode_position*>::iterator gcode_position_iterator = gpp::gcode_positions.find(key);
-		if (gcode_position_iterator == gpp::gcode_positions.end())
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
 		{
-			std::string message = "GcodePositionProcessor.Update - No position processor was found for the given key: ";
+			std::string message = "GcodePositionProcessor.UpdateBatch - No position processor was found for the given key: ";
 			message += key;
 			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
 			return Py_BuildValue("O", Py_False);
 		}
-		gcode_position* p_gcode_position = gcode_position_iterator->second;
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
+
+		PyObject* py_gcodes_sequence = PySequence_Fast(py_gcodes, "GcodePositionProcessor.UpdateBatch - The gcodes must be a list or a tuple.");
+		if (py_gcodes_sequence == NULL)
+		{
+			std::string message = "GcodePositionProcessor.UpdateBatch - The gcodes must be a list or a tuple.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		const Py_ssize_t num_gcodes = PySequence_Fast_GET_SIZE(py_gcodes_sequence);
+
+		PyObject* py_line_flags = NULL;
+		if ((return_type & update_batch_return_line_flags) != 0)
+		{
+			py_line_flags = PyList_New(num_gcodes);
+			if (py_line_flags == NULL)
+			{
+				Py_DECREF(py_gcodes_sequence);
+				std::string message = "GcodePositionProcessor.UpdateBatch - Unable to create the line flags list.";
+				octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+				return NULL;
+			}
+		}
+		PyObject* py_layer_changes = NULL;
+		if ((return_type & update_batch_return_layer_changes) != 0)
+		{
+			py_layer_changes = PyList_New(0);
+			if (py_layer_changes == NULL)
+			{
+				Py_XDECREF(py_line_flags);
+				Py_DECREF(py_gcodes_sequence);
+				std::string message = "GcodePositionProcessor.UpdateBatch - Unable to create the layer change list.";
+				octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+				return NULL;
+			}
+		}
 
+		processing_call_stats& update_stats = p_state->update_stats[key];
 		parsed_command command;
-		gpp::parser->try_parse_gcode(gcode, command);
-		p_gcode_position->update(command, -1, -1, -1);
+		for (Py_ssize_t index = 0; index < num_gcodes; index++)
+		{
+			Py_ssize_t gcode_length;
+			const char* gcode = PyUnicode_SafeAsStringAndSize(PySequence_Fast_GET_ITEM(py_gcodes_sequence, index), &gcode_length);
+			if (gcode == NULL)
+			{
+				Py_XDECREF(py_line_flags);
+				Py_XDECREF(py_layer_changes);
+				Py_DECREF(py_gcodes_sequence);
+				std::string message = "GcodePositionProcessor.UpdateBatch - Each gcode must be a string.";
+				octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+				return NULL;
+			}
+			const long long start_ns = processing_stats_get_time_ns();
+			command.clear();
+			p_state->parser.try_parse_gcode(gcode, static_cast<size_t>(gcode_length), command);
+			p_gcode_position->update(command, -1, -1, -1);
+			update_stats.add_call(processing_stats_get_time_ns() - start_ns);
+
+			// Empty lines do not change the position.
+			const position* p_current_pos = p_gcode_position->get_current_position_ptr();
+			const bool is_layer_change = !command.is_empty && p_current_pos->is_layer_change;
+			if (py_line_flags != NULL)
+			{
+				long flags = 0;
+				if (!command.is_empty)
+				{
+					flags = update_batch_line_has_command;
+					if (p_current_pos->has_position_changed)
+						flags |= update_batch_line_position_changed;
+					if (p_current_pos->has_xy_position_changed)
+						flags |= update_batch_line_xy_position_changed;
+					if (is_layer_change)
+						flags |= update_batch_line_layer_change;
+					if (p_current_pos->is_height_change)
+						flags |= update_batch_line_height_change;
+					if (p_current_pos->is_zhop)
+						flags |= update_batch_line_zhop;
+					if (p_current_pos->is_xy_travel)
+						flags |= update_batch_line_xy_travel;
+					if (p_current_pos->is_in_bounds)
+						flags |= update_batch_line_in_bounds;
+				}
+				// PyList_SET_ITEM steals the reference
+				PyList_SET_ITEM(py_line_flags, index, PyLong_FromLong(flags));
+			}
+			if (py_layer_changes != NULL && is_layer_change)
+			{
+				PyObject* py_index = PyLong_FromSsize_t(index);
+				PyList_Append(py_layer_changes, py_index);
+				Py_DECREF(py_index);
+			}
+		}
+		Py_DECREF(py_gcodes_sequence);
 
-		return p_gcode_position->get_current_position_ptr()->to_py_tuple();
+		PyObject* py_position = NULL;
+		if ((return_type & update_batch_return_position) != 0)
+		{
+			py_position = p_gcode_position->get_current_position_ptr()->to_py_tuple();
+			if (py_position == NULL)
+			{
+				Py_XDECREF(py_line_flags);
+				Py_XDECREF(py_layer_changes);
+				return NULL;
+			}
+		}
+		else
+		{
+			Py_INCREF(Py_None);
+			py_position = Py_None;
+		}
+		if (py_line_flags == NULL)
+		{
+			Py_INCREF(Py_None);
+			py_line_flags = Py_None;
+		}
+		if (py_layer_changes == NULL)
+		{
+			Py_INCREF(Py_None);
+			py_layer_changes = Py_None;
+		}
+		// The N format steals our references
+		return Py_BuildValue("(NNN)", py_position, py_line_flags, py_layer_changes);
+	}
+
+	static PyObject* GetStats(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		const char* key;
+		if (!PyArg_ParseTuple(args, "s", &key))
+		{
+			std::string message = "GcodePositionProcessor.GetStats - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		std::map<std::string, processing_call_stats>::iterator update_stats_iterator = p_state->update_stats.find(key);
+		if (update_stats_iterator == p_state->update_stats.end())
+		{
+			std::string message = "GcodePositionProcessor.GetStats - No position processor was found for the given key: ";
+			message += key;
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
+			return Py_BuildValue("O", Py_False);
+		}
+		return update_stats_iterator->second.to_py_object();
 	}
 
 	static PyObject* UpdatePosition(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
-		octolapse_log(
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
 			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
 			"Manually updating current position."
 		);
@@ -470,15 +1296,15 @@ extern "C"
 			return NULL;
 		}
 		// Get the parser
-		std::map<std::string, gcode_position*>::iterator gcode_position_iterator = gpp::gcode_positions.find(key);
-		if (gcode_position_iterator == gpp::gcode_positions.end())
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
 		{
 			std::string message = "GcodePositionProcessor.UpdatePosition - No position processor was found for the given key: ";
 			message += key;
 			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
 			return Py_BuildValue("O", Py_False);
 		}
-		gcode_position* p_gcode_position = gcode_position_iterator->second;
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
 		position* pos = p_gcode_position->get_current_position_ptr();
 		p_gcode_position->update_position(
 			pos,
@@ -500,8 +1326,9 @@ extern "C"
 
 	static PyObject* Parse(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
-		octolapse_log(
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
 			octolapse_log::GCODE_PARSER, octolapse_log::VERBOSE,
 			"Parsing gcode."
 		);
@@ -513,15 +1340,16 @@ extern "C"
 			return NULL;
 		}
 		parsed_command command;
-		gpp::parser->try_parse_gcode(gcode, command);
+		p_state->parser.try_parse_gcode(gcode, command);
 		return command.to_py_object();
 		
 	}
 
 	static PyObject* GetCurrentPositionTuple(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
-		octolapse_log(
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
 			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
 			"Getting current position tuple."
 		);
@@ -533,20 +1361,47 @@ extern "C"
 			return NULL;
 		}
 		// Get the parser
-		std::map<std::string, gcode_position*>::iterator gcode_position_iterator = gpp::gcode_positions.find(key);
-		if (gcode_position_iterator == gpp::gcode_positions.end())
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
 		{
 			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "Could not find a position processor with the given key.");
 			return Py_BuildValue("O", Py_False);
 		}
-		gcode_position* p_gcode_position = gcode_position_iterator->second;
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
 		return p_gcode_position->get_current_position().to_py_tuple();
 	}
 
+	static PyObject* GetCurrentPositionView(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
+			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
+			"Getting current position view."
+		);
+		const char * key;
+		if (!PyArg_ParseTuple(args, "s", &key))
+		{
+			std::string message = "GcodePositionProcessor.GetCurrentPositionView - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		// Get the position processor by key
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
+		{
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePositionProcessor.GetCurrentPositionView - Could not find a position processor with the given key.");
+			return Py_BuildValue("O", Py_False);
+		}
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
+		return position_view_create(*p_gcode_position->get_current_position_ptr());
+	}
+
 	static PyObject* GetCurrentPositionDict(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
-		octolapse_log(
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
 			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
 			"Getting current position dict."
 		);
@@ -559,21 +1414,22 @@ extern "C"
 		}
 
 		// Get the parser
-		std::map<std::string, gcode_position*>::iterator gcode_position_iterator = gpp::gcode_positions.find(key);
-		if (gcode_position_iterator == gpp::gcode_positions.end())
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
 		{
 			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "Could not find a position processor with the given key.");
 			return Py_BuildValue("O", Py_False);
 		}
-		gcode_position* p_gcode_position = gcode_position_iterator->second;
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
 
 		return p_gcode_position->get_current_position().to_py_dict();
 	}
 
 	static PyObject* GetPreviousPositionTuple(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
-		octolapse_log(
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
 			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
 			"Getting previous position tuple."
 		);
@@ -585,20 +1441,47 @@ extern "C"
 			return NULL;
 		}
 		// Get the position processor by key
-		std::map<std::string, gcode_position*>::iterator gcode_position_iterator = gpp::gcode_positions.find(key);
-		if (gcode_position_iterator == gpp::gcode_positions.end())
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
 		{
 			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePositionProcessor.GetPreviousPositionTuple - Could not find a position processor with the given key.");
 			return Py_BuildValue("O", Py_False);
 		}
-		gcode_position* p_gcode_position = gcode_position_iterator->second;
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
 		return p_gcode_position->get_previous_position().to_py_tuple();
 	}
 
+	static PyObject* GetPreviousPositionView(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
+			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
+			"Getting previous position view."
+		);
+		const char * key;
+		if (!PyArg_ParseTuple(args, "s", &key))
+		{
+			std::string message = "GcodePositionProcessor.GetPreviousPositionView - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		// Get the position processor by key
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
+		{
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePositionProcessor.GetPreviousPositionView - Could not find a position processor with the given key.");
+			return Py_BuildValue("O", Py_False);
+		}
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
+		return position_view_create(*p_gcode_position->get_previous_position_ptr());
+	}
+
 	static PyObject* GetPreviousPositionDict(PyObject* self, PyObject *args)
 	{
-		set_internal_log_levels(true);
-		octolapse_log(
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		OCTOLAPSE_LOG(
 			octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
 			"Getting previous position dict."
 		);
@@ -611,19 +1494,249 @@ extern "C"
 		}
 
 		// Get the parser
-		std::map<std::string, gcode_position*>::iterator gcode_position_iterator = gpp::gcode_positions.find(key);
-		if (gcode_position_iterator == gpp::gcode_positions.end())
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (gcode_position_iterator == p_state->gcode_positions.end())
 		{
 			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, "GcodePositionProcessor.GetPreviousPositionDict - Could not find a position processor with the given key.");
 			return Py_BuildValue("O", Py_False);
 		}
-		gcode_position* p_gcode_position = gcode_position_iterator->second;
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
 
 		return p_gcode_position->get_previous_position().to_py_dict();
 	}
+
+	static PyObject* SetLogLevels(PyObject* self, PyObject *args)
+	{
+		long gcode_parser_level;
+		long gcode_position_level;
+		long snapshot_plan_level;
+		if (!PyArg_ParseTuple(args, "lll", &gcode_parser_level, &gcode_position_level, &snapshot_plan_level))
+		{
+			std::string message = "GcodePositionProcessor.SetLogLevels - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		octolapse_set_log_levels(gcode_parser_level, gcode_position_level, snapshot_plan_level);
+		return Py_BuildValue("O", Py_True);
+	}
+
+	static PyObject* InvalidateLogLevels(PyObject* self, PyObject *args)
+	{
+		// The levels will be reloaded from the python loggers on the next call.
+		octolapse_invalidate_log_levels();
+		return Py_BuildValue("O", Py_True);
+	}
+
+	static PyObject* InitializeTrigger(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Initializing native snapshot trigger.");
+		const char* key;
+		PyObject* py_trigger_args;
+		if (!PyArg_ParseTuple(args, "sO", &key, &py_trigger_args))
+		{
+			std::string message = "GcodePositionProcessor.InitializeTrigger - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		snapshot_trigger_args trigger_args;
+		if (!ParseTriggerArgs(py_trigger_args, &trigger_args))
+		{
+			return NULL; // ParseTriggerArgs has taken care of the error message
+		}
+		std::map<std::string, snapshot_trigger*>::iterator trigger_iterator = p_state->snapshot_triggers.find(key);
+		if (trigger_iterator != p_state->snapshot_triggers.end())
+		{
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Existing trigger found, deleting.");
+			delete trigger_iterator->second;
+			p_state->snapshot_triggers.erase(trigger_iterator);
+		}
+		p_state->snapshot_triggers.insert(std::pair<std::string, snapshot_trigger*>(key, new snapshot_trigger(trigger_args)));
+		return Py_BuildValue("O", Py_True);
+	}
+
+	static PyObject* UpdateTrigger(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		const char* key;
+		if (!PyArg_ParseTuple(args, "s", &key))
+		{
+			std::string message = "GcodePositionProcessor.UpdateTrigger - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		std::map<std::string, snapshot_trigger*>::iterator trigger_iterator = p_state->snapshot_triggers.find(key);
+		std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+		if (trigger_iterator == p_state->snapshot_triggers.end() || gcode_position_iterator == p_state->gcode_positions.end())
+		{
+			std::string message = "GcodePositionProcessor.UpdateTrigger - No trigger and position processor were found for the given key: ";
+			message += key;
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		snapshot_trigger* p_trigger = trigger_iterator->second;
+		gcode_position* p_gcode_position = gcode_position_iterator->second.get();
+		if (!p_trigger->update(p_gcode_position->get_current_position_ptr(), p_gcode_position->get_previous_position_ptr()))
+		{
+			// Nothing changed, so python can keep its current state.
+			Py_INCREF(Py_None);
+			return Py_None;
+		}
+		return p_trigger->get_state().to_py_tuple(p_trigger->get_trigger_count());
+	}
+
+	static PyObject* PauseTrigger(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		const char* key;
+		if (!PyArg_ParseTuple(args, "s", &key))
+		{
+			std::string message = "GcodePositionProcessor.PauseTrigger - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		std::map<std::string, snapshot_trigger*>::iterator trigger_iterator = p_state->snapshot_triggers.find(key);
+		if (trigger_iterator == p_state->snapshot_triggers.end())
+		{
+			return Py_BuildValue("O", Py_False);
+		}
+		trigger_iterator->second->pause();
+		return Py_BuildValue("O", Py_True);
+	}
+
+	static PyObject* ResumeTrigger(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		const char* key;
+		if (!PyArg_ParseTuple(args, "s", &key))
+		{
+			std::string message = "GcodePositionProcessor.ResumeTrigger - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+		std::map<std::string, snapshot_trigger*>::iterator trigger_iterator = p_state->snapshot_triggers.find(key);
+		if (trigger_iterator == p_state->snapshot_triggers.end())
+		{
+			return Py_BuildValue("O", Py_False);
+		}
+		trigger_iterator->second->resume();
+		return Py_BuildValue("O", Py_True);
+	}
+
+	static PyObject* InitializeSnapshotGcodeGenerator(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Initializing the snapshot gcode generator.");
+		const char* key;
+		PyObject* py_generator_args;
+		if (!PyArg_ParseTuple(args, "sO", &key, &py_generator_args))
+		{
+			std::string message = "GcodePositionProcessor.InitializeSnapshotGcodeGenerator - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		snapshot_gcode_generator_args generator_args;
+		if (!ParseSnapshotGcodeGeneratorArgs(py_generator_args, &generator_args))
+		{
+			return NULL; // ParseSnapshotGcodeGeneratorArgs has taken care of the error message
+		}
+		std::map<std::string, snapshot_gcode_generator*>::iterator generator_iterator = p_state->snapshot_gcode_generators.find(key);
+		if (generator_iterator != p_state->snapshot_gcode_generators.end())
+		{
+			delete generator_iterator->second;
+			p_state->snapshot_gcode_generators.erase(generator_iterator);
+		}
+		p_state->snapshot_gcode_generators.insert(
+			std::pair<std::string, snapshot_gcode_generator*>(key, new snapshot_gcode_generator(generator_args))
+		);
+		return Py_BuildValue("O", Py_True);
+	}
+
+	static PyObject* GetSnapshotGcode(PyObject* self, PyObject *args)
+	{
+		processor_state* p_state = processor_get_state(self);
+		octolapse_update_log_levels();
+		const char* key;
+		PyObject* py_snapshot_plan;
+		PyObject* py_g90_influences_extruder;
+		PyObject* py_disable_z_lift;
+		if (!PyArg_ParseTuple(args, "sOOO", &key, &py_snapshot_plan, &py_g90_influences_extruder, &py_disable_z_lift))
+		{
+			std::string message = "GcodePositionProcessor.GetSnapshotGcode - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		std::map<std::string, snapshot_gcode_generator*>::iterator generator_iterator = p_state->snapshot_gcode_generators.find(key);
+		if (generator_iterator == p_state->snapshot_gcode_generators.end())
+		{
+			std::string message = "GcodePositionProcessor.GetSnapshotGcode - No snapshot gcode generator was found for the given key: ";
+			message += key;
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		snapshot_plan plan;
+		if (!ParseSnapshotPlanObject(py_snapshot_plan, &plan))
+		{
+			return NULL; // ParseSnapshotPlanObject has taken care of the error message
+		}
+		snapshot_gcode gcode;
+		if (!generator_iterator->second->create_gcode(
+			plan, PyLong_AsLong(py_g90_influences_extruder) > 0, PyLong_AsLong(py_disable_z_lift) > 0, gcode
+		))
+		{
+			Py_INCREF(Py_None);
+			return Py_None;
+		}
+		return gcode.to_py_object();
+	}
+
+	static PyObject* ExtractSlicerSettings(PyObject* self, PyObject *args)
+	{
+		octolapse_update_log_levels();
+		const char* file_path;
+		PyObject* py_tables;
+		if (!PyArg_ParseTuple(args, "sO", &file_path, &py_tables))
+		{
+			std::string message = "GcodePositionProcessor.ExtractSlicerSettings - Error parsing parameters.";
+			octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+			return NULL;
+		}
+		std::vector<slicer_settings_table> tables;
+		if (!ParseSlicerSettingsTables(py_tables, tables))
+		{
+			return NULL; // ParseSlicerSettingsTables has taken care of the error message
+		}
+		slicer_settings_extractor extractor(tables);
+		const std::string path = file_path;
+		bool success;
+		// The file scan only needs python for logging, which acquires the GIL itself.
+		Py_BEGIN_ALLOW_THREADS
+		success = extractor.extract(path);
+		Py_END_ALLOW_THREADS
+		if (!success)
+		{
+			std::string message = "GcodePositionProcessor.ExtractSlicerSettings - Unable to open the gcode file: ";
+			message += path;
+			octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+			return NULL;
+		}
+		return extractor.to_py_object();
+	}
 }
 
 static bool ExecuteStabilizationProgressCallback(PyObject* progress_callback, const double percent_complete, const double seconds_elapsed, const double estimated_seconds_remaining, const int gcodes_processed, const int lines_processed)
+{
+	// Snapshot plan preprocessing runs without the GIL, so acquire it before touching any python objects.
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	bool continue_processing = ExecuteStabilizationProgressCallbackWithGil(progress_callback, percent_complete, seconds_elapsed, estimated_seconds_remaining, gcodes_processed, lines_processed);
+	PyGILState_Release(gstate);
+	return continue_processing;
+}
+
+static bool ExecuteStabilizationProgressCallbackWithGil(PyObject* progress_callback, const double percent_complete, const double seconds_elapsed, const double estimated_seconds_remaining, const int gcodes_processed, const int lines_processed)
 {
 	//octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::VERBOSE, "Executing the stabilization progress callback.");
 	PyObject * funcArgs = Py_BuildValue("(d,d,d,i,i)", percent_complete, seconds_elapsed, estimated_seconds_remaining, gcodes_processed, lines_processed);
@@ -634,10 +1747,7 @@ static bool ExecuteStabilizationProgressCallback(PyObject* progress_callback, co
 		return false;
 	}
 
-
-	PyGILState_STATE gstate = PyGILState_Ensure();
 	PyObject * pContinueProcessing = PyObject_CallObject(progress_callback, funcArgs);
-	PyGILState_Release(gstate);
 
 	Py_DECREF(funcArgs);
 
@@ -654,7 +1764,59 @@ static bool ExecuteStabilizationProgressCallback(PyObject* progress_callback, co
 
 }
 
-static bool ExecuteGetSnapshotPositionCallback(PyObject* py_get_snapshot_position_callback, double x_initial, double y_initial, double& x_result, double& y_result )
+static bool ExecuteSnapshotPlansCallback(PyObject* py_snapshot_plans_callback, std::vector<snapshot_plan>& plans)
+{
+	// Snapshot plan preprocessing runs without the GIL, so acquire it before touching any python objects.
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	bool success = ExecuteSnapshotPlansCallbackWithGil(py_snapshot_plans_callback, plans);
+	PyGILState_Release(gstate);
+	return success;
+}
+
+static bool ExecuteSnapshotPlansCallbackWithGil(PyObject* py_snapshot_plans_callback, std::vector<snapshot_plan>& plans)
+{
+	PyObject * py_snapshot_plans = snapshot_plan::build_py_object(plans);
+	if (py_snapshot_plans == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ExecuteSnapshotPlansCallback - Unable to convert the snapshot plans.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	PyObject * funcArgs = Py_BuildValue("(O)", py_snapshot_plans);
+	Py_DECREF(py_snapshot_plans);
+	if (funcArgs == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ExecuteSnapshotPlansCallback - Error parsing parameters.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+
+	PyObject * py_result = PyObject_CallObject(py_snapshot_plans_callback, funcArgs);
+
+	Py_DECREF(funcArgs);
+
+	if (py_result == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ExecuteSnapshotPlansCallback - Failed to call python snapshot plans callback.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		// Processing is cancelled and the results are still returned, so the exception must not stay set.
+		PyErr_Clear();
+		return false;
+	}
+	Py_DECREF(py_result);
+	return true;
+}
+
+static bool ExecuteGetSnapshotPositionCallback(PyObject* py_get_snapshot_position_callback, double x_initial, double y_initial, double& x_result, double& y_result )
+{
+	// Snapshot plan preprocessing runs without the GIL, so acquire it before touching any python objects.
+	PyGILState_STATE gstate = PyGILState_Ensure();
+	bool success = ExecuteGetSnapshotPositionCallbackWithGil(py_get_snapshot_position_callback, x_initial, y_initial, x_result, y_result);
+	PyGILState_Release(gstate);
+	return success;
+}
+
+static bool ExecuteGetSnapshotPositionCallbackWithGil(PyObject* py_get_snapshot_position_callback, double x_initial, double y_initial, double& x_result, double& y_result)
 {
 	//octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::VERBOSE, "Executing the get_snapshot_position callback.");
 	PyObject * funcArgs = Py_BuildValue("(d,d)", x_initial, y_initial);
@@ -665,10 +1827,7 @@ static bool ExecuteGetSnapshotPositionCallback(PyObject* py_get_snapshot_positio
 		return false;
 	}
 
-
-	PyGILState_STATE gstate = PyGILState_Ensure();
 	PyObject * pyCoordinates = PyObject_CallObject(py_get_snapshot_position_callback, funcArgs);
-	PyGILState_Release(gstate);
 
 	Py_DECREF(funcArgs);
 
@@ -683,6 +1842,7 @@ static bool ExecuteGetSnapshotPositionCallback(PyObject* py_get_snapshot_positio
 	{
 		std::string message = "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Failed to parse the return x value.";
 		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		Py_DECREF(pyCoordinates);
 		return false;
 	}
 	x_result = PyFloatOrInt_AsDouble(pyX);
@@ -691,6 +1851,7 @@ static bool ExecuteGetSnapshotPositionCallback(PyObject* py_get_snapshot_positio
 	{
 		std::string message = "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Failed to parse the return y value.";
 		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		Py_DECREF(pyCoordinates);
 		return false;
 	}
 	y_result = PyFloatOrInt_AsDouble(pyY);
@@ -1015,7 +2176,15 @@ static bool ParsePositionArgs(PyObject *py_args, gcode_position_args *args)
 		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
 		return false;
 	}
-	args->set_num_extruders(PyLong_AsLong(py_num_extruders));
+	const long num_extruders = PyLong_AsLong(py_num_extruders);
+	if (num_extruders > MAX_EXTRUDERS)
+	{
+		std::stringstream stream;
+		stream << "GcodePositionProcessor.ParsePositionArgs - Too many extruders were requested.  No more than " << MAX_EXTRUDERS << " extruders are supported.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, stream.str());
+		return false;
+	}
+	args->set_num_extruders(num_extruders);
 
 	// py_shared_extruder
 	PyObject * py_shared_extruder = PyDict_GetItemString(py_args, "shared_extruder");
@@ -1278,10 +2447,77 @@ static bool ParsePositionArgs(PyObject *py_args, gcode_position_args *args)
 		return false;
 	}
 	args->g90_influences_extruder = PyLong_AsLong(py_g90_influences_extruder) > 0;
+
+	// lock_slicer_from_header - optional, the slicer is detected from the section comments if it is missing
+	PyObject * py_lock_slicer_from_header = PyDict_GetItemString(py_args, "lock_slicer_from_header");
+	if (py_lock_slicer_from_header != NULL)
+		args->lock_slicer_from_header = PyLong_AsLong(py_lock_slicer_from_header) > 0;
+
+	// tracking_mask - optional, the POSITION_TRACKING_ flags for the parts of the position to track, all of them if missing
+	PyObject * py_tracking_mask = PyDict_GetItemString(py_args, "tracking_mask");
+	if (py_tracking_mask != NULL)
+		args->tracking_mask = static_cast<int>(PyLong_AsLong(py_tracking_mask));
 	
 	return true;
 }
 
+static bool ParseSnapshotPlansCallback(PyObject *py_args, PyObject** p_py_snapshot_plans_callback)
+{
+	// on_snapshot_plans_received - optional, the plans are returned with the results if it is missing or None
+	*p_py_snapshot_plans_callback = NULL;
+	PyObject * py_on_snapshot_plans_received = PyDict_GetItemString(py_args, "on_snapshot_plans_received");
+	if (py_on_snapshot_plans_received == NULL || py_on_snapshot_plans_received == Py_None)
+		return true;
+	if (!PyCallable_Check(py_on_snapshot_plans_received))
+	{
+		std::string message = "GcodePositionProcessor.ParseSnapshotPlansCallback - on_snapshot_plans_received must be callable.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	// need to incref this so it doesn't vanish later (borrowed reference we are saving)
+	Py_IncRef(py_on_snapshot_plans_received);
+	*p_py_snapshot_plans_callback = py_on_snapshot_plans_received;
+	return true;
+}
+
+static bool ParseProcessingProgress(PyObject *py_args, PyObject** p_py_progress)
+{
+	// progress - optional, a ProcessingProgress that can be read and cancelled from any thread
+	*p_py_progress = NULL;
+	PyObject * py_progress = PyDict_GetItemString(py_args, "progress");
+	if (py_progress == NULL || py_progress == Py_None)
+		return true;
+	if (processing_progress_get(py_progress) == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseProcessingProgress - progress must be a ProcessingProgress.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	// need to incref this so it doesn't vanish later (borrowed reference we are saving)
+	Py_IncRef(py_progress);
+	*p_py_progress = py_progress;
+	return true;
+}
+
+static bool ParseToolpath(PyObject *py_args, PyObject** p_py_toolpath)
+{
+	// toolpath - optional, a Toolpath that records the decimated toolpath of the file
+	*p_py_toolpath = NULL;
+	PyObject * py_toolpath = PyDict_GetItemString(py_args, "toolpath");
+	if (py_toolpath == NULL || py_toolpath == Py_None)
+		return true;
+	if (!PyObject_TypeCheck(py_toolpath, &toolpath_type))
+	{
+		std::string message = "GcodePositionProcessor.ParseToolpath - toolpath must be a Toolpath.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	// need to incref this so it doesn't vanish later (borrowed reference we are saving)
+	Py_IncRef(py_toolpath);
+	*p_py_toolpath = py_toolpath;
+	return true;
+}
+
 static bool ParseStabilizationArgs(PyObject *py_args, stabilization_args* args, PyObject ** py_progress_callback, PyObject** py_snapshot_position_callback)
 {
 	octolapse_log(
@@ -1316,7 +2552,7 @@ static bool ParseStabilizationArgs(PyObject *py_args, stabilization_args* args,
 	}
 	// py_get_snapshot_position_callback is a new reference, no reason to incref
 	*py_snapshot_position_callback = py_get_snapshot_position_callback;
-	// on_progress_received
+	// on_progress_received - may be None when the progress is read from a ProcessingProgress instead
 	PyObject * py_on_progress_received = PyDict_GetItemString(py_args, "on_progress_received");
 	if (py_on_progress_received == NULL)
 	{
@@ -1324,9 +2560,12 @@ static bool ParseStabilizationArgs(PyObject *py_args, stabilization_args* args,
 		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
 		return false;
 	}
-	// need to incref this so it doesn't vanish later (borrowed reference we are saving)
-	Py_IncRef(py_on_progress_received);
-	*py_progress_callback = py_on_progress_received;
+	if (py_on_progress_received != Py_None)
+	{
+		// need to incref this so it doesn't vanish later (borrowed reference we are saving)
+		Py_IncRef(py_on_progress_received);
+		*py_progress_callback = py_on_progress_received;
+	}
 
 
 	// height_increment
@@ -1379,6 +2618,32 @@ static bool ParseStabilizationArgs(PyObject *py_args, stabilization_args* args,
 		return false;
 	}
 	args->file_path = PyUnicode_SafeAsString(py_file_path);
+
+	// cache_directory - optional, the snapshot plan cache is disabled if it is missing or None
+	PyObject * py_cache_directory = PyDict_GetItemString(py_args, "cache_directory");
+	if (py_cache_directory != NULL && py_cache_directory != Py_None)
+	{
+		args->cache_directory = PyUnicode_SafeAsString(py_cache_directory);
+	}
+
+	// cache_key - optional
+	PyObject * py_cache_key = PyDict_GetItemString(py_args, "cache_key");
+	if (py_cache_key != NULL && py_cache_key != Py_None)
+	{
+		args->cache_key = PyUnicode_SafeAsString(py_cache_key);
+	}
+	// trace_directory - optional
+	PyObject * py_trace_directory = PyDict_GetItemString(py_args, "trace_directory");
+	if (py_trace_directory != NULL && py_trace_directory != Py_None)
+	{
+		args->trace_directory = PyUnicode_SafeAsString(py_trace_directory);
+	}
+	// checkpoint_directory - optional
+	PyObject * py_checkpoint_directory = PyDict_GetItemString(py_args, "checkpoint_directory");
+	if (py_checkpoint_directory != NULL && py_checkpoint_directory != Py_None)
+	{
+		args->checkpoint_directory = PyUnicode_SafeAsString(py_checkpoint_directory);
+	}
 	//std::cout << "Stabilization Args parsed successfully.\r\n";
 	return true;
 }
@@ -1421,6 +2686,68 @@ static bool ParseStabilizationArgs_SmartLayer(PyObject *py_args, smart_layer_arg
 	return true;
 }
 
+static bool ParseStabilizationArgs_SmartTimer(PyObject *py_args, smart_timer_args* args)
+{
+	octolapse_log(
+		octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO,
+		"Parsing Smart Timer Stabilization Args."
+	);
+	PyObject * py_trigger_type = PyDict_GetItemString(py_args, "trigger_type");
+	if (py_trigger_type == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseStabilizationArgs_SmartTimer - Unable to retrieve trigger_type from the smart timer trigger stabilization args.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	args->smart_timer_trigger_type = static_cast<trigger_type>(PyLong_AsLong(py_trigger_type));
+
+	PyObject * py_snap_to_print_high_quality = PyDict_GetItemString(py_args, "snap_to_print_high_quality");
+	if (py_snap_to_print_high_quality == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseStabilizationArgs_SmartTimer - Unable to retrieve snap_to_print_high_quality from the smart timer trigger stabilization args.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	args->snap_to_print_high_quality = PyLong_AsLong(py_snap_to_print_high_quality) > 0;
+
+	PyObject * py_snap_to_print_smooth = PyDict_GetItemString(py_args, "snap_to_print_smooth");
+	if (py_snap_to_print_smooth == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseStabilizationArgs_SmartTimer - Unable to retrieve snap_to_print_smooth from the smart timer trigger stabilization args.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	args->snap_to_print_smooth = PyLong_AsLong(py_snap_to_print_smooth) > 0;
+
+	PyObject * py_interval_seconds = PyDict_GetItemString(py_args, "interval_seconds");
+	if (py_interval_seconds == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseStabilizationArgs_SmartTimer - Unable to retrieve interval_seconds from the smart timer trigger stabilization args.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	args->interval_seconds = PyFloatOrInt_AsDouble(py_interval_seconds);
+	if (!(args->interval_seconds > 0))
+	{
+		std::string message = "GcodePositionProcessor.ParseStabilizationArgs_SmartTimer - The interval_seconds must be greater than 0.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+
+	// search_seconds, acceleration and jerk - optional, the defaults are used if they are missing
+	PyObject * py_search_seconds = PyDict_GetItemString(py_args, "search_seconds");
+	if (py_search_seconds != NULL)
+		args->search_seconds = PyFloatOrInt_AsDouble(py_search_seconds);
+	PyObject * py_acceleration = PyDict_GetItemString(py_args, "acceleration");
+	if (py_acceleration != NULL)
+		args->time_estimator_args.acceleration = PyFloatOrInt_AsDouble(py_acceleration);
+	PyObject * py_jerk = PyDict_GetItemString(py_args, "jerk");
+	if (py_jerk != NULL)
+		args->time_estimator_args.jerk = PyFloatOrInt_AsDouble(py_jerk);
+
+	return true;
+}
+
 static bool ParseStabilizationArgs_SmartGcode(PyObject *py_args, smart_gcode_args* args)
 {
 	octolapse_log(
@@ -1458,3 +2785,417 @@ static bool ParseStabilizationArgs_SmartGcode(PyObject *py_args, smart_gcode_arg
 
 	return true;
 }
+
+static bool ParseTriggerArgs(PyObject *py_args, snapshot_trigger_args* args)
+{
+	octolapse_log(
+		octolapse_log::GCODE_POSITION, octolapse_log::DEBUG,
+		"Parsing Trigger Args."
+	);
+	PyObject * py_type = PyDict_GetItemString(py_args, "type");
+	if (py_type == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseTriggerArgs - Unable to retrieve type from the trigger args dict.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	const char* type = PyUnicode_SafeAsString(py_type);
+	if (strcmp(type, "layer") == 0)
+		args->type = snapshot_trigger_type_layer;
+	else if (strcmp(type, "timer") == 0)
+		args->type = snapshot_trigger_type_timer;
+	else if (strcmp(type, "gcode") == 0)
+		args->type = snapshot_trigger_type_gcode;
+	else
+	{
+		std::string message = "GcodePositionProcessor.ParseTriggerArgs - Unknown trigger type: ";
+		message += type;
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+
+	PyObject * py_require_zhop = PyDict_GetItemString(py_args, "require_zhop");
+	if (py_require_zhop == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseTriggerArgs - Unable to retrieve require_zhop from the trigger args dict.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	args->require_zhop = PyLong_AsLong(py_require_zhop) > 0;
+
+	PyObject * py_height_increment = PyDict_GetItemString(py_args, "height_increment");
+	if (py_height_increment == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseTriggerArgs - Unable to retrieve height_increment from the trigger args dict.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	args->height_increment = PyFloatOrInt_AsDouble(py_height_increment);
+
+	PyObject * py_interval_seconds = PyDict_GetItemString(py_args, "interval_seconds");
+	if (py_interval_seconds == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseTriggerArgs - Unable to retrieve interval_seconds from the trigger args dict.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	args->interval_seconds = PyFloatOrInt_AsDouble(py_interval_seconds);
+
+	PyObject * py_snapshot_command = PyDict_GetItemString(py_args, "snapshot_command");
+	if (py_snapshot_command == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseTriggerArgs - Unable to retrieve snapshot_command from the trigger args dict.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	// Parse the alternative snapshot command once so that each update only needs to compare the gcode
+	parsed_command snapshot_command;
+	gcode_parser parser;
+	parser.try_parse_gcode(PyUnicode_SafeAsString(py_snapshot_command), snapshot_command);
+	args->snapshot_command_gcode = snapshot_command.gcode;
+
+	PyObject * py_extruder_state_requirements_enabled = PyDict_GetItemString(py_args, "extruder_state_requirements_enabled");
+	if (py_extruder_state_requirements_enabled == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseTriggerArgs - Unable to retrieve extruder_state_requirements_enabled from the trigger args dict.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	args->extruder_state_requirements_enabled = PyLong_AsLong(py_extruder_state_requirements_enabled) > 0;
+
+	// A list of None (ignore), True (required) or False (forbidden) in the order of extruder_trigger
+	PyObject * py_extruder_triggers = PyDict_GetItemString(py_args, "extruder_triggers");
+	if (py_extruder_triggers == NULL || !PyList_Check(py_extruder_triggers) || PyList_Size(py_extruder_triggers) != NUM_EXTRUDER_TRIGGERS)
+	{
+		std::string message = "GcodePositionProcessor.ParseTriggerArgs - Unable to retrieve a list of extruder_triggers from the trigger args dict.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	for (int index = 0; index < NUM_EXTRUDER_TRIGGERS; index++)
+	{
+		PyObject * py_extruder_trigger = PyList_GetItem(py_extruder_triggers, index);
+		if (py_extruder_trigger == Py_None)
+			args->extruder_triggers[index] = extruder_trigger_option_ignore;
+		else if (PyLong_AsLong(py_extruder_trigger) > 0)
+			args->extruder_triggers[index] = extruder_trigger_option_required;
+		else
+			args->extruder_triggers[index] = extruder_trigger_option_forbidden;
+	}
+	return true;
+}
+
+static bool ParseSnapshotGcodeGeneratorArgs(PyObject *py_args, snapshot_gcode_generator_args* args)
+{
+	octolapse_log(
+		octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
+		"Parsing Snapshot Gcode Generator Args."
+	);
+	PyObject * py_axis_mode_compatibility = PyDict_GetItemString(py_args, "axis_mode_compatibility");
+	if (py_axis_mode_compatibility == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseSnapshotGcodeGeneratorArgs - Unable to retrieve axis_mode_compatibility from the generator args dict.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	args->axis_mode_compatibility = PyLong_AsLong(py_axis_mode_compatibility) > 0;
+
+	PyObject * py_wait_for_moves_to_finish = PyDict_GetItemString(py_args, "wait_for_moves_to_finish");
+	if (py_wait_for_moves_to_finish == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseSnapshotGcodeGeneratorArgs - Unable to retrieve wait_for_moves_to_finish from the generator args dict.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	args->wait_for_moves_to_finish = PyLong_AsLong(py_wait_for_moves_to_finish) > 0;
+
+	PyObject * py_max_z = PyDict_GetItemString(py_args, "max_z");
+	if (py_max_z == NULL)
+	{
+		std::string message = "GcodePositionProcessor.ParseSnapshotGcodeGeneratorArgs - Unable to retrieve max_z from the generator args dict.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	args->max_z = PyFloatOrInt_AsDouble(py_max_z);
+
+	PyObject * py_extruders = PyDict_GetItemString(py_args, "extruders");
+	if (py_extruders == NULL || !PyList_Check(py_extruders))
+	{
+		std::string message = "GcodePositionProcessor.ParseSnapshotGcodeGeneratorArgs - Unable to retrieve the extruders list from the generator args dict.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	const Py_ssize_t num_extruders = PyList_Size(py_extruders);
+	for (Py_ssize_t index = 0; index < num_extruders; index++)
+	{
+		PyObject * py_extruder = PyList_GetItem(py_extruders, index);
+		PyObject * py_x_y_travel_speed = PyDict_GetItemString(py_extruder, "x_y_travel_speed");
+		PyObject * py_z_lift_speed = PyDict_GetItemString(py_extruder, "z_lift_speed");
+		PyObject * py_retraction_speed = PyDict_GetItemString(py_extruder, "retraction_speed");
+		PyObject * py_deretraction_speed = PyDict_GetItemString(py_extruder, "deretraction_speed");
+		PyObject * py_retract_before_move = PyDict_GetItemString(py_extruder, "retract_before_move");
+		PyObject * py_retraction_length = PyDict_GetItemString(py_extruder, "retraction_length");
+		PyObject * py_lift_when_retracted = PyDict_GetItemString(py_extruder, "lift_when_retracted");
+		PyObject * py_z_lift_height = PyDict_GetItemString(py_extruder, "z_lift_height");
+		if (
+			py_x_y_travel_speed == NULL || py_z_lift_speed == NULL || py_retraction_speed == NULL
+			|| py_deretraction_speed == NULL || py_retract_before_move == NULL || py_retraction_length == NULL
+			|| py_lift_when_retracted == NULL || py_z_lift_height == NULL
+		)
+		{
+			std::string message = "GcodePositionProcessor.ParseSnapshotGcodeGeneratorArgs - Unable to retrieve the gcode generation settings for an extruder.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return false;
+		}
+		snapshot_gcode_extruder_args extruder_args;
+		extruder_args.x_y_travel_speed = py_x_y_travel_speed == Py_None ? SNAPSHOT_GCODE_NO_FEEDRATE : PyFloatOrInt_AsDouble(py_x_y_travel_speed);
+		extruder_args.z_lift_speed = py_z_lift_speed == Py_None ? SNAPSHOT_GCODE_NO_FEEDRATE : PyFloatOrInt_AsDouble(py_z_lift_speed);
+		extruder_args.retraction_speed = py_retraction_speed == Py_None ? SNAPSHOT_GCODE_NO_FEEDRATE : PyFloatOrInt_AsDouble(py_retraction_speed);
+		extruder_args.deretraction_speed = py_deretraction_speed == Py_None ? SNAPSHOT_GCODE_NO_FEEDRATE : PyFloatOrInt_AsDouble(py_deretraction_speed);
+		extruder_args.retract_before_move = PyLong_AsLong(py_retract_before_move) > 0;
+		extruder_args.retraction_length = PyFloatOrInt_AsDouble(py_retraction_length);
+		extruder_args.lift_when_retracted = PyLong_AsLong(py_lift_when_retracted) > 0;
+		extruder_args.z_lift_height = PyFloatOrInt_AsDouble(py_z_lift_height);
+		args->extruders.push_back(extruder_args);
+	}
+	return true;
+}
+
+// Reads a float attribute that may be None.  Returns false if the attribute does not exist.
+static bool GetOptionalDoubleAttr(PyObject* py_object, const char* name, double& value, bool& is_null)
+{
+	PyObject* py_value = PyObject_GetAttrString(py_object, name);
+	if (py_value == NULL)
+		return false;
+	is_null = py_value == Py_None;
+	value = is_null ? 0 : PyFloatOrInt_AsDouble(py_value);
+	Py_DECREF(py_value);
+	return true;
+}
+
+static bool GetOptionalBoolAttr(PyObject* py_object, const char* name, bool& value, bool& is_null)
+{
+	PyObject* py_value = PyObject_GetAttrString(py_object, name);
+	if (py_value == NULL)
+		return false;
+	is_null = py_value == Py_None;
+	value = !is_null && PyLong_AsLong(py_value) > 0;
+	Py_DECREF(py_value);
+	return true;
+}
+
+// Copies the values used to generate snapshot gcode from a python Pos object.
+static bool ParseSnapshotPlanPosition(PyObject *py_position, position* pos)
+{
+	bool is_null;
+	bool success = GetOptionalDoubleAttr(py_position, "x", pos->x, pos->x_null)
+		&& GetOptionalDoubleAttr(py_position, "y", pos->y, pos->y_null)
+		&& GetOptionalDoubleAttr(py_position, "z", pos->z, pos->z_null)
+		&& GetOptionalDoubleAttr(py_position, "f", pos->f, pos->f_null)
+		&& GetOptionalDoubleAttr(py_position, "x_offset", pos->x_offset, is_null)
+		&& GetOptionalDoubleAttr(py_position, "y_offset", pos->y_offset, is_null)
+		&& GetOptionalDoubleAttr(py_position, "z_offset", pos->z_offset, is_null)
+		&& GetOptionalDoubleAttr(py_position, "x_firmware_offset", pos->x_firmware_offset, is_null)
+		&& GetOptionalDoubleAttr(py_position, "y_firmware_offset", pos->y_firmware_offset, is_null)
+		&& GetOptionalDoubleAttr(py_position, "z_firmware_offset", pos->z_firmware_offset, is_null)
+		&& GetOptionalDoubleAttr(py_position, "last_extrusion_height", pos->last_extrusion_height, pos->last_extrusion_height_null)
+		&& GetOptionalBoolAttr(py_position, "is_relative", pos->is_relative, pos->is_relative_null)
+		&& GetOptionalBoolAttr(py_position, "is_extruder_relative", pos->is_extruder_relative, pos->is_extruder_relative_null)
+		&& GetOptionalBoolAttr(py_position, "is_metric", pos->is_metric, pos->is_metric_null);
+	double current_tool = 0;
+	success = success && GetOptionalDoubleAttr(py_position, "current_tool", current_tool, is_null);
+	pos->current_tool = static_cast<int>(current_tool);
+
+	PyObject* py_extruders = success ? PyObject_GetAttrString(py_position, "extruders") : NULL;
+	if (py_extruders == NULL || !PyList_Check(py_extruders) || PyList_Size(py_extruders) < 1)
+	{
+		Py_XDECREF(py_extruders);
+		PyErr_Clear();
+		std::string message = "GcodePositionProcessor.ParseSnapshotPlanPosition - Unable to read the snapshot plan position.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	int num_extruders = static_cast<int>(PyList_Size(py_extruders));
+	if (num_extruders > MAX_EXTRUDERS)
+		num_extruders = MAX_EXTRUDERS;
+	pos->set_num_extruders(num_extruders);
+	for (int index = 0; index < num_extruders; index++)
+	{
+		PyObject* py_extruder = PyList_GetItem(py_extruders, index);
+		extruder& current_extruder = pos->get_extruder(index);
+		if (
+			!GetOptionalDoubleAttr(py_extruder, "e", current_extruder.e, is_null)
+			|| !GetOptionalDoubleAttr(py_extruder, "e_offset", current_extruder.e_offset, is_null)
+			|| !GetOptionalDoubleAttr(py_extruder, "retraction_length", current_extruder.retraction_length, is_null)
+		)
+		{
+			Py_DECREF(py_extruders);
+			PyErr_Clear();
+			std::string message = "GcodePositionProcessor.ParseSnapshotPlanPosition - Unable to read the snapshot plan extruders.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return false;
+		}
+	}
+	Py_DECREF(py_extruders);
+	pos->is_empty = false;
+	return true;
+}
+
+// Parses the gcode of a python ParsedCommand, which may be None.
+static bool ParseSnapshotPlanCommand(PyObject *py_snapshot_plan, const char* name, parsed_command* command)
+{
+	PyObject* py_command = PyObject_GetAttrString(py_snapshot_plan, name);
+	if (py_command == NULL)
+	{
+		PyErr_Clear();
+		std::string message = "GcodePositionProcessor.ParseSnapshotPlanCommand - Unable to retrieve the command: ";
+		message += name;
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	if (py_command != Py_None)
+	{
+		PyObject* py_gcode = PyObject_GetAttrString(py_command, "gcode");
+		if (py_gcode == NULL)
+		{
+			Py_DECREF(py_command);
+			PyErr_Clear();
+			std::string message = "GcodePositionProcessor.ParseSnapshotPlanCommand - Unable to retrieve the gcode of the command: ";
+			message += name;
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return false;
+		}
+		if (py_gcode != Py_None)
+		{
+			gcode_parser parser;
+			parser.try_parse_gcode(PyUnicode_SafeAsString(py_gcode), *command);
+		}
+		Py_DECREF(py_gcode);
+	}
+	Py_DECREF(py_command);
+	return true;
+}
+
+static bool ParseSnapshotPlanObject(PyObject *py_snapshot_plan, snapshot_plan* plan)
+{
+	PyObject* py_initial_position = PyObject_GetAttrString(py_snapshot_plan, "initial_position");
+	PyObject* py_return_position = PyObject_GetAttrString(py_snapshot_plan, "return_position");
+	PyObject* py_steps = PyObject_GetAttrString(py_snapshot_plan, "steps");
+	bool success = py_initial_position != NULL && py_initial_position != Py_None
+		&& py_return_position != NULL && py_steps != NULL && PyList_Check(py_steps);
+	if (!success)
+	{
+		PyErr_Clear();
+		std::string message = "GcodePositionProcessor.ParseSnapshotPlanObject - The snapshot plan does not have an initial position, return position and steps.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+	}
+	success = success && ParseSnapshotPlanPosition(py_initial_position, &plan->initial_position);
+	plan->has_initial_position = success;
+	if (success && py_return_position != Py_None)
+		success = ParseSnapshotPlanPosition(py_return_position, &plan->return_position);
+	success = success
+		&& ParseSnapshotPlanCommand(py_snapshot_plan, "start_command", &plan->start_command)
+		&& ParseSnapshotPlanCommand(py_snapshot_plan, "end_command", &plan->end_command);
+	const Py_ssize_t num_steps = success ? PyList_Size(py_steps) : 0;
+	for (Py_ssize_t index = 0; success && index < num_steps; index++)
+	{
+		PyObject* py_step = PyList_GetItem(py_steps, index);
+		PyObject* py_action = PyObject_GetAttrString(py_step, "action");
+		double x, y;
+		bool x_null, y_null;
+		if (
+			py_action == NULL
+			|| !GetOptionalDoubleAttr(py_step, "x", x, x_null)
+			|| !GetOptionalDoubleAttr(py_step, "y", y, y_null)
+		)
+		{
+			Py_XDECREF(py_action);
+			PyErr_Clear();
+			std::string message = "GcodePositionProcessor.ParseSnapshotPlanObject - Unable to read a snapshot plan step.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			success = false;
+			break;
+		}
+		plan->steps.push_back(snapshot_plan_step(x_null ? NULL : &x, y_null ? NULL : &y, NULL, NULL, NULL, PyUnicode_SafeAsString(py_action)));
+		Py_DECREF(py_action);
+	}
+	Py_XDECREF(py_initial_position);
+	Py_XDECREF(py_return_position);
+	Py_XDECREF(py_steps);
+	return success;
+}
+
+static bool ParseSlicerSettingsKeys(PyObject *py_table, const char* name, std::vector<std::string>& keys)
+{
+	PyObject * py_keys = PyDict_GetItemString(py_table, name);
+	if (py_keys == NULL || !PyList_Check(py_keys))
+	{
+		std::string message = "GcodePositionProcessor.ParseSlicerSettingsKeys - Unable to retrieve the key list: ";
+		message += name;
+		octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+		return false;
+	}
+	const Py_ssize_t num_keys = PyList_Size(py_keys);
+	for (Py_ssize_t index = 0; index < num_keys; index++)
+	{
+		const char* key = PyUnicode_SafeAsString(PyList_GetItem(py_keys, index));
+		if (key == NULL)
+		{
+			std::string message = "GcodePositionProcessor.ParseSlicerSettingsKeys - A key is not a string: ";
+			message += name;
+			octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+			return false;
+		}
+		keys.push_back(key);
+	}
+	return true;
+}
+
+static bool ParseSlicerSettingsTables(PyObject *py_tables, std::vector<slicer_settings_table>& tables)
+{
+	if (!PyList_Check(py_tables))
+	{
+		std::string message = "GcodePositionProcessor.ParseSlicerSettingsTables - The slicer settings tables must be a list.";
+		octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+		return false;
+	}
+	const Py_ssize_t num_tables = PyList_Size(py_tables);
+	for (Py_ssize_t index = 0; index < num_tables; index++)
+	{
+		PyObject * py_table = PyList_GetItem(py_tables, index);
+		PyObject * py_name = PyDict_GetItemString(py_table, "name");
+		PyObject * py_setting_format = PyDict_GetItemString(py_table, "setting_format");
+		PyObject * py_version_format = PyDict_GetItemString(py_table, "version_format");
+		PyObject * py_search_forward = PyDict_GetItemString(py_table, "search_forward");
+		PyObject * py_search_reverse = PyDict_GetItemString(py_table, "search_reverse");
+		PyObject * py_max_forward_lines = PyDict_GetItemString(py_table, "max_forward_lines");
+		PyObject * py_max_reverse_lines = PyDict_GetItemString(py_table, "max_reverse_lines");
+		if (
+			py_name == NULL || py_setting_format == NULL || py_version_format == NULL || py_search_forward == NULL
+			|| py_search_reverse == NULL || py_max_forward_lines == NULL || py_max_reverse_lines == NULL
+		)
+		{
+			std::string message = "GcodePositionProcessor.ParseSlicerSettingsTables - Unable to retrieve the slicer settings table values.";
+			octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+			return false;
+		}
+		slicer_settings_table table;
+		const char* name = PyUnicode_SafeAsString(py_name);
+		if (name == NULL)
+		{
+			std::string message = "GcodePositionProcessor.ParseSlicerSettingsTables - The slicer name must be a string.";
+			octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+			return false;
+		}
+		table.name = name;
+		table.setting_format = static_cast<slicer_setting_format>(PyIntOrLong_AsLong(py_setting_format));
+		table.version_format = static_cast<slicer_version_format>(PyIntOrLong_AsLong(py_version_format));
+		table.search_forward = PyLong_AsLong(py_search_forward) > 0;
+		table.search_reverse = PyLong_AsLong(py_search_reverse) > 0;
+		table.max_forward_lines = static_cast<int>(PyIntOrLong_AsLong(py_max_forward_lines));
+		table.max_reverse_lines = static_cast<int>(PyIntOrLong_AsLong(py_max_reverse_lines));
+		if (!ParseSlicerSettingsKeys(py_table, "keys", table.keys) || !ParseSlicerSettingsKeys(py_table, "ignored_keys", table.ignored_keys))
+			return false;
+		tables.push_back(table);
+	}
+	return true;
+}
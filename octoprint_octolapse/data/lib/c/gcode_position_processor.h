@@ -35,10 +35,32 @@
 #include "stabilization.h"
 #include "stabilization_smart_layer.h"
 #include "stabilization_smart_gcode.h"
-namespace gpp {
-	static std::map<std::string, gcode_position*> gcode_positions;
-	static gcode_parser* parser;
-}
+#include "stabilization_smart_timer.h"
+#include "snapshot_trigger.h"
+#include "snapshot_gcode_generator.h"
+#include "slicer_settings_extractor.h"
+#include "processing_stats.h"
+#include "position_checkpoint.h"
+#include "processor_state.h"
+#include "position_handle.h"
+// Flags telling UpdateBatch what to return.
+enum update_batch_return_type {
+	update_batch_return_position = 1,
+	update_batch_return_line_flags = 2,
+	update_batch_return_layer_changes = 4
+};
+
+// Per-line flags returned by UpdateBatch.
+enum update_batch_line_flag {
+	update_batch_line_has_command = 1,
+	update_batch_line_position_changed = 2,
+	update_batch_line_xy_position_changed = 4,
+	update_batch_line_layer_change = 8,
+	update_batch_line_height_change = 16,
+	update_batch_line_zhop = 32,
+	update_batch_line_xy_travel = 64,
+	update_batch_line_in_bounds = 128
+};
 
 extern "C"
 {
@@ -48,22 +70,57 @@ extern "C"
 	extern "C" void initGcodePositionProcessor(void);
 #endif
 	static PyObject* Initialize(PyObject* self, PyObject *args);
+	static PyObject* GetPositionHandle(PyObject* self, PyObject *args);
+	static PyObject* CreateAsyncTracker(PyObject* self, PyObject *args);
+	static PyObject* CreateProcessingProgress(PyObject* self, PyObject *args);
+	static PyObject* CreateToolpath(PyObject* self, PyObject *args);
+	static PyObject* CreatePlanCursor(PyObject* self, PyObject *args);
+	static PyObject* InitializeFromCheckpoint(PyObject* self, PyObject *args);
 	static PyObject* Undo(PyObject* self, PyObject *args);
 	static PyObject* Update(PyObject* self, PyObject *args);
+	static PyObject* UpdateView(PyObject* self, PyObject *args);
+	static PyObject* UpdateBatch(PyObject* self, PyObject *args);
 	static PyObject* UpdatePosition(PyObject* self, PyObject *args);
 	static PyObject* Parse(PyObject* self, PyObject *args);
 	static PyObject* GetCurrentPositionTuple(PyObject* self, PyObject *args);
 	static PyObject* GetCurrentPositionDict(PyObject* self, PyObject *args);
+	static PyObject* GetCurrentPositionView(PyObject* self, PyObject *args);
 	static PyObject* GetPreviousPositionTuple(PyObject* self, PyObject *args);
+	static PyObject* GetPreviousPositionView(PyObject* self, PyObject *args);
 	static PyObject* GetPreviousPositionDict(PyObject* self, PyObject *args);
 	static PyObject* GetSnapshotPlans_SmartLayer(PyObject *self, PyObject *args);
+	static PyObject* StartSnapshotPlans_SmartLayer(PyObject *self, PyObject *args);
+	static PyObject* GetSnapshotPlans_SmartLayerMultiple(PyObject *self, PyObject *args);
 	static PyObject* GetSnapshotPlans_SmartGcode(PyObject *self, PyObject *args);
+	static PyObject* GetSnapshotPlans_SmartTimer(PyObject *self, PyObject *args);
+	static PyObject* SetLogLevels(PyObject* self, PyObject *args);
+	static PyObject* InvalidateLogLevels(PyObject* self, PyObject *args);
+	static PyObject* InitializeTrigger(PyObject* self, PyObject *args);
+	static PyObject* UpdateTrigger(PyObject* self, PyObject *args);
+	static PyObject* PauseTrigger(PyObject* self, PyObject *args);
+	static PyObject* ResumeTrigger(PyObject* self, PyObject *args);
+	static PyObject* InitializeSnapshotGcodeGenerator(PyObject* self, PyObject *args);
+	static PyObject* GetSnapshotGcode(PyObject* self, PyObject *args);
+	static PyObject* ExtractSlicerSettings(PyObject* self, PyObject *args);
+	static PyObject* GetStats(PyObject* self, PyObject *args);
 }
 static bool ParsePositionArgs(PyObject *py_args, gcode_position_args *args);
 static bool ParseStabilizationArgs(PyObject *py_args, stabilization_args* args, PyObject** p_py_progress_callback, PyObject** p_py_snapshot_position_callback);
+static bool ParseSnapshotPlansCallback(PyObject *py_args, PyObject** p_py_snapshot_plans_callback);
+static bool ParseProcessingProgress(PyObject *py_args, PyObject** p_py_progress);
+static bool ParseToolpath(PyObject *py_args, PyObject** p_py_toolpath);
 static bool ParseStabilizationArgs_SmartLayer(PyObject *py_args, smart_layer_args* args);
 static bool ParseStabilizationArgs_SmartGcode(PyObject *py_args, smart_gcode_args* args);
+static bool ParseStabilizationArgs_SmartTimer(PyObject *py_args, smart_timer_args* args);
+static bool ParseTriggerArgs(PyObject *py_args, snapshot_trigger_args* args);
+static bool ParseSnapshotGcodeGeneratorArgs(PyObject *py_args, snapshot_gcode_generator_args* args);
+static bool ParseSnapshotPlanObject(PyObject *py_snapshot_plan, snapshot_plan* plan);
+static bool ParseSlicerSettingsTables(PyObject *py_tables, std::vector<slicer_settings_table>& tables);
 static bool ExecuteStabilizationProgressCallback(PyObject* progress_callback, const double percent_complete, const double seconds_elapsed, const double estimated_seconds_remaining, const int gcodes_processed, const int lines_processed);
 static bool ExecuteGetSnapshotPositionCallback(PyObject* py_get_snapshot_position_callback, double x_initial, double y_initial, double& x_result, double& y_result);
+static bool ExecuteStabilizationProgressCallbackWithGil(PyObject* progress_callback, const double percent_complete, const double seconds_elapsed, const double estimated_seconds_remaining, const int gcodes_processed, const int lines_processed);
+static bool ExecuteSnapshotPlansCallback(PyObject* py_snapshot_plans_callback, std::vector<snapshot_plan>& plans);
+static bool ExecuteSnapshotPlansCallbackWithGil(PyObject* py_snapshot_plans_callback, std::vector<snapshot_plan>& plans);
+static bool ExecuteGetSnapshotPositionCallbackWithGil(PyObject* py_get_snapshot_position_callback, double x_initial, double y_initial, double& x_result, double& y_result);
 #endif
 
@@ -10,18 +10,26 @@
 #include <string>
 #include "python_helpers.h"
 #include <iostream>
+#include <vector>
+#include "threads.h"
 
+// The loggers below are shared by the module functions and every Processor.  Python loggers are process wide, so
+// giving each Processor its own references would only point them at the same objects.  They are created once when the
+// module is initialized and never change afterwards, and are only called while holding the GIL.
 static bool octolapse_loggers_created = false;
-static bool check_log_levels_real_time = true;
+// True when the level table below matches the python loggers.  When false every message is sent to python, which does
+// the filtering.  The table may be read from threads that do not hold the GIL, so it is atomic.  A reader that sees
+// a mix of old and new levels while they are being replaced only filters a message as it would have just before.
+static octolapse_sync::atomic<bool> log_levels_cached(false);
 static PyObject *py_logging_module = NULL;
 static PyObject *py_logging_configurator_name = NULL;
 static PyObject *py_logging_configurator = NULL;
 static PyObject *py_octolapse_gcode_parser_logger = NULL;
-static long gcode_parser_log_level = 0;
+static octolapse_sync::atomic<long> gcode_parser_log_level(0);
 static PyObject *py_octolapse_gcode_position_logger = NULL;
-static long gcode_position_log_level = 0;
+static octolapse_sync::atomic<long> gcode_position_log_level(0);
 static PyObject *py_octolapse_snapshot_plan_logger = NULL;
-static long snapshot_plan_log_level = 0;
+static octolapse_sync::atomic<long> snapshot_plan_log_level(0);
 static PyObject *py_info_function_name = NULL;
 static PyObject *py_warn_function_name = NULL;
 static PyObject *py_error_function_name = NULL;
@@ -30,6 +38,27 @@ static PyObject *py_verbose_function_name = NULL;
 static PyObject *py_critical_function_name = NULL;
 static PyObject *py_get_effective_level_function_name = NULL;
 
+static void octolapse_log_to_python(PyObject * py_logger, const int log_level, const std::string& message, bool is_exception);
+
+struct octolapse_log_record
+{
+	int logger_type;
+	int log_level;
+	std::string message;
+};
+// Records waiting to be sent to python.  Each thread buffers its own records, so concurrent stabilizations never
+// flush each other's messages or wait on each other to log.
+#if OCTOLAPSE_HAS_THREADS
+static thread_local std::vector<octolapse_log_record> buffered_log_records;
+// The number of octolapse_log_buffer_begin calls without a matching end on this thread.
+static thread_local int log_buffer_depth = 0;
+#else
+// Without thread_local the threads would share one buffer, so nothing is buffered and every record goes straight to
+// python.
+static std::vector<octolapse_log_record> buffered_log_records;
+static const int log_buffer_depth = 0;
+#endif
+
 void octolapse_initialize_loggers()
 {
 	// Create all of the objects necessary for logging
@@ -96,45 +125,53 @@ void octolapse_initialize_loggers()
 
 }
 
-void set_internal_log_levels(bool check_real_time)
+static bool octolapse_get_effective_level(PyObject* py_logger, long &log_level)
 {
-	check_log_levels_real_time = check_real_time;
-	if(!check_log_levels_real_time)
+	PyObject* py_log_level = PyObject_CallMethodObjArgs(py_logger, py_get_effective_level_function_name, NULL);
+	if (py_log_level == NULL)
 	{
+		PyErr_Clear();
+		return false;
+	}
+	log_level = PyIntOrLong_AsLong(py_log_level);
+	Py_DECREF(py_log_level);
+	return true;
+}
 
-		PyObject* py_gcode_parser_log_level = PyObject_CallMethodObjArgs(py_octolapse_gcode_parser_logger, py_get_effective_level_function_name, NULL);
-		if (py_gcode_parser_log_level == NULL)
-		{
-			PyErr_Print();
-			PyErr_SetString(PyExc_ValueError, "Logging.octolapse_log - Could not retrieve the log level for the gcode parser logger.");
-		}
-		gcode_parser_log_level = PyIntOrLong_AsLong(py_gcode_parser_log_level);
+void octolapse_update_log_levels()
+{
+	if (log_levels_cached || !octolapse_loggers_created)
+		return;
 
-		PyObject* py_gcode_position_log_level = PyObject_CallMethodObjArgs(py_octolapse_gcode_position_logger, py_get_effective_level_function_name, NULL);
-		if (py_gcode_position_log_level == NULL)
-		{
-			PyErr_Print();
-			PyErr_SetString(PyExc_ValueError, "Logging.octolapse_log - Could not retrieve the log level for the gcode position logger.");
-		}
-		gcode_position_log_level = PyIntOrLong_AsLong(py_gcode_position_log_level);
+	long parser_level, position_level, snapshot_plan_level;
+	if (
+		!octolapse_get_effective_level(py_octolapse_gcode_parser_logger, parser_level) ||
+		!octolapse_get_effective_level(py_octolapse_gcode_position_logger, position_level) ||
+		!octolapse_get_effective_level(py_octolapse_snapshot_plan_logger, snapshot_plan_level)
+	)
+	{
+		// Leave the levels uncached so that python keeps filtering the messages, and try again on the next call.
+		return;
+	}
+	octolapse_set_log_levels(parser_level, position_level, snapshot_plan_level);
+}
 
-		PyObject* py_snapshot_plan_log_level = PyObject_CallMethodObjArgs(py_octolapse_snapshot_plan_logger, py_get_effective_level_function_name, NULL);
-		if (py_snapshot_plan_log_level == NULL)
-		{
-			PyErr_Print();
-			PyErr_SetString(PyExc_ValueError, "Logging.octolapse_log - Could not retrieve the log level for the snapshot plan logger.");
-		}
-		snapshot_plan_log_level = PyIntOrLong_AsLong(py_snapshot_plan_log_level);
+void octolapse_set_log_levels(long gcode_parser_level, long gcode_position_level, long snapshot_plan_level)
+{
+	gcode_parser_log_level = gcode_parser_level;
+	gcode_position_log_level = gcode_position_level;
+	snapshot_plan_log_level = snapshot_plan_level;
+	log_levels_cached = true;
+}
 
-		Py_XDECREF(py_gcode_parser_log_level);
-		Py_XDECREF(py_gcode_position_log_level);
-		Py_XDECREF(py_snapshot_plan_log_level);
-	}
+void octolapse_invalidate_log_levels()
+{
+	log_levels_cached = false;
 }
 
 bool octolapse_may_be_logged(const int logger_type, const int log_level)
 {
-	int current_log_level;
+	long current_log_level;
 	switch (logger_type)
 	{
 	case octolapse_log::GCODE_PARSER:
@@ -150,9 +187,8 @@ bool octolapse_may_be_logged(const int logger_type, const int log_level)
 		return false;
 	}
 
-	if (!check_log_levels_real_time)
+	if (log_levels_cached)
 	{
-		//std::cout << "Current Log Level: " << current_log_level << " requested:" << log_level;
 		// For speed we are going to check the log levels here before attempting to send any logging info to Python.
 		if (current_log_level > log_level)
 		{
@@ -196,13 +232,16 @@ void octolapse_log(const int logger_type, const int log_level, const std::string
 		current_log_level = snapshot_plan_log_level;
 		break;
 	default:
+	{
+		PyGILState_STATE state = PyGILState_Ensure();
 		PyErr_SetString(PyExc_ValueError, "Logging.octolapse_log - unknown logger_type.");
+		PyGILState_Release(state);
 		return;
 	}
+	}
 
-	if (!check_log_levels_real_time)
+	if (log_levels_cached)
 	{
-		//std::cout << "Current Log Level: " << current_log_level << " requested:" << log_level;
 		// For speed we are going to check the log levels here before attempting to send any logging info to Python.
 		if (current_log_level > log_level)
 		{
@@ -210,6 +249,83 @@ void octolapse_log(const int logger_type, const int log_level, const std::string
 		}
 	}
 
+	if (log_buffer_depth > 0)
+	{
+		if (!is_exception)
+		{
+			buffered_log_records.resize(buffered_log_records.size() + 1);
+			octolapse_log_record& record = buffered_log_records.back();
+			record.logger_type = logger_type;
+			record.log_level = log_level;
+			record.message = message;
+			if (buffered_log_records.size() >= OCTOLAPSE_LOG_BUFFER_SIZE)
+				octolapse_log_buffer_flush();
+			return;
+		}
+		// Send everything that came before the exception first so that the log stays in order.
+		octolapse_log_buffer_flush();
+	}
+
+	// We may be called from a thread that released the GIL (snapshot plan preprocessing, for example),
+	// so make sure we hold it before touching any python objects.
+	PyGILState_STATE state = PyGILState_Ensure();
+	octolapse_log_to_python(py_logger, log_level, message, is_exception);
+	PyGILState_Release(state);
+}
+
+static PyObject * octolapse_get_py_logger(const int logger_type)
+{
+	switch (logger_type)
+	{
+	case octolapse_log::GCODE_PARSER:
+		return py_octolapse_gcode_parser_logger;
+	case octolapse_log::GCODE_POSITION:
+		return py_octolapse_gcode_position_logger;
+	case octolapse_log::SNAPSHOT_PLAN:
+		return py_octolapse_snapshot_plan_logger;
+	default:
+		return NULL;
+	}
+}
+
+void octolapse_log_buffer_begin()
+{
+#if OCTOLAPSE_HAS_THREADS
+	log_buffer_depth++;
+#endif
+}
+
+void octolapse_log_buffer_end()
+{
+#if OCTOLAPSE_HAS_THREADS
+	if (log_buffer_depth > 0)
+		log_buffer_depth--;
+	if (log_buffer_depth == 0)
+		octolapse_log_buffer_flush();
+#endif
+}
+
+void octolapse_log_buffer_flush()
+{
+	if (buffered_log_records.empty())
+		return;
+	std::vector<octolapse_log_record> records;
+	records.swap(buffered_log_records);
+	buffered_log_records.reserve(OCTOLAPSE_LOG_BUFFER_SIZE);
+	if (!octolapse_loggers_created)
+		return;
+	// One GIL acquisition for the whole batch
+	PyGILState_STATE state = PyGILState_Ensure();
+	for (unsigned int index = 0; index < records.size(); index++)
+	{
+		const octolapse_log_record& record = records[index];
+		octolapse_log_to_python(octolapse_get_py_logger(record.logger_type), record.log_level, record.message, false);
+	}
+	PyGILState_Release(state);
+}
+
+static void octolapse_log_to_python(PyObject * py_logger, const int log_level, const std::string& message, bool is_exception)
+{
 	PyObject * pyFunctionName = NULL;
 
 	PyObject* error_type = NULL;
@@ -261,11 +377,9 @@ void octolapse_log(const int logger_type, const int log_level, const std::string
 			"Unable to convert the log message '%s' to a PyString/Unicode message.", message.c_str());
 		return;
 	}
-	PyGILState_STATE state = PyGILState_Ensure();
 	PyObject * ret_val = PyObject_CallMethodObjArgs(py_logger, pyFunctionName, pyMessage, NULL);
 	// We need to decref our message so that the GC can remove it.  Maybe?
 	Py_DECREF(pyMessage);
-	PyGILState_Release(state);
 	if (ret_val == NULL)
 	{
 		if (!PyErr_Occurred())
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include <map>
+#include <sstream>
 
 struct octolapse_log
 {
@@ -13,6 +14,61 @@ bool octolapse_may_be_logged(const int logger_type, const int log_level);
 void octolapse_log(const int logger_type, const int log_level, const std::string &message);
 void octolapse_log(const int logger_type, const int log_level, const std::string& message, bool is_exception);
 void octolapse_log_exception(const int logger_type, const std::string &message);
-void set_internal_log_levels(bool check_real_time);
+/**
+ * \brief Loads the effective log levels from the python loggers if they are not already cached.  Requires the GIL.
+ */
+void octolapse_update_log_levels();
+/**
+ * \brief Caches the given log levels, which are used to discard messages without calling into python.
+ */
+void octolapse_set_log_levels(long gcode_parser_level, long gcode_position_level, long snapshot_plan_level);
+/**
+ * \brief Discards the cached log levels.  Call this whenever the python logging settings change.
+ */
+void octolapse_invalidate_log_levels();
+
+// Messages logged through OCTOLAPSE_LOG below this level are removed at compile time.  Release builds strip VERBOSE
+// messages.  Define OCTOLAPSE_LOG_FLOOR=0 to keep them.
+#ifndef OCTOLAPSE_LOG_FLOOR
+#ifdef _DEBUG
+#define OCTOLAPSE_LOG_FLOOR 0
+#else
+#define OCTOLAPSE_LOG_FLOOR 10
+#endif
+#endif
+
+// The number of records held natively while buffering before they are sent to python in a single batch.
+#define OCTOLAPSE_LOG_BUFFER_SIZE 256
+
+/**
+ * \brief Starts buffering log records on the calling thread.  Records are sent to python in batches of
+ * OCTOLAPSE_LOG_BUFFER_SIZE, or when octolapse_log_buffer_end is called.  Exceptions are never buffered.
+ * Calls may be nested.
+ */
+void octolapse_log_buffer_begin();
+/**
+ * \brief Stops buffering log records on the calling thread and sends any buffered records to python.
+ */
+void octolapse_log_buffer_end();
+/**
+ * \brief Sends any records buffered on the calling thread to python.
+ */
+void octolapse_log_buffer_flush();
+
+/**
+ * \brief Logs a message built with stream insertion, but only builds it if the level may be logged and is not below
+ * OCTOLAPSE_LOG_FLOOR.  For example:
+ * OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG, "Lines Processed: " << lines_processed);
+ */
+#define OCTOLAPSE_LOG(logger_type, log_level, message) \
+	do \
+	{ \
+		if ((log_level) >= OCTOLAPSE_LOG_FLOOR && octolapse_may_be_logged(logger_type, log_level)) \
+		{ \
+			std::stringstream octolapse_log_stream; \
+			octolapse_log_stream << message; \
+			octolapse_log(logger_type, log_level, octolapse_log_stream.str()); \
+		} \
+	} while (false)
 
 
@@ -26,11 +26,9 @@
 #include <sstream>
 parsed_command::parsed_command()
 {
-	
-	command.reserve(8);
-	gcode.reserve(128);
-	comment.reserve(128);
-	parameters.reserve(6);
+	// Nothing is reserved.  Every snapshot plan holds several commands, and the commands that are reused for every
+	// line grow to fit once.
+	opcode = gcode_opcode_unknown;
 	is_known_command = false;
 	is_empty = true;
 }
@@ -42,10 +40,33 @@ void parsed_command::clear()
 	gcode.clear();
 	comment.clear();
 	parameters.clear();
+	opcode = gcode_opcode_unknown;
 	is_known_command = false;
 	is_empty = true;
 }
 
+bool parsed_command::has_octolapse_parameter(const char* parameter_name) const
+{
+	if (opcode != gcode_opcode_octolapse)
+		return false;
+	for (std::vector<parsed_command_parameter>::const_iterator it = parameters.begin(); it != parameters.end(); ++it)
+	{
+		if ((*it).name == '\0' && (*it).string_value == parameter_name)
+			return true;
+	}
+	return false;
+}
+
+bool parsed_command::is_snapshot_command(const std::string& snapshot_command_gcode) const
+{
+	if (opcode == gcode_opcode_octolapse)
+		return has_octolapse_parameter("TAKE-SNAPSHOT");
+	if (snapshot_command_gcode.size() > 0 && snapshot_command_gcode == gcode)
+		return true;
+	// Backwards Compatibility
+	return gcode == "SNAP";
+}
+
 PyObject * parsed_command::to_py_object()
 {
 	PyObject *ret_val;
@@ -104,18 +125,24 @@ PyObject * parsed_command::to_py_object()
 		// Loop through our parameters vector and create and add PyDict items
 		for (unsigned int index = 0; index < parameters.size(); index++)
 		{
-			parsed_command_parameter param = parameters[index];
+			parsed_command_parameter& param = parameters[index];
 			PyObject * param_value = param.value_to_py_object();
 			// Errors here will be handled by value_to_py_object, just return NULL
 			if (param_value == NULL)
 			{
 				return NULL;
 			}
-			if (PyDict_SetItemString(pyParametersDict, param.name.c_str(), param_value) != 0)
+			// Parameters are keyed by their letter.  @OCTOLAPSE parameters are keyed by their name, and text
+			// parameters have no key.
+			char param_name[2] = { param.name, '\0' };
+			const char * key = param_name;
+			if (param.name == '\0' && opcode == gcode_opcode_octolapse)
+				key = param.string_value.c_str();
+			if (PyDict_SetItemString(pyParametersDict, key, param_value) != 0)
 			{
 				// Handle error here, display detailed message
 				std::string message = "Unable to add the command parameter to the parameters dictionary.  Parameter Name: ";
-				message += param.name;
+				message += key;
 				message += " Value Type: ";
 				message += param.value_type;
 				message += " Value: ";
@@ -178,3 +205,46 @@ PyObject * parsed_command::to_py_object()
 	Py_DECREF(pyComment);
 	return ret_val;
 }
+
+void parsed_command::serialize(binary_writer& writer) const
+{
+	writer.write_string(command);
+	writer.write_int(static_cast<int>(opcode));
+	writer.write_string(gcode);
+	writer.write_string(comment);
+	writer.write_bool(is_empty);
+	writer.write_bool(is_known_command);
+	writer.write_int(static_cast<int>(parameters.size()));
+	for (unsigned int index = 0; index < parameters.size(); index++)
+	{
+		parameters[index].serialize(writer);
+	}
+}
+
+bool parsed_command::deserialize(binary_reader& reader)
+{
+	int opcode_value;
+	int num_parameters;
+	if (
+		!reader.read_string(command) ||
+		!reader.read_int(opcode_value) ||
+		!reader.read_string(gcode) ||
+		!reader.read_string(comment) ||
+		!reader.read_bool(is_empty) ||
+		!reader.read_bool(is_known_command) ||
+		!reader.read_count(num_parameters) ||
+		opcode_value < 0 || opcode_value >= NUM_GCODE_OPCODES
+	)
+	{
+		return false;
+	}
+	opcode = static_cast<gcode_opcode>(opcode_value);
+	// Resize rather than clear so that the existing parameters, and their strings, are reused.
+	parameters.resize(num_parameters);
+	for (int index = 0; index < num_parameters; index++)
+	{
+		if (!parameters[index].deserialize(reader))
+			return false;
+	}
+	return true;
+}
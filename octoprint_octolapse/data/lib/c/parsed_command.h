@@ -32,12 +32,55 @@
 #include <string>
 #include <vector>
 #include "parsed_command_parameter.h"
+#include "binary_stream.h"
+
+// Every command the parser is able to extract parameters from has an opcode.  The opcode
+// allows commands to be compared and dispatched without any string comparisons.
+#define NUM_GCODE_OPCODES 35
+enum gcode_opcode {
+	gcode_opcode_unknown = 0,
+	gcode_opcode_g0,
+	gcode_opcode_g1,
+	gcode_opcode_g2,
+	gcode_opcode_g3,
+	gcode_opcode_g10,
+	gcode_opcode_g11,
+	gcode_opcode_g20,
+	gcode_opcode_g21,
+	gcode_opcode_g28,
+	gcode_opcode_g29,
+	gcode_opcode_g80,
+	gcode_opcode_g90,
+	gcode_opcode_g91,
+	gcode_opcode_g92,
+	gcode_opcode_m82,
+	gcode_opcode_m83,
+	gcode_opcode_m104,
+	gcode_opcode_m105,
+	gcode_opcode_m106,
+	gcode_opcode_m109,
+	gcode_opcode_m114,
+	gcode_opcode_m116,
+	gcode_opcode_m140,
+	gcode_opcode_m141,
+	gcode_opcode_m190,
+	gcode_opcode_m191,
+	gcode_opcode_m207,
+	gcode_opcode_m208,
+	gcode_opcode_m218,
+	gcode_opcode_m240,
+	gcode_opcode_m400,
+	gcode_opcode_m563,
+	gcode_opcode_t,
+	gcode_opcode_octolapse
+};
 
 struct parsed_command
 {
 public:
 	parsed_command();
 	std::string command;
+	gcode_opcode opcode;
 	std::string gcode;
 	std::string comment;
 	bool is_empty;
@@ -45,6 +88,17 @@ public:
 	std::vector<parsed_command_parameter> parameters;
 	PyObject * to_py_object();
 	void clear();
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
+	/**
+	 * \brief Returns true if this is an @OCTOLAPSE command with the given (upper case) parameter, for example TAKE-SNAPSHOT.
+	 */
+	bool has_octolapse_parameter(const char* parameter_name) const;
+	/**
+	 * \brief Returns true for @OCTOLAPSE TAKE-SNAPSHOT, the legacy SNAP command, or the printer's snapshot command
+	 * if one is configured (snapshot_command_gcode is not empty).
+	 */
+	bool is_snapshot_command(const std::string& snapshot_command_gcode) const;
 	
 };
 
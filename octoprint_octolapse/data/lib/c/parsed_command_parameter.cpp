@@ -26,23 +26,38 @@
 #include "python_helpers.h"
 parsed_command_parameter::parsed_command_parameter()
 {
+	name = '\0';
 	value_type = 'N';
-	name.reserve(1);
+	double_value = 0;
+	unsigned_long_value = 0;
 }
 
-parsed_command_parameter::parsed_command_parameter(const std::string name, double value) : name(name), double_value(value)
+parsed_command_parameter::parsed_command_parameter(const char name, double value) : name(name), double_value(value)
 {
 	value_type = 'F';
+	unsigned_long_value = 0;
 }
 
-parsed_command_parameter::parsed_command_parameter(const std::string name, const std::string value) : name(name), string_value(value)
+parsed_command_parameter::parsed_command_parameter(const char name, const std::string value) : name(name), string_value(value)
 {
 	value_type = 'S';
+	double_value = 0;
+	unsigned_long_value = 0;
 }
 
-parsed_command_parameter::parsed_command_parameter(const std::string name, const unsigned long value) : name(name), unsigned_long_value(value)
+parsed_command_parameter::parsed_command_parameter(const char name, const unsigned long value) : name(name), unsigned_long_value(value)
 {
 	value_type = 'U';
+	double_value = 0;
+}
+
+void parsed_command_parameter::clear()
+{
+	name = '\0';
+	value_type = 'N';
+	double_value = 0;
+	unsigned_long_value = 0;
+	string_value.clear();
 }
 parsed_command_parameter::~parsed_command_parameter()
 {
@@ -101,4 +116,30 @@ PyObject * parsed_command_parameter::value_to_py_object()
 
 	return ret_val;
 
-}
\ No newline at end of file
+}
+
+void parsed_command_parameter::serialize(binary_writer& writer) const
+{
+	writer.write_char(name);
+	writer.write_char(value_type);
+	writer.write_double(double_value);
+	writer.write_long(static_cast<long>(unsigned_long_value));
+	writer.write_string(string_value);
+}
+
+bool parsed_command_parameter::deserialize(binary_reader& reader)
+{
+	long long_value;
+	if (
+		!reader.read_char(name) ||
+		!reader.read_char(value_type) ||
+		!reader.read_double(double_value) ||
+		!reader.read_long(long_value) ||
+		!reader.read_string(string_value)
+	)
+	{
+		return false;
+	}
+	unsigned_long_value = static_cast<unsigned long>(long_value);
+	return true;
+}
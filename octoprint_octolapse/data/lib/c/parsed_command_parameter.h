@@ -23,6 +23,7 @@
 #ifndef PARSED_COMMAND_PARAMETER_H
 #define PARSED_COMMAND_PARAMETER_H
 #include <string>
+#include "binary_stream.h"
 #ifdef _DEBUG
 #undef _DEBUG
 #include <Python.h>
@@ -35,15 +36,23 @@ struct parsed_command_parameter
 public:
 	parsed_command_parameter();
 	~parsed_command_parameter();
-	parsed_command_parameter(std::string name, double value);
-	parsed_command_parameter(std::string name, std::string value);
-	parsed_command_parameter(std::string name, unsigned long value);
+	parsed_command_parameter(char name, double value);
+	parsed_command_parameter(char name, std::string value);
+	parsed_command_parameter(char name, unsigned long value);
 	PyObject * value_to_py_object();
-
-	std::string name;
+	void clear();
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
+	/**
+	 * \brief The parameter letter.  Text parameters and @OCTOLAPSE parameters have no letter (\0).
+	 */
+	char name;
 	char value_type;
 	double double_value;
 	unsigned long unsigned_long_value;
+	/**
+	 * \brief Only used for string values, text parameters and the names of @OCTOLAPSE parameters.
+	 */
 	std::string string_value;
 };
 
@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "plan_cursor.h"
+#include "plan_pipeline.h"
+#include "logging.h"
+
+plan_cursor::plan_cursor()
+{
+	index_ = 0;
+	p_queue_ = NULL;
+}
+
+plan_cursor::plan_cursor(const plan_cursor& source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+void plan_cursor::add_plan(const long file_gcode_number)
+{
+	plans_.push_back(file_gcode_number);
+}
+
+void plan_cursor::set_queue(const snapshot_plan_queue* p_queue)
+{
+	p_queue_ = p_queue;
+}
+
+plan_cursor_status plan_cursor::get_queue_status(const long gcode_number) const
+{
+	if (p_queue_ == NULL)
+		return plan_cursor_status_none;
+	// Read these before the count, so that the count includes every plan they promise.
+	const bool is_complete = p_queue_->is_complete();
+	const long planned_gcode_number = p_queue_->get_planned_gcode_number();
+	if (static_cast<size_t>(p_queue_->get_pushed_count()) > plans_.size())
+		return plan_cursor_status_plans_pending;
+	if (!is_complete && gcode_number >= planned_gcode_number)
+		return plan_cursor_status_not_planned;
+	return plan_cursor_status_none;
+}
+
+plan_cursor_status plan_cursor::update(const long gcode_number)
+{
+	if (index_ >= plans_.size())
+		return get_queue_status(gcode_number);
+	if (plans_[index_] > gcode_number)
+		return plan_cursor_status_none;
+
+	// skip plans in case any were missed.
+	plan_cursor_status status = plan_cursor_status_none;
+	while (index_ < plans_.size() && plans_[index_] < gcode_number)
+	{
+		index_++;
+		status = plan_cursor_status_skipped;
+	}
+	if (index_ < plans_.size() && plans_[index_] == gcode_number)
+		return plan_cursor_status_trigger_line;
+	if (index_ >= plans_.size())
+	{
+		// The queue may have the plan for this line.
+		const plan_cursor_status queue_status = get_queue_status(gcode_number);
+		if (queue_status != plan_cursor_status_none)
+			return queue_status;
+	}
+	return status;
+}
+
+void plan_cursor::advance()
+{
+	if (index_ < plans_.size())
+		index_++;
+}
+
+long plan_cursor::get_index() const
+{
+	return static_cast<long>(index_);
+}
+
+long plan_cursor::get_plan_count() const
+{
+	return static_cast<long>(plans_.size());
+}
+
+static plan_cursor * plan_cursor_get(PyObject * self)
+{
+	return reinterpret_cast<plan_cursor_object*>(self)->p_cursor;
+}
+
+/**
+ * \brief Adds each file gcode number in the sequence to the cursor.  Logs and returns false on failure.
+ */
+static bool plan_cursor_add_plans(plan_cursor * p_cursor, PyObject * py_plans)
+{
+	PyObject* py_plans_sequence = PySequence_Fast(py_plans, "GcodePositionProcessor.PlanCursor - The plans must be a list or a tuple.");
+	if (py_plans_sequence == NULL)
+	{
+		std::string message = "plan_cursor_add_plans - The plans must be a list or a tuple.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	const Py_ssize_t num_plans = PySequence_Fast_GET_SIZE(py_plans_sequence);
+	for (Py_ssize_t index = 0; index < num_plans; index++)
+	{
+		const long file_gcode_number = PyLong_AsLong(PySequence_Fast_GET_ITEM(py_plans_sequence, index));
+		if (file_gcode_number == -1 && PyErr_Occurred())
+		{
+			std::string message = "plan_cursor_add_plans - Each plan must be a file gcode number.";
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			Py_DECREF(py_plans_sequence);
+			return false;
+		}
+		p_cursor->add_plan(file_gcode_number);
+	}
+	Py_DECREF(py_plans_sequence);
+	return true;
+}
+
+static PyObject * plan_cursor_Update(PyObject * self, PyObject * py_gcode_number)
+{
+	const long gcode_number = PyLong_AsLong(py_gcode_number);
+	if (gcode_number == -1 && PyErr_Occurred())
+	{
+		std::string message = "GcodePositionProcessor.PlanCursor.Update - Error parsing parameters.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return NULL;
+	}
+	return PyLong_FromLong(plan_cursor_get(self)->update(gcode_number));
+}
+
+static PyObject * plan_cursor_AddPlans(PyObject * self, PyObject * py_plans)
+{
+	if (!plan_cursor_add_plans(plan_cursor_get(self), py_plans))
+		return NULL;
+	return Py_BuildValue("O", Py_True);
+}
+
+static PyObject * plan_cursor_Advance(PyObject * self, PyObject * args)
+{
+	plan_cursor_get(self)->advance();
+	return Py_BuildValue("O", Py_True);
+}
+
+static PyObject * plan_cursor_GetIndex(PyObject * self, PyObject * args)
+{
+	return PyLong_FromLong(plan_cursor_get(self)->get_index());
+}
+
+static PyObject * plan_cursor_GetPlanCount(PyObject * self, PyObject * args)
+{
+	return PyLong_FromLong(plan_cursor_get(self)->get_plan_count());
+}
+
+static void plan_cursor_dealloc(PyObject * self)
+{
+	delete plan_cursor_get(self);
+	// The cursor reads the pipeline's queue, so the pipeline is released after it.
+	Py_XDECREF(reinterpret_cast<plan_cursor_object*>(self)->py_pipeline);
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyMethodDef plan_cursor_methods[] = {
+	{ "Update", (PyCFunction)plan_cursor_Update, METH_O, "Count a printed line by its gcode number.  Returns 0 if the current plan is unchanged, 1 if missed plans were skipped, or 2 if the line is the current plan's triggering line.  A cursor that follows a PlanPipeline returns 3 once every plan has been passed but the pipeline has more, and 4 if the line hasn't been planned yet." },
+	{ "AddPlans", (PyCFunction)plan_cursor_AddPlans, METH_O, "Add a sequence of file gcode numbers of the plans that follow the current ones." },
+	{ "Advance", (PyCFunction)plan_cursor_Advance, METH_NOARGS, "Move to the next plan." },
+	{ "GetIndex", (PyCFunction)plan_cursor_GetIndex, METH_NOARGS, "Returns the index of the current plan, which is the number of plans once every plan has been passed." },
+	{ "GetPlanCount", (PyCFunction)plan_cursor_GetPlanCount, METH_NOARGS, "Returns the number of plans." },
+	{ NULL, NULL, 0, NULL }
+};
+
+PyTypeObject plan_cursor_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.PlanCursor"
+};
+
+bool plan_cursor_add_type(PyObject * module)
+{
+	plan_cursor_type.tp_basicsize = sizeof(plan_cursor_object);
+	plan_cursor_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	plan_cursor_type.tp_doc = "Follows precalculated snapshot plans while printing.  Returned by CreatePlanCursor.";
+	plan_cursor_type.tp_dealloc = plan_cursor_dealloc;
+	plan_cursor_type.tp_methods = plan_cursor_methods;
+	if (PyType_Ready(&plan_cursor_type) < 0)
+	{
+		std::string message = "plan_cursor_add_type - Unable to ready the PlanCursor type.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	Py_INCREF(&plan_cursor_type);
+	if (PyModule_AddObject(module, "PlanCursor", reinterpret_cast<PyObject*>(&plan_cursor_type)) < 0)
+	{
+		Py_DECREF(&plan_cursor_type);
+		std::string message = "plan_cursor_add_type - Unable to add the PlanCursor type to the module.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	return true;
+}
+
+PyObject * plan_cursor_create(PyObject * py_plans, PyObject * py_pipeline)
+{
+	snapshot_plan_queue * p_queue = NULL;
+	if (py_pipeline != NULL)
+	{
+		p_queue = plan_pipeline_get_queue(py_pipeline);
+		if (p_queue == NULL)
+		{
+			std::string message = "GcodePositionProcessor.PlanCursor - The pipeline must be a PlanPipeline.";
+			PyErr_SetString(PyExc_TypeError, message.c_str());
+			octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+			return NULL;
+		}
+	}
+	plan_cursor * p_cursor = new plan_cursor();
+	if (!plan_cursor_add_plans(p_cursor, py_plans))
+	{
+		delete p_cursor;
+		return NULL;
+	}
+	p_cursor->set_queue(p_queue);
+
+	PyObject * py_cursor = plan_cursor_type.tp_alloc(&plan_cursor_type, 0);
+	if (py_cursor == NULL)
+	{
+		std::string message = "plan_cursor_create - Unable to allocate a PlanCursor.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		delete p_cursor;
+		return NULL;
+	}
+	plan_cursor_object * p_object = reinterpret_cast<plan_cursor_object*>(py_cursor);
+	p_object->p_cursor = p_cursor;
+	p_object->py_pipeline = py_pipeline;
+	Py_XINCREF(py_pipeline);
+	return py_cursor;
+}
@@ -0,0 +1,110 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef PLAN_CURSOR_H
+#define PLAN_CURSOR_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <vector>
+#include "snapshot_plan_queue.h"
+
+enum plan_cursor_status
+{
+	// The line has no effect on the current plan
+	plan_cursor_status_none = 0,
+	// Plans that were missed have been skipped, so the current plan changed
+	plan_cursor_status_skipped = 1,
+	// The line is the current plan's triggering line.  Plans may have been skipped to reach it.
+	plan_cursor_status_trigger_line = 2,
+	// Every plan has been passed, but the plan queue has more.  Add them and update again.
+	plan_cursor_status_plans_pending = 3,
+	// The line hasn't been planned yet, so snapshots must be triggered live until the plan queue catches up.
+	plan_cursor_status_not_planned = 4
+};
+
+/**
+ * \brief Follows precalculated snapshot plans while printing.  Each plan already knows the gcode number of its
+ * triggering line, so the printed lines only need to be counted, and there is no need to parse or track the lines in
+ * between.
+ */
+class plan_cursor
+{
+public:
+	plan_cursor();
+	/**
+	 * \brief Adds a plan.  Plans must be added in file order.
+	 */
+	void add_plan(long file_gcode_number);
+	/**
+	 * \brief Follows a plan queue, whose plans are added as they arrive.  The queue must outlive the cursor.
+	 */
+	void set_queue(const snapshot_plan_queue* p_queue);
+	/**
+	 * \brief Moves past any plans whose triggering line has already been printed, and reports whether the printed
+	 * line is the current plan's triggering line.
+	 */
+	plan_cursor_status update(long gcode_number);
+	/**
+	 * \brief Moves to the next plan.
+	 */
+	void advance();
+	/**
+	 * \brief Returns the index of the current plan.  It is the number of plans when every plan has been passed.
+	 */
+	long get_index() const;
+	long get_plan_count() const;
+private:
+	plan_cursor(const plan_cursor& source);
+	// The gcode number of each plan's triggering line
+	std::vector<long> plans_;
+	size_t index_;
+	const snapshot_plan_queue* p_queue_;
+	plan_cursor_status get_queue_status(long gcode_number) const;
+};
+
+/**
+ * \brief A python object that owns a plan_cursor.  Returned by CreatePlanCursor.
+ */
+typedef struct {
+	PyObject_HEAD
+	plan_cursor * p_cursor;
+	// The PlanPipeline that owns the followed queue, or NULL.
+	PyObject * py_pipeline;
+} plan_cursor_object;
+
+extern PyTypeObject plan_cursor_type;
+
+/**
+ * \brief Readies the PlanCursor type and adds it to the module.  Returns false on failure.
+ */
+bool plan_cursor_add_type(PyObject * module);
+
+/**
+ * \brief Creates a PlanCursor from a sequence of the plans' file gcode numbers in file order.  py_pipeline may be a
+ * PlanPipeline whose plans follow the given ones, or NULL.
+ */
+PyObject * plan_cursor_create(PyObject * py_plans, PyObject * py_pipeline);
+#endif
@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "plan_pipeline.h"
+#include "logging.h"
+
+#if OCTOLAPSE_HAS_THREADS
+
+#pragma region plan_pipeline
+plan_pipeline::plan_pipeline(stabilization* p_stabilization, processing_progress* p_progress)
+{
+	p_stabilization_ = p_stabilization;
+	p_own_progress_ = NULL;
+	if (p_progress == NULL)
+	{
+		p_own_progress_ = new processing_progress();
+		p_stabilization_->set_progress(p_own_progress_, NULL);
+		p_progress = p_own_progress_;
+	}
+	p_progress_ = p_progress;
+	p_stabilization_->set_plan_queue(&queue_);
+	thread_ = std::thread(&plan_pipeline::run, this);
+}
+
+plan_pipeline::plan_pipeline(const plan_pipeline& source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+plan_pipeline::~plan_pipeline()
+{
+	if (thread_.joinable())
+	{
+		// This is only safe if processing never needs python, which is why the owner joins before deleting.
+		cancel();
+		thread_.join();
+	}
+	delete p_stabilization_;
+	if (p_own_progress_ != NULL)
+		delete p_own_progress_;
+}
+
+void plan_pipeline::run()
+{
+	results_ = p_stabilization_->process_file();
+	queue_.finish();
+}
+
+void plan_pipeline::cancel()
+{
+	p_progress_->request_cancel();
+}
+
+void plan_pipeline::join()
+{
+	if (thread_.joinable())
+		thread_.join();
+}
+
+bool plan_pipeline::is_complete() const
+{
+	return queue_.is_complete();
+}
+
+snapshot_plan_queue& plan_pipeline::get_queue()
+{
+	return queue_;
+}
+
+stabilization_results& plan_pipeline::get_results()
+{
+	return results_;
+}
+#pragma endregion plan_pipeline
+
+#pragma region PlanPipeline
+static plan_pipeline * plan_pipeline_get(PyObject * self)
+{
+	return reinterpret_cast<plan_pipeline_object*>(self)->p_pipeline;
+}
+
+static PyObject * plan_pipeline_GetPlans(PyObject * self, PyObject * args)
+{
+	std::vector<snapshot_plan> plans;
+	plan_pipeline_get(self)->get_queue().take(plans);
+	return snapshot_plan::build_py_object(plans);
+}
+
+static PyObject * plan_pipeline_GetPlannedGcodeNumber(PyObject * self, PyObject * args)
+{
+	return PyLong_FromLong(plan_pipeline_get(self)->get_queue().get_planned_gcode_number());
+}
+
+static PyObject * plan_pipeline_GetPlanCount(PyObject * self, PyObject * args)
+{
+	return PyLong_FromLong(plan_pipeline_get(self)->get_queue().get_pushed_count());
+}
+
+static PyObject * plan_pipeline_IsComplete(PyObject * self, PyObject * args)
+{
+	if (plan_pipeline_get(self)->is_complete())
+		return Py_BuildValue("O", Py_True);
+	return Py_BuildValue("O", Py_False);
+}
+
+static PyObject * plan_pipeline_Cancel(PyObject * self, PyObject * args)
+{
+	plan_pipeline_get(self)->cancel();
+	return Py_BuildValue("O", Py_True);
+}
+
+static PyObject * plan_pipeline_Join(PyObject * self, PyObject * args)
+{
+	plan_pipeline_object * p_object = reinterpret_cast<plan_pipeline_object*>(self);
+	if (p_object->py_results == NULL)
+	{
+		plan_pipeline * p_pipeline = p_object->p_pipeline;
+		Py_BEGIN_ALLOW_THREADS
+		p_pipeline->join();
+		Py_END_ALLOW_THREADS
+		octolapse_update_log_levels();
+		PyObject * py_results = p_pipeline->get_results().to_py_object();
+		if (py_results == NULL)
+			return NULL;
+		p_object->py_results = py_results;
+	}
+	Py_INCREF(p_object->py_results);
+	return p_object->py_results;
+}
+
+static void plan_pipeline_dealloc(PyObject * self)
+{
+	plan_pipeline_object * p_object = reinterpret_cast<plan_pipeline_object*>(self);
+	plan_pipeline * p_pipeline = p_object->p_pipeline;
+	// The processing thread may be waiting on the GIL.
+	Py_BEGIN_ALLOW_THREADS
+	p_pipeline->cancel();
+	p_pipeline->join();
+	Py_END_ALLOW_THREADS
+	delete p_pipeline;
+	Py_XDECREF(p_object->py_results);
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyMethodDef plan_pipeline_methods[] = {
+	{ "GetPlans", (PyCFunction)plan_pipeline_GetPlans, METH_NOARGS, "Returns the snapshot plans that were completed since the last call, in file order." },
+	{ "GetPlannedGcodeNumber", (PyCFunction)plan_pipeline_GetPlannedGcodeNumber, METH_NOARGS, "Returns the gcode number below which every snapshot plan has been completed.  It is only final for the whole file once IsComplete returns True." },
+	{ "GetPlanCount", (PyCFunction)plan_pipeline_GetPlanCount, METH_NOARGS, "Returns the number of snapshot plans completed so far." },
+	{ "IsComplete", (PyCFunction)plan_pipeline_IsComplete, METH_NOARGS, "Returns True once every snapshot plan has been completed." },
+	{ "Cancel", (PyCFunction)plan_pipeline_Cancel, METH_NOARGS, "Stops processing.  The plans completed so far can still be read." },
+	{ "Join", (PyCFunction)plan_pipeline_Join, METH_NOARGS, "Waits for processing to finish and returns the same results as GetSnapshotPlans_SmartLayer.  The snapshot plans in the results are empty, since they are returned by GetPlans." },
+	{ NULL, NULL, 0, NULL }
+};
+
+PyTypeObject plan_pipeline_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.PlanPipeline"
+};
+
+bool plan_pipeline_add_type(PyObject * module)
+{
+	plan_pipeline_type.tp_basicsize = sizeof(plan_pipeline_object);
+	plan_pipeline_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	plan_pipeline_type.tp_doc = "Creates snapshot plans on a native thread while printing.  Returned by StartSnapshotPlans_SmartLayer.";
+	plan_pipeline_type.tp_dealloc = plan_pipeline_dealloc;
+	plan_pipeline_type.tp_methods = plan_pipeline_methods;
+	if (PyType_Ready(&plan_pipeline_type) < 0)
+	{
+		std::string message = "plan_pipeline_add_type - Unable to ready the PlanPipeline type.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	Py_INCREF(&plan_pipeline_type);
+	if (PyModule_AddObject(module, "PlanPipeline", reinterpret_cast<PyObject*>(&plan_pipeline_type)) < 0)
+	{
+		Py_DECREF(&plan_pipeline_type);
+		std::string message = "plan_pipeline_add_type - Unable to add the PlanPipeline type to the module.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	return true;
+}
+
+PyObject * plan_pipeline_create(stabilization* p_stabilization, processing_progress* p_progress)
+{
+	PyObject * py_pipeline = plan_pipeline_type.tp_alloc(&plan_pipeline_type, 0);
+	if (py_pipeline == NULL)
+	{
+		std::string message = "plan_pipeline_create - Unable to allocate a PlanPipeline.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		delete p_stabilization;
+		return NULL;
+	}
+	plan_pipeline_object * p_object = reinterpret_cast<plan_pipeline_object*>(py_pipeline);
+	p_object->py_results = NULL;
+	p_object->p_pipeline = new plan_pipeline(p_stabilization, p_progress);
+	return py_pipeline;
+}
+
+snapshot_plan_queue * plan_pipeline_get_queue(PyObject * py_pipeline)
+{
+	if (!PyObject_TypeCheck(py_pipeline, &plan_pipeline_type))
+		return NULL;
+	return &plan_pipeline_get(py_pipeline)->get_queue();
+}
+#pragma endregion PlanPipeline
+#else
+bool plan_pipeline_add_type(PyObject * module)
+{
+	// The PlanPipeline type is left out, and python preprocesses the file before printing.
+	return true;
+}
+
+PyObject * plan_pipeline_create(stabilization* p_stabilization, processing_progress* p_progress)
+{
+	delete p_stabilization;
+	std::string message = "GcodePositionProcessor.StartSnapshotPlans_SmartLayer - This build has no native thread support.";
+	PyErr_SetString(PyExc_NotImplementedError, message.c_str());
+	octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+	return NULL;
+}
+
+snapshot_plan_queue * plan_pipeline_get_queue(PyObject * py_pipeline)
+{
+	return NULL;
+}
+#endif
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef PLAN_PIPELINE_H
+#define PLAN_PIPELINE_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include "threads.h"
+#include "stabilization.h"
+#include "stabilization_results.h"
+#include "snapshot_plan_queue.h"
+#include "processing_progress.h"
+
+#if OCTOLAPSE_HAS_THREADS
+#include <thread>
+
+/**
+ * \brief Processes a file on its own thread so that the print can start right away.  Each snapshot plan is pushed to
+ * the queue as soon as it is complete, and the planned gcode number tells the printing side which lines are already
+ * planned.  The results are kept until the thread is joined.
+ * Only one thread may cancel or join.
+ */
+class plan_pipeline
+{
+public:
+	/**
+	 * \brief Takes ownership of the stabilization and starts processing.  p_progress is used to cancel, and may be
+	 * NULL if the stabilization has no progress, in which case the pipeline adds its own.
+	 */
+	plan_pipeline(stabilization* p_stabilization, processing_progress* p_progress);
+	/**
+	 * \brief Cancels and joins the processing thread.  Call with the GIL held, but only once the thread is joined,
+	 * since the stabilization releases python objects.
+	 */
+	~plan_pipeline();
+	void cancel();
+	/**
+	 * \brief Waits for the processing thread.  Call without holding the GIL, since processing may call python.
+	 */
+	void join();
+	bool is_complete() const;
+	snapshot_plan_queue& get_queue();
+	// Only read these after join.
+	stabilization_results& get_results();
+private:
+	plan_pipeline(const plan_pipeline& source);
+	void run();
+	stabilization* p_stabilization_;
+	processing_progress* p_progress_;
+	// The progress added when the stabilization has none, NULL otherwise.
+	processing_progress* p_own_progress_;
+	snapshot_plan_queue queue_;
+	stabilization_results results_;
+	std::thread thread_;
+};
+
+/**
+ * \brief A python object that owns a plan_pipeline.  Returned by StartSnapshotPlans_SmartLayer.
+ */
+typedef struct {
+	PyObject_HEAD
+	plan_pipeline * p_pipeline;
+	// The result tuple, created by the first Join call.
+	PyObject * py_results;
+} plan_pipeline_object;
+
+extern PyTypeObject plan_pipeline_type;
+#endif
+
+/**
+ * \brief Readies the PlanPipeline type and adds it to the module.  Returns false on failure.
+ */
+bool plan_pipeline_add_type(PyObject * module);
+/**
+ * \brief Creates a PlanPipeline, which takes ownership of the stabilization and starts processing it.  Call with the
+ * GIL held.  p_progress may be NULL.  Without native threads this deletes the stabilization, sets
+ * NotImplementedError and returns NULL.
+ */
+PyObject * plan_pipeline_create(stabilization* p_stabilization, processing_progress* p_progress);
+/**
+ * \brief Returns the plan queue of a PlanPipeline, or NULL if py_pipeline is some other object.
+ */
+snapshot_plan_queue * plan_pipeline_get_queue(PyObject * py_pipeline);
+#endif
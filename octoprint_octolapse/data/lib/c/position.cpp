@@ -23,6 +23,7 @@
 #include "position.h"
 #include "logging.h"
 #include <iostream>
+#include <utility>
 void position::set_xyz_axis_mode(const std::string& xyz_axis_default_mode)
 {
 	if (xyz_axis_default_mode == "relative" || xyz_axis_default_mode == "force-relative")
@@ -133,7 +134,7 @@ position::position()
 	gcode_ignored = true;
 	is_in_bounds = true;
 	current_tool = -1;
-	p_extruders = NULL;
+	num_extruders = 0;
 	set_num_extruders(0);
 }
 
@@ -190,79 +191,43 @@ position::position(int extruder_count)
 	gcode_ignored = true;
 	is_in_bounds = true;
 	current_tool = 0;
-	p_extruders = NULL;
+	num_extruders = 0;
 	set_num_extruders(extruder_count);
 	
 }
 
 position::position(const position &pos)
 {
-	is_empty = pos.is_empty;
-	feature_type_tag = pos.feature_type_tag;
-	f = pos.f;
-	f_null = pos.f_null;
-	x = pos.x;
-	x_null = pos.x_null;
-	x_offset = pos.x_offset;
-	x_firmware_offset = pos.x_firmware_offset;
-	x_homed = pos.x_homed;
-	y = pos.y;
-	y_null = pos.y_null;
-	y_offset = pos.y_offset;
-	y_firmware_offset = pos.y_firmware_offset;
-	y_homed = pos.y_homed;
-	z = pos.z;
-	z_null = pos.z_null;
-	z_offset = pos.z_offset;
-	z_firmware_offset = pos.z_firmware_offset;
-	z_homed = pos.z_homed;
-	is_relative = pos.is_relative;
-	is_relative_null = pos.is_relative_null;
-	is_extruder_relative = pos.is_extruder_relative;
-	is_extruder_relative_null = pos.is_extruder_relative_null;
-	is_metric = pos.is_metric;
-	is_metric_null = pos.is_metric_null;
-	last_extrusion_height = pos.last_extrusion_height;
-	last_extrusion_height_null = pos.last_extrusion_height_null;
-	layer = pos.layer;
-	height = pos.height;
-	height_increment = pos.height_increment;
-	height_increment_change_count = pos.height_increment_change_count;
-	is_printer_primed = pos.is_printer_primed;
-	has_definite_position = pos.has_definite_position;
-	z_relative = pos.z_relative;
-	is_in_position = pos.is_in_position;
-	in_path_position = pos.in_path_position;
-	is_zhop = pos.is_zhop;
-	is_layer_change = pos.is_layer_change;
-	is_height_change = pos.is_height_change;
-	is_height_increment_change = pos.is_height_increment_change;
-	is_xy_travel = pos.is_xy_travel;
-	is_xyz_travel = pos.is_xyz_travel;
-	has_xy_position_changed = pos.has_xy_position_changed;
-	has_position_changed = pos.has_position_changed;
-	has_received_home_command = pos.has_received_home_command;
-	file_line_number = pos.file_line_number;
-	gcode_number = pos.gcode_number;
-	file_position = pos.file_position;
-	gcode_ignored = pos.gcode_ignored;
-	is_in_bounds = pos.is_in_bounds;
-	current_tool = pos.current_tool;
-	p_extruders = NULL;
+	num_extruders = 0;
+	copy_state(pos);
 	command = pos.command;
-	set_num_extruders(pos.num_extruders);
-	for(int index=0; index < pos.num_extruders; index++)
-	{
-		p_extruders[index] = pos.p_extruders[index];
-	}
+}
+
+position::position(position&& pos) noexcept
+{
+	num_extruders = 0;
+	copy_state(pos);
+	command = std::move(pos.command);
 }
 
 position::~position()
 {
-	delete_extruders();
 }
 
 position& position::operator=(const position& pos) {
+	copy_state(pos);
+	command = pos.command;
+	return *this;
+}
+
+position& position::operator=(position&& pos) noexcept {
+	copy_state(pos);
+	command = std::move(pos.command);
+	return *this;
+}
+
+void position::copy_state(const position& pos)
+{
 	is_empty = pos.is_empty;
 	feature_type_tag = pos.feature_type_tag;
 	f = pos.f;
@@ -314,34 +279,24 @@ position& position::operator=(const position& pos) {
 	gcode_ignored = pos.gcode_ignored;
 	is_in_bounds = pos.is_in_bounds;
 	current_tool = pos.current_tool;
-	command = pos.command;
-	if (num_extruders != pos.num_extruders)
-	{
-		set_num_extruders(pos.num_extruders);
-	}
+	num_extruders = pos.num_extruders;
 	for (int index = 0; index < pos.num_extruders; index++)
 	{
-		p_extruders[index] = pos.p_extruders[index];
+		extruders[index] = pos.extruders[index];
 	}
-	return *this;
 }
 
 void position::set_num_extruders(int num_extruders_)
 {
-	delete_extruders();
+	if (num_extruders_ > MAX_EXTRUDERS)
+		num_extruders_ = MAX_EXTRUDERS;
+	else if (num_extruders_ < 0)
+		num_extruders_ = 0;
 	num_extruders = num_extruders_;
-	if (num_extruders_ > 0)
+	// Reset the extruders in use
+	for (int index = 0; index < num_extruders; index++)
 	{
-		p_extruders = new extruder[num_extruders_];
-	}
-}
-
-void position::delete_extruders()
-{
-	if (p_extruders != NULL)
-	{
-		delete[] p_extruders;
-		p_extruders = NULL;
+		extruders[index] = extruder();
 	}
 }
 
@@ -362,21 +317,17 @@ double position::get_gcode_z() const
 
 extruder& position::get_current_extruder() const
 {
-	int tool_number = current_tool;
-	if (current_tool >= num_extruders)
-		tool_number = num_extruders - 1;
-	else if (current_tool < 0)
-		tool_number = 0;
-	return p_extruders[tool_number];
+	return get_extruder(current_tool);
 }
 
 extruder& position::get_extruder(int index) const
 {
 	if (index >= num_extruders)
 		index = num_extruders - 1;
-	else if (index < 0)
+	if (index < 0)
 		index = 0;
-	return p_extruders[index];
+	// The extruders are stored inline, but callers have always been able to modify them through a const position.
+	return const_cast<extruder&>(extruders[index]);
 }
 
 void position::reset_state()
@@ -392,7 +343,7 @@ void position::reset_state()
 	
 	//is_in_bounds = true; // I dont' think we want to reset this every time since it's only calculated if the current position
 	// changes.
-	p_extruders[current_tool].e_relative = 0;
+	get_current_extruder().e_relative = 0;
 	z_relative = 0;
 	feature_type_tag = 0;
 }
@@ -403,6 +354,7 @@ PyObject* position::to_py_tuple()
 	PyObject * py_command;
 	if (command.is_empty)
 	{
+		Py_INCREF(Py_None);
 		py_command = Py_None;
 	}
 	else
@@ -413,7 +365,7 @@ PyObject* position::to_py_tuple()
 			return NULL;
 		}
 	}
-	PyObject * py_extruders = extruder::build_py_object(p_extruders, num_extruders);
+	PyObject * py_extruders = extruder::build_py_object(extruders, num_extruders);
 	if (py_extruders == NULL)
 	{
 		return NULL;
@@ -511,13 +463,14 @@ PyObject* position::to_py_dict()
 	PyObject * py_command;
 	if (command.command.length() == 0)
 	{
+		Py_INCREF(Py_None);
 		py_command = Py_None;
 	}
 	else
 	{
 		py_command = command.to_py_object();
 	}
-	PyObject * py_extruders = extruder::build_py_object(p_extruders, num_extruders);
+	PyObject * py_extruders = extruder::build_py_object(extruders, num_extruders);
 	if (py_extruders == NULL)
 	{
 		return NULL;
@@ -663,3 +616,134 @@ PyObject* position::to_py_dict()
 
 	return p_position;
 }
+
+void position::serialize(binary_writer& writer) const
+{
+	command.serialize(writer);
+	writer.write_int(feature_type_tag);
+	writer.write_double(f);
+	writer.write_bool(f_null);
+	writer.write_double(x);
+	writer.write_bool(x_null);
+	writer.write_double(x_offset);
+	writer.write_double(x_firmware_offset);
+	writer.write_bool(x_homed);
+	writer.write_double(y);
+	writer.write_bool(y_null);
+	writer.write_double(y_offset);
+	writer.write_double(y_firmware_offset);
+	writer.write_bool(y_homed);
+	writer.write_double(z);
+	writer.write_bool(z_null);
+	writer.write_double(z_offset);
+	writer.write_double(z_firmware_offset);
+	writer.write_bool(z_homed);
+	writer.write_bool(is_metric);
+	writer.write_bool(is_metric_null);
+	writer.write_double(last_extrusion_height);
+	writer.write_bool(last_extrusion_height_null);
+	writer.write_long(layer);
+	writer.write_double(height);
+	writer.write_int(height_increment);
+	writer.write_int(height_increment_change_count);
+	writer.write_bool(is_printer_primed);
+	writer.write_bool(has_definite_position);
+	writer.write_double(z_relative);
+	writer.write_bool(is_relative);
+	writer.write_bool(is_relative_null);
+	writer.write_bool(is_extruder_relative);
+	writer.write_bool(is_extruder_relative_null);
+	writer.write_bool(is_layer_change);
+	writer.write_bool(is_height_change);
+	writer.write_bool(is_height_increment_change);
+	writer.write_bool(is_xy_travel);
+	writer.write_bool(is_xyz_travel);
+	writer.write_bool(is_zhop);
+	writer.write_bool(has_position_changed);
+	writer.write_bool(has_xy_position_changed);
+	writer.write_bool(has_received_home_command);
+	writer.write_bool(is_in_position);
+	writer.write_bool(in_path_position);
+	writer.write_long(file_line_number);
+	writer.write_long(gcode_number);
+	writer.write_long(file_position);
+	writer.write_bool(gcode_ignored);
+	writer.write_bool(is_in_bounds);
+	writer.write_bool(is_empty);
+	writer.write_int(current_tool);
+	writer.write_int(num_extruders);
+	for (int index = 0; index < num_extruders; index++)
+	{
+		extruders[index].serialize(writer);
+	}
+}
+
+bool position::deserialize(binary_reader& reader)
+{
+	if (!(
+		command.deserialize(reader) &&
+		reader.read_int(feature_type_tag) &&
+		reader.read_double(f) &&
+		reader.read_bool(f_null) &&
+		reader.read_double(x) &&
+		reader.read_bool(x_null) &&
+		reader.read_double(x_offset) &&
+		reader.read_double(x_firmware_offset) &&
+		reader.read_bool(x_homed) &&
+		reader.read_double(y) &&
+		reader.read_bool(y_null) &&
+		reader.read_double(y_offset) &&
+		reader.read_double(y_firmware_offset) &&
+		reader.read_bool(y_homed) &&
+		reader.read_double(z) &&
+		reader.read_bool(z_null) &&
+		reader.read_double(z_offset) &&
+		reader.read_double(z_firmware_offset) &&
+		reader.read_bool(z_homed) &&
+		reader.read_bool(is_metric) &&
+		reader.read_bool(is_metric_null) &&
+		reader.read_double(last_extrusion_height) &&
+		reader.read_bool(last_extrusion_height_null) &&
+		reader.read_long(layer) &&
+		reader.read_double(height) &&
+		reader.read_int(height_increment) &&
+		reader.read_int(height_increment_change_count) &&
+		reader.read_bool(is_printer_primed) &&
+		reader.read_bool(has_definite_position) &&
+		reader.read_double(z_relative) &&
+		reader.read_bool(is_relative) &&
+		reader.read_bool(is_relative_null) &&
+		reader.read_bool(is_extruder_relative) &&
+		reader.read_bool(is_extruder_relative_null) &&
+		reader.read_bool(is_layer_change) &&
+		reader.read_bool(is_height_change) &&
+		reader.read_bool(is_height_increment_change) &&
+		reader.read_bool(is_xy_travel) &&
+		reader.read_bool(is_xyz_travel) &&
+		reader.read_bool(is_zhop) &&
+		reader.read_bool(has_position_changed) &&
+		reader.read_bool(has_xy_position_changed) &&
+		reader.read_bool(has_received_home_command) &&
+		reader.read_bool(is_in_position) &&
+		reader.read_bool(in_path_position) &&
+		reader.read_long(file_line_number) &&
+		reader.read_long(gcode_number) &&
+		reader.read_long(file_position) &&
+		reader.read_bool(gcode_ignored) &&
+		reader.read_bool(is_in_bounds) &&
+		reader.read_bool(is_empty) &&
+		reader.read_int(current_tool) &&
+		reader.read_int(num_extruders)
+	))
+	{
+		return false;
+	}
+	if (num_extruders < 0 || num_extruders > MAX_EXTRUDERS)
+		return false;
+	for (int index = 0; index < num_extruders; index++)
+	{
+		if (!extruders[index].deserialize(reader))
+			return false;
+	}
+	return true;
+}
@@ -25,6 +25,7 @@
 #include <string>
 #include "parsed_command.h"
 #include "extruder.h"
+#include "binary_stream.h"
 #ifdef _DEBUG
 #undef _DEBUG
 #include <Python.h>
@@ -33,16 +34,32 @@
 #include <Python.h>
 #endif
 
+// The most extruders a position can track.  This matches the printer profile limit.
+#define MAX_EXTRUDERS 16
+
 struct position
 {
 	position();
 	position(int extruder_count);
 	position(const position &pos); // Copy Constructor
+	// Moves the command instead of copying it, so that vectors of snapshot plans can grow without allocating.
+	position(position&& pos) noexcept;
 	virtual ~position();
 	position& operator=(const position& pos);
+	position& operator=(position&& pos) noexcept;
+	/**
+	 * \brief Copies all of the state from another position except for the parsed command.  Only the extruders
+	 * in use are copied.  Nothing is allocated.
+	 */
+	void copy_state(const position& pos);
 	void reset_state();
 	PyObject * to_py_tuple();
 	PyObject * to_py_dict();
+	/**
+	 * \brief Writes the position, including its command and the extruders in use.
+	 */
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
 	parsed_command command;
 	int feature_type_tag;
 	double f;
@@ -96,11 +113,10 @@ struct position
 	bool is_empty;
 	int current_tool;
 	int num_extruders;
-	extruder * p_extruders;
+	extruder extruders[MAX_EXTRUDERS];
 	extruder& get_current_extruder() const;
 	extruder& get_extruder(int index) const;
 	void set_num_extruders(int num_extruders_);
-	void delete_extruders();
 	double get_gcode_x() const;
 	double get_gcode_y() const;
 	double get_gcode_z() const;
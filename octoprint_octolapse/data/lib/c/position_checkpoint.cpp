@@ -0,0 +1,245 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#define _CRT_SECURE_NO_DEPRECATE
+#include "position_checkpoint.h"
+#include "snapshot_plan_cache.h"
+#include "gcode_file_source.h"
+#include <cstdio>
+#include <cstring>
+
+static const char* checkpoint_index_magic = "OCTOLAPSE_CHECKPOINTS";
+
+position_checkpoint::position_checkpoint()
+{
+	file_position = 0;
+	lines_processed = 0;
+	gcodes_processed = 0;
+	comment_type = comment_process_type_unknown;
+	current_section = section_type_no_section;
+}
+
+void position_checkpoint::serialize(binary_writer& writer) const
+{
+	writer.write_long(file_position);
+	writer.write_int(lines_processed);
+	writer.write_int(gcodes_processed);
+	writer.write_int(static_cast<int>(comment_type));
+	writer.write_int(static_cast<int>(current_section));
+	pos.serialize(writer);
+}
+
+bool position_checkpoint::deserialize(binary_reader& reader)
+{
+	int comment_type_value;
+	int section_value;
+	if (!(
+		reader.read_long(file_position) &&
+		reader.read_int(lines_processed) &&
+		reader.read_int(gcodes_processed) &&
+		reader.read_int(comment_type_value) &&
+		reader.read_int(section_value) &&
+		pos.deserialize(reader)
+	))
+	{
+		return false;
+	}
+	comment_type = static_cast<comment_process_type>(comment_type_value);
+	current_section = static_cast<section_type>(section_value);
+	return true;
+}
+
+position_checkpoint_index::position_checkpoint_index()
+{
+}
+
+bool position_checkpoint_index::create_key(const std::string& gcode_file_path, const gcode_position_args& args, std::string& key)
+{
+	binary_writer settings;
+	args.serialize(settings);
+	return snapshot_plan_cache::create_key(gcode_file_path, settings.get_buffer(), key);
+}
+
+std::string position_checkpoint_index::get_index_file_path(const std::string& directory, const std::string& key)
+{
+	char file_name[32];
+	sprintf(file_name, "%016llx.checkpoints", binary_hash(key.c_str(), key.size()));
+	std::string file_path = directory;
+	if (!file_path.empty() && file_path[file_path.size() - 1] != '/' && file_path[file_path.size() - 1] != '\\')
+		file_path += "/";
+	file_path += file_name;
+	return file_path;
+}
+
+void position_checkpoint_index::clear()
+{
+	checkpoints_.clear();
+}
+
+void position_checkpoint_index::add(gcode_position& source, const long file_position, const int lines_processed, const int gcodes_processed)
+{
+	checkpoints_.push_back(position_checkpoint());
+	position_checkpoint& checkpoint = checkpoints_.back();
+	checkpoint.file_position = file_position;
+	checkpoint.lines_processed = lines_processed;
+	checkpoint.gcodes_processed = gcodes_processed;
+	gcode_comment_processor* p_comment_processor = source.get_gcode_comment_processor();
+	checkpoint.comment_type = p_comment_processor->get_comment_process_type();
+	checkpoint.current_section = p_comment_processor->get_current_section();
+	checkpoint.pos = *source.get_current_position_ptr();
+}
+
+bool position_checkpoint_index::save(const std::string& file_path, const std::string& key) const
+{
+	binary_writer writer;
+	writer.write_bytes(checkpoint_index_magic, strlen(checkpoint_index_magic));
+	writer.write_int(POSITION_CHECKPOINT_INDEX_VERSION);
+	writer.write_string(key);
+	writer.write_int(static_cast<int>(checkpoints_.size()));
+	for (std::vector<position_checkpoint>::const_iterator it = checkpoints_.begin(); it != checkpoints_.end(); ++it)
+		(*it).serialize(writer);
+
+	// Write to a temporary file first so that a partially written index can never be loaded.
+	const std::string temp_file_path = file_path + ".tmp";
+	FILE* p_file = fopen(temp_file_path.c_str(), "wb");
+	if (p_file == NULL)
+		return false;
+	const std::string& buffer = writer.get_buffer();
+	const bool success = fwrite(buffer.c_str(), 1, buffer.size(), p_file) == buffer.size();
+	if (fclose(p_file) != 0 || !success)
+	{
+		remove(temp_file_path.c_str());
+		return false;
+	}
+	// rename won't replace an existing file on Windows
+	remove(file_path.c_str());
+	if (rename(temp_file_path.c_str(), file_path.c_str()) != 0)
+	{
+		remove(temp_file_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool position_checkpoint_index::load(const std::string& file_path, const std::string& key)
+{
+	checkpoints_.clear();
+	FILE* p_file = fopen(file_path.c_str(), "rb");
+	if (p_file == NULL)
+		return false;
+	std::string contents;
+	char buffer[65536];
+	size_t bytes_read;
+	while ((bytes_read = fread(buffer, 1, sizeof(buffer), p_file)) > 0)
+		contents.append(buffer, bytes_read);
+	fclose(p_file);
+
+	binary_reader reader(contents.c_str(), contents.size());
+	const size_t magic_length = strlen(checkpoint_index_magic);
+	std::vector<char> magic(magic_length);
+	int version;
+	std::string stored_key;
+	int count;
+	if (
+		!reader.read_bytes(&magic[0], magic_length) ||
+		memcmp(&magic[0], checkpoint_index_magic, magic_length) != 0 ||
+		!reader.read_int(version) ||
+		version != POSITION_CHECKPOINT_INDEX_VERSION ||
+		!reader.read_string(stored_key) ||
+		stored_key != key ||
+		!reader.read_count(count)
+	)
+	{
+		return false;
+	}
+	std::vector<position_checkpoint> checkpoints(count);
+	for (int index = 0; index < count; index++)
+	{
+		if (!checkpoints[index].deserialize(reader))
+			return false;
+	}
+	if (!reader.is_at_end())
+		return false;
+	checkpoints_.swap(checkpoints);
+	return true;
+}
+
+const position_checkpoint* position_checkpoint_index::find(const long file_position) const
+{
+	// Binary search for the first checkpoint after the file position
+	size_t low = 0;
+	size_t high = checkpoints_.size();
+	while (low < high)
+	{
+		const size_t middle = low + (high - low) / 2;
+		if (checkpoints_[middle].file_position <= file_position)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	if (low == 0)
+		return NULL;
+	return &checkpoints_[low - 1];
+}
+
+size_t position_checkpoint_index::size() const
+{
+	return checkpoints_.size();
+}
+
+bool position_checkpoint_index::seek(gcode_position& target, gcode_parser& parser, const std::string& gcode_file_path, const position_checkpoint* p_checkpoint, const long file_position, int& lines_processed)
+{
+	lines_processed = 0;
+	int gcodes_processed = 0;
+	long current_file_position = 0;
+	gcode_file_source gcode_file;
+	if (!gcode_file.open(gcode_file_path))
+		return false;
+	if (p_checkpoint != NULL)
+	{
+		if (!gcode_file.seek(p_checkpoint->file_position))
+			return false;
+		// Positions are restored the same way a position trace is replayed
+		*target.get_next_position_ptr() = p_checkpoint->pos;
+		target.advance_position();
+		gcode_comment_processor* p_comment_processor = target.get_gcode_comment_processor();
+		p_comment_processor->set_comment_process_type(p_checkpoint->comment_type);
+		p_comment_processor->set_current_section(p_checkpoint->current_section);
+		lines_processed = p_checkpoint->lines_processed;
+		gcodes_processed = p_checkpoint->gcodes_processed;
+		current_file_position = p_checkpoint->file_position;
+	}
+	parsed_command cmd;
+	const char* p_line;
+	size_t line_length;
+	while (current_file_position < file_position && gcode_file.get_next_line(p_line, line_length))
+	{
+		current_file_position = gcode_file.get_file_position();
+		lines_processed++;
+		cmd.clear();
+		parser.try_parse_gcode(p_line, line_length, cmd);
+		if (cmd.gcode.length() > 0)
+			gcodes_processed++;
+		target.update(cmd, lines_processed, gcodes_processed, current_file_position);
+	}
+	gcode_file.close();
+	return true;
+}
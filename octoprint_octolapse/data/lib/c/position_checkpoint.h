@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef POSITION_CHECKPOINT_H
+#define POSITION_CHECKPOINT_H
+#include <string>
+#include <vector>
+#include "binary_stream.h"
+#include "position.h"
+#include "gcode_position.h"
+#include "gcode_parser.h"
+#include "gcode_comment_processor.h"
+
+// Increment whenever the index format, the position or the serialized command changes so that old indexes are ignored.
+#define POSITION_CHECKPOINT_INDEX_VERSION 1
+
+/**
+ * \brief The state of a gcode_position right after a layer change, which is enough to continue tracking the
+ * position from the next line.
+ */
+struct position_checkpoint
+{
+	position_checkpoint();
+	/**
+	 * \brief The offset of the line after the layer change, where tracking continues.
+	 */
+	long file_position;
+	int lines_processed;
+	int gcodes_processed;
+	comment_process_type comment_type;
+	section_type current_section;
+	position pos;
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
+};
+
+/**
+ * \brief The position checkpoints of a gcode file, in file order, so that the position can be rebuilt at any line
+ * by processing from the nearest checkpoint instead of from the top of the file.  Like a position trace, the index
+ * only depends on the file and the gcode_position_args.
+ */
+class position_checkpoint_index
+{
+public:
+	position_checkpoint_index();
+	/**
+	 * \brief Creates the key that identifies the gcode file and the position settings, see
+	 * snapshot_plan_cache::create_key.
+	 */
+	static bool create_key(const std::string& gcode_file_path, const gcode_position_args& args, std::string& key);
+	static std::string get_index_file_path(const std::string& directory, const std::string& key);
+	void clear();
+	/**
+	 * \brief Adds a checkpoint for the current position, which must follow the previous checkpoint in the file.
+	 * \param file_position The offset of the next line.
+	 */
+	void add(gcode_position& source, long file_position, int lines_processed, int gcodes_processed);
+	/**
+	 * \brief Saves the index, replacing any existing index.  The directory must already exist.
+	 */
+	bool save(const std::string& file_path, const std::string& key) const;
+	/**
+	 * \brief Loads the index, failing if it doesn't exist, is damaged or was created with a different key.
+	 */
+	bool load(const std::string& file_path, const std::string& key);
+	/**
+	 * \brief Finds the last checkpoint at or before the file position.
+	 * \return NULL if there is none.
+	 */
+	const position_checkpoint* find(long file_position) const;
+	size_t size() const;
+	/**
+	 * \brief Rebuilds the position as if every line before file_position had been processed, starting from the
+	 * checkpoint, or from the top of the file if the checkpoint is NULL.  The position must have just been created.
+	 * \param lines_processed Receives the number of lines before file_position.
+	 * \return false if the gcode file could not be read.
+	 */
+	static bool seek(gcode_position& target, gcode_parser& parser, const std::string& gcode_file_path, const position_checkpoint* p_checkpoint, long file_position, int& lines_processed);
+private:
+	std::vector<position_checkpoint> checkpoints_;
+};
+#endif
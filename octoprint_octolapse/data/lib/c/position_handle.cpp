@@ -0,0 +1,237 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "position_handle.h"
+#include "logging.h"
+#include "python_helpers.h"
+#include "position_view.h"
+#include <sstream>
+
+#if PY_VERSION_HEX >= 0x03070000
+#define POSITION_HANDLE_FAST_FLAGS METH_FASTCALL
+// Methods with arguments get them as an array, without a tuple or any format string parsing.
+#define POSITION_HANDLE_FAST_METHOD(name) \
+	static PyObject * name(PyObject * self, PyObject * const * args, Py_ssize_t nargs) \
+	{ \
+		return name##_impl(reinterpret_cast<position_handle*>(self), args, nargs); \
+	}
+#else
+#define POSITION_HANDLE_FAST_FLAGS METH_VARARGS
+#define POSITION_HANDLE_FAST_METHOD(name) \
+	static PyObject * name(PyObject * self, PyObject * args) \
+	{ \
+		return name##_impl(reinterpret_cast<position_handle*>(self), &PyTuple_GET_ITEM(args, 0), PyTuple_GET_SIZE(args)); \
+	}
+#endif
+
+static bool position_handle_check_nargs(const char * name, Py_ssize_t nargs, Py_ssize_t expected)
+{
+	if (nargs == expected)
+		return true;
+	std::stringstream message;
+	message << "GcodePositionProcessor.PositionHandle." << name << " - Expected " << expected << " arguments, but received " << nargs << ".";
+	PyErr_SetString(PyExc_TypeError, message.str().c_str());
+	octolapse_log_exception(octolapse_log::GCODE_POSITION, message.str());
+	return false;
+}
+
+static bool position_handle_update(position_handle * p_handle, const char * name, PyObject * const * args, Py_ssize_t nargs)
+{
+	if (!position_handle_check_nargs(name, nargs, 1))
+		return false;
+	const char * gcode = PyUnicode_SafeAsString(args[0]);
+	if (gcode == NULL)
+	{
+		std::string message = "GcodePositionProcessor.PositionHandle.";
+		message.append(name).append(" - Error parsing parameters.");
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	octolapse_update_log_levels();
+	const long long start_ns = processing_stats_get_time_ns();
+	parsed_command command;
+	p_handle->p_state->parser.try_parse_gcode(gcode, command);
+	p_handle->p_gcode_position->update(command, -1, -1, -1);
+	p_handle->p_update_stats->add_call(processing_stats_get_time_ns() - start_ns);
+	return true;
+}
+
+static PyObject * position_handle_Update_impl(position_handle * p_handle, PyObject * const * args, Py_ssize_t nargs)
+{
+	if (!position_handle_update(p_handle, "Update", args, nargs))
+		return NULL;
+	return p_handle->p_gcode_position->get_current_position_ptr()->to_py_tuple();
+}
+POSITION_HANDLE_FAST_METHOD(position_handle_Update)
+
+static PyObject * position_handle_UpdateView_impl(position_handle * p_handle, PyObject * const * args, Py_ssize_t nargs)
+{
+	if (!position_handle_update(p_handle, "UpdateView", args, nargs))
+		return NULL;
+	return position_view_create(*p_handle->p_gcode_position->get_current_position_ptr());
+}
+POSITION_HANDLE_FAST_METHOD(position_handle_UpdateView)
+
+static PyObject * position_handle_UpdatePosition_impl(position_handle * p_handle, PyObject * const * args, Py_ssize_t nargs)
+{
+	// Takes the same (x, update_x, y, update_y, z, update_z, e, update_e, f, update_f) arguments as UpdatePosition.
+	if (!position_handle_check_nargs("UpdatePosition", nargs, 10))
+		return NULL;
+	double values[5];
+	bool updates[5];
+	for (int index = 0; index < 5; index++)
+	{
+		values[index] = PyFloat_AsDouble(args[index * 2]);
+		updates[index] = PyIntOrLong_AsLong(args[index * 2 + 1]) > 0;
+	}
+	if (PyErr_Occurred())
+	{
+		std::string message = "GcodePositionProcessor.PositionHandle.UpdatePosition - Error parsing parameters.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return NULL;
+	}
+	gcode_position * p_gcode_position = p_handle->p_gcode_position.get();
+	p_gcode_position->update_position(
+		p_gcode_position->get_current_position_ptr(),
+		values[0],
+		updates[0],
+		values[1],
+		updates[1],
+		values[2],
+		updates[2],
+		values[3],
+		updates[3],
+		values[4],
+		updates[4],
+		true,
+		false);
+	return p_gcode_position->get_current_position_ptr()->to_py_tuple();
+}
+POSITION_HANDLE_FAST_METHOD(position_handle_UpdatePosition)
+
+static PyObject * position_handle_Undo(PyObject * self, PyObject * args)
+{
+	reinterpret_cast<position_handle*>(self)->p_gcode_position->undo_update();
+	return Py_BuildValue("O", Py_True);
+}
+
+static PyObject * position_handle_GetCurrentPositionTuple(PyObject * self, PyObject * args)
+{
+	return reinterpret_cast<position_handle*>(self)->p_gcode_position->get_current_position_ptr()->to_py_tuple();
+}
+
+static PyObject * position_handle_GetCurrentPositionView(PyObject * self, PyObject * args)
+{
+	return position_view_create(*reinterpret_cast<position_handle*>(self)->p_gcode_position->get_current_position_ptr());
+}
+
+static PyObject * position_handle_GetPreviousPositionTuple(PyObject * self, PyObject * args)
+{
+	return reinterpret_cast<position_handle*>(self)->p_gcode_position->get_previous_position_ptr()->to_py_tuple();
+}
+
+static PyObject * position_handle_GetPreviousPositionView(PyObject * self, PyObject * args)
+{
+	return position_view_create(*reinterpret_cast<position_handle*>(self)->p_gcode_position->get_previous_position_ptr());
+}
+
+static void position_handle_dealloc(PyObject * self)
+{
+	position_handle * p_handle = reinterpret_cast<position_handle*>(self);
+	typedef std::shared_ptr<gcode_position> gcode_position_ptr;
+	p_handle->p_gcode_position.~gcode_position_ptr();
+	Py_XDECREF(p_handle->py_owner);
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyMethodDef position_handle_methods[] = {
+	{ "Update", (PyCFunction)(void(*)(void))position_handle_Update, POSITION_HANDLE_FAST_FLAGS, "Update the position from gcode and return it in tuple form." },
+	{ "UpdateView", (PyCFunction)(void(*)(void))position_handle_UpdateView, POSITION_HANDLE_FAST_FLAGS, "Update the position from gcode and return it as a PositionView." },
+	{ "UpdatePosition", (PyCFunction)(void(*)(void))position_handle_UpdatePosition, POSITION_HANDLE_FAST_FLAGS, "Update x, y, z, e and f, each followed by a flag telling if it should be updated.  Returns the position in tuple form." },
+	{ "Undo", (PyCFunction)position_handle_Undo, METH_NOARGS, "Undo the last update.  You can only undo once." },
+	{ "GetCurrentPositionTuple", (PyCFunction)position_handle_GetCurrentPositionTuple, METH_NOARGS, "Returns the current position in tuple form." },
+	{ "GetCurrentPositionView", (PyCFunction)position_handle_GetCurrentPositionView, METH_NOARGS, "Returns the current position as a PositionView." },
+	{ "GetPreviousPositionTuple", (PyCFunction)position_handle_GetPreviousPositionTuple, METH_NOARGS, "Returns the previous position in tuple form." },
+	{ "GetPreviousPositionView", (PyCFunction)position_handle_GetPreviousPositionView, METH_NOARGS, "Returns the previous position as a PositionView." },
+	{ NULL, NULL, 0, NULL }
+};
+
+PyTypeObject position_handle_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.PositionHandle"
+};
+
+bool position_handle_add_type(PyObject * module)
+{
+	position_handle_type.tp_basicsize = sizeof(position_handle);
+	position_handle_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	position_handle_type.tp_doc = "Refers directly to the gcode position of one key.  Returned by Initialize.";
+	position_handle_type.tp_dealloc = position_handle_dealloc;
+	position_handle_type.tp_methods = position_handle_methods;
+	if (PyType_Ready(&position_handle_type) < 0)
+	{
+		std::string message = "position_handle_add_type - Unable to ready the PositionHandle type.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	Py_INCREF(&position_handle_type);
+	if (PyModule_AddObject(module, "PositionHandle", reinterpret_cast<PyObject*>(&position_handle_type)) < 0)
+	{
+		Py_DECREF(&position_handle_type);
+		std::string message = "position_handle_add_type - Unable to add the PositionHandle type to the module.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	return true;
+}
+
+PyObject * position_handle_create(PyObject * self, const std::string& key)
+{
+	processor_state * p_state = processor_get_state(self);
+	std::map<std::string, std::shared_ptr<gcode_position> >::iterator gcode_position_iterator = p_state->gcode_positions.find(key);
+	if (gcode_position_iterator == p_state->gcode_positions.end())
+	{
+		std::string message = "GcodePositionProcessor.position_handle_create - No position processor was found for the given key: ";
+		message += key;
+		octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR, message);
+		return Py_BuildValue("O", Py_False);
+	}
+	PyObject * py_handle = position_handle_type.tp_alloc(&position_handle_type, 0);
+	if (py_handle == NULL)
+	{
+		std::string message = "position_handle_create - Unable to allocate a PositionHandle.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return NULL;
+	}
+	position_handle * p_handle = reinterpret_cast<position_handle*>(py_handle);
+	p_handle->py_owner = NULL;
+	if (self != NULL && PyObject_TypeCheck(self, &processor_type))
+	{
+		Py_INCREF(self);
+		p_handle->py_owner = self;
+	}
+	p_handle->p_state = p_state;
+	new (&p_handle->p_gcode_position) std::shared_ptr<gcode_position>(gcode_position_iterator->second);
+	// std::map never moves its values, so the stats stay put while the owner is alive.
+	p_handle->p_update_stats = &p_state->update_stats[key];
+	return py_handle;
+}
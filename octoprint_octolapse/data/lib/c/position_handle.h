@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef POSITION_HANDLE_H
+#define POSITION_HANDLE_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <string>
+#include <memory>
+#include "processor_state.h"
+
+/**
+ * \brief A python object returned by Initialize that refers directly to the gcode position of one key, so that the live
+ * position calls skip the key lookup.  On python 3.7+ the methods that take arguments use METH_FASTCALL.
+ * If the key is initialized again the handle keeps the old position, so get a new handle after every Initialize.
+ */
+typedef struct {
+	PyObject_HEAD
+	// The Processor that owns p_state and p_update_stats, or NULL for the module's state, which is never freed.
+	PyObject * py_owner;
+	processor_state * p_state;
+	std::shared_ptr<gcode_position> p_gcode_position;
+	processing_call_stats * p_update_stats;
+} position_handle;
+
+extern PyTypeObject position_handle_type;
+
+/**
+ * \brief Readies the PositionHandle type and adds it to the module.  Returns false on failure.
+ */
+bool position_handle_add_type(PyObject * module);
+/**
+ * \brief Creates a PositionHandle for the gcode position with the given key.  self is the object the module function was
+ * called on.  Returns False if the key has no position.
+ */
+PyObject * position_handle_create(PyObject * self, const std::string& key);
+#endif
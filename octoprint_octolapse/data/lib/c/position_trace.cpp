@@ -0,0 +1,544 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#define _CRT_SECURE_NO_DEPRECATE
+#include "position_trace.h"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+static const char* position_trace_magic = "OCTOLAPSE_TRACE";
+// The record count, comment process type and trace size follow the magic and version, and are written when the trace
+// is closed.
+static const long position_trace_footer_offset = 19;
+// The position state is compared with the previous one in blocks of this many bytes, and only runs of changed blocks
+// are written.  Most lines only move a couple of axes, so there are only a few short runs.
+static const size_t position_trace_state_block_size = 8;
+
+void position_trace_state::from_position(const position& pos)
+{
+	f = pos.f;
+	x = pos.x;
+	x_offset = pos.x_offset;
+	x_firmware_offset = pos.x_firmware_offset;
+	y = pos.y;
+	y_offset = pos.y_offset;
+	y_firmware_offset = pos.y_firmware_offset;
+	z = pos.z;
+	z_offset = pos.z_offset;
+	z_firmware_offset = pos.z_firmware_offset;
+	last_extrusion_height = pos.last_extrusion_height;
+	layer = pos.layer;
+	height = pos.height;
+	z_relative = pos.z_relative;
+	file_line_number = pos.file_line_number;
+	gcode_number = pos.gcode_number;
+	file_position = pos.file_position;
+	feature_type_tag = pos.feature_type_tag;
+	height_increment = pos.height_increment;
+	height_increment_change_count = pos.height_increment_change_count;
+	current_tool = pos.current_tool;
+	num_extruders = pos.num_extruders;
+	f_null = pos.f_null;
+	x_null = pos.x_null;
+	x_homed = pos.x_homed;
+	y_null = pos.y_null;
+	y_homed = pos.y_homed;
+	z_null = pos.z_null;
+	z_homed = pos.z_homed;
+	is_metric = pos.is_metric;
+	is_metric_null = pos.is_metric_null;
+	last_extrusion_height_null = pos.last_extrusion_height_null;
+	is_printer_primed = pos.is_printer_primed;
+	has_definite_position = pos.has_definite_position;
+	is_relative = pos.is_relative;
+	is_relative_null = pos.is_relative_null;
+	is_extruder_relative = pos.is_extruder_relative;
+	is_extruder_relative_null = pos.is_extruder_relative_null;
+	is_layer_change = pos.is_layer_change;
+	is_height_change = pos.is_height_change;
+	is_height_increment_change = pos.is_height_increment_change;
+	is_xy_travel = pos.is_xy_travel;
+	is_xyz_travel = pos.is_xyz_travel;
+	is_zhop = pos.is_zhop;
+	has_position_changed = pos.has_position_changed;
+	has_xy_position_changed = pos.has_xy_position_changed;
+	has_received_home_command = pos.has_received_home_command;
+	is_in_position = pos.is_in_position;
+	in_path_position = pos.in_path_position;
+	gcode_ignored = pos.gcode_ignored;
+	is_in_bounds = pos.is_in_bounds;
+	is_empty = pos.is_empty;
+}
+
+void position_trace_state::to_position(position& pos) const
+{
+	pos.f = f;
+	pos.x = x;
+	pos.x_offset = x_offset;
+	pos.x_firmware_offset = x_firmware_offset;
+	pos.y = y;
+	pos.y_offset = y_offset;
+	pos.y_firmware_offset = y_firmware_offset;
+	pos.z = z;
+	pos.z_offset = z_offset;
+	pos.z_firmware_offset = z_firmware_offset;
+	pos.last_extrusion_height = last_extrusion_height;
+	pos.layer = layer;
+	pos.height = height;
+	pos.z_relative = z_relative;
+	pos.file_line_number = file_line_number;
+	pos.gcode_number = gcode_number;
+	pos.file_position = file_position;
+	pos.feature_type_tag = feature_type_tag;
+	pos.height_increment = height_increment;
+	pos.height_increment_change_count = height_increment_change_count;
+	pos.current_tool = current_tool;
+	pos.num_extruders = num_extruders;
+	pos.f_null = f_null;
+	pos.x_null = x_null;
+	pos.x_homed = x_homed;
+	pos.y_null = y_null;
+	pos.y_homed = y_homed;
+	pos.z_null = z_null;
+	pos.z_homed = z_homed;
+	pos.is_metric = is_metric;
+	pos.is_metric_null = is_metric_null;
+	pos.last_extrusion_height_null = last_extrusion_height_null;
+	pos.is_printer_primed = is_printer_primed;
+	pos.has_definite_position = has_definite_position;
+	pos.is_relative = is_relative;
+	pos.is_relative_null = is_relative_null;
+	pos.is_extruder_relative = is_extruder_relative;
+	pos.is_extruder_relative_null = is_extruder_relative_null;
+	pos.is_layer_change = is_layer_change;
+	pos.is_height_change = is_height_change;
+	pos.is_height_increment_change = is_height_increment_change;
+	pos.is_xy_travel = is_xy_travel;
+	pos.is_xyz_travel = is_xyz_travel;
+	pos.is_zhop = is_zhop;
+	pos.has_position_changed = has_position_changed;
+	pos.has_xy_position_changed = has_xy_position_changed;
+	pos.has_received_home_command = has_received_home_command;
+	pos.is_in_position = is_in_position;
+	pos.in_path_position = in_path_position;
+	pos.gcode_ignored = gcode_ignored;
+	pos.is_in_bounds = is_in_bounds;
+	pos.is_empty = is_empty;
+}
+
+position_trace_record::position_trace_record()
+{
+	flags = 0;
+	lines_processed = 0;
+	gcodes_processed = 0;
+	file_position = 0;
+}
+
+position_trace_writer::position_trace_writer()
+{
+	p_file_ = NULL;
+	record_count_ = 0;
+	trace_size_ = 0;
+	file_size_offset_ = 0;
+	has_error_ = false;
+}
+
+position_trace_writer::position_trace_writer(const position_trace_writer &source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+position_trace_writer::~position_trace_writer()
+{
+	discard();
+}
+
+bool position_trace_writer::open(const std::string& file_path, const std::string& key, long file_size)
+{
+	discard();
+	file_path_ = file_path;
+	temp_file_path_ = file_path + ".tmp";
+	p_file_ = fopen(temp_file_path_.c_str(), "wb");
+	if (p_file_ == NULL)
+		return false;
+	setvbuf(p_file_, NULL, _IOFBF, POSITION_TRACE_BUFFER_SIZE);
+	has_error_ = false;
+
+	writer_.clear();
+	writer_.write_bytes(position_trace_magic, strlen(position_trace_magic));
+	writer_.write_int(POSITION_TRACE_VERSION);
+	// The record count is unknown until the trace is closed
+	const long long record_count = -1;
+	writer_.write_bytes(reinterpret_cast<const char*>(&record_count), sizeof(record_count));
+	writer_.write_int(static_cast<int>(comment_process_type_unknown));
+	const long long trace_size = -1;
+	writer_.write_bytes(reinterpret_cast<const char*>(&trace_size), sizeof(trace_size));
+	writer_.write_string(key);
+	file_size_offset_ = static_cast<long>(writer_.get_buffer().size());
+	writer_.write_long(file_size);
+	state_.clear();
+	const std::string& header = writer_.get_buffer();
+	has_error_ = fwrite(header.c_str(), 1, header.size(), p_file_) != header.size();
+	record_count_ = 0;
+	trace_size_ = static_cast<long long>(header.size());
+	return !has_error_;
+}
+
+void position_trace_writer::write(const position_trace_record& record, const position* p_position)
+{
+	if (p_file_ == NULL || has_error_)
+		return;
+	writer_.clear();
+	// The length is filled in once the record is complete.
+	writer_.write_int(0);
+	writer_.write_char(static_cast<char>(record.flags));
+	writer_.write_int(record.lines_processed);
+	writer_.write_int(record.gcodes_processed);
+	writer_.write_long(record.file_position);
+	if ((record.flags & position_trace_has_position) != 0 && p_position != NULL)
+	{
+		p_position->command.serialize(writer_);
+		write_state(*p_position);
+	}
+	const std::string& block = writer_.get_buffer();
+	const int length = static_cast<int>(block.size() - sizeof(int));
+	writer_.replace_bytes(0, reinterpret_cast<const char*>(&length), sizeof(length));
+	has_error_ = fwrite(block.c_str(), 1, block.size(), p_file_) != block.size();
+	record_count_++;
+	trace_size_ += static_cast<long long>(block.size());
+}
+
+void position_trace_writer::write_state(const position& pos)
+{
+	position_trace_state fixed_state;
+	// Clear the padding too, otherwise it would look like it changed.
+	memset(&fixed_state, 0, sizeof(fixed_state));
+	fixed_state.from_position(pos);
+	const size_t extruders_size = sizeof(extruder) * static_cast<size_t>(pos.num_extruders);
+	const size_t state_size = sizeof(fixed_state) + extruders_size;
+	if (state_size != state_.size())
+	{
+		// The first state is written in full.
+		state_.resize(state_size);
+		memcpy(&state_[0], &fixed_state, sizeof(fixed_state));
+		memcpy(&state_[sizeof(fixed_state)], pos.extruders, extruders_size);
+		writer_.write_bool(true);
+		writer_.write_string(state_);
+		return;
+	}
+	writer_.write_bool(false);
+	// Each run is written as its start, its length and the changed bytes, and the number of runs is written first.
+	const size_t count_position = writer_.get_buffer().size();
+	writer_.write_int(0);
+	int num_runs = 0;
+	size_t run_start = 0;
+	bool in_run = false;
+	for (size_t start = 0; start <= state_size; start += position_trace_state_block_size)
+	{
+		bool is_changed = false;
+		if (start < state_size)
+		{
+			const size_t length = std::min(position_trace_state_block_size, state_size - start);
+			const char* p_new = start < sizeof(fixed_state)
+				? reinterpret_cast<const char*>(&fixed_state) + start
+				: reinterpret_cast<const char*>(pos.extruders) + (start - sizeof(fixed_state));
+			is_changed = memcmp(p_new, state_.c_str() + start, length) != 0;
+			if (is_changed)
+				memcpy(&state_[start], p_new, length);
+		}
+		if (is_changed && !in_run)
+		{
+			run_start = start;
+			in_run = true;
+		}
+		else if (!is_changed && in_run)
+		{
+			const size_t run_end = std::min(start, state_size);
+			writer_.write_int(static_cast<int>(run_start));
+			writer_.write_int(static_cast<int>(run_end - run_start));
+			writer_.write_bytes(state_.c_str() + run_start, run_end - run_start);
+			num_runs++;
+			in_run = false;
+		}
+	}
+	writer_.replace_bytes(count_position, reinterpret_cast<const char*>(&num_runs), sizeof(num_runs));
+}
+
+bool position_trace_writer::close(comment_process_type final_comment_process_type, long file_size)
+{
+	if (p_file_ == NULL)
+		return false;
+	if (!has_error_)
+	{
+		const int comment_type = static_cast<int>(final_comment_process_type);
+		const long long file_size_64 = file_size;
+		has_error_ = (
+			fseek(p_file_, position_trace_footer_offset, SEEK_SET) != 0 ||
+			fwrite(&record_count_, sizeof(record_count_), 1, p_file_) != 1 ||
+			fwrite(&comment_type, sizeof(comment_type), 1, p_file_) != 1 ||
+			fwrite(&trace_size_, sizeof(trace_size_), 1, p_file_) != 1 ||
+			fseek(p_file_, file_size_offset_, SEEK_SET) != 0 ||
+			fwrite(&file_size_64, sizeof(file_size_64), 1, p_file_) != 1
+		);
+	}
+	const bool closed = fclose(p_file_) == 0;
+	p_file_ = NULL;
+	if (has_error_ || !closed)
+	{
+		remove(temp_file_path_.c_str());
+		return false;
+	}
+	// rename won't replace an existing file on Windows
+	remove(file_path_.c_str());
+	if (rename(temp_file_path_.c_str(), file_path_.c_str()) != 0)
+	{
+		remove(temp_file_path_.c_str());
+		return false;
+	}
+	return true;
+}
+
+void position_trace_writer::discard()
+{
+	if (p_file_ == NULL)
+		return;
+	fclose(p_file_);
+	p_file_ = NULL;
+	remove(temp_file_path_.c_str());
+}
+
+bool position_trace_writer::is_open() const
+{
+	return p_file_ != NULL;
+}
+
+position_trace_reader::position_trace_reader()
+{
+	p_file_ = NULL;
+	records_remaining_ = 0;
+	final_comment_process_type_ = comment_process_type_unknown;
+	file_size_ = 0;
+	buffer_position_ = 0;
+	buffer_length_ = 0;
+}
+
+position_trace_reader::position_trace_reader(const position_trace_reader &source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+position_trace_reader::~position_trace_reader()
+{
+	close();
+}
+
+bool position_trace_reader::open(const std::string& file_path, const std::string& key)
+{
+	close();
+	p_file_ = fopen(file_path.c_str(), "rb");
+	if (p_file_ == NULL)
+		return false;
+
+	const size_t magic_length = strlen(position_trace_magic);
+	std::vector<char> magic(magic_length);
+	int version;
+	int comment_type;
+	long long trace_size;
+	int key_length;
+	std::string stored_key;
+	bool success = (
+		fread(&magic[0], 1, magic_length, p_file_) == magic_length &&
+		memcmp(&magic[0], position_trace_magic, magic_length) == 0 &&
+		fread(&version, sizeof(version), 1, p_file_) == 1 &&
+		version == POSITION_TRACE_VERSION &&
+		fread(&records_remaining_, sizeof(records_remaining_), 1, p_file_) == 1 &&
+		records_remaining_ >= 0 &&
+		fread(&comment_type, sizeof(comment_type), 1, p_file_) == 1 &&
+		fread(&trace_size, sizeof(trace_size), 1, p_file_) == 1 &&
+		fread(&key_length, sizeof(key_length), 1, p_file_) == 1 &&
+		key_length == static_cast<int>(key.size())
+	);
+	if (success)
+	{
+		stored_key.resize(key.size());
+		success = (key.empty() || fread(&stored_key[0], 1, stored_key.size(), p_file_) == stored_key.size()) && stored_key == key;
+	}
+	long long file_size;
+	success = success && fread(&file_size, sizeof(file_size), 1, p_file_) == 1;
+	if (success)
+	{
+		// A trace that was truncated or appended to can't be replayed.
+		const long header_end = ftell(p_file_);
+		success = (
+			fseek(p_file_, 0, SEEK_END) == 0 &&
+			static_cast<long long>(ftell(p_file_)) == trace_size &&
+			fseek(p_file_, header_end, SEEK_SET) == 0
+		);
+	}
+	if (!success)
+	{
+		close();
+		return false;
+	}
+	final_comment_process_type_ = static_cast<comment_process_type>(comment_type);
+	file_size_ = static_cast<long>(file_size);
+	state_.clear();
+	buffer_.resize(POSITION_TRACE_BUFFER_SIZE);
+	buffer_position_ = 0;
+	buffer_length_ = 0;
+	return true;
+}
+
+bool position_trace_reader::read_block(const char*& p_block, size_t& block_length)
+{
+	int length;
+	if (!fill_buffer(sizeof(length)))
+		return false;
+	memcpy(&length, &buffer_[buffer_position_], sizeof(length));
+	buffer_position_ += sizeof(length);
+	if (length < 0 || !fill_buffer(static_cast<size_t>(length)))
+		return false;
+	p_block = &buffer_[buffer_position_];
+	block_length = static_cast<size_t>(length);
+	buffer_position_ += block_length;
+	return true;
+}
+
+bool position_trace_reader::fill_buffer(size_t length)
+{
+	if (buffer_length_ - buffer_position_ >= length)
+		return true;
+	// Move the unread bytes to the front, then read as much as fits after them.
+	const size_t unread = buffer_length_ - buffer_position_;
+	if (unread > 0)
+		memmove(&buffer_[0], &buffer_[buffer_position_], unread);
+	buffer_position_ = 0;
+	buffer_length_ = unread;
+	if (buffer_.size() < length)
+		buffer_.resize(length);
+	buffer_length_ += fread(&buffer_[buffer_length_], 1, buffer_.size() - buffer_length_, p_file_);
+	return buffer_length_ >= length;
+}
+
+bool position_trace_reader::read_next(position_trace_record& record, position& pos)
+{
+	const char* p_block;
+	size_t block_length;
+	if (p_file_ == NULL || records_remaining_ <= 0 || !read_block(p_block, block_length))
+		return false;
+	binary_reader reader(p_block, block_length);
+	char flags;
+	if (
+		!reader.read_char(flags) ||
+		!reader.read_int(record.lines_processed) ||
+		!reader.read_int(record.gcodes_processed) ||
+		!reader.read_long(record.file_position)
+	)
+	{
+		return false;
+	}
+	record.flags = static_cast<unsigned char>(flags);
+	if ((record.flags & position_trace_has_position) != 0)
+	{
+		if (!pos.command.deserialize(reader) || !read_state(reader, pos))
+			return false;
+	}
+	records_remaining_--;
+	return reader.is_at_end();
+}
+
+bool position_trace_reader::read_state(binary_reader& reader, position& pos)
+{
+	bool is_full_state;
+	if (!reader.read_bool(is_full_state))
+		return false;
+	if (is_full_state)
+	{
+		if (!reader.read_string(state_))
+			return false;
+	}
+	else
+	{
+		if (state_.empty())
+			return false;
+		int num_runs;
+		if (!reader.read_int(num_runs))
+			return false;
+		for (int run = 0; run < num_runs; run++)
+		{
+			int run_start;
+			int run_length;
+			if (
+				!reader.read_int(run_start) ||
+				!reader.read_int(run_length) ||
+				run_start < 0 || run_length < 0 ||
+				static_cast<size_t>(run_start) + static_cast<size_t>(run_length) > state_.size() ||
+				!reader.read_bytes(&state_[run_start], static_cast<size_t>(run_length))
+			)
+			{
+				return false;
+			}
+		}
+	}
+	position_trace_state fixed_state;
+	if (state_.size() < sizeof(fixed_state))
+		return false;
+	memcpy(&fixed_state, state_.c_str(), sizeof(fixed_state));
+	if (
+		fixed_state.num_extruders < 0 || fixed_state.num_extruders > MAX_EXTRUDERS ||
+		state_.size() != sizeof(fixed_state) + sizeof(extruder) * static_cast<size_t>(fixed_state.num_extruders)
+	)
+	{
+		return false;
+	}
+	fixed_state.to_position(pos);
+	memcpy(pos.extruders, state_.c_str() + sizeof(fixed_state), sizeof(extruder) * static_cast<size_t>(fixed_state.num_extruders));
+	return true;
+}
+
+bool position_trace_reader::is_complete() const
+{
+	return records_remaining_ == 0;
+}
+
+comment_process_type position_trace_reader::get_final_comment_process_type() const
+{
+	return final_comment_process_type_;
+}
+
+long position_trace_reader::get_file_size() const
+{
+	return file_size_;
+}
+
+void position_trace_reader::close()
+{
+	if (p_file_ != NULL)
+	{
+		fclose(p_file_);
+		p_file_ = NULL;
+	}
+	records_remaining_ = 0;
+}
@@ -0,0 +1,218 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef POSITION_TRACE_H
+#define POSITION_TRACE_H
+#include <string>
+#include <cstdio>
+#include <vector>
+#include "binary_stream.h"
+#include "position.h"
+#include "gcode_comment_processor.h"
+
+// Increment whenever the trace format, the position or the serialized command changes so that old traces are ignored.
+#define POSITION_TRACE_VERSION 1
+// The size of the buffers used when reading and writing traces.
+#define POSITION_TRACE_BUFFER_SIZE 1048576
+
+enum position_trace_flags
+{
+	// The line contained gcode, so stabilization processes the position.
+	position_trace_has_gcode = 1,
+	// The parser found a command on the line.
+	position_trace_found_command = 2,
+	// The line produced a new position, which follows the record.  Lines that are only comments don't move the printer.
+	position_trace_has_position = 4,
+	// Snapshots were enabled after the line was processed (@OCTOLAPSE START-SNAPSHOTS/STOP-SNAPSHOTS).
+	position_trace_snapshots_enabled = 8
+};
+
+/**
+ * \brief One line of a position trace.
+ */
+struct position_trace_record
+{
+	position_trace_record();
+	unsigned char flags;
+	int lines_processed;
+	int gcodes_processed;
+	long file_position;
+};
+
+/**
+ * \brief The fixed size part of a position, everything but the command and the extruders.  It is copied to and from
+ * the trace as raw bytes, which is much faster than serializing each field.  The fields are ordered by size to
+ * avoid padding.
+ */
+struct position_trace_state
+{
+	void from_position(const position& pos);
+	void to_position(position& pos) const;
+	double f;
+	double x;
+	double x_offset;
+	double x_firmware_offset;
+	double y;
+	double y_offset;
+	double y_firmware_offset;
+	double z;
+	double z_offset;
+	double z_firmware_offset;
+	double last_extrusion_height;
+	long layer;
+	double height;
+	double z_relative;
+	long file_line_number;
+	long gcode_number;
+	long file_position;
+	int feature_type_tag;
+	int height_increment;
+	int height_increment_change_count;
+	int current_tool;
+	int num_extruders;
+	bool f_null;
+	bool x_null;
+	bool x_homed;
+	bool y_null;
+	bool y_homed;
+	bool z_null;
+	bool z_homed;
+	bool is_metric;
+	bool is_metric_null;
+	bool last_extrusion_height_null;
+	bool is_printer_primed;
+	bool has_definite_position;
+	bool is_relative;
+	bool is_relative_null;
+	bool is_extruder_relative;
+	bool is_extruder_relative_null;
+	bool is_layer_change;
+	bool is_height_change;
+	bool is_height_increment_change;
+	bool is_xy_travel;
+	bool is_xyz_travel;
+	bool is_zhop;
+	bool has_position_changed;
+	bool has_xy_position_changed;
+	bool has_received_home_command;
+	bool is_in_position;
+	bool in_path_position;
+	bool gcode_ignored;
+	bool is_in_bounds;
+	bool is_empty;
+};
+
+/**
+ * \brief Writes the result of tracking the position through a gcode file, one record per line that contains gcode or
+ * moves the printer, so that stabilization can later be repeated with different trigger and stabilization settings
+ * without parsing the file again.  Each position is stored as its command plus the blocks of its
+ * position_trace_state and extruders that changed since the previous position.  A final record without a position
+ * holds the line and gcode counts for the whole file.  The trace is written to a temporary file and only appears
+ * under its real name once it is complete.
+ */
+class position_trace_writer
+{
+public:
+	position_trace_writer();
+	~position_trace_writer();
+	/**
+	 * \param key Identifies the gcode file and position settings, see snapshot_plan_cache::create_key.
+	 * \param file_size The size of the gcode file, used to report progress when the trace is replayed.
+	 */
+	bool open(const std::string& file_path, const std::string& key, long file_size);
+	void write(const position_trace_record& record, const position* p_position);
+	/**
+	 * \brief Finishes the trace and moves it to its real name.
+	 * \param file_size The size of the gcode text, which replaces the size given to open.  They differ for compressed
+	 * files, where the record file positions are offsets into the decoded text.
+	 */
+	bool close(comment_process_type final_comment_process_type, long file_size);
+	/**
+	 * \brief Deletes the incomplete trace.
+	 */
+	void discard();
+	bool is_open() const;
+private:
+	position_trace_writer(const position_trace_writer &source); // don't copy me!
+	/**
+	 * \brief Writes the blocks of the position state that changed since the last position.
+	 */
+	void write_state(const position& pos);
+	FILE* p_file_;
+	std::string file_path_;
+	std::string temp_file_path_;
+	binary_writer writer_;
+	std::string state_;
+	long long record_count_;
+	long long trace_size_;
+	long file_size_offset_;
+	bool has_error_;
+};
+
+/**
+ * \brief Reads a trace created by a position_trace_writer.
+ */
+class position_trace_reader
+{
+public:
+	position_trace_reader();
+	~position_trace_reader();
+	/**
+	 * \brief Opens the trace, failing if it doesn't exist, is incomplete or was created with a different key.
+	 */
+	bool open(const std::string& file_path, const std::string& key);
+	/**
+	 * \brief Reads the next record.  If the record has a position it is read into pos.
+	 * \return false at the end of the trace or if it could not be read.
+	 */
+	bool read_next(position_trace_record& record, position& pos);
+	/**
+	 * \brief True once every record has been read.
+	 */
+	bool is_complete() const;
+	comment_process_type get_final_comment_process_type() const;
+	long get_file_size() const;
+	void close();
+private:
+	position_trace_reader(const position_trace_reader &source); // don't copy me!
+	/**
+	 * \brief Applies the changed blocks to the previous position state and copies it to the position.
+	 */
+	bool read_state(binary_reader& reader, position& pos);
+	/**
+	 * \brief Gets the next length prefixed block.  It points into the buffer and is valid until the next read.
+	 */
+	bool read_block(const char*& p_block, size_t& block_length);
+	/**
+	 * \brief Makes sure that at least length unread bytes are in the buffer.
+	 */
+	bool fill_buffer(size_t length);
+	FILE* p_file_;
+	std::vector<char> buffer_;
+	size_t buffer_position_;
+	size_t buffer_length_;
+	std::string state_;
+	long long records_remaining_;
+	comment_process_type final_comment_process_type_;
+	long file_size_;
+};
+#endif
@@ -0,0 +1,340 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "position_view.h"
+#include "logging.h"
+#include "python_helpers.h"
+#include <new>
+
+struct position_view_field
+{
+	const char * name;
+	// The index of the value within the position tuple
+	int index;
+	// The index of the null flag within the position tuple, or -1 if the value cannot be null
+	int null_index;
+	// 'd' for float, 'l' for integer, 'b' for bool and 'o' for an object
+	char type;
+};
+
+static const position_view_field position_view_fields[] = {
+	{ "x", 0, 43, 'd' },
+	{ "y", 1, 44, 'd' },
+	{ "z", 2, 45, 'd' },
+	{ "f", 3, 46, 'd' },
+	{ "x_offset", 4, -1, 'd' },
+	{ "y_offset", 5, -1, 'd' },
+	{ "z_offset", 6, -1, 'd' },
+	{ "x_firmware_offset", 7, -1, 'd' },
+	{ "y_firmware_offset", 8, -1, 'd' },
+	{ "z_firmware_offset", 9, -1, 'd' },
+	{ "z_relative", 10, -1, 'd' },
+	{ "last_extrusion_height", 11, 49, 'd' },
+	{ "height", 12, -1, 'd' },
+	{ "firmware_retraction_length", 13, 51, 'd' },
+	{ "firmware_unretraction_additional_length", 14, 52, 'd' },
+	{ "firmware_retraction_feedrate", 15, 53, 'd' },
+	{ "firmware_unretraction_feedrate", 16, 54, 'd' },
+	{ "firmware_z_lift", 17, 55, 'd' },
+	{ "layer", 18, -1, 'l' },
+	{ "height_increment", 19, -1, 'l' },
+	{ "height_increment_change_count", 20, -1, 'l' },
+	{ "current_tool", 21, -1, 'l' },
+	{ "num_extruders", 22, -1, 'l' },
+	{ "x_homed", 23, -1, 'b' },
+	{ "y_homed", 24, -1, 'b' },
+	{ "z_homed", 25, -1, 'b' },
+	{ "is_relative", 26, 47, 'b' },
+	{ "is_extruder_relative", 27, 48, 'b' },
+	{ "is_metric", 28, 50, 'b' },
+	{ "is_printer_primed", 29, -1, 'b' },
+	{ "has_definite_position", 30, -1, 'b' },
+	{ "is_layer_change", 31, -1, 'b' },
+	{ "is_height_change", 32, -1, 'b' },
+	// The python Pos object keeps this one as an integer
+	{ "is_height_increment_change", 33, -1, 'l' },
+	{ "is_xy_travel", 34, -1, 'b' },
+	{ "is_xyz_travel", 35, -1, 'b' },
+	{ "is_zhop", 36, -1, 'b' },
+	{ "has_xy_position_changed", 37, -1, 'b' },
+	{ "has_position_changed", 38, -1, 'b' },
+	{ "has_received_home_command", 39, -1, 'b' },
+	{ "is_in_position", 40, -1, 'b' },
+	{ "in_path_position", 41, -1, 'b' },
+	{ "is_in_bounds", 42, -1, 'b' },
+	{ "file_line_number", 56, -1, 'l' },
+	{ "gcode_number", 57, -1, 'l' },
+	{ "file_position", 58, -1, 'l' },
+	{ "parsed_command", 59, -1, 'o' },
+	{ "extruders", 60, -1, 'o' },
+	{ NULL, 0, 0, 0 }
+};
+
+static bool position_view_get_flag(const position& pos, int index)
+{
+	switch (index)
+	{
+	case 23: return pos.x_homed;
+	case 24: return pos.y_homed;
+	case 25: return pos.z_homed;
+	case 26: return pos.is_relative;
+	case 27: return pos.is_extruder_relative;
+	case 28: return pos.is_metric;
+	case 29: return pos.is_printer_primed;
+	case 30: return pos.has_definite_position;
+	case 31: return pos.is_layer_change;
+	case 32: return pos.is_height_change;
+	case 33: return pos.is_height_increment_change;
+	case 34: return pos.is_xy_travel;
+	case 35: return pos.is_xyz_travel;
+	case 36: return pos.is_zhop;
+	case 37: return pos.has_xy_position_changed;
+	case 38: return pos.has_position_changed;
+	case 39: return pos.has_received_home_command;
+	case 40: return pos.is_in_position;
+	case 41: return pos.in_path_position;
+	case 42: return pos.is_in_bounds;
+	case 43: return pos.x_null;
+	case 44: return pos.y_null;
+	case 45: return pos.z_null;
+	case 46: return pos.f_null;
+	case 47: return pos.is_relative_null;
+	case 48: return pos.is_extruder_relative_null;
+	case 49: return pos.last_extrusion_height_null;
+	case 50: return pos.is_metric_null;
+	// Firmware retraction values are not tracked, so they are always null
+	default: return true;
+	}
+}
+
+static double position_view_get_double(const position& pos, int index)
+{
+	switch (index)
+	{
+	case 0: return pos.x;
+	case 1: return pos.y;
+	case 2: return pos.z;
+	case 3: return pos.f;
+	case 4: return pos.x_offset;
+	case 5: return pos.y_offset;
+	case 6: return pos.z_offset;
+	case 7: return pos.x_firmware_offset;
+	case 8: return pos.y_firmware_offset;
+	case 9: return pos.z_firmware_offset;
+	case 10: return pos.z_relative;
+	case 11: return pos.last_extrusion_height;
+	case 12: return pos.height;
+	// Firmware retraction values are not tracked
+	default: return 0.0;
+	}
+}
+
+static long position_view_get_long(const position& pos, int index)
+{
+	switch (index)
+	{
+	case 18: return pos.layer;
+	case 19: return pos.height_increment;
+	case 20: return pos.height_increment_change_count;
+	case 21: return pos.current_tool;
+	case 22: return pos.num_extruders;
+	case 56: return pos.file_line_number;
+	case 57: return pos.gcode_number;
+	case 58: return pos.file_position;
+	default: return position_view_get_flag(pos, index) ? 1 : 0;
+	}
+}
+
+static PyObject * position_view_get_object(position_view * self, int index)
+{
+	if (index == 59)
+	{
+		if (self->py_command == NULL)
+		{
+			if (self->pos.command.is_empty)
+			{
+				Py_INCREF(Py_None);
+				self->py_command = Py_None;
+			}
+			else
+			{
+				self->py_command = self->pos.command.to_py_object();
+				if (self->py_command == NULL)
+					return NULL;
+			}
+		}
+		Py_INCREF(self->py_command);
+		return self->py_command;
+	}
+	if (self->py_extruders == NULL)
+	{
+		self->py_extruders = extruder::build_py_object(self->pos.extruders, self->pos.num_extruders);
+		if (self->py_extruders == NULL)
+			return NULL;
+	}
+	Py_INCREF(self->py_extruders);
+	return self->py_extruders;
+}
+
+static PyObject * position_view_get_item(position_view * self, int index)
+{
+	if (index <= 17)
+		return PyFloat_FromDouble(position_view_get_double(self->pos, index));
+	if (index <= 58)
+		return PyIntOrLong_FromLong(position_view_get_long(self->pos, index));
+	return position_view_get_object(self, index);
+}
+
+static PyObject * position_view_get_field(PyObject * self, void * closure)
+{
+	const position_view_field * p_field = static_cast<const position_view_field*>(closure);
+	position_view * p_view = reinterpret_cast<position_view*>(self);
+	if (p_field->null_index > -1 && position_view_get_flag(p_view->pos, p_field->null_index))
+	{
+		Py_RETURN_NONE;
+	}
+	switch (p_field->type)
+	{
+	case 'd':
+		return PyFloat_FromDouble(position_view_get_double(p_view->pos, p_field->index));
+	case 'l':
+		return PyIntOrLong_FromLong(position_view_get_long(p_view->pos, p_field->index));
+	case 'b':
+		return PyBool_FromLong(position_view_get_flag(p_view->pos, p_field->index) ? 1 : 0);
+	default:
+		return position_view_get_object(p_view, p_field->index);
+	}
+}
+
+static Py_ssize_t position_view_length(PyObject * self)
+{
+	return POSITION_VIEW_TUPLE_SIZE;
+}
+
+static PyObject * position_view_item(PyObject * self, Py_ssize_t index)
+{
+	if (index < 0 || index >= POSITION_VIEW_TUPLE_SIZE)
+	{
+		PyErr_SetString(PyExc_IndexError, "PositionView index out of range");
+		return NULL;
+	}
+	return position_view_get_item(reinterpret_cast<position_view*>(self), static_cast<int>(index));
+}
+
+static PyObject * position_view_to_tuple(PyObject * self, PyObject * args)
+{
+	return reinterpret_cast<position_view*>(self)->pos.to_py_tuple();
+}
+
+static PyObject * position_view_to_dict(PyObject * self, PyObject * args)
+{
+	return reinterpret_cast<position_view*>(self)->pos.to_py_dict();
+}
+
+static void position_view_dealloc(PyObject * self)
+{
+	position_view * p_view = reinterpret_cast<position_view*>(self);
+	Py_XDECREF(p_view->py_command);
+	Py_XDECREF(p_view->py_extruders);
+	p_view->pos.~position();
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyObject * position_view_new(PyTypeObject * type, PyObject * args, PyObject * kwds)
+{
+	PyObject * self = type->tp_alloc(type, 0);
+	if (self == NULL)
+		return NULL;
+	position_view * p_view = reinterpret_cast<position_view*>(self);
+	new (&p_view->pos) position();
+	p_view->py_command = NULL;
+	p_view->py_extruders = NULL;
+	return self;
+}
+
+static PyMethodDef position_view_methods[] = {
+	{ "to_tuple", (PyCFunction)position_view_to_tuple, METH_NOARGS, "Returns the position as a tuple, in the same form as GetCurrentPositionTuple." },
+	{ "to_dict", (PyCFunction)position_view_to_dict, METH_NOARGS, "Returns the position as a dict, in the same form as GetCurrentPositionDict." },
+	{ NULL, NULL, 0, NULL }
+};
+
+static PySequenceMethods position_view_sequence_methods;
+static PyGetSetDef position_view_getset[sizeof(position_view_fields) / sizeof(position_view_field)];
+
+PyTypeObject position_view_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.PositionView"
+};
+
+bool position_view_add_type(PyObject * module)
+{
+	for (unsigned int index = 0; position_view_fields[index].name != NULL; index++)
+	{
+		position_view_getset[index].name = const_cast<char*>(position_view_fields[index].name);
+		position_view_getset[index].get = position_view_get_field;
+		position_view_getset[index].set = NULL;
+		position_view_getset[index].doc = NULL;
+		position_view_getset[index].closure = const_cast<position_view_field*>(&position_view_fields[index]);
+	}
+	position_view_sequence_methods.sq_length = position_view_length;
+	position_view_sequence_methods.sq_item = position_view_item;
+
+	position_view_type.tp_basicsize = sizeof(position_view);
+	position_view_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	position_view_type.tp_doc = "A read only snapshot of a gcode position.";
+	position_view_type.tp_new = position_view_new;
+	position_view_type.tp_dealloc = position_view_dealloc;
+	position_view_type.tp_methods = position_view_methods;
+	position_view_type.tp_getset = position_view_getset;
+	position_view_type.tp_as_sequence = &position_view_sequence_methods;
+	if (PyType_Ready(&position_view_type) < 0)
+	{
+		std::string message = "position_view_add_type - Unable to ready the PositionView type.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	Py_INCREF(&position_view_type);
+	if (PyModule_AddObject(module, "PositionView", reinterpret_cast<PyObject*>(&position_view_type)) < 0)
+	{
+		Py_DECREF(&position_view_type);
+		std::string message = "position_view_add_type - Unable to add the PositionView type to the module.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	return true;
+}
+
+PyObject * position_view_create(const position& pos)
+{
+	PyObject * self = position_view_type.tp_alloc(&position_view_type, 0);
+	if (self == NULL)
+	{
+		std::string message = "position_view_create - Unable to allocate a PositionView.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return NULL;
+	}
+	position_view * p_view = reinterpret_cast<position_view*>(self);
+	new (&p_view->pos) position(pos);
+	p_view->py_command = NULL;
+	p_view->py_extruders = NULL;
+	return self;
+}
@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef POSITION_VIEW_H
+#define POSITION_VIEW_H
+#include "position.h"
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+
+// The number of items in the tuple returned by position::to_py_tuple
+#define POSITION_VIEW_TUPLE_SIZE 61
+
+/**
+ * \brief A python object that holds a snapshot of a position.  Values are only converted to PyObjects when
+ * they are read, either by attribute (x, y, is_layer_change, etc, with the same None handling as the python Pos
+ * object) or by index (using the same layout as position::to_py_tuple).
+ */
+typedef struct {
+	PyObject_HEAD
+	position pos;
+	// The parsed command and extruders are converted on first access and cached.
+	PyObject * py_command;
+	PyObject * py_extruders;
+} position_view;
+
+extern PyTypeObject position_view_type;
+
+/**
+ * \brief Readies the PositionView type and adds it to the module.  Returns false on failure.
+ */
+bool position_view_add_type(PyObject * module);
+/**
+ * \brief Creates a new PositionView that holds a copy of the supplied position.
+ */
+PyObject * position_view_create(const position& pos);
+#endif
@@ -0,0 +1,178 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "print_time_estimator.h"
+#include "gcode_arc.h"
+#include "utilities.h"
+#include <cmath>
+#include <algorithm>
+
+void print_time_estimator_args::serialize(binary_writer& writer) const
+{
+	writer.write_double(acceleration);
+	writer.write_double(jerk);
+}
+
+// Returns the seconds a move of the given length takes to go from the entry speed to the exit speed, cruising at the
+// cruise speed if there is room for it.
+static double get_move_seconds(const double distance, const double entry_speed, const double cruise_speed, const double exit_speed, const double acceleration)
+{
+	if (acceleration <= 0)
+		return distance / cruise_speed;
+	const double accelerate_distance = (cruise_speed * cruise_speed - entry_speed * entry_speed) / (2 * acceleration);
+	const double decelerate_distance = (cruise_speed * cruise_speed - exit_speed * exit_speed) / (2 * acceleration);
+	if (accelerate_distance + decelerate_distance <= distance)
+	{
+		return (cruise_speed - entry_speed) / acceleration
+			+ (cruise_speed - exit_speed) / acceleration
+			+ (distance - accelerate_distance - decelerate_distance) / cruise_speed;
+	}
+	// The move is too short to reach the cruise speed, so it peaks where acceleration meets deceleration.
+	const double peak_speed = sqrt(acceleration * distance + (entry_speed * entry_speed + exit_speed * exit_speed) / 2);
+	if (peak_speed < std::max(entry_speed, exit_speed))
+	{
+		// The move can not change speed that much, the junction speeds were limited by the previous move only.
+		return 2 * distance / (entry_speed + exit_speed);
+	}
+	return (peak_speed - entry_speed) / acceleration + (peak_speed - exit_speed) / acceleration;
+}
+
+print_time_estimator::print_time_estimator()
+{
+	clear();
+}
+
+print_time_estimator::print_time_estimator(print_time_estimator_args args)
+{
+	args_ = args;
+	clear();
+}
+
+void print_time_estimator::clear()
+{
+	seconds_ = 0;
+	has_pending_move_ = false;
+	pending_distance_ = 0;
+	pending_speed_ = 0;
+	pending_entry_speed_ = 0;
+	for (int index = 0; index < 4; index++)
+		pending_exit_unit_[index] = 0;
+}
+
+double print_time_estimator::get_seconds() const
+{
+	return seconds_;
+}
+
+void print_time_estimator::update(const position* p_current_pos, const position* p_previous_pos)
+{
+	const gcode_opcode opcode = p_current_pos->command.opcode;
+	if (opcode != gcode_opcode_g0 && opcode != gcode_opcode_g1 && opcode != gcode_opcode_g2 && opcode != gcode_opcode_g3)
+		return;
+	if (!p_current_pos->has_position_changed || p_current_pos->f_null || p_current_pos->x_null || p_current_pos->y_null || p_current_pos->z_null)
+		return;
+	const double speed = p_current_pos->f / 60.0;
+	if (!utilities::greater_than(speed, 0))
+		return;
+
+	const double x_relative = p_current_pos->x - p_previous_pos->x;
+	const double y_relative = p_current_pos->y - p_previous_pos->y;
+	const double z_relative = p_current_pos->z - p_previous_pos->z;
+	const double e_relative = p_current_pos->get_current_extruder().e_relative;
+	double xy_length = sqrt(x_relative * x_relative + y_relative * y_relative);
+	// The xy direction the move enters and leaves in
+	double entry_x = x_relative, entry_y = y_relative, exit_x = x_relative, exit_y = y_relative;
+	if (opcode == gcode_opcode_g2 || opcode == gcode_opcode_g3)
+	{
+		gcode_arc arc;
+		// Helical arcs are not split, so they are estimated as straight moves.
+		if (arc.try_set_circle(p_current_pos->command, p_previous_pos->x, p_previous_pos->y, p_current_pos->x, p_current_pos->y))
+		{
+			arc.set_sweep();
+			xy_length = arc.length;
+			// The arc leaves its start and end points along the tangent
+			const double direction = arc.sweep_angle < 0 ? -xy_length : xy_length;
+			const double end_angle = arc.start_angle + arc.sweep_angle;
+			entry_x = -sin(arc.start_angle) * direction;
+			entry_y = cos(arc.start_angle) * direction;
+			exit_x = -sin(end_angle) * direction;
+			exit_y = cos(end_angle) * direction;
+		}
+	}
+
+	double distance = sqrt(xy_length * xy_length + z_relative * z_relative);
+	// Retractions and deretractions only move the extruder
+	if (utilities::is_zero(distance))
+		distance = fabs(e_relative);
+	if (utilities::is_zero(distance))
+		return;
+
+	const double entry_unit[4] = { entry_x / distance, entry_y / distance, z_relative / distance, e_relative / distance };
+	double entry_speed;
+	if (has_pending_move_)
+	{
+		entry_speed = get_junction_speed(entry_unit, speed);
+		add_pending_move(entry_speed);
+	}
+	else
+		entry_speed = std::min(speed, args_.jerk);
+
+	has_pending_move_ = true;
+	pending_distance_ = distance;
+	pending_speed_ = speed;
+	pending_entry_speed_ = entry_speed;
+	pending_exit_unit_[0] = exit_x / distance;
+	pending_exit_unit_[1] = exit_y / distance;
+	pending_exit_unit_[2] = entry_unit[2];
+	pending_exit_unit_[3] = entry_unit[3];
+}
+
+double print_time_estimator::get_junction_speed(const double* unit, const double speed) const
+{
+	double junction_speed = std::min(pending_speed_, speed);
+	// Slow down until no axis changes speed by more than the jerk
+	double largest_jump = 0;
+	for (int index = 0; index < 4; index++)
+		largest_jump = std::max(largest_jump, fabs(unit[index] - pending_exit_unit_[index]) * junction_speed);
+	if (largest_jump > args_.jerk)
+		junction_speed *= args_.jerk / largest_jump;
+	// The pending move can only accelerate so much before the junction
+	if (args_.acceleration > 0)
+	{
+		junction_speed = std::min(
+			junction_speed,
+			sqrt(pending_entry_speed_ * pending_entry_speed_ + 2 * args_.acceleration * pending_distance_)
+		);
+	}
+	return junction_speed;
+}
+
+void print_time_estimator::add_pending_move(const double exit_speed)
+{
+	seconds_ += get_move_seconds(pending_distance_, pending_entry_speed_, pending_speed_, exit_speed, args_.acceleration);
+	has_pending_move_ = false;
+}
+
+void print_time_estimator::finish()
+{
+	if (has_pending_move_)
+		add_pending_move(std::min(pending_speed_, args_.jerk));
+}
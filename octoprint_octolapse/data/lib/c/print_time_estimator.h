@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef PRINT_TIME_ESTIMATOR_H
+#define PRINT_TIME_ESTIMATOR_H
+#include "position.h"
+#include "binary_stream.h"
+
+struct print_time_estimator_args
+{
+	print_time_estimator_args()
+	{
+		acceleration = 1000;
+		jerk = 10;
+	}
+	// The acceleration of every move in mm/s^2.  Moves run at their feedrate if this is 0.
+	double acceleration;
+	// The largest instant change in the speed of any axis at the junction of two moves, in mm/s.
+	double jerk;
+	void serialize(binary_writer& writer) const;
+};
+
+/**
+ * \brief Estimates the time it takes to print the G0-G3 moves tracked by a gcode_position.  Each move accelerates from
+ * the speed it is able to enter with, cruises at its feedrate and decelerates to the speed it can leave with, where the
+ * junction speeds are limited by the jerk as in the classic firmware planners.  A move's exit speed depends on the next
+ * move, so there is always one move that has not been estimated yet.  Dwells and heating waits are not included.
+ */
+class print_time_estimator
+{
+public:
+	print_time_estimator();
+	print_time_estimator(print_time_estimator_args args);
+	/**
+	 * \brief Adds the move from the previous position to the current position, if the current command is a move.
+	 */
+	void update(const position* p_current_pos, const position* p_previous_pos);
+	/**
+	 * \brief Adds the move that has not been estimated yet, ending it with a stop.
+	 */
+	void finish();
+	/**
+	 * \brief Gets the estimated seconds until the start of the last move that was added.
+	 */
+	double get_seconds() const;
+	void clear();
+private:
+	void add_pending_move(double exit_speed);
+	double get_junction_speed(const double* unit, double speed) const;
+	print_time_estimator_args args_;
+	double seconds_;
+	bool has_pending_move_;
+	double pending_distance_;
+	double pending_speed_;
+	double pending_entry_speed_;
+	// The direction the pending move leaves in, as the change of x, y, z and e per mm
+	double pending_exit_unit_[4];
+};
+#endif
@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "processing_progress.h"
+#include "logging.h"
+
+processing_progress::processing_progress()
+{
+	state_.store(processing_progress_state_waiting);
+	is_cancel_requested_.store(false);
+	bytes_processed_.store(0);
+	total_bytes_.store(0);
+	lines_processed_.store(0);
+	gcodes_processed_.store(0);
+	snapshot_plans_.store(0);
+	elapsed_ms_.store(0);
+	for (int index = 0; index < NUM_PROCESSING_STAGES; index++)
+		stage_ms_[index].store(0);
+}
+
+processing_progress::processing_progress(const processing_progress& source)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+void processing_progress::start()
+{
+	bytes_processed_.store(0, octolapse_sync::memory_order_relaxed);
+	total_bytes_.store(0, octolapse_sync::memory_order_relaxed);
+	lines_processed_.store(0, octolapse_sync::memory_order_relaxed);
+	gcodes_processed_.store(0, octolapse_sync::memory_order_relaxed);
+	snapshot_plans_.store(0, octolapse_sync::memory_order_relaxed);
+	elapsed_ms_.store(0, octolapse_sync::memory_order_relaxed);
+	for (int index = 0; index < NUM_PROCESSING_STAGES; index++)
+		stage_ms_[index].store(0, octolapse_sync::memory_order_relaxed);
+	state_.store(processing_progress_state_running, octolapse_sync::memory_order_release);
+}
+
+void processing_progress::update(const long bytes_processed, const long total_bytes, const long lines_processed,
+	const long gcodes_processed, const long snapshot_plans, const double seconds_elapsed, const processing_stats& stats)
+{
+	bytes_processed_.store(bytes_processed, octolapse_sync::memory_order_relaxed);
+	total_bytes_.store(total_bytes, octolapse_sync::memory_order_relaxed);
+	lines_processed_.store(lines_processed, octolapse_sync::memory_order_relaxed);
+	gcodes_processed_.store(gcodes_processed, octolapse_sync::memory_order_relaxed);
+	snapshot_plans_.store(snapshot_plans, octolapse_sync::memory_order_relaxed);
+	elapsed_ms_.store(static_cast<long>(seconds_elapsed * 1000.0), octolapse_sync::memory_order_relaxed);
+	for (int index = 0; index < NUM_PROCESSING_STAGES; index++)
+	{
+		const double stage_seconds = stats.get_stage(static_cast<processing_stage>(index)).get_estimated_seconds();
+		stage_ms_[index].store(static_cast<long>(stage_seconds * 1000.0), octolapse_sync::memory_order_relaxed);
+	}
+}
+
+void processing_progress::finish(const bool is_cancelled)
+{
+	state_.store(is_cancelled ? processing_progress_state_cancelled : processing_progress_state_complete, octolapse_sync::memory_order_release);
+}
+
+processing_progress_state processing_progress::get_state() const
+{
+	return static_cast<processing_progress_state>(state_.load(octolapse_sync::memory_order_acquire));
+}
+
+PyObject* processing_progress::to_py_object() const
+{
+	const processing_progress_state state = get_state();
+	const long bytes_processed = bytes_processed_.load(octolapse_sync::memory_order_relaxed);
+	const long total_bytes = total_bytes_.load(octolapse_sync::memory_order_relaxed);
+	const double seconds_elapsed = static_cast<double>(elapsed_ms_.load(octolapse_sync::memory_order_relaxed)) / 1000.0;
+	double percent_complete = 0;
+	double seconds_to_complete = 0;
+	if (state == processing_progress_state_complete)
+		percent_complete = 100.0;
+	else if (total_bytes > 0 && bytes_processed > 0)
+	{
+		percent_complete = static_cast<double>(bytes_processed) / static_cast<double>(total_bytes) * 100.0;
+		seconds_to_complete = seconds_elapsed * static_cast<double>(total_bytes - bytes_processed) / static_cast<double>(bytes_processed);
+	}
+
+	PyObject* py_stage_seconds = PyDict_New();
+	if (py_stage_seconds == NULL)
+	{
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, "processing_progress.to_py_object: Unable to create the stage seconds dict.");
+		return NULL;
+	}
+	for (int index = 0; index < NUM_PROCESSING_STAGES; index++)
+	{
+		PyObject* py_seconds = PyFloat_FromDouble(static_cast<double>(stage_ms_[index].load(octolapse_sync::memory_order_relaxed)) / 1000.0);
+		if (py_seconds == NULL || PyDict_SetItemString(py_stage_seconds, processing_stage_name[index].c_str(), py_seconds) < 0)
+		{
+			Py_XDECREF(py_seconds);
+			Py_DECREF(py_stage_seconds);
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, "processing_progress.to_py_object: Unable to add a stage to the stage seconds dict.");
+			return NULL;
+		}
+		// PyDict_SetItemString does not steal the reference
+		Py_DECREF(py_seconds);
+	}
+	// N steals the stage seconds reference
+	PyObject* py_progress = Py_BuildValue(
+		"{s:s,s:O,s:l,s:l,s:l,s:l,s:l,s:d,s:d,s:d,s:N}",
+		"state", processing_progress_state_name[state].c_str(),
+		"is_cancel_requested", is_cancel_requested() ? Py_True : Py_False,
+		"bytes_processed", bytes_processed,
+		"total_bytes", total_bytes,
+		"lines_processed", lines_processed_.load(octolapse_sync::memory_order_relaxed),
+		"gcodes_processed", gcodes_processed_.load(octolapse_sync::memory_order_relaxed),
+		"snapshot_plans", snapshot_plans_.load(octolapse_sync::memory_order_relaxed),
+		"percent_complete", percent_complete,
+		"seconds_elapsed", seconds_elapsed,
+		"seconds_to_complete", seconds_to_complete,
+		"stage_seconds", py_stage_seconds
+	);
+	if (py_progress == NULL)
+	{
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, "processing_progress.to_py_object: Unable to build the progress dict via Py_BuildValue.");
+		return NULL;
+	}
+	return py_progress;
+}
+
+static processing_progress * processing_progress_from_self(PyObject * self)
+{
+	return reinterpret_cast<processing_progress_object*>(self)->p_progress;
+}
+
+static PyObject * processing_progress_GetProgress(PyObject * self, PyObject * args)
+{
+	return processing_progress_from_self(self)->to_py_object();
+}
+
+static PyObject * processing_progress_Cancel(PyObject * self, PyObject * args)
+{
+	processing_progress_from_self(self)->request_cancel();
+	return Py_BuildValue("O", Py_True);
+}
+
+static PyObject * processing_progress_IsCancelRequested(PyObject * self, PyObject * args)
+{
+	return Py_BuildValue("O", processing_progress_from_self(self)->is_cancel_requested() ? Py_True : Py_False);
+}
+
+static void processing_progress_dealloc(PyObject * self)
+{
+	delete processing_progress_from_self(self);
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyMethodDef processing_progress_methods[] = {
+	{ "GetProgress", (PyCFunction)processing_progress_GetProgress, METH_NOARGS, "Returns the latest progress as a dict without waiting on the processing thread." },
+	{ "Cancel", (PyCFunction)processing_progress_Cancel, METH_NOARGS, "Cancel the run.  The processing loop stops the next time it checks, without calling python." },
+	{ "IsCancelRequested", (PyCFunction)processing_progress_IsCancelRequested, METH_NOARGS, "Returns True if Cancel has been called." },
+	{ NULL, NULL, 0, NULL }
+};
+
+PyTypeObject processing_progress_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.ProcessingProgress"
+};
+
+bool processing_progress_add_type(PyObject * module)
+{
+	processing_progress_type.tp_basicsize = sizeof(processing_progress_object);
+	processing_progress_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	processing_progress_type.tp_doc = "The progress and the cancel flag of a preprocessing run.  Returned by CreateProcessingProgress.";
+	processing_progress_type.tp_dealloc = processing_progress_dealloc;
+	processing_progress_type.tp_methods = processing_progress_methods;
+	if (PyType_Ready(&processing_progress_type) < 0)
+	{
+		std::string message = "processing_progress_add_type - Unable to ready the ProcessingProgress type.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	Py_INCREF(&processing_progress_type);
+	if (PyModule_AddObject(module, "ProcessingProgress", reinterpret_cast<PyObject*>(&processing_progress_type)) < 0)
+	{
+		Py_DECREF(&processing_progress_type);
+		std::string message = "processing_progress_add_type - Unable to add the ProcessingProgress type to the module.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	return true;
+}
+
+PyObject * processing_progress_create()
+{
+	PyObject * py_progress = processing_progress_type.tp_alloc(&processing_progress_type, 0);
+	if (py_progress == NULL)
+	{
+		std::string message = "processing_progress_create - Unable to allocate a ProcessingProgress.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return NULL;
+	}
+	reinterpret_cast<processing_progress_object*>(py_progress)->p_progress = new processing_progress();
+	return py_progress;
+}
+
+processing_progress * processing_progress_get(PyObject * py_progress)
+{
+	if (!PyObject_TypeCheck(py_progress, &processing_progress_type))
+		return NULL;
+	return processing_progress_from_self(py_progress);
+}
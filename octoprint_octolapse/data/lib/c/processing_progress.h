@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PROCESSING_PROGRESS_H
+#define PROCESSING_PROGRESS_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include "threads.h"
+#include "processing_stats.h"
+
+enum processing_progress_state
+{
+	processing_progress_state_waiting = 0,
+	processing_progress_state_running = 1,
+	processing_progress_state_complete = 2,
+	processing_progress_state_cancelled = 3
+};
+#define NUM_PROCESSING_PROGRESS_STATES 4
+static const std::string processing_progress_state_name[NUM_PROCESSING_PROGRESS_STATES] = {
+	"waiting", "running", "complete", "cancelled"
+};
+
+/**
+ * \brief The progress of a preprocessing run, which any thread can read while the file is processed, and a flag
+ * that cancels the run.  Every value is its own atomic, so a reader never waits on the processing thread and never
+ * needs the GIL, but the values it sees may be from slightly different moments.  The counters are longs and the times
+ * are in milliseconds so that they stay lock free on 32 bit platforms.
+ * Only one run at a time may publish to a progress object.
+ */
+class processing_progress
+{
+public:
+	processing_progress();
+	/**
+	 * \brief Clears the counters and marks the run as running.  A cancel that was requested beforehand is kept.
+	 */
+	void start();
+	void update(long bytes_processed, long total_bytes, long lines_processed, long gcodes_processed,
+		long snapshot_plans, double seconds_elapsed, const processing_stats& stats);
+	void finish(bool is_cancelled);
+	inline void request_cancel()
+	{
+		is_cancel_requested_.store(true, octolapse_sync::memory_order_relaxed);
+	}
+	inline bool is_cancel_requested() const
+	{
+		return is_cancel_requested_.load(octolapse_sync::memory_order_relaxed);
+	}
+	processing_progress_state get_state() const;
+	/**
+	 * \brief Returns {'state', 'is_cancel_requested', 'bytes_processed', 'total_bytes', 'lines_processed',
+	 * 'gcodes_processed', 'snapshot_plans', 'percent_complete', 'seconds_elapsed', 'seconds_to_complete',
+	 * 'stage_seconds'}.  stage_seconds holds the estimated seconds spent in each processing stage so far.
+	 */
+	PyObject* to_py_object() const;
+private:
+	processing_progress(const processing_progress& source);
+	octolapse_sync::atomic<int> state_;
+	octolapse_sync::atomic<bool> is_cancel_requested_;
+	octolapse_sync::atomic<long> bytes_processed_;
+	octolapse_sync::atomic<long> total_bytes_;
+	octolapse_sync::atomic<long> lines_processed_;
+	octolapse_sync::atomic<long> gcodes_processed_;
+	octolapse_sync::atomic<long> snapshot_plans_;
+	octolapse_sync::atomic<long> elapsed_ms_;
+	octolapse_sync::atomic<long> stage_ms_[NUM_PROCESSING_STAGES];
+};
+
+/**
+ * \brief A python object that owns a processing_progress.  Returned by CreateProcessingProgress.
+ */
+typedef struct {
+	PyObject_HEAD
+	processing_progress * p_progress;
+} processing_progress_object;
+
+extern PyTypeObject processing_progress_type;
+
+/**
+ * \brief Readies the ProcessingProgress type and adds it to the module.  Returns false on failure.
+ */
+bool processing_progress_add_type(PyObject * module);
+PyObject * processing_progress_create();
+/**
+ * \brief Returns the processing_progress of a ProcessingProgress, or NULL if py_progress is some other object.
+ */
+processing_progress * processing_progress_get(PyObject * py_progress);
+#endif
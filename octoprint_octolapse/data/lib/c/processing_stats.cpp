@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "processing_stats.h"
+#include "logging.h"
+
+processing_stage_stats::processing_stage_stats()
+{
+	calls = 0;
+	timed_calls = 0;
+	timed_ns = 0;
+}
+
+double processing_stage_stats::get_estimated_seconds() const
+{
+	if (timed_calls == 0)
+		return 0;
+	return static_cast<double>(timed_ns) / 1000000000.0 * (static_cast<double>(calls) / static_cast<double>(timed_calls));
+}
+
+processing_stats::processing_stats()
+{
+	peak_buffered_snapshot_plans_ = 0;
+	lines_ = 0;
+	is_timing_ = false;
+}
+
+void processing_stats::clear()
+{
+	for (int index = 0; index < NUM_PROCESSING_STAGES; index++)
+		stages_[index] = processing_stage_stats();
+	peak_buffered_snapshot_plans_ = 0;
+	lines_ = 0;
+	is_timing_ = false;
+}
+
+long long processing_stats::get_peak_buffered_snapshot_plans() const
+{
+	return peak_buffered_snapshot_plans_;
+}
+
+const processing_stage_stats& processing_stats::get_stage(processing_stage stage) const
+{
+	return stages_[stage];
+}
+
+PyObject* processing_stats::to_py_object() const
+{
+	PyObject* py_stats = PyDict_New();
+	if (py_stats == NULL)
+	{
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, "processing_stats.to_py_object: Unable to create the stats dict.");
+		return NULL;
+	}
+	for (int index = 0; index < NUM_PROCESSING_STAGES; index++)
+	{
+		const processing_stage_stats& stage = stages_[index];
+		PyObject* py_stage = Py_BuildValue(
+			"{s:L,s:L,s:L,s:d}",
+			"calls", stage.calls,
+			"timed_calls", stage.timed_calls,
+			"timed_ns", stage.timed_ns,
+			"estimated_seconds", stage.get_estimated_seconds()
+		);
+		if (py_stage == NULL || PyDict_SetItemString(py_stats, processing_stage_name[index].c_str(), py_stage) < 0)
+		{
+			Py_XDECREF(py_stage);
+			Py_DECREF(py_stats);
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, "processing_stats.to_py_object: Unable to add the stage stats to the stats dict.");
+			return NULL;
+		}
+		// PyDict_SetItemString does not steal the reference
+		Py_DECREF(py_stage);
+	}
+	PyObject* py_peak = PyLong_FromLongLong(peak_buffered_snapshot_plans_);
+	if (py_peak == NULL || PyDict_SetItemString(py_stats, "peak_buffered_snapshot_plans", py_peak) < 0)
+	{
+		Py_XDECREF(py_peak);
+		Py_DECREF(py_stats);
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, "processing_stats.to_py_object: Unable to add the peak buffered snapshot plans to the stats dict.");
+		return NULL;
+	}
+	Py_DECREF(py_peak);
+	return py_stats;
+}
+
+processing_call_stats::processing_call_stats()
+{
+	clear();
+}
+
+void processing_call_stats::clear()
+{
+	calls_ = 0;
+	total_ns_ = 0;
+	min_ns_ = 0;
+	max_ns_ = 0;
+	for (int index = 0; index < NUM_CALL_STATS_BUCKETS; index++)
+		buckets_[index] = 0;
+}
+
+void processing_call_stats::add_call(long long ns)
+{
+	if (ns < 0)
+		ns = 0;
+	if (calls_ == 0 || ns < min_ns_)
+		min_ns_ = ns;
+	if (ns > max_ns_)
+		max_ns_ = ns;
+	calls_++;
+	total_ns_ += ns;
+	int bucket = 0;
+	while (bucket < NUM_CALL_STATS_BUCKETS - 1 && (ns >> (bucket + 1)) != 0)
+		bucket++;
+	buckets_[bucket]++;
+}
+
+PyObject* processing_call_stats::to_py_object() const
+{
+	int num_buckets = NUM_CALL_STATS_BUCKETS;
+	while (num_buckets > 0 && buckets_[num_buckets - 1] == 0)
+		num_buckets--;
+	PyObject* py_histogram = PyList_New(num_buckets);
+	if (py_histogram == NULL)
+	{
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, "processing_call_stats.to_py_object: Unable to create the histogram list.");
+		return NULL;
+	}
+	for (int index = 0; index < num_buckets; index++)
+	{
+		// PyList_SET_ITEM steals the reference
+		PyList_SET_ITEM(py_histogram, index, PyLong_FromLongLong(buckets_[index]));
+	}
+	const double ns_per_call = calls_ == 0 ? 0 : static_cast<double>(total_ns_) / static_cast<double>(calls_);
+	// The N format steals the histogram reference
+	PyObject* py_stats = Py_BuildValue(
+		"{s:L,s:L,s:d,s:L,s:L,s:N}",
+		"calls", calls_,
+		"total_ns", total_ns_,
+		"ns_per_call", ns_per_call,
+		"min_ns", min_ns_,
+		"max_ns", max_ns_,
+		"histogram", py_histogram
+	);
+	if (py_stats == NULL)
+	{
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, "processing_call_stats.to_py_object: Unable to build the stats dict via Py_BuildValue.");
+		return NULL;
+	}
+	return py_stats;
+}
@@ -0,0 +1,189 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef PROCESSING_STATS_H
+#define PROCESSING_STATS_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <string>
+#include "threads.h"
+#if OCTOLAPSE_HAS_THREADS
+#include <chrono>
+#endif
+
+// The stages of stabilization preprocessing that are counted and timed.  Some stages run inside others:  comment
+// processing is part of the position update, and adding trigger positions and estimating the print time are part of
+// the snapshot plan stage.
+enum processing_stage
+{
+	processing_stage_read,
+	processing_stage_parse,
+	processing_stage_position_update,
+	processing_stage_comment_processing,
+	processing_stage_snapshot_plan,
+	processing_stage_trigger_positions,
+	processing_stage_time_estimation,
+	processing_stage_python_callbacks,
+	processing_stage_result_conversion
+};
+#define NUM_PROCESSING_STAGES 9
+static const std::string processing_stage_name[NUM_PROCESSING_STAGES] = {
+	"read", "parse", "position_update", "comment_processing", "snapshot_plan", "trigger_positions", "time_estimation",
+	"python_callbacks", "result_conversion"
+};
+
+// Reading the clock for every line would cost about as much as some of the stages, so only one line in this many
+// is timed.  Every call is still counted.
+#define PROCESSING_STATS_SAMPLE_INTERVAL 64
+
+inline long long processing_stats_get_time_ns()
+{
+#if OCTOLAPSE_HAS_THREADS
+	return static_cast<long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#elif defined(_WIN32)
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return static_cast<long long>(
+		static_cast<double>(counter.QuadPart) * 1000000000.0 / static_cast<double>(frequency.QuadPart));
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<long long>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+#endif
+}
+
+struct processing_stage_stats
+{
+	processing_stage_stats();
+	long long calls;
+	long long timed_calls;
+	long long timed_ns;
+	/**
+	 * \brief Estimates the total time of every call from the timed calls.
+	 */
+	double get_estimated_seconds() const;
+};
+
+class processing_stats
+{
+public:
+	processing_stats();
+	void clear();
+	/**
+	 * \brief Starts the next line, which decides if its stages will be timed.
+	 */
+	inline void next_line()
+	{
+		is_timing_ = (++lines_ % PROCESSING_STATS_SAMPLE_INTERVAL) == 0;
+	}
+	inline bool is_timing() const
+	{
+		return is_timing_;
+	}
+	inline void add_call(processing_stage stage)
+	{
+		stages_[stage].calls++;
+	}
+	inline void add_time(processing_stage stage, long long ns)
+	{
+		stages_[stage].timed_calls++;
+		stages_[stage].timed_ns += ns;
+	}
+	/**
+	 * \brief Records how many snapshot plans are waiting to be streamed or returned, keeping the largest count.
+	 */
+	inline void track_buffered_snapshot_plans(long long count)
+	{
+		if (count > peak_buffered_snapshot_plans_)
+			peak_buffered_snapshot_plans_ = count;
+	}
+	long long get_peak_buffered_snapshot_plans() const;
+	const processing_stage_stats& get_stage(processing_stage stage) const;
+	/**
+	 * \brief Returns {stage name: {'calls', 'timed_calls', 'timed_ns', 'estimated_seconds'}}, plus
+	 * 'peak_buffered_snapshot_plans', the most snapshot plans that were held in memory at once.
+	 */
+	PyObject* to_py_object() const;
+private:
+	processing_stage_stats stages_[NUM_PROCESSING_STAGES];
+	long long peak_buffered_snapshot_plans_;
+	long long lines_;
+	bool is_timing_;
+};
+
+// Counts a call to a stage for as long as it is in scope, and times it if the current line is sampled or if
+// always_time is set, which is meant for stages that only run now and then.  The stats may be NULL.
+class processing_stage_timer
+{
+public:
+	inline processing_stage_timer(processing_stats* p_stats, processing_stage stage, bool always_time = false)
+	{
+		p_stats_ = p_stats;
+		stage_ = stage;
+		start_ns_ = -1;
+		if (p_stats_ == NULL)
+			return;
+		p_stats_->add_call(stage_);
+		if (always_time || p_stats_->is_timing())
+			start_ns_ = processing_stats_get_time_ns();
+	}
+	inline ~processing_stage_timer()
+	{
+		if (start_ns_ >= 0)
+			p_stats_->add_time(stage_, processing_stats_get_time_ns() - start_ns_);
+	}
+private:
+	processing_stage_timer(const processing_stage_timer &source);
+	processing_stats* p_stats_;
+	processing_stage stage_;
+	long long start_ns_;
+};
+
+// The number of power of two buckets in the call histogram.  The last bucket also holds every slower call.
+#define NUM_CALL_STATS_BUCKETS 32
+// Times every call of a function that is called from python, like GcodePositionProcessor.Update.
+class processing_call_stats
+{
+public:
+	processing_call_stats();
+	void clear();
+	void add_call(long long ns);
+	/**
+	 * \brief Returns {'calls', 'total_ns', 'ns_per_call', 'min_ns', 'max_ns', 'histogram'}.  histogram[i] is the
+	 * number of calls that took less than 2^(i+1) nanoseconds, but at least 2^i, and trailing empty buckets are
+	 * removed.
+	 */
+	PyObject* to_py_object() const;
+private:
+	long long calls_;
+	long long total_ns_;
+	long long min_ns_;
+	long long max_ns_;
+	long long buckets_[NUM_CALL_STATS_BUCKETS];
+};
+#endif
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "processor_state.h"
+#include "logging.h"
+
+// The state used by the module functions, which are called without a Processor.
+static processor_state * p_module_processor_state = NULL;
+
+processor_state::processor_state()
+{
+}
+
+processor_state::processor_state(const processor_state &source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+processor_state::~processor_state()
+{
+	gcode_positions.clear();
+	for (std::map<std::string, snapshot_trigger*>::iterator it = snapshot_triggers.begin(); it != snapshot_triggers.end(); ++it)
+		delete it->second;
+	snapshot_triggers.clear();
+	for (std::map<std::string, snapshot_gcode_generator*>::iterator it = snapshot_gcode_generators.begin(); it != snapshot_gcode_generators.end(); ++it)
+		delete it->second;
+	snapshot_gcode_generators.clear();
+}
+
+static void processor_dealloc(PyObject * self)
+{
+	processor * p_processor = reinterpret_cast<processor*>(self);
+	delete p_processor->p_state;
+	p_processor->p_state = NULL;
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyObject * processor_new(PyTypeObject * type, PyObject * args, PyObject * kwds)
+{
+	PyObject * self = type->tp_alloc(type, 0);
+	if (self == NULL)
+		return NULL;
+	reinterpret_cast<processor*>(self)->p_state = new processor_state();
+	return self;
+}
+
+PyTypeObject processor_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.Processor"
+};
+
+bool processor_add_type(PyObject * module, PyMethodDef * methods)
+{
+	if (p_module_processor_state == NULL)
+		p_module_processor_state = new processor_state();
+
+	processor_type.tp_basicsize = sizeof(processor);
+	processor_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	processor_type.tp_doc = "A gcode position processor with its own positions, triggers and snapshot gcode generators.";
+	processor_type.tp_new = processor_new;
+	processor_type.tp_dealloc = processor_dealloc;
+	processor_type.tp_methods = methods;
+	if (PyType_Ready(&processor_type) < 0)
+	{
+		std::string message = "processor_add_type - Unable to ready the Processor type.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	Py_INCREF(&processor_type);
+	if (PyModule_AddObject(module, "Processor", reinterpret_cast<PyObject*>(&processor_type)) < 0)
+	{
+		Py_DECREF(&processor_type);
+		std::string message = "processor_add_type - Unable to add the Processor type to the module.";
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+		return false;
+	}
+	return true;
+}
+
+processor_state * processor_get_state(PyObject * self)
+{
+	// Module functions receive the module (python 3) or NULL (python 2) as self.
+	if (self != NULL && PyObject_TypeCheck(self, &processor_type))
+		return reinterpret_cast<processor*>(self)->p_state;
+	return p_module_processor_state;
+}
@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PROCESSOR_STATE_H
+#define PROCESSOR_STATE_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <string>
+#include <map>
+#include <memory>
+#include "gcode_position.h"
+#include "gcode_parser.h"
+#include "snapshot_trigger.h"
+#include "snapshot_gcode_generator.h"
+#include "processing_stats.h"
+
+/**
+ * \brief Everything the module functions keep between calls:  the parser, and the gcode positions, triggers,
+ * snapshot gcode generators and update timing for each key.  Only touch it while holding the GIL.
+ */
+class processor_state
+{
+public:
+	processor_state();
+	~processor_state();
+	gcode_parser parser;
+	// Shared with any PositionHandle created for the key
+	std::map<std::string, std::shared_ptr<gcode_position> > gcode_positions;
+	// Native real-time triggers, keyed by the key of the gcode_position they follow.
+	std::map<std::string, snapshot_trigger*> snapshot_triggers;
+	std::map<std::string, snapshot_gcode_generator*> snapshot_gcode_generators;
+	// The timing of Update, UpdateView and UpdateBatch for each gcode position key.
+	std::map<std::string, processing_call_stats> update_stats;
+private:
+	processor_state(const processor_state &source);
+};
+
+/**
+ * \brief A python object that owns a processor_state.  It has the same methods as the module, but the keys of one
+ * Processor never see the positions of another, or those used by the module functions.
+ */
+typedef struct {
+	PyObject_HEAD
+	processor_state * p_state;
+} processor;
+
+extern PyTypeObject processor_type;
+
+/**
+ * \brief Readies the Processor type with the supplied methods and adds it to the module.  Returns false on failure.
+ */
+bool processor_add_type(PyObject * module, PyMethodDef * methods);
+/**
+ * \brief Returns the state of self if it is a Processor, else the state shared by the module functions.
+ */
+processor_state * processor_get_state(PyObject * self);
+#endif
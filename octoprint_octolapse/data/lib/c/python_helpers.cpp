@@ -18,6 +18,18 @@ const char* PyUnicode_SafeAsString(PyObject * py)
 #endif
 }
 
+const char* PyUnicode_SafeAsStringAndSize(PyObject * py, Py_ssize_t * length)
+{
+#if PY_MAJOR_VERSION >= 3
+	return PyUnicode_AsUTF8AndSize(py, length);
+#else
+	char * buffer;
+	if (PyString_AsStringAndSize(py, &buffer, length) != 0)
+		return NULL;
+	return buffer;
+#endif
+}
+
 PyObject * PyString_SafeFromString(const char * str)
 {
 #if PY_MAJOR_VERSION >= 3
@@ -89,4 +101,12 @@ bool PyFloatLongOrInt_Check(PyObject* py_object)
 #endif
 		);
 
-}
\ No newline at end of file
+}
+PyObject * PyIntOrLong_FromLong(long value)
+{
+#if PY_MAJOR_VERSION >= 3
+	return PyLong_FromLong(value);
+#else
+	return PyInt_FromLong(value);
+#endif
+}
@@ -9,8 +9,10 @@
 #include <string>
 int PyUnicode_SafeCheck(PyObject * py);
 const char* PyUnicode_SafeAsString(PyObject * py);
+const char* PyUnicode_SafeAsStringAndSize(PyObject * py, Py_ssize_t * length);
 PyObject * PyString_SafeFromString(const char * str);
 PyObject * PyUnicode_SafeFromString(std::string str);
 double PyFloatOrInt_AsDouble(PyObject* py_double_or_int);
 long PyIntOrLong_AsLong(PyObject * value);
+PyObject * PyIntOrLong_FromLong(long value);
 bool PyFloatLongOrInt_Check(PyObject* value);
\ No newline at end of file
@@ -0,0 +1,462 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "slicer_settings_extractor.h"
+#include "logging.h"
+#include "python_helpers.h"
+#include <cstring>
+#include <exception>
+
+#pragma region Matching
+// Matches the characters that python's str.strip and the \s regex class treat as whitespace within the ascii range
+static inline bool is_setting_whitespace(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r') || (c >= '\x1c' && c <= '\x1f');
+}
+
+static inline bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// Returns true if the pattern matches at p_line.  A space in the pattern matches exactly one whitespace character.
+static bool matches_pattern_at(const char* p_line, const char* p_end, const char* pattern, const char*& p_rest)
+{
+	const char* p_cur = p_line;
+	for (; *pattern != '\0'; ++pattern, ++p_cur)
+	{
+		if (p_cur >= p_end)
+			return false;
+		if (*pattern == ' ' ? !is_setting_whitespace(*p_cur) : *pattern != *p_cur)
+			return false;
+	}
+	p_rest = p_cur;
+	return true;
+}
+
+// Matches up to max_digits digits, like [0-9]?[0-9]?
+static void match_digits(const char*& p_cur, const char* p_end, int max_digits, std::string& digits)
+{
+	const char* p_start = p_cur;
+	while (p_cur < p_end && is_digit(*p_cur) && p_cur - p_start < max_digits)
+		++p_cur;
+	digits.assign(p_start, p_cur);
+}
+
+static bool match_literal(const char*& p_cur, const char* p_end, const char* literal)
+{
+	const size_t literal_length = strlen(literal);
+	if (static_cast<size_t>(p_end - p_cur) < literal_length || memcmp(p_cur, literal, literal_length) != 0)
+		return false;
+	p_cur += literal_length;
+	return true;
+}
+
+// General settings of Slic3r PE and Cura, like the regex:  ^; (?P<key>[^,]*?) = (?P<val>.*)
+static bool try_match_key_equals_value(const char* p_line, size_t length, const char*& p_key, size_t& key_length, const char*& p_value, size_t& value_length)
+{
+	if (length < 2 || p_line[0] != ';' || p_line[1] != ' ')
+		return false;
+	const char* p_end = p_line + length;
+	for (const char* p_cur = p_line + 2; p_cur + 3 <= p_end; ++p_cur)
+	{
+		if (*p_cur == ',')
+			return false;
+		if (p_cur[0] == ' ' && p_cur[1] == '=' && p_cur[2] == ' ')
+		{
+			p_key = p_line + 2;
+			key_length = static_cast<size_t>(p_cur - p_key);
+			p_value = p_cur + 3;
+			value_length = static_cast<size_t>(p_end - p_value);
+			return true;
+		}
+	}
+	return false;
+}
+
+// General settings of Simplify 3D, like the regex:  ^;\s\s\s(?P<key>.*?),(?P<val>.*)$
+static bool try_match_key_comma_value(const char* p_line, size_t length, const char*& p_key, size_t& key_length, const char*& p_value, size_t& value_length)
+{
+	if (
+		length < 5 || p_line[0] != ';'
+		|| !is_setting_whitespace(p_line[1]) || !is_setting_whitespace(p_line[2]) || !is_setting_whitespace(p_line[3])
+	)
+		return false;
+	const char* p_end = p_line + length;
+	const char* p_comma = static_cast<const char*>(memchr(p_line + 4, ',', static_cast<size_t>(p_end - (p_line + 4))));
+	if (p_comma == NULL)
+		return false;
+	p_key = p_line + 4;
+	key_length = static_cast<size_t>(p_comma - p_key);
+	p_value = p_comma + 1;
+	value_length = static_cast<size_t>(p_end - p_value);
+	return true;
+}
+
+// ^; generated by (?P<ver>.*) on (?P<year>[0-9]?[0-9]?[0-9]?[0-9])-(?P<mon>[0-9]?[0-9])-(?P<day>[0-9]?[0-9]) at
+// (?P<hour>[0-9]?[0-9]):(?P<min>[0-9]?[0-9]):(?P<sec>[0-9]?[0-9])$
+static bool try_match_slic3r_pe_version(const char* p_line, size_t length, std::vector<std::pair<std::string, std::string> >& groups)
+{
+	static const char* prefix = "; generated by ";
+	static const size_t prefix_length = strlen(prefix);
+	if (length < prefix_length || memcmp(p_line, prefix, prefix_length) != 0)
+		return false;
+	const char* p_end = p_line + length;
+	const char* p_version = p_line + prefix_length;
+	// The version is greedy, so try the last ' on ' first
+	for (const char* p_on = p_end - 4; p_on >= p_version; --p_on)
+	{
+		if (memcmp(p_on, " on ", 4) != 0)
+			continue;
+		const char* p_cur = p_on + 4;
+		std::string year, month, day, hour, minute, second;
+		match_digits(p_cur, p_end, 4, year);
+		if (!match_literal(p_cur, p_end, "-"))
+			continue;
+		match_digits(p_cur, p_end, 2, month);
+		if (!match_literal(p_cur, p_end, "-"))
+			continue;
+		match_digits(p_cur, p_end, 2, day);
+		if (!match_literal(p_cur, p_end, " at "))
+			continue;
+		match_digits(p_cur, p_end, 2, hour);
+		if (!match_literal(p_cur, p_end, ":"))
+			continue;
+		match_digits(p_cur, p_end, 2, minute);
+		if (!match_literal(p_cur, p_end, ":"))
+			continue;
+		match_digits(p_cur, p_end, 2, second);
+		if (p_cur == p_end)
+		{
+			groups.clear();
+			groups.push_back(std::pair<std::string, std::string>("ver", std::string(p_version, p_on)));
+			groups.push_back(std::pair<std::string, std::string>("year", year));
+			groups.push_back(std::pair<std::string, std::string>("mon", month));
+			groups.push_back(std::pair<std::string, std::string>("day", day));
+			groups.push_back(std::pair<std::string, std::string>("hour", hour));
+			groups.push_back(std::pair<std::string, std::string>("min", minute));
+			groups.push_back(std::pair<std::string, std::string>("sec", second));
+			return true;
+		}
+	}
+	return false;
+}
+// ;\sG\-Code\sgenerated\sby\sSimplify3D\(R\)\sVersion\s(?P<ver>.*)$  Note that this is not anchored to the start of the line.
+static bool try_match_simplify_3d_version(const char* p_line, size_t length, std::vector<std::pair<std::string, std::string> >& groups)
+{
+	const char* p_end = p_line + length;
+	for (const char* p_cur = p_line; p_cur < p_end; ++p_cur)
+	{
+		const char* p_version;
+		if (*p_cur == ';' && matches_pattern_at(p_cur, p_end, "; G-Code generated by Simplify3D(R) Version ", p_version))
+		{
+			groups.clear();
+			groups.push_back(std::pair<std::string, std::string>("ver", std::string(p_version, p_end)));
+			return true;
+		}
+	}
+	return false;
+}
+
+// ^;Generated\swith\sCura_SteamEngine\s(?P<ver>.*)$
+static bool try_match_cura_version(const char* p_line, size_t length, std::vector<std::pair<std::string, std::string> >& groups)
+{
+	const char* p_end = p_line + length;
+	const char* p_version;
+	if (!matches_pattern_at(p_line, p_end, ";Generated with Cura_SteamEngine ", p_version))
+		return false;
+	groups.clear();
+	groups.push_back(std::pair<std::string, std::string>("ver", std::string(p_version, p_end)));
+	return true;
+}
+#pragma endregion Matching
+
+static PyObject* PyUnicode_FromSlice(const std::string& value)
+{
+	// Slicer comments are not always valid utf-8, never fail because of a bad character
+	return PyUnicode_DecodeUTF8(value.c_str(), static_cast<Py_ssize_t>(value.length()), "replace");
+}
+
+static PyObject* string_pairs_to_py_dict(const std::vector<std::pair<std::string, std::string> >& pairs)
+{
+	PyObject* py_dict = PyDict_New();
+	if (py_dict == NULL)
+		return NULL;
+	for (unsigned int index = 0; index < pairs.size(); index++)
+	{
+		PyObject* py_key = PyUnicode_FromSlice(pairs[index].first);
+		PyObject* py_value = PyUnicode_FromSlice(pairs[index].second);
+		if (py_key == NULL || py_value == NULL || PyDict_SetItem(py_dict, py_key, py_value) < 0)
+		{
+			Py_XDECREF(py_key);
+			Py_XDECREF(py_value);
+			Py_DECREF(py_dict);
+			return NULL;
+		}
+		// PyDict_SetItem does not steal the references
+		Py_DECREF(py_key);
+		Py_DECREF(py_value);
+	}
+	return py_dict;
+}
+
+PyObject* slicer_settings_result::to_py_object() const
+{
+	PyObject* py_settings = string_pairs_to_py_dict(settings);
+	PyObject* py_version = NULL;
+	if (is_version_detected)
+		py_version = string_pairs_to_py_dict(version_groups);
+	else
+	{
+		Py_INCREF(Py_None);
+		py_version = Py_None;
+	}
+	if (py_settings == NULL || py_version == NULL)
+	{
+		Py_XDECREF(py_settings);
+		Py_XDECREF(py_version);
+		octolapse_log_exception(octolapse_log::GCODE_PARSER, "slicer_settings_result.to_py_object: Unable to convert the slicer settings to a dict.");
+		return NULL;
+	}
+	// The N format steals the references
+	PyObject* py_result = Py_BuildValue("{s:N,s:N}", "settings", py_settings, "version", py_version);
+	if (py_result == NULL)
+	{
+		octolapse_log_exception(octolapse_log::GCODE_PARSER, "slicer_settings_result.to_py_object: Unable to build the result dict via Py_BuildValue.");
+		return NULL;
+	}
+	return py_result;
+}
+
+slicer_settings_extractor::slicer_settings_extractor(const std::vector<slicer_settings_table>& tables)
+{
+	tables_ = tables;
+	is_complete_ = false;
+}
+
+slicer_settings_extractor::slicer_settings_extractor(const slicer_settings_extractor &source)
+{
+	// Private copy constructor - you can't copy this class
+	throw std::exception();
+}
+
+slicer_settings_extractor::~slicer_settings_extractor()
+{
+}
+
+bool slicer_settings_extractor::extract(const std::string& file_path)
+{
+	is_complete_ = false;
+	// build the key tables
+	states_.clear();
+	results_.clear();
+	states_.resize(tables_.size());
+	results_.resize(tables_.size());
+	for (unsigned int index = 0; index < tables_.size(); index++)
+	{
+		const slicer_settings_table& table = tables_[index];
+		slicer_state& state = states_[index];
+		state.remaining_keys.clear();
+		for (unsigned int key_index = 0; key_index < table.keys.size(); key_index++)
+			state.remaining_keys[table.keys[key_index]] = false;
+		for (unsigned int key_index = 0; key_index < table.ignored_keys.size(); key_index++)
+			state.remaining_keys[table.ignored_keys[key_index]] = true;
+		state.is_version_matched = false;
+		state.forward_lines_processed = 0;
+		state.reverse_lines_processed = 0;
+		results_[index].name = table.name;
+	}
+
+	if (!source_.open(file_path))
+	{
+		std::string message = "Unable to open the gcode file for slicer settings extraction: ";
+		message += file_path;
+		octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::ERROR, message);
+		return false;
+	}
+	is_complete_ = search(true);
+	if (!is_complete_)
+		is_complete_ = search(false);
+	source_.close();
+	return true;
+}
+
+bool slicer_settings_extractor::is_complete() const
+{
+	return is_complete_;
+}
+
+const std::vector<slicer_settings_result>& slicer_settings_extractor::get_results() const
+{
+	return results_;
+}
+
+bool slicer_settings_extractor::search(bool is_forward)
+{
+	std::vector<unsigned int> active_slicers;
+	for (unsigned int index = 0; index < tables_.size(); index++)
+	{
+		if (is_forward ? tables_[index].search_forward : tables_[index].search_reverse)
+			active_slicers.push_back(index);
+	}
+	bool is_slicer_type_detected = false;
+	const char* p_line;
+	size_t length;
+	while (!active_slicers.empty() && (is_forward ? source_.get_next_line(p_line, length) : source_.get_previous_line(p_line, length)))
+	{
+		// strip the line
+		while (length > 0 && is_setting_whitespace(*p_line))
+		{
+			++p_line;
+			--length;
+		}
+		while (length > 0 && is_setting_whitespace(p_line[length - 1]))
+			--length;
+
+		for (int active_index = static_cast<int>(active_slicers.size()) - 1; active_index >= 0; active_index--)
+		{
+			const unsigned int slicer_index = active_slicers[active_index];
+			slicer_state& state = states_[slicer_index];
+			process_line(slicer_index, p_line, length);
+			int lines_processed;
+			int max_lines;
+			if (is_forward)
+			{
+				lines_processed = ++state.forward_lines_processed;
+				max_lines = tables_[slicer_index].max_forward_lines;
+			}
+			else
+			{
+				lines_processed = ++state.reverse_lines_processed;
+				max_lines = tables_[slicer_index].max_reverse_lines;
+			}
+			if (lines_processed >= max_lines)
+				active_slicers.erase(active_slicers.begin() + active_index);
+			else if (state.remaining_keys.empty())
+				return true;
+		}
+		// Once a slicer has been detected, stop searching for the others
+		if (!is_slicer_type_detected)
+		{
+			for (unsigned int active_index = 0; active_index < active_slicers.size(); active_index++)
+			{
+				const unsigned int slicer_index = active_slicers[active_index];
+				if (results_[slicer_index].is_version_detected)
+				{
+					active_slicers.assign(1, slicer_index);
+					is_slicer_type_detected = true;
+					break;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+void slicer_settings_extractor::process_line(unsigned int slicer_index, const char* p_line, size_t length)
+{
+	if (length == 0)
+		return;
+	const char* p_key;
+	size_t key_length;
+	const char* p_value;
+	size_t value_length;
+	const bool is_general_setting = tables_[slicer_index].setting_format == slicer_setting_format_key_comma_value
+		? try_match_key_comma_value(p_line, length, p_key, key_length, p_value, value_length)
+		: try_match_key_equals_value(p_line, length, p_key, key_length, p_value, value_length);
+	if (is_general_setting)
+	{
+		// Only the first matching rule is applied to a line, even if the key is not one we are looking for
+		on_key_found(slicer_index, std::string(p_key, key_length), p_value, value_length);
+		return;
+	}
+	if (!states_[slicer_index].is_version_matched)
+		try_match_version(slicer_index, p_line, length);
+}
+
+bool slicer_settings_extractor::try_match_version(unsigned int slicer_index, const char* p_line, size_t length)
+{
+	slicer_settings_result& result = results_[slicer_index];
+	std::vector<std::pair<std::string, std::string> > groups;
+	bool is_match;
+	switch (tables_[slicer_index].version_format)
+	{
+	case slicer_version_format_slic3r_pe:
+		is_match = try_match_slic3r_pe_version(p_line, length, groups);
+		break;
+	case slicer_version_format_simplify_3d:
+		is_match = try_match_simplify_3d_version(p_line, length, groups);
+		break;
+	case slicer_version_format_cura:
+		is_match = try_match_cura_version(p_line, length, groups);
+		break;
+	default:
+		return false;
+	}
+	if (!is_match)
+		return false;
+	slicer_state& state = states_[slicer_index];
+	state.is_version_matched = true;
+	// The version only counts if we are still looking for it
+	std::map<std::string, bool>::iterator key_iterator = state.remaining_keys.find("version");
+	if (key_iterator == state.remaining_keys.end())
+		return true;
+	state.remaining_keys.erase(key_iterator);
+	result.is_version_detected = true;
+	result.version_groups = groups;
+	return true;
+}
+
+void slicer_settings_extractor::on_key_found(unsigned int slicer_index, const std::string& key, const char* p_value, size_t value_length)
+{
+	slicer_state& state = states_[slicer_index];
+	std::map<std::string, bool>::iterator key_iterator = state.remaining_keys.find(key);
+	// Skip keys we are not looking for, keys that were already found and ignored keys
+	if (key_iterator == state.remaining_keys.end() || key_iterator->second)
+		return;
+	state.remaining_keys.erase(key_iterator);
+	results_[slicer_index].settings.push_back(std::pair<std::string, std::string>(key, std::string(p_value, value_length)));
+}
+
+PyObject* slicer_settings_extractor::to_py_object() const
+{
+	PyObject* py_results = PyDict_New();
+	if (py_results == NULL)
+		return NULL;
+	for (unsigned int index = 0; index < results_.size(); index++)
+	{
+		PyObject* py_result = results_[index].to_py_object();
+		if (py_result == NULL || PyDict_SetItemString(py_results, results_[index].name.c_str(), py_result) < 0)
+		{
+			Py_XDECREF(py_result);
+			Py_DECREF(py_results);
+			return NULL;
+		}
+		Py_DECREF(py_result);
+	}
+	PyObject* py_extraction = Py_BuildValue("(ON)", is_complete_ ? Py_True : Py_False, py_results);
+	if (py_extraction == NULL)
+	{
+		octolapse_log_exception(octolapse_log::GCODE_PARSER, "slicer_settings_extractor.to_py_object: Unable to build the extraction tuple via Py_BuildValue.");
+		return NULL;
+	}
+	return py_extraction;
+}
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef SLICER_SETTINGS_EXTRACTOR_H
+#define SLICER_SETTINGS_EXTRACTOR_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <string>
+#include <vector>
+#include <map>
+#include "gcode_file_source.h"
+
+// How the general settings are written in the gcode comments
+enum slicer_setting_format
+{
+	slicer_setting_format_key_equals_value = 0, // '; key = value' (Slic3r PE, Cura)
+	slicer_setting_format_key_comma_value = 1 // ';   key,value' (Simplify 3D)
+};
+
+// Which slicer header identifies the slicer and provides the version
+enum slicer_version_format
+{
+	slicer_version_format_none = 0,
+	slicer_version_format_slic3r_pe = 1, // '; generated by <ver> on <yyyy>-<mm>-<dd> at <hh>:<mm>:<ss>'
+	slicer_version_format_simplify_3d = 2, // '; G-Code generated by Simplify3D(R) Version <ver>'
+	slicer_version_format_cura = 3 // ';Generated with Cura_SteamEngine <ver>'
+};
+
+/**
+ * \brief The settings to search for in one slicer's comments, matching a GcodeSettingsProcessor.
+ */
+struct slicer_settings_table
+{
+	slicer_settings_table()
+	{
+		setting_format = slicer_setting_format_key_equals_value;
+		version_format = slicer_version_format_none;
+		search_forward = true;
+		search_reverse = true;
+		max_forward_lines = 0;
+		max_reverse_lines = 0;
+	}
+	std::string name;
+	slicer_setting_format setting_format;
+	slicer_version_format version_format;
+	// The keys whose values are extracted
+	std::vector<std::string> keys;
+	// Keys that must be found for the search to be complete, but whose general setting lines are ignored (the version)
+	std::vector<std::string> ignored_keys;
+	bool search_forward;
+	bool search_reverse;
+	int max_forward_lines;
+	int max_reverse_lines;
+};
+
+struct slicer_settings_result
+{
+	slicer_settings_result()
+	{
+		is_version_detected = false;
+	}
+	std::string name;
+	// The setting values, in the order they were found.  Each key is only included once.
+	std::vector<std::pair<std::string, std::string> > settings;
+	bool is_version_detected;
+	// The named groups of the version header, for example ver, year, mon...
+	std::vector<std::pair<std::string, std::string> > version_groups;
+	/**
+	 * \brief Returns a dict: {"settings": {key: value}, "version": {group: value} or None}
+	 */
+	PyObject* to_py_object() const;
+};
+
+/**
+ * \brief Extracts the slicer settings from the header and footer comments of a gcode file.  The header is read forward
+ * and the footer is read backwards, each up to the maximum number of lines of each slicer.  The search works like
+ * settings_preprocessor.GcodeFileProcessor:  As soon as a slicer's version header is found the other slicers are no
+ * longer searched, and the search stops when every key of a slicer has been found.
+ */
+class slicer_settings_extractor
+{
+public:
+	slicer_settings_extractor(const std::vector<slicer_settings_table>& tables);
+	~slicer_settings_extractor();
+	/**
+	 * \brief Searches the file.  Returns false if the file could not be opened.
+	 */
+	bool extract(const std::string& file_path);
+	/**
+	 * \brief True if every key of one of the slicers was found.
+	 */
+	bool is_complete() const;
+	const std::vector<slicer_settings_result>& get_results() const;
+	/**
+	 * \brief Returns a tuple: (is_complete, {slicer name: result dict})
+	 */
+	PyObject* to_py_object() const;
+private:
+	slicer_settings_extractor(const slicer_settings_extractor &source); // don't copy me!
+	struct slicer_state
+	{
+		// The keys that have not been found yet.  The value is true if the key is ignored.
+		std::map<std::string, bool> remaining_keys;
+		bool is_version_matched;
+		int forward_lines_processed;
+		int reverse_lines_processed;
+	};
+	bool search(bool is_forward);
+	void process_line(unsigned int slicer_index, const char* p_line, size_t length);
+	bool try_match_version(unsigned int slicer_index, const char* p_line, size_t length);
+	void on_key_found(unsigned int slicer_index, const std::string& key, const char* p_value, size_t value_length);
+	std::vector<slicer_settings_table> tables_;
+	std::vector<slicer_state> states_;
+	std::vector<slicer_settings_result> results_;
+	gcode_file_source source_;
+	bool is_complete_;
+};
+#endif
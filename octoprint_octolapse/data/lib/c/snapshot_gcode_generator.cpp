@@ -0,0 +1,643 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "snapshot_gcode_generator.h"
+#include "logging.h"
+#include "utilities.h"
+#include "python_helpers.h"
+#include "stabilization.h"
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+// Matches utility.FLOAT_MATH_EQUALITY_RANGE and Pos.min_length_to_retract
+#define SNAPSHOT_GCODE_FLOAT_MATH_EQUALITY_RANGE 0.0000001
+#define SNAPSHOT_GCODE_MIN_LENGTH_TO_RETRACT 0.0001
+
+// Sent in place of the snapshot, matches PrinterProfile.OCTOLAPSE_COMMAND and DEFAULT_OCTOLAPSE_SNAPSHOT_COMMAND
+static const char* const snapshot_gcode_snapshot_command = "@OCTOLAPSE TAKE-SNAPSHOT";
+
+void snapshot_gcode::clear()
+{
+	initialization_gcode.clear();
+	start_gcode.clear();
+	snapshot_commands.clear();
+	return_commands.clear();
+	end_gcode.clear();
+}
+
+static PyObject* gcode_list_to_py_object(const std::vector<std::string>& gcodes)
+{
+	PyObject* py_gcodes = PyList_New(0);
+	if (py_gcodes == NULL)
+		return NULL;
+	for (unsigned int index = 0; index < gcodes.size(); index++)
+	{
+		PyObject* py_gcode = PyUnicode_SafeFromString(gcodes[index]);
+		if (py_gcode == NULL || PyList_Append(py_gcodes, py_gcode) < 0)
+		{
+			Py_XDECREF(py_gcode);
+			Py_DECREF(py_gcodes);
+			return NULL;
+		}
+		// PyList_Append increfs the gcode
+		Py_DECREF(py_gcode);
+	}
+	return py_gcodes;
+}
+
+PyObject* snapshot_gcode::to_py_object() const
+{
+	PyObject* py_initialization_gcode = gcode_list_to_py_object(initialization_gcode);
+	PyObject* py_start_gcode = gcode_list_to_py_object(start_gcode);
+	PyObject* py_snapshot_commands = gcode_list_to_py_object(snapshot_commands);
+	PyObject* py_return_commands = gcode_list_to_py_object(return_commands);
+	PyObject* py_end_gcode = gcode_list_to_py_object(end_gcode);
+	if (
+		py_initialization_gcode == NULL || py_start_gcode == NULL || py_snapshot_commands == NULL
+		|| py_return_commands == NULL || py_end_gcode == NULL
+	)
+	{
+		Py_XDECREF(py_initialization_gcode);
+		Py_XDECREF(py_start_gcode);
+		Py_XDECREF(py_snapshot_commands);
+		Py_XDECREF(py_return_commands);
+		Py_XDECREF(py_end_gcode);
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, "snapshot_gcode.to_py_object: Unable to convert the snapshot gcode to lists of strings.");
+		return NULL;
+	}
+	// The N format steals the references to the lists
+	PyObject* py_snapshot_gcode = Py_BuildValue(
+		"(NNNNN)", py_initialization_gcode, py_start_gcode, py_snapshot_commands, py_return_commands, py_end_gcode
+	);
+	if (py_snapshot_gcode == NULL)
+	{
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, "snapshot_gcode.to_py_object: Unable to build the snapshot gcode tuple via Py_BuildValue.");
+		return NULL;
+	}
+	return py_snapshot_gcode;
+}
+
+snapshot_gcode_generator::snapshot_gcode_generator()
+{
+	p_plan_ = NULL;
+	p_gcode_ = NULL;
+	p_return_position_ = NULL;
+	g90_influences_extruder_ = false;
+	x_current_ = 0;
+	y_current_ = 0;
+	z_current_ = 0;
+	e_current_ = 0;
+	f_current_ = 0;
+	is_relative_current_ = false;
+	is_extruder_relative_current_ = false;
+	length_to_retract_ = 0;
+	distance_to_lift_ = 0;
+	retracted_by_start_gcode_ = false;
+	lifted_by_start_gcode_ = false;
+}
+
+snapshot_gcode_generator::snapshot_gcode_generator(const snapshot_gcode_generator_args& args) : snapshot_gcode_generator()
+{
+	args_ = args;
+}
+
+snapshot_gcode_generator::snapshot_gcode_generator(const snapshot_gcode_generator& source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+snapshot_gcode_generator::~snapshot_gcode_generator()
+{
+}
+
+bool snapshot_gcode_generator::create_gcode(snapshot_plan& plan, bool g90_influences_extruder, bool disable_z_lift, snapshot_gcode& gcode)
+{
+	gcode.clear();
+	if (!initialize(plan, g90_influences_extruder, disable_z_lift, gcode))
+		return false;
+
+	// create the start command if it exists
+	if (!plan.start_command.is_empty)
+		gcode.initialization_gcode.push_back(plan.start_command.gcode);
+
+	// There is no need to stabilize the extruder if we aren't waiting for moves to finish
+	if (args_.wait_for_moves_to_finish)
+	{
+		retract();
+		lift_z();
+	}
+
+	for (unsigned int index = 0; index < plan.steps.size(); index++)
+	{
+		const snapshot_plan_step& step = plan.steps[index];
+		if (step.action == travel_action)
+		{
+			if (args_.wait_for_moves_to_finish)
+				add_travel_action(step);
+		}
+		else if (step.action == snapshot_action)
+			gcode.snapshot_commands.push_back(snapshot_gcode_snapshot_command);
+	}
+
+	if (args_.wait_for_moves_to_finish)
+	{
+		return_to_original_position();
+		// If we zhopped in the beginning, lower z
+		delift_z();
+		deretract();
+		// reset the coordinate systems for the extruder and axis
+		return_to_original_coordinate_systems();
+		return_to_original_feedrate();
+	}
+
+	if (!plan.end_command.is_empty)
+		gcode.end_gcode.push_back(plan.end_command.gcode);
+
+	p_plan_ = NULL;
+	p_gcode_ = NULL;
+	p_return_position_ = NULL;
+	return true;
+}
+
+bool snapshot_gcode_generator::initialize(snapshot_plan& plan, bool g90_influences_extruder, bool disable_z_lift, snapshot_gcode& gcode)
+{
+	const position& initial_position = plan.initial_position;
+	// check the units, only metric works.
+	if (initial_position.is_metric_null || !initial_position.is_metric)
+	{
+		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+			"No unit of measurement has been set and the current printer profile is set to require explicit G20/G21, or the unit of measurement is inches.");
+		return false;
+	}
+	if (args_.extruders.empty())
+	{
+		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, "No extruder gcode generation settings were provided.");
+		return false;
+	}
+	p_plan_ = &plan;
+	p_gcode_ = &gcode;
+	p_return_position_ = plan.return_position.is_empty ? NULL : &plan.return_position;
+	g90_influences_extruder_ = g90_influences_extruder;
+
+	x_current_ = initial_position.x;
+	y_current_ = initial_position.y;
+	z_current_ = initial_position.z;
+	e_current_ = initial_position.get_current_extruder().e;
+	f_current_ = initial_position.f_null ? SNAPSHOT_GCODE_NO_FEEDRATE : initial_position.f;
+	is_relative_current_ = initial_position.is_relative;
+	is_extruder_relative_current_ = initial_position.is_extruder_relative;
+
+	int current_tool = initial_position.current_tool;
+	if (current_tool > static_cast<int>(args_.extruders.size()) - 1)
+	{
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING,
+			"The requested tool index of " << current_tool << " is greater than the number of extruders (" << args_.extruders.size() << ").");
+		current_tool = static_cast<int>(args_.extruders.size()) - 1;
+	}
+	if (current_tool < 0)
+	{
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING,
+			"The requested tool index was less than zero.  Index: " << current_tool << ".");
+		current_tool = 0;
+	}
+	extruder_args_ = args_.extruders[current_tool];
+	distance_to_lift_ = disable_z_lift ? 0 : get_distance_to_lift(initial_position, extruder_args_.z_lift_height);
+	length_to_retract_ = get_length_to_retract(initial_position, extruder_args_.retraction_length);
+	retracted_by_start_gcode_ = false;
+	lifted_by_start_gcode_ = false;
+	return true;
+}
+
+double snapshot_gcode_generator::get_distance_to_lift(const position& pos, double z_lift_height)
+{
+	// Matches Pos.distance_to_zlift with restrict_lift_height
+	if (pos.z_null || pos.last_extrusion_height_null)
+		return 0;
+	const double amount_to_lift = z_lift_height - (pos.z - pos.last_extrusion_height);
+	if (amount_to_lift < SNAPSHOT_GCODE_FLOAT_MATH_EQUALITY_RANGE)
+		return 0;
+	if (amount_to_lift > z_lift_height)
+		return z_lift_height;
+	const double rounded = amount_to_lift / SNAPSHOT_GCODE_FLOAT_MATH_EQUALITY_RANGE + (amount_to_lift >= 0 ? 0.5 : -0.5);
+	return static_cast<double>(static_cast<long long>(rounded)) * SNAPSHOT_GCODE_FLOAT_MATH_EQUALITY_RANGE;
+}
+
+double snapshot_gcode_generator::get_length_to_retract(const position& pos, double retraction_length)
+{
+	// Matches Pos.length_to_retract, which rounds twice to the float equality range.
+	double retract_length = retraction_length - pos.get_current_extruder().retraction_length;
+	retract_length = floor(retract_length * 10000000 + 0.00000005) / 10000000.0;
+	retract_length = floor(retract_length * 10000000 + 0.00000005) / 10000000.0;
+	if (retract_length < 0)
+		return 0;
+	if (retract_length > retraction_length)
+		return retraction_length;
+	// we don't want to retract less than the min_length_to_retract, else we might have quality issues!
+	if (retract_length < SNAPSHOT_GCODE_MIN_LENGTH_TO_RETRACT)
+		return 0;
+	return retract_length;
+}
+
+bool snapshot_gcode_generator::get_altered_feedrate(double feedrate, double& altered_feedrate)
+{
+	if (feedrate == f_current_)
+		return false;
+	f_current_ = feedrate;
+	// The printer keeps its current feedrate, which is no longer known.
+	if (feedrate == SNAPSHOT_GCODE_NO_FEEDRATE)
+		return false;
+	altered_feedrate = feedrate;
+	return true;
+}
+
+bool snapshot_gcode_generator::can_retract() const
+{
+	return extruder_args_.retract_before_move && length_to_retract_ > 0;
+}
+
+bool snapshot_gcode_generator::can_zhop() const
+{
+	if (!(extruder_args_.retract_before_move && extruder_args_.lift_when_retracted && distance_to_lift_ > 0))
+		return false;
+	return utilities::less_than_or_equal(p_plan_->initial_position.z + distance_to_lift_, args_.max_z);
+}
+
+void snapshot_gcode_generator::set_e_to_relative(std::vector<std::string>& gcodes)
+{
+	if (!is_extruder_relative_current_)
+	{
+		gcodes.push_back("M83");
+		is_extruder_relative_current_ = true;
+	}
+}
+
+void snapshot_gcode_generator::set_e_to_absolute(std::vector<std::string>& gcodes)
+{
+	if (is_extruder_relative_current_)
+	{
+		gcodes.push_back("M82");
+		is_extruder_relative_current_ = false;
+	}
+}
+
+void snapshot_gcode_generator::set_xyz_to_relative(std::vector<std::string>& gcodes)
+{
+	if (!is_relative_current_)
+	{
+		gcodes.push_back("G91");
+		is_relative_current_ = true;
+		// this may also influence the extruder
+		if (g90_influences_extruder_)
+			is_extruder_relative_current_ = true;
+	}
+}
+
+void snapshot_gcode_generator::set_xyz_to_absolute(std::vector<std::string>& gcodes)
+{
+	if (is_relative_current_)
+	{
+		gcodes.push_back("G90");
+		is_relative_current_ = false;
+		// this may also influence the extruder
+		if (g90_influences_extruder_)
+			is_extruder_relative_current_ = false;
+	}
+}
+
+#pragma region Retract and Lift
+void snapshot_gcode_generator::retract()
+{
+	if (!can_retract())
+		return;
+	if (args_.axis_mode_compatibility || is_extruder_relative_current_)
+		retract_relative();
+	else
+		retract_absolute();
+}
+
+void snapshot_gcode_generator::retract_relative()
+{
+	set_e_to_relative(p_gcode_->start_gcode);
+	const double length_to_retract = -1 * length_to_retract_;
+	e_current_ += length_to_retract;
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.retraction_speed, f);
+	p_gcode_->start_gcode.push_back(get_gcode_retract(length_to_retract, has_f, f));
+	retracted_by_start_gcode_ = true;
+}
+
+void snapshot_gcode_generator::retract_absolute()
+{
+	set_e_to_absolute(p_gcode_->start_gcode);
+	e_current_ += -1 * length_to_retract_;
+	retracted_by_start_gcode_ = true;
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.retraction_speed, f);
+	const double e_offset = p_plan_->initial_position.get_current_extruder().e_offset;
+	p_gcode_->start_gcode.push_back(get_gcode_retract(e_current_ - e_offset, has_f, f));
+}
+
+void snapshot_gcode_generator::deretract()
+{
+	if (!retracted_by_start_gcode_)
+		return;
+	if (args_.axis_mode_compatibility || is_extruder_relative_current_)
+		deretract_relative();
+	else
+		deretract_absolute();
+}
+
+void snapshot_gcode_generator::deretract_relative()
+{
+	const double length_to_deretract = length_to_retract_;
+	e_current_ += length_to_deretract;
+	set_e_to_relative(p_gcode_->end_gcode);
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.deretraction_speed, f);
+	p_gcode_->end_gcode.push_back(get_gcode_retract(length_to_deretract, has_f, f));
+}
+
+void snapshot_gcode_generator::deretract_absolute()
+{
+	set_e_to_absolute(p_gcode_->end_gcode);
+	e_current_ += length_to_retract_;
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.deretraction_speed, f);
+	const double e_offset = p_plan_->initial_position.get_current_extruder().e_offset;
+	p_gcode_->end_gcode.push_back(get_gcode_retract(e_current_ - e_offset, has_f, f));
+}
+
+void snapshot_gcode_generator::lift_z()
+{
+	if (!can_zhop())
+		return;
+	if (args_.axis_mode_compatibility || is_relative_current_)
+		lift_z_relative();
+	else
+		lift_z_absolute();
+}
+
+void snapshot_gcode_generator::lift_z_relative()
+{
+	z_current_ += distance_to_lift_;
+	set_xyz_to_relative(p_gcode_->start_gcode);
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.z_lift_speed, f);
+	p_gcode_->start_gcode.push_back(get_gcode_z_lift(distance_to_lift_, has_f, f));
+	lifted_by_start_gcode_ = true;
+}
+
+void snapshot_gcode_generator::lift_z_absolute()
+{
+	set_xyz_to_absolute(p_gcode_->start_gcode);
+	z_current_ += distance_to_lift_;
+	lifted_by_start_gcode_ = true;
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.z_lift_speed, f);
+	p_gcode_->start_gcode.push_back(get_gcode_z_lift(z_current_ - p_plan_->initial_position.z_offset, has_f, f));
+}
+
+void snapshot_gcode_generator::delift_z()
+{
+	if (!lifted_by_start_gcode_)
+		return;
+	if (args_.axis_mode_compatibility || is_relative_current_)
+		delift_z_relative();
+	else
+		delift_z_absolute();
+}
+
+void snapshot_gcode_generator::delift_z_relative()
+{
+	const double distance_to_delift = -1 * distance_to_lift_;
+	z_current_ += distance_to_delift;
+	set_xyz_to_relative(p_gcode_->end_gcode);
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.z_lift_speed, f);
+	p_gcode_->end_gcode.push_back(get_gcode_z_lift(distance_to_delift, has_f, f));
+}
+
+void snapshot_gcode_generator::delift_z_absolute()
+{
+	set_xyz_to_absolute(p_gcode_->end_gcode);
+	z_current_ += -1 * distance_to_lift_;
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.z_lift_speed, f);
+	p_gcode_->end_gcode.push_back(get_gcode_z_lift(z_current_ - p_plan_->initial_position.z_offset, has_f, f));
+}
+#pragma endregion Retract and Lift
+
+#pragma region Travel
+void snapshot_gcode_generator::add_travel_action(const snapshot_plan_step& step)
+{
+	if (step.p_x == NULL || step.p_y == NULL)
+		return;
+	// In compatibility mode travel is always absolute
+	if (!args_.axis_mode_compatibility && is_relative_current_)
+		add_travel_action_relative(step);
+	else
+		add_travel_action_absolute(step);
+}
+
+void snapshot_gcode_generator::add_travel_action_relative(const snapshot_plan_step& step)
+{
+	const double x = *step.p_x;
+	const double y = *step.p_y;
+	if (!(x_current_ == x && y_current_ == y))
+	{
+		set_xyz_to_relative(p_gcode_->snapshot_commands);
+		const double x_relative = x - x_current_;
+		const double y_relative = y - y_current_;
+		x_current_ = x;
+		y_current_ = y;
+		double f = 0;
+		const bool has_f = get_altered_feedrate(extruder_args_.x_y_travel_speed, f);
+		p_gcode_->snapshot_commands.push_back(get_gcode_travel(x_relative, y_relative, has_f, f));
+	}
+}
+
+void snapshot_gcode_generator::add_travel_action_absolute(const snapshot_plan_step& step)
+{
+	const double x = *step.p_x;
+	const double y = *step.p_y;
+	if (!(x_current_ == x && y_current_ == y))
+	{
+		// Move to Snapshot Position
+		set_xyz_to_absolute(p_gcode_->snapshot_commands);
+		x_current_ = x;
+		y_current_ = y;
+		double f = 0;
+		const bool has_f = get_altered_feedrate(extruder_args_.x_y_travel_speed, f);
+		const position& initial_position = p_plan_->initial_position;
+		p_gcode_->snapshot_commands.push_back(get_gcode_travel(
+			x - initial_position.x_offset + initial_position.x_firmware_offset,
+			y - initial_position.y_offset + initial_position.y_firmware_offset,
+			has_f, f
+		));
+	}
+}
+
+void snapshot_gcode_generator::return_to_original_position()
+{
+	if (!args_.axis_mode_compatibility && is_relative_current_)
+		return_to_original_position_relative();
+	else
+		return_to_original_position_absolute();
+}
+
+void snapshot_gcode_generator::return_to_original_position_relative()
+{
+	if (p_return_position_ == NULL || (x_current_ == p_return_position_->x && y_current_ == p_return_position_->y))
+		return;
+	// Like the python generator, any G91 is sent with the snapshot commands.
+	set_xyz_to_relative(p_gcode_->snapshot_commands);
+	const double x_relative = p_return_position_->x - x_current_;
+	const double y_relative = p_return_position_->y - y_current_;
+	x_current_ = p_return_position_->x;
+	y_current_ = p_return_position_->y;
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.x_y_travel_speed, f);
+	p_gcode_->return_commands.push_back(get_gcode_travel(x_relative, y_relative, has_f, f));
+}
+
+void snapshot_gcode_generator::return_to_original_position_absolute()
+{
+	// Only return to the previous coordinates if we need to (which will be most cases,
+	// except when the triggering command is a travel only (moves both X and Y, but not Z)
+	if (p_return_position_ == NULL || (p_return_position_->x == x_current_ && p_return_position_->y == y_current_))
+		return;
+	x_current_ = p_return_position_->x;
+	y_current_ = p_return_position_->y;
+	// Move back to previous position - make sure we're in absolute mode for this
+	set_xyz_to_absolute(p_gcode_->return_commands);
+	double f = 0;
+	const bool has_f = get_altered_feedrate(extruder_args_.x_y_travel_speed, f);
+	p_gcode_->return_commands.push_back(get_gcode_travel(p_return_position_->get_gcode_x(), p_return_position_->get_gcode_y(), has_f, f));
+}
+#pragma endregion Travel
+
+void snapshot_gcode_generator::return_to_original_coordinate_systems()
+{
+	const position& return_position = p_return_position_ != NULL ? *p_return_position_ : p_plan_->initial_position;
+	if (return_position.is_relative != is_relative_current_)
+	{
+		p_gcode_->end_gcode.push_back(is_relative_current_ ? "G90" : "G91");
+		is_relative_current_ = return_position.is_relative;
+		if (g90_influences_extruder_)
+			is_extruder_relative_current_ = return_position.is_relative;
+	}
+	if (return_position.is_extruder_relative != is_extruder_relative_current_)
+	{
+		p_gcode_->end_gcode.push_back(return_position.is_extruder_relative ? "M83" : "M82");
+		is_extruder_relative_current_ = return_position.is_extruder_relative;
+	}
+}
+
+void snapshot_gcode_generator::return_to_original_feedrate()
+{
+	parsed_command& end_command = p_plan_->end_command;
+	bool feedrate_set_in_end_command = false;
+	if (!end_command.is_empty)
+	{
+		for (unsigned int index = 0; index < end_command.parameters.size(); index++)
+		{
+			if (end_command.parameters[index].name == 'F')
+			{
+				feedrate_set_in_end_command = true;
+				break;
+			}
+		}
+	}
+	const position& return_position = p_return_position_ != NULL ? *p_return_position_ : p_plan_->initial_position;
+	const double f_return = return_position.f;
+	// There is nothing to restore if the feedrate was never set
+	if (feedrate_set_in_end_command || return_position.f_null || f_return == f_current_)
+		return;
+	// see if we can alter the end_command feedrate
+	if (!end_command.is_empty && (end_command.command == "G0" || end_command.command == "G1"))
+	{
+		end_command.parameters.push_back(parsed_command_parameter('F', f_return));
+		end_command.gcode = get_gcode_string(end_command);
+	}
+	else
+	{
+		// we can't count on the end gcode to set f, set it here
+		p_gcode_->end_gcode.push_back(get_gcode_feedrate(f_return));
+	}
+}
+
+#pragma region Gcode Strings
+std::string snapshot_gcode_generator::get_gcode_travel(double x, double y, bool has_f, double f)
+{
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(3) << "G0 X" << x << " Y" << y;
+	if (has_f)
+		stream << " F" << f;
+	return stream.str();
+}
+
+std::string snapshot_gcode_generator::get_gcode_z_lift(double distance, bool has_f, double f)
+{
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(3) << "G1 Z" << distance;
+	if (has_f)
+		stream << " F" << f;
+	return stream.str();
+}
+
+std::string snapshot_gcode_generator::get_gcode_retract(double distance, bool has_f, double f)
+{
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(5) << "G1 E" << distance;
+	if (has_f)
+		stream << std::setprecision(3) << " F" << f;
+	return stream.str();
+}
+
+std::string snapshot_gcode_generator::get_gcode_feedrate(double f)
+{
+	std::stringstream stream;
+	stream << std::fixed << std::setprecision(3) << "G1 F" << f;
+	return stream.str();
+}
+
+std::string snapshot_gcode_generator::get_gcode_string(const parsed_command& command)
+{
+	// Matches ParsedCommand.to_string
+	std::stringstream stream;
+	stream << std::fixed << command.command;
+	for (unsigned int index = 0; index < command.parameters.size(); index++)
+	{
+		const parsed_command_parameter& parameter = command.parameters[index];
+		stream << " ";
+		if (parameter.name != '\0')
+			stream << parameter.name;
+		if (parameter.value_type == 'F')
+			stream << std::setprecision(parameter.name == 'E' ? 5 : 3) << parameter.double_value;
+		else if (parameter.value_type == 'U')
+			stream << parameter.unsigned_long_value;
+		else if (parameter.value_type == 'S')
+			stream << parameter.string_value;
+	}
+	return stream.str();
+}
+#pragma endregion Gcode Strings
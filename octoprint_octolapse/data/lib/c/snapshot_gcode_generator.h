@@ -0,0 +1,164 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef SNAPSHOT_GCODE_GENERATOR_H
+#define SNAPSHOT_GCODE_GENERATOR_H
+#include <string>
+#include <vector>
+#include "snapshot_plan.h"
+// A speed of None in the gcode generation settings.  No F parameter is sent for the move, as in the python generator.
+#define SNAPSHOT_GCODE_NO_FEEDRATE -1
+
+// The gcode generation settings for one extruder, from the printer profile or the slicer settings.  Speeds may be
+// SNAPSHOT_GCODE_NO_FEEDRATE.
+struct snapshot_gcode_extruder_args
+{
+	snapshot_gcode_extruder_args()
+	{
+		x_y_travel_speed = 0;
+		z_lift_speed = 0;
+		retraction_speed = 0;
+		deretraction_speed = 0;
+		retract_before_move = false;
+		retraction_length = 0;
+		lift_when_retracted = false;
+		z_lift_height = 0;
+	}
+	double x_y_travel_speed;
+	double z_lift_speed;
+	double retraction_speed;
+	double deretraction_speed;
+	bool retract_before_move;
+	double retraction_length;
+	bool lift_when_retracted;
+	double z_lift_height;
+};
+
+struct snapshot_gcode_generator_args
+{
+	snapshot_gcode_generator_args()
+	{
+		axis_mode_compatibility = false;
+		wait_for_moves_to_finish = true;
+		max_z = 0;
+	}
+	std::vector<snapshot_gcode_extruder_args> extruders;
+	// Always use relative extrusion and absolute xyz movement, regardless of the current axis modes
+	bool axis_mode_compatibility;
+	// If false, no retract, lift or travel gcode is generated since the snapshot is taken wherever the printer is
+	bool wait_for_moves_to_finish;
+	double max_z;
+};
+
+/**
+ * \brief The gcode for one snapshot, in the order it must be sent.
+ */
+struct snapshot_gcode
+{
+	void clear();
+	/**
+	 * \brief Returns a tuple of lists:  (initialization, start, snapshot, return, end)
+	 */
+	PyObject* to_py_object() const;
+	// commands executed here are not involved in timing calculations
+	std::vector<std::string> initialization_gcode;
+	std::vector<std::string> start_gcode;
+	std::vector<std::string> snapshot_commands;
+	std::vector<std::string> return_commands;
+	std::vector<std::string> end_gcode;
+};
+
+/**
+ * \brief Creates the gcode to travel to each snapshot plan step and back, like SnapshotGcodeGenerator in
+ * stabilization_gcode.py.
+ */
+class snapshot_gcode_generator
+{
+public:
+	snapshot_gcode_generator();
+	snapshot_gcode_generator(const snapshot_gcode_generator_args& args);
+	~snapshot_gcode_generator();
+	/**
+	 * \brief Like the python generator, a missing F parameter may be added to a G0/G1 end command so that the
+	 * original feedrate is restored without sending an additional gcode.
+	 * \return false if the plan cannot be used, for example if the units are not metric.
+	 */
+	bool create_gcode(snapshot_plan& plan, bool g90_influences_extruder, bool disable_z_lift, snapshot_gcode& gcode);
+private:
+	snapshot_gcode_generator(const snapshot_gcode_generator& source);
+	bool initialize(snapshot_plan& plan, bool g90_influences_extruder, bool disable_z_lift, snapshot_gcode& gcode);
+	static double get_distance_to_lift(const position& pos, double z_lift_height);
+	static double get_length_to_retract(const position& pos, double retraction_length);
+	bool get_altered_feedrate(double feedrate, double& altered_feedrate);
+	bool can_retract() const;
+	bool can_zhop() const;
+	void set_e_to_relative(std::vector<std::string>& gcodes);
+	void set_e_to_absolute(std::vector<std::string>& gcodes);
+	void set_xyz_to_relative(std::vector<std::string>& gcodes);
+	void set_xyz_to_absolute(std::vector<std::string>& gcodes);
+	void retract();
+	void retract_relative();
+	void retract_absolute();
+	void deretract();
+	void deretract_relative();
+	void deretract_absolute();
+	void lift_z();
+	void lift_z_relative();
+	void lift_z_absolute();
+	void delift_z();
+	void delift_z_relative();
+	void delift_z_absolute();
+	void add_travel_action(const snapshot_plan_step& step);
+	void add_travel_action_relative(const snapshot_plan_step& step);
+	void add_travel_action_absolute(const snapshot_plan_step& step);
+	void return_to_original_position();
+	void return_to_original_position_relative();
+	void return_to_original_position_absolute();
+	void return_to_original_coordinate_systems();
+	void return_to_original_feedrate();
+	static std::string get_gcode_travel(double x, double y, bool has_f, double f);
+	static std::string get_gcode_z_lift(double distance, bool has_f, double f);
+	static std::string get_gcode_retract(double distance, bool has_f, double f);
+	static std::string get_gcode_feedrate(double f);
+	static std::string get_gcode_string(const parsed_command& command);
+	snapshot_gcode_generator_args args_;
+	// The plan and gcode currently being generated
+	snapshot_plan* p_plan_;
+	snapshot_gcode* p_gcode_;
+	const position* p_return_position_;
+	bool g90_influences_extruder_;
+	// current values
+	double x_current_;
+	double y_current_;
+	double z_current_;
+	double e_current_;
+	double f_current_;
+	bool is_relative_current_;
+	bool is_extruder_relative_current_;
+	// calculated values
+	snapshot_gcode_extruder_args extruder_args_;
+	double length_to_retract_;
+	double distance_to_lift_;
+	// state flags
+	bool retracted_by_start_gcode_;
+	bool lifted_by_start_gcode_;
+};
+#endif
@@ -200,4 +200,65 @@ PyObject * snapshot_plan::to_py_object()
 	Py_DECREF(py_end_command);
 	
 	return py_snapshot_plan;
-}
\ No newline at end of file
+}
+
+void snapshot_plan::serialize(binary_writer& writer) const
+{
+	writer.write_long(file_line);
+	writer.write_long(file_gcode_number);
+	writer.write_long(file_position);
+	writer.write_int(static_cast<int>(triggering_command_type));
+	writer.write_int(static_cast<int>(triggering_command_feature_type));
+	triggering_command.serialize(writer);
+	start_command.serialize(writer);
+	writer.write_bool(has_initial_position);
+	initial_position.serialize(writer);
+	writer.write_int(static_cast<int>(steps.size()));
+	for (unsigned int index = 0; index < steps.size(); index++)
+	{
+		steps[index].serialize(writer);
+	}
+	return_position.serialize(writer);
+	end_command.serialize(writer);
+	writer.write_double(distance_from_stabilization_point);
+	writer.write_double(total_travel_distance);
+	writer.write_double(saved_travel_distance);
+}
+
+bool snapshot_plan::deserialize(binary_reader& reader)
+{
+	int command_type_value;
+	int feature_type_value;
+	int num_steps;
+	if (
+		!reader.read_long(file_line) ||
+		!reader.read_long(file_gcode_number) ||
+		!reader.read_long(file_position) ||
+		!reader.read_int(command_type_value) ||
+		!reader.read_int(feature_type_value) ||
+		!triggering_command.deserialize(reader) ||
+		!start_command.deserialize(reader) ||
+		!reader.read_bool(has_initial_position) ||
+		!initial_position.deserialize(reader) ||
+		!reader.read_count(num_steps)
+	)
+	{
+		return false;
+	}
+	triggering_command_type = static_cast<position_type>(command_type_value);
+	triggering_command_feature_type = static_cast<feature_type>(feature_type_value);
+	steps.clear();
+	steps.resize(num_steps);
+	for (int index = 0; index < num_steps; index++)
+	{
+		if (!steps[index].deserialize(reader))
+			return false;
+	}
+	return (
+		return_position.deserialize(reader) &&
+		end_command.deserialize(reader) &&
+		reader.read_double(distance_from_stabilization_point) &&
+		reader.read_double(total_travel_distance) &&
+		reader.read_double(saved_travel_distance)
+	);
+}
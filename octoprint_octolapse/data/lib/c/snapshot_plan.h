@@ -25,6 +25,7 @@
 #include "parsed_command.h"
 #include "position.h"
 #include "trigger_position.h"
+#include "binary_stream.h"
 #include <vector>
 #include <map>
 struct snapshot_plan
@@ -32,6 +33,8 @@ struct snapshot_plan
 	snapshot_plan();
 	PyObject * to_py_object();
 	static PyObject * build_py_object(std::vector<snapshot_plan> &plans);
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
 	long file_line;
 	long file_gcode_number;
 	long file_position;
@@ -0,0 +1,165 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#define _CRT_SECURE_NO_DEPRECATE
+#include "snapshot_plan_cache.h"
+#include "binary_stream.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static const char* cache_file_magic = "OCTOLAPSE_PLANS";
+
+snapshot_plan_cache::snapshot_plan_cache(const std::string& cache_directory)
+{
+	cache_directory_ = cache_directory;
+}
+
+bool snapshot_plan_cache::create_key(const std::string& file_path, const std::string& settings, std::string& key)
+{
+	struct stat file_stat;
+	if (stat(file_path.c_str(), &file_stat) != 0)
+		return false;
+	const long long file_size = static_cast<long long>(file_stat.st_size);
+
+	FILE* p_file = fopen(file_path.c_str(), "rb");
+	if (p_file == NULL)
+		return false;
+
+	// Hash the first block, the last block and blocks spread evenly between them.  Small files are hashed entirely.
+	std::vector<char> block(SNAPSHOT_PLAN_CACHE_SAMPLE_SIZE);
+	unsigned long long hash = binary_hash(NULL, 0);
+	const long long num_blocks = SNAPSHOT_PLAN_CACHE_SAMPLE_COUNT + 2;
+	const bool hash_entire_file = file_size <= static_cast<long long>(SNAPSHOT_PLAN_CACHE_SAMPLE_SIZE) * num_blocks;
+	bool success = true;
+	if (hash_entire_file)
+	{
+		size_t bytes_read;
+		while ((bytes_read = fread(&block[0], 1, block.size(), p_file)) > 0)
+			hash = binary_hash(&block[0], bytes_read, hash);
+	}
+	else
+	{
+		const long long last_block_start = file_size - SNAPSHOT_PLAN_CACHE_SAMPLE_SIZE;
+		for (long long index = 0; index < num_blocks && success; index++)
+		{
+			const long long block_start = last_block_start * index / (num_blocks - 1);
+			if (fseek(p_file, static_cast<long>(block_start), SEEK_SET) != 0)
+			{
+				success = false;
+				break;
+			}
+			const size_t bytes_read = fread(&block[0], 1, block.size(), p_file);
+			hash = binary_hash(&block[0], bytes_read, hash);
+		}
+	}
+	fclose(p_file);
+	if (!success)
+		return false;
+
+	binary_writer writer;
+	writer.write_bytes(reinterpret_cast<const char*>(&file_size), sizeof(file_size));
+	const long long modified_time = static_cast<long long>(file_stat.st_mtime);
+	writer.write_bytes(reinterpret_cast<const char*>(&modified_time), sizeof(modified_time));
+	writer.write_bytes(reinterpret_cast<const char*>(&hash), sizeof(hash));
+	writer.write_string(settings);
+	key = writer.get_buffer();
+	return true;
+}
+
+bool snapshot_plan_cache::try_load(const std::string& key, stabilization_results& results) const
+{
+	FILE* p_file = fopen(get_cache_file_path(key).c_str(), "rb");
+	if (p_file == NULL)
+		return false;
+	std::string contents;
+	char buffer[65536];
+	size_t bytes_read;
+	while ((bytes_read = fread(buffer, 1, sizeof(buffer), p_file)) > 0)
+		contents.append(buffer, bytes_read);
+	fclose(p_file);
+
+	binary_reader reader(contents.c_str(), contents.size());
+	const size_t magic_length = strlen(cache_file_magic);
+	std::vector<char> magic(magic_length);
+	int version;
+	std::string stored_key;
+	if (
+		!reader.read_bytes(&magic[0], magic_length) ||
+		memcmp(&magic[0], cache_file_magic, magic_length) != 0 ||
+		!reader.read_int(version) ||
+		version != SNAPSHOT_PLAN_CACHE_VERSION ||
+		!reader.read_string(stored_key) ||
+		stored_key != key
+	)
+	{
+		return false;
+	}
+	stabilization_results cached_results;
+	if (!cached_results.deserialize(reader) || !reader.is_at_end())
+		return false;
+	results = cached_results;
+	return true;
+}
+
+bool snapshot_plan_cache::save(const std::string& key, const stabilization_results& results) const
+{
+	binary_writer writer;
+	writer.write_bytes(cache_file_magic, strlen(cache_file_magic));
+	writer.write_int(SNAPSHOT_PLAN_CACHE_VERSION);
+	writer.write_string(key);
+	results.serialize(writer);
+
+	// Write to a temporary file first so that a partially written entry can never be loaded.
+	const std::string file_path = get_cache_file_path(key);
+	const std::string temp_file_path = file_path + ".tmp";
+	FILE* p_file = fopen(temp_file_path.c_str(), "wb");
+	if (p_file == NULL)
+		return false;
+	const std::string& buffer = writer.get_buffer();
+	const bool success = fwrite(buffer.c_str(), 1, buffer.size(), p_file) == buffer.size();
+	if (fclose(p_file) != 0 || !success)
+	{
+		remove(temp_file_path.c_str());
+		return false;
+	}
+	// rename won't replace an existing file on Windows
+	remove(file_path.c_str());
+	if (rename(temp_file_path.c_str(), file_path.c_str()) != 0)
+	{
+		remove(temp_file_path.c_str());
+		return false;
+	}
+	return true;
+}
+
+std::string snapshot_plan_cache::get_cache_file_path(const std::string& key) const
+{
+	char file_name[32];
+	sprintf(file_name, "%016llx.plans", binary_hash(key.c_str(), key.size()));
+	std::string file_path = cache_directory_;
+	if (!file_path.empty() && file_path[file_path.size() - 1] != '/' && file_path[file_path.size() - 1] != '\\')
+		file_path += "/";
+	file_path += file_name;
+	return file_path;
+}
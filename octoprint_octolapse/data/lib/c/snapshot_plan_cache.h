@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SNAPSHOT_PLAN_CACHE_H
+#define SNAPSHOT_PLAN_CACHE_H
+#include <string>
+#include "stabilization_results.h"
+
+// Increment whenever the serialized form of the stabilization results, or the plans created for a file, change so that
+// old cache files are ignored.
+#define SNAPSHOT_PLAN_CACHE_VERSION 2
+// The size of each block of the gcode file that is hashed when creating a cache key.
+#define SNAPSHOT_PLAN_CACHE_SAMPLE_SIZE 65536
+// The number of blocks hashed between the first and last block of the gcode file.
+#define SNAPSHOT_PLAN_CACHE_SAMPLE_COUNT 16
+
+/**
+ * \brief Stores stabilization results on disk so that an unchanged gcode file doesn't need to be processed again with
+ * the same settings.  Each entry is a file in the cache directory named after a hash of its key.  The full key is
+ * stored in the file and compared when loading, so hash collisions are treated as misses.
+ */
+class snapshot_plan_cache
+{
+public:
+	snapshot_plan_cache(const std::string& cache_directory);
+	/**
+	 * \brief Creates a key from the size and modification time of the gcode file, a hash of sampled blocks of the
+	 * file and the serialized settings.
+	 * \return false if the file could not be read.
+	 */
+	static bool create_key(const std::string& file_path, const std::string& settings, std::string& key);
+	bool try_load(const std::string& key, stabilization_results& results) const;
+	/**
+	 * \brief Saves the results, replacing any existing entry with the same key.  The directory must already exist.
+	 */
+	bool save(const std::string& key, const stabilization_results& results) const;
+private:
+	std::string get_cache_file_path(const std::string& key) const;
+	std::string cache_directory_;
+};
+#endif
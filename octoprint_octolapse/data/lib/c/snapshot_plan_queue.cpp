@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "snapshot_plan_queue.h"
+
+snapshot_plan_queue::snapshot_plan_queue() : pushed_count_(0), planned_gcode_number_(0), is_complete_(false)
+{
+}
+
+snapshot_plan_queue::snapshot_plan_queue(const snapshot_plan_queue& source) : pushed_count_(0), planned_gcode_number_(0), is_complete_(false)
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+void snapshot_plan_queue::push(std::vector<snapshot_plan>& plans)
+{
+	if (plans.empty())
+		return;
+	{
+		octolapse_sync::lock_guard<octolapse_sync::mutex> lock(mutex_);
+		for (std::vector<snapshot_plan>::iterator it = plans.begin(); it != plans.end(); ++it)
+			plans_.push_back(std::move(*it));
+	}
+	pushed_count_.fetch_add(static_cast<long>(plans.size()), octolapse_sync::memory_order_release);
+	plans.clear();
+}
+
+void snapshot_plan_queue::set_planned_gcode_number(const long gcode_number)
+{
+	planned_gcode_number_.store(gcode_number, octolapse_sync::memory_order_release);
+}
+
+void snapshot_plan_queue::finish()
+{
+	is_complete_.store(true, octolapse_sync::memory_order_release);
+}
+
+size_t snapshot_plan_queue::take(std::vector<snapshot_plan>& plans)
+{
+	octolapse_sync::lock_guard<octolapse_sync::mutex> lock(mutex_);
+	const size_t count = plans_.size();
+	for (std::vector<snapshot_plan>::iterator it = plans_.begin(); it != plans_.end(); ++it)
+		plans.push_back(std::move(*it));
+	plans_.clear();
+	return count;
+}
+
+long snapshot_plan_queue::get_pushed_count() const
+{
+	return pushed_count_.load(octolapse_sync::memory_order_acquire);
+}
+
+long snapshot_plan_queue::get_planned_gcode_number() const
+{
+	return planned_gcode_number_.load(octolapse_sync::memory_order_acquire);
+}
+
+bool snapshot_plan_queue::is_complete() const
+{
+	return is_complete_.load(octolapse_sync::memory_order_acquire);
+}
@@ -0,0 +1,67 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef SNAPSHOT_PLAN_QUEUE_H
+#define SNAPSHOT_PLAN_QUEUE_H
+#include <vector>
+#include "threads.h"
+#include "snapshot_plan.h"
+
+/**
+ * \brief Hands snapshot plans from the processing thread to the printing thread while the file is still being
+ * processed.  The processing thread pushes each plan as soon as it is complete, and then publishes the planned gcode
+ * number, below which every plan has been pushed.  The plans are guarded by a mutex, but the counts and the planned
+ * gcode number are atomics that can be read without waiting on the processing thread.
+ * Only one thread may push, and only one thread may take.
+ */
+class snapshot_plan_queue
+{
+public:
+	snapshot_plan_queue();
+	/**
+	 * \brief Moves the plans to the end of the queue, leaving plans empty.
+	 */
+	void push(std::vector<snapshot_plan>& plans);
+	/**
+	 * \brief Publishes that every plan triggering before gcode_number has been pushed.
+	 */
+	void set_planned_gcode_number(long gcode_number);
+	/**
+	 * \brief Publishes that every plan has been pushed.
+	 */
+	void finish();
+	/**
+	 * \brief Moves every plan that has been pushed but not taken to the end of plans.  Returns the number of plans moved.
+	 */
+	size_t take(std::vector<snapshot_plan>& plans);
+	long get_pushed_count() const;
+	long get_planned_gcode_number() const;
+	bool is_complete() const;
+private:
+	snapshot_plan_queue(const snapshot_plan_queue& source);
+	octolapse_sync::mutex mutex_;
+	std::vector<snapshot_plan> plans_;
+	// Readers should load is_complete_ and planned_gcode_number_ before pushed_count_, which is then at least as new.
+	octolapse_sync::atomic<long> pushed_count_;
+	octolapse_sync::atomic<long> planned_gcode_number_;
+	octolapse_sync::atomic<bool> is_complete_;
+};
+#endif
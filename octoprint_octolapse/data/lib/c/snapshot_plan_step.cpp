@@ -25,153 +25,54 @@
 #include "logging.h"
 snapshot_plan_step::snapshot_plan_step()
 {
-	p_x = NULL;
-	p_y = NULL;
-	p_z = NULL;
-	p_e = NULL;
-	p_f = NULL;
+	set_coordinates(NULL, NULL, NULL, NULL, NULL);
 	action = "";
 }
 
 snapshot_plan_step::snapshot_plan_step(const snapshot_plan_step & source)
 {
-	if (source.p_x != NULL)
-	{
-		p_x = new double;
-		*p_x = *source.p_x;
-	}
-	else
-	{
-		p_x = NULL;
-	}
-
-	if (source.p_y != NULL)
-	{
-		p_y = new double;
-		*p_y = *source.p_y;
-	}
-	else
-	{
-		p_y = NULL;
-	}
-
-
-	if (source.p_z != NULL)
-	{
-		p_z = new double;
-		*p_z = *source.p_z;
-	}
-	else
-	{
-		p_z = NULL;
-	}
-
-	if (source.p_e != NULL)
-	{
-		p_e = new double;
-		*p_e = *source.p_e;
-	}
-	else
-	{
-		p_e = NULL;
-	}
-
-	if (source.p_f != NULL)
-	{
-		p_f = new double;
-		*p_f = *source.p_f;
-	}
-	else
-	{
-		p_f = NULL;
-	}
-
+	set_coordinates(source.p_x, source.p_y, source.p_z, source.p_e, source.p_f);
 	action = source.action;
 }
+
 snapshot_plan_step::snapshot_plan_step(double* x, double* y, double* z, double* e, double* f, std::string action_type) 
 {
-	if (x != NULL)
-	{
-		p_x = new double;
-		*p_x = *x;
-	}
-	else
-	{
-		p_x = NULL;
-	}
-
-	if (y != NULL)
-	{
-		p_y = new double;
-		*p_y = *y;
-	}
-	else
-	{
-		p_y = NULL;
-	}
-
+	set_coordinates(x, y, z, e, f);
+	action = action_type;
+}
 
-	if (z != NULL)
-	{
-		p_z = new double;
-		*p_z = *z;
-	}
-	else
+snapshot_plan_step& snapshot_plan_step::operator=(const snapshot_plan_step& source)
+{
+	if (this != &source)
 	{
-		p_z = NULL;
+		set_coordinates(source.p_x, source.p_y, source.p_z, source.p_e, source.p_f);
+		action = source.action;
 	}
+	return *this;
+}
 
-	if (e != NULL)
-	{
-		p_e = new double;
-		*p_e = *e;
-	}
-	else
-	{
-		p_e = NULL;
-	}
+snapshot_plan_step::~snapshot_plan_step()
+{
+}
 
-	if (f != NULL)
-	{
-		p_f = new double;
-		*p_f = *f;
-	}
-	else
+static double* set_coordinate(const double* p_source, double& value)
+{
+	if (p_source == NULL)
 	{
-		p_f = NULL;
+		value = 0;
+		return NULL;
 	}
-
-	action = action_type;
+	value = *p_source;
+	return &value;
 }
 
-snapshot_plan_step::~snapshot_plan_step()
+void snapshot_plan_step::set_coordinates(const double* x, const double* y, const double* z, const double* e, const double* f)
 {
-	if (p_x != NULL)
-	{
-		delete p_x;
-		p_x = NULL;
-	}
-	if(p_y != NULL)
-	{
-		delete p_y;
-		p_y = NULL;
-	}
-	if (p_z != NULL)
-	{
-		delete p_z;
-		p_z = NULL;
-	}
-	if (p_e != NULL)
-	{
-		delete p_e;
-		p_e = NULL;
-	}
-	if (p_f != NULL)
-	{
-		delete p_f;
-		p_f = NULL;
-	}
-	
+	p_x = set_coordinate(x, x_);
+	p_y = set_coordinate(y, y_);
+	p_z = set_coordinate(z, z_);
+	p_e = set_coordinate(e, e_);
+	p_f = set_coordinate(f, f_);
 }
 
 PyObject * snapshot_plan_step::to_py_object() const
@@ -275,3 +176,45 @@ PyObject * snapshot_plan_step::to_py_object() const
 	Py_DecRef(py_f);
 	return py_step;
 }
+
+static void serialize_coordinate(binary_writer& writer, const double* p_value)
+{
+	writer.write_bool(p_value != NULL);
+	if (p_value != NULL)
+		writer.write_double(*p_value);
+}
+
+static bool deserialize_coordinate(binary_reader& reader, double*& p_value, double& value)
+{
+	bool has_value;
+	if (!reader.read_bool(has_value))
+		return false;
+	p_value = NULL;
+	value = 0;
+	if (!has_value)
+		return true;
+	p_value = &value;
+	return reader.read_double(value);
+}
+
+void snapshot_plan_step::serialize(binary_writer& writer) const
+{
+	serialize_coordinate(writer, p_x);
+	serialize_coordinate(writer, p_y);
+	serialize_coordinate(writer, p_z);
+	serialize_coordinate(writer, p_e);
+	serialize_coordinate(writer, p_f);
+	writer.write_string(action);
+}
+
+bool snapshot_plan_step::deserialize(binary_reader& reader)
+{
+	return (
+		deserialize_coordinate(reader, p_x, x_) &&
+		deserialize_coordinate(reader, p_y, y_) &&
+		deserialize_coordinate(reader, p_z, z_) &&
+		deserialize_coordinate(reader, p_e, e_) &&
+		deserialize_coordinate(reader, p_f, f_) &&
+		reader.read_string(action)
+	);
+}
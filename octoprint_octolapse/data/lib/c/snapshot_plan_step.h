@@ -22,6 +22,7 @@
 #ifndef SNAPSHOT_PLAN_STEP_H
 #define SNAPSHOT_PLAN_STEP_H
 #include <string>
+#include "binary_stream.h"
 #ifdef _DEBUG
 #undef _DEBUG
 #include <Python.h>
@@ -29,19 +30,31 @@
 #else
 #include <Python.h>
 #endif
+// The coordinates are kept in the step itself.  Each pointer is NULL or points to the matching value of the same
+// step, so steps can be copied without allocating.
 struct snapshot_plan_step
 {
 	snapshot_plan_step();
 	snapshot_plan_step(double* x, double* y, double* z, double* e, double* f, std::string action_type);
 	snapshot_plan_step(const snapshot_plan_step & source);
+	snapshot_plan_step& operator=(const snapshot_plan_step& source);
 	~snapshot_plan_step();
 	PyObject * to_py_object() const;
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
 	double *p_x;
 	double *p_y;
 	double *p_z;
 	double *p_e;
 	double *p_f;
 	std::string action;
+private:
+	void set_coordinates(const double* x, const double* y, const double* z, const double* e, const double* f);
+	double x_;
+	double y_;
+	double z_;
+	double e_;
+	double f_;
 };
 
 #endif
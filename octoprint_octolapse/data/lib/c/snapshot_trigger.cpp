@@ -0,0 +1,444 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "snapshot_trigger.h"
+#include "logging.h"
+#include "utilities.h"
+#include "threads.h"
+#if OCTOLAPSE_HAS_THREADS
+#include <chrono>
+#endif
+#include <cmath>
+
+snapshot_trigger_state::snapshot_trigger_state()
+{
+	reset();
+	current_increment = 0;
+	is_layer_change_wait = false;
+	is_height_change_wait = false;
+	layer = 0;
+	has_seconds_to_trigger = false;
+	seconds_to_trigger = 0;
+	has_trigger_start_time = false;
+	trigger_start_time = 0;
+	has_pause_time = false;
+	pause_time = 0;
+}
+
+void snapshot_trigger_state::reset()
+{
+	is_triggered = false;
+	trigger_type = snapshot_trigger_triggered_type_none;
+	is_in_position = false;
+	in_path_position = false;
+	is_waiting = false;
+	is_home_position_wait = false;
+	is_waiting_on_zhop = false;
+	is_waiting_on_extruder = false;
+	has_definite_position = false;
+	wait_reason = snapshot_trigger_wait_reason_none;
+	is_layer_change = false;
+	is_height_change = false;
+}
+
+bool snapshot_trigger_state::is_equal(const snapshot_trigger_state& state) const
+{
+	return is_triggered == state.is_triggered
+		&& trigger_type == state.trigger_type
+		&& is_in_position == state.is_in_position
+		&& in_path_position == state.in_path_position
+		&& is_waiting == state.is_waiting
+		&& is_home_position_wait == state.is_home_position_wait
+		&& is_waiting_on_zhop == state.is_waiting_on_zhop
+		&& is_waiting_on_extruder == state.is_waiting_on_extruder
+		&& has_definite_position == state.has_definite_position
+		&& wait_reason == state.wait_reason
+		&& current_increment == state.current_increment
+		&& is_layer_change_wait == state.is_layer_change_wait
+		&& is_layer_change == state.is_layer_change
+		&& is_height_change == state.is_height_change
+		&& is_height_change_wait == state.is_height_change_wait
+		&& layer == state.layer
+		&& has_seconds_to_trigger == state.has_seconds_to_trigger
+		&& (!has_seconds_to_trigger || seconds_to_trigger == state.seconds_to_trigger)
+		&& has_trigger_start_time == state.has_trigger_start_time
+		&& (!has_trigger_start_time || trigger_start_time == state.trigger_start_time)
+		&& has_pause_time == state.has_pause_time
+		&& (!has_pause_time || pause_time == state.pause_time);
+}
+
+static PyObject* optional_double_to_py_object(bool has_value, double value)
+{
+	if (!has_value)
+	{
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	return PyFloat_FromDouble(value);
+}
+
+PyObject* snapshot_trigger_state::to_py_tuple(int trigger_count) const
+{
+	PyObject* py_seconds_to_trigger = optional_double_to_py_object(has_seconds_to_trigger, seconds_to_trigger);
+	PyObject* py_trigger_start_time = optional_double_to_py_object(has_trigger_start_time, trigger_start_time);
+	PyObject* py_pause_time = optional_double_to_py_object(has_pause_time, pause_time);
+	if (py_seconds_to_trigger == NULL || py_trigger_start_time == NULL || py_pause_time == NULL)
+	{
+		Py_XDECREF(py_seconds_to_trigger);
+		Py_XDECREF(py_trigger_start_time);
+		Py_XDECREF(py_pause_time);
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, "snapshot_trigger_state.to_py_tuple: Unable to convert the timer values.");
+		return NULL;
+	}
+	// The N format steals the references to the timer values
+	PyObject* py_state = Py_BuildValue(
+		"(llllllllllllllllNNNl)",
+		(long int)(is_triggered ? 1 : 0),
+		(long int)trigger_type,
+		(long int)(is_in_position ? 1 : 0),
+		(long int)(in_path_position ? 1 : 0),
+		(long int)(is_waiting ? 1 : 0),
+		(long int)(is_home_position_wait ? 1 : 0),
+		(long int)(is_waiting_on_zhop ? 1 : 0),
+		(long int)(is_waiting_on_extruder ? 1 : 0),
+		(long int)(has_definite_position ? 1 : 0),
+		(long int)wait_reason,
+		(long int)current_increment,
+		(long int)(is_layer_change_wait ? 1 : 0),
+		(long int)(is_layer_change ? 1 : 0),
+		(long int)(is_height_change ? 1 : 0),
+		(long int)(is_height_change_wait ? 1 : 0),
+		layer,
+		py_seconds_to_trigger,
+		py_trigger_start_time,
+		py_pause_time,
+		(long int)trigger_count
+	);
+	if (py_state == NULL)
+	{
+		octolapse_log_exception(octolapse_log::GCODE_POSITION, "snapshot_trigger_state.to_py_tuple: Unable to convert the trigger state to a PyObject tuple via Py_BuildValue.");
+		return NULL;
+	}
+	return py_state;
+}
+
+snapshot_trigger::snapshot_trigger()
+{
+	trigger_count_ = 0;
+	snapshots_enabled_ = true;
+	are_all_extruder_triggers_ignored_ = true;
+}
+
+snapshot_trigger::snapshot_trigger(const snapshot_trigger_args& args)
+{
+	args_ = args;
+	trigger_count_ = 0;
+	snapshots_enabled_ = true;
+	are_all_extruder_triggers_ignored_ = true;
+	for (int index = 0; index < NUM_EXTRUDER_TRIGGERS; index++)
+	{
+		if (args_.extruder_triggers[index] != extruder_trigger_option_ignore)
+			are_all_extruder_triggers_ignored_ = false;
+	}
+}
+
+snapshot_trigger::snapshot_trigger(const snapshot_trigger& source)
+{
+	// Private copy constructor - you can't copy this class
+}
+
+snapshot_trigger::~snapshot_trigger()
+{
+}
+
+const snapshot_trigger_state& snapshot_trigger::get_state() const
+{
+	return state_;
+}
+
+int snapshot_trigger::get_trigger_count() const
+{
+	return trigger_count_;
+}
+
+double snapshot_trigger::get_time()
+{
+#if OCTOLAPSE_HAS_THREADS
+	return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+#elif defined(_WIN32)
+	// The file time counts 100 ns intervals since 1601.
+	FILETIME file_time;
+	GetSystemTimeAsFileTime(&file_time);
+	const unsigned long long intervals =
+		(static_cast<unsigned long long>(file_time.dwHighDateTime) << 32) | file_time.dwLowDateTime;
+	return static_cast<double>(intervals - 116444736000000000ULL) / 10000000.0;
+#else
+	timeval now;
+	gettimeofday(&now, NULL);
+	return static_cast<double>(now.tv_sec) + static_cast<double>(now.tv_usec) / 1000000.0;
+#endif
+}
+
+void snapshot_trigger::pause()
+{
+	// Like trigger.py, pausing changes the current state without creating a new one.
+	state_.has_pause_time = true;
+	state_.pause_time = get_time();
+	octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Timer trigger paused.");
+}
+
+void snapshot_trigger::resume()
+{
+	if (!state_.has_pause_time || !state_.has_trigger_start_time)
+		return;
+	// Keep the proper interval if the print is paused
+	state_.trigger_start_time = get_time() - (state_.pause_time - state_.trigger_start_time);
+	state_.has_pause_time = false;
+	state_.pause_time = 0;
+}
+
+bool snapshot_trigger::update(const position* p_current_pos, const position* p_previous_pos)
+{
+	const parsed_command& command = p_current_pos->command;
+	if (command.opcode == gcode_opcode_octolapse)
+	{
+		if (command.has_octolapse_parameter("STOP-SNAPSHOTS"))
+			snapshots_enabled_ = false;
+		else if (command.has_octolapse_parameter("START-SNAPSHOTS"))
+			snapshots_enabled_ = true;
+	}
+
+	snapshot_trigger_state state = state_;
+	state.reset();
+	switch (args_.type)
+	{
+	case snapshot_trigger_type_layer:
+		update_layer(p_current_pos, p_previous_pos, state);
+		break;
+	case snapshot_trigger_type_timer:
+		update_timer(p_current_pos, p_previous_pos, state);
+		break;
+	case snapshot_trigger_type_gcode:
+		update_gcode(p_current_pos, p_previous_pos, state);
+		break;
+	}
+	// A trigger that fires is always reported, even if it fired on the previous update too, so that the trigger count
+	// stays current.
+	const bool has_changed = state.is_triggered || !state.is_equal(state_);
+	state_ = state;
+	return has_changed;
+}
+
+void snapshot_trigger::update_layer(const position* p_current_pos, const position* p_previous_pos, snapshot_trigger_state& state)
+{
+	// The layer trigger starts every update with a fresh wait state, only the layer tracking carries over.
+	state.is_layer_change_wait = state_.is_layer_change_wait;
+	state.is_height_change_wait = state_.is_height_change_wait;
+	if (!p_previous_pos->has_definite_position)
+		return;
+	state.has_definite_position = true;
+	// Position restrictions are handled in python, so the position is always in position if it is in bounds.
+	state.is_in_position = p_previous_pos->is_in_bounds;
+
+	const bool has_height_increment = args_.height_increment > 0;
+	if (
+		has_height_increment
+		&& p_current_pos->is_layer_change
+		&& (state.current_increment * args_.height_increment < p_previous_pos->height || state.current_increment == 0)
+	)
+	{
+		const int new_increment = static_cast<int>(ceil(p_previous_pos->height / args_.height_increment));
+		if (new_increment <= state.current_increment)
+		{
+			OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::WARNING,
+				"Layer Trigger - Warning - The height increment was expected to increase, but it did not. Height Increment:"
+				<< args_.height_increment << ", Current Increment:" << state.current_increment << ", Calculated Increment:" << new_increment);
+		}
+		else
+		{
+			// if the current increment is below one here, set it to one.  This is not normal, but can happen
+			// if extrusion is detected at height 0.
+			state.current_increment = new_increment < 1 ? 1 : new_increment;
+			state.is_height_change = true;
+			OCTOLAPSE_LOG(octolapse_log::GCODE_POSITION, octolapse_log::INFO,
+				"Layer Trigger - Height Increment:" << args_.height_increment << ", Current Increment:" << state.current_increment
+				<< ", Height: " << p_previous_pos->height);
+		}
+	}
+
+	if (has_height_increment)
+	{
+		if (state.is_height_change)
+		{
+			state.is_height_change_wait = true;
+			state.is_waiting = true;
+		}
+	}
+	else if (p_current_pos->is_layer_change)
+	{
+		state.layer = p_previous_pos->layer;
+		state.is_layer_change_wait = true;
+		state.is_layer_change = true;
+		state.is_waiting = true;
+	}
+
+	if (!state.is_height_change_wait && !state.is_layer_change_wait && !state.is_waiting)
+		return;
+	state.is_waiting = true;
+	if (try_trigger(p_previous_pos, state))
+	{
+		state.is_layer_change_wait = false;
+		state.is_layer_change = false;
+		state.is_height_change_wait = false;
+	}
+}
+
+void snapshot_trigger::update_timer(const position* p_current_pos, const position* p_previous_pos, snapshot_trigger_state& state)
+{
+	if (!p_previous_pos->has_definite_position)
+		return;
+	state.has_definite_position = true;
+	// record the current time to keep things consistant
+	const double current_time = get_time();
+	state.is_in_position = p_previous_pos->is_in_bounds;
+	if (!state.has_trigger_start_time)
+	{
+		state.has_trigger_start_time = true;
+		state.trigger_start_time = current_time;
+	}
+	// Round to the nearest second, away from zero, like utility.round_to
+	const double seconds_to_trigger = args_.interval_seconds - (current_time - state.trigger_start_time);
+	state.has_seconds_to_trigger = true;
+	state.seconds_to_trigger = static_cast<double>(static_cast<long>(seconds_to_trigger + (seconds_to_trigger >= 0 ? 0.5 : -0.5)));
+	if (state.seconds_to_trigger > 0)
+		return;
+	state.is_waiting = true;
+	if (try_trigger(p_previous_pos, state))
+	{
+		state.has_trigger_start_time = false;
+		state.trigger_start_time = 0;
+		octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "TimerTrigger - Triggering.");
+	}
+}
+
+void snapshot_trigger::update_gcode(const position* p_current_pos, const position* p_previous_pos, snapshot_trigger_state& state)
+{
+	// The gcode trigger keeps waiting from one update to the next until the snapshot is taken.
+	state.is_waiting = state_.is_waiting;
+	state.is_waiting_on_zhop = state_.is_waiting_on_zhop;
+	state.is_waiting_on_extruder = state_.is_waiting_on_extruder;
+	if (!p_previous_pos->has_definite_position)
+		return;
+	state.has_definite_position = true;
+	state.is_in_position = p_previous_pos->is_in_bounds;
+	if (p_current_pos->command.is_snapshot_command(args_.snapshot_command_gcode))
+	{
+		if (snapshots_enabled_)
+			state.is_waiting = true;
+		else
+			octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "GcodeTrigger - A snapshot was detected, but snapshots were disabled via @Octolapse stop-snapshots.");
+	}
+	if (state.is_waiting)
+		try_trigger(p_previous_pos, state);
+}
+
+bool snapshot_trigger::try_trigger(const position* p_previous_pos, snapshot_trigger_state& state)
+{
+	if (!is_extruder_triggered(p_previous_pos))
+	{
+		state.is_waiting_on_extruder = true;
+		state.wait_reason = snapshot_trigger_wait_reason_extruder;
+		return false;
+	}
+	if (args_.require_zhop && !p_previous_pos->is_zhop)
+	{
+		state.is_waiting_on_zhop = true;
+		state.wait_reason = snapshot_trigger_wait_reason_zhop;
+		return false;
+	}
+	if (!p_previous_pos->is_in_bounds)
+	{
+		state.wait_reason = snapshot_trigger_wait_reason_out_of_bounds;
+		return false;
+	}
+	if (!state.is_in_position && !state.in_path_position)
+	{
+		state.wait_reason = snapshot_trigger_wait_reason_position;
+		return false;
+	}
+	if (p_previous_pos->last_extrusion_height_null || p_previous_pos->last_extrusion_height == 0)
+	{
+		state.wait_reason = snapshot_trigger_wait_reason_no_extrusion;
+		return false;
+	}
+	if (utilities::less_than(p_previous_pos->z, p_previous_pos->last_extrusion_height))
+	{
+		// The extruder is below the last extrusion height, do not take a snapshot else we might run into the part!
+		state.wait_reason = snapshot_trigger_wait_reason_below_last_extrusion;
+		return false;
+	}
+	if (!snapshots_enabled_)
+	{
+		state.wait_reason = snapshot_trigger_wait_reason_snapshots_disabled;
+		return false;
+	}
+	trigger_count_++;
+	state.is_triggered = true;
+	if (state.is_in_position)
+		state.trigger_type = snapshot_trigger_triggered_type_default;
+	else if (state.in_path_position)
+		state.trigger_type = snapshot_trigger_triggered_type_in_path;
+	state.is_waiting = false;
+	state.is_waiting_on_zhop = false;
+	state.is_waiting_on_extruder = false;
+	return true;
+}
+
+bool snapshot_trigger::is_extruder_triggered(const position* p_pos) const
+{
+	if (!args_.extruder_state_requirements_enabled)
+		return true;
+	const extruder& current_extruder = p_pos->get_current_extruder();
+	const bool extruder_states[NUM_EXTRUDER_TRIGGERS] = {
+		current_extruder.is_extruding_start,
+		current_extruder.is_extruding,
+		current_extruder.is_primed,
+		current_extruder.is_retracting_start,
+		current_extruder.is_retracting,
+		current_extruder.is_partially_retracted,
+		current_extruder.is_retracted,
+		current_extruder.is_deretracting_start,
+		current_extruder.is_deretracting,
+		current_extruder.is_deretracted
+	};
+	// Any forbidden state prevents triggering, else at least one required state must be present.
+	bool has_required_state = false;
+	for (int index = 0; index < NUM_EXTRUDER_TRIGGERS; index++)
+	{
+		if (!extruder_states[index])
+			continue;
+		if (args_.extruder_triggers[index] == extruder_trigger_option_forbidden)
+			return false;
+		if (args_.extruder_triggers[index] == extruder_trigger_option_required)
+			has_required_state = true;
+	}
+	return has_required_state || are_all_extruder_triggers_ignored_;
+}
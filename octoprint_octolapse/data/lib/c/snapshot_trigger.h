@@ -0,0 +1,182 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef SNAPSHOT_TRIGGER_H
+#define SNAPSHOT_TRIGGER_H
+#include <string>
+#include "position.h"
+
+// The real-time triggers from trigger.py, evaluated natively against the gcode_position of the live print so that
+// python doesn't need to run a state machine for every line of gcode.  Position restrictions are computed in python,
+// so the native triggers are only used when there are none.
+enum snapshot_trigger_type
+{
+	snapshot_trigger_type_layer,
+	snapshot_trigger_type_timer,
+	snapshot_trigger_type_gcode
+};
+
+// Matches Triggers.TRIGGER_TYPE_DEFAULT and Triggers.TRIGGER_TYPE_IN_PATH in trigger.py
+enum snapshot_trigger_triggered_type
+{
+	snapshot_trigger_triggered_type_none,
+	snapshot_trigger_triggered_type_default,
+	snapshot_trigger_triggered_type_in_path
+};
+
+// Why a trigger that wants to take a snapshot is still waiting.
+enum snapshot_trigger_wait_reason
+{
+	snapshot_trigger_wait_reason_none,
+	snapshot_trigger_wait_reason_extruder,
+	snapshot_trigger_wait_reason_zhop,
+	snapshot_trigger_wait_reason_out_of_bounds,
+	snapshot_trigger_wait_reason_position,
+	snapshot_trigger_wait_reason_no_extrusion,
+	snapshot_trigger_wait_reason_below_last_extrusion,
+	snapshot_trigger_wait_reason_snapshots_disabled
+};
+
+// To trigger on an extruder state use required, to prevent triggering use forbidden.
+enum extruder_trigger_option
+{
+	extruder_trigger_option_ignore,
+	extruder_trigger_option_required,
+	extruder_trigger_option_forbidden
+};
+
+// The order of the extruder states in snapshot_trigger_args::extruder_triggers, which matches ExtruderTriggers in
+// position.py.
+#define NUM_EXTRUDER_TRIGGERS 10
+enum extruder_trigger
+{
+	extruder_trigger_on_extruding_start,
+	extruder_trigger_on_extruding,
+	extruder_trigger_on_primed,
+	extruder_trigger_on_retracting_start,
+	extruder_trigger_on_retracting,
+	extruder_trigger_on_partially_retracted,
+	extruder_trigger_on_retracted,
+	extruder_trigger_on_deretracting_start,
+	extruder_trigger_on_deretracting,
+	extruder_trigger_on_deretracted
+};
+
+struct snapshot_trigger_args
+{
+	snapshot_trigger_args()
+	{
+		type = snapshot_trigger_type_layer;
+		require_zhop = false;
+		height_increment = 0;
+		interval_seconds = 0;
+		extruder_state_requirements_enabled = false;
+		for (int index = 0; index < NUM_EXTRUDER_TRIGGERS; index++)
+			extruder_triggers[index] = extruder_trigger_option_ignore;
+	}
+	snapshot_trigger_type type;
+	bool require_zhop;
+	// Layer triggers only.  0 to trigger on every layer change.
+	double height_increment;
+	// Timer triggers only
+	double interval_seconds;
+	// Gcode triggers only.  The parsed alternative snapshot command, which may be empty.
+	std::string snapshot_command_gcode;
+	bool extruder_state_requirements_enabled;
+	extruder_trigger_option extruder_triggers[NUM_EXTRUDER_TRIGGERS];
+};
+
+/**
+ * \brief The same fields as the trigger states in trigger.py.  Fields that don't apply to a trigger type keep their
+ * defaults.
+ */
+struct snapshot_trigger_state
+{
+	snapshot_trigger_state();
+	void reset();
+	bool is_equal(const snapshot_trigger_state& state) const;
+	/**
+	 * \brief Returns a tuple of every field, in declaration order, followed by the trigger count.
+	 */
+	PyObject* to_py_tuple(int trigger_count) const;
+	bool is_triggered;
+	snapshot_trigger_triggered_type trigger_type;
+	bool is_in_position;
+	bool in_path_position;
+	bool is_waiting;
+	// No trigger waits for the home position, as in trigger.py, so this is always false.
+	bool is_home_position_wait;
+	bool is_waiting_on_zhop;
+	bool is_waiting_on_extruder;
+	bool has_definite_position;
+	snapshot_trigger_wait_reason wait_reason;
+	// Layer trigger
+	int current_increment;
+	bool is_layer_change_wait;
+	// Only set on the update that finds the layer change, and cleared if the trigger fires during that update.
+	bool is_layer_change;
+	bool is_height_change;
+	bool is_height_change_wait;
+	long layer;
+	// Timer trigger.  Times are in seconds since the epoch, like time.time().
+	bool has_seconds_to_trigger;
+	double seconds_to_trigger;
+	bool has_trigger_start_time;
+	double trigger_start_time;
+	bool has_pause_time;
+	double pause_time;
+};
+
+class snapshot_trigger
+{
+public:
+	snapshot_trigger();
+	snapshot_trigger(const snapshot_trigger_args& args);
+	~snapshot_trigger();
+	/**
+	 * \brief Evaluates the trigger after the live gcode_position has processed a line.  Like trigger.py, the previous
+	 * position is the one that would be snapshotted.
+	 * \return true if the state changed or the trigger fired.
+	 */
+	bool update(const position* p_current_pos, const position* p_previous_pos);
+	void pause();
+	void resume();
+	const snapshot_trigger_state& get_state() const;
+	int get_trigger_count() const;
+private:
+	snapshot_trigger(const snapshot_trigger& source);
+	void update_layer(const position* p_current_pos, const position* p_previous_pos, snapshot_trigger_state& state);
+	void update_timer(const position* p_current_pos, const position* p_previous_pos, snapshot_trigger_state& state);
+	void update_gcode(const position* p_current_pos, const position* p_previous_pos, snapshot_trigger_state& state);
+	/**
+	 * \brief Checks the conditions every trigger type must meet before a snapshot can be taken.
+	 * \return true if the trigger fired, else the wait reason is set.
+	 */
+	bool try_trigger(const position* p_previous_pos, snapshot_trigger_state& state);
+	bool is_extruder_triggered(const position* p_pos) const;
+	static double get_time();
+	snapshot_trigger_args args_;
+	snapshot_trigger_state state_;
+	int trigger_count_;
+	bool snapshots_enabled_;
+	bool are_all_extruder_triggers_ignored_;
+};
+#endif
@@ -23,15 +23,20 @@
 #include <time.h>
 #include <vector>
 #include <sstream>
+#include <typeinfo>
 #include "logging.h"
 #include "utilities.h"
-#include <iostream>
-#include <fstream>
+#include "gcode_file_source.h"
+#include "snapshot_plan_cache.h"
+
+// The number of snapshot plans held before they are handed to the snapshot plans callback.
+static const unsigned int snapshot_plan_stream_batch_size = 16;
 
 stabilization::stabilization(gcode_position_args position_args, stabilization_args stab_args, pythonGetCoordinatesCallback get_coordinates_callback, PyObject* py_get_coordinates_callback, pythonProgressCallback progress_callback, PyObject* py_progress_callback)
 {
 	std::string errors_;
-	if (py_get_coordinates_callback != NULL && py_progress_callback != NULL)
+	// The progress callback is optional when the progress is published through a processing_progress.
+	if (py_get_coordinates_callback != NULL)
 	{
 		has_python_callbacks_ = true;
 	}
@@ -49,14 +54,30 @@ stabilization::stabilization(gcode_position_args position_args, stabilization_ar
 	is_running_ = true;
 	gcode_parser_ = NULL;
 	gcode_position_ = NULL;
+	p_trace_writer_ = NULL;
+	p_stats_ = &stats_;
+	p_progress_ = NULL;
+	py_progress_ = NULL;
+	p_toolpath_ = NULL;
+	py_toolpath_ = NULL;
+	p_plan_queue_ = NULL;
+	planned_gcode_number_ = 0;
+	write_checkpoints_ = false;
+	native_snapshot_plans_callback_ = NULL;
+	snapshot_plans_callback_ = NULL;
+	py_on_snapshot_plans_received = NULL;
+	streamed_snapshot_plan_count_ = 0;
+	keep_streamed_snapshot_plans_ = false;
 	file_size_ = 0;
 	lines_processed_ = 0;
 	gcodes_processed_ = 0;
 	file_position_ = 0;
+	source_position_ = 0;
 	missed_snapshots_ = 0;
 	stabilization_x_ = 0;
 	stabilization_y_ = 0;
 	snapshots_enabled_ = true;
+	is_estimating_time_ = false;
 
 }
 
@@ -71,10 +92,25 @@ stabilization::stabilization()
 	is_running_ = true;
 	gcode_parser_ = NULL;
 	gcode_position_ = NULL;
+	p_trace_writer_ = NULL;
+	p_stats_ = &stats_;
+	p_progress_ = NULL;
+	py_progress_ = NULL;
+	p_toolpath_ = NULL;
+	py_toolpath_ = NULL;
+	p_plan_queue_ = NULL;
+	planned_gcode_number_ = 0;
+	write_checkpoints_ = false;
+	native_snapshot_plans_callback_ = NULL;
+	snapshot_plans_callback_ = NULL;
+	py_on_snapshot_plans_received = NULL;
+	streamed_snapshot_plan_count_ = 0;
+	keep_streamed_snapshot_plans_ = false;
 	file_size_ = 0;
 	lines_processed_ = 0;
 	gcodes_processed_ = 0;
 	file_position_ = 0;
+	source_position_ = 0;
 	missed_snapshots_ = 0;
 	stabilization_x_ = 0;
 	stabilization_y_ = 0;
@@ -82,6 +118,7 @@ stabilization::stabilization()
 	py_on_progress_received = NULL;
 	py_get_snapshot_position_callback = NULL;
 	snapshots_enabled_ = true;
+	is_estimating_time_ = false;
 	
 }
 
@@ -96,10 +133,25 @@ stabilization::stabilization(gcode_position_args position_args, stabilization_ar
 	is_running_ = true;
 	gcode_parser_ = NULL;
 	gcode_position_ = NULL;
+	p_trace_writer_ = NULL;
+	p_stats_ = &stats_;
+	p_progress_ = NULL;
+	py_progress_ = NULL;
+	p_toolpath_ = NULL;
+	py_toolpath_ = NULL;
+	p_plan_queue_ = NULL;
+	planned_gcode_number_ = 0;
+	write_checkpoints_ = false;
+	native_snapshot_plans_callback_ = NULL;
+	snapshot_plans_callback_ = NULL;
+	py_on_snapshot_plans_received = NULL;
+	streamed_snapshot_plan_count_ = 0;
+	keep_streamed_snapshot_plans_ = false;
 	file_size_ = 0;
 	lines_processed_ = 0;
 	gcodes_processed_ = 0;
 	file_position_ = 0;
+	source_position_ = 0;
 	missed_snapshots_ = 0;
 	stabilization_x_ = 0;
 	stabilization_y_ = 0;
@@ -107,6 +159,7 @@ stabilization::stabilization(gcode_position_args position_args, stabilization_ar
 	py_on_progress_received = NULL;
 	py_get_snapshot_position_callback = NULL;
 	snapshots_enabled_ = true;
+	is_estimating_time_ = false;
 	
 }
 
@@ -120,6 +173,11 @@ stabilization::~stabilization()
 {
 	delete_gcode_parser();
 	delete_gcode_position();
+	if (p_trace_writer_ != NULL)
+	{
+		delete p_trace_writer_;
+		p_trace_writer_ = NULL;
+	}
 		
 	if (gcode_position_ != NULL)
 	{
@@ -130,6 +188,12 @@ stabilization::~stabilization()
 		Py_XDECREF(py_on_progress_received);
 	if (py_get_snapshot_position_callback != NULL)
 		Py_XDECREF(py_get_snapshot_position_callback);
+	if (py_on_snapshot_plans_received != NULL)
+		Py_XDECREF(py_on_snapshot_plans_received);
+	if (py_progress_ != NULL)
+		Py_XDECREF(py_progress_);
+	if (py_toolpath_ != NULL)
+		Py_XDECREF(py_toolpath_);
 }
 
 void stabilization::delete_gcode_parser()
@@ -150,28 +214,511 @@ void stabilization::delete_gcode_position()
 	}
 }
 
-long stabilization::get_file_size(const std::string& file_path)
+double stabilization::get_time_seconds()
 {
-	// Todo:  Fix this function.  This is a pretty weak implementation :(
-	std::ifstream file(file_path.c_str(), std::ios::in | std::ios::binary);
-	const long l = (long)file.tellg();
-	file.seekg(0, std::ios::end);
-	const long m = (long)file.tellg();
-	file.close();
-	return (m - l);
+	return static_cast<double>(processing_stats_get_time_ns()) / 1000000000.0;
 }
 
 double stabilization::get_next_update_time() const
 {
-	return clock() + (stabilization_args_.notification_period_seconds * CLOCKS_PER_SEC);
+	return get_time_seconds() + stabilization_args_.notification_period_seconds;
 }
 
-double stabilization::get_time_elapsed(double start_clock, double end_clock)
+double stabilization::get_time_elapsed(double start_seconds, double end_seconds)
 {
-	return static_cast<double>(end_clock - start_clock) / CLOCKS_PER_SEC;
+	return end_seconds - start_seconds;
+}
+
+void stabilization::update_progress(double start_seconds, double& next_update_time)
+{
+	const double current_seconds = get_time_seconds();
+	if (publish_progress(get_time_elapsed(start_seconds, current_seconds)))
+	{
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "A cancel was requested, stopping processing.");
+		is_running_ = false;
+		return;
+	}
+	if (next_update_time < current_seconds)
+	{
+		long bytesRemaining = file_size_ - source_position_;
+		double percentProgress = static_cast<double>(source_position_) / static_cast<double>(file_size_)*100.0;
+		double secondsElapsed = get_time_elapsed(start_seconds, current_seconds);
+		double bytesPerSecond = static_cast<double>(source_position_) / secondsElapsed;
+		double secondsToComplete = bytesRemaining / bytesPerSecond;
+		//std::cout << "stabilization::process_file - notifying progress...";
+		
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
+			"Stabilization Progress - Bytes Remaining: " << bytesRemaining <<
+			", Seconds Elapsed: " << utilities::to_string(secondsElapsed) << ", Percent Progress:" << utilities::to_string(percentProgress));
+		notify_progress(percentProgress, secondsElapsed, secondsToComplete, gcodes_processed_,
+			lines_processed_);
+		//std::cout << "Complete.\r\n";
+		next_update_time = get_next_update_time();
+	}
+}
+
+bool stabilization::publish_progress(const double seconds_elapsed)
+{
+	bool is_cancel_requested = false;
+	if (p_progress_ != NULL)
+	{
+		p_progress_->update(source_position_, file_size_, lines_processed_, gcodes_processed_, get_snapshot_plan_count(), seconds_elapsed, *p_stats_);
+		is_cancel_requested = p_progress_->is_cancel_requested();
+	}
+	// Followers share the pass, so they see the leader's counters and any of them can cancel it.
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		stabilization* p_follower = *it;
+		if (p_follower->p_progress_ == NULL)
+			continue;
+		p_follower->p_progress_->update(source_position_, file_size_, lines_processed_, gcodes_processed_, p_follower->get_snapshot_plan_count(), seconds_elapsed, *p_stats_);
+		if (p_follower->p_progress_->is_cancel_requested())
+			is_cancel_requested = true;
+	}
+	return is_cancel_requested;
+}
+
+void stabilization::start_progress()
+{
+	if (p_progress_ != NULL)
+		p_progress_->start();
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		if ((*it)->p_progress_ != NULL)
+			(*it)->p_progress_->start();
+	}
+}
+
+void stabilization::finish_progress(const double seconds_elapsed)
+{
+	publish_progress(seconds_elapsed);
+	if (p_progress_ != NULL)
+		p_progress_->finish(!is_running_);
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		if ((*it)->p_progress_ != NULL)
+			(*it)->p_progress_->finish(!is_running_);
+	}
+}
+
+long stabilization::get_snapshot_plan_count() const
+{
+	return static_cast<long>(streamed_snapshot_plan_count_) + static_cast<long>(p_snapshot_plans_.size());
+}
+
+bool stabilization::get_trace_file_path(std::string& trace_file_path, std::string& trace_key) const
+{
+	if (stabilization_args_.trace_directory.empty())
+		return false;
+	// Only the position settings affect the trace, so it can be replayed with any trigger or stabilization settings.
+	binary_writer settings;
+	gcode_position_args_.serialize(settings);
+	if (!snapshot_plan_cache::create_key(stabilization_args_.file_path, settings.get_buffer(), trace_key))
+	{
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "Unable to create a position trace key, the position trace will not be used.");
+		return false;
+	}
+	char file_name[32];
+	sprintf(file_name, "%016llx.trace", binary_hash(trace_key.c_str(), trace_key.size()));
+	trace_file_path = stabilization_args_.trace_directory;
+	if (trace_file_path[trace_file_path.size() - 1] != '/' && trace_file_path[trace_file_path.size() - 1] != '\\')
+		trace_file_path += "/";
+	trace_file_path += file_name;
+	return true;
+}
+
+bool stabilization::is_checkpoint_index_missing(std::string& index_file_path, std::string& index_key) const
+{
+	if (stabilization_args_.checkpoint_directory.empty())
+		return false;
+	if (!position_checkpoint_index::create_key(stabilization_args_.file_path, gcode_position_args_, index_key))
+	{
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "Unable to create a position checkpoint key, the checkpoint index will not be saved.");
+		return false;
+	}
+	index_file_path = position_checkpoint_index::get_index_file_path(stabilization_args_.checkpoint_directory, index_key);
+	FILE* p_file = fopen(index_file_path.c_str(), "rb");
+	if (p_file == NULL)
+		return true;
+	fclose(p_file);
+	return false;
+}
+
+bool stabilization::try_replay_trace(const std::string& trace_file_path, const std::string& trace_key, double start_seconds, double& next_update_time)
+{
+	position_trace_reader reader;
+	if (!reader.open(trace_file_path, trace_key))
+		return false;
+	OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Replaying the position trace at: " << trace_file_path);
+	const int records_before_clock_check = 2000;
+	file_size_ = reader.get_file_size();
+	position_trace_record record;
+	int records_read = 0;
+	// Positions are read straight into the next slot, which is only made current if the record has a position.
+	while (is_running_ && reader.read_next(record, *gcode_position_->get_next_position_ptr()))
+	{
+		if ((record.flags & position_trace_has_position) != 0)
+		{
+			gcode_position_->advance_position();
+			update_time_estimates_all(gcode_position_->get_current_position_ptr(), gcode_position_->get_previous_position_ptr());
+			record_toolpath_all(gcode_position_->get_current_position_ptr(), gcode_position_->get_previous_position_ptr());
+		}
+		lines_processed_ = record.lines_processed;
+		gcodes_processed_ = record.gcodes_processed;
+		file_position_ = record.file_position;
+		source_position_ = file_position_;
+		snapshots_enabled_ = (record.flags & position_trace_snapshots_enabled) != 0;
+		if ((record.flags & position_trace_has_gcode) != 0)
+		{
+			stats_.next_line();
+			if (snapshots_enabled_)
+			{
+				processing_stage_timer timer(&stats_, processing_stage_snapshot_plan);
+				process_pos_all(gcode_position_->get_current_position_ptr(), gcode_position_->get_previous_position_ptr(), (record.flags & position_trace_found_command) != 0);
+			}
+			if ((++records_read % records_before_clock_check) == 0)
+			{
+				update_progress(start_seconds, next_update_time);
+			}
+		}
+	}
+	if (is_running_ && !reader.is_complete())
+	{
+		// The header was valid, so the file was damaged after it was written.  The results can't be trusted.
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, "Unable to read the position trace at: " << trace_file_path);
+	}
+	gcode_position_->get_gcode_comment_processor()->set_comment_process_type(reader.get_final_comment_process_type());
+	reader.close();
+	return true;
+}
+
+void stabilization::finish_trace()
+{
+	if (is_running_)
+	{
+		// The final record holds the totals for lines that were not traced, like trailing comments.
+		position_trace_record record;
+		record.flags = snapshots_enabled_ ? position_trace_snapshots_enabled : 0;
+		record.lines_processed = lines_processed_;
+		record.gcodes_processed = gcodes_processed_;
+		record.file_position = file_position_;
+		p_trace_writer_->write(record, NULL);
+		if (p_trace_writer_->close(gcode_position_->get_gcode_comment_processor()->get_comment_process_type(), file_position_))
+			OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Saved the position trace.");
+		else
+			OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "Unable to save the position trace.");
+	}
+	else
+	{
+		p_trace_writer_->discard();
+	}
+	delete p_trace_writer_;
+	p_trace_writer_ = NULL;
+}
+
+void stabilization::finish_checkpoints(const std::string& index_file_path, const std::string& index_key)
+{
+	// A cancelled run didn't see every layer
+	if (is_running_)
+	{
+		if (checkpoints_.save(index_file_path, index_key))
+			OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Saved " << checkpoints_.size() << " position checkpoints.");
+		else
+			OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "Unable to save the position checkpoints.");
+	}
+	checkpoints_.clear();
+	write_checkpoints_ = false;
+}
+
+void stabilization_args::serialize(binary_writer& writer) const
+{
+	// The file path, progress notifications and threading don't change the results.
+	writer.write_double(height_increment);
+	writer.write_bool(x_stabilization_disabled);
+	writer.write_bool(y_stabilization_disabled);
+	writer.write_double(x_coordinate);
+	writer.write_double(y_coordinate);
+	writer.write_string(cache_key);
+}
+
+void stabilization::serialize_settings(binary_writer& writer) const
+{
+	gcode_position_args_.serialize(writer);
+	stabilization_args_.serialize(writer);
+}
+
+bool stabilization::try_load_cached_results(std::string& key, stabilization_results& results)
+{
+	key = "";
+	keep_streamed_snapshot_plans_ = false;
+	if (stabilization_args_.cache_directory.empty())
+		return false;
+	const double start_seconds = get_time_seconds();
+	snapshot_plan_cache cache(stabilization_args_.cache_directory);
+	binary_writer settings;
+	serialize_settings(settings);
+	if (!cache.create_key(stabilization_args_.file_path, settings.get_buffer(), key))
+	{
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "Unable to create a snapshot plan cache key, the cache will not be used.");
+		key = "";
+		return false;
+	}
+	std::string index_file_path;
+	std::string index_key;
+	// Loading the results would skip the parse that creates the checkpoint index
+	// Loading the results would also skip the parse that records the toolpath
+	if (p_toolpath_ != NULL || is_checkpoint_index_missing(index_file_path, index_key) || !cache.try_load(key, results))
+	{
+		// The streamed plans are needed to save the results
+		keep_streamed_snapshot_plans_ = true;
+		return false;
+	}
+	stream_cached_results(results);
+	results.seconds_elapsed = get_time_elapsed(start_seconds, get_time_seconds());
+	if (p_progress_ != NULL)
+	{
+		p_progress_->start();
+		p_progress_->update(0, 0, results.lines_processed, results.gcodes_processed,
+			static_cast<long>(results.streamed_snapshot_plan_count) + static_cast<long>(results.snapshot_plans.size()),
+			results.seconds_elapsed, stats_);
+		p_progress_->finish(false);
+	}
+	OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO,
+		"Loaded " << results.snapshot_plans.size() << " snapshot plans from the cache in " << results.seconds_elapsed << " seconds.");
+	return true;
+}
+
+void stabilization::save_cached_results(const std::string& key, const stabilization_results& results)
+{
+	// Don't cache the results of a cancelled run
+	if (key.empty() || !is_running_)
+		return;
+	snapshot_plan_cache cache(stabilization_args_.cache_directory);
+	if (cache.save(key, results))
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Saved the snapshot plans to the cache.");
+	else
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "Unable to save the snapshot plans to the cache.");
 }
 
 stabilization_results stabilization::process_file()
+{
+	std::string key;
+	stabilization_results results;
+	if (try_load_cached_results(key, results))
+		return results;
+	results = process_gcode_file();
+	save_cached_results(key, results);
+	return results;
+}
+
+std::vector<stabilization_results> stabilization::process_file_multiple(std::vector<stabilization*>& stabilizations)
+{
+	std::vector<stabilization_results> results(stabilizations.size());
+	std::vector<std::string> keys(stabilizations.size());
+	// Stabilizations that read the same file with the same position settings see exactly the same positions, so
+	// the first one of each group parses the file and the rest only receive its positions.
+	std::vector<std::string> group_keys;
+	std::vector<std::vector<unsigned int> > groups;
+	for (unsigned int index = 0; index < stabilizations.size(); index++)
+	{
+		stabilization* p_stabilization = stabilizations[index];
+		if (p_stabilization->try_load_cached_results(keys[index], results[index]))
+			continue;
+		binary_writer group_key;
+		group_key.write_string(p_stabilization->stabilization_args_.file_path);
+		// Some stabilizations copy the height increment into the position settings, so the type must match too.
+		group_key.write_string(typeid(*p_stabilization).name());
+		group_key.write_double(p_stabilization->stabilization_args_.height_increment);
+		p_stabilization->gcode_position_args_.serialize(group_key);
+		unsigned int group_index = 0;
+		while (group_index < group_keys.size() && group_keys[group_index] != group_key.get_buffer())
+			group_index++;
+		if (group_index == group_keys.size())
+		{
+			group_keys.push_back(group_key.get_buffer());
+			groups.push_back(std::vector<unsigned int>());
+		}
+		groups[group_index].push_back(index);
+	}
+
+	for (unsigned int group_index = 0; group_index < groups.size(); group_index++)
+	{
+		const std::vector<unsigned int>& group = groups[group_index];
+		stabilization* p_leader = stabilizations[group[0]];
+		p_leader->followers_.clear();
+		for (unsigned int index = 1; index < group.size(); index++)
+			p_leader->followers_.push_back(stabilizations[group[index]]);
+		if (group.size() > 1)
+			OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Processing " << group.size() << " stabilizations with a single pass through: " << p_leader->stabilization_args_.file_path);
+
+		results[group[0]] = p_leader->process_gcode_file();
+		p_leader->save_cached_results(keys[group[0]], results[group[0]]);
+		for (unsigned int index = 1; index < group.size(); index++)
+		{
+			stabilization* p_follower = stabilizations[group[index]];
+			results[group[index]] = p_leader->follower_results_[index - 1];
+			// The follower's results are only complete if the shared pass was.
+			p_follower->is_running_ = p_leader->is_running_;
+			p_follower->save_cached_results(keys[group[index]], results[group[index]]);
+		}
+		p_leader->followers_.clear();
+		p_leader->follower_results_.clear();
+	}
+	return results;
+}
+
+void stabilization::process_pos_all(position* p_current_pos, position* p_previous_pos, bool found_command)
+{
+	process_pos(p_current_pos, p_previous_pos, found_command);
+	stream_snapshot_plans(false);
+	if (p_plan_queue_ != NULL)
+		p_plan_queue_->set_planned_gcode_number(planned_gcode_number_);
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		stabilization* p_follower = *it;
+		p_follower->process_pos(p_current_pos, p_previous_pos, found_command);
+		p_follower->stream_snapshot_plans(false);
+		if (p_follower->p_plan_queue_ != NULL)
+			p_follower->p_plan_queue_->set_planned_gcode_number(p_follower->planned_gcode_number_);
+		// A follower can only cancel by failing to receive its plans, which cancels the shared pass.
+		if (!p_follower->is_running_)
+			is_running_ = false;
+	}
+}
+
+void stabilization::update_time_estimates_all(const position* p_current_pos, const position* p_previous_pos)
+{
+	if (is_estimating_time_)
+	{
+		processing_stage_timer timer(&stats_, processing_stage_time_estimation);
+		time_estimator_.update(p_current_pos, p_previous_pos);
+	}
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		stabilization* p_follower = *it;
+		if (p_follower->is_estimating_time_)
+		{
+			processing_stage_timer timer(&stats_, processing_stage_time_estimation);
+			p_follower->time_estimator_.update(p_current_pos, p_previous_pos);
+		}
+	}
+}
+
+void stabilization::record_toolpath_all(const position* p_current_pos, const position* p_previous_pos)
+{
+	if (p_toolpath_ != NULL)
+		p_toolpath_->add(p_current_pos, p_previous_pos);
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		stabilization* p_follower = *it;
+		if (p_follower->p_toolpath_ != NULL)
+			p_follower->p_toolpath_->add(p_current_pos, p_previous_pos);
+	}
+}
+
+void stabilization::finish_toolpath_all()
+{
+	if (p_toolpath_ != NULL)
+		p_toolpath_->finish();
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		if ((*it)->p_toolpath_ != NULL)
+			(*it)->p_toolpath_->finish();
+	}
+}
+
+void stabilization::set_snapshot_plans_callback(snapshotPlansCallback callback)
+{
+	native_snapshot_plans_callback_ = callback;
+}
+
+void stabilization::set_snapshot_plans_callback(pythonSnapshotPlansCallback callback, PyObject* py_snapshot_plans_callback)
+{
+	if (py_on_snapshot_plans_received != NULL)
+		Py_XDECREF(py_on_snapshot_plans_received);
+	snapshot_plans_callback_ = callback;
+	py_on_snapshot_plans_received = py_snapshot_plans_callback;
+}
+
+void stabilization::set_progress(processing_progress* p_progress, PyObject* py_progress)
+{
+	if (py_progress_ != NULL)
+		Py_XDECREF(py_progress_);
+	p_progress_ = p_progress;
+	py_progress_ = py_progress;
+}
+
+void stabilization::set_toolpath(toolpath_recorder* p_toolpath, PyObject* py_toolpath)
+{
+	if (py_toolpath_ != NULL)
+		Py_XDECREF(py_toolpath_);
+	p_toolpath_ = p_toolpath;
+	py_toolpath_ = py_toolpath;
+}
+
+void stabilization::set_plan_queue(snapshot_plan_queue* p_queue)
+{
+	p_plan_queue_ = p_queue;
+}
+
+bool stabilization::has_snapshot_plans_callback() const
+{
+	return p_plan_queue_ != NULL || native_snapshot_plans_callback_ != NULL || (snapshot_plans_callback_ != NULL && py_on_snapshot_plans_received != NULL);
+}
+
+void stabilization::stream_snapshot_plans(const bool all)
+{
+	p_stats_->track_buffered_snapshot_plans(static_cast<long long>(p_snapshot_plans_.size()));
+	// The plan queue takes every plan as soon as it is complete, so that the print never waits on a batch.
+	if (
+		p_snapshot_plans_.empty() ||
+		(!all && p_plan_queue_ == NULL && p_snapshot_plans_.size() < snapshot_plan_stream_batch_size) ||
+		!has_snapshot_plans_callback()
+	)
+		return;
+	if (keep_streamed_snapshot_plans_)
+	{
+		for (std::vector<snapshot_plan>::const_iterator it = p_snapshot_plans_.begin(); it != p_snapshot_plans_.end(); ++it)
+			(*it).serialize(streamed_snapshot_plans_);
+	}
+	bool success = true;
+	const int plan_count = static_cast<int>(p_snapshot_plans_.size());
+	if (p_plan_queue_ != NULL)
+		p_plan_queue_->push(p_snapshot_plans_);
+	else if (native_snapshot_plans_callback_ != NULL)
+		success = native_snapshot_plans_callback_(p_snapshot_plans_);
+	else
+	{
+		processing_stage_timer timer(p_stats_, processing_stage_python_callbacks, true);
+		success = snapshot_plans_callback_(py_on_snapshot_plans_received, p_snapshot_plans_);
+	}
+	if (!success)
+	{
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, "The snapshot plans callback failed, cancelling processing.");
+		is_running_ = false;
+	}
+	streamed_snapshot_plan_count_ += plan_count;
+	p_snapshot_plans_.clear();
+}
+
+void stabilization::stream_cached_results(stabilization_results& results)
+{
+	if (!has_snapshot_plans_callback())
+		return;
+	// The cache entry already exists, so there is no need to keep copies.
+	keep_streamed_snapshot_plans_ = false;
+	std::vector<snapshot_plan> cached_plans;
+	cached_plans.swap(results.snapshot_plans);
+	for (std::vector<snapshot_plan>::iterator it = cached_plans.begin(); it != cached_plans.end(); ++it)
+	{
+		p_snapshot_plans_.push_back(std::move(*it));
+		stream_snapshot_plans(false);
+	}
+	stream_snapshot_plans(true);
+	results.streamed_snapshot_plan_count = streamed_snapshot_plan_count_;
+}
+
+stabilization_results stabilization::process_gcode_file()
 {
 	if (gcode_parser_ != NULL)
 	{
@@ -187,37 +734,94 @@ stabilization_results stabilization::process_file()
 	// Construct the gcode_parser and gcode_position objects.
 	gcode_parser_ = new gcode_parser();
 	gcode_position_ = new gcode_position(gcode_position_args_);
-	// Create a stringstream we can use for messaging.
-	std::stringstream stream;
+	// Followers use the leader's position instead of tracking their own.
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		stabilization* p_follower = *it;
+		p_follower->delete_gcode_parser();
+		p_follower->delete_gcode_position();
+		p_follower->on_processing_start();
+		p_follower->gcode_position_ = gcode_position_;
+		p_follower->p_stats_ = &stats_;
+		p_follower->is_running_ = true;
+		p_follower->planned_gcode_number_ = 0;
+	}
+	stats_.clear();
+	input_error_.clear();
+	gcode_position_->set_processing_stats(&stats_);
+	// Buffer log records until processing is complete, so that python is only called once per batch.
+	octolapse_log_buffer_begin();
 	// Make sure snapshots are enabled at the start of the process.
 	snapshots_enabled_ = true;
 	int read_lines_before_clock_check = 2000;
+	planned_gcode_number_ = 0;
 	//std::cout << "stabilization::process_file - Processing file.\r\n";
-	stream << "Stabilizing file at: " << stabilization_args_.file_path;
-	octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
+	OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Stabilizing file at: " << stabilization_args_.file_path);
 	is_running_ = true;
+	start_progress();
+	// The run may have been cancelled before it started
+	if (publish_progress(0))
+		is_running_ = false;
 	
 	double next_update_time = get_next_update_time();
-	const clock_t start_clock = clock();
-	file_size_ = get_file_size(stabilization_args_.file_path);
-	std::ifstream gcodeFile(stabilization_args_.file_path.c_str());
-	std::string line;
+	const double start_seconds = get_time_seconds();
+	std::string trace_file_path;
+	std::string trace_key;
+	const bool use_trace = get_trace_file_path(trace_file_path, trace_key);
+	std::string index_file_path;
+	std::string index_key;
+	// The checkpoints are only created while parsing, so the trace isn't replayed until the index exists.
+	write_checkpoints_ = is_checkpoint_index_missing(index_file_path, index_key);
+	checkpoints_.clear();
+	gcode_file_source gcode_file;
+	const char* p_line;
+	size_t line_length;
 	int lines_with_no_commands = 0;
-	if (gcodeFile.is_open())
+	if (use_trace && !write_checkpoints_ && try_replay_trace(trace_file_path, trace_key, start_seconds, next_update_time))
+	{
+		on_processing_complete();
+		followers_processing_complete();
+	}
+	else if (gcode_file.open(stabilization_args_.file_path))
 	{
-		stream.clear();
-		stream.str("");
-		stream << "Opened file for reading.  File Size: " << utilities::to_string(file_size_);
-		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
+		file_size_ = gcode_file.get_file_size();
+		const char* p_decoder_name = gcode_file.get_decoder_name();
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO,
+			"Opened file for reading.  File Size: " << utilities::to_string(file_size_) <<
+			(gcode_file.is_memory_mapped() ? ", Memory Mapped." : ", Buffered.") <<
+			(p_decoder_name != NULL ? "  Decoding " : "") << (p_decoder_name != NULL ? p_decoder_name : ""));
+		if (use_trace)
+		{
+			p_trace_writer_ = new position_trace_writer();
+			if (!p_trace_writer_->open(trace_file_path, trace_key, file_size_))
+			{
+				OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "Unable to create the position trace at: " << trace_file_path);
+				delete p_trace_writer_;
+				p_trace_writer_ = NULL;
+			}
+		}
 		parsed_command cmd;
+		bool has_line;
+		bool found_command;
 		// Communicate every second
-		while (std::getline(gcodeFile, line) && is_running_)
+		while (is_running_)
 		{
-			file_position_ = static_cast<long>(gcodeFile.tellg());
+			stats_.next_line();
+			{
+				processing_stage_timer timer(&stats_, processing_stage_read);
+				has_line = gcode_file.get_next_line(p_line, line_length);
+			}
+			if (!has_line)
+				break;
+			file_position_ = gcode_file.get_file_position();
+			source_position_ = gcode_file.get_source_position();
 			lines_processed_++;
 
 			cmd.clear();
-			bool found_command = gcode_parser_->try_parse_gcode(line.c_str(), cmd);
+			{
+				processing_stage_timer timer(&stats_, processing_stage_parse);
+				found_command = gcode_parser_->try_parse_gcode(p_line, line_length, cmd);
+			}
 			bool has_gcode = false;
 			if (cmd.gcode.length() > 0)
 			{
@@ -229,33 +833,33 @@ stabilization_results stabilization::process_file()
 				lines_with_no_commands++;
 			}
 			// If the current command is an @Octolapse command, check the paramaters and update any state as necessary
-			if (cmd.command == "@OCTOLAPSE")
+			if (cmd.opcode == gcode_opcode_octolapse)
 			{
 				if (cmd.parameters.size() == 1)
 				{
-					parsed_command_parameter param = cmd.parameters[0];
-					if (param.name == "STOP-SNAPSHOTS")
+					const parsed_command_parameter& param = cmd.parameters[0];
+					if (param.string_value == "STOP-SNAPSHOTS")
 					{
 						if (snapshots_enabled_)
 						{
-							octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "@Octolapse command detected - STOP-SNAPSHOTS - snapshots stopped.");
+							OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "@Octolapse command detected - STOP-SNAPSHOTS - snapshots stopped.");
 							snapshots_enabled_ = false;
 						}
 						else
 						{
-							octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "@Octolapse command detected - STOP-SNAPSHOTS - snapshots already stopped, command ignored.");
+							OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "@Octolapse command detected - STOP-SNAPSHOTS - snapshots already stopped, command ignored.");
 						}
 					}
-					else if (param.name == "START-SNAPSHOTS")
+					else if (param.string_value == "START-SNAPSHOTS")
 					{
 						if (!snapshots_enabled_)
 						{
-							octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "@Octolapse command detected - START-SNAPSHOTS - snapshots started.");
+							OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "@Octolapse command detected - START-SNAPSHOTS - snapshots started.");
 							snapshots_enabled_ = true;
 						}
 						else
 						{
-							octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "@Octolapse command detected - START-SNAPSHOTS - snapshots already started, command ignored.");
+							OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "@Octolapse command detected - START-SNAPSHOTS - snapshots already started, command ignored.");
 						}
 					}
 
@@ -265,77 +869,137 @@ stabilization_results stabilization::process_file()
 			// Always process the command through the printer, even if no command is found
 			// This is important so that comments can be analyzed
 			//std::cout << "stabilization::process_file - updating position...";
-			gcode_position_->update(cmd, lines_processed_, gcodes_processed_, file_position_);
+			{
+				processing_stage_timer timer(&stats_, processing_stage_position_update);
+				gcode_position_->update(cmd, lines_processed_, gcodes_processed_, file_position_);
+			}
+			if (!cmd.is_empty)
+			{
+				update_time_estimates_all(gcode_position_->get_current_position_ptr(), gcode_position_->get_previous_position_ptr());
+				record_toolpath_all(gcode_position_->get_current_position_ptr(), gcode_position_->get_previous_position_ptr());
+			}
+			if (write_checkpoints_ && !cmd.is_empty && gcode_position_->get_current_position_ptr()->is_layer_change)
+			{
+				checkpoints_.add(*gcode_position_, file_position_, lines_processed_, gcodes_processed_);
+			}
+
+			if (p_trace_writer_ != NULL && (has_gcode || !cmd.is_empty))
+			{
+				position_trace_record record;
+				record.flags = (has_gcode ? position_trace_has_gcode : 0) |
+					(found_command ? position_trace_found_command : 0) |
+					(!cmd.is_empty ? position_trace_has_position : 0) |
+					(snapshots_enabled_ ? position_trace_snapshots_enabled : 0);
+				record.lines_processed = lines_processed_;
+				record.gcodes_processed = gcodes_processed_;
+				record.file_position = file_position_;
+				p_trace_writer_->write(record, gcode_position_->get_current_position_ptr());
+			}
 			
 			// Only continue to process if we've found a command.
 			if (has_gcode)
 			{
 				if (snapshots_enabled_)
 				{
-					process_pos(gcode_position_->get_current_position_ptr(), gcode_position_->get_previous_position_ptr(), found_command);
+					processing_stage_timer timer(&stats_, processing_stage_snapshot_plan);
+					process_pos_all(gcode_position_->get_current_position_ptr(), gcode_position_->get_previous_position_ptr(), found_command);
 				}
 
-				if ( (lines_processed_ % read_lines_before_clock_check) == 0 && next_update_time < clock())
+				if ( (lines_processed_ % read_lines_before_clock_check) == 0)
 				{
-					// ToDo: tellg does not do what I think it does, but why?
-					long bytesRemaining = file_size_ - file_position_;
-					double percentProgress = static_cast<double>(file_position_) / static_cast<double>(file_size_)*100.0;
-					double secondsElapsed = get_time_elapsed(start_clock, clock());
-					double bytesPerSecond = static_cast<double>(file_position_) / secondsElapsed;
-					double secondsToComplete = bytesRemaining / bytesPerSecond;
-					//std::cout << "stabilization::process_file - notifying progress...";
-					
-					stream.clear();
-					stream.str("");
-					stream << "Stabilization Progress - Bytes Remaining: " << bytesRemaining <<
-						", Seconds Elapsed: " << utilities::to_string(secondsElapsed) << ", Percent Progress:" << utilities::to_string(percentProgress);
-					octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG, stream.str());
-					notify_progress(percentProgress, secondsElapsed, secondsToComplete, gcodes_processed_,
-						lines_processed_);
-					//std::cout << "Complete.\r\n";
-					next_update_time = get_next_update_time();
+					update_progress(start_seconds, next_update_time);
 				}
 			}
 			
 		}
-		// deallocate the parsed_command object
-		
-		gcodeFile.close();
+		if (gcode_file.has_error())
+		{
+			// The plans would only cover part of the file
+			input_error_ = gcode_file.get_error();
+			OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, "Unable to decode the gcode file: " << input_error_);
+		}
+		gcode_file.close();
+		if (p_trace_writer_ != NULL)
+		{
+			finish_trace();
+		}
+		if (write_checkpoints_)
+		{
+			finish_checkpoints(index_file_path, index_key);
+		}
 		on_processing_complete();
+		followers_processing_complete();
 		//std::cout << "stabilization::process_file - Completed Processing file.\r\n";
 	}
 	else
 	{
-		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, "Unable to open the gcode file for processing.");
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, "Unable to open the gcode file for processing.");
+	}
+	// The toolpath is finished first, so it can be read as soon as the progress is complete.
+	finish_toolpath_all();
+	const double total_seconds = get_time_elapsed(start_seconds, get_time_seconds());
+	finish_progress(total_seconds);
+	stabilization_results results = get_results(total_seconds);
+	follower_results_.clear();
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		stabilization* p_follower = *it;
+		p_follower->lines_processed_ = lines_processed_;
+		p_follower->gcodes_processed_ = gcodes_processed_;
+		p_follower->file_position_ = file_position_;
+		p_follower->file_size_ = file_size_;
+		p_follower->source_position_ = source_position_;
+		p_follower->input_error_ = input_error_;
+		p_follower->snapshots_enabled_ = snapshots_enabled_;
+		follower_results_.push_back(p_follower->get_results(total_seconds));
+		// The position and the stats belong to the leader
+		p_follower->gcode_position_ = NULL;
+		p_follower->p_stats_ = &p_follower->stats_;
+	}
+	octolapse_log_buffer_end();
+	return results;
+}
+
+void stabilization::followers_processing_complete()
+{
+	for (std::vector<stabilization*>::iterator it = followers_.begin(); it != followers_.end(); ++it)
+	{
+		stabilization* p_follower = *it;
+		p_follower->is_running_ = is_running_;
+		p_follower->on_processing_complete();
 	}
-	const clock_t end_clock = clock();
-	const double total_seconds = static_cast<double>(end_clock - start_clock) / CLOCKS_PER_SEC;
+}
+
+stabilization_results stabilization::get_results(double total_seconds)
+{
+	stream_snapshot_plans(true);
 	stabilization_results results;
 	results.seconds_elapsed = total_seconds;
+	results.streamed_snapshot_plan_count = streamed_snapshot_plan_count_;
+	streamed_snapshot_plans_.take_buffer(results.streamed_snapshot_plans);
 	results.gcodes_processed = gcodes_processed_;
 	results.lines_processed = lines_processed_;
 	results.quality_issues = get_quality_issues();
-	results.snapshot_plans = p_snapshot_plans_;
+	// The run is over, so the plans are handed over instead of copied.
+	results.snapshot_plans.swap(p_snapshot_plans_);
 	results.processing_issues = get_processing_issues();
 	// Calculate number of missed layers
 	results.missed_layer_count = missed_snapshots_;
-	stream.clear();
-	stream.str("");
-	stream << "Completed file processing\r\n";
-	stream << "\tBytes Processed      : " << file_position_ << "\r\n";
-	stream << "\tLines Processed      : " << lines_processed_ << "\r\n";
-	stream << "\tSnapshots Found      : " << results.snapshot_plans.size() << "\r\n";
-	stream << "\tTotal Seconds        : " << total_seconds << "\r\n";
-	octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
+	results.stats = *p_stats_;
+	OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO,
+		"Completed file processing\r\n" <<
+		"\tBytes Processed      : " << file_position_ << "\r\n" <<
+		"\tLines Processed      : " << lines_processed_ << "\r\n" <<
+		"\tSnapshots Found      : " << results.streamed_snapshot_plan_count + results.snapshot_plans.size() << "\r\n" <<
+		"\tTotal Seconds        : " << total_seconds << "\r\n");
 	// Try to avoid logging the snapshot plan if it definitely won't be logged
 	if (octolapse_may_be_logged(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG))
 	{
-		stream.clear();
-		stream.str("");
+		std::stringstream stream;
 		stream << "Snapshot Plan Details:";
 		for (unsigned int index = 0; index < results.snapshot_plans.size(); index++)
 		{
-			snapshot_plan pPlan = results.snapshot_plans[index];
+			const snapshot_plan& pPlan = results.snapshot_plans[index];
 			std::string gcode = pPlan.start_command.gcode;
 			std::string feature_type_description = "unknown";
 			if (pPlan.triggering_command_feature_type != feature_type_unknown_feature)
@@ -370,8 +1034,9 @@ stabilization_results stabilization::process_file()
 void stabilization::notify_progress(const double percent_progress, const double seconds_elapsed, const double seconds_to_complete,
 	const int gcodes_processed, const int lines_processed)
 {
-	if (has_python_callbacks_)
+	if (has_python_callbacks_ && py_on_progress_received != NULL)
 	{
+		processing_stage_timer timer(p_stats_, processing_stage_python_callbacks, true);
 		is_running_ = progress_callback_(py_on_progress_received, percent_progress, seconds_elapsed, seconds_to_complete, gcodes_processed, lines_processed);
 	}
 	else if(native_progress_callback_ != NULL)
@@ -449,6 +1114,18 @@ std::vector<stabilization_processing_issue> stabilization::get_processing_issues
 		issues.push_back(issue);
 	}
 
+	if (!input_error_.empty())
+	{
+		stabilization_processing_issue issue;
+		issue.description = "Unable to decode the gcode file: " + input_error_;
+		issue.issue_type = stabilization_processing_issue_type_gcode_decode_error;
+		replacement_token decode_error_token;
+		decode_error_token.key = "decode_error";
+		decode_error_token.value = input_error_;
+		issue.replacement_tokens.push_back(decode_error_token);
+		issues.push_back(issue);
+	}
+
 	if (pos.is_metric_null)
 	{
 		// Add issue for metri  null
@@ -476,8 +1153,9 @@ void stabilization::get_next_xy_coordinates(double &x, double&y) const
 	if (has_python_callbacks_)
 	{
 		//std::cout << "calling python...";
+		processing_stage_timer timer(p_stats_, processing_stage_python_callbacks, true);
 		if (!_get_coordinates_callback(py_get_snapshot_position_callback, stabilization_args_.x_coordinate, stabilization_args_.y_coordinate, x_ret, y_ret))
-			octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Failed dto get snapshot coordinates.");
+			OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Failed dto get snapshot coordinates.");
 	}
 	else
 	{
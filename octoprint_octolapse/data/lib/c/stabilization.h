@@ -28,6 +28,14 @@
 #include "gcode_position.h"
 #include "snapshot_plan.h"
 #include "stabilization_results.h"
+#include "binary_stream.h"
+#include "position_trace.h"
+#include "processing_stats.h"
+#include "processing_progress.h"
+#include "position_checkpoint.h"
+#include "print_time_estimator.h"
+#include "toolpath_recorder.h"
+#include "snapshot_plan_queue.h"
 #include <vector>
 #ifdef _DEBUG
 #undef _DEBUG
@@ -54,6 +62,10 @@ public:
 		y_coordinate = 0;
 		x_stabilization_disabled = false;
 		y_stabilization_disabled = false;
+		cache_directory = "";
+		cache_key = "";
+		trace_directory = "";
+		checkpoint_directory = "";
 	}
 	~stabilization_args()
 	{
@@ -75,9 +87,35 @@ public:
 
 	double x_coordinate;
 	double y_coordinate;
+	/**
+	 * \brief If not empty, results are saved to and loaded from a snapshot_plan_cache in this directory.
+	 */
+	std::string cache_directory;
+	/**
+	 * \brief Added to the snapshot plan cache key.  Used for settings that only python knows about, like the ones
+	 * that decide the snapshot position.
+	 */
+	std::string cache_key;
+	/**
+	 * \brief If not empty, the tracked position is saved to a position trace in this directory after the file is
+	 * parsed, and later runs replay the trace instead of parsing the file again.  The trace only depends on the file
+	 * and the gcode_position_args, so it can be replayed after the trigger or stabilization settings change.
+	 */
+	std::string trace_directory;
+	/**
+	 * \brief If not empty, a position_checkpoint_index is saved in this directory after the file is parsed.  The
+	 * snapshot plan cache and position traces are not used until the index exists, since they skip parsing.
+	 */
+	std::string checkpoint_directory;
+	/**
+	 * \brief Writes the settings that affect the stabilization results.
+	 */
+	void serialize(binary_writer& writer) const;
 };
 typedef bool(*progressCallback)(double percentComplete, double seconds_elapsed, double estimatedSecondsRemaining, long gcodesProcessed, long linesProcessed);
 typedef bool(*pythonProgressCallback)(PyObject* python_progress_callback, double percentComplete, double seconds_elapsed, double estimatedSecondsRemaining, int gcodesProcessed, int linesProcessed);
+typedef bool(*snapshotPlansCallback)(std::vector<snapshot_plan>& plans);
+typedef bool(*pythonSnapshotPlansCallback)(PyObject* py_snapshot_plans_callback, std::vector<snapshot_plan>& plans);
 typedef bool(*pythonGetCoordinatesCallback)(PyObject* py_get_snapshot_position_callback, double x_initial, double y_initial, double& x_result, double& y_result);
 
 class stabilization
@@ -90,12 +128,123 @@ public:
 	// constructor for use when being called from python
 	stabilization(gcode_position_args position_args, stabilization_args args, pythonGetCoordinatesCallback get_coordinates, PyObject* py_get_coordinates_callback, pythonProgressCallback progress, PyObject* py_progress_callback);
 	virtual ~stabilization();
+	/**
+	 * \brief Processes the gcode file, or loads the results from the snapshot plan cache if it is enabled and the
+	 * file and settings have not changed.
+	 */
 	stabilization_results process_file();
+	/**
+	 * \brief Processes several stabilizations, parsing each file only once for all of the stabilizations that share
+	 * the file and position settings.  Only the first stabilization of each group reports progress and can cancel.
+	 * \return The results of each stabilization, in the same order.
+	 */
+	static std::vector<stabilization_results> process_file_multiple(std::vector<stabilization*>& stabilizations);
+	/**
+	 * \brief Hands the snapshot plans to the callback in small batches while processing instead of returning them all
+	 * in the results, so that only a few plans are held in memory.  Processing is cancelled if the callback returns
+	 * false.  The python callback must be a new reference, which is released by the stabilization.
+	 */
+	void set_snapshot_plans_callback(snapshotPlansCallback callback);
+	void set_snapshot_plans_callback(pythonSnapshotPlansCallback callback, PyObject* py_snapshot_plans_callback);
+	/**
+	 * \brief Publishes the progress while processing and stops processing once a cancel is requested, without calling
+	 * python.  py_progress may be NULL, otherwise it must be a new reference, which is released by the stabilization.
+	 */
+	void set_progress(processing_progress* p_progress, PyObject* py_progress);
+	/**
+	 * \brief Records the decimated toolpath while processing.  The snapshot plan cache is not loaded while a toolpath
+	 * is recorded, since it only holds the plans.  py_toolpath must be a new reference, which is released by the
+	 * stabilization.
+	 */
+	void set_toolpath(toolpath_recorder* p_toolpath, PyObject* py_toolpath);
+	/**
+	 * \brief Pushes each snapshot plan to the queue as soon as it is complete instead of returning it in the results or
+	 * sending it to the snapshot plans callback, and publishes the planned gcode number after each position.  The queue
+	 * is not owned by the stabilization, and is not finished by it.
+	 */
+	void set_plan_queue(snapshot_plan_queue* p_queue);
 	
 private:
+	stabilization_results process_gcode_file();
+	stabilization_results get_results(double total_seconds);
+	bool try_load_cached_results(std::string& key, stabilization_results& results);
+	void save_cached_results(const std::string& key, const stabilization_results& results);
+	/**
+	 * \brief Sends the position to this stabilization and to every follower.
+	 */
+	void process_pos_all(position* p_current_pos, position* p_previous_pos, bool found_command);
+	/**
+	 * \brief Adds the move to the print time of this stabilization and of every follower that estimates it.  This
+	 * happens for every position, even while snapshots are stopped.
+	 */
+	void update_time_estimates_all(const position* p_current_pos, const position* p_previous_pos);
+	/**
+	 * \brief Adds the move to the toolpath of this stabilization and of every follower that records one.
+	 */
+	void record_toolpath_all(const position* p_current_pos, const position* p_previous_pos);
+	void finish_toolpath_all();
+	void followers_processing_complete();
+	bool has_snapshot_plans_callback() const;
+	/**
+	 * \brief Sends the pending snapshot plans to the snapshot plans callback, if there is one.
+	 * \param all If false, the plans are only sent once a full batch is pending.
+	 */
+	void stream_snapshot_plans(bool all);
+	/**
+	 * \brief Sends plans that were loaded from the snapshot plan cache to the snapshot plans callback.
+	 */
+	void stream_cached_results(stabilization_results& results);
+	snapshotPlansCallback native_snapshot_plans_callback_;
+	pythonSnapshotPlansCallback snapshot_plans_callback_;
+	PyObject* py_on_snapshot_plans_received;
+	int streamed_snapshot_plan_count_;
+	/**
+	 * \brief Serialized copies of the streamed plans, kept only when the results will be saved to the cache.
+	 */
+	binary_writer streamed_snapshot_plans_;
+	bool keep_streamed_snapshot_plans_;
+	/**
+	 * \brief Stabilizations that receive the positions tracked by this one instead of parsing the file themselves.
+	 */
+	std::vector<stabilization*> followers_;
+	std::vector<stabilization_results> follower_results_;
 	stabilization(const stabilization &source); // don't copy me!
+	/**
+	 * \brief Gets the monotonic time in seconds, which is only meaningful relative to another call.
+	 */
+	static double get_time_seconds();
 	double get_next_update_time() const;
-	static double get_time_elapsed(double start_clock, double end_clock);
+	static double get_time_elapsed(double start_seconds, double end_seconds);
+	void update_progress(double start_seconds, double& next_update_time);
+	/**
+	 * \brief Publishes the counters to the progress of this stabilization and of every follower.
+	 * \return true if any of them requested a cancel.
+	 */
+	bool publish_progress(double seconds_elapsed);
+	void start_progress();
+	void finish_progress(double seconds_elapsed);
+	long get_snapshot_plan_count() const;
+	/**
+	 * \brief Processes every position stored in the trace as if the gcode file had been parsed.
+	 * \return false if the trace doesn't exist or doesn't match the file and position settings.
+	 */
+	bool try_replay_trace(const std::string& trace_file_path, const std::string& trace_key, double start_seconds, double& next_update_time);
+	/**
+	 * \brief Writes the final record and closes the trace, or deletes it if processing was cancelled.
+	 */
+	void finish_trace();
+	bool get_trace_file_path(std::string& trace_file_path, std::string& trace_key) const;
+	/**
+	 * \brief True if a checkpoint index was requested but hasn't been saved for this file and position settings yet.
+	 */
+	bool is_checkpoint_index_missing(std::string& index_file_path, std::string& index_key) const;
+	/**
+	 * \brief Saves the checkpoint index, unless processing was cancelled.
+	 */
+	void finish_checkpoints(const std::string& index_file_path, const std::string& index_key);
+	bool write_checkpoints_;
+	position_checkpoint_index checkpoints_;
+	position_trace_writer* p_trace_writer_;
 	bool has_python_callbacks_;
 	// False if return < 0, else true
 	pythonGetCoordinatesCallback _get_coordinates_callback;
@@ -109,6 +258,12 @@ private:
 
 	PyObject* py_on_progress_received;
 	PyObject* py_get_snapshot_position_callback;
+	processing_stats stats_;
+	processing_progress* p_progress_;
+	PyObject* py_progress_;
+	toolpath_recorder* p_toolpath_;
+	PyObject* py_toolpath_;
+	snapshot_plan_queue* p_plan_queue_;
 	
 protected:
 	/**
@@ -125,6 +280,11 @@ protected:
 	virtual std::vector<stabilization_processing_issue> get_internal_processing_issues();
 	virtual std::vector<stabilization_quality_issue> get_quality_issues();
 	virtual std::vector<stabilization_processing_issue> get_processing_issues();
+	/**
+	 * \brief Writes every setting that affects the results, which is used to create the snapshot plan cache key.
+	 * Derived classes must call this and then write their own settings.
+	 */
+	virtual void serialize_settings(binary_writer& writer) const;
 	std::vector<snapshot_plan> p_snapshot_plans_;
 	bool is_running_;
 	gcode_position_args gcode_position_args_;
@@ -133,12 +293,27 @@ protected:
 	pythonProgressCallback progress_callback_;
 	gcode_position* gcode_position_;
 	gcode_parser* gcode_parser_;
-	long get_file_size(const std::string& file_path);
 	long file_size_;
 	int lines_processed_;
 	int gcodes_processed_;
 	long file_position_;
+	// The bytes read from the gcode file, which is less than file_position_ for compressed files
+	long source_position_;
+	// Why the gcode file could not be decoded, empty if there was no error
+	std::string input_error_;
 	int missed_snapshots_;
 	bool snapshots_enabled_;
+	/**
+	 * \brief Every plan that triggers before this gcode number has been added.  Stabilizations that can tell set it
+	 * while processing; otherwise nothing is known to be planned until processing is complete.
+	 */
+	long planned_gcode_number_;
+	// Set by stabilizations that need the estimated print time of each position.
+	bool is_estimating_time_;
+	print_time_estimator time_estimator_;
+	/**
+	 * \brief The stats of the pass that is running.  A follower records into the stats of its leader.
+	 */
+	processing_stats* p_stats_;
 };
 #endif
\ No newline at end of file
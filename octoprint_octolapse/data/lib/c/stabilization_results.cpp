@@ -28,10 +28,13 @@ stabilization_results::stabilization_results()
 	lines_processed = 0;
 	missed_layer_count = 0;
 	seconds_elapsed = 0;
+	streamed_snapshot_plan_count = 0;
 }
 
 PyObject* stabilization_results::to_py_object()
 {
+	const long long start_ns = processing_stats_get_time_ns();
+	stats.add_call(processing_stage_result_conversion);
 	PyObject * py_snapshot_plans = snapshot_plan::build_py_object(snapshot_plans);
 	if (py_snapshot_plans == NULL)
 	{
@@ -86,7 +89,17 @@ PyObject* stabilization_results::to_py_object()
 		Py_DECREF(py_issue);
 	}
 	
-	PyObject * py_results = Py_BuildValue("(O,d,l,l,l,O,O)", py_snapshot_plans, seconds_elapsed, gcodes_processed, lines_processed, missed_layer_count, py_quality_issues, py_processing_issues);
+	// The stats are converted last so that they include the rest of the conversion
+	stats.add_time(processing_stage_result_conversion, processing_stats_get_time_ns() - start_ns);
+	PyObject * py_stats = stats.to_py_object();
+	if (py_stats == NULL)
+	{
+		Py_DECREF(py_snapshot_plans);
+		Py_DECREF(py_quality_issues);
+		Py_DECREF(py_processing_issues);
+		return NULL;
+	}
+	PyObject * py_results = Py_BuildValue("(O,d,l,l,l,O,O,N)", py_snapshot_plans, seconds_elapsed, gcodes_processed, lines_processed, missed_layer_count, py_quality_issues, py_processing_issues, py_stats);
 	if (py_results == NULL)
 	{
 		std::string message = "stabilization_results.to_py_object - Unable to create a Tuple from the snapshot plan list.";
@@ -153,3 +166,122 @@ PyObject * stabilization_processing_issue::to_py_object() const
 	}
 	return py_results;
 }
+
+void stabilization_results::serialize(binary_writer& writer) const
+{
+	writer.write_long(gcodes_processed);
+	writer.write_long(lines_processed);
+	writer.write_int(missed_layer_count);
+	writer.write_int(streamed_snapshot_plan_count + static_cast<int>(snapshot_plans.size()));
+	writer.write_bytes(streamed_snapshot_plans.c_str(), streamed_snapshot_plans.size());
+	for (unsigned int index = 0; index < snapshot_plans.size(); index++)
+	{
+		snapshot_plans[index].serialize(writer);
+	}
+	writer.write_int(static_cast<int>(quality_issues.size()));
+	for (unsigned int index = 0; index < quality_issues.size(); index++)
+	{
+		quality_issues[index].serialize(writer);
+	}
+	writer.write_int(static_cast<int>(processing_issues.size()));
+	for (unsigned int index = 0; index < processing_issues.size(); index++)
+	{
+		processing_issues[index].serialize(writer);
+	}
+}
+
+bool stabilization_results::deserialize(binary_reader& reader)
+{
+	int num_plans;
+	if (
+		!reader.read_long(gcodes_processed) ||
+		!reader.read_long(lines_processed) ||
+		!reader.read_int(missed_layer_count) ||
+		!reader.read_count(num_plans)
+	)
+	{
+		return false;
+	}
+	snapshot_plans.clear();
+	snapshot_plans.resize(num_plans);
+	streamed_snapshot_plan_count = 0;
+	streamed_snapshot_plans.clear();
+	for (int index = 0; index < num_plans; index++)
+	{
+		if (!snapshot_plans[index].deserialize(reader))
+			return false;
+	}
+
+	int num_quality_issues;
+	if (!reader.read_count(num_quality_issues))
+		return false;
+	quality_issues.clear();
+	quality_issues.resize(num_quality_issues);
+	for (int index = 0; index < num_quality_issues; index++)
+	{
+		if (!quality_issues[index].deserialize(reader))
+			return false;
+	}
+
+	int num_processing_issues;
+	if (!reader.read_count(num_processing_issues))
+		return false;
+	processing_issues.clear();
+	processing_issues.resize(num_processing_issues);
+	for (int index = 0; index < num_processing_issues; index++)
+	{
+		if (!processing_issues[index].deserialize(reader))
+			return false;
+	}
+	return true;
+}
+
+void stabilization_quality_issue::serialize(binary_writer& writer) const
+{
+	writer.write_string(description);
+	writer.write_int(static_cast<int>(issue_type));
+}
+
+bool stabilization_quality_issue::deserialize(binary_reader& reader)
+{
+	int issue_type_value;
+	if (!reader.read_string(description) || !reader.read_int(issue_type_value))
+		return false;
+	issue_type = static_cast<stabilization_quality_issue_type>(issue_type_value);
+	return true;
+}
+
+void stabilization_processing_issue::serialize(binary_writer& writer) const
+{
+	writer.write_string(description);
+	writer.write_int(static_cast<int>(issue_type));
+	writer.write_int(static_cast<int>(replacement_tokens.size()));
+	for (unsigned int index = 0; index < replacement_tokens.size(); index++)
+	{
+		writer.write_string(replacement_tokens[index].key);
+		writer.write_string(replacement_tokens[index].value);
+	}
+}
+
+bool stabilization_processing_issue::deserialize(binary_reader& reader)
+{
+	int issue_type_value;
+	int num_tokens;
+	if (
+		!reader.read_string(description) ||
+		!reader.read_int(issue_type_value) ||
+		!reader.read_count(num_tokens)
+	)
+	{
+		return false;
+	}
+	issue_type = static_cast<stabilization_processing_issue_type>(issue_type_value);
+	replacement_tokens.clear();
+	replacement_tokens.resize(num_tokens);
+	for (int index = 0; index < num_tokens; index++)
+	{
+		if (!reader.read_string(replacement_tokens[index].key) || !reader.read_string(replacement_tokens[index].value))
+			return false;
+	}
+	return true;
+}
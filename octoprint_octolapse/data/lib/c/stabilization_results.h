@@ -24,6 +24,8 @@
 #include <string>
 #include <vector>
 #include "snapshot_plan.h"
+#include "binary_stream.h"
+#include "processing_stats.h"
 enum stabilization_quality_issue_type
 {
 	stabilization_quality_issue_fast_trigger = 1,
@@ -38,7 +40,8 @@ enum stabilization_processing_issue_type
 	stabilization_processing_issue_type_no_definite_position = 3,
 	stabilization_processing_issue_type_printer_not_primed = 4,
 	stabilization_processing_issue_type_no_metric_units = 5,
-	stabilization_processing_issue_type_no_snapshot_commands_found = 6
+	stabilization_processing_issue_type_no_snapshot_commands_found = 6,
+	stabilization_processing_issue_type_gcode_decode_error = 7
 };
 
 struct stabilization_quality_issue
@@ -46,6 +49,8 @@ struct stabilization_quality_issue
 	std::string description;
 	stabilization_quality_issue_type issue_type;
 	PyObject * to_py_object() const;
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
 };
 
 struct replacement_token
@@ -60,19 +65,41 @@ struct stabilization_processing_issue
 	stabilization_processing_issue_type issue_type;
 	std::vector<replacement_token> replacement_tokens;
 	PyObject * to_py_object() const;
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
 };
 
 struct stabilization_results
 {
 	stabilization_results();
 	PyObject * to_py_object();
+	/**
+	 * \brief Writes everything except seconds_elapsed and stats, which describe the run that produced the results.
+	 */
+	void serialize(binary_writer& writer) const;
+	bool deserialize(binary_reader& reader);
 	std::vector<snapshot_plan> snapshot_plans;
+	/**
+	 * \brief The number of plans that were already handed to the snapshot plans callback while processing.  They are
+	 * not in snapshot_plans.
+	 */
+	int streamed_snapshot_plan_count;
+	/**
+	 * \brief The serialized streamed plans, which are only kept when the results will be cached.  Serialized plans
+	 * are written before snapshot_plans so that the cache entry holds every plan in file order.
+	 */
+	std::string streamed_snapshot_plans;
 	double seconds_elapsed;
 	long gcodes_processed;
 	long lines_processed;
 	int missed_layer_count;
 	std::vector<stabilization_quality_issue> quality_issues;
 	std::vector<stabilization_processing_issue> processing_issues;
+	/**
+	 * \brief How often each stage ran and how long it took.  Results that were loaded from the snapshot plan cache
+	 * have no stage stats.
+	 */
+	processing_stats stats;
 };
 
 
@@ -66,6 +66,13 @@ void stabilization_smart_gcode::on_processing_complete()
 {
 }
 
+void stabilization_smart_gcode::serialize_settings(binary_writer& writer) const
+{
+	stabilization::serialize_settings(writer);
+	writer.write_string("smart_gcode");
+	writer.write_string(smart_gcode_args_.snapshot_command_text);
+}
+
 std::vector<stabilization_quality_issue> stabilization_smart_gcode::get_quality_issues()
 {
 	return std::vector<stabilization_quality_issue>();
@@ -118,11 +125,11 @@ void stabilization_smart_gcode::process_snapshot_command_parameters(position *p_
 	
 	for (std::vector<parsed_command_parameter>::const_iterator it = p_cur_pos->command.parameters.begin(); it != p_cur_pos->command.parameters.end(); ++it)
 	{
-		if ((*it).name == "X")
+		if ((*it).name == 'X')
 		{
 			x = (*it).double_value;
 		}
-		else if ((*it).name == "Y")
+		else if ((*it).name == 'Y')
 		{
 			y = (*it).double_value;
 		}
@@ -131,41 +138,17 @@ void stabilization_smart_gcode::process_snapshot_command_parameters(position *p_
 
 bool stabilization_smart_gcode::process_snapshot_command(position *p_cur_pos)
 {
-	if (p_cur_pos->command.command == "@OCTOLAPSE")
-	{
-		bool ret_val;
-		for (std::vector<parsed_command_parameter>::const_iterator it = p_cur_pos->command.parameters.begin(); it != p_cur_pos->command.parameters.end(); ++it)
-		{
-			if ((*it).name == "TAKE-SNAPSHOT")
-			{
-				// Todo:  Figure out what to do here
-				//process_snapshot_command_parameters(p_cur_pos);
-				ret_val = true;
-				break;
-			}
-		}
-		return ret_val;
-	}
-	else if (
-		smart_gcode_args_.snapshot_command.gcode.size() > 0 && 
-		(
-			smart_gcode_args_.snapshot_command.gcode == p_cur_pos->command.gcode
-		)
-	){
-		return true;
-	}
-	else if (p_cur_pos->command.gcode == "SNAP")  // Backwards Compatibility
-	{
-		return true;
-	}
-	return false;
-	
+	// Todo:  Figure out what to do with any TAKE-SNAPSHOT parameters
+	//process_snapshot_command_parameters(p_cur_pos);
+	return p_cur_pos->command.is_snapshot_command(smart_gcode_args_.snapshot_command.gcode);
 }
 
 void stabilization_smart_gcode::add_plan(position * p_position)
 {
 	//std::cout << "Adding saved plan to plans...  F Speed" << p_saved_position_->f_ << " \r\n";
-	snapshot_plan p_plan;
+	// Build the plan in place so that it is never copied.
+	p_snapshot_plans_.resize(p_snapshot_plans_.size() + 1);
+	snapshot_plan& p_plan = p_snapshot_plans_.back();
 	double total_travel_distance;
 	total_travel_distance = utilities::get_cartesian_distance(p_position->x, p_position->y, stabilization_x_, stabilization_y_);
 	
@@ -207,8 +190,6 @@ void stabilization_smart_gcode::add_plan(position * p_position)
 	p_plan.file_gcode_number = p_position->gcode_number;
 	p_plan.file_position = p_position->file_position;
 
-	// Add the plan
-	p_snapshot_plans_.push_back(p_plan);
 	// get the next coordinates
 	update_stabilization_coordinates();
 	
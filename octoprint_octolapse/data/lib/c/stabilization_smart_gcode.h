@@ -10,8 +10,9 @@ struct smart_gcode_args
 	{
 		snapshot_command_text = "@OCTOLAPSE TAKE-SNAPSHOT";
 		snapshot_command.command = "@OCTOLAPSE";
+		snapshot_command.opcode = gcode_opcode_octolapse;
 		parsed_command_parameter parameter;
-		parameter.name = "TAKE-SNAPSHOT";
+		parameter.string_value = "TAKE-SNAPSHOT";
 		snapshot_command.gcode = "@OCTOLAPSE TAKE-SNAPSHOT";
 		snapshot_command.parameters.push_back(parameter);
 	}
@@ -34,6 +35,7 @@ private:
 	void on_processing_complete() override;
 	std::vector<stabilization_quality_issue> get_quality_issues() override;
 	std::vector<stabilization_processing_issue> get_internal_processing_issues() override;
+	void serialize_settings(binary_writer& writer) const override;
 	bool process_snapshot_command(position *p_cur_pos);
 	void process_snapshot_command_parameters(position *p_cur_pos);
 	void add_plan(position * p_position);
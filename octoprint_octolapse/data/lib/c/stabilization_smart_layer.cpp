@@ -37,6 +37,8 @@ stabilization_smart_layer::stabilization_smart_layer(
 	slowest_extrusion_speed_ = -1;
 
 	smart_layer_args_ = mt_args;
+	// The position tracks the layer height increment, so it must be set before any cache or checkpoint key is created
+	gcode_position_args_.height_increment = stabilization_args_.height_increment;
 	// initialize closest extrusion/travel tracking structs
 	stabilization_x_ = 0;
 	stabilization_y_ = 0;
@@ -67,6 +69,8 @@ stabilization_smart_layer::stabilization_smart_layer(
 	slowest_extrusion_speed_ = -1;
 
 	smart_layer_args_ = mt_args;
+	// The position tracks the layer height increment, so it must be set before any cache or checkpoint key is created
+	gcode_position_args_.height_increment = stabilization_args_.height_increment;
 	// Get the initial stabilization coordinates
 	stabilization_x_ = 0;
 	stabilization_y_ = 0;
@@ -94,11 +98,6 @@ stabilization_smart_layer::~stabilization_smart_layer()
 	
 }
 
-void stabilization_smart_layer::on_processing_start()
-{
-	gcode_position_args_.height_increment = stabilization_args_.height_increment;
-}
-
 void stabilization_smart_layer::update_stabilization_coordinates()
 {
 	const bool snap_to_print_smooth = smart_layer_args_.smart_layer_trigger_type == trigger_type_snap_to_print && smart_layer_args_.snap_to_print_smooth;
@@ -169,8 +168,14 @@ void stabilization_smart_layer::process_pos(position* p_current_pos, position* p
 	{
 		add_plan();
 	}
+	// Plans are only made from the saved positions, so once they are empty every later plan triggers here or after.
+	if (closest_positions_.is_empty())
+		planned_gcode_number_ = p_current_pos->gcode_number;
 	//octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::VERBOSE, "Adding closest position.");
-	closest_positions_.try_add(p_current_pos, p_previous_pos);
+	{
+		processing_stage_timer timer(p_stats_, processing_stage_trigger_positions);
+		closest_positions_.try_add(p_current_pos, p_previous_pos);
+	}
 	last_tested_gcode_number_ = p_current_pos->gcode_number;
 }
 
@@ -180,7 +185,9 @@ void stabilization_smart_layer::add_plan()
 	if (closest_positions_.get_position(p_closest))
 	{
 		//std::cout << "Adding saved plan to plans...  F Speed" << p_saved_position_->f_ << " \r\n";
-		snapshot_plan p_plan;
+		// Build the plan in place so that it is never copied.
+		p_snapshot_plans_.resize(p_snapshot_plans_.size() + 1);
+		snapshot_plan& p_plan = p_snapshot_plans_.back();
 		double total_travel_distance;
 		if (smart_layer_args_.smart_layer_trigger_type == trigger_type_snap_to_print)
 		{
@@ -198,7 +205,14 @@ void stabilization_smart_layer::add_plan()
 		p_plan.triggering_command_feature_type = p_closest.type_feature;
 		// create the initial position
 		p_plan.triggering_command = p_closest.pos.command;
-		p_plan.start_command = p_closest.pos.command;
+		if (p_closest.start_command.is_empty)
+			p_plan.start_command = p_closest.pos.command;
+		else
+		{
+			// The snapshot is taken part of the way along an arc.  The rest of the arc is printed afterwards.
+			p_plan.start_command = p_closest.start_command;
+			p_plan.end_command = p_closest.end_command;
+		}
 		p_plan.initial_position = p_closest.pos;
 		p_plan.has_initial_position = true;
 		const bool all_stabilizations_disabled = stabilization_args_.x_stabilization_disabled && stabilization_args_.y_stabilization_disabled;
@@ -231,8 +245,6 @@ void stabilization_smart_layer::add_plan()
 		p_plan.file_gcode_number = p_closest.pos.gcode_number;
 		p_plan.file_position = p_closest.pos.file_position;
 
-		// Add the plan
-		p_snapshot_plans_.push_back(p_plan);
 		last_snapshot_initial_position_ = p_plan.initial_position;
 		// only get the next coordinates if we've actually added a plan.
 		update_stabilization_coordinates();
@@ -248,7 +260,7 @@ void stabilization_smart_layer::add_plan()
 	}
 	else
 	{
-		octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "No point snapshot position found for layer.");
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "No point snapshot position found for layer.");
 		// reset the saved positions
 		reset_saved_positions();
 	}
@@ -278,6 +290,16 @@ void stabilization_smart_layer::on_processing_complete()
 	//std::cout << "Complete.\r\n";
 }
 
+void stabilization_smart_layer::serialize_settings(binary_writer& writer) const
+{
+	stabilization::serialize_settings(writer);
+	writer.write_string("smart_layer");
+	writer.write_int(static_cast<int>(smart_layer_args_.smart_layer_trigger_type));
+	writer.write_double(smart_layer_args_.speed_threshold);
+	writer.write_bool(smart_layer_args_.snap_to_print_high_quality);
+	writer.write_bool(smart_layer_args_.snap_to_print_smooth);
+}
+
 std::vector<stabilization_quality_issue> stabilization_smart_layer::get_quality_issues()
 {
 	std::vector<stabilization_quality_issue> issues;
@@ -35,9 +35,9 @@ public:
 private:
 	stabilization_smart_layer(const stabilization_smart_layer &source); // don't copy me
 	void process_pos(position* p_current_pos, position* p_previous_pos, bool found_command) override;
-	void on_processing_start() override;
 	void on_processing_complete() override;
 	std::vector<stabilization_quality_issue> get_quality_issues() override;
+	void serialize_settings(binary_writer& writer) const override;
 	void add_plan();
 	void reset_saved_positions();
 	/**
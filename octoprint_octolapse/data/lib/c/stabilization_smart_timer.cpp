@@ -0,0 +1,289 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "stabilization_smart_timer.h"
+#include "utilities.h"
+#include "logging.h"
+
+stabilization_smart_timer::stabilization_smart_timer()
+{
+	initialize(smart_timer_args());
+}
+
+stabilization_smart_timer::stabilization_smart_timer(
+	gcode_position_args position_args, stabilization_args stab_args, smart_timer_args mt_args, progressCallback progress
+) : stabilization(position_args, stab_args, progress)
+{
+	initialize(mt_args);
+	update_stabilization_coordinates();
+}
+
+stabilization_smart_timer::stabilization_smart_timer(
+	gcode_position_args position_args, stabilization_args stab_args, smart_timer_args mt_args, pythonGetCoordinatesCallback get_coordinates, PyObject* py_get_coordinates_callback, pythonProgressCallback progress, PyObject* py_progress_callback
+) : stabilization(position_args, stab_args, get_coordinates, py_get_coordinates_callback, progress, py_progress_callback)
+{
+	initialize(mt_args);
+	update_stabilization_coordinates();
+}
+
+stabilization_smart_timer::stabilization_smart_timer(const stabilization_smart_timer &source)
+{
+	
+}
+
+stabilization_smart_timer::~stabilization_smart_timer()
+{
+	
+}
+
+void stabilization_smart_timer::initialize(const smart_timer_args& mt_args)
+{
+	smart_timer_args_ = mt_args;
+	search_seconds_ = mt_args.search_seconds > 0 ? mt_args.search_seconds : mt_args.interval_seconds / 4;
+	is_timer_started_ = false;
+	is_trigger_wait_ = false;
+	next_snapshot_seconds_ = 0;
+	stabilization_x_ = 0;
+	stabilization_y_ = 0;
+	standard_trigger_distance_ = 0;
+	is_estimating_time_ = true;
+	time_estimator_ = print_time_estimator(mt_args.time_estimator_args);
+
+	trigger_position_args default_args;
+	default_args.type = mt_args.smart_timer_trigger_type;
+	default_args.minimum_speed = mt_args.speed_threshold;
+	default_args.snap_to_print_high_quality = mt_args.snap_to_print_high_quality;
+	default_args.x_stabilization_disabled = stabilization_args_.x_stabilization_disabled;
+	default_args.y_stabilization_disabled = stabilization_args_.y_stabilization_disabled;
+	closest_positions_.initialize(default_args);
+	last_snapshot_initial_position_.is_empty = true;
+}
+
+void stabilization_smart_timer::update_stabilization_coordinates()
+{
+	const bool snap_to_print_smooth = smart_timer_args_.smart_timer_trigger_type == trigger_type_snap_to_print && smart_timer_args_.snap_to_print_smooth;
+	const bool stabilization_disabled = stabilization_args_.x_stabilization_disabled && stabilization_args_.y_stabilization_disabled;
+	if (
+		(stabilization_disabled || snap_to_print_smooth)
+		&& !last_snapshot_initial_position_.is_empty
+	)
+	{
+		stabilization_x_ = last_snapshot_initial_position_.x;
+		stabilization_y_ = last_snapshot_initial_position_.y;
+	}
+	else
+	{
+		// Get the next stabilization point
+		get_next_xy_coordinates(stabilization_x_, stabilization_y_);
+	}
+	closest_positions_.set_stabilization_coordinates(stabilization_x_, stabilization_y_);
+}
+
+void stabilization_smart_timer::on_processing_start()
+{
+	time_estimator_.clear();
+	is_timer_started_ = false;
+	reset_saved_positions();
+}
+
+void stabilization_smart_timer::process_pos(position* p_current_pos, position* p_previous_pos, bool found_command)
+{
+	if (!found_command)
+		return;
+	// The estimate runs up to the start of the current move, which is where a snapshot triggered by the previous
+	// command would be taken.
+	const double seconds = time_estimator_.get_seconds();
+	if (!is_timer_started_)
+	{
+		// Like the live timer trigger, the first interval starts once a snapshot could be taken.
+		if (!p_current_pos->can_take_snapshot())
+			return;
+		is_timer_started_ = true;
+		next_snapshot_seconds_ = seconds + smart_timer_args_.interval_seconds;
+	}
+
+	if (seconds >= next_snapshot_seconds_)
+	{
+		if (!is_trigger_wait_)
+		{
+			is_trigger_wait_ = true;
+			standard_trigger_distance_ = utilities::get_cartesian_distance(
+				p_current_pos->x, p_current_pos->y,
+				stabilization_x_, stabilization_y_
+			);
+		}
+		// Wait for a candidate if none were found near the end of the interval
+		if (!closest_positions_.is_empty())
+			add_plan(seconds);
+	}
+
+	if (seconds >= next_snapshot_seconds_ - search_seconds_)
+	{
+		processing_stage_timer timer(p_stats_, processing_stage_trigger_positions);
+		closest_positions_.try_add(p_current_pos, p_previous_pos);
+	}
+}
+
+void stabilization_smart_timer::add_plan(const double seconds)
+{
+	trigger_position p_closest;
+	if (closest_positions_.get_position(p_closest))
+	{
+		// Build the plan in place so that it is never copied.
+		p_snapshot_plans_.resize(p_snapshot_plans_.size() + 1);
+		snapshot_plan& p_plan = p_snapshot_plans_.back();
+		double total_travel_distance;
+		if (smart_timer_args_.smart_timer_trigger_type == trigger_type_snap_to_print)
+		{
+			total_travel_distance = 0;
+		}
+		else
+		{
+			total_travel_distance = p_closest.distance * 2;
+		}
+
+		p_plan.total_travel_distance = total_travel_distance;
+		p_plan.saved_travel_distance = (standard_trigger_distance_ * 2) - total_travel_distance;
+		p_plan.distance_from_stabilization_point = p_closest.distance;
+		p_plan.triggering_command_type = p_closest.type_position;
+		p_plan.triggering_command_feature_type = p_closest.type_feature;
+		// create the initial position
+		p_plan.triggering_command = p_closest.pos.command;
+		if (p_closest.start_command.is_empty)
+			p_plan.start_command = p_closest.pos.command;
+		else
+		{
+			// The snapshot is taken part of the way along an arc.  The rest of the arc is printed afterwards.
+			p_plan.start_command = p_closest.start_command;
+			p_plan.end_command = p_closest.end_command;
+		}
+		p_plan.initial_position = p_closest.pos;
+		p_plan.has_initial_position = true;
+		const bool all_stabilizations_disabled = stabilization_args_.x_stabilization_disabled && stabilization_args_.y_stabilization_disabled;
+
+		if (!(all_stabilizations_disabled || smart_timer_args_.smart_timer_trigger_type == trigger_type_snap_to_print))
+		{
+			double x_stabilization, y_stabilization;
+			if (stabilization_args_.x_stabilization_disabled)
+				x_stabilization = p_closest.pos.x;
+			else
+				x_stabilization = stabilization_x_;
+
+			if (stabilization_args_.y_stabilization_disabled)
+				y_stabilization = p_closest.pos.y;
+			else
+				y_stabilization = stabilization_y_;
+
+			const snapshot_plan_step p_travel_step(&x_stabilization, &y_stabilization, NULL, NULL, NULL, travel_action);
+			p_plan.steps.push_back(p_travel_step);
+		}
+
+		const snapshot_plan_step p_snapshot_step(NULL, NULL, NULL, NULL, NULL, snapshot_action);
+		p_plan.steps.push_back(p_snapshot_step);
+
+		// Only add a return position if we're not using snap to print
+		if (smart_timer_args_.smart_timer_trigger_type != trigger_type_snap_to_print)
+			p_plan.return_position = p_closest.pos;
+
+		p_plan.file_line = p_closest.pos.file_line_number;
+		p_plan.file_gcode_number = p_closest.pos.gcode_number;
+		p_plan.file_position = p_closest.pos.file_position;
+
+		last_snapshot_initial_position_ = p_plan.initial_position;
+		update_stabilization_coordinates();
+		reset_saved_positions();
+		// Need to set the initial position after resetting the saved positions
+		closest_positions_.set_previous_initial_position(last_snapshot_initial_position_);
+	}
+	else
+	{
+		OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, "No point snapshot position found for the timer interval.");
+		reset_saved_positions();
+		missed_snapshots_++;
+	}
+
+	// The intervals stay fixed to the start of the print, so a late snapshot doesn't delay the ones after it.
+	next_snapshot_seconds_ += smart_timer_args_.interval_seconds;
+	while (next_snapshot_seconds_ <= seconds)
+	{
+		next_snapshot_seconds_ += smart_timer_args_.interval_seconds;
+		missed_snapshots_++;
+	}
+}
+
+void stabilization_smart_timer::reset_saved_positions()
+{
+	closest_positions_.clear();
+	is_trigger_wait_ = false;
+	standard_trigger_distance_ = 0;
+}
+
+void stabilization_smart_timer::on_processing_complete()
+{
+	time_estimator_.finish();
+	if (!closest_positions_.is_empty())
+	{
+		add_plan(time_estimator_.get_seconds());
+	}
+	OCTOLAPSE_LOG(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Smart timer stabilization complete, estimated print time: " << utilities::to_string(time_estimator_.get_seconds()) << " seconds.");
+}
+
+void stabilization_smart_timer::serialize_settings(binary_writer& writer) const
+{
+	stabilization::serialize_settings(writer);
+	writer.write_string(SMART_TIMER_STABILIZATION);
+	writer.write_int(static_cast<int>(smart_timer_args_.smart_timer_trigger_type));
+	writer.write_double(smart_timer_args_.speed_threshold);
+	writer.write_bool(smart_timer_args_.snap_to_print_high_quality);
+	writer.write_bool(smart_timer_args_.snap_to_print_smooth);
+	writer.write_double(smart_timer_args_.interval_seconds);
+	writer.write_double(search_seconds_);
+	smart_timer_args_.time_estimator_args.serialize(writer);
+}
+
+std::vector<stabilization_quality_issue> stabilization_smart_timer::get_quality_issues()
+{
+	std::vector<stabilization_quality_issue> issues;
+
+	gcode_comment_processor* p_comment_processor = gcode_position_->get_gcode_comment_processor();
+	if (smart_timer_args_.smart_timer_trigger_type == trigger_type_fast)
+	{
+		stabilization_quality_issue issue;
+		issue.description = "You are using the 'Fast' smart trigger.  This could lead to quality issues.  If you are having print quality issues, consider using a 'high quality' or 'snap to print' smart trigger.";
+		issue.issue_type = stabilization_quality_issue_fast_trigger;
+		issues.push_back(issue);
+	}
+	else if (smart_timer_args_.smart_timer_trigger_type == trigger_type_snap_to_print && !smart_timer_args_.snap_to_print_high_quality)
+	{
+		stabilization_quality_issue issue;
+		issue.description = "In most cases using the 'High Quality' snap to print option will improve print quality, unless you are printing with vase mode enabled.";
+		issue.issue_type = stabilization_quality_issue_snap_to_print_low_quality;
+		issues.push_back(issue);
+	}
+	else if (p_comment_processor->get_comment_process_type() == comment_process_type_unknown)
+	{
+		stabilization_quality_issue issue;
+		issue.description = "No print features were found in your gcode file.  This can reduce print quality significantly.  If you are using Slic3r or PrusaSlicer, please enable 'Verbose G-code' in 'Print Settings'->'Output Options'->'Output File'.";
+		issue.issue_type = stabilization_quality_issue_no_print_features;
+		issues.push_back(issue);
+	}
+	return issues;
+}
@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef STABILIZATION_SMART_TIMER_H
+#define STABILIZATION_SMART_TIMER_H
+#include "stabilization.h"
+#include "position.h"
+#include "trigger_position.h"
+#include "print_time_estimator.h"
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#endif
+static const char* SMART_TIMER_STABILIZATION = "smart_timer";
+
+struct smart_timer_args
+{
+	smart_timer_args()
+	{
+		smart_timer_trigger_type = trigger_type::trigger_type_compatibility;
+		speed_threshold = 0;
+		snap_to_print_high_quality = false;
+		snap_to_print_smooth = false;
+		interval_seconds = 30;
+		search_seconds = 0;
+	}
+	trigger_type smart_timer_trigger_type;
+	double speed_threshold;
+	bool snap_to_print_high_quality;
+	bool snap_to_print_smooth;
+	// The estimated print time between snapshots
+	double interval_seconds;
+	// The positions printed in the last search_seconds of each interval are the snapshot candidates.  A quarter of the
+	// interval is searched if this is 0.
+	double search_seconds;
+	print_time_estimator_args time_estimator_args;
+};
+
+/**
+ * \brief Plans a snapshot every interval_seconds of estimated print time, so that timer snapshots can be planned before
+ * printing like smart layer snapshots.  Each snapshot is the best position found by the trigger_positions near the end
+ * of its interval.
+ */
+class stabilization_smart_timer : public stabilization
+{
+public:
+	stabilization_smart_timer();
+	stabilization_smart_timer(gcode_position_args position_args, stabilization_args stab_args, smart_timer_args mt_args, progressCallback progress);
+	stabilization_smart_timer(gcode_position_args position_args, stabilization_args stab_args, smart_timer_args mt_args, pythonGetCoordinatesCallback get_coordinates, PyObject* py_get_coordinates_callback, pythonProgressCallback progress, PyObject* py_progress_callback);
+	~stabilization_smart_timer();
+private:
+	stabilization_smart_timer(const stabilization_smart_timer &source); // don't copy me
+	void initialize(const smart_timer_args& mt_args);
+	void process_pos(position* p_current_pos, position* p_previous_pos, bool found_command) override;
+	void on_processing_start() override;
+	void on_processing_complete() override;
+	std::vector<stabilization_quality_issue> get_quality_issues() override;
+	void serialize_settings(binary_writer& writer) const override;
+	/**
+	 * \brief Adds a plan for the closest position, and moves to the first interval that ends after seconds.
+	 */
+	void add_plan(double seconds);
+	void reset_saved_positions();
+	void update_stabilization_coordinates();
+	smart_timer_args smart_timer_args_;
+	double search_seconds_;
+	bool is_timer_started_;
+	bool is_trigger_wait_;
+	double next_snapshot_seconds_;
+	double stabilization_x_;
+	double stabilization_y_;
+	// The distance to the stabilization point from where the interval ended, which is where a timer trigger would take the snapshot
+	double standard_trigger_distance_;
+	position last_snapshot_initial_position_;
+	trigger_positions closest_positions_;
+};
+#endif
@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef THREADS_H
+#define THREADS_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+
+// OCTOLAPSE_HAS_THREADS is 1 when the compiler has the C++11 thread support library, thread_local and <chrono>.  On
+// windows, python 2.7 and 3.4 and older build their extensions with MSVC 9 or 10, which have none of them.  Those
+// builds leave out the AsyncTracker and the PlanPipeline, so python uses its synchronous paths instead, and use the
+// stand-ins below everywhere else.  Define it as 0 to build without threads on any compiler.
+#ifndef OCTOLAPSE_HAS_THREADS
+#if defined(_MSC_VER)
+#if _MSC_VER >= 1900
+#define OCTOLAPSE_HAS_THREADS 1
+#else
+#define OCTOLAPSE_HAS_THREADS 0
+#endif
+#elif __cplusplus >= 201103L
+#define OCTOLAPSE_HAS_THREADS 1
+#else
+#define OCTOLAPSE_HAS_THREADS 0
+#endif
+#endif
+
+#if OCTOLAPSE_HAS_THREADS
+#include <atomic>
+#include <mutex>
+namespace octolapse_sync
+{
+	using std::atomic;
+	using std::mutex;
+	using std::lock_guard;
+	using std::memory_order;
+	using std::memory_order_relaxed;
+	using std::memory_order_acquire;
+	using std::memory_order_release;
+	using std::memory_order_seq_cst;
+}
+#else
+#include <pythread.h>
+// For the clocks that stand in for <chrono>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <time.h>
+#endif
+namespace octolapse_sync
+{
+	enum memory_order
+	{
+		memory_order_relaxed,
+		memory_order_acquire,
+		memory_order_release,
+		memory_order_seq_cst
+	};
+
+	/**
+	 * \brief Stands in for std::atomic.  Without native threads, only a python thread that released the GIL writes
+	 * these values while others read them.  MSVC gives volatile reads and writes acquire and release semantics, which
+	 * is all that the readers rely on.  fetch_add is not atomic, so it may only be called by a single writer.
+	 */
+	template <typename T>
+	class atomic
+	{
+	public:
+		atomic() : value_() {}
+		atomic(T value) : value_(value) {}
+		T load(memory_order order = memory_order_seq_cst) const
+		{
+			return value_;
+		}
+		void store(T value, memory_order order = memory_order_seq_cst)
+		{
+			value_ = value;
+		}
+		T fetch_add(T value, memory_order order = memory_order_seq_cst)
+		{
+			const T previous = value_;
+			value_ = previous + value;
+			return previous;
+		}
+		operator T() const
+		{
+			return value_;
+		}
+		T operator=(T value)
+		{
+			value_ = value;
+			return value;
+		}
+	private:
+		atomic(const atomic& source);
+		atomic& operator=(const atomic& source);
+		volatile T value_;
+	};
+
+	/**
+	 * \brief Stands in for std::mutex with a python thread lock, which every python version provides.
+	 */
+	class mutex
+	{
+	public:
+		mutex() : lock_(PyThread_allocate_lock()) {}
+		~mutex()
+		{
+			PyThread_free_lock(lock_);
+		}
+		void lock()
+		{
+			PyThread_acquire_lock(lock_, WAIT_LOCK);
+		}
+		void unlock()
+		{
+			PyThread_release_lock(lock_);
+		}
+	private:
+		mutex(const mutex& source);
+		mutex& operator=(const mutex& source);
+		PyThread_type_lock lock_;
+	};
+
+	template <typename Mutex>
+	class lock_guard
+	{
+	public:
+		explicit lock_guard(Mutex& m) : mutex_(m)
+		{
+			mutex_.lock();
+		}
+		~lock_guard()
+		{
+			mutex_.unlock();
+		}
+	private:
+		lock_guard(const lock_guard& source);
+		lock_guard& operator=(const lock_guard& source);
+		Mutex& mutex_;
+	};
+}
+#endif
+#endif
@@ -0,0 +1,478 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "toolpath_recorder.h"
+#include "gcode_arc.h"
+#include "logging.h"
+#include <cmath>
+
+#pragma region toolpath_column
+toolpath_column::toolpath_column(const char format, const size_t item_size)
+{
+	format_ = format;
+	item_size_ = item_size;
+}
+
+void toolpath_column::clear()
+{
+	// Release the memory too, since the column may be large.
+	std::vector<unsigned char>().swap(data_);
+}
+
+char toolpath_column::get_format() const
+{
+	return format_;
+}
+
+size_t toolpath_column::get_item_size() const
+{
+	return item_size_;
+}
+
+std::vector<unsigned char>& toolpath_column::get_data()
+{
+	return data_;
+}
+#pragma endregion toolpath_column
+
+#pragma region toolpath_recorder
+namespace
+{
+	double get_distance_to_segment(const double x, const double y, const double z,
+		const double start_x, const double start_y, const double start_z, const double end_x, const double end_y, const double end_z)
+	{
+		const double dx = end_x - start_x;
+		const double dy = end_y - start_y;
+		const double dz = end_z - start_z;
+		const double length_squared = dx * dx + dy * dy + dz * dz;
+		double t = 0;
+		if (length_squared > 0)
+		{
+			t = ((x - start_x) * dx + (y - start_y) * dy + (z - start_z) * dz) / length_squared;
+			if (t < 0)
+				t = 0;
+			else if (t > 1)
+				t = 1;
+		}
+		const double ox = x - (start_x + t * dx);
+		const double oy = y - (start_y + t * dy);
+		const double oz = z - (start_z + t * dz);
+		return sqrt(ox * ox + oy * oy + oz * oz);
+	}
+}
+
+toolpath_recorder::toolpath_recorder(const double tolerance) :
+	x('f', sizeof(float)), y('f', sizeof(float)), z('f', sizeof(float)), e_delta('f', sizeof(float)),
+	feature_type('b', sizeof(signed char)), layer('i', sizeof(int))
+{
+	tolerance_ = tolerance;
+	clear();
+}
+
+toolpath_recorder::toolpath_recorder(const toolpath_recorder& source) :
+	x('f', sizeof(float)), y('f', sizeof(float)), z('f', sizeof(float)), e_delta('f', sizeof(float)),
+	feature_type('b', sizeof(signed char)), layer('i', sizeof(int))
+{
+	// Private copy constructor, don't copy me!
+	throw std::exception();
+}
+
+void toolpath_recorder::clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	e_delta.clear();
+	feature_type.clear();
+	layer.clear();
+	point_count_ = 0;
+	move_count_ = 0;
+	has_anchor_ = false;
+	has_pending_ = false;
+	pending_e_delta_ = 0;
+	pending_feature_type_ = 0;
+	pending_layer_ = 0;
+	merged_.clear();
+	is_finished_.store(false, octolapse_sync::memory_order_release);
+}
+
+void toolpath_recorder::add(const position* p_current_pos, const position* p_previous_pos)
+{
+	if (
+		!p_current_pos->has_position_changed ||
+		p_current_pos->x_null || p_current_pos->y_null || p_current_pos->z_null ||
+		p_previous_pos->x_null || p_previous_pos->y_null || p_previous_pos->z_null
+	)
+		return;
+	if (p_current_pos->x == p_previous_pos->x && p_current_pos->y == p_previous_pos->y && p_current_pos->z == p_previous_pos->z)
+		return;
+	move_count_++;
+	const double e = p_current_pos->get_current_extruder().e_relative;
+	const int feature = p_current_pos->feature_type_tag;
+	const long current_layer = p_current_pos->layer;
+	if (!has_anchor_)
+	{
+		// The toolpath starts where the first known move starts
+		toolpath_point start;
+		start.x = p_previous_pos->x;
+		start.y = p_previous_pos->y;
+		start.z = p_previous_pos->z;
+		write_point(start, 0, feature, current_layer);
+		anchor_ = start;
+		has_anchor_ = true;
+	}
+	toolpath_point end;
+	end.x = p_current_pos->x;
+	end.y = p_current_pos->y;
+	end.z = p_current_pos->z;
+	const gcode_opcode opcode = p_current_pos->command.opcode;
+	if (opcode == gcode_opcode_g2 || opcode == gcode_opcode_g3)
+	{
+		gcode_arc arc;
+		// Helical arcs are not split, so they are drawn as straight moves.
+		if (arc.try_set_circle(p_current_pos->command, p_previous_pos->x, p_previous_pos->y, p_current_pos->x, p_current_pos->y))
+		{
+			arc.set_sweep();
+			const double chord_tolerance = tolerance_ > 0 ? tolerance_ : TOOLPATH_DEFAULT_ARC_TOLERANCE;
+			int chords = TOOLPATH_MAX_ARC_CHORDS;
+			if (chord_tolerance < arc.radius)
+			{
+				// The sagitta of a chord that spans the angle a is r * (1 - cos(a / 2))
+				const double chord_angle = 2.0 * acos(1.0 - chord_tolerance / arc.radius);
+				chords = static_cast<int>(ceil(fabs(arc.sweep_angle) / chord_angle));
+			}
+			if (chords > TOOLPATH_MAX_ARC_CHORDS)
+				chords = TOOLPATH_MAX_ARC_CHORDS;
+			for (int index = 1; index < chords; index++)
+			{
+				toolpath_point point;
+				arc.get_point(static_cast<double>(index) / static_cast<double>(chords), point.x, point.y);
+				point.z = end.z;
+				add_point(point, e / static_cast<double>(chords), feature, current_layer);
+			}
+			if (chords > 1)
+			{
+				add_point(end, e / static_cast<double>(chords), feature, current_layer);
+				return;
+			}
+		}
+	}
+	add_point(end, e, feature, current_layer);
+}
+
+bool toolpath_recorder::can_merge(const toolpath_point& end, const double e, const int feature, const long current_layer) const
+{
+	if (
+		tolerance_ <= 0 ||
+		merged_.size() >= TOOLPATH_MAX_MERGED_MOVES ||
+		feature != pending_feature_type_ ||
+		current_layer != pending_layer_ ||
+		(e > 0) != (pending_e_delta_ > 0)
+	)
+		return false;
+	// The pending point and every point merged before it must stay close to the longer segment.
+	if (get_distance_to_segment(pending_.x, pending_.y, pending_.z, anchor_.x, anchor_.y, anchor_.z, end.x, end.y, end.z) > tolerance_)
+		return false;
+	for (std::vector<toolpath_point>::const_iterator it = merged_.begin(); it != merged_.end(); ++it)
+	{
+		if (get_distance_to_segment((*it).x, (*it).y, (*it).z, anchor_.x, anchor_.y, anchor_.z, end.x, end.y, end.z) > tolerance_)
+			return false;
+	}
+	return true;
+}
+
+void toolpath_recorder::add_point(const toolpath_point& point, const double e, const int feature, const long current_layer)
+{
+	if (has_pending_)
+	{
+		if (can_merge(point, e, feature, current_layer))
+		{
+			merged_.push_back(pending_);
+			pending_ = point;
+			pending_e_delta_ += e;
+			return;
+		}
+		write_point(pending_, pending_e_delta_, pending_feature_type_, pending_layer_);
+		anchor_ = pending_;
+		merged_.clear();
+	}
+	pending_ = point;
+	pending_e_delta_ = e;
+	pending_feature_type_ = feature;
+	pending_layer_ = current_layer;
+	has_pending_ = true;
+}
+
+void toolpath_recorder::write_point(const toolpath_point& point, const double e, const int feature, const long current_layer)
+{
+	x.push_back(static_cast<float>(point.x));
+	y.push_back(static_cast<float>(point.y));
+	z.push_back(static_cast<float>(point.z));
+	e_delta.push_back(static_cast<float>(e));
+	feature_type.push_back(static_cast<signed char>(feature));
+	layer.push_back(static_cast<int>(current_layer));
+	point_count_++;
+}
+
+void toolpath_recorder::finish()
+{
+	if (has_pending_)
+	{
+		write_point(pending_, pending_e_delta_, pending_feature_type_, pending_layer_);
+		anchor_ = pending_;
+		merged_.clear();
+		has_pending_ = false;
+	}
+	is_finished_.store(true, octolapse_sync::memory_order_release);
+}
+
+bool toolpath_recorder::is_finished() const
+{
+	return is_finished_.load(octolapse_sync::memory_order_acquire);
+}
+
+double toolpath_recorder::get_tolerance() const
+{
+	return tolerance_;
+}
+
+long toolpath_recorder::get_point_count() const
+{
+	return point_count_;
+}
+
+long toolpath_recorder::get_move_count() const
+{
+	return move_count_;
+}
+#pragma endregion toolpath_recorder
+
+#pragma region ToolpathColumn
+static int toolpath_column_getbuffer(PyObject * self, Py_buffer * view, int flags)
+{
+	toolpath_column_object * p_column = reinterpret_cast<toolpath_column_object*>(self);
+	if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+	{
+		// The buffer protocol requires an exception here
+		PyErr_SetString(PyExc_BufferError, "ToolpathColumn is read only.");
+		view->obj = NULL;
+		return -1;
+	}
+	view->buf = p_column->p_data->empty() ? NULL : &(*p_column->p_data)[0];
+	view->obj = self;
+	Py_INCREF(self);
+	view->len = p_column->length * p_column->item_size;
+	view->readonly = 1;
+	view->itemsize = p_column->item_size;
+	view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? p_column->format : NULL;
+	view->ndim = 1;
+	view->shape = (flags & PyBUF_ND) == PyBUF_ND ? &p_column->length : NULL;
+	view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? &p_column->item_size : NULL;
+	view->suboffsets = NULL;
+	view->internal = NULL;
+	return 0;
+}
+
+static Py_ssize_t toolpath_column_length(PyObject * self)
+{
+	return reinterpret_cast<toolpath_column_object*>(self)->length;
+}
+
+static void toolpath_column_dealloc(PyObject * self)
+{
+	delete reinterpret_cast<toolpath_column_object*>(self)->p_data;
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyBufferProcs toolpath_column_buffer_procs;
+static PySequenceMethods toolpath_column_sequence_methods;
+
+PyTypeObject toolpath_column_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.ToolpathColumn"
+};
+
+/**
+ * \brief Creates a ToolpathColumn that takes the values of the column, leaving it empty.
+ */
+static PyObject * toolpath_column_create(toolpath_column& column)
+{
+	PyObject * py_column = toolpath_column_type.tp_alloc(&toolpath_column_type, 0);
+	if (py_column == NULL)
+	{
+		std::string message = "toolpath_column_create - Unable to allocate a ToolpathColumn.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return NULL;
+	}
+	toolpath_column_object * p_column = reinterpret_cast<toolpath_column_object*>(py_column);
+	p_column->p_data = new std::vector<unsigned char>();
+	p_column->p_data->swap(column.get_data());
+	p_column->format[0] = column.get_format();
+	p_column->format[1] = '\0';
+	p_column->item_size = static_cast<Py_ssize_t>(column.get_item_size());
+	p_column->length = static_cast<Py_ssize_t>(p_column->p_data->size()) / p_column->item_size;
+	return py_column;
+}
+#pragma endregion ToolpathColumn
+
+#pragma region Toolpath
+static PyObject * toolpath_GetColumns(PyObject * self, PyObject * args)
+{
+	toolpath_object * p_toolpath = reinterpret_cast<toolpath_object*>(self);
+	// The columns belong to the processing thread until the run is over.
+	if (!p_toolpath->p_toolpath->is_finished())
+	{
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	if (p_toolpath->py_columns == NULL)
+	{
+		toolpath_recorder * p_recorder = p_toolpath->p_toolpath;
+		PyObject * py_columns = Py_BuildValue(
+			"{s:N,s:N,s:N,s:N,s:N,s:N}",
+			"x", toolpath_column_create(p_recorder->x),
+			"y", toolpath_column_create(p_recorder->y),
+			"z", toolpath_column_create(p_recorder->z),
+			"e_delta", toolpath_column_create(p_recorder->e_delta),
+			"feature_type", toolpath_column_create(p_recorder->feature_type),
+			"layer", toolpath_column_create(p_recorder->layer)
+		);
+		if (py_columns == NULL)
+		{
+			std::string message = "GcodePositionProcessor.Toolpath.GetColumns - Unable to build the column dict.";
+			octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+			return NULL;
+		}
+		p_toolpath->py_columns = py_columns;
+	}
+	Py_INCREF(p_toolpath->py_columns);
+	return p_toolpath->py_columns;
+}
+
+static PyObject * toolpath_GetPointCount(PyObject * self, PyObject * args)
+{
+	return PyLong_FromLong(reinterpret_cast<toolpath_object*>(self)->p_toolpath->get_point_count());
+}
+
+static PyObject * toolpath_GetMoveCount(PyObject * self, PyObject * args)
+{
+	return PyLong_FromLong(reinterpret_cast<toolpath_object*>(self)->p_toolpath->get_move_count());
+}
+
+static PyObject * toolpath_GetTolerance(PyObject * self, PyObject * args)
+{
+	return PyFloat_FromDouble(reinterpret_cast<toolpath_object*>(self)->p_toolpath->get_tolerance());
+}
+
+static void toolpath_dealloc(PyObject * self)
+{
+	toolpath_object * p_toolpath = reinterpret_cast<toolpath_object*>(self);
+	Py_XDECREF(p_toolpath->py_columns);
+	delete p_toolpath->p_toolpath;
+	Py_TYPE(self)->tp_free(self);
+}
+
+static PyMethodDef toolpath_methods[] = {
+	{ "GetColumns", (PyCFunction)toolpath_GetColumns, METH_NOARGS, "Returns {'x', 'y', 'z', 'e_delta', 'feature_type', 'layer'} as ToolpathColumns, which support the buffer protocol, or None if no run has finished." },
+	{ "GetPointCount", (PyCFunction)toolpath_GetPointCount, METH_NOARGS, "Returns the number of toolpath points that were kept." },
+	{ "GetMoveCount", (PyCFunction)toolpath_GetMoveCount, METH_NOARGS, "Returns the number of moves that were recorded before decimation." },
+	{ "GetTolerance", (PyCFunction)toolpath_GetTolerance, METH_NOARGS, "Returns the decimation tolerance in mm." },
+	{ NULL, NULL, 0, NULL }
+};
+
+PyTypeObject toolpath_type = {
+	PyVarObject_HEAD_INIT(NULL, 0)
+	"GcodePositionProcessor.Toolpath"
+};
+
+static bool toolpath_add_type(PyObject * module, PyTypeObject * p_type, const char * name)
+{
+	if (PyType_Ready(p_type) < 0)
+	{
+		std::string message = "toolpath_add_types - Unable to ready the ";
+		message += name;
+		message += " type.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	Py_INCREF(p_type);
+	if (PyModule_AddObject(module, name, reinterpret_cast<PyObject*>(p_type)) < 0)
+	{
+		Py_DECREF(p_type);
+		std::string message = "toolpath_add_types - Unable to add the ";
+		message += name;
+		message += " type to the module.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return false;
+	}
+	return true;
+}
+
+bool toolpath_add_types(PyObject * module)
+{
+	toolpath_column_buffer_procs.bf_getbuffer = toolpath_column_getbuffer;
+	toolpath_column_buffer_procs.bf_releasebuffer = NULL;
+	toolpath_column_sequence_methods.sq_length = toolpath_column_length;
+	toolpath_column_type.tp_basicsize = sizeof(toolpath_column_object);
+#if PY_MAJOR_VERSION >= 3
+	toolpath_column_type.tp_flags = Py_TPFLAGS_DEFAULT;
+#else
+	toolpath_column_type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+	toolpath_column_type.tp_doc = "A read only toolpath column.  Supports the buffer protocol, so it can be read with memoryview or numpy.frombuffer.";
+	toolpath_column_type.tp_dealloc = toolpath_column_dealloc;
+	toolpath_column_type.tp_as_buffer = &toolpath_column_buffer_procs;
+	toolpath_column_type.tp_as_sequence = &toolpath_column_sequence_methods;
+	toolpath_type.tp_basicsize = sizeof(toolpath_object);
+	toolpath_type.tp_flags = Py_TPFLAGS_DEFAULT;
+	toolpath_type.tp_doc = "A decimated toolpath recorded while processing.  Returned by CreateToolpath.";
+	toolpath_type.tp_dealloc = toolpath_dealloc;
+	toolpath_type.tp_methods = toolpath_methods;
+	return toolpath_add_type(module, &toolpath_column_type, "ToolpathColumn") && toolpath_add_type(module, &toolpath_type, "Toolpath");
+}
+
+PyObject * toolpath_create(const double tolerance)
+{
+	PyObject * py_toolpath = toolpath_type.tp_alloc(&toolpath_type, 0);
+	if (py_toolpath == NULL)
+	{
+		std::string message = "toolpath_create - Unable to allocate a Toolpath.";
+		octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+		return NULL;
+	}
+	toolpath_object * p_toolpath = reinterpret_cast<toolpath_object*>(py_toolpath);
+	p_toolpath->p_toolpath = new toolpath_recorder(tolerance);
+	p_toolpath->py_columns = NULL;
+	return py_toolpath;
+}
+
+toolpath_recorder * toolpath_prepare(PyObject * py_toolpath)
+{
+	if (!PyObject_TypeCheck(py_toolpath, &toolpath_type))
+		return NULL;
+	toolpath_object * p_toolpath = reinterpret_cast<toolpath_object*>(py_toolpath);
+	// Columns that were already handed out own their values, so they are unaffected.
+	Py_CLEAR(p_toolpath->py_columns);
+	p_toolpath->p_toolpath->clear();
+	return p_toolpath->p_toolpath;
+}
+#pragma endregion Toolpath
@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TOOLPATH_RECORDER_H
+#define TOOLPATH_RECORDER_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <vector>
+#include <cstring>
+#include "threads.h"
+#include "position.h"
+
+// The decimation tolerance in mm used when CreateToolpath is called without one.
+#define TOOLPATH_DEFAULT_TOLERANCE 0.05
+// The most moves that are merged into a single toolpath segment, which bounds the work done for each move.
+#define TOOLPATH_MAX_MERGED_MOVES 256
+// G2/G3 arcs are divided into chords that stray at most this far from the arc when the tolerance is 0 or less, and
+// into at most this many chords.
+#define TOOLPATH_DEFAULT_ARC_TOLERANCE 0.01
+#define TOOLPATH_MAX_ARC_CHORDS 64
+
+/**
+ * \brief A single column of the toolpath, stored as the bytes of contiguous values so that it can be handed to a
+ * ToolpathColumn without a copy.
+ */
+class toolpath_column
+{
+public:
+	toolpath_column(char format, size_t item_size);
+	template <typename T>
+	inline void push_back(const T value)
+	{
+		const size_t size = data_.size();
+		data_.resize(size + sizeof(T));
+		memcpy(&data_[size], &value, sizeof(T));
+	}
+	void clear();
+	char get_format() const;
+	size_t get_item_size() const;
+	std::vector<unsigned char>& get_data();
+private:
+	char format_;
+	size_t item_size_;
+	std::vector<unsigned char> data_;
+};
+
+/**
+ * \brief Records the positions of a processing run as a decimated toolpath with one row per point.
+ * Each row has x, y, z and e_delta (float32), feature_type (int8) and layer (int32).  e_delta is the extrusion of the
+ * segment that ends at the point, so segments with an e_delta of 0 or less are travel moves.  Moves are merged into a
+ * single segment while they have the same layer, feature type and travel or extrusion, and while every merged point
+ * stays within the tolerance of the merged segment.  A tolerance of 0 or less keeps every move.  G2/G3 arcs are
+ * divided into chords that stay within the tolerance of the arc.
+ * Only the processing thread may record, and the columns may only be read once the run has finished.
+ */
+class toolpath_recorder
+{
+public:
+	explicit toolpath_recorder(double tolerance);
+	void clear();
+	/**
+	 * \brief Records the move from the previous position to the current one.  Moves that don't change x, y or z, and
+	 * moves from an unknown position, are skipped.
+	 */
+	void add(const position* p_current_pos, const position* p_previous_pos);
+	/**
+	 * \brief Writes the segment that is still being merged.  The columns are complete afterwards.
+	 */
+	void finish();
+	bool is_finished() const;
+	double get_tolerance() const;
+	long get_point_count() const;
+	long get_move_count() const;
+	toolpath_column x;
+	toolpath_column y;
+	toolpath_column z;
+	toolpath_column e_delta;
+	toolpath_column feature_type;
+	toolpath_column layer;
+private:
+	toolpath_recorder(const toolpath_recorder& source);
+	struct toolpath_point
+	{
+		double x;
+		double y;
+		double z;
+	};
+	void add_point(const toolpath_point& point, double e_delta, int feature_type, long layer);
+	void write_point(const toolpath_point& point, double e_delta, int feature_type, long layer);
+	bool can_merge(const toolpath_point& end, double e_delta, int feature_type, long layer) const;
+	double tolerance_;
+	long point_count_;
+	long move_count_;
+	bool has_anchor_;
+	bool has_pending_;
+	// The last point that was written, where the segment being merged starts.
+	toolpath_point anchor_;
+	// The end of the segment being merged, and the points that were merged into it.
+	toolpath_point pending_;
+	double pending_e_delta_;
+	int pending_feature_type_;
+	long pending_layer_;
+	std::vector<toolpath_point> merged_;
+	octolapse_sync::atomic<bool> is_finished_;
+};
+
+/**
+ * \brief A python object that owns a toolpath_recorder.  Returned by CreateToolpath.
+ */
+typedef struct {
+	PyObject_HEAD
+	toolpath_recorder * p_toolpath;
+	// The ToolpathColumn dict, created by the first GetColumns call after a run.
+	PyObject * py_columns;
+} toolpath_object;
+
+/**
+ * \brief A read only column that supports the buffer protocol.  It owns its values, so it stays valid after the
+ * Toolpath is reused.
+ */
+typedef struct {
+	PyObject_HEAD
+	std::vector<unsigned char> * p_data;
+	char format[2];
+	Py_ssize_t item_size;
+	Py_ssize_t length;
+} toolpath_column_object;
+
+extern PyTypeObject toolpath_type;
+extern PyTypeObject toolpath_column_type;
+
+/**
+ * \brief Readies the Toolpath and ToolpathColumn types and adds them to the module.  Returns false on failure.
+ */
+bool toolpath_add_types(PyObject * module);
+PyObject * toolpath_create(double tolerance);
+/**
+ * \brief Clears a Toolpath before it is recorded again and returns its toolpath_recorder, or NULL if py_toolpath is
+ * some other object.  Call with the GIL held.
+ */
+toolpath_recorder * toolpath_prepare(PyObject * py_toolpath);
+#endif
@@ -82,6 +82,18 @@ trigger_positions::trigger_positions()
 	slowest_extrusion_speed_ = -1;
 	stabilization_x_ = 0;
 	stabilization_y_ = 0;
+	has_previous_initial_pos_ = false;
+	previous_initial_x_ = 0;
+	previous_initial_y_ = 0;
+	previous_retracted_index_ = -1;
+	previous_primed_index_ = -1;
+	previous_primed_x_ = 0;
+	previous_primed_y_ = 0;
+	previous_primed_z_ = 0;
+	for (unsigned int index = 0; index < TRIGGER_POSITION_STORE_SIZE; index++)
+	{
+		stored_position_references_[index] = 0;
+	}
 }
 
 trigger_positions::~trigger_positions()
@@ -104,8 +116,91 @@ void trigger_positions::set_stabilization_coordinates(double x, double y)
 
 void trigger_positions::set_previous_initial_position(position &pos)
 {
-	previous_initial_pos_ = pos;
-	previous_initial_pos_.is_empty = false;
+	// Only the xy coordinates are used to break ties
+	previous_initial_x_ = pos.x;
+	previous_initial_y_ = pos.y;
+	has_previous_initial_pos_ = true;
+}
+
+int trigger_positions::acquire_position(position* p_pos)
+{
+	// Positions are never changed once they are tracked, so a position with the same line and gcode number is the
+	// same position, unless one of them is part of the way along an arc.
+	int free_index = -1;
+	for (int index = 0; index < static_cast<int>(TRIGGER_POSITION_STORE_SIZE); index++)
+	{
+		if (stored_position_references_[index] == 0)
+		{
+			if (free_index < 0)
+				free_index = index;
+		}
+		else if (
+			stored_positions_[index].file_line_number == p_pos->file_line_number &&
+			stored_positions_[index].gcode_number == p_pos->gcode_number &&
+			stored_positions_[index].x == p_pos->x &&
+			stored_positions_[index].y == p_pos->y
+		)
+		{
+			stored_position_references_[index]++;
+			return index;
+		}
+	}
+	// There is one entry for every reference, so a free entry always exists.
+	stored_positions_[free_index] = *p_pos;
+	stored_position_references_[free_index] = 1;
+	if (p_pos == &arc_split_position_)
+	{
+		stored_start_commands_[free_index] = arc_start_command_;
+		stored_end_commands_[free_index] = arc_end_command_;
+	}
+	else if (!stored_start_commands_[free_index].is_empty)
+	{
+		stored_start_commands_[free_index].clear();
+		stored_end_commands_[free_index].clear();
+	}
+	return free_index;
+}
+
+void trigger_positions::release_position(const int store_index)
+{
+	if (store_index > -1 && stored_position_references_[store_index] > 0)
+		stored_position_references_[store_index]--;
+}
+
+void trigger_positions::set_stored_position(int& store_index, position* p_pos)
+{
+	// Acquire before releasing so that replacing a position with itself doesn't copy it.
+	const int new_index = acquire_position(p_pos);
+	release_position(store_index);
+	store_index = new_index;
+}
+
+void trigger_positions::set_candidate(trigger_candidate& candidate, position* p_pos, const double distance)
+{
+	if (candidate.is_empty)
+		candidate.store_index = -1;
+	set_stored_position(candidate.store_index, p_pos);
+	candidate.distance = distance;
+	// The comparisons allow for the zero tolerance, so allow for twice as much to be safe from rounding.
+	const double reject_distance = distance + 2 * utilities::get_zero_tolerance();
+	candidate.reject_distance_squared = reject_distance * reject_distance;
+	candidate.x = p_pos->x;
+	candidate.y = p_pos->y;
+	candidate.f = p_pos->f;
+	candidate.is_empty = false;
+}
+
+void trigger_positions::materialize(const trigger_candidate& candidate, trigger_position& pos) const
+{
+	pos.is_empty = candidate.is_empty;
+	if (candidate.is_empty)
+		return;
+	pos.type_position = candidate.type_position;
+	pos.type_feature = candidate.type_feature;
+	pos.distance = candidate.distance;
+	pos.pos = stored_positions_[candidate.store_index];
+	pos.start_command = stored_start_commands_[candidate.store_index];
+	pos.end_command = stored_end_commands_[candidate.store_index];
 }
 
 bool trigger_positions::is_empty() const
@@ -151,7 +246,7 @@ bool trigger_positions::has_fastest_extrusion_position() const
 		if (position_list_[position_type_fastest_extrusion].is_empty)
 			return false;
 
-		if (utilities::greater_than(args_.minimum_speed, 0) && utilities::greater_than_or_equal(position_list_[position_type_fastest_extrusion].pos.f, args_.minimum_speed))
+		if (utilities::greater_than(args_.minimum_speed, 0) && utilities::greater_than_or_equal(position_list_[position_type_fastest_extrusion].f, args_.minimum_speed))
 		{
 			return true;
 		}
@@ -183,17 +278,17 @@ bool trigger_positions::get_snap_to_print_position(trigger_position &pos)
 		}
 		if (current_closest_index > -1)
 		{
-			pos = feature_position_list_[current_closest_index];
+			materialize(feature_position_list_[current_closest_index], pos);
 			return true;
 		}
 
 		if (has_fastest_position)
 		{
-			pos = position_list_[position_type_fastest_extrusion];
+			materialize(position_list_[position_type_fastest_extrusion], pos);
 		}
 		else
 		{
-			pos = position_list_[position_type_extrusion];
+			materialize(position_list_[position_type_extrusion], pos);
 		}
 		return !pos.is_empty;
 	}
@@ -206,17 +301,17 @@ bool trigger_positions::get_snap_to_print_position(trigger_position &pos)
 
 	if (position_list_[position_type_extrusion].is_empty)
 	{
-		pos = position_list_[position_type_fastest_extrusion];
+		materialize(position_list_[position_type_fastest_extrusion], pos);
 		return true;
 	}
 	
 	// if the p_extrusion distance is less than or equal to the p_fastest_extrusion distance, return that.
 	if (utilities::less_than_or_equal(position_list_[position_type_extrusion].distance, position_list_[position_type_fastest_extrusion].distance))
 	{
-		pos = position_list_[position_type_extrusion];
+		materialize(position_list_[position_type_extrusion], pos);
 	}
 	else
-		pos = position_list_[position_type_fastest_extrusion];
+		materialize(position_list_[position_type_fastest_extrusion], pos);
 
 	// return p_fastest_extrusion, which is equal to or less than the travel distance of p_extrusion
 	return true;
@@ -237,7 +332,7 @@ bool trigger_positions::get_fast_position(trigger_position &pos)
 	}
 	if (current_closest_index > -1)
 	{
-		pos = position_list_[current_closest_index];
+		materialize(position_list_[current_closest_index], pos);
 		return true;
 	}
 	return false;
@@ -249,21 +344,20 @@ bool trigger_positions::get_compatibility_position(trigger_position &pos)
 	{
 		if (!feature_position_list_[index].is_empty)
 		{
-			pos = feature_position_list_[index];
+			materialize(feature_position_list_[index], pos);
 			return true;
 		}
 	}
-	int current_best_index = -1;
 	for (int index = trigger_position::num_position_types - 1; index > -1; index--)
 	{
 		if (index == position_type_fastest_extrusion && has_fastest_extrusion_position())
 		{
-			pos = position_list_[index];
+			materialize(position_list_[index], pos);
 			return true;
 		}
 		else if (!position_list_[index].is_empty)
 		{
-			pos = position_list_[index];
+			materialize(position_list_[index], pos);
 			return true;
 		}
 	}
@@ -276,7 +370,7 @@ bool trigger_positions::get_high_quality_position(trigger_position &pos)
 	{
 		if (!feature_position_list_[index].is_empty)
 		{
-			pos = feature_position_list_[index];
+			materialize(feature_position_list_[index], pos);
 			return true;
 		}
 	}
@@ -286,14 +380,14 @@ bool trigger_positions::get_high_quality_position(trigger_position &pos)
 		{
 			if (has_fastest_extrusion_position())
 			{
-				pos = position_list_[index];
+				materialize(position_list_[index], pos);
 				return true;
 			}
 			continue;
 		}
 		else if (!position_list_[index].is_empty)
 		{
-			pos = position_list_[index];
+			materialize(position_list_[index], pos);
 			return true;
 		}
 	}
@@ -303,17 +397,28 @@ bool trigger_positions::get_high_quality_position(trigger_position &pos)
 void trigger_positions::try_save_retracted_position(position* p_current_pos)
 {
 	if (p_current_pos->get_current_extruder().is_retracted)
-		previous_retracted_pos_ = *p_current_pos;
+		set_stored_position(previous_retracted_index_, p_current_pos);
 	else if (p_current_pos->get_current_extruder().is_extruding && !p_current_pos->get_current_extruder().is_extruding_start)
-		previous_retracted_pos_.is_empty = true;
+	{
+		release_position(previous_retracted_index_);
+		previous_retracted_index_ = -1;
+	}
 }
 
 void trigger_positions::try_save_primed_position(position* p_current_pos)
 {
 	if (p_current_pos->get_current_extruder().is_primed)
-		previous_primed_pos_ = *p_current_pos;
+	{
+		set_stored_position(previous_primed_index_, p_current_pos);
+		previous_primed_x_ = p_current_pos->x;
+		previous_primed_y_ = p_current_pos->y;
+		previous_primed_z_ = p_current_pos->z;
+	}
 	else if (p_current_pos->get_current_extruder().is_extruding && !p_current_pos->get_current_extruder().is_extruding_start)
-		previous_primed_pos_.is_empty = true;
+	{
+		release_position(previous_primed_index_);
+		previous_primed_index_ = -1;
+	}
 }
 
 void trigger_positions::clear()
@@ -321,9 +426,14 @@ void trigger_positions::clear()
 	// reset all tracking variables
 	fastest_extrusion_speed_ = -1;
 	slowest_extrusion_speed_ = -1;
-	previous_initial_pos_.is_empty = true;
-	previous_retracted_pos_.is_empty = true;
-	previous_primed_pos_.is_empty = true;
+	has_previous_initial_pos_ = false;
+	previous_retracted_index_ = -1;
+	previous_primed_index_ = -1;
+	// Release every stored position
+	for (unsigned int index = 0; index < TRIGGER_POSITION_STORE_SIZE; index++)
+	{
+		stored_position_references_[index] = 0;
+	}
 
 	// clear out any saved positions
 	for (unsigned int index = 0; index < trigger_position::num_position_types; index++)
@@ -340,7 +450,9 @@ void trigger_positions::clear()
 
 trigger_position trigger_positions::get(const position_type type)
 {
-	return position_list_[type];
+	trigger_position pos;
+	materialize(position_list_[type], pos);
+	return pos;
 }
 
 
@@ -371,10 +483,10 @@ bool trigger_positions::can_process_position(position* pos, const position_type
 }
 
 
-double trigger_positions::get_stabilization_distance(position* p_pos) const
+double trigger_positions::get_stabilization_distance_squared(position* p_pos) const
 {
 	double x, y;
-	if (args_.x_stabilization_disabled && previous_initial_pos_.is_empty)
+	if (args_.x_stabilization_disabled && !has_previous_initial_pos_)
 	{
 		x = p_pos->x;
 	}
@@ -382,7 +494,7 @@ double trigger_positions::get_stabilization_distance(position* p_pos) const
 	{
 		x = stabilization_x_;
 	}
-	if (args_.y_stabilization_disabled && previous_initial_pos_.is_empty)
+	if (args_.y_stabilization_disabled && !has_previous_initial_pos_)
 	{
 		y = p_pos->y;
 	}
@@ -391,7 +503,49 @@ double trigger_positions::get_stabilization_distance(position* p_pos) const
 		y = stabilization_y_;
 	}
 
-	return utilities::get_cartesian_distance(p_pos->x, p_pos->y, x, y);
+	return utilities::get_cartesian_distance_squared(p_pos->x, p_pos->y, x, y);
+}
+
+bool trigger_positions::may_add_candidate(const stabilization_distance& distance, position* p_pos, const position_type type) const
+{
+	// If a position can't replace any of these, try_add won't add it.  The fastest extrusion doesn't depend on the
+	// distance unless the speed ties.
+	return distance.may_replace(position_list_[type]) ||
+		(
+			p_pos->feature_type_tag != feature_type::feature_type_unknown_feature &&
+			distance.may_replace(feature_position_list_[p_pos->feature_type_tag])
+		) ||
+		(type == position_type_extrusion && utilities::greater_than_or_equal(p_pos->f, fastest_extrusion_speed_));
+}
+
+position* trigger_positions::get_arc_candidate_position(position* p_current_pos, position* p_previous_pos, const position_type type)
+{
+	// A disabled axis follows the position itself, so the closest point on the arc is only known when there is a
+	// stabilization point for both axes.
+	if (!has_previous_initial_pos_ && (args_.x_stabilization_disabled || args_.y_stabilization_disabled))
+		return p_current_pos;
+	if (!arc_.try_set_circle(p_current_pos->command, p_previous_pos->x, p_previous_pos->y, p_current_pos->x, p_current_pos->y))
+		return p_current_pos;
+	// Every point on the arc is equally close to its center, so the end of the arc is as good as any.
+	if (utilities::is_equal(arc_.center_x, stabilization_x_) && utilities::is_equal(arc_.center_y, stabilization_y_))
+		return p_current_pos;
+	// Splitting copies the position, so only split if the closest point could replace a candidate.  If no point on
+	// the circle is close enough, the arc isn't either.
+	if (!may_add_candidate(stabilization_distance(arc_.get_circle_distance_squared(stabilization_x_, stabilization_y_)), p_current_pos, type))
+		return p_current_pos;
+
+	arc_.set_sweep();
+	const double fraction = arc_.get_closest_fraction(stabilization_x_, stabilization_y_);
+	// Don't split off a part of the arc that is too short to move.
+	if (!utilities::greater_than(arc_.length * fraction, 0) || !utilities::greater_than(arc_.length * (1.0 - fraction), 0))
+		return p_current_pos;
+	double x, y;
+	arc_.get_point(fraction, x, y);
+	if (!may_add_candidate(stabilization_distance(utilities::get_cartesian_distance_squared(x, y, stabilization_x_, stabilization_y_)), p_current_pos, type))
+		return p_current_pos;
+	if (!arc_.split(*p_previous_pos, *p_current_pos, fraction, arc_split_position_, arc_start_command_, arc_end_command_))
+		return p_current_pos;
+	return &arc_split_position_;
 }
 
 /// Try to add a position to the position list.  Returns false if no position can be added.
@@ -406,6 +560,10 @@ void trigger_positions::try_add(position *p_current_pos, position *p_previous_po
 		return;
 	}
 
+	// The saved retracted and primed positions are used as the start of the next extrusion, so they are always the
+	// end of the move.  The candidates can be part of the way along an arc.
+	position* p_candidate_pos = get_arc_candidate_position(p_current_pos, p_previous_pos, type);
+	stabilization_distance distance(get_stabilization_distance_squared(p_candidate_pos));
 	// add any feature positions if a feature tag exists, and if we are in high quality or compatibility mode
 	if (
 		p_current_pos->feature_type_tag != feature_type::feature_type_unknown_feature &&
@@ -419,28 +577,33 @@ void trigger_positions::try_add(position *p_current_pos, position *p_previous_po
 		// only add features if we are extruding.
 		if (p_current_pos->get_current_extruder().is_extruding)
 		{
-			try_add_feature_position_internal(p_current_pos);
+			try_add_feature_position_internal(p_candidate_pos, distance);
 			if (p_current_pos->get_current_extruder().is_extruding_start)
 			{
 				// if this is an extrusion_stat (also an extrusion), we will want to add the
 				// starting point of the extrusion as well , which would not have been marked as an extrusion
-				position* start_pos = NULL;
-				// set the latest saved retracted (preferred) or primed position
-				if (!previous_retracted_pos_.is_empty)
-					start_pos = &previous_retracted_pos_;
-				else
-					start_pos = &previous_primed_pos_;
+				// use the latest saved retracted (preferred) or primed position.  The primed coordinates are kept
+				// after the primed position is cleared, so they are compared even if there is no primed position.
+				double start_x = previous_primed_x_;
+				double start_y = previous_primed_y_;
+				double start_z = previous_primed_z_;
+				if (previous_retracted_index_ > -1)
+				{
+					start_x = stored_positions_[previous_retracted_index_].x;
+					start_y = stored_positions_[previous_retracted_index_].y;
+					start_z = stored_positions_[previous_retracted_index_].z;
+				}
 				
 				if (
-					start_pos != NULL &&
-					start_pos->x == p_previous_pos->x &&
-					start_pos->y == p_previous_pos->y &&
-					start_pos->z == p_previous_pos->z
+					start_x == p_previous_pos->x &&
+					start_y == p_previous_pos->y &&
+					start_z == p_previous_pos->z
 					)
 				{
 					// If we have a starting position that matches the previous position (retracted or primed)
 					// try to add the previous position to the feature position list
-					try_add_feature_position_internal(p_previous_pos);
+					stabilization_distance previous_distance(get_stabilization_distance_squared(p_previous_pos));
+					try_add_feature_position_internal(p_previous_pos, previous_distance);
 				}
 			}
 		}
@@ -456,9 +619,7 @@ void trigger_positions::try_add(position *p_current_pos, position *p_previous_po
 		try_save_primed_position(p_current_pos);
 		
 	}
-	const double distance = get_stabilization_distance(p_current_pos);
-	//std::cout << "Distance:" << distance << "\r\n";
-	try_add_internal(p_current_pos, distance, type);
+	try_add_internal(p_candidate_pos, distance, type);
 
 	// If we are using snap to print, and the current position is = is_extruding_start
 	if (args_.type == trigger_type_snap_to_print)
@@ -470,32 +631,38 @@ void trigger_positions::try_add(position *p_current_pos, position *p_previous_po
 		}
 		else if (p_current_pos->get_current_extruder().is_extruding)
 		{
-			previous_retracted_pos_.is_empty = true;
-			previous_primed_pos_.is_empty = true;
+			release_position(previous_retracted_index_);
+			previous_retracted_index_ = -1;
+			release_position(previous_primed_index_);
+			previous_primed_index_ = -1;
 		}
 	}
 	
 }
 
-void trigger_positions::try_add_feature_position_internal(position * p_pos)
+void trigger_positions::try_add_feature_position_internal(position * p_pos, stabilization_distance& distance)
 {
 	bool add_position = false;
-	const double distance = get_stabilization_distance(p_pos);
 	const feature_type type = static_cast<feature_type>(p_pos->feature_type_tag);
 
 	if (feature_position_list_[type].is_empty)
 	{
 		add_position = true;
 	}
-	else if (utilities::less_than(distance, feature_position_list_[type].distance))
+	else if (!distance.may_replace(feature_position_list_[type]))
+	{
+		// Too far away to be closer or to tie
+		add_position = false;
+	}
+	else if (utilities::less_than(distance.get(), feature_position_list_[type].distance))
 	{
 		add_position = true;
 	}
-	else if (utilities::is_equal(feature_position_list_[type].distance, distance) && !previous_initial_pos_.is_empty)
+	else if (utilities::is_equal(feature_position_list_[type].distance, distance.get()) && has_previous_initial_pos_)
 	{
 		//std::cout << "Closest position tie detected, ";
-		const double old_distance_from_previous = utilities::get_cartesian_distance(feature_position_list_[type].pos.x, feature_position_list_[type].pos.y, previous_initial_pos_.x, previous_initial_pos_.y);
-		const double new_distance_from_previous = utilities::get_cartesian_distance(p_pos->x, p_pos->y, previous_initial_pos_.x, previous_initial_pos_.y);
+		const double old_distance_from_previous = utilities::get_cartesian_distance(feature_position_list_[type].x, feature_position_list_[type].y, previous_initial_x_, previous_initial_y_);
+		const double new_distance_from_previous = utilities::get_cartesian_distance(p_pos->x, p_pos->y, previous_initial_x_, previous_initial_y_);
 		if (utilities::less_than(new_distance_from_previous, old_distance_from_previous))
 		{
 			//std::cout << "new is closer to the last initial snapshot position.\r\n";
@@ -507,41 +674,36 @@ void trigger_positions::try_add_feature_position_internal(position * p_pos)
 	if (add_position)
 	{
 		// add the current position as the fastest extrusion speed 
-		add_feature_position_internal(p_pos, distance, static_cast<feature_type>(type));
+		add_feature_position_internal(p_pos, distance.get(), static_cast<feature_type>(type));
 	}
 }
 
 void trigger_positions::add_feature_position_internal(position *p_pos, double distance, feature_type type)
 {
-	feature_position_list_[p_pos->feature_type_tag].pos = *p_pos;
-	feature_position_list_[p_pos->feature_type_tag].distance = distance;
+	set_candidate(feature_position_list_[p_pos->feature_type_tag], p_pos, distance);
 	feature_position_list_[p_pos->feature_type_tag].type_feature = type;
-	feature_position_list_[p_pos->feature_type_tag].is_empty = false;
-
 }
 
 // Adds a position to the internal position list.
 void trigger_positions::add_internal(position *p_pos, double distance, position_type type)
 {
-	position_list_[type].pos = *p_pos;
-	position_list_[type].distance = distance;
+	set_candidate(position_list_[type], p_pos, distance);
 	position_list_[type].type_position = type;
-	position_list_[type].is_empty = false;
-
 }
 
 void trigger_positions::try_add_extrusion_start_positions(position* p_extrusion_start_pos)
 {
 	// Try to add the start of the extrusion to the snap to print stabilization
-	if (!previous_retracted_pos_.is_empty)
-		try_add_extrusion_start_position(p_extrusion_start_pos, previous_retracted_pos_);
-	else if (!previous_primed_pos_.is_empty)
-		try_add_extrusion_start_position( p_extrusion_start_pos, previous_primed_pos_);
+	if (previous_retracted_index_ > -1)
+		try_add_extrusion_start_position(p_extrusion_start_pos, previous_retracted_index_);
+	else if (previous_primed_index_ > -1)
+		try_add_extrusion_start_position( p_extrusion_start_pos, previous_primed_index_);
 
 }
 
-void trigger_positions::try_add_extrusion_start_position(position * p_extrusion_start_pos, position & saved_pos)
+void trigger_positions::try_add_extrusion_start_position(position * p_extrusion_start_pos, const int saved_index)
 {
+	position& saved_pos = stored_positions_[saved_index];
 	// A special case where we are trying to add a snap to print position from the start of an extrusion.
 	// Note that we do not need to add any checks for max speed or thresholds, since that will have been taken care of
 	if (
@@ -553,7 +715,7 @@ void trigger_positions::try_add_extrusion_start_position(position * p_extrusion_
 		return;
 	}
 
-	const double distance = get_stabilization_distance(&saved_pos);
+	const double distance = sqrt(get_stabilization_distance_squared(&saved_pos));
 
 	// See if we need to update the fastest extrusion position
 	if (
@@ -574,16 +736,16 @@ void trigger_positions::try_add_extrusion_start_position(position * p_extrusion_
 	{
 		add_position = true;
 	}
-	else if (utilities::is_equal(position_list_[position_type_extrusion].distance, distance) && !previous_initial_pos_.is_empty)
+	else if (utilities::is_equal(position_list_[position_type_extrusion].distance, distance) && has_previous_initial_pos_)
 	{
 		//std::cout << "Closest position tie detected, ";
 		const double old_distance_from_previous = utilities::get_cartesian_distance(
-			position_list_[position_type_extrusion].pos.x, 
-			position_list_[position_type_extrusion].pos.y, 
-			previous_initial_pos_.x, 
-			previous_initial_pos_.y
+			position_list_[position_type_extrusion].x, 
+			position_list_[position_type_extrusion].y, 
+			previous_initial_x_, 
+			previous_initial_y_
 		);
-		const double new_distance_from_previous = utilities::get_cartesian_distance(saved_pos.x, saved_pos.y, previous_initial_pos_.x, previous_initial_pos_.y);
+		const double new_distance_from_previous = utilities::get_cartesian_distance(saved_pos.x, saved_pos.y, previous_initial_x_, previous_initial_y_);
 		if (utilities::less_than(new_distance_from_previous, old_distance_from_previous))
 		{
 			//std::cout << "new is closer to the last initial snapshot position.\r\n";
@@ -599,7 +761,7 @@ void trigger_positions::try_add_extrusion_start_position(position * p_extrusion_
 }
 
 // Try to add a position to the internal position list.
-void trigger_positions::try_add_internal(position * p_pos, double distance, position_type type)
+void trigger_positions::try_add_internal(position * p_pos, stabilization_distance& distance, position_type type)
 {
 
 	// If this is an extrusion type position, we need to handle it with care since we want to track both the closest 
@@ -630,7 +792,8 @@ void trigger_positions::try_add_internal(position * p_pos, double distance, posi
 		}
 		else if (
 			utilities::is_equal(fastest_extrusion_speed_, p_pos->f)
-			&& utilities::less_than(distance, position_list_[position_type_fastest_extrusion].distance))
+			&& distance.may_replace(position_list_[position_type_fastest_extrusion])
+			&& utilities::less_than(distance.get(), position_list_[position_type_fastest_extrusion].distance))
 		{
 			add_fastest = true;
 		}
@@ -638,7 +801,7 @@ void trigger_positions::try_add_internal(position * p_pos, double distance, posi
 		if (add_fastest)
 		{
 			// add the current position as the fastest extrusion speed 
-			add_internal(p_pos, distance, position_type_fastest_extrusion);
+			add_internal(p_pos, distance.get(), position_type_fastest_extrusion);
 		}
 
 	}
@@ -651,15 +814,20 @@ void trigger_positions::try_add_internal(position * p_pos, double distance, posi
 	{
 		add_position = true;
 	}
-	else if (utilities::less_than(distance, position_list_[type].distance))
+	else if (!distance.may_replace(position_list_[type]))
+	{
+		// Too far away to be closer or to tie
+		add_position = false;
+	}
+	else if (utilities::less_than(distance.get(), position_list_[type].distance))
 	{
 		add_position = true;
 	}
-	else if (utilities::is_equal(position_list_[type].distance, distance) && !previous_initial_pos_.is_empty)
+	else if (utilities::is_equal(position_list_[type].distance, distance.get()) && has_previous_initial_pos_)
 	{
 		//std::cout << "Closest position tie detected, ";
-		const double old_distance_from_previous = utilities::get_cartesian_distance(position_list_[type].pos.x, position_list_[type].pos.y, previous_initial_pos_.x, previous_initial_pos_.y);
-		const double new_distance_from_previous = utilities::get_cartesian_distance(p_pos->x, p_pos->y, previous_initial_pos_.x, previous_initial_pos_.y);
+		const double old_distance_from_previous = utilities::get_cartesian_distance(position_list_[type].x, position_list_[type].y, previous_initial_x_, previous_initial_y_);
+		const double new_distance_from_previous = utilities::get_cartesian_distance(p_pos->x, p_pos->y, previous_initial_x_, previous_initial_y_);
 		if (utilities::less_than(new_distance_from_previous, old_distance_from_previous))
 		{
 			//std::cout << "new is closer to the last initial snapshot position.\r\n";
@@ -670,6 +838,6 @@ void trigger_positions::try_add_internal(position * p_pos, double distance, posi
 	if(add_position)
 	{
 		// add the current position as the fastest extrusion speed 
-		add_internal(p_pos, distance, type);
+		add_internal(p_pos, distance.get(), type);
 	}
 }
\ No newline at end of file
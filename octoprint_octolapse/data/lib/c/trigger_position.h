@@ -1,6 +1,8 @@
 #pragma once
 #include "position.h"
 #include "gcode_comment_processor.h"
+#include "gcode_arc.h"
+#include <cmath>
 
 /**
  * \brief A struct to hold the closest position, which  is used by the stabilization preprocessors.
@@ -80,9 +82,82 @@ struct trigger_position
 	feature_type type_feature;
 	double distance;
 	position pos;
+	/**
+	 * \brief When the position is part of the way along an arc, the first part of the arc and the rest of it.  These
+	 * are empty otherwise.
+	 */
+	parsed_command start_command;
+	parsed_command end_command;
+	bool is_empty;
+};
+
+/**
+ * \brief A compact record of a candidate trigger position.  Only the values used to compare candidates are stored
+ * here.  The full position is kept once in the trigger_positions store, however many candidates refer to it, and is
+ * only copied into a trigger_position when the winning candidate is requested.
+ */
+struct trigger_candidate
+{
+	trigger_candidate()
+	{
+		type_position = position_type_unknown;
+		type_feature = feature_type_unknown_feature;
+		distance = -1;
+		x = 0;
+		y = 0;
+		f = 0;
+		reject_distance_squared = 0;
+		store_index = -1;
+		is_empty = true;
+	}
+	position_type type_position;
+	feature_type type_feature;
+	double distance;
+	/**
+	 * \brief A position whose squared distance is at least this large can neither be closer than this candidate nor
+	 * tie with it, so it can be rejected without taking a square root.
+	 */
+	double reject_distance_squared;
+	double x;
+	double y;
+	double f;
+	int store_index;
 	bool is_empty;
 };
 
+/**
+ * \brief The distance from a position to the stabilization point.  Most positions are farther away than the current
+ * candidates, so the squared distance is compared first and the square root is only taken when it is needed.
+ */
+struct stabilization_distance
+{
+	explicit stabilization_distance(double squared_distance)
+	{
+		squared = squared_distance;
+		distance_ = -1;
+	}
+	double get()
+	{
+		if (distance_ < 0)
+			distance_ = sqrt(squared);
+		return distance_;
+	}
+	/**
+	 * \brief Returns false if the position is definitely farther from the stabilization point than the candidate.
+	 */
+	bool may_replace(const trigger_candidate& candidate) const
+	{
+		return candidate.is_empty || squared < candidate.reject_distance_squared;
+	}
+	double squared;
+private:
+	double distance_;
+};
+
+// The number of positions the trigger_positions store can hold, which is enough for every candidate slot and the
+// saved retracted and primed positions to refer to a different position.
+#define TRIGGER_POSITION_STORE_SIZE (trigger_position::num_position_types + NUM_FEATURE_TYPES + 2)
+
 struct trigger_position_args
 {
 public:
@@ -122,21 +197,46 @@ private:
 	bool get_compatibility_position(trigger_position &pos);
 	bool get_high_quality_position(trigger_position &pos);
 
-	double get_stabilization_distance(position* p_pos) const;
+	double get_stabilization_distance_squared(position* p_pos) const;
+	/**
+	 * \brief Returns the point along the current arc move that is closest to the stabilization point, so that the arc
+	 * is a single candidate, or p_current_pos if the move isn't an arc or its end is the closest point.
+	 */
+	position* get_arc_candidate_position(position* p_current_pos, position* p_previous_pos, position_type type);
+	/**
+	 * \brief Returns false if a position at this distance from the stabilization point would not be added as a
+	 * candidate.
+	 */
+	bool may_add_candidate(const stabilization_distance& distance, position* p_pos, position_type type) const;
 
 	//trigger_position* get_normal_quality_position();
 	void try_save_retracted_position(position* p_current_pos);
 	void try_save_primed_position(position* p_current_pos);
 	static bool can_process_position(position* pos, position_type type);
 	void add_internal(position* p_pos, double distance, position_type type);
-	void try_add_feature_position_internal(position * p_pos);
+	void try_add_feature_position_internal(position * p_pos, stabilization_distance& distance);
 	void add_feature_position_internal(position *p_pos, double distance, feature_type type);
-	void try_add_internal(position* p_pos, double distance, position_type type);
+	void try_add_internal(position* p_pos, stabilization_distance& distance, position_type type);
 	void try_add_extrusion_start_positions(position* p_extrusion_start_pos);
-	void try_add_extrusion_start_position(position* p_extrusion_start_pos, position& saved_pos);
+	void try_add_extrusion_start_position(position* p_extrusion_start_pos, int saved_index);
+	/**
+	 * \brief Adds a reference to the position in the store, copying it only if it isn't already stored.
+	 * \return The store index of the position.
+	 */
+	int acquire_position(position* p_pos);
+	void release_position(int store_index);
+	/**
+	 * \brief Replaces a stored position reference, releasing the old one.
+	 */
+	void set_stored_position(int& store_index, position* p_pos);
+	void set_candidate(trigger_candidate& candidate, position* p_pos, double distance);
+	/**
+	 * \brief Copies the candidate and its stored position into a trigger_position.
+	 */
+	void materialize(const trigger_candidate& candidate, trigger_position& pos) const;
 
-	trigger_position position_list_[trigger_position::num_position_types];
-	trigger_position feature_position_list_[NUM_FEATURE_TYPES];
+	trigger_candidate position_list_[trigger_position::num_position_types];
+	trigger_candidate feature_position_list_[NUM_FEATURE_TYPES];
 	// arguments
 	trigger_position_args args_;
 	double stabilization_x_;
@@ -144,9 +244,26 @@ private:
 	// Tracking variables
 	double fastest_extrusion_speed_;
 	double slowest_extrusion_speed_;
-	position previous_initial_pos_;
-	position previous_retracted_pos_;
-	position previous_primed_pos_;
+	bool has_previous_initial_pos_;
+	double previous_initial_x_;
+	double previous_initial_y_;
+	// Store indexes of the saved positions, or -1 if there is no saved position
+	int previous_retracted_index_;
+	int previous_primed_index_;
+	double previous_primed_x_;
+	double previous_primed_y_;
+	double previous_primed_z_;
+	// The positions referred to by the candidates and saved positions
+	position stored_positions_[TRIGGER_POSITION_STORE_SIZE];
+	int stored_position_references_[TRIGGER_POSITION_STORE_SIZE];
+	// The parts of the arc for stored positions that split an arc, or empty commands.
+	parsed_command stored_start_commands_[TRIGGER_POSITION_STORE_SIZE];
+	parsed_command stored_end_commands_[TRIGGER_POSITION_STORE_SIZE];
+	// The current arc, and the position where it is split along with the two parts of the arc.
+	gcode_arc arc_;
+	position arc_split_position_;
+	parsed_command arc_start_command_;
+	parsed_command arc_end_command_;
 	
 };
 
@@ -46,10 +46,19 @@ bool utilities::is_zero(double x)
 double utilities::get_cartesian_distance(double x1, double y1, double x2, double y2)
 {
 	// Compare the saved points cartesian distance from the current point
+	return sqrt(get_cartesian_distance_squared(x1, y1, x2, y2));
+}
+
+double utilities::get_cartesian_distance_squared(double x1, double y1, double x2, double y2)
+{
 	double xdif = x1 - x2;
 	double ydif = y1 - y2;
-	double dist_squared = xdif * xdif + ydif * ydif;
-	return sqrt(xdif*xdif + ydif * ydif);
+	return xdif * xdif + ydif * ydif;
+}
+
+double utilities::get_zero_tolerance()
+{
+	return ZERO_TOLERANCE;
 }
 
 std::string utilities::to_string(double value)
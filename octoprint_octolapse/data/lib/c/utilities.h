@@ -11,6 +11,8 @@ public:
 	static bool less_than_or_equal(double x, double y);
 	static bool is_zero(double x);
 	static double get_cartesian_distance(double x1, double y1, double x2, double y2);
+	static double get_cartesian_distance_squared(double x1, double y1, double x2, double y2);
+	static double get_zero_tolerance();
 	static std::string to_string(double value);
 	static std::string ltrim(const std::string& s);
 	static std::string rtrim(const std::string& s);
@@ -91,6 +91,13 @@ _octolapse_errors = {
                 'is_fatal': True,
                 'description': "No snapshot commands were found.  Current Snapshot Commands: @OCTOLAPSE "
                                "TAKE-SNAPSHOT{snapshot_command_gcode} "
+            },
+            "7": {
+                'name': "Gcode File Decoding Failed",
+                'help_link': "error_help_preprocessor_gcode_decode_error.md",
+                'cpp_name': "stabilization_processing_issue_type_gcode_decode_error",
+                'is_fatal': True,
+                'description': "Unable to decode the compressed or binary gcode file: {decode_error}"
             }
         },
         'preprocessor_errors': {
@@ -630,17 +630,65 @@ class ParsedCommand(utility.JsonSerializable):
 
 class GcodeProcessor(object):
     _key = "plugin_octolapse"
+    # PlanCursor.Update results
+    PLAN_CURSOR_NONE = GcodePositionProcessor.PLAN_CURSOR_NONE
+    PLAN_CURSOR_SKIPPED = GcodePositionProcessor.PLAN_CURSOR_SKIPPED
+    PLAN_CURSOR_TRIGGER_LINE = GcodePositionProcessor.PLAN_CURSOR_TRIGGER_LINE
+    # Only returned while a PlanPipeline is still creating the plans
+    PLAN_CURSOR_PLANS_PENDING = GcodePositionProcessor.PLAN_CURSOR_PLANS_PENDING
+    PLAN_CURSOR_NOT_PLANNED = GcodePositionProcessor.PLAN_CURSOR_NOT_PLANNED
+    # Flags for the tracking_mask position arg
+    POSITION_TRACKING_COMMENTS = GcodePositionProcessor.POSITION_TRACKING_COMMENTS
+    POSITION_TRACKING_BOUNDS = GcodePositionProcessor.POSITION_TRACKING_BOUNDS
+    POSITION_TRACKING_EXTRUDER_STATE = GcodePositionProcessor.POSITION_TRACKING_EXTRUDER_STATE
+    POSITION_TRACKING_LAYERS = GcodePositionProcessor.POSITION_TRACKING_LAYERS
+    POSITION_TRACKING_HEIGHT_INCREMENT = GcodePositionProcessor.POSITION_TRACKING_HEIGHT_INCREMENT
+    POSITION_TRACKING_ALL = GcodePositionProcessor.POSITION_TRACKING_ALL
+    # False if the extension was built without native threads, in which case there is no AsyncTracker or PlanPipeline
+    HAS_THREADS = GcodePositionProcessor.HAS_THREADS != 0
+
+    @staticmethod
+    def create_processor():
+        # Returns a GcodePositionProcessor.Processor, which has the same functions as the module but keeps its own
+        # positions, triggers and snapshot gcode generators.  Use one per thread to process gcode concurrently.
+        return GcodePositionProcessor.Processor()
 
     @staticmethod
     def initialize_position_processor(position_args, key=_key):
+        # Returns a GcodePositionProcessor.PositionHandle for the key.  Pass it as the handle of the live position
+        # functions below to skip the argument parsing and key lookup.  Get a new handle after every initialize.
         try:
-            GcodePositionProcessor.Initialize(key, position_args)
-            return True
+            return GcodePositionProcessor.Initialize(key, position_args)
         except Exception as e:
             logger.exception("An error occurred while initializing the GcodePositionProcessor!")
             raise e
         return False
 
+    @staticmethod
+    def initialize_position_processor_from_checkpoint(
+        position_args, checkpoint_directory, file_path, file_position, key=_key
+    ):
+        # Initializes the position processor as if every line of the file before file_position had been processed,
+        # starting from the nearest checkpoint saved while preprocessing.  Returns (is_checkpoint_used,
+        # lines_processed), or False if the gcode file could not be read.
+        try:
+            return GcodePositionProcessor.InitializeFromCheckpoint(
+                key, position_args, checkpoint_directory, file_path, file_position
+            )
+        except Exception as e:
+            logger.exception("An error occurred while initializing the GcodePositionProcessor from a checkpoint!")
+            raise e
+
+    @staticmethod
+    def set_log_levels(gcode_parser_level, gcode_position_level, snapshot_plan_level):
+        # Overrides the log levels cached by the native processor until they are invalidated.
+        GcodePositionProcessor.SetLogLevels(gcode_parser_level, gcode_position_level, snapshot_plan_level)
+
+    @staticmethod
+    def invalidate_log_levels():
+        # The native processor will reload its log levels from the python loggers on its next call.
+        GcodePositionProcessor.InvalidateLogLevels()
+
     @staticmethod
     def parse(gcode):
         parsed_command_cpp = GcodePositionProcessor.Parse(gcode.encode('ascii', errors="replace").decode())
@@ -654,19 +702,34 @@ class GcodeProcessor(object):
         return parsed_command
 
     @staticmethod
-    def get_current_position(key=_key):
-        current_pos_cpp = GcodePositionProcessor.GetCurrentPositionTuple(key)
+    def get_current_position(key=_key, handle=None):
+        if handle is not None:
+            current_pos_cpp = handle.GetCurrentPositionTuple()
+        else:
+            current_pos_cpp = GcodePositionProcessor.GetCurrentPositionTuple(key)
         return Pos.create_from_cpp_pos(current_pos_cpp)
 
     @staticmethod
-    def get_previous_position(key=_key):
-        previous_pos_cpp = GcodePositionProcessor.GetPreviousPositionTuple(key)
+    def get_previous_position(key=_key, handle=None):
+        if handle is not None:
+            previous_pos_cpp = handle.GetPreviousPositionTuple()
+        else:
+            previous_pos_cpp = GcodePositionProcessor.GetPreviousPositionTuple(key)
         return Pos.create_from_cpp_pos(previous_pos_cpp)
 
     @staticmethod
-    def update_position(position, x, y, z, e, f, key=_key):
-        cpp_pos = GcodePositionProcessor.UpdatePosition(
-            key,
+    def get_current_position_view(key=_key):
+        # Returns a GcodePositionProcessor.PositionView, which only converts the values that are actually read.  The
+        # view can also be indexed like the position tuple, so it can be passed to Pos.copy_from_cpp_pos.
+        return GcodePositionProcessor.GetCurrentPositionView(key)
+
+    @staticmethod
+    def get_previous_position_view(key=_key):
+        return GcodePositionProcessor.GetPreviousPositionView(key)
+
+    @staticmethod
+    def update_position(position, x, y, z, e, f, key=_key, handle=None):
+        values = (
             0.0 if x is None else x,
             True if x is None else False,
             0.0 if y is None else y,
@@ -678,19 +741,111 @@ class GcodeProcessor(object):
             0.0 if f is None else f,
             True if f is None else False,
         )
+        if handle is not None:
+            cpp_pos = handle.UpdatePosition(*values)
+        else:
+            cpp_pos = GcodePositionProcessor.UpdatePosition(key, *values)
         Pos.copy_from_cpp_pos(cpp_pos, position)
         return position
 
     @staticmethod
-    def undo(key=_key):
-        GcodePositionProcessor.Undo(key)
+    def undo(key=_key, handle=None):
+        if handle is not None:
+            handle.Undo()
+        else:
+            GcodePositionProcessor.Undo(key)
 
     @staticmethod
-    def update(gcode, position, key=_key):
-        cpp_pos = GcodePositionProcessor.Update(key, gcode)
+    def update(gcode, position, key=_key, handle=None):
+        if handle is not None:
+            cpp_pos = handle.Update(gcode)
+        else:
+            cpp_pos = GcodePositionProcessor.Update(key, gcode)
         Pos.copy_from_cpp_pos(cpp_pos, position)
         return position
 
+    @staticmethod
+    def update_view(gcode, key=_key, handle=None):
+        # Like update, but returns a PositionView instead of copying every value into a Pos object.
+        if handle is not None:
+            return handle.UpdateView(gcode)
+        return GcodePositionProcessor.UpdateView(key, gcode)
+
+    @staticmethod
+    def update_batch(gcodes, position=None, return_line_flags=False, return_layer_changes=False, key=_key):
+        # Process a list of gcodes with a single call.  The final position is copied into position (if supplied).
+        # Returns a tuple of (line_flags, layer_change_indexes), each of which is None unless requested.
+        return_type = 0
+        if position is not None:
+            return_type |= GcodePositionProcessor.UPDATE_BATCH_RETURN_POSITION
+        if return_line_flags:
+            return_type |= GcodePositionProcessor.UPDATE_BATCH_RETURN_LINE_FLAGS
+        if return_layer_changes:
+            return_type |= GcodePositionProcessor.UPDATE_BATCH_RETURN_LAYER_CHANGES
+        cpp_pos, line_flags, layer_changes = GcodePositionProcessor.UpdateBatch(key, gcodes, return_type)
+        if position is not None:
+            Pos.copy_from_cpp_pos(cpp_pos, position)
+        return line_flags, layer_changes
+
+    @staticmethod
+    def get_stats(key=_key):
+        # returns the timing of update, update_view and update_batch: {"calls", "total_ns", "ns_per_call", "min_ns",
+        # "max_ns", "histogram"}, where histogram[i] counts the calls that took from 2^i to 2^(i+1) nanoseconds
+        return GcodePositionProcessor.GetStats(key)
+
+    @staticmethod
+    def initialize_trigger(trigger_args, key=_key):
+        # Creates a native trigger that is updated from the position processor with the same key.
+        GcodePositionProcessor.InitializeTrigger(key, trigger_args)
+
+    @staticmethod
+    def update_trigger(key=_key):
+        # Must be called after the position is updated.  Returns None if the trigger state did not change, else a
+        # state tuple.
+        return GcodePositionProcessor.UpdateTrigger(key)
+
+    @staticmethod
+    def pause_trigger(key=_key):
+        GcodePositionProcessor.PauseTrigger(key)
+
+    @staticmethod
+    def resume_trigger(key=_key):
+        GcodePositionProcessor.ResumeTrigger(key)
+
+    @staticmethod
+    def create_async_tracker(position_args, trigger_args=None, queue_size=1024):
+        # Returns a GcodePositionProcessor.AsyncTracker, which parses pushed gcode and updates its own position and
+        # optional native trigger on a separate thread.  Push only waits when the queue is full, and returns False
+        # without queuing the line if the trigger is pending then.  When the trigger fires the tracker stops on that
+        # line until Resume is called, so Wait, then read the position, then Resume.
+        # The file line number of each position is the number of lines pushed so far.
+        return GcodePositionProcessor.CreateAsyncTracker(position_args, trigger_args, queue_size)
+
+    @staticmethod
+    def create_plan_cursor(snapshot_plans, plan_pipeline=None):
+        # Returns a GcodePositionProcessor.PlanCursor that follows the snapshot plans by the gcode number of each
+        # printed line, so that lines which don't trigger a plan don't need to be parsed or tracked.  Update returns
+        # one of the PLAN_CURSOR_ constants.  If a PlanPipeline is supplied, Update returns PLAN_CURSOR_PLANS_PENDING
+        # when it has plans that haven't been added with AddPlans, and PLAN_CURSOR_NOT_PLANNED for lines it hasn't
+        # planned yet.
+        return GcodePositionProcessor.CreatePlanCursor(
+            [plan.file_gcode_number for plan in snapshot_plans], plan_pipeline
+        )
+
+    @staticmethod
+    def initialize_snapshot_gcode_generator(generator_args, key=_key):
+        GcodePositionProcessor.InitializeSnapshotGcodeGenerator(key, generator_args)
+
+    @staticmethod
+    def get_snapshot_gcode(snapshot_plan, g90_influences_extruder, disable_z_lift, key=_key):
+        # returns a tuple of (initialization, start, snapshot, return, end) gcode lists, or None on failure
+        return GcodePositionProcessor.GetSnapshotGcode(key, snapshot_plan, g90_influences_extruder, disable_z_lift)
+
+    @staticmethod
+    def extract_slicer_settings(file_path, tables):
+        # returns (is_complete, {slicer name: {"settings": {key: value}, "version": {group: value} or None}})
+        return GcodePositionProcessor.ExtractSlicerSettings(file_path, tables)
+
 
 # class GcodeStabilizationProcessor(object):
 #
@@ -24,6 +24,7 @@ from __future__ import unicode_literals
 import logging
 import datetime as datetime
 import os
+import sys
 import six
 from octoprint.logging.handlers import AsyncLogHandlerMixin, CleaningTimedRotatingFileHandler
 
@@ -217,3 +218,9 @@ class LoggingConfigurator(object):
             else:
                 current_logger = self._root_logger.getChild(logger_name)
                 current_logger.setLevel(default_log_level)
+
+        # The native gcode processor caches the log levels so that it can skip messages without calling into python.
+        # It is only in sys.modules once it has been imported, and imports this module itself, so don't import it here.
+        gcode_position_processor = sys.modules.get("GcodePositionProcessor")
+        if gcode_position_processor is not None:
+            gcode_position_processor.InvalidateLogLevels()
@@ -61,8 +61,15 @@ class Position(utility.JsonSerializable):
         #     self._location_detection_commands.append("G162")
         self._gcode_generation_settings = printer_profile.get_current_state_detection_settings()
         cpp_position_args = printer_profile.get_position_args(overridable_printer_profile_settings)
+        # The live position never reads the feature tags, so skip the comment processing.
+        cpp_position_args["tracking_mask"] = (
+            GcodeProcessor.POSITION_TRACKING_ALL & ~GcodeProcessor.POSITION_TRACKING_COMMENTS
+        )
 
-        GcodeProcessor.initialize_position_processor(cpp_position_args)
+        # The handle refers directly to the native position, so the live updates below skip the key lookup.
+        self._position_handle = GcodeProcessor.initialize_position_processor(cpp_position_args)
+        # kept for create_async_tracker
+        self._cpp_position_args = cpp_position_args
 
         self._auto_detect_position = printer_profile.auto_detect_position
         self._priming_height = printer_profile.priming_height
@@ -77,12 +84,17 @@ class Position(utility.JsonSerializable):
         self._priming_height = printer_profile.priming_height
         self._minimum_layer_height = printer_profile.minimum_layer_height
 
-        self.current_pos = GcodeProcessor.get_current_position()
-        self.previous_pos = GcodeProcessor.get_previous_position()
-        self.undo_pos = GcodeProcessor.get_current_position()
+        self.current_pos = GcodeProcessor.get_current_position(handle=self._position_handle)
+        self.previous_pos = GcodeProcessor.get_previous_position(handle=self._position_handle)
+        self.undo_pos = GcodeProcessor.get_current_position(handle=self._position_handle)
+
+    def create_async_tracker(self, trigger_args, queue_size):
+        # Returns an AsyncTracker that tracks the position with the same settings on its own thread, with a native
+        # trigger created from trigger_args.
+        return GcodeProcessor.create_async_tracker(self._cpp_position_args, trigger_args, queue_size)
 
     def update_position(self, x, y, z, e, f):
-        GcodeProcessor.update_position(self.current_pos, x, y, z, e, f)
+        GcodeProcessor.update_position(self.current_pos, x, y, z, e, f, handle=self._position_handle)
 
     def to_position_dict(self):
         ret_dict = self.current_pos.to_dict()
@@ -98,7 +110,7 @@ class Position(utility.JsonSerializable):
         return False
 
     def undo_update(self):
-        GcodeProcessor.undo()
+        GcodeProcessor.undo(handle=self._position_handle)
         # set pos to the previous pos and pop the current position
         if self.undo_pos is None:
             raise Exception("Cannot undo updates when there is less than one position in the position queue.")
@@ -109,6 +121,20 @@ class Position(utility.JsonSerializable):
         self.undo_pos = None
         return previous_position
 
+    def update_batch(self, gcodes, file_line_number=None):
+        # Like update, but processes every gcode with a single native call.  Only the final positions are copied, so
+        # the position restrictions can't be calculated.  Don't use this with restricted positions.
+        if len(gcodes) == 0:
+            return
+        GcodeProcessor.update_batch(gcodes, position=self.current_pos)
+        # Undo only reverts the final gcode of the batch.
+        self.undo_pos = self.previous_pos
+        self.previous_pos = GcodeProcessor.get_previous_position(handle=self._position_handle)
+        if file_line_number is not None:
+            self.current_pos.file_line_number = file_line_number
+        self.current_pos.in_path_position = False
+        self.current_pos.is_in_position = True
+
     def update(self, gcode, file_line_number=None):
         # Move the current position to the previous and the previous to the undo position
         # then copy previous to current
@@ -122,7 +148,7 @@ class Position(utility.JsonSerializable):
         Pos.copy(self.previous_pos, self.current_pos)
 
         # process the gcode and update our current position
-        GcodeProcessor.update(gcode, self.current_pos)
+        GcodeProcessor.update(gcode, self.current_pos, handle=self._position_handle)
 
         # fill in the file line number if it is supplied.
         if file_line_number is not None:
@@ -355,6 +355,7 @@ class PrinterProfile(AutomaticConfigurationProfile):
         self.auto_position_detection_commands = ""
         self.priming_height = 0.75  # Extrusion must occur BELOW this level before layer tracking will begin
         self.minimum_layer_height = 0.05  # Layer tracking won't start until extrusion at this height is reached.
+        self.lock_slicer_from_header = False  # Trust the slicer named in the gcode header when detecting features.
         self.e_axis_default_mode = 'absolute'  # other values are 'relative' and 'absolute'
         self.g90_influences_extruder = 'false'  # other values are 'true' and 'false'
         self.xyz_axes_default_mode = 'absolute'  # other values are 'relative' and 'absolute'
@@ -744,6 +745,7 @@ class PrinterProfile(AutomaticConfigurationProfile):
             "e_axis_default_mode": self.e_axis_default_mode,
             "units_default": self.units_default,
             "autodetect_position": self.auto_detect_position,
+            "lock_slicer_from_header": self.lock_slicer_from_header,
             "slicer_settings": gcode_generation_settings.to_dict(),
             "zero_based_extruder": self.zero_based_extruder,
             "priming_height": self.priming_height,
@@ -1634,6 +1636,10 @@ class MainSettings(Settings):
         self.preview_snapshot_plans = True
         self.preview_snapshot_plan_autoclose = False
         self.preview_snapshot_plan_seconds = 30
+        self.pipelined_preprocessing = False
+        self.async_position_tracking = False
+        self.save_position_traces = False
+        self.cache_snapshot_plans = False
         self.automatic_updates_enabled = True
         self.automatic_update_interval_days = 7
         self.snapshot_archive_directory = ""
@@ -29,6 +29,7 @@ from file_read_backwards import FileReadBackwards
 import re
 import six
 import string
+import octoprint_octolapse.gcode_processor as gcode_processor
 # create the module level logger
 from octoprint_octolapse.log import LoggingConfigurator
 logging_configurator = LoggingConfigurator()
@@ -78,14 +79,19 @@ class GcodeFileProcessor(object):
         if len(filtered_processors) == 0:
             return None
 
-        # create a list of forward, reverse and full processors
-        forward_processors = [x for x in filtered_processors if x.file_process_type in [u'forward', u'both']]
-        reverse_processors = [x for x in filtered_processors if x.file_process_type in [u'reverse', u'both']]
+        # use the native extractor if it can handle all of the active rules, it searches for every processor at once
+        native_tables = [x.get_native_table() for x in filtered_processors]
+        if None not in native_tables:
+            complete = self.process_native(filtered_processors, native_tables, target_file_path)
+        else:
+            # create a list of forward, reverse and full processors
+            forward_processors = [x for x in filtered_processors if x.file_process_type in [u'forward', u'both']]
+            reverse_processors = [x for x in filtered_processors if x.file_process_type in [u'reverse', u'both']]
 
-        # process any forward items
-        complete = self.process_forwards(forward_processors, target_file_path)
-        if not complete:
-            complete = self.process_reverse(reverse_processors, target_file_path)
+            # process any forward items
+            complete = self.process_forwards(forward_processors, target_file_path)
+            if not complete:
+                complete = self.process_reverse(reverse_processors, target_file_path)
 
         self.end_time = time.time()
         if complete:
@@ -95,6 +101,13 @@ class GcodeFileProcessor(object):
         self.notify_progress(end_progress=True)
         return self.get_processor_results()
 
+    def process_native(self, processors, native_tables, target_file_path):
+        complete, results = gcode_processor.GcodeProcessor.extract_slicer_settings(target_file_path, native_tables)
+        for processor in processors:
+            processor.apply_native_result(results[processor.name])
+        self.current_file_position = self.file_size_bytes
+        return complete
+
     def process_forwards(self, processors, target_file_path):
         # open the file for streaming
         line_number = 0
@@ -237,6 +250,16 @@ class GcodeProcessor(object):
 
 
 class GcodeSettingsProcessor(GcodeProcessor):
+    # Setting and version formats understood by the native extractor, these match slicer_settings_extractor.h
+    SETTING_FORMAT_KEY_EQUALS_VALUE = 0
+    SETTING_FORMAT_KEY_COMMA_VALUE = 1
+    VERSION_FORMAT_NONE = 0
+    VERSION_FORMAT_SLIC3R_PE = 1
+    VERSION_FORMAT_SIMPLIFY_3D = 2
+    VERSION_FORMAT_CURA = 3
+    # The regexes that the native extractor replaces, override these to enable native extraction
+    native_setting_format = None
+    native_version_format = VERSION_FORMAT_NONE
 
     def __init__(self, name, file_procdss_type, max_forward_lines_to_process, max_reverse_lines_to_process):
         super(GcodeSettingsProcessor, self).__init__(name, u'settings_processor')
@@ -359,6 +382,55 @@ class GcodeSettingsProcessor(GcodeProcessor):
     def get_results(self):
         return self.results
 
+    def get_native_table(self):
+        # Returns None if the active regexes can't all be matched natively
+        if self.native_setting_format is None or u'general_setting' not in self.active_regex_definitions:
+            return None
+        for key in self.active_regex_definitions:
+            if key not in (u'general_setting', u'version'):
+                return None
+        keys = []
+        ignored_keys = []
+        for key, setting in six.iteritems(self.active_settings_dictionary):
+            if setting.ignore_key:
+                ignored_keys.append(key)
+            else:
+                keys.append(key)
+        return {
+            "name": self.name,
+            "setting_format": self.native_setting_format,
+            "version_format": (
+                self.native_version_format if u'version' in self.active_regex_definitions
+                else GcodeSettingsProcessor.VERSION_FORMAT_NONE
+            ),
+            "keys": keys,
+            "ignored_keys": ignored_keys,
+            "search_forward": self.file_process_type in [u'forward', u'both'],
+            "search_reverse": self.file_process_type in [u'reverse', u'both'],
+            "max_forward_lines": self.max_forward_lines_to_process,
+            "max_reverse_lines": self.max_reverse_lines_to_process,
+        }
+
+    def apply_native_result(self, result):
+        # replay the native matches through the regular matching functions
+        for key, val in six.iteritems(result["settings"]):
+            self.process_match(NativeMatch({u"key": key, u"val": val}), None, self.active_regex_definitions[u'general_setting'])
+        if result["version"] is not None and u'version' in self.active_regex_definitions:
+            regex = self.active_regex_definitions[u'version']
+            regex.has_matched = True
+            self.process_match(NativeMatch(result["version"]), None, regex)
+
+
+class NativeMatch(object):
+    # Stands in for the re match object of a natively matched line
+    def __init__(self, groups):
+        self._groups = groups
+
+    def group(self, *names):
+        if len(names) == 1:
+            return self._groups[names[0]]
+        return tuple(self._groups[name] for name in names)
+
 
 #############################################
 # Standard parsing functions
@@ -743,6 +815,9 @@ class RegexDefinition(object):
 # Extends GcodeProcessor
 #############################################
 class Slic3rSettingsProcessor(GcodeSettingsProcessor):
+    native_setting_format = GcodeSettingsProcessor.SETTING_FORMAT_KEY_EQUALS_VALUE
+    native_version_format = GcodeSettingsProcessor.VERSION_FORMAT_SLIC3R_PE
+
     def __init__(self, search_direction=u"both", max_forward_search=50, max_reverse_search=263):
         super(Slic3rSettingsProcessor, self).__init__(u'slic3r-pe', search_direction, max_forward_search, max_reverse_search)
 
@@ -975,6 +1050,9 @@ class Slic3rSettingsProcessor(GcodeSettingsProcessor):
 
 
 class Simplify3dSettingsProcessor(GcodeSettingsProcessor):
+    native_setting_format = GcodeSettingsProcessor.SETTING_FORMAT_KEY_COMMA_VALUE
+    native_version_format = GcodeSettingsProcessor.VERSION_FORMAT_SIMPLIFY_3D
+
     def __init__(self, search_direction="forward", max_forward_search=295, max_reverse_search=0):
         super(Simplify3dSettingsProcessor, self).__init__(u'simplify-3d', search_direction, max_forward_search, max_reverse_search)
 
@@ -1223,6 +1301,9 @@ class Simplify3dSettingsProcessor(GcodeSettingsProcessor):
 
 
 class CuraSettingsProcessor(GcodeSettingsProcessor):
+    native_setting_format = GcodeSettingsProcessor.SETTING_FORMAT_KEY_EQUALS_VALUE
+    native_version_format = GcodeSettingsProcessor.VERSION_FORMAT_CURA
+
     def __init__(self, search_direction="both", max_forward_search=550, max_reverse_search=550):
         super(CuraSettingsProcessor, self).__init__(u'cura', search_direction, max_forward_search, max_reverse_search)
 
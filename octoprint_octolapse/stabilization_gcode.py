@@ -25,6 +25,7 @@ from octoprint_octolapse.position import Pos
 from octoprint_octolapse.gcode_commands import Commands
 from octoprint_octolapse.settings import *
 from octoprint_octolapse.trigger import Triggers
+from octoprint_octolapse.gcode_processor import GcodeProcessor
 # create the module level logger
 from octoprint_octolapse.log import LoggingConfigurator
 import json
@@ -209,10 +210,10 @@ class SnapshotPlan(utility.JsonSerializable):
             raise e
 
     @classmethod
-    def create_from_cpp_snapshot_plans(cls, cpp_snapshot_plans):
+    def create_from_cpp_snapshot_plans(cls, cpp_snapshot_plans, first_plan_number=1):
         # turn the snapshot plans into a class
         snapshot_plans = []
-        plan_number = 1
+        plan_number = first_plan_number
         try:
             for cpp_plan in cpp_snapshot_plans:
                 # extract the arguments
@@ -240,17 +241,17 @@ class SnapshotPlan(utility.JsonSerializable):
                 return_position = None if cpp_plan[9] is None else Pos.create_from_cpp_pos(cpp_plan[9])
                 end_command = None if cpp_plan[10] is None else ParsedCommand.create_from_cpp_parsed_command(cpp_plan[10])
                 snapshot_plan = SnapshotPlan(
-                    file_line_number,
-                    file_gcode_number,
-                    file_position,
-                    travel_distance,
-                    saved_travel_distance,
-                    start_command,
-                    triggering_command,
-                    initial_position,
-                    steps,
-                    return_position,
-                    end_command)
+                    file_line_number=file_line_number,
+                    file_gcode_number=file_gcode_number,
+                    file_position=file_position,
+                    travel_distance=travel_distance,
+                    saved_travel_distance=saved_travel_distance,
+                    triggering_command=triggering_command,
+                    start_command=start_command,
+                    initial_position=initial_position,
+                    steps=steps,
+                    return_position=return_position,
+                    end_command=end_command)
                 snapshot_plans.append(snapshot_plan)
                 logger.verbose("Plan %d: %s", plan_number, snapshot_plan)
                 plan_number += 1
@@ -273,125 +274,9 @@ class SnapshotGcodeGenerator(object):
         self.overridable_printer_profile_settings = overridable_printer_profile_settings
         self.gcode_generation_settings = self.Printer.get_current_state_detection_settings()
         # assert(isinstance(self.gcode_generation_settings, OctolapseGcodeSettings))
-        # this will be determined by the supplied position object
-        self.g90_g91_affect_extruder = None
-        # variables for gcode generation
-        # return (original) values
-
-        # current valuse
-        self.x_current = None
-        self.y_current = None
-        self.z_current = None
-        self.e_current = None
-        self.f_current = None
-        self.is_relative_current = None
-        self.is_extruder_relative_current = None
-        # calculated values
-        # calculate printer retract amount
-        self.length_to_retract = None
-        self.distance_to_lift = None
-        self.axis_mode_compatibility = self.Printer.gocde_axis_compatibility_mode_enabled
-
-        # Gcode Generation Settings
-        self.x_y_travel_speed = None
-        self.z_lift_speed = None
-        #   Extruder Settings
-        self.current_tool = None
-        self.current_extruder = None
-        self.retract_before_move = None
-        self.retraction_length = None
-        self.retraction_speed = None
-        self.deretraction_speed = None
-        self.lift_when_retracted = None
-        self.z_lift_height = None
-
-        # Snapshot Gcode Variable
-        self.snapshot_gcode = None
-
-        # state flags
-        self.retracted_by_start_gcode = None
-        self.lifted_by_start_gcode = None
-        self.g90_influences_extruder = None
-        # misc variables used for logging info
-        self.last_extrusion_height = None
-        self.snapshot_plan = None
-
-    def initialize_for_snapshot_plan_processing(
-        self, snapshot_plan, g90_influences_extruder, options=None
-    ):
-        assert(isinstance(snapshot_plan, SnapshotPlan))
-        assert(isinstance(snapshot_plan.initial_position, Pos))
-
-        # get the triggering command and extruder position by
-        # undo the most recent position update since we haven't yet executed the most recent gcode command
-        # Capture and undo the last position update, we're not going to be using it!
-
-        # save the snapshot plan
-        self.snapshot_plan = snapshot_plan
-
-        # does G90/G91 influence the extruder
-        self.g90_influences_extruder = g90_influences_extruder
-
-        assert(isinstance(snapshot_plan.initial_position, Pos))
-
-        self.x_current = snapshot_plan.initial_position.x
-        self.y_current = snapshot_plan.initial_position.y
-        self.z_current = snapshot_plan.initial_position.z
-        self.e_current = snapshot_plan.initial_position.get_current_extruder().e
-        self.f_current = snapshot_plan.initial_position.f
-        self.is_relative_current = snapshot_plan.initial_position.is_relative
-        self.is_extruder_relative_current = snapshot_plan.initial_position.is_extruder_relative
-        self.current_tool = snapshot_plan.initial_position.current_tool
-        if self.current_tool > len(self.gcode_generation_settings.extruders) - 1:
-            logger.warning("The requested tool index of %d is greater than the number of extruders ($d).",
-                           self.current_tool, len(self.gcode_generation_settings.extruders))
-            self.current_tool = len(self.gcode_generation_settings.extruders) - 1
-
-        if self.current_tool < 0:
-            logger.warning("The requested tool index was less than zero.  Index: %d.",
-                           self.current_tool)
-            self.current_tool = 0
-        self.current_extruder = self.gcode_generation_settings.extruders[self.current_tool]
-        # Get per extruder settings for convenience
-        self.x_y_travel_speed = self.current_extruder.x_y_travel_speed
-        self.z_lift_speed = self.current_extruder.z_lift_speed
-        self.retraction_speed = self.current_extruder.retraction_speed
-        self.deretraction_speed = self.current_extruder.deretraction_speed
-        self.retract_before_move = self.current_extruder.retract_before_move
-        self.retraction_length = self.current_extruder.retraction_length
-        self.lift_when_retracted = self.current_extruder.lift_when_retracted
-        self.z_lift_height = self.current_extruder.z_lift_height
-
-        if options is not None and "disable_z_lift" in options and options["disable_z_lift"]:
-            self.distance_to_lift = 0
-        else:
-            self.distance_to_lift = snapshot_plan.initial_position.distance_to_zlift(self.z_lift_height)
-            if self.distance_to_lift is None:
-                self.distance_to_lift = 0
-
-        self.length_to_retract = snapshot_plan.initial_position.length_to_retract(self.retraction_length)
-        if self.length_to_retract is None:
-            self.length_to_retract = 0
-
-        self.retracted_by_start_gcode = False
-        self.lifted_by_start_gcode = False
-
-        # create our gcode object
-        self.snapshot_gcode = SnapshotGcode()
-
-        return not self.has_initialization_errors()
-
-    def has_initialization_errors(self):
-        # check the units, only metric works.
-        is_metric = self.snapshot_plan.initial_position.is_metric
-        if is_metric is None or not is_metric:
-            logger.error(
-                "No unit of measurement has been set and the current"
-                " printer profile is set to require explicit G20/G21, or the unit of measurement is inches. "
-            )
-            return True
-
-        return False
+        # the native generator is created the first time gcode is requested, since the gcode generation settings
+        # are only sent once
+        self._is_native_generator_initialized = False
 
     def get_snapshot_position(self, x_pos, y_pos):
         x_path = self.StabilizationPaths["x"]
@@ -509,428 +394,6 @@ class SnapshotGcodeGenerator(object):
                    (float(max_value) - float(min_value))/2.0
         return ((float(max_value) - float(min_value)) * (percent / 100.0)) + float(min_value)
 
-    def set_e_to_relative(self, gcode_type):
-        if not self.is_extruder_relative_current:
-            self.snapshot_gcode.append(
-                gcode_type,
-                self.get_gcode_extruder_relative()
-            )
-            self.is_extruder_relative_current = True
-
-    def set_e_to_absolute(self, gcode_type):
-        if self.is_extruder_relative_current:
-            self.snapshot_gcode.append(
-                gcode_type,
-                self.get_gcode_extruder_absolute()
-            )
-            self.is_extruder_relative_current = False
-
-    def set_xyz_to_relative(self, gcode_type):
-        if not self.is_relative_current:  # must be in relative mode
-            self.snapshot_gcode.append(
-                gcode_type,
-                self.get_gcode_axes_relative()
-            )
-            self.is_relative_current = True
-            # this may also influence the extruder
-            if self.g90_influences_extruder:
-                self.is_extruder_relative_current = True
-
-    def set_xyz_to_absolute(self, gcode_type):
-        if self.is_relative_current:  # must be in relative mode
-            self.snapshot_gcode.append(
-                gcode_type,
-                self.get_gcode_axes_absolute()
-            )
-            self.is_relative_current = False
-            # this may also influence the extruder
-            if self.g90_influences_extruder:
-                self.is_extruder_relative_current = False
-
-    def get_altered_feedrate(self, feedrate):
-        if feedrate != self.f_current:
-            self.f_current = feedrate
-        else:
-            feedrate = None
-        return feedrate
-
-    def can_retract(self):
-        return self.retract_before_move and self.length_to_retract > 0
-
-    def can_zhop(self):
-        if not (
-            self.retract_before_move and
-            self.lift_when_retracted and self.distance_to_lift > 0
-        ):
-            return False
-        max_z = self.overridable_printer_profile_settings["volume"]["max_z"]
-        return utility.less_than_or_equal(self.snapshot_plan.initial_position.z + self.distance_to_lift, max_z)
-
-    ###########################
-    # Relative retract/lift/travel functions
-    ###########################
-    def retract_relative(self):
-        self.set_e_to_relative(SnapshotGcode.START_GCODE)
-        length_to_retract = -1 * self.length_to_retract
-        self.e_current += length_to_retract
-
-        self.snapshot_gcode.append(
-            SnapshotGcode.START_GCODE,
-            self.get_gcode_retract(
-                length_to_retract,
-                self.get_altered_feedrate(self.retraction_speed)
-            )
-        )
-        self.retracted_by_start_gcode = True
-
-    def deretract_relative(self):
-        if self.retracted_by_start_gcode:
-            length_to_deretract = self.length_to_retract
-            self.e_current += length_to_deretract
-
-            self.set_e_to_relative(SnapshotGcode.END_GCODE)
-            self.snapshot_gcode.append(
-                SnapshotGcode.END_GCODE,
-                self.get_gcode_retract(
-                    length_to_deretract,
-                    self.get_altered_feedrate(self.deretraction_speed)
-                )
-            )
-
-    def lift_z_relative(self):
-        # if we can ZHop, do
-        distance_to_lift = self.distance_to_lift
-        self.z_current += distance_to_lift
-        self.set_xyz_to_relative(SnapshotGcode.START_GCODE)
-        # append to snapshot gcode
-        self.snapshot_gcode.append(
-            SnapshotGcode.START_GCODE,
-            self.get_gcode_z_lift(
-                distance_to_lift,
-                self.get_altered_feedrate(self.z_lift_speed)
-            )
-        )
-        self.lifted_by_start_gcode = True
-
-    def delift_z_relative(self):
-        if self.lifted_by_start_gcode:
-            # if we can ZHop, do
-            distance_to_delift = -1 * self.distance_to_lift
-            self.z_current += distance_to_delift
-            self.set_xyz_to_relative(SnapshotGcode.END_GCODE)
-            self.snapshot_gcode.append(
-                SnapshotGcode.END_GCODE,
-                self.get_gcode_z_lift(
-                    distance_to_delift,
-                    self.get_altered_feedrate(self.z_lift_speed)
-                )
-            )
-
-    def add_travel_action_relative(self, step):
-        if self.x_current != step.x and self.y_current != step.y:
-            self.set_xyz_to_relative(SnapshotGcode.SNAPSHOT_COMMANDS)
-            x_relative = (step.x - self.x_current)
-            y_relative = (step.y - self.y_current)
-            self.x_current = step.x
-            self.y_current = step.y
-            self.snapshot_gcode.append(
-                SnapshotGcode.SNAPSHOT_COMMANDS,
-                self.get_gcode_travel(
-                    x_relative,
-                    y_relative,
-                    self.get_altered_feedrate(self.x_y_travel_speed)
-                )
-            )
-
-    def return_to_original_position_relative(self):
-        if (
-            self.snapshot_plan.return_position is not None and
-            self.x_current != self.snapshot_plan.return_position.x and
-            self.y_current != self.snapshot_plan.return_position.y
-        ):
-            self.set_xyz_to_relative(SnapshotGcode.SNAPSHOT_COMMANDS)
-            x_relative = (self.snapshot_plan.return_position.x - self.x_current)
-            y_relative = (self.snapshot_plan.return_position.y - self.y_current)
-            self.x_current = self.snapshot_plan.return_position.x
-            self.y_current = self.snapshot_plan.return_position.y
-            self.snapshot_gcode.append(
-                SnapshotGcode.RETURN_COMMANDS,
-                self.get_gcode_travel(
-                    x_relative,
-                    y_relative,
-                    self.get_altered_feedrate(self.x_y_travel_speed)
-                )
-            )
-
-    ###########################
-    # Absolute retract/lift/travel functions
-    ###########################
-    def retract_absolute(self):
-        self.set_e_to_absolute(SnapshotGcode.START_GCODE)
-        length_to_retract = -1 * self.length_to_retract
-        self.e_current += length_to_retract
-        self.retracted_by_start_gcode = True
-        self.snapshot_gcode.append(
-            SnapshotGcode.START_GCODE,
-            self.get_gcode_retract(
-                self.snapshot_plan.initial_position.gcode_e(e=self.e_current),
-                self.get_altered_feedrate(self.retraction_speed)
-            )
-        )
-
-    def deretract_absolute(self):
-        if self.retracted_by_start_gcode:
-            self.set_e_to_absolute(SnapshotGcode.END_GCODE)
-            length_to_deretract = self.length_to_retract
-            self.e_current += length_to_deretract
-            self.snapshot_gcode.append(
-                SnapshotGcode.END_GCODE,
-                self.get_gcode_retract(
-                    self.snapshot_plan.initial_position.gcode_e(e=self.e_current),
-                    self.get_altered_feedrate(self.deretraction_speed)
-                )
-            )
-
-    def lift_z_absolute(self):
-        self.set_xyz_to_absolute(SnapshotGcode.START_GCODE)
-        # if we can ZHop, do
-        distance_to_lift = self.distance_to_lift
-        self.z_current += distance_to_lift
-        self.lifted_by_start_gcode = True
-        # append to snapshot gcode
-        self.snapshot_gcode.append(
-            SnapshotGcode.START_GCODE,
-            self.get_gcode_z_lift(
-                self.z_current - self.snapshot_plan.initial_position.z_offset,
-                self.get_altered_feedrate(self.z_lift_speed)
-            )
-        )
-
-    def delift_z_absolute(self):
-        self.set_xyz_to_absolute(SnapshotGcode.END_GCODE)
-        # if we can ZHop, do
-        distance_to_delift = -1 * self.distance_to_lift
-        self.z_current += distance_to_delift
-        # append to snapshot gcode
-        self.snapshot_gcode.append(
-            SnapshotGcode.END_GCODE,
-            self.get_gcode_z_lift(
-                self.z_current - self.snapshot_plan.initial_position.z_offset,
-                self.get_altered_feedrate(self.z_lift_speed)
-            )
-        )
-
-    def add_travel_action_absolute(self, step):
-        assert (isinstance(step, SnapshotPlanStep))
-        if not(self.x_current == step.x and self.y_current == step.y):
-            # Move to Snapshot Position
-            self.set_xyz_to_absolute(SnapshotGcode.SNAPSHOT_COMMANDS)
-            self.x_current = step.x
-            self.y_current = step.y
-            self.snapshot_gcode.append(
-                SnapshotGcode.SNAPSHOT_COMMANDS,
-                self.get_gcode_travel(
-                    self.snapshot_plan.initial_position.gcode_x(x=step.x),
-                    self.snapshot_plan.initial_position.gcode_y(y=step.y),
-                    self.get_altered_feedrate(self.x_y_travel_speed)
-                )
-            )
-
-    def return_to_original_position_absolute(self):
-        if self.snapshot_plan.return_position is not None:
-            # Only return to the previous coordinates if we need to (which will be most cases,
-            # except when the triggering command is a travel only (moves both X and Y, but not Z)
-            if(
-                self.snapshot_plan.return_position.x != self.x_current or
-                self.snapshot_plan.return_position.y != self.y_current
-            ):
-                self.x_current = self.snapshot_plan.return_position.x
-                self.y_current = self.snapshot_plan.return_position.y
-
-                # Move back to previous position - make sure we're in absolute mode for this
-                self.set_xyz_to_absolute(SnapshotGcode.RETURN_COMMANDS)
-
-                self.snapshot_gcode.append(
-                    SnapshotGcode.RETURN_COMMANDS,
-                    self.get_gcode_travel(
-                        self.snapshot_plan.return_position.gcode_x(),
-                        self.snapshot_plan.return_position.gcode_y(),
-                        self.get_altered_feedrate(self.x_y_travel_speed)
-                    )
-                )
-
-    ###########################
-    # Current axis mode  retract/lift/travel functions
-    ###########################
-    def retract_current_mode(self):
-        if self.is_extruder_relative_current:
-            self.retract_relative()
-        else:
-            self.retract_absolute()
-
-    def deretract_current_mode(self):
-        if self.is_extruder_relative_current:
-            self.deretract_relative()
-        else:
-            self.deretract_absolute()
-
-    def lift_z_current_mode(self):
-        if self.is_relative_current:
-            self.lift_z_relative()
-        else:
-            self.lift_z_absolute()
-
-    def delift_z_current_mode(self):
-        if self.is_relative_current:
-            self.delift_z_relative()
-        else:
-            self.delift_z_absolute()
-
-    def add_travel_action_current_mode(self, step):
-        # Move to Snapshot Position
-        if self.is_relative_current:
-            self.add_travel_action_relative(step)
-        else:
-            self.add_travel_action_absolute(step)
-
-    def return_to_original_position_current_mode(self):
-        if self.is_relative_current:
-            self.return_to_original_position_relative()
-        else:
-            self.return_to_original_position_absolute()
-
-    ######################################
-    # common functions for retract, lift, travel, and returning to the original position
-    # Calls the appropriate functions based on the self.axis_mode_compatibility setting
-    ######################################
-
-    def retract(self):
-        # Todo: make sure that retract with axis mode compatibility works for wipe steps
-        if self.can_retract():
-            if self.axis_mode_compatibility:
-                self.retract_relative()
-            else:
-                self.retract_current_mode()
-
-    def deretract(self):
-        if self.retracted_by_start_gcode:
-            if self.axis_mode_compatibility:
-                self.deretract_relative()
-            else:
-                self.deretract_current_mode()
-
-    def lift_z(self):
-        if (
-            self.can_zhop()
-        ):
-            if self.axis_mode_compatibility:
-                self.lift_z_relative()
-            else:
-                self.lift_z_current_mode()
-
-    def delift_z(self):
-        if self.lifted_by_start_gcode:
-            if self.axis_mode_compatibility:
-                self.delift_z_relative()
-            else:
-                self.delift_z_current_mode()
-
-    def add_travel_action(self, step):
-        if self.axis_mode_compatibility:
-            self.add_travel_action_absolute(step)
-        else:
-            self.add_travel_action_current_mode(step)
-
-    def return_to_original_position(self):
-        if self.axis_mode_compatibility:
-            self.return_to_original_position_absolute()
-        else:
-            self.return_to_original_position_current_mode()
-
-    ###########################
-    # Gcode generation functions that work in any axis mode
-    ###########################
-    def add_snapshot_action(self):
-        # Move to Snapshot Position
-        self.snapshot_gcode.append(
-            SnapshotGcode.SNAPSHOT_COMMANDS,
-            "{0} {1}".format(PrinterProfile.OCTOLAPSE_COMMAND, PrinterProfile.DEFAULT_OCTOLAPSE_SNAPSHOT_COMMAND)
-        )
-
-    def return_to_original_coordinate_systems(self):
-        if self.snapshot_plan.return_position is not None:
-            is_relative_return = self.snapshot_plan.return_position.is_relative
-        else:
-            is_relative_return = self.snapshot_plan.initial_position.is_relative
-
-        if is_relative_return != self.is_relative_current:
-            if self.is_relative_current:
-                self.snapshot_gcode.append(
-                    SnapshotGcode.END_GCODE,
-                    self.get_gcode_axes_absolute()
-                )
-            else:
-                self.snapshot_gcode.append(
-                    SnapshotGcode.END_GCODE,
-                    self.get_gcode_axes_relative()
-                )
-            self.is_relative_current = is_relative_return
-            if self.g90_influences_extruder:
-                self.is_extruder_relative_current = is_relative_return
-
-        if self.snapshot_plan.return_position is not None:
-            is_extruder_relative_return = self.snapshot_plan.return_position.is_extruder_relative
-        else:
-            is_extruder_relative_return = self.snapshot_plan.initial_position.is_extruder_relative
-
-        if is_extruder_relative_return != self.is_extruder_relative_current:
-            if is_extruder_relative_return:
-                self.snapshot_gcode.append(
-                    SnapshotGcode.END_GCODE,
-                    self.get_gcode_extruder_relative())
-            else:
-                self.snapshot_gcode.append(
-                    SnapshotGcode.END_GCODE,
-                    self.get_gcode_extruder_absolute())
-            self.is_extruder_relative_current = is_extruder_relative_return
-
-    # Note that this command may alter the end_command's feedrate if it exists in order to reduce the number of gcodes
-    # sent
-    def return_to_original_feedrate(self):
-        feedrate_set_in_end_command = (
-            self.snapshot_plan.end_command is not None and
-            "F" in self.snapshot_plan.end_command.parameters
-        )
-        f_return = self.snapshot_plan.initial_position.f
-        if self.snapshot_plan.return_position is not None:
-            f_return = self.snapshot_plan.return_position.f
-
-        if not feedrate_set_in_end_command and f_return != self.f_current:
-            # see if we can alter the end_command feedrate
-            if self.snapshot_plan.end_command is not None and self.snapshot_plan.end_command.cmd in ["G0", "G1"]:
-                self.snapshot_plan.end_command.parameters["F"] = f_return
-                self.snapshot_plan.end_command.update_gcode_string()
-            else:
-                # we can't count on the end gcode to set f, set it here
-                self.snapshot_gcode.append(
-                    SnapshotGcode.END_GCODE,
-                    self.get_gcode_feedrate(f_return))
-
-    ###########################
-    # Functions to send start and end commmand gcode
-    ###########################
-    def send_start_command(self, gcode_type=SnapshotGcode.INITIALIZATION_GCODE):
-        if self.snapshot_plan.start_command is not None:
-            self.snapshot_gcode.append(
-                gcode_type,
-                self.snapshot_plan.start_command.gcode)
-
-    def send_end_command(self, gcode_type=SnapshotGcode.END_GCODE):
-        if self.snapshot_plan.end_command is not None:
-            self.snapshot_gcode.append(
-                gcode_type,
-                self.snapshot_plan.end_command.gcode)
-
     @staticmethod
     def get_triggered_type(trigger):
         if trigger is None:
@@ -1105,50 +568,46 @@ class SnapshotGcodeGenerator(object):
 
         return triggering_command_1, triggering_command_2
 
-    def create_gcode_for_snapshot_plan(self, snapshot_plan, g90_influences_extruder, options):
-
-        assert(isinstance(snapshot_plan, SnapshotPlan))
-        if not self.initialize_for_snapshot_plan_processing(
-            snapshot_plan, g90_influences_extruder, options
-        ):
-            return None
-
-        # create the start command if it exists
-        self.send_start_command()
-
-        # There is no need to stabilize the extruder if we aren't waiting for moves to finish
-        if self._stabilization.wait_for_moves_to_finish:
-            # retract if necessary
-            self.retract()
-            # lift if necessary
-            self.lift_z()
+    def get_native_generator_args(self):
+        return {
+            "extruders": [
+                {
+                    "x_y_travel_speed": extruder.x_y_travel_speed,
+                    "z_lift_speed": extruder.z_lift_speed,
+                    "retraction_speed": extruder.retraction_speed,
+                    "deretraction_speed": extruder.deretraction_speed,
+                    "retract_before_move": extruder.retract_before_move,
+                    "retraction_length": extruder.retraction_length,
+                    "lift_when_retracted": extruder.lift_when_retracted,
+                    "z_lift_height": extruder.z_lift_height,
+                } for extruder in self.gcode_generation_settings.extruders
+            ],
+            "axis_mode_compatibility": self.Printer.gocde_axis_compatibility_mode_enabled,
+            "wait_for_moves_to_finish": self._stabilization.wait_for_moves_to_finish,
+            "max_z": self.overridable_printer_profile_settings["volume"]["max_z"]
+        }
 
+    def create_gcode_for_snapshot_plan(self, snapshot_plan, g90_influences_extruder, options):
 
         assert(isinstance(snapshot_plan, SnapshotPlan))
-        for step in snapshot_plan.steps:
-            assert(isinstance(step, SnapshotPlanStep))
-            if step.action == SnapshotPlan.TRAVEL_ACTION:
-                if self._stabilization.wait_for_moves_to_finish:
-                    self.add_travel_action(step)
-            if step.action == SnapshotPlan.SNAPSHOT_ACTION:
-                self.add_snapshot_action()
-
-        if self._stabilization.wait_for_moves_to_finish:
-            # Create Return Gcode
-            self.return_to_original_position()
-
-            # If we zhopped in the beginning, lower z
-            self.delift_z()
-
-            # deretract if necessary
-            self.deretract()
-
-            # reset the coordinate systems for the extruder and axis
-            self.return_to_original_coordinate_systems()
+        assert(isinstance(snapshot_plan.initial_position, Pos))
+        if not self._is_native_generator_initialized:
+            GcodeProcessor.initialize_snapshot_gcode_generator(self.get_native_generator_args())
+            self._is_native_generator_initialized = True
 
-            self.return_to_original_feedrate()
+        disable_z_lift = options is not None and "disable_z_lift" in options and options["disable_z_lift"]
+        gcode_lists = GcodeProcessor.get_snapshot_gcode(snapshot_plan, g90_influences_extruder, disable_z_lift)
+        if gcode_lists is None:
+            return None
 
-        self.send_end_command()
+        snapshot_gcode = SnapshotGcode()
+        (
+            snapshot_gcode.InitializationGcode,
+            snapshot_gcode.StartGcode,
+            snapshot_gcode.snapshot_commands,
+            snapshot_gcode.ReturnCommands,
+            snapshot_gcode.EndGcode
+        ) = gcode_lists
 
         # print out log messages
         if snapshot_plan.initial_position.file_line_number > 0:
@@ -1166,12 +625,12 @@ class SnapshotGcodeGenerator(object):
         # enhanced snapshot gcode logger
         if len(self.gcode_generation_settings.extruders) > 0 or snapshot_plan.initial_position.current_tool != 0:
             logger.info(
-                "Snapshot Gcode (Tool: %d):\r\n%s", snapshot_plan.initial_position.current_tool + 1, self.snapshot_gcode
+                "Snapshot Gcode (Tool: %d):\r\n%s", snapshot_plan.initial_position.current_tool + 1, snapshot_gcode
             )
         else:
-            logger.info("Snapshot Gcode:\r\n%s", self.snapshot_gcode)
+            logger.info("Snapshot Gcode:\r\n%s", snapshot_gcode)
 
-        return self.snapshot_gcode
+        return snapshot_gcode
 
     @staticmethod
     def get_g_command(cmd, x, y, z, e, f):
@@ -22,6 +22,8 @@
 ##################################################################################
 from __future__ import unicode_literals
 from threading import Thread
+import os
+import json
 from six.moves import queue
 from octoprint_octolapse.stabilization_gcode import SnapshotPlan, SnapshotGcodeGenerator
 from octoprint_octolapse.settings import PrinterProfile, TriggerProfile, StabilizationProfile
@@ -33,6 +35,25 @@ logging_configurator = LoggingConfigurator()
 logger = logging_configurator.get_logger(__name__)
 
 
+def prepare_snapshot_plan_cache(cache_directory, max_entries=25, extension=".plans"):
+    # Create the cache directory if necessary and remove the least recently written entries when there are too many.
+    # Position traces share the directory and use their own extension.  Returns None if the cache can't be used.
+    try:
+        if not os.path.isdir(cache_directory):
+            os.makedirs(cache_directory)
+        entries = [
+            os.path.join(cache_directory, name) for name in os.listdir(cache_directory) if name.endswith(extension)
+        ]
+        if len(entries) >= max_entries:
+            entries.sort(key=os.path.getmtime)
+            for path in entries[:len(entries) - max_entries + 1]:
+                os.remove(path)
+        return cache_directory
+    except (IOError, OSError):
+        logger.exception("Unable to prepare the snapshot plan cache, it will not be used.")
+        return None
+
+
 class StabilizationPreprocessingThread(Thread):
 
     def __init__(
@@ -43,7 +64,9 @@ class StabilizationPreprocessingThread(Thread):
         complete_callback,
         cancel_event,
         parsed_command,
-        notification_period_seconds=1
+        notification_period_seconds=1,
+        cache_directory=None,
+        toolpath_tolerance=None
     ):
 
         super(StabilizationPreprocessingThread, self).__init__()
@@ -67,11 +90,19 @@ class StabilizationPreprocessingThread(Thread):
         self.parsed_command = parsed_command
         self.cancel_event = cancel_event
         self.is_cancelled = False
+        # Read and cancelled from any thread without waiting on the progress callback, which needs the GIL.
+        self.processing_progress = GcodePositionProcessor.CreateProcessingProgress()
+        # Records the decimated toolpath for the stabilization preview.  The snapshot plan cache isn't loaded while
+        # the toolpath is recorded.
+        self.toolpath = None
+        if toolpath_tolerance is not None:
+            self.toolpath = GcodePositionProcessor.CreateToolpath(float(toolpath_tolerance))
         # make sure the event is set to start with
         if not self.cancel_event.is_set():
             self.cancel_event.set()
 
         self.notification_period_seconds = notification_period_seconds
+        self.cache_directory = cache_directory
         self.snapshot_plans = []
         self.printer_profile = printer
         self.stabilization_profile = stabilization
@@ -89,7 +120,7 @@ class StabilizationPreprocessingThread(Thread):
             ret_val, options = self._run_stabilization()
             logger.info(
                 "Received %s snapshot plans from the GcodePositionProcessor stabilization in %s seconds.",
-                len(ret_val[1]), ret_val[2]
+                len(self.snapshot_plans) + len(ret_val[1]), ret_val[2]
             )
             results = (
                 ret_val[0],  # success
@@ -131,8 +162,13 @@ class StabilizationPreprocessingThread(Thread):
         processing_issues = self._get_processing_issues_from_cpp(results[7])
         other_errors = results[8]
 
-        snapshot_plans = []
-        if success and not cpp_snapshot_plans:
+        # Most plans were streamed to on_snapshot_plans_received while processing, any others are in the results
+        snapshot_plans = self.snapshot_plans
+        if cpp_snapshot_plans:
+            snapshot_plans.extend(
+                SnapshotPlan.create_from_cpp_snapshot_plans(cpp_snapshot_plans, len(snapshot_plans) + 1)
+            )
+        if success and not snapshot_plans:
             success = False
             # see if there were any fatal processing issues
             has_fatal_issues = False
@@ -144,15 +180,29 @@ class StabilizationPreprocessingThread(Thread):
             if not has_fatal_issues and len(other_errors) == 0:
                 error = error_messages.get_error(["preprocessor", "preprocessor_errors", "no_snapshot_plans_returned"])
                 other_errors.append(error)
-        elif cpp_snapshot_plans:
-            snapshot_plans = SnapshotPlan.create_from_cpp_snapshot_plans(cpp_snapshot_plans)
 
+        if self.processing_progress.IsCancelRequested():
+            self.is_cancelled = True
         errors = other_errors + processing_issues
         self.complete_callback(
             success, self.is_cancelled, snapshot_plans, seconds_elapsed, gcodes_processed, lines_processed,
             missed_snapshots, quality_issues, errors, self.timelapse_settings, self.parsed_command
         )
 
+    @staticmethod
+    def _log_processing_stats(processing_stats):
+        # processing_stats is {stage name: {"calls", "timed_calls", "timed_ns", "estimated_seconds"}}, plus
+        # peak_buffered_snapshot_plans, the most snapshot plans that were held in memory at once.
+        peak_buffered_snapshot_plans = processing_stats.pop("peak_buffered_snapshot_plans", 0)
+        logger.debug(
+            "Stabilization stage timing: %s, peak buffered snapshot plans: %s",
+            ", ".join(
+                "{0}: {1} calls, {2:.3f}s".format(name, stage["calls"], stage["estimated_seconds"])
+                for name, stage in sorted(processing_stats.items())
+            ),
+            peak_buffered_snapshot_plans
+        )
+
     def _get_quality_issues_from_cpp(self, issues):
         quality_issues = []
         for issue in issues:
@@ -188,7 +238,13 @@ class StabilizationPreprocessingThread(Thread):
             'height_increment': height_increment,
             'notification_period_seconds': self.notification_period_seconds,
             'on_progress_received': self.on_progress_received,
+            'on_snapshot_plans_received': self.on_snapshot_plans_received,
+            'progress': self.processing_progress,
+            'toolpath': self.toolpath,
             'file_path': self.timelapse_settings["gcode_file_path"],
+            'cache_directory': None,
+            'trace_directory': None,
+            'checkpoint_directory': None,
             'gcode_generator': self.gcode_generator,
             "x_stabilization_disabled": (
                 self.stabilization_profile.x_type == StabilizationProfile.STABILIZATION_AXIS_TYPE_DISABLED
@@ -197,15 +253,84 @@ class StabilizationPreprocessingThread(Thread):
                 self.stabilization_profile.y_type == StabilizationProfile.STABILIZATION_AXIS_TYPE_DISABLED
             )
         }
+        main_settings = self.timelapse_settings["settings"].main_settings
+        if self.cache_directory is not None:
+            if main_settings.cache_snapshot_plans:
+                cache_key = self._create_cache_key()
+                if cache_key is not None:
+                    stabilization_args['cache_directory'] = prepare_snapshot_plan_cache(self.cache_directory)
+                    stabilization_args['cache_key'] = cache_key
+            if main_settings.save_position_traces:
+                # Position traces are several times larger than the gcode, so only keep the most recent few.  They
+                # only depend on the file and the printer, so changing the trigger or stabilization settings can
+                # replay one.
+                stabilization_args['trace_directory'] = prepare_snapshot_plan_cache(
+                    self.cache_directory, max_entries=3, extension=".trace"
+                )
+                # The position checkpoints of each layer let the position be rebuilt mid-print without replaying
+                # the file.
+                stabilization_args['checkpoint_directory'] = prepare_snapshot_plan_cache(
+                    self.cache_directory, extension=".checkpoints"
+                )
         return stabilization_args
 
-    def _run_stabilization(self):
-        options = {}
+    def _create_cache_key(self):
+        # The snapshot position comes from the gcode generator, so the cached plans are only valid for the same
+        # stabilization profile and printer volume.  Everything else is part of the native cache key.
+        try:
+            return json.dumps(
+                {
+                    "stabilization": json.loads(self.stabilization_profile.to_json()),
+                    "volume": self.timelapse_settings["overridable_printer_profile_settings"]["volume"]
+                },
+                sort_keys=True,
+                default=str
+            )
+        except (TypeError, ValueError, KeyError):
+            logger.exception("Unable to create the snapshot plan cache key, the cache will not be used.")
+            return None
+
+    @staticmethod
+    def is_pipeline_supported(trigger_profile):
+        # Only the smart layer trigger publishes how far it has planned, which the print needs to follow the plans
+        # while they are being created.  The pipeline needs a native thread, which some builds don't have.
+        return (
+            GcodePositionProcessor.HAS_THREADS != 0 and
+            trigger_profile.trigger_type == TriggerProfile.TRIGGER_TYPE_SMART and
+            trigger_profile.trigger_subtype == TriggerProfile.LAYER_TRIGGER_TYPE
+        )
+
+    def start_pipeline(self):
+        # Starts creating the snapshot plans on a native thread, and returns the GcodePositionProcessor.PlanPipeline
+        # that publishes them, so that the print can start while the rest of the file is scanned.  Returns None if
+        # the current trigger can't be pipelined.
+        if not self.is_pipeline_supported(self.trigger_profile):
+            return None
         stabilization_args = self._create_stabilization_args()
+        self._apply_vase_mode(stabilization_args)
+        return GcodePositionProcessor.StartSnapshotPlans_SmartLayer(
+            self.cpp_position_args,
+            stabilization_args,
+            self._create_smart_layer_args()
+        )
+
+    def _apply_vase_mode(self, stabilization_args):
         # if this is a vase mode print, set the minimum layer height to the
         # height increment so we can get better layer change detection for vase mode
         if self.printer_profile.gcode_generation_settings.vase_mode:
             self.cpp_position_args["minimum_layer_height"] = stabilization_args["height_increment"]
+
+    def _create_smart_layer_args(self):
+        return {
+            'trigger_type': int(self.trigger_profile.smart_layer_trigger_type),
+            'snap_to_print_high_quality': self.trigger_profile.smart_layer_snap_to_print_high_quality,
+            'snap_to_print_smooth': self.trigger_profile.smart_layer_snap_to_print_smooth
+        }
+
+    def _run_stabilization(self):
+        options = {}
+        stabilization_args = self._create_stabilization_args()
+        self._apply_vase_mode(stabilization_args)
         trigger_type = self.trigger_profile.trigger_type
         trigger_subtype = self.trigger_profile.trigger_subtype
         is_precalculated = (
@@ -233,16 +358,13 @@ class StabilizationPreprocessingThread(Thread):
             trigger_subtype == TriggerProfile.LAYER_TRIGGER_TYPE
         ):
             # run smart layer trigger
-            smart_layer_args = {
-                'trigger_type': int(self.trigger_profile.smart_layer_trigger_type),
-                'snap_to_print_high_quality': self.trigger_profile.smart_layer_snap_to_print_high_quality,
-                'snap_to_print_smooth': self.trigger_profile.smart_layer_snap_to_print_smooth
-            }
             ret_val = list(GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
                 self.cpp_position_args,
                 stabilization_args,
-                smart_layer_args
+                self._create_smart_layer_args()
             ))
+            # remove the processing stats, which are only logged
+            self._log_processing_stats(ret_val.pop())
             # add the success indicator
             ret_val.insert(0, True)
             # add the 'other' errors (errors not related to the C++ call)
@@ -263,6 +385,33 @@ class StabilizationPreprocessingThread(Thread):
                 stabilization_args,
                 smart_gcode_args
             ))
+            # remove the processing stats, which are only logged
+            self._log_processing_stats(ret_val.pop())
+            # add the success indicator
+            ret_val.insert(0, True)
+            # add the 'other' errors (errors not related to the C++ call)
+            ret_val.append([])
+            # set the results as the ret_val in tuple form
+            results = tuple(ret_val)
+            logger.info("Stabilization results received, returning.")
+        elif (
+                trigger_type == TriggerProfile.TRIGGER_TYPE_SMART and
+                trigger_subtype == TriggerProfile.TIMER_TRIGGER_TYPE
+        ):
+            # run smart timer trigger, which plans a snapshot every interval of estimated print time
+            smart_timer_args = {
+                'trigger_type': int(self.trigger_profile.smart_layer_trigger_type),
+                'snap_to_print_high_quality': self.trigger_profile.smart_layer_snap_to_print_high_quality,
+                'snap_to_print_smooth': self.trigger_profile.smart_layer_snap_to_print_smooth,
+                'interval_seconds': float(self.trigger_profile.timer_trigger_seconds)
+            }
+            ret_val = list(GcodePositionProcessor.GetSnapshotPlans_SmartTimer(
+                self.cpp_position_args,
+                stabilization_args,
+                smart_timer_args
+            ))
+            # remove the processing stats, which are only logged
+            self._log_processing_stats(ret_val.pop())
             # add the success indicator
             ret_val.insert(0, True)
             # add the 'other' errors (errors not related to the C++ call)
@@ -292,6 +441,26 @@ class StabilizationPreprocessingThread(Thread):
 
         return results, options
 
+    def cancel(self):
+        # The native loop checks the flag itself, so this doesn't wait for the next progress callback.
+        self.processing_progress.Cancel()
+
+    def get_progress(self):
+        # see ProcessingProgress.GetProgress
+        return self.processing_progress.GetProgress()
+
+    def get_toolpath_columns(self):
+        # see Toolpath.GetColumns.  Each column supports the buffer protocol, e.g. numpy.frombuffer(columns["x"], "f4")
+        if self.toolpath is None:
+            return None
+        return self.toolpath.GetColumns()
+
+    def on_snapshot_plans_received(self, cpp_snapshot_plans):
+        # Convert the plans as they arrive so that the native copies can be freed while the file is processed.
+        self.snapshot_plans.extend(
+            SnapshotPlan.create_from_cpp_snapshot_plans(cpp_snapshot_plans, len(self.snapshot_plans) + 1)
+        )
+
     def on_progress_received(self, percent_progress, seconds_elapsed, seconds_to_complete, gcodes_processed,
                              lines_processed):
         try:
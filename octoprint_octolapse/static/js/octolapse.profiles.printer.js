@@ -160,6 +160,7 @@ $(function() {
         self.snapshot_max_z = ko.observable(values.snapshot_max_z);
         self.priming_height = ko.observable(values.priming_height);
         self.minimum_layer_height = ko.observable(values.minimum_layer_height);
+        self.lock_slicer_from_header = ko.observable(values.lock_slicer_from_header);
         self.e_axis_default_mode = ko.observable(values.e_axis_default_mode);
         self.g90_influences_extruder = ko.observable(values.g90_influences_extruder);
         self.xyz_axes_default_mode = ko.observable(values.xyz_axes_default_mode);
@@ -257,6 +258,7 @@ $(function() {
             self.snapshot_max_z(server_profile.snapshot_max_z);
             self.priming_height(server_profile.priming_height);
             self.minimum_layer_height(server_profile.minimum_layer_height);
+            self.lock_slicer_from_header(server_profile.lock_slicer_from_header);
             self.e_axis_default_mode(server_profile.e_axis_default_mode);
             self.g90_influences_extruder(server_profile.g90_influences_extruder);
             self.xyz_axes_default_mode(server_profile.xyz_axes_default_mode);
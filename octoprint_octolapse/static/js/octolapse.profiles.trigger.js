@@ -85,18 +85,9 @@ $(function () {
         self.new_calculate_intersections = ko.observable(false);
         // Hold the parent dialog.
         self.dialog = null;
+        // Every subtype can be used with either trigger type.  Smart timer snapshots are planned from the
+        // estimated print time.
         self.get_trigger_subtype_options = ko.pureComputed( function () {
-                if (self.trigger_type() == 'smart') {
-                    var options = [];
-                    for (var index = 0; index < Octolapse.Triggers.profileOptions.trigger_subtype_options.length; index++) {
-                        var curItem = Octolapse.Triggers.profileOptions.trigger_subtype_options[index];
-                        if (curItem.value == 'timer') {
-                            continue;
-                        }
-                        options.push(curItem);
-                    }
-                    return options;
-                }
                 return Octolapse.Triggers.profileOptions.trigger_subtype_options;
             }, this);
 
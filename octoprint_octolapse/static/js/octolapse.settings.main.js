@@ -39,6 +39,10 @@ $(function () {
         self.preview_snapshot_plans = ko.observable();
         self.preview_snapshot_plan_autoclose = ko.observable();
         self.preview_snapshot_plan_seconds = ko.observable();
+        self.pipelined_preprocessing = ko.observable();
+        self.async_position_tracking = ko.observable();
+        self.save_position_traces = ko.observable();
+        self.cache_snapshot_plans = ko.observable();
         self.automatic_updates_enabled = ko.observable();
         self.automatic_update_interval_days = ko.observable();
         self.snapshot_archive_directory = ko.observable();
@@ -84,6 +88,10 @@ $(function () {
             self.preview_snapshot_plans(settings.preview_snapshot_plans);
             self.preview_snapshot_plan_autoclose(settings.preview_snapshot_plan_autoclose);
             self.preview_snapshot_plan_seconds(settings.preview_snapshot_plan_seconds);
+            self.pipelined_preprocessing(settings.pipelined_preprocessing);
+            self.async_position_tracking(settings.async_position_tracking);
+            self.save_position_traces(settings.save_position_traces);
+            self.cache_snapshot_plans(settings.cache_snapshot_plans);
             self.cancel_print_on_startup_error(settings.cancel_print_on_startup_error);
             self.automatic_update_interval_days(settings.automatic_update_interval_days);
             self.automatic_updates_enabled(settings.automatic_updates_enabled);
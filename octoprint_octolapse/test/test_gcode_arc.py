@@ -0,0 +1,170 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2020  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+
+import os
+import shutil
+import tempfile
+import unittest
+
+import GcodePositionProcessor
+from testing_utilities import get_position_args, SnapshotPositionGenerator
+from octoprint_octolapse.gcode_processor import GcodeProcessor
+from octoprint_octolapse.stabilization_gcode import SnapshotPlan, SnapshotGcodeGenerator
+
+
+class FakeExtruder(object):
+    x_y_travel_speed = 6000.0
+    z_lift_speed = 900.0
+    retraction_speed = 2400.0
+    deretraction_speed = 1800.0
+    retract_before_move = True
+    retraction_length = 0.8
+    lift_when_retracted = True
+    z_lift_height = 0.4
+
+
+class FakeGcodeGenerationSettings(object):
+    extruders = [FakeExtruder()]
+
+
+class FakePrinter(object):
+    gocde_axis_compatibility_mode_enabled = False
+
+    @staticmethod
+    def get_current_state_detection_settings():
+        return FakeGcodeGenerationSettings()
+
+
+class FakeStabilization(object):
+    wait_for_moves_to_finish = True
+
+    @staticmethod
+    def get_stabilization_paths():
+        return {"x": None, "y": None}
+
+
+class FakeProfiles(object):
+    @staticmethod
+    def current_stabilization():
+        return FakeStabilization()
+
+    @staticmethod
+    def current_printer():
+        return FakePrinter()
+
+
+class FakeSettings(object):
+    profiles = FakeProfiles()
+
+
+class TestGcodeArc(unittest.TestCase):
+    # Snap to print can take a snapshot part of the way along a G2/G3 arc.  The arc is then split in two at the
+    # point closest to the stabilization point, which is (100, 150) for every arc below.
+    POSITION_ARGS = get_position_args()
+    SMART_LAYER_ARGS = {"trigger_type": 0, "snap_to_print_high_quality": False, "snap_to_print_smooth": False}
+    LAYER_COUNT = 5
+    ARC_E = 4.0
+
+    def setUp(self):
+        self.temp_directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_directory)
+
+    def create_gcode(self, start_x, arc_command):
+        # Every layer prints a half circle of radius 50 around (100, 100) that passes through (100, 150).
+        lines = [";FLAVOR:Marlin", "M83", "G21", "G90", "G28", "G1 Z0.3 F3000"]
+        for layer in range(self.LAYER_COUNT):
+            lines.append(";LAYER:{0}".format(layer))
+            lines.append("G0 F9000 X{0:.3f} Y90.000 Z{1:.3f}".format(start_x, 0.3 + layer * 0.2))
+            # The arc isn't split at the start of an extrusion, since that depends on the state before the move.
+            lines.append("G1 X{0:.3f} Y100.000 E0.50000 F1800".format(start_x))
+            lines.append(arc_command)
+        return "\n".join(lines) + "\n"
+
+    def get_snapshot_plans(self, gcode):
+        path = os.path.join(self.temp_directory, "arc.gcode")
+        with open(path, "w") as gcode_file:
+            gcode_file.write(gcode)
+        stabilization_args = {
+            "height_increment": 0.0,
+            "notification_period_seconds": 0.0,
+            "on_progress_received": lambda *args: True,
+            "file_path": path,
+            # Every snapshot is stabilized above the top of the arcs.
+            "gcode_generator": SnapshotPositionGenerator(100.0, 180.0),
+            "x_stabilization_disabled": False,
+            "y_stabilization_disabled": False,
+        }
+        results = GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
+            self.POSITION_ARGS, stabilization_args, self.SMART_LAYER_ARGS
+        )
+        return SnapshotPlan.create_from_cpp_snapshot_plans(results[0])
+
+    @staticmethod
+    def get_parameters(gcode):
+        parsed = GcodeProcessor.parse(gcode)
+        return parsed.cmd, parsed.parameters
+
+    def assert_arc_split(self, start_x, arc_command, end_x):
+        plans = self.get_snapshot_plans(self.create_gcode(start_x, arc_command))
+        self.assertEqual(self.LAYER_COUNT, len(plans))
+        generator = SnapshotGcodeGenerator(FakeSettings(), {"volume": self.POSITION_ARGS["volume"]})
+        for plan in plans:
+            self.assertEqual(arc_command, plan.triggering_command.gcode)
+            self.assertAlmostEqual(100.0, plan.initial_position.x, places=3)
+            self.assertAlmostEqual(150.0, plan.initial_position.y, places=3)
+            snapshot_gcode = generator.create_gcode_for_snapshot_plan(plan, False, None)
+            self.assertIsNotNone(snapshot_gcode)
+            # The first part of the arc is printed before the snapshot, and the rest of it afterwards.
+            start_cmd, start_parameters = self.get_parameters(snapshot_gcode.InitializationGcode[0])
+            end_cmd, end_parameters = self.get_parameters(snapshot_gcode.EndGcode[-1])
+            original_cmd = plan.triggering_command.cmd
+            self.assertEqual(original_cmd, start_cmd)
+            self.assertEqual(original_cmd, end_cmd)
+            self.assertAlmostEqual(100.0, float(start_parameters["X"]), places=3)
+            self.assertAlmostEqual(150.0, float(start_parameters["Y"]), places=3)
+            self.assertAlmostEqual(end_x, float(end_parameters["X"]), places=3)
+            self.assertAlmostEqual(100.0, float(end_parameters["Y"]), places=3)
+            # Both parts turn around the original center.
+            self.assertAlmostEqual(100.0 - start_x, float(start_parameters["I"]), places=3)
+            self.assertAlmostEqual(0.0, float(start_parameters["J"]), places=3)
+            self.assertAlmostEqual(0.0, float(end_parameters["I"]), places=3)
+            self.assertAlmostEqual(-50.0, float(end_parameters["J"]), places=3)
+            # The extrusion of the arc is divided between its parts.
+            self.assertAlmostEqual(
+                self.ARC_E, float(start_parameters["E"]) + float(end_parameters["E"]), places=4
+            )
+
+    def test_clockwise_arc(self):
+        """A G2 arc is split at the point closest to the stabilization point."""
+        self.assert_arc_split(50.0, "G2 X150.000 Y100.000 I50.000 J0.000 E{0:.5f}".format(self.ARC_E), 150.0)
+
+    def test_counter_clockwise_arc(self):
+        """A G3 arc is split at the point closest to the stabilization point."""
+        self.assert_arc_split(150.0, "G3 X50.000 Y100.000 I-50.000 J0.000 E{0:.5f}".format(self.ARC_E), 50.0)
+
+
+if __name__ == '__main__':
+    suite = unittest.TestLoader().loadTestsFromTestCase(TestGcodeArc)
+    unittest.TextTestRunner(verbosity=3).run(suite)
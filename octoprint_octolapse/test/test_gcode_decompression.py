@@ -0,0 +1,283 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2020  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+
+import gzip
+import io
+import os
+import shutil
+import struct
+import tempfile
+import unittest
+import zlib
+
+import GcodePositionProcessor
+from testing_utilities import get_position_args, SnapshotPositionGenerator
+
+
+class TestGcodeDecompression(unittest.TestCase):
+    # Compressed and binary gcode files must produce the same snapshot plans as the gcode text they contain.
+    POSITION_ARGS = get_position_args(e_axis_default_mode="absolute")
+    SMART_LAYER_ARGS = {"trigger_type": 0, "snap_to_print_high_quality": False, "snap_to_print_smooth": False}
+    PRINTER_METADATA = b"printer_model=MK4\nnozzle_diameter=0.4\n"
+    LAYER_COUNT = 30
+
+    def setUp(self):
+        self.temp_directory = tempfile.mkdtemp()
+        self.gcode = self.create_gcode(self.LAYER_COUNT)
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_directory)
+
+    @staticmethod
+    def create_gcode(layer_count):
+        lines = [";FLAVOR:Marlin", "M82", "G21", "G90", "G28", "G92 E0", "G1 Z0.3 F3000"]
+        e = 0.0
+        for layer in range(layer_count):
+            z = 0.3 + layer * 0.2
+            lines.append(";LAYER:{0}".format(layer))
+            lines.append("G1 E{0:.5f} F2400".format(e - 0.8))
+            lines.append("G0 F9000 X{0:.3f} Y{1:.3f} Z{2:.3f}".format(50 + layer, 50 + layer, z))
+            lines.append("G1 E{0:.5f} F2400".format(e))
+            for move in range(40):
+                e += 0.05
+                lines.append("G1 X{0:.3f} Y{1:.3f} E{2:.5f} ; move {3}".format(
+                    50 + (move * 7 + layer) % 40, 50 + (move * 13 + layer) % 40, e, move
+                ))
+        return "\n".join(lines).encode("ascii") + b"\n"
+
+    @staticmethod
+    def heatshrink_compress(data, window_bits, lookahead_bits=4):
+        # A greedy heatshrink encoder.  Each symbol is a 1 bit tag followed by a literal byte, or by the offset and the
+        # length of an earlier match, with the most significant bit first.
+        window_size = 1 << window_bits
+        max_length = 1 << lookahead_bits
+        bits = []
+        position = 0
+        while position < len(data):
+            window_start = max(0, position - window_size)
+            length = 0
+            offset = 0
+            # A match of 2 bytes is no longer than the literals, but it is allowed.
+            for test_length in range(2, min(max_length, len(data) - position) + 1):
+                # The match may overlap the bytes it produces.
+                match = data.rfind(data[position:position + test_length], window_start, position + test_length - 1)
+                if match < 0:
+                    break
+                length = test_length
+                offset = position - match
+            if length == 0:
+                bits.append("1{0:08b}".format(data[position]))
+                position += 1
+            else:
+                bits.append("0{0:0{1}b}{2:0{3}b}".format(offset - 1, window_bits, length - 1, lookahead_bits))
+                position += length
+        bit_string = "".join(bits)
+        # The last byte is padded with zeros
+        bit_string += "0" * (-len(bit_string) % 8)
+        return bytes(int(bit_string[index:index + 8], 2) for index in range(0, len(bit_string), 8))
+
+    @staticmethod
+    def meatpack_encode(gcode, keep_comments):
+        # Encodes gcode like PrusaSlicer's binarizer:  inline comments are removed, spaces are removed from G lines
+        # (the 4 bit code for a space becomes an 'E'), and the most common characters are packed two to a byte.
+        # Comment lines are removed, or sent with packing disabled if they are kept.
+        codes = dict((c, index) for index, c in enumerate(b"0123456789.E\nGX"))
+        signal = b"\xff\xff"
+        enable_packing, disable_packing, reset_all, enable_no_spaces = b"\xfb", b"\xfa", b"\xf9", b"\xf7"
+        encoded = bytearray(signal + enable_packing + signal + enable_no_spaces)
+        is_packing = True
+        for line in gcode.splitlines():
+            if line.startswith(b";"):
+                if keep_comments:
+                    if is_packing:
+                        encoded += signal + disable_packing
+                        is_packing = False
+                    encoded += line + b"\n"
+                continue
+            line = line.split(b";")[0].strip()
+            if not line:
+                continue
+            if line.startswith(b"G"):
+                line = line.replace(b" ", b"")
+            line += b"\n"
+            if not is_packing:
+                encoded += signal + enable_packing
+                is_packing = True
+            # The second character of a pair that ends with the newline is padding
+            if len(line) % 2 == 1:
+                line += b"0"
+            for index in range(0, len(line), 2):
+                first, second = line[index:index + 1], line[index + 1:index + 2]
+                first_code, second_code = codes.get(first[0], 15), codes.get(second[0], 15)
+                encoded.append(first_code | (second_code << 4))
+                # Characters without a code follow the packed byte in full
+                if first_code == 15:
+                    encoded += first
+                if second_code == 15:
+                    encoded += second
+        encoded += signal + reset_all
+        return bytes(encoded)
+
+    @classmethod
+    def compress(cls, compression, data):
+        if compression == 1:
+            return zlib.compress(data)
+        if compression == 2:
+            return cls.heatshrink_compress(data, 11)
+        if compression == 3:
+            return cls.heatshrink_compress(data, 12)
+        return data
+
+    @classmethod
+    def create_binary_gcode_block(cls, block_type, compression, data, parameters):
+        if compression == 0:
+            payload = data
+            header = struct.pack("<HHI", block_type, compression, len(data))
+        else:
+            payload = cls.compress(compression, data)
+            header = struct.pack("<HHII", block_type, compression, len(data), len(payload))
+        block = header + parameters + payload
+        return block + struct.pack("<I", zlib.crc32(block) & 0xffffffff)
+
+    def create_binary_gcode(self, compression, gcode_block_size=16384, encoding=0):
+        # A printer metadata block and the gcode split into several gcode blocks, each with a CRC32 checksum.
+        binary_gcode = b"GCDE" + struct.pack("<IH", 1, 1)
+        binary_gcode += self.create_binary_gcode_block(3, compression, self.PRINTER_METADATA, b"\0\0")
+        start = 0
+        while start < len(self.gcode):
+            end = self.gcode.find(b"\n", start + gcode_block_size) + 1 or len(self.gcode)
+            data = self.gcode[start:end]
+            # Each gcode block is encoded on its own
+            if encoding != 0:
+                data = self.meatpack_encode(data, encoding == 2)
+            binary_gcode += self.create_binary_gcode_block(1, compression, data, struct.pack("<H", encoding))
+            start = end
+        return binary_gcode
+
+    def write_file(self, name, data):
+        path = os.path.join(self.temp_directory, name)
+        with open(path, "wb") as gcode_file:
+            gcode_file.write(data)
+        return path
+
+    def get_snapshot_plans(self, path):
+        stabilization_args = {
+            "height_increment": 0.0,
+            "notification_period_seconds": 0.0,
+            "on_progress_received": lambda *args: True,
+            "file_path": path,
+            # Every snapshot is stabilized at the center of the bed.
+            "gcode_generator": SnapshotPositionGenerator(100.0, 100.0),
+            "x_stabilization_disabled": False,
+            "y_stabilization_disabled": False,
+        }
+        results = GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
+            self.POSITION_ARGS, stabilization_args, self.SMART_LAYER_ARGS
+        )
+        # (snapshot plans, processing issues)
+        return results[0], results[6]
+
+    @staticmethod
+    def get_decode_errors(issues):
+        # The issues may also include any the partially decoded gcode causes.
+        return [issue[2]["decode_error"] for issue in issues if "decode_error" in issue[2]]
+
+    def assert_same_plans(self, data, expected_gcode):
+        expected_plans, expected_issues = self.get_snapshot_plans(self.write_file("expected.gcode", expected_gcode))
+        self.assertEqual([], expected_issues)
+        self.assertEqual(self.LAYER_COUNT, len(expected_plans))
+        plans, issues = self.get_snapshot_plans(self.write_file("test.bin", data))
+        self.assertEqual([], issues)
+        self.assertEqual(expected_plans, plans)
+
+    @staticmethod
+    def gzip_compress(data, compression_level=9, file_name=""):
+        # gzip.compress isn't available in python 2
+        gzip_buffer = io.BytesIO()
+        with gzip.GzipFile(
+            filename=file_name, mode="wb", compresslevel=compression_level, fileobj=gzip_buffer
+        ) as gzip_file:
+            gzip_file.write(data)
+        return gzip_buffer.getvalue()
+
+    def test_gzip(self):
+        """Gzip files are decoded at every compression level."""
+        for compression_level in (0, 1, 6, 9):
+            self.assert_same_plans(self.gzip_compress(self.gcode, compression_level), self.gcode)
+
+    def test_gzip_with_file_name(self):
+        """Gzip files that store the original file name are decoded."""
+        self.assert_same_plans(self.gzip_compress(self.gcode, file_name="print.gcode"), self.gcode)
+
+    def test_gzip_multiple_members(self):
+        """Every member of a gzip file with several members is decoded."""
+        middle = self.gcode.find(b"\n", len(self.gcode) // 2) + 1
+        data = self.gzip_compress(self.gcode[:middle]) + self.gzip_compress(self.gcode[middle:])
+        self.assert_same_plans(data, self.gcode)
+
+    def test_zlib(self):
+        """Zlib streams are decoded."""
+        self.assert_same_plans(zlib.compress(self.gcode), self.gcode)
+
+    def test_binary_gcode(self):
+        """Binary gcode blocks are decoded, and the metadata becomes comments."""
+        expected_gcode = b"; printer_model = MK4\n; nozzle_diameter = 0.4\n" + self.gcode
+        for compression in (0, 1):
+            self.assert_same_plans(self.create_binary_gcode(compression), expected_gcode)
+
+    def test_binary_gcode_heatshrink(self):
+        """Binary gcode blocks compressed with heatshrink 11/4 and 12/4 are decoded."""
+        expected_gcode = b"; printer_model = MK4\n; nozzle_diameter = 0.4\n" + self.gcode
+        for compression in (2, 3):
+            self.assert_same_plans(self.create_binary_gcode(compression), expected_gcode)
+
+    def test_binary_gcode_meatpack(self):
+        """MeatPack encoded gcode blocks are decoded, with or without comments."""
+        metadata = b"; printer_model = MK4\n; nozzle_diameter = 0.4\n"
+        # The encoder removes the inline comments
+        gcode = b"\n".join(line.split(b" ;")[0] for line in self.gcode.split(b"\n"))
+        gcode_without_comments = b"".join(
+            line for line in gcode.splitlines(True) if not line.startswith(b";")
+        )
+        for compression in (0, 3):
+            self.assert_same_plans(self.create_binary_gcode(compression, encoding=1), metadata + gcode_without_comments)
+            self.assert_same_plans(self.create_binary_gcode(compression, encoding=2), metadata + gcode)
+
+    def test_truncated_gzip(self):
+        """A truncated gzip file is reported as a processing issue."""
+        data = self.gzip_compress(self.gcode)
+        plans, issues = self.get_snapshot_plans(self.write_file("truncated.gz", data[:len(data) // 2]))
+        self.assertEqual(1, len(self.get_decode_errors(issues)))
+        self.assertLess(len(plans), self.LAYER_COUNT)
+
+    def test_corrupt_binary_gcode(self):
+        """A binary gcode block with a bad checksum is reported as a processing issue."""
+        data = bytearray(self.create_binary_gcode(1))
+        data[len(data) // 2] ^= 0x20
+        plans, issues = self.get_snapshot_plans(self.write_file("corrupt.bgcode", bytes(data)))
+        self.assertEqual(1, len(self.get_decode_errors(issues)))
+
+
+if __name__ == '__main__':
+    suite = unittest.TestLoader().loadTestsFromTestCase(TestGcodeDecompression)
+    unittest.TextTestRunner(verbosity=3).run(suite)
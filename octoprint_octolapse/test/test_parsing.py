@@ -20,9 +20,12 @@
 # You can contact the author either through the git-hub repository, or at the
 # following email address: FormerLurker@pm.me
 ##################################################################################
+import random
+import struct
 import time
 import unittest
 
+import GcodePositionProcessor
 from octoprint_octolapse.gcode_commands import Commands, Response
 
 
@@ -528,6 +531,104 @@ class TestParsing(unittest.TestCase):
 #        print("{0} parses in {1} seconds, {2}MS per parse".format(num_tests, total_time, ms_per_op))
 
 
+def parse_number_reference(text):
+    # The digit by digit number parser that gcode_parser::try_extract_double_reference uses, with the same double
+    # arithmetic, so that the native fast path can be checked bit for bit.  Returns None if no digits are found.
+    index = 0
+    length = len(text)
+    while index < length and text[index] == " ":
+        index += 1
+    negative = False
+    if index < length and text[index] in "-+":
+        negative = text[index] == "-"
+        index += 1
+        while index < length and text[index] == " ":
+            index += 1
+    value = 0.0
+    found_numbers = False
+    while index < length and (text[index].isdigit() or text[index] == " "):
+        if text[index] != " ":
+            found_numbers = True
+            value = value * 10.0 + (ord(text[index]) - ord("0"))
+        index += 1
+    if index < length and text[index] == ".":
+        fraction = 0.0
+        power = 1.0
+        index += 1
+        while index < length and (text[index].isdigit() or text[index] == " "):
+            if text[index] != " ":
+                found_numbers = True
+                fraction = fraction * 10.0 + (ord(text[index]) - ord("0"))
+                power *= 10
+            index += 1
+        value += fraction / power
+    if not found_numbers:
+        return None
+    return -value if negative else value
+
+
+class TestNativeNumberParsing(unittest.TestCase):
+    # The native parser converts short digit runs several characters at a time, and hands everything else to the
+    # reference parser.  Both must produce identical doubles.
+
+    EDGE_CASES = [
+        "0", "-0", "+0", "0.", ".0", "-.5", "1.", "12345678", "123456789", "1234567.8", "12345678.12345678",
+        "123456789012345", "1234567890123456", "12345678901234567890", "0.123456789012345", "0.1234567890123456",
+        "0.000000000000001", "9999999999999999", "999999999999999.999999999999999", "1 2.3", "12 .5", "1. 5",
+        "  -  12.5", "- 1", "00000000000000000001", "0.00000000", "3.14159265358979", "10.000000000000001",
+        "0.1", "0.2", "0.3", "1234.5678", "-9876.54321", "+7.000001"
+    ]
+
+    def assert_same_double(self, text, expected, actual):
+        self.assertEqual(
+            struct.pack("<d", expected), struct.pack("<d", actual),
+            "'{0}' parsed as {1!r}, the reference is {2!r}".format(text, actual, expected)
+        )
+
+    def assert_parses_like_reference(self, text):
+        expected = parse_number_reference(text)
+        self.assertIsNotNone(expected)
+        # Check with the end of the line right after the number, and with more parameters after it.
+        for gcode in ("G1 X{0}".format(text), "G1 X{0} Y7.5 Z0.2 ; 12345678".format(text)):
+            parsed = GcodePositionProcessor.Parse(gcode)
+            self.assertEqual(parsed[0], "G1")
+            self.assert_same_double(text, expected, parsed[1]["X"])
+
+    def test_edge_cases(self):
+        for text in self.EDGE_CASES:
+            self.assert_parses_like_reference(text)
+
+    def test_random_digit_runs(self):
+        # Digit runs of every length, including the boundaries of the fast path.
+        generator = random.Random(12345)
+        for index in range(20000):
+            text = ""
+            if generator.randint(0, 3) == 0:
+                text += generator.choice("-+")
+            integer_digits = generator.randint(0, 19)
+            text += "".join(generator.choice("0123456789") for digit in range(integer_digits))
+            fraction_digits = 0
+            if generator.randint(0, 2) != 0:
+                fraction_digits = generator.randint(0, 19)
+                text += "." + "".join(generator.choice("0123456789") for digit in range(fraction_digits))
+            if integer_digits + fraction_digits > 0:
+                self.assert_parses_like_reference(text)
+
+    def test_slicer_gcode(self):
+        gcode = [
+            "G1 X105.432 Y98.21 E0.03512",
+            "G1 F1800 X110.0 Y97.806 E4.46012",
+            "G0 F7200 X120.139 Y100.668 Z0.3",
+            "G1 Z.48 F10800",
+            "G1 X-12.5 Y-0.001 E-1.25 F2400",
+            "G1 X84.123456789 Y123.98765432100 E123.456789012345",
+        ]
+        for line in gcode:
+            parsed = GcodePositionProcessor.Parse(line)
+            for word in line.split()[1:]:
+                self.assert_same_double(word, parse_number_reference(word[1:]), parsed[1][word[0]])
+
+
 if __name__ == '__main__':
     suite = unittest.TestLoader().loadTestsFromTestCase(TestParsing)
     unittest.TextTestRunner(verbosity=3).run(suite)
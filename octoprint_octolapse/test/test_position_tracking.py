@@ -0,0 +1,86 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2020  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+
+import unittest
+
+from testing_utilities import get_position_args
+from octoprint_octolapse.gcode_processor import GcodeProcessor, Pos
+
+
+class TestPositionTracking(unittest.TestCase):
+    # The parts of the position that a tracking_mask leaves out must read as cleared, never as values from an
+    # earlier position.
+    KEY = "test_position_tracking"
+    BOUNDS = {"min_x": 0.0, "max_x": 100.0, "min_y": 0.0, "max_y": 100.0, "min_z": 0.0, "max_z": 200.0}
+    GCODE = [
+        "M83", "G90", "G21", "G28", "G1 Z0.3 F3000", ";TYPE:WALL-OUTER", "G1 X10 Y10 E1", "G1 X20 Y10 E1",
+        "G1 E-0.8", "G1 Z0.7", "G1 X150 Y10", "G1 Z0.5", "G1 E0.8", "G1 X60 Y20 E1",
+        "G1 X70 Y30 E1"
+    ]
+
+    def get_positions(self, tracking_mask):
+        position_args = get_position_args(bounds=self.BOUNDS, tracking_mask=tracking_mask)
+        handle = GcodeProcessor.initialize_position_processor(position_args, key=self.KEY)
+        positions = []
+        for gcode in self.GCODE:
+            positions.append(GcodeProcessor.update(gcode, Pos(), handle=handle))
+        return positions
+
+    def test_full_tracking(self):
+        """Every part of the position is tracked by default."""
+        positions = self.get_positions(GcodeProcessor.POSITION_TRACKING_ALL)
+        self.assertFalse(all(position.is_in_bounds for position in positions))
+        position = positions[-1]
+        self.assertTrue(position.get_current_extruder().is_extruding)
+        self.assertTrue(position.is_printer_primed)
+        self.assertEqual(2, position.layer)
+        self.assertAlmostEqual(0.5, position.last_extrusion_height)
+
+    def test_untracked_parts_are_cleared(self):
+        """The untracked parts keep their cleared values after every gcode."""
+        tracked = self.get_positions(GcodeProcessor.POSITION_TRACKING_ALL)
+        untracked = self.get_positions(0)
+        for tracked_position, position in zip(tracked, untracked):
+            message = "The position differs after {0}.".format(position.parsed_command.gcode)
+            self.assertEqual(tracked_position.x, position.x, message)
+            self.assertEqual(tracked_position.z, position.z, message)
+            self.assertEqual(
+                tracked_position.get_current_extruder().extrusion_length_total,
+                position.get_current_extruder().extrusion_length_total,
+                message
+            )
+            self.assertTrue(position.is_in_bounds, message)
+            extruder = position.get_current_extruder()
+            self.assertEqual(0, extruder.extrusion_length, message)
+            self.assertEqual(0, extruder.retraction_length, message)
+            self.assertFalse(extruder.is_extruding or extruder.is_retracted or extruder.is_primed, message)
+            self.assertFalse(position.is_printer_primed, message)
+            self.assertFalse(position.is_zhop, message)
+            self.assertEqual(0, position.layer, message)
+            self.assertIsNone(position.last_extrusion_height, message)
+            self.assertEqual(0, position.height_increment, message)
+
+
+if __name__ == '__main__':
+    suite = unittest.TestLoader().loadTestsFromTestCase(TestPositionTracking)
+    unittest.TextTestRunner(verbosity=3).run(suite)
@@ -0,0 +1,315 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2020  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+
+import unittest
+
+from octoprint_octolapse.gcode_processor import GcodeProcessor, Pos, Extruder
+from octoprint_octolapse.stabilization_gcode import SnapshotPlan, SnapshotPlanStep
+
+
+class TestNativeSnapshotGcode(unittest.TestCase):
+    # The expected gcode is the output of the python SnapshotGcodeGenerator that the native generator replaced, except
+    # where noted.  Each result is (initialization, start, snapshot, return, end).
+    KEY = "test_snapshot_gcode_generator"
+
+    EXTRUDER_ARGS = {
+        "x_y_travel_speed": 6000.0,
+        "z_lift_speed": 900.0,
+        "retraction_speed": 2400.0,
+        "deretraction_speed": 1800.0,
+        "retract_before_move": True,
+        "retraction_length": 2.0,
+        "lift_when_retracted": True,
+        "z_lift_height": 0.5,
+    }
+
+    @classmethod
+    def initialize_generator(cls, axis_mode_compatibility=False, wait_for_moves_to_finish=True, **speeds):
+        extruder_args = dict(cls.EXTRUDER_ARGS)
+        extruder_args.update(speeds)
+        GcodeProcessor.initialize_snapshot_gcode_generator(
+            {
+                "extruders": [extruder_args],
+                "axis_mode_compatibility": axis_mode_compatibility,
+                "wait_for_moves_to_finish": wait_for_moves_to_finish,
+                "max_z": 200.0
+            },
+            key=cls.KEY
+        )
+
+    @staticmethod
+    def create_position(
+        is_relative=False, is_extruder_relative=True, z=0.3, f=1800.0, e=10.0, retraction_length=0.0,
+        last_extrusion_height=0.3
+    ):
+        position = Pos()
+        position.x = 10.0
+        position.y = 10.0
+        position.z = z
+        position.f = f
+        position.is_relative = is_relative
+        position.is_extruder_relative = is_extruder_relative
+        position.is_metric = True
+        position.current_tool = 0
+        position.last_extrusion_height = last_extrusion_height
+        extruder = Extruder()
+        extruder.e = e
+        extruder.retraction_length = retraction_length
+        position.extruders = [extruder]
+        return position
+
+    @staticmethod
+    def create_plan(initial_position, return_position, start_gcode=None, end_gcode=None, x=125.0, y=190.5):
+        return SnapshotPlan(
+            file_line_number=100,
+            file_gcode_number=90,
+            file_position=2048,
+            travel_distance=10.0,
+            saved_travel_distance=0.0,
+            start_command=None if start_gcode is None else GcodeProcessor.parse(start_gcode),
+            triggering_command=GcodeProcessor.parse("G1 X10 Y10 E1"),
+            initial_position=initial_position,
+            steps=[
+                SnapshotPlanStep(SnapshotPlan.TRAVEL_ACTION, x=x, y=y),
+                SnapshotPlanStep(SnapshotPlan.SNAPSHOT_ACTION)
+            ],
+            return_position=return_position,
+            end_command=None if end_gcode is None else GcodeProcessor.parse(end_gcode)
+        )
+
+    def assert_gcode(self, plan, expected, g90_influences_extruder=False, disable_z_lift=False):
+        gcode = GcodeProcessor.get_snapshot_gcode(plan, g90_influences_extruder, disable_z_lift, key=self.KEY)
+        self.assertIsNotNone(gcode)
+        self.assertEqual(tuple(list(gcode_list) for gcode_list in gcode), expected)
+
+    def test_absolute_axes(self):
+        self.initialize_generator()
+        plan = self.create_plan(
+            self.create_position(is_extruder_relative=False),
+            self.create_position(is_extruder_relative=False, e=11.0),
+            end_gcode="G1 X11 Y10 E1"
+        )
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E8.00000 F2400.000", "G1 Z0.800 F900.000"],
+            ["G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300 F900.000", "G1 E10.00000 F1800.000", "G1 X11 Y10 E1"]
+        ))
+
+    def test_relative_axes(self):
+        self.initialize_generator()
+        plan = self.create_plan(
+            self.create_position(is_relative=True), self.create_position(is_relative=True), end_gcode="G1 X1 Y0 E0.1"
+        )
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000 F2400.000", "G1 Z0.500 F900.000"],
+            ["G0 X115.000 Y180.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X-115.000 Y-180.500"],
+            ["G1 Z-0.500 F900.000", "G1 E2.00000 F1800.000", "G1 X1 Y0 E0.1"]
+        ))
+
+    def test_relative_axes_single_axis_travel(self):
+        # The python generator skipped relative travel, and the return, unless both X and Y changed.
+        self.initialize_generator()
+        plan = self.create_plan(
+            self.create_position(is_relative=True), self.create_position(is_relative=True), y=10.0
+        )
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000 F2400.000", "G1 Z0.500 F900.000"],
+            ["G0 X115.000 Y0.000 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X-115.000 Y0.000"],
+            ["G1 Z-0.500 F900.000", "G1 E2.00000 F1800.000"]
+        ))
+
+    def test_g90_influences_extruder(self):
+        # G91 also makes the extruder relative, so the retraction is absolute here.
+        self.initialize_generator()
+        plan = self.create_plan(
+            self.create_position(is_relative=True, is_extruder_relative=False),
+            self.create_position(is_relative=True, is_extruder_relative=False)
+        )
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E8.00000 F2400.000", "G1 Z0.500 F900.000"],
+            ["G0 X115.000 Y180.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X-115.000 Y-180.500"],
+            ["G1 Z-0.500 F900.000", "G1 E10.00000 F1800.000"]
+        ), g90_influences_extruder=True)
+
+    def test_axis_mode_compatibility(self):
+        # The current axis modes are switched to absolute xyz and relative extrusion, and restored at the end.
+        self.initialize_generator(axis_mode_compatibility=True)
+        plan = self.create_plan(
+            self.create_position(is_relative=True, is_extruder_relative=False),
+            self.create_position(is_relative=True, is_extruder_relative=False)
+        )
+        self.assert_gcode(plan, (
+            [],
+            ["M83", "G1 E-2.00000 F2400.000", "G1 Z0.500 F900.000"],
+            ["G90", "G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G91", "G1 Z-0.500 F900.000", "G1 E2.00000 F1800.000", "M82"]
+        ))
+
+    def test_already_retracted(self):
+        self.initialize_generator()
+        plan = self.create_plan(
+            self.create_position(retraction_length=2.0), self.create_position(retraction_length=2.0)
+        )
+        self.assert_gcode(plan, (
+            [],
+            ["G1 Z0.800 F900.000"],
+            ["G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300 F900.000", "G1 F1800.000"]
+        ))
+
+    def test_already_lifted(self):
+        self.initialize_generator()
+        plan = self.create_plan(self.create_position(z=0.8), self.create_position(z=0.8))
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000 F2400.000"],
+            ["G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 E2.00000 F1800.000"]
+        ))
+
+    def test_z_lift_disabled(self):
+        self.initialize_generator()
+        plan = self.create_plan(self.create_position(), self.create_position())
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000 F2400.000"],
+            ["G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 E2.00000 F1800.000"]
+        ), disable_z_lift=True)
+
+    def test_stabilization_disabled(self):
+        # Without waiting for moves to finish, the snapshot is taken wherever the printer is.
+        self.initialize_generator(wait_for_moves_to_finish=False)
+        plan = self.create_plan(self.create_position(), self.create_position())
+        self.assert_gcode(plan, ([], [], ["@OCTOLAPSE TAKE-SNAPSHOT"], [], []))
+
+    def test_start_and_end_commands(self):
+        self.initialize_generator()
+        plan = self.create_plan(
+            self.create_position(), self.create_position(), start_gcode="G1 X5 Y5", end_gcode="G1 X11 Y10"
+        )
+        self.assert_gcode(plan, (
+            ["G1 X5 Y5"],
+            ["G1 E-2.00000 F2400.000", "G1 Z0.800 F900.000"],
+            ["G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300 F900.000", "G1 E2.00000 F1800.000", "G1 X11 Y10"]
+        ))
+
+    def test_return_feedrate(self):
+        self.initialize_generator()
+        # Without an end command, the return feedrate is set on its own.
+        plan = self.create_plan(self.create_position(), self.create_position(f=3000.0))
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000 F2400.000", "G1 Z0.800 F900.000"],
+            ["G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300 F900.000", "G1 E2.00000 F1800.000", "G1 F3000.000"]
+        ))
+        # Otherwise it is added to the end command.  The python generator wrote F3000 here.
+        plan = self.create_plan(
+            self.create_position(), self.create_position(f=3000.0), end_gcode="G1 X11 Y10 E1"
+        )
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000 F2400.000", "G1 Z0.800 F900.000"],
+            ["G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300 F900.000", "G1 E2.00000 F1800.000", "G1 X11.000 Y10.000 E1.00000 F3000.000"]
+        ))
+
+    def test_unknown_return_feedrate(self):
+        # The python generator appended a bare F to the end command when the return feedrate was unknown.
+        self.initialize_generator()
+        plan = self.create_plan(self.create_position(), self.create_position(f=None), end_gcode="G1 X11 Y10")
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000 F2400.000", "G1 Z0.800 F900.000"],
+            ["G0 X125.000 Y190.500 F6000.000", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300 F900.000", "G1 E2.00000 F1800.000", "G1 X11 Y10"]
+        ))
+
+    def test_no_speeds(self):
+        # Speeds of None leave the feedrate alone, so the original feedrate is always restored.
+        self.initialize_generator(
+            x_y_travel_speed=None, z_lift_speed=None, retraction_speed=None, deretraction_speed=None
+        )
+        plan = self.create_plan(
+            self.create_position(is_extruder_relative=False),
+            self.create_position(is_extruder_relative=False, e=11.0),
+            end_gcode="G1 X11 Y10 E1"
+        )
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E8.00000", "G1 Z0.800"],
+            ["G0 X125.000 Y190.500", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300", "G1 E10.00000", "G1 X11.000 Y10.000 E1.00000 F1800.000"]
+        ))
+        plan = self.create_plan(self.create_position(is_relative=True), self.create_position(is_relative=True))
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000", "G1 Z0.500"],
+            ["G0 X115.000 Y180.500", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X-115.000 Y-180.500"],
+            ["G1 Z-0.500", "G1 E2.00000", "G1 F1800.000"]
+        ))
+        # Nothing is restored if the original feedrate is unknown.
+        plan = self.create_plan(self.create_position(f=None), self.create_position(f=None))
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000", "G1 Z0.800"],
+            ["G0 X125.000 Y190.500", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300", "G1 E2.00000"]
+        ))
+
+    def test_no_travel_speed(self):
+        self.initialize_generator(x_y_travel_speed=None)
+        plan = self.create_plan(self.create_position(), self.create_position(), end_gcode="G1 X11 Y10")
+        self.assert_gcode(plan, (
+            [],
+            ["G1 E-2.00000 F2400.000", "G1 Z0.800 F900.000"],
+            ["G0 X125.000 Y190.500", "@OCTOLAPSE TAKE-SNAPSHOT"],
+            ["G0 X10.000 Y10.000"],
+            ["G1 Z0.300 F900.000", "G1 E2.00000 F1800.000", "G1 X11 Y10"]
+        ))
+
+
+if __name__ == '__main__':
+    suite = unittest.TestLoader().loadTestsFromTestCase(TestNativeSnapshotGcode)
+    unittest.TextTestRunner(verbosity=3).run(suite)
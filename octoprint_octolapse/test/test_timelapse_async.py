@@ -0,0 +1,199 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2020  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+
+import threading
+import unittest
+from mock import Mock, MagicMock
+
+from octoprint_octolapse.timelapse import Timelapse, TimelapseState
+from octoprint_octolapse.trigger import Triggers, TimerTrigger
+
+
+class FakeAsyncTracker(object):
+    # Stands in for GcodePositionProcessor.AsyncTracker, so that each test decides when its trigger fires.
+    def __init__(self):
+        self.pushed = []
+        self.is_trigger_pending = False
+        self.is_queue_full = False
+        self.resume_count = 0
+        self.trigger_state = ("trigger state",)
+        self.trigger_state_count = 0
+        self.is_stopped = False
+
+    def Push(self, gcode):
+        if self.is_queue_full and self.is_trigger_pending:
+            return False
+        self.pushed.append(gcode)
+        return True
+
+    def IsTriggerPending(self):
+        is_trigger_pending = self.is_trigger_pending
+        if self.is_queue_full:
+            # The trigger fires after it is checked, while the queue is full
+            self.is_trigger_pending = True
+        return is_trigger_pending
+
+    def GetTriggerState(self):
+        self.trigger_state_count += 1
+        return self.trigger_state
+
+    def Resume(self):
+        self.is_trigger_pending = False
+        self.resume_count += 1
+
+    def Stop(self):
+        self.is_stopped = True
+
+
+def file_tags(line):
+    return {"source:file", "filepos:{0}".format(line * 10), "fileline:{0}".format(line)}
+
+
+class TestAsyncTimelapse(unittest.TestCase):
+    def setUp(self):
+        self.tracker = FakeAsyncTracker()
+        self.timelapse = self.create_timelapse(self.tracker)
+
+    def tearDown(self):
+        del self.timelapse
+        del self.tracker
+
+    @staticmethod
+    def create_timelapse(tracker):
+        # Only the members used by process_async_realtime_gcode are created.
+        t = Timelapse.__new__(Timelapse)
+        t._state = TimelapseState.WaitingForTrigger
+        t._async_tracker = tracker
+        t._async_tracker_lock = threading.RLock()
+        t._async_lines = []
+        t._async_tags = None
+        t._async_previous_cmd = None
+        t._plan_pipeline = None
+        t._position = MagicMock()
+        t._position.command_requires_location_detection.side_effect = lambda cmd: cmd == "G28"
+        t._octoprint_printer = MagicMock()
+        t._octoprint_printer.is_printing.return_value = True
+        t._triggers = MagicMock()
+        t._position_signal = MagicMock()
+        t._stabilization_signal = MagicMock()
+        t.process_realtime_gcode = Mock(return_value=(None,))
+        return t
+
+    def test_lines_are_batched_while_waiting(self):
+        """Lines are pushed to the tracker and queued for the position until a trigger fires."""
+        t = self.timelapse
+        self.assertIsNone(t.process_async_realtime_gcode("G1 X10", "G1", file_tags(1)))
+        self.assertIsNone(t.process_async_realtime_gcode("M117 Hello", "M117", {"source:api"}))
+        self.assertEqual(["G1 X10", "M117 Hello"], self.tracker.pushed)
+        self.assertEqual(["G1 X10", "M117 Hello"], t._async_lines)
+        t._position.update_batch.assert_not_called()
+        t.process_realtime_gcode.assert_not_called()
+
+    def test_lines_from_outside_the_file_are_tracked(self):
+        """Lines sent from the terminal or a script change the tracked position too, but snapshot gcode doesn't."""
+        t = self.timelapse
+        t.process_async_realtime_gcode("G1 X10", "G1", file_tags(1))
+        t.process_async_realtime_gcode("G92 E0", "G92", {"source:api", "api:printer.command"})
+        t.process_async_realtime_gcode("M83", "M83", {"source:script"})
+        t.process_async_realtime_gcode("G1 X50 Y50", "G1", {"plugin:octolapse", "snapshot_gcode", "snapshot-gcode"})
+        t.process_async_realtime_gcode("G1 X11 E1", "G1", file_tags(2))
+        self.assertEqual(["G1 X10", "G92 E0", "M83", "G1 X11 E1"], self.tracker.pushed)
+        self.assertEqual(["G1 X10", "G92 E0", "M83", "G1 X50 Y50", "G1 X11 E1"], t._async_lines)
+
+    def test_pending_trigger_uses_synchronous_path(self):
+        """The line after a trigger fires is processed synchronously with the tracker's trigger state."""
+        t = self.timelapse
+        t.process_async_realtime_gcode("G1 X10", "G1", file_tags(1))
+        self.tracker.is_trigger_pending = True
+        self.assertEqual((None,), t.process_async_realtime_gcode("G1 X11", "G1", file_tags(2)))
+        self.assertEqual(1, self.tracker.resume_count)
+        self.assertEqual(["G1 X10", "G1 X11"], self.tracker.pushed)
+        t._position.update_batch.assert_called_once_with(["G1 X10"], file_line_number=1)
+        t.process_realtime_gcode.assert_called_once_with("G1 X11", file_tags(2), self.tracker.trigger_state)
+        self.assertEqual([], t._async_lines)
+
+    def test_pending_trigger_is_dropped_while_not_waiting(self):
+        """A trigger that fires while a snapshot can't be taken is resumed without being used."""
+        t = self.timelapse
+        t._state = TimelapseState.TakingSnapshot
+        self.tracker.is_trigger_pending = True
+        t.process_async_realtime_gcode("G1 X10", "G1", file_tags(1))
+        self.assertEqual(1, self.tracker.resume_count)
+        self.assertEqual(0, self.tracker.trigger_state_count)
+        t.process_realtime_gcode.assert_called_once_with("G1 X10", file_tags(1), None)
+
+    def test_full_queue_with_pending_trigger(self):
+        """A line that can't be pushed because the trigger fired is pushed again after resuming."""
+        t = self.timelapse
+        self.tracker.is_queue_full = True
+        self.assertEqual((None,), t.process_async_realtime_gcode("G1 X10", "G1", file_tags(1)))
+        self.assertEqual(1, self.tracker.resume_count)
+        self.assertEqual(["G1 X10"], self.tracker.pushed)
+        t.process_realtime_gcode.assert_called_once_with("G1 X10", file_tags(1), self.tracker.trigger_state)
+
+    def test_location_detection_uses_synchronous_path(self):
+        """The line after a command that may need the position to be detected is processed synchronously."""
+        t = self.timelapse
+        self.assertIsNone(t.process_async_realtime_gcode("G28", "G28", file_tags(1)))
+        t.process_realtime_gcode.assert_not_called()
+        t.process_async_realtime_gcode("M400", "M400", file_tags(2))
+        t._position.update_batch.assert_called_once_with(["G28"], file_line_number=1)
+        t.process_realtime_gcode.assert_called_once_with("M400", file_tags(2), None)
+
+    def test_full_batch_is_applied(self):
+        """Queued lines are applied to the position once the batch is full."""
+        t = self.timelapse
+        for line in range(1, Timelapse.ASYNC_BATCH_SIZE + 1):
+            t.process_async_realtime_gcode("G1 X{0}".format(line), "G1", file_tags(line))
+        self.assertEqual(1, t._position.update_batch.call_count)
+        self.assertEqual(Timelapse.ASYNC_BATCH_SIZE, len(t._position.update_batch.call_args[0][0]))
+        self.assertEqual([], t._async_lines)
+
+    def test_reset_stops_tracker(self):
+        """Resetting the timelapse stops the tracker and discards the queued lines."""
+        t = self.timelapse
+        t.process_async_realtime_gcode("G1 X10", "G1", file_tags(1))
+        t._reset()
+        self.assertTrue(self.tracker.is_stopped)
+        self.assertIsNone(t._async_tracker)
+        self.assertEqual([], t._async_lines)
+
+    def test_async_trigger_args(self):
+        """Only a single native trigger that isn't a timer can be evaluated by the tracker."""
+        triggers = Triggers.__new__(Triggers)
+        trigger = Mock(is_native=True)
+        trigger.get_native_trigger_args.return_value = {"type": "layer"}
+        triggers._triggers = [trigger]
+        self.assertEqual({"type": "layer"}, triggers.get_async_trigger_args())
+        trigger.is_native = False
+        self.assertIsNone(triggers.get_async_trigger_args())
+        timer_trigger = Mock(spec=TimerTrigger, is_native=True)
+        triggers._triggers = [timer_trigger]
+        self.assertIsNone(triggers.get_async_trigger_args())
+        triggers._triggers = [Mock(is_native=True), Mock(is_native=True)]
+        self.assertIsNone(triggers.get_async_trigger_args())
+
+
+if __name__ == '__main__':
+    suite = unittest.TestLoader().loadTestsFromTestCase(TestAsyncTimelapse)
+    unittest.TextTestRunner(verbosity=3).run(suite)
@@ -0,0 +1,257 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2020  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+
+import threading
+import unittest
+from mock import Mock, MagicMock, patch
+
+import octoprint_octolapse.timelapse as timelapse
+from octoprint_octolapse.gcode_processor import GcodeProcessor
+import octoprint_octolapse.stabilization_preprocessing as preprocessing
+from octoprint_octolapse.stabilization_preprocessing import StabilizationPreprocessingThread
+from octoprint_octolapse.settings import TriggerProfile
+from octoprint_octolapse.stabilization_gcode import SnapshotPlan
+from octoprint_octolapse.timelapse import Timelapse, TimelapseState
+
+
+class FakePlanPipeline(object):
+    # Stands in for GcodePositionProcessor.PlanPipeline, so that each test decides how far planning has gone.
+    def __init__(self):
+        self.planned_gcode_number = 0
+        self.plans = []
+        self.taken_count = 0
+        self.is_complete = False
+        self.is_cancelled = False
+
+    def plan_through(self, gcode_number, plans=None):
+        self.plans.extend(plans or [])
+        self.planned_gcode_number = gcode_number
+
+    def GetPlans(self):
+        plans = self.plans[self.taken_count:]
+        self.taken_count = len(self.plans)
+        return plans
+
+    def IsComplete(self):
+        return self.is_complete
+
+    def Join(self):
+        return [], 0.0, 0, 0, 0, [], [], {}
+
+    def Cancel(self):
+        self.is_cancelled = True
+
+
+class FakePlanCursor(object):
+    # Follows the same rules as the native PlanCursor, but reads the queue state from a FakePlanPipeline.
+    def __init__(self, pipeline):
+        self.pipeline = pipeline
+        self.plans = []
+        self.index = 0
+
+    def AddPlans(self, file_gcode_numbers):
+        self.plans.extend(file_gcode_numbers)
+
+    def _get_queue_status(self, gcode_number):
+        if len(self.pipeline.plans) > len(self.plans):
+            return GcodeProcessor.PLAN_CURSOR_PLANS_PENDING
+        if not self.pipeline.is_complete and gcode_number >= self.pipeline.planned_gcode_number:
+            return GcodeProcessor.PLAN_CURSOR_NOT_PLANNED
+        return GcodeProcessor.PLAN_CURSOR_NONE
+
+    def Update(self, gcode_number):
+        if self.index >= len(self.plans):
+            return self._get_queue_status(gcode_number)
+        if self.plans[self.index] > gcode_number:
+            return GcodeProcessor.PLAN_CURSOR_NONE
+        status = GcodeProcessor.PLAN_CURSOR_NONE
+        while self.index < len(self.plans) and self.plans[self.index] < gcode_number:
+            self.index += 1
+            status = GcodeProcessor.PLAN_CURSOR_SKIPPED
+        if self.index < len(self.plans):
+            return GcodeProcessor.PLAN_CURSOR_TRIGGER_LINE
+        queue_status = self._get_queue_status(gcode_number)
+        return status if queue_status == GcodeProcessor.PLAN_CURSOR_NONE else queue_status
+
+    def Advance(self):
+        if self.index < len(self.plans):
+            self.index += 1
+
+    def GetIndex(self):
+        return self.index
+
+
+def create_plan(file_gcode_number, layer):
+    return Mock(file_gcode_number=file_gcode_number, initial_position=Mock(layer=layer))
+
+
+def file_tags(file_line):
+    return {"source:file", "fileline:{0}".format(file_line)}
+
+
+class TestPipelinedTimelapse(unittest.TestCase):
+    def setUp(self):
+        # The pipeline returns the plans themselves, so they don't need to be converted.
+        self.create_plans_patcher = patch.object(
+            SnapshotPlan, "create_from_cpp_snapshot_plans", side_effect=lambda cpp_plans, first_plan_number: cpp_plans
+        )
+        self.create_plans_patcher.start()
+        self.thread_patcher = patch.object(timelapse.threading, "Thread")
+        self.thread = self.thread_patcher.start()
+        self.pipeline = FakePlanPipeline()
+        self.timelapse = self.create_timelapse(self.pipeline)
+
+    def tearDown(self):
+        self.thread_patcher.stop()
+        self.create_plans_patcher.stop()
+
+    @staticmethod
+    def create_timelapse(pipeline):
+        # Only the members used while following a plan pipeline are created.
+        t = Timelapse.__new__(Timelapse)
+        t._state = TimelapseState.WaitingForTrigger
+        t._plan_pipeline = pipeline
+        t._plan_cursor = FakePlanCursor(pipeline)
+        t.snapshot_plans = []
+        t._snapshot_layers = set()
+        t._is_live_snapshot = False
+        t._async_tracker = None
+        t._async_tracker_lock = threading.RLock()
+        t._async_lines = []
+        t._async_tags = None
+        t._async_previous_cmd = None
+        t.current_snapshot_plan = None
+        t.current_snapshot_plan_index = 0
+        t._position = MagicMock()
+        t._position.previous_pos.parsed_command = None
+        t._position.current_pos.layer = 1
+        t._octoprint_printer = MagicMock()
+        t._octoprint_printer.is_printing.return_value = True
+        t._octoprint_printer.set_job_on_hold.return_value = True
+        t._triggers = MagicMock()
+        t._gcode = MagicMock()
+        t._stabilization_signal = MagicMock()
+        t.check_for_non_metric_errors = Mock(return_value=False)
+        t.get_first_triggering = Mock(return_value=False)
+        t._trigger_snapshot_plan = Mock(return_value=None)
+        return t
+
+    def test_caught_up_print_triggers_in_real_time(self):
+        """A line the pipeline hasn't planned yet is triggered in real time."""
+        t = self.timelapse
+        self.pipeline.plan_through(100)
+        t.get_first_triggering.return_value = Mock()
+
+        # Planned lines don't use the real time triggers
+        self.assertIsNone(t.process_pre_calculated_gcode("G1 X10", file_tags(99)))
+        t._triggers.update.assert_not_called()
+
+        # The print has caught up with the pipeline
+        t._position.current_pos.layer = 2
+        self.assertEqual((None,), t.process_pre_calculated_gcode("G1 X11", file_tags(100)))
+        t._triggers.update.assert_called_once_with(t._position)
+        self.assertEqual(TimelapseState.TakingSnapshot, t._state)
+        self.assertTrue(t._is_live_snapshot)
+        self.assertEqual({2}, t._snapshot_layers)
+        self.thread.assert_called_once_with(target=t.acquire_snapshot_precalculated, args=[t._position.current_pos.parsed_command])
+        t._trigger_snapshot_plan.assert_not_called()
+
+    def test_live_layer_plan_is_skipped(self):
+        """A plan for a layer that was already triggered in real time is skipped when it arrives."""
+        t = self.timelapse
+        self.pipeline.plan_through(10)
+        t.get_first_triggering.return_value = Mock()
+        t._position.current_pos.layer = 3
+        self.assertEqual((None,), t.process_pre_calculated_gcode("G1 X10", file_tags(10)))
+        self.assertEqual({3}, t._snapshot_layers)
+
+        # The plans for layers 3 and 4 arrive after the snapshot.
+        t._state = TimelapseState.WaitingForTrigger
+        t._is_live_snapshot = False
+        layer_3_plan = create_plan(20, 3)
+        layer_4_plan = create_plan(30, 4)
+        self.pipeline.plan_through(50, [layer_3_plan, layer_4_plan])
+
+        self.assertIsNone(t.process_pre_calculated_gcode("G1 X20", file_tags(20)))
+        t._trigger_snapshot_plan.assert_not_called()
+        self.assertEqual(2, len(t.snapshot_plans))
+        self.assertIs(layer_4_plan, t.current_snapshot_plan)
+
+        t.process_pre_calculated_gcode("G1 X30", file_tags(30))
+        t._trigger_snapshot_plan.assert_called_once_with(
+            "G1 X30", 30, GcodeProcessor.PLAN_CURSOR_TRIGGER_LINE
+        )
+
+        # The layer that was triggered live is never triggered again in real time, either.
+        t._trigger_snapshot_plan.reset_mock()
+        t._triggers.reset_mock()
+        self.thread.reset_mock()
+        t._position.current_pos.layer = 3
+        self.assertIsNone(t.process_pre_calculated_gcode("G1 X60", file_tags(60)))
+        self.thread.assert_not_called()
+        self.assertEqual(TimelapseState.WaitingForTrigger, t._state)
+
+    def test_plans_followed_after_pipeline_completes(self):
+        """Once the pipeline completes it is released, and its plans are followed like any precalculated plans."""
+        t = self.timelapse
+        plan = create_plan(20, 2)
+        self.pipeline.plan_through(20, [plan])
+        self.pipeline.is_complete = True
+
+        self.assertIsNone(t.process_pre_calculated_gcode("G1 X1", file_tags(1)))
+        self.assertIsNone(t._plan_pipeline)
+        self.assertIs(plan, t.current_snapshot_plan)
+
+    def test_reset_cancels_pipeline(self):
+        """Resetting the timelapse cancels the pipeline and stops following it."""
+        t = self.timelapse
+        t._position_signal = MagicMock()
+        self.pipeline.plan_through(10)
+        t._reset()
+        self.assertTrue(self.pipeline.is_cancelled)
+        self.assertIsNone(t._plan_pipeline)
+        self.assertEqual(TimelapseState.Idle, t._state)
+
+        # Gcode is no longer sent to the pipeline, or triggered in real time.
+        self.assertIsNone(t.process_pre_calculated_gcode("G1 X10", file_tags(20)))
+        t._triggers.update.assert_not_called()
+        self.assertEqual([], t.snapshot_plans)
+
+    def test_plan_cursor_rejects_invalid_pipeline(self):
+        """A plan pipeline that isn't a PlanPipeline raises a TypeError."""
+        self.assertRaises(TypeError, GcodeProcessor.create_plan_cursor, [], self.pipeline)
+
+    def test_pipeline_needs_native_threads(self):
+        """The plans are created before printing when the extension was built without native threads."""
+        trigger_profile = Mock(
+            trigger_type=TriggerProfile.TRIGGER_TYPE_SMART, trigger_subtype=TriggerProfile.LAYER_TRIGGER_TYPE
+        )
+        with patch.object(preprocessing.GcodePositionProcessor, "HAS_THREADS", 1):
+            self.assertTrue(StabilizationPreprocessingThread.is_pipeline_supported(trigger_profile))
+        with patch.object(preprocessing.GcodePositionProcessor, "HAS_THREADS", 0):
+            self.assertFalse(StabilizationPreprocessingThread.is_pipeline_supported(trigger_profile))
+
+
+if __name__ == '__main__':
+    suite = unittest.TestLoader().loadTestsFromTestCase(TestPipelinedTimelapse)
+    unittest.TextTestRunner(verbosity=3).run(suite)
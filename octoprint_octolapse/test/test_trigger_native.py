@@ -0,0 +1,180 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2020  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+
+import unittest
+
+from octoprint_octolapse.position import Position
+from octoprint_octolapse.settings import PrinterProfile, TriggerProfile, OtherSlicerExtruder
+from octoprint_octolapse.trigger import LayerTrigger, GcodeTrigger
+
+
+class FakeProfiles(object):
+    def __init__(self, printer, trigger):
+        self.printer = printer
+        self.trigger = trigger
+
+    def current_printer(self):
+        return self.printer
+
+    def current_trigger(self):
+        return self.trigger
+
+
+class FakeSettings(object):
+    def __init__(self, printer, trigger):
+        self.profiles = FakeProfiles(printer, trigger)
+
+
+class TestNativeTrigger(unittest.TestCase):
+    # The native triggers must produce the same states as the python triggers.  The gcode is from the fixtures in
+    # test_trigger_layer.py and test_trigger_gcode.py.
+    LAYER_CHANGE_GCODE = [
+        "g0 x0 y0 z.2 e1", "g28", "g0 x0 y0 z.2 e1", "g0 x1 y1 z.2 e1", "g0 x1 y1 z.4", "g0 x2 y2 z.4",
+        "g0 x2 y2 z.2", "g0 x4 y4 z.2", "g0 x2 y2 z.2 e1", "g0 x2 y2 z.4", "g0 x2 y2 z.6", "g0 x2 y2 z.4 e1",
+        "g0 x2 y2 z.2 e1", "g0 x2 y2 z.4 e1", "g0 x2 y2 z.6 e1"
+    ]
+    HEIGHT_CHANGE_GCODE = LAYER_CHANGE_GCODE + ["g0 x2 y2 z0.74 e1", "m114", "g0 x2 y2 z0.7500 e1"]
+    ZHOP_GCODE = [
+        "g0 x0 y0 z.2 e1", "g28", "g0 x0 y0 z.2 e1", "g0 x0 y0 z.7 ", "g0 x0 y0 z.7 e1", "g0 x0 y0 z.7 ",
+        "g0 x0 y0 z1.1999", "g0 x0 y0 z1.3 e1", "g0 x0 y0 z.8", "g0 x0 y0 z1.3", "g0 x0 y0 z1.795",
+        "g0 x0 y0 z1.7951"
+    ]
+    PRINT_GCODE = [
+        "T0", "M104 S255", "M140 S100", "M190 S100", "M109 S255", "G21", "G90", "M83", "G28 W", "G80", "G92 E0.0",
+        "M203 E100", "M92 E140", "G92 E0.0", "M900 K200",
+        # layer 1
+        "G1 Z0.250 F7200.000", "G1 X50.0 E80.0  F1000.0", "G1 X160.0 E20.0 F1000.0", "G1 Z0.200 F7200.000",
+        "G1 X220.0 E13 F1000.0", "G1 X240.0 E0 F1000.0", "G1 E-4.00000 F3000.00000", "G1 Z0.700 F7200.000",
+        "G1 X117.061 Y98.921 F7200.000", "G1 Z0.200 F7200.000", "G1 E4.00000 F3000.00000", "M204 S1000", "G1 F1800",
+        "G1 X117.508 Y98.104 E0.02922", "G1 X117.947 Y97.636 E0.02011", "G1 X118.472 Y97.267 E0.02011",
+        "G1 X130.004 Y96.869 E0.32341", "G1 E-2.40000 F3000.00000", "G1 F5760", "G1 X119.824 Y97.629 E-0.50464",
+        "G1 X121.876 Y97.628 E-1.01536", "G1 E-0.08000 F3000.00000", "G1 Z0.700 F7200.000",
+        "G1 X120.587 Y100.587 F7200.000", "G1 Z0.200 F7200.000", "G1 E4.00000 F3000.00000", "G1 F1800",
+        "G1 X129.413 Y100.587 E0.27673", "G1 X129.413 Y109.413 E0.27673", "G1 X120.210 Y100.210 F7200.000",
+        # layer 2
+        "G1 E-4.00000 F3000.00000", "G1 Z0.900 F7200.000", "G1 X133.089 Y99.490 F7200.000", "G1 Z0.400 F7200.000",
+        "G1 E4.00000 F3000.00000", "G1 F3000", "G1 X133.128 Y110.149 E0.33418", "G1 X132.942 Y111.071 E0.02950",
+        "G1 X132.492 Y111.896 E0.02950",
+        # layer 3
+        "G1 Z2.600 F7200.000", "G1 X120.632 Y100.632 F7200.000", "M204 S800", "G1 F1200",
+        "G1 X129.368 Y100.632 E0.29570", "G1 X129.368 Y109.368 E0.29570", "G1 X120.225 Y100.225 F7200.000",
+        "G1 X129.775 Y100.225 E0.32326",
+        # layer 4
+        "G1 Z2.800 F7200.000", "G1 X120.632 Y109.368 F7200.000", "G1 X120.632 Y100.632 E0.29570",
+        "G1 X129.368 Y100.632 E0.29570", "G1 E-2.40000 F3000.00000", "G1 X120.225 Y109.775 F7200.000",
+        "G1 E2.40000 F3000.00000", "G1 X120.225 Y100.225 E0.32326", "G1 X129.775 Y100.225 E0.32326"
+    ]
+    GCODE_TRIGGER_GCODE = [
+        "NotThesnapshot_command", "snap", "M83", "G90", "G28", "snap", "G0 X0 Y0 Z0 E1 F0", "G0 X1 Y1 Z0.2 E1",
+        "snap", "G0 X2 Y2 Z0.2 E1", "G0 X3 Y3 Z0.2 E-1", "snap", "G0 X3 Y3 Z0.7", "G0 X4 Y4 Z0.7"
+    ]
+
+    @staticmethod
+    def create_printer_profile():
+        printer = PrinterProfile()
+        printer.slicer_type = "other"
+        extruder = OtherSlicerExtruder()
+        extruder.retract_length = 4.0
+        extruder.z_hop = 0.5
+        printer.slicers.other.extruders = [extruder]
+        printer.e_axis_default_mode = "relative"
+        printer.xyz_axes_default_mode = "absolute"
+        printer.auto_detect_position = False
+        printer.home_x = 0
+        printer.home_y = 0
+        printer.home_z = 0
+        return printer
+
+    @staticmethod
+    def create_trigger_profile(
+        trigger_subtype=TriggerProfile.LAYER_TRIGGER_TYPE, layer_trigger_height=0.0, require_zhop=False,
+        extruder_state_requirements_enabled=False
+    ):
+        trigger_profile = TriggerProfile()
+        trigger_profile.trigger_subtype = trigger_subtype
+        trigger_profile.layer_trigger_height = layer_trigger_height
+        trigger_profile.require_zhop = require_zhop
+        trigger_profile.extruder_state_requirements_enabled = extruder_state_requirements_enabled
+        return trigger_profile
+
+    def assert_same_states(self, trigger_type, trigger_profile, gcodes):
+        printer = self.create_printer_profile()
+        settings = FakeSettings(printer, trigger_profile)
+        overridable_printer_profile_settings = printer.get_overridable_profile_settings(
+            False, {
+                "volume": {
+                    "width": 250, "depth": 200, "height": 200, "formFactor": "rectangular", "origin": "lowerleft",
+                    "custom_box": False
+                }
+            }
+        )
+        position = Position(printer, trigger_profile, overridable_printer_profile_settings)
+        python_trigger = trigger_type(settings)
+        native_trigger = trigger_type(settings)
+        native_trigger.initialize_native()
+        trigger_count = 0
+        for gcode in gcodes:
+            position.update(gcode)
+            python_trigger.update(position)
+            native_trigger.update_native()
+            python_state = python_trigger.get_state(0)
+            native_state = native_trigger.get_state(0)
+            message = "The states differ after {0}.".format(gcode)
+            self.assertEqual(python_state.to_dict(python_trigger), native_state.to_dict(native_trigger), message)
+            self.assertEqual(python_trigger.trigger_count, native_trigger.trigger_count, message)
+            trigger_count = python_trigger.trigger_count
+        # Make sure the fixture exercised the trigger
+        self.assertGreater(trigger_count, 0)
+
+    def test_layer_change(self):
+        """The native layer trigger matches the python trigger on layer changes."""
+        self.assert_same_states(LayerTrigger, self.create_trigger_profile(), self.LAYER_CHANGE_GCODE)
+
+    def test_height_change(self):
+        """The native layer trigger matches the python trigger with a height increment."""
+        self.assert_same_states(
+            LayerTrigger, self.create_trigger_profile(layer_trigger_height=0.25), self.HEIGHT_CHANGE_GCODE
+        )
+
+    def test_zhop(self):
+        """The native layer trigger matches the python trigger when a zhop is required."""
+        self.assert_same_states(LayerTrigger, self.create_trigger_profile(require_zhop=True), self.ZHOP_GCODE)
+
+    def test_extruder_triggers(self):
+        """The native layer trigger matches the python trigger with the default extruder triggers."""
+        self.assert_same_states(
+            LayerTrigger, self.create_trigger_profile(extruder_state_requirements_enabled=True), self.PRINT_GCODE
+        )
+
+    def test_gcode_trigger(self):
+        """The native gcode trigger matches the python trigger."""
+        self.assert_same_states(
+            GcodeTrigger,
+            self.create_trigger_profile(trigger_subtype=TriggerProfile.GCODE_TRIGGER_TYPE),
+            self.GCODE_TRIGGER_GCODE
+        )
+
+
+if __name__ == '__main__':
+    suite = unittest.TestLoader().loadTestsFromTestCase(TestNativeTrigger)
+    unittest.TextTestRunner(verbosity=3).run(suite)
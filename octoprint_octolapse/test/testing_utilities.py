@@ -32,3 +32,41 @@ def get_printer_profile():
           "home_z": 0
     }
 
+
+
+def get_position_args(**overrides):
+    # The position args for GcodePositionProcessor, for a 200mm rectangular printer with relative extrusion.  A bounds
+    # override is set in the volume, and any other override replaces the position arg of the same name.
+    position_args = {
+        "volume": {
+            "bed_type": "rectangular", "min_x": 0.0, "max_x": 200.0, "min_y": 0.0, "max_y": 200.0, "min_z": 0.0,
+            "max_z": 200.0, "bounds": overrides.pop("bounds", None)
+        },
+        "location_detection_commands": [],
+        "xyz_axis_default_mode": "absolute",
+        "e_axis_default_mode": "relative",
+        "units_default": "millimeters",
+        "autodetect_position": True,
+        "home_position": {"home_x": 0.0, "home_y": 0.0, "home_z": 0.0},
+        "num_extruders": 1,
+        "shared_extruder": True,
+        "zero_based_extruder": True,
+        "default_extruder_index": 0,
+        "slicer_settings": {"extruders": [{"z_lift_height": 0.4, "retraction_length": 0.8}]},
+        "extruder_offsets": [],
+        "priming_height": 0.75,
+        "minimum_layer_height": 0.05,
+        "g90_influences_extruder": False,
+    }
+    position_args.update(overrides)
+    return position_args
+
+
+class SnapshotPositionGenerator(object):
+    # Stands in for the gcode_generator stabilization arg, and stabilizes every snapshot at the same point.
+    def __init__(self, x, y):
+        self.x = x
+        self.y = y
+
+    def get_snapshot_position(self, x, y):
+        return {"x": self.x, "y": self.y}
@@ -28,7 +28,7 @@ from six import iteritems, string_types
 from six.moves import queue
 import os
 import octoprint_octolapse.utility as utility
-from octoprint_octolapse.stabilization_gcode import SnapshotGcodeGenerator, SnapshotGcode
+from octoprint_octolapse.stabilization_gcode import SnapshotGcodeGenerator, SnapshotGcode, SnapshotPlan
 from octoprint_octolapse.gcode_commands import Commands, Response
 from octoprint_octolapse.gcode_processor import ParsedCommand
 from octoprint_octolapse.position import Position
@@ -53,6 +53,10 @@ class TimelapseStartException(Exception):
 
 
 class Timelapse(object):
+    # The most lines queued by process_async_realtime_gcode before they are applied to the synchronous position
+    ASYNC_BATCH_SIZE = 1000
+    # The most lines the AsyncTracker may fall behind, which limits how late a snapshot can be
+    ASYNC_TRACKER_QUEUE_SIZE = 64
 
     def __init__(
         self, get_current_octolapse_settings, octoprint_printer, data_folder, default_settings_folder,
@@ -131,6 +135,19 @@ class Timelapse(object):
         self.snapshot_plans = None  # type: [preprocessing.SnapshotPlan]
         self.current_snapshot_plan_index = 0
         self.current_snapshot_plan = None  # type: preprocessing.SnapshotPlan
+        self._plan_cursor = None
+        # creates the snapshot plans while printing, see start_timelapse
+        self._plan_pipeline = None
+        # the layers that have had a snapshot, so that a layer triggered live isn't also triggered by its plan
+        self._snapshot_layers = set()
+        self._is_live_snapshot = False
+        # tracks the real time position on its own thread when the async_position_tracking setting is enabled
+        self._async_tracker = None
+        self._async_tracker_lock = threading.RLock()
+        # lines that have not been applied to the synchronous position yet, see process_async_realtime_gcode
+        self._async_lines = []
+        self._async_tags = None
+        self._async_previous_cmd = None
         self.is_realtime = True
         self.was_started = False
         # snapshot thread queue
@@ -159,7 +176,7 @@ class Timelapse(object):
 
     def start_timelapse(
         self, settings, overridable_printer_profile_settings,
-        gcode_file_path, snapshot_plans=None
+        gcode_file_path, snapshot_plans=None, plan_pipeline=None
     ):
         # we must supply the settings first!  Else reset won't work properly.
         self._reset()
@@ -174,9 +191,20 @@ class Timelapse(object):
         self.snapshot_plans = snapshot_plans
         self.current_snapshot_plan = None
         self.current_snapshot_plan_index = 0
+        self._plan_cursor = None
+        # If there is a plan pipeline, the plans are added as it creates them.  Until it completes, any lines that it
+        # hasn't planned are triggered in real time.
+        self._plan_pipeline = plan_pipeline
+        self._snapshot_layers = set()
+        self._is_live_snapshot = False
+        if self._plan_pipeline is not None and self.snapshot_plans is None:
+            self.snapshot_plans = []
         # set the current snapshot plan if we have any
-        if self.snapshot_plans is not None and len(self.snapshot_plans) > 0:
-            self.current_snapshot_plan = self.snapshot_plans[self.current_snapshot_plan_index]
+        if self.snapshot_plans is not None:
+            # follow the plans natively, so that lines which don't trigger a plan are not parsed.
+            self._plan_cursor = GcodeProcessor.create_plan_cursor(self.snapshot_plans, self._plan_pipeline)
+            if len(self.snapshot_plans) > 0:
+                self.current_snapshot_plan = self.snapshot_plans[self.current_snapshot_plan_index]
         # if we have at least one snapshot plan, we must have preprocessed, so set is_realtime to false.
         self.is_realtime = self.snapshot_plans is None
         assert (isinstance(self._printer, PrinterProfile))
@@ -215,6 +243,22 @@ class Timelapse(object):
         self._test_mode_enabled = self._settings.main_settings.test_mode_enabled
         self._triggers = Triggers(self._settings)
         self._triggers.create()
+        if self.is_realtime and self._settings.main_settings.async_position_tracking:
+            trigger_args = self._triggers.get_async_trigger_args()
+            if not GcodeProcessor.HAS_THREADS:
+                logger.info(
+                    "The gcode processor was built without native threads, so the position will be tracked "
+                    "synchronously."
+                )
+            elif trigger_args is None:
+                logger.info(
+                    "The %s trigger can't be evaluated by the asynchronous position tracker, so the position will be "
+                    "tracked synchronously.", self._triggers.name
+                )
+            else:
+                self._async_tracker = self._position.create_async_tracker(
+                    trigger_args, Timelapse.ASYNC_TRACKER_QUEUE_SIZE
+                )
 
         # take a snapshot of the current settings for use in the Octolapse Tab
         self._current_profiles = self._settings.profiles.get_profiles_dict()
@@ -695,12 +739,21 @@ class Timelapse(object):
         ):
             logger.verbose("Queuing: %s", command_string)
 
-        if self.is_realtime:
+        if self.is_realtime and self._async_tracker is None:
             return_value = self.process_realtime_gcode(command_string, tags)
             parsed_command = self._position.current_pos.parsed_command
         else:
-            parsed_command = GcodeProcessor.parse(command_string)
-            return_value = self.process_pre_calculated_gcode(parsed_command, tags)
+            if self.is_realtime:
+                return_value = self.process_async_realtime_gcode(command_string, gcode, tags)
+            else:
+                return_value = self.process_pre_calculated_gcode(command_string, tags)
+            # Only parse the command if it might be altered below.  A G92 with a dummy parameter contains an O.
+            parsed_command = None
+            if (
+                (self._test_mode_enabled and self._state >= TimelapseState.WaitingForTrigger) or
+                "O" in command_string or "o" in command_string
+            ):
+                parsed_command = GcodeProcessor.parse(command_string)
 
         # notify any callbacks
         self._send_state_changed_message()
@@ -733,63 +786,202 @@ class Timelapse(object):
         return None
 
     def set_next_snapshot_plan(self):
+        self._plan_cursor.Advance()
+        self._update_current_snapshot_plan()
+
+    def _update_current_snapshot_plan(self):
+        # get the current plan from the plan cursor
         self.current_snapshot_plan = None
-        self.current_snapshot_plan_index += 1
+        self.current_snapshot_plan_index = self._plan_cursor.GetIndex()
         if len(self.snapshot_plans) > self.current_snapshot_plan_index:
             self.current_snapshot_plan = self.snapshot_plans[self.current_snapshot_plan_index]
 
-    def process_pre_calculated_gcode(self, parsed_command, tags):
+    def process_pre_calculated_gcode(self, command_string, tags):
+        if self._plan_pipeline is not None:
+            return self.process_pipelined_gcode(command_string, tags)
         if not {'plugin:octolapse', 'snapshot_gcode'}.issubset(tags) and 'source:file' in tags:
             if self.current_snapshot_plan is None:
                 return None
             current_file_line = self.get_current_file_line(tags)
-            # skip plans if we need to in case any were missed.
-            if self.current_snapshot_plan.file_gcode_number < current_file_line:
-                while (
-                    self.current_snapshot_plan.file_gcode_number < current_file_line and
-                    len(self.snapshot_plans) > self.current_snapshot_plan_index
-                ):
-                    self.set_next_snapshot_plan()
+            if current_file_line is None:
+                return None
+            # The cursor skips plans in case any were missed.  Most lines don't change the current plan.
+            cursor_status = self._plan_cursor.Update(current_file_line)
+            if cursor_status == GcodeProcessor.PLAN_CURSOR_NONE:
+                return None
+            self._update_current_snapshot_plan()
+            return self._trigger_snapshot_plan(command_string, current_file_line, cursor_status)
+        return None
+
+    def process_pipelined_gcode(self, command_string, tags):
+        # The plan pipeline is still creating the snapshot plans.  Every line updates the position, so that the
+        # lines it hasn't planned yet can be triggered in real time.
+        current_file_line = None
+        if not {'plugin:octolapse', 'snapshot_gcode'}.issubset(tags) and 'source:file' in tags:
+            current_file_line = self.get_current_file_line(tags)
+        if current_file_line is None:
+            self._position.update(command_string)
+            return None
+
+        cursor_status = self._plan_cursor.Update(current_file_line)
+        if cursor_status == GcodeProcessor.PLAN_CURSOR_PLANS_PENDING:
+            self._add_pipelined_snapshot_plans()
+            cursor_status = self._plan_cursor.Update(current_file_line)
+        if cursor_status == GcodeProcessor.PLAN_CURSOR_NOT_PLANNED:
+            # The print has caught up with the pipeline, so trigger this line in real time.
+            return self.process_realtime_gcode(command_string, tags)
+
+        self._position.update(command_string, file_line_number=current_file_line)
+        if self._plan_pipeline.IsComplete():
+            self._finish_plan_pipeline()
+        if cursor_status == GcodeProcessor.PLAN_CURSOR_NONE:
+            return None
+        self._update_current_snapshot_plan()
+        layer = self._get_snapshot_plan_layer(self.current_snapshot_plan)
+        if (
+            cursor_status == GcodeProcessor.PLAN_CURSOR_TRIGGER_LINE and
+            layer is not None and
+            layer in self._snapshot_layers
+        ):
+            # This layer was triggered in real time before its plan was created.
+            self.set_next_snapshot_plan()
+            return None
+        return self._trigger_snapshot_plan(command_string, current_file_line, cursor_status)
+
+    def _trigger_snapshot_plan(self, command_string, current_file_line, cursor_status):
+        if (
+            self._state == TimelapseState.WaitingForTrigger
+            and self._octoprint_printer.is_printing()
+            and cursor_status == GcodeProcessor.PLAN_CURSOR_TRIGGER_LINE
+        ):
+            # time to take a snapshot!
+            parsed_command = GcodeProcessor.parse(command_string)
+            if self.current_snapshot_plan.triggering_command.gcode != parsed_command.gcode:
+                logger.error(
+                    "The snapshot plan position (gcode number: %s, gcode:%s, line number: %s) does not match the actual position (gcode number: %s, gcode: %s)!  "
+                    "Aborting Snapshot, moving to next plan.",
+                    self.current_snapshot_plan.file_gcode_number,
+                    self.current_snapshot_plan.triggering_command.gcode,
+                    self.current_snapshot_plan.file_line_number,
+                    current_file_line,
+                    parsed_command.gcode
+                )
+                self.set_next_snapshot_plan()
+                return None
 
+            if self._octoprint_printer.set_job_on_hold(True):
+                logger.debug("Setting job-on-hold lock.")
+                # this was set to 'False' earlier.  Why?
+                self.job_on_hold = True
+                # We are triggering, take a snapshot
+                self._state = TimelapseState.TakingSnapshot
+                if self._plan_pipeline is not None:
+                    self._snapshot_layers.add(self._get_snapshot_plan_layer(self.current_snapshot_plan))
+
+                # take the snapshot on a new thread, making sure to set a signal so we know when it is finished
+                if not self._stabilization_signal.is_set():
+                    self._stabilization_signal.clear()
+                thread = threading.Thread(
+                    target=self.acquire_snapshot_precalculated, args=[parsed_command]
+                )
+                thread.daemon = True
+                thread.start()
+                # suppress the current command, we'll send it later
+                return None,
+        return None
+
+    @staticmethod
+    def _get_snapshot_plan_layer(snapshot_plan):
+        if snapshot_plan is None or snapshot_plan.initial_position is None:
+            return None
+        return snapshot_plan.initial_position.layer
+
+    def _add_pipelined_snapshot_plans(self):
+        cpp_snapshot_plans = self._plan_pipeline.GetPlans()
+        if not cpp_snapshot_plans:
+            return
+        snapshot_plans = SnapshotPlan.create_from_cpp_snapshot_plans(
+            cpp_snapshot_plans, len(self.snapshot_plans) + 1
+        )
+        self.snapshot_plans.extend(snapshot_plans)
+        self._plan_cursor.AddPlans([plan.file_gcode_number for plan in snapshot_plans])
+
+    def _finish_plan_pipeline(self):
+        # The pipeline has finished, so add any remaining plans and follow them like any preprocessed timelapse.
+        self._add_pipelined_snapshot_plans()
+        results = self._plan_pipeline.Join()
+        self._plan_pipeline = None
+        self._update_current_snapshot_plan()
+        logger.info(
+            "The plan pipeline created %s snapshot plans in %s seconds, %s snapshots were missed.",
+            len(self.snapshot_plans), results[1], results[4]
+        )
+        if results[6]:
+            logger.error("The plan pipeline reported processing errors: %s", results[6])
+
+    def process_async_realtime_gcode(self, command_string, cmd, tags):
+        # The AsyncTracker follows the file on its own thread and updates its trigger.  While waiting for a trigger,
+        # lines are only queued for it, and for a batched update of the synchronous position.  The synchronous path
+        # takes over for the first line after the tracker reports that its trigger fired, so that the snapshot is taken
+        # before that line is sent.  It also handles any line that may need the position to be acquired, and every line while
+        # the timelapse isn't waiting for a trigger.  cmd is the command OctoPrint parsed from the line, if any.
+        with self._async_tracker_lock:
+            if self._async_tracker is None:
+                return self.process_realtime_gcode(command_string, tags)
+            previous_cmd = self._async_previous_cmd
+            self._async_previous_cmd = cmd
+            can_trigger = (
+                self._state == TimelapseState.WaitingForTrigger and
+                self._octoprint_printer.is_printing()
+            )
+            trigger_state = None
+            while True:
+                if self._async_tracker.IsTriggerPending():
+                    if can_trigger and trigger_state is None:
+                        # The tracker is waiting on the line that triggered, which has already been sent.
+                        trigger_state = self._async_tracker.GetTriggerState()
+                    # Triggers that fire while a snapshot can't be taken are ignored, like the synchronous triggers.
+                    self._async_tracker.Resume()
+                # Every line changes the position the same way it does for the synchronous position, except for
+                # Octolapse's own snapshot gcode, which returns to where the print was.  Push fails if the queue is
+                # full and the trigger fired after it was checked.
+                if (
+                    {'plugin:octolapse', 'snapshot_gcode'}.issubset(tags) or
+                    self._async_tracker.Push(command_string)
+                ):
+                    break
             if (
-                self._state == TimelapseState.WaitingForTrigger
-                and self._octoprint_printer.is_printing()
-                and self.current_snapshot_plan.file_gcode_number == current_file_line
+                can_trigger and
+                trigger_state is None and
+                not (previous_cmd is not None and self._position.command_requires_location_detection(previous_cmd))
             ):
-                # time to take a snapshot!
-                if self.current_snapshot_plan.triggering_command.gcode != parsed_command.gcode:
-                    logger.error(
-                        "The snapshot plan position (gcode number: %s, gcode:%s, line number: %s) does not match the actual position (gcode number: %s, gcode: %s)!  "
-                        "Aborting Snapshot, moving to next plan.",
-                        self.current_snapshot_plan.file_gcode_number,
-                        self.current_snapshot_plan.triggering_command.gcode,
-                        self.current_snapshot_plan.file_line_number,
-                        current_file_line,
-                        parsed_command.gcode
-                    )
-                    self.set_next_snapshot_plan()
-                    return None
+                self._async_lines.append(command_string)
+                self._async_tags = tags
+                if len(self._async_lines) >= Timelapse.ASYNC_BATCH_SIZE:
+                    self._flush_async_lines()
+                return None
+            self._flush_async_lines()
+            return self.process_realtime_gcode(command_string, tags, trigger_state)
 
-                if self._octoprint_printer.set_job_on_hold(True):
-                    logger.debug("Setting job-on-hold lock.")
-                    # this was set to 'False' earlier.  Why?
-                    self.job_on_hold = True
-                    # We are triggering, take a snapshot
-                    self._state = TimelapseState.TakingSnapshot
-
-                    # take the snapshot on a new thread, making sure to set a signal so we know when it is finished
-                    if not self._stabilization_signal.is_set():
-                        self._stabilization_signal.clear()
-                    thread = threading.Thread(
-                        target=self.acquire_snapshot_precalculated, args=[parsed_command]
-                    )
-                    thread.daemon = True
-                    thread.start()
-                    # suppress the current command, we'll send it later
-                    return None,
-        return None
+    def _flush_async_lines(self):
+        # Applies the lines queued by process_async_realtime_gcode to the synchronous position.
+        with self._async_tracker_lock:
+            if len(self._async_lines) == 0:
+                return
+            lines = self._async_lines
+            self._async_lines = []
+            self._position.update_batch(lines, file_line_number=self.get_current_file_line(self._async_tags))
+
+    def _update_from_async_tracker(self):
+        # Brings the synchronous position and the trigger state up to date, so that they can be displayed.
+        with self._async_tracker_lock:
+            if self._async_tracker is None:
+                return
+            self._flush_async_lines()
+            self._triggers.update(self._position, native_state=self._async_tracker.GetTriggerState())
 
-    def process_realtime_gcode(self, gcode, tags):
+    def process_realtime_gcode(self, gcode, tags, trigger_state=None):
+        # trigger_state is the state of the AsyncTracker's trigger when it fired, if there is a tracker.
         # a flag indicating that we should suppress the command (prevent it from being sent to the printer)
         suppress_command = False
 
@@ -831,10 +1023,25 @@ class Timelapse(object):
                     elif (self._state == TimelapseState.WaitingForTrigger
                           and self._octoprint_printer.is_printing()):
                         # update the triggers with the current position
-                        self._triggers.update(self._position)
-
-                        # see if at least one trigger is triggering
-                        _first_triggering = self.get_first_triggering()
+                        if self._async_tracker is None:
+                            self._triggers.update(self._position)
+                            # see if at least one trigger is triggering
+                            _first_triggering = self.get_first_triggering()
+                        elif trigger_state is not None:
+                            self._triggers.update(self._position, native_state=trigger_state)
+                            _first_triggering = self.get_first_triggering()
+                        else:
+                            # Only the tracker's trigger is up to date
+                            _first_triggering = False
+
+                        # Layers that were triggered by their plan while the plan pipeline was running aren't
+                        # triggered again.
+                        if (
+                            _first_triggering and
+                            self._plan_pipeline is not None and
+                            self._position.current_pos.layer in self._snapshot_layers
+                        ):
+                            _first_triggering = False
 
                         if _first_triggering:
                             # get the job lock
@@ -849,6 +1056,9 @@ class Timelapse(object):
                                 # create the snapshot plan
                                 self.current_snapshot_plan = self._gcode.create_snapshot_plan(
                                     self._position, _first_triggering)
+                                self._is_live_snapshot = True
+                                if self._plan_pipeline is not None:
+                                    self._snapshot_layers.add(self._position.current_pos.layer)
 
                                 # take the snapshot on a new thread, making sure to set a signal so we know when it
                                 # is finished
@@ -1121,7 +1331,12 @@ class Timelapse(object):
 
             # set the next snapshot plan
             if not self.is_realtime:
-                self.set_next_snapshot_plan()
+                if self._is_live_snapshot:
+                    # Snapshots triggered in real time while the plan pipeline is running don't come from the cursor.
+                    self._update_current_snapshot_plan()
+                else:
+                    self.set_next_snapshot_plan()
+            self._is_live_snapshot = False
             self._octoprint_printer.set_job_on_hold(False)
             logger.debug("Releasing job-on-hold lock.")
             self.job_on_hold = False
@@ -1276,6 +1491,8 @@ class Timelapse(object):
                     self._state_changed_callback(change_dict)
 
                 if self.is_realtime:
+                    if self._async_tracker is not None:
+                        self._update_from_async_tracker()
                     send_real_time_change_message()
                 else:
                     send_pre_calculated_change_message()
@@ -1328,6 +1545,17 @@ class Timelapse(object):
 
     def _reset(self):
         self._state = TimelapseState.Idle
+        if self._plan_pipeline is not None:
+            # The pipeline is joined when it is released.
+            self._plan_pipeline.Cancel()
+            self._plan_pipeline = None
+        with self._async_tracker_lock:
+            if self._async_tracker is not None:
+                self._async_tracker.Stop()
+                self._async_tracker = None
+            self._async_lines = []
+            self._async_tags = None
+            self._async_previous_cmd = None
         self._current_file_line = 0
         if self._triggers is not None:
             self._triggers.reset()
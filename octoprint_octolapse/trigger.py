@@ -23,6 +23,7 @@
 from __future__ import unicode_literals
 import time
 from octoprint_octolapse.position import ExtruderTriggers
+from octoprint_octolapse.gcode_processor import GcodeProcessor
 from octoprint_octolapse.settings import *
 
 # create the module level logger
@@ -63,6 +64,12 @@ class Triggers(object):
         elif trigger_profile.trigger_subtype == TriggerProfile.TIMER_TRIGGER_TYPE:
             self._triggers.append(TimerTrigger(self._settings))
 
+        # Position restrictions are only calculated in python, so without them the triggers can be evaluated by
+        # the native position processor, which saves a python state machine update for every gcode.
+        if not (trigger_profile.position_restrictions_enabled and len(trigger_profile.position_restrictions) > 0):
+            for trigger in self._triggers:
+                trigger.initialize_native()
+
     def resume(self):
         for trigger in self._triggers:
             if type(trigger) == TimerTrigger:
@@ -73,7 +80,19 @@ class Triggers(object):
             if type(trigger) == TimerTrigger:
                 trigger.pause()
 
-    def update(self, position):
+    def get_async_trigger_args(self):
+        # Returns the native args for an AsyncTracker's trigger, or None if the tracker can't evaluate the triggers.
+        # The tracker has a single trigger, which must be native.  Timers are paused while taking a snapshot, which
+        # the tracking thread doesn't support.
+        if len(self._triggers) != 1:
+            return None
+        trigger = self._triggers[0]
+        if not trigger.is_native or isinstance(trigger, TimerTrigger):
+            return None
+        return trigger.get_native_trigger_args()
+
+    def update(self, position, native_state=None):
+        # native_state is the state tuple of an AsyncTracker's trigger, which replaces the native trigger update.
         # the previous command (not just the current) MUST have homed positions else
         # we may have some null coordinates.
         #if not position.current_pos.has_definite_position:
@@ -84,7 +103,9 @@ class Triggers(object):
             # Loop through all of the active current_triggers
             for current_trigger in self._triggers:
                 # determine what type the current trigger is and update appropriately
-                if isinstance(current_trigger, GcodeTrigger):
+                if current_trigger.is_native:
+                    current_trigger.update_native(native_state)
+                elif isinstance(current_trigger, GcodeTrigger):
                     current_trigger.update(position)
                 elif isinstance(current_trigger, TimerTrigger):
                     current_trigger.update(position)
@@ -142,6 +163,9 @@ class Triggers(object):
 
 
 class TriggerState(object):
+    # The native trigger types, by value
+    NATIVE_TRIGGER_TYPES = [None, Triggers.TRIGGER_TYPE_DEFAULT, Triggers.TRIGGER_TYPE_IN_PATH]
+
     def __init__(self, state=None):
         self.is_triggered = False if state is None else state.is_triggered
         self.trigger_type = None if state is None else state.trigger_type
@@ -177,6 +201,18 @@ class TriggerState(object):
         self.trigger_type = None
         self.has_changed = False
 
+    def copy_from_native_tuple(self, state_tuple):
+        # See snapshot_trigger_state::to_py_tuple for the order of the values
+        self.is_triggered = state_tuple[0] > 0
+        self.trigger_type = TriggerState.NATIVE_TRIGGER_TYPES[state_tuple[1]]
+        self.is_in_position = state_tuple[2] > 0
+        self.in_path_position = state_tuple[3] > 0
+        self.is_waiting = state_tuple[4] > 0
+        self.is_home_position_wait = state_tuple[5] > 0
+        self.is_waiting_on_zhop = state_tuple[6] > 0
+        self.is_waiting_on_extruder = state_tuple[7] > 0
+        self.has_definite_position = state_tuple[8] > 0
+
     def is_equal(self, state):
         if (state is not None
                 and self.is_triggered == state.is_triggered
@@ -204,6 +240,8 @@ class Trigger(object):
         self.extruder_triggers = None
         self.trigger_count = 0
         self.snapshots_enabled = True
+        self.is_native = False
+        self.require_zhop = False
 
     def update(self, position):
         parsed_command = position.current_pos.parsed_command
@@ -216,6 +254,56 @@ class Trigger(object):
     def name(self):
         return self.trigger_profile.name + " Trigger"
 
+    def create_state(self):
+        return TriggerState()
+
+    def get_native_trigger_args(self):
+        trigger_profile = self.trigger_profile
+        return {
+            "type": self.type,
+            "require_zhop": self.require_zhop,
+            "height_increment": 0,
+            "interval_seconds": 0,
+            "snapshot_command": "",
+            "extruder_state_requirements_enabled": trigger_profile.extruder_state_requirements_enabled,
+            "extruder_triggers": [
+                TriggerProfile.get_extruder_trigger_value(value) for value in [
+                    trigger_profile.trigger_on_extruding_start,
+                    trigger_profile.trigger_on_extruding,
+                    trigger_profile.trigger_on_primed,
+                    trigger_profile.trigger_on_retracting_start,
+                    trigger_profile.trigger_on_retracting,
+                    trigger_profile.trigger_on_partially_retracted,
+                    trigger_profile.trigger_on_retracted,
+                    trigger_profile.trigger_on_deretracting_start,
+                    trigger_profile.trigger_on_deretracting,
+                    trigger_profile.trigger_on_deretracted
+                ]
+            ]
+        }
+
+    def initialize_native(self):
+        GcodeProcessor.initialize_trigger(self.get_native_trigger_args())
+        self.is_native = True
+        logger.info("%s trigger will be evaluated by the native position processor.", self.type)
+
+    def update_native(self, state_tuple=None):
+        # The native trigger follows the native position processor, which has already processed the current gcode.
+        # An AsyncTracker supplies the state of its own trigger instead.
+        if state_tuple is None:
+            state_tuple = GcodeProcessor.update_trigger()
+        if state_tuple is None:
+            # Nothing changed, so keep the current state rather than adding a copy to the history
+            state = self.get_state(0)
+            if state is not None:
+                state.has_changed = False
+            return
+        state = self.create_state()
+        state.copy_from_native_tuple(state_tuple)
+        self.trigger_count = state_tuple[19]
+        state.has_changed = not state.is_equal(self.get_state(0))
+        self.add_state(state)
+
     def add_state(self, state):
         self._state_history.insert(0, state)
         while len(self._state_history) > self._max_states:
@@ -330,6 +418,14 @@ class GcodeTrigger(Trigger):
         # add an initial state
         self.add_state(GcodeTriggerState())
 
+    def create_state(self):
+        return GcodeTriggerState()
+
+    def get_native_trigger_args(self):
+        trigger_args = super(GcodeTrigger, self).get_native_trigger_args()
+        trigger_args["snapshot_command"] = self.snapshot_command
+        return trigger_args
+
     def update(self, position):
         super(GcodeTrigger, self).update(position)
         parsed_command = position.current_pos.parsed_command
@@ -443,6 +539,7 @@ class LayerTriggerState(TriggerState):
         current_dict = {
             "current_increment": self.current_increment,
             "is_layer_change_wait": self.is_layer_change_wait,
+            "is_layer_change": self.is_layer_change,
             "is_height_change": self.is_height_change,
             "is_height_change_wait": self.is_height_change_wait,
             "height_increment": trigger.height_increment,
@@ -456,6 +553,15 @@ class LayerTriggerState(TriggerState):
         self.is_height_change = False
         self.is_layer_change = False
 
+    def copy_from_native_tuple(self, state_tuple):
+        super(LayerTriggerState, self).copy_from_native_tuple(state_tuple)
+        self.current_increment = state_tuple[10]
+        self.is_layer_change_wait = state_tuple[11] > 0
+        self.is_layer_change = state_tuple[12] > 0
+        self.is_height_change = state_tuple[13] > 0
+        self.is_height_change_wait = state_tuple[14] > 0
+        self.layer = state_tuple[15]
+
     def is_equal(self, state):
         if (super(LayerTriggerState, self).is_equal(state)
                 and self.is_home_position_wait == state.is_home_position_wait
@@ -522,6 +628,14 @@ class LayerTrigger(Trigger):
         )
         self.add_state(LayerTriggerState())
 
+    def create_state(self):
+        return LayerTriggerState()
+
+    def get_native_trigger_args(self):
+        trigger_args = super(LayerTrigger, self).get_native_trigger_args()
+        trigger_args["height_increment"] = 0 if self.height_increment is None else self.height_increment
+        return trigger_args
+
     def update(self, position):
         """Updates the layer monitor position.  x, y and z may be absolute, but e must always be relative"""
         super(LayerTrigger, self).update(position)
@@ -697,6 +811,12 @@ class TimerTriggerState(TriggerState):
         current_dict.update(super_dict)
         return current_dict
 
+    def copy_from_native_tuple(self, state_tuple):
+        super(TimerTriggerState, self).copy_from_native_tuple(state_tuple)
+        self.seconds_to_trigger = None if state_tuple[16] is None else int(state_tuple[16])
+        self.trigger_start_time = state_tuple[17]
+        self.pause_time = state_tuple[18]
+
     def is_equal(self, state):
         if (super(TimerTriggerState, self).is_equal(state)
                 and self.seconds_to_trigger == state.seconds_to_trigger
@@ -762,7 +882,17 @@ class TimerTrigger(Trigger):
         initial_state = TimerTriggerState()
         self.add_state(initial_state)
 
+    def create_state(self):
+        return TimerTriggerState()
+
+    def get_native_trigger_args(self):
+        trigger_args = super(TimerTrigger, self).get_native_trigger_args()
+        trigger_args["interval_seconds"] = self.interval_seconds
+        return trigger_args
+
     def pause(self):
+        if self.is_native:
+            GcodeProcessor.pause_trigger()
         state = self.get_state(0)
         if state is None:
             return
@@ -770,6 +900,8 @@ class TimerTrigger(Trigger):
         logger.info("Timer trigger paused.")
 
     def resume(self):
+        if self.is_native:
+            GcodeProcessor.resume_trigger()
         state = self.get_state(0)
         if state is None:
             return
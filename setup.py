@@ -98,8 +98,8 @@ DEBUG = False
 # define compiler flags
 compiler_opts = {
     CCompiler.compiler_type: {
-        'extra_compile_args': ['-O3', '-std=c++11'],
-        'extra_link_args': [],
+        'extra_compile_args': ['-O3', '-std=c++11', '-pthread'],
+        'extra_link_args': ['-pthread'],
         'define_macros': []
     },
     MSVCCompiler.compiler_type: {
@@ -108,18 +108,18 @@ compiler_opts = {
         'define_macros': []
     },
     UnixCCompiler.compiler_type: {
-        'extra_compile_args': ['-O3', '-std=c++11'],
-        'extra_link_args': [],
+        'extra_compile_args': ['-O3', '-std=c++11', '-pthread'],
+        'extra_link_args': ['-pthread'],
         'define_macros': []
     },
     BCPPCompiler.compiler_type: {
-        'extra_compile_args': ['-O3', '-std=c++11'],
-        'extra_link_args': [],
+        'extra_compile_args': ['-O3', '-std=c++11', '-pthread'],
+        'extra_link_args': ['-pthread'],
         'define_macros': []
     },
     CygwinCCompiler.compiler_type: {
-        'extra_compile_args': ['-O3', '-std=c++11'],
-        'extra_link_args': [],
+        'extra_compile_args': ['-O3', '-std=c++11', '-pthread'],
+        'extra_link_args': ['-pthread'],
         'define_macros': []
     }
 }
@@ -179,6 +179,7 @@ plugin_ext_sources = [
     'octoprint_octolapse/data/lib/c/parsed_command.cpp',
     'octoprint_octolapse/data/lib/c/parsed_command_parameter.cpp',
     'octoprint_octolapse/data/lib/c/position.cpp',
+    'octoprint_octolapse/data/lib/c/position_view.cpp',
     'octoprint_octolapse/data/lib/c/python_helpers.cpp',
     'octoprint_octolapse/data/lib/c/snapshot_plan.cpp',
     'octoprint_octolapse/data/lib/c/snapshot_plan_step.cpp',
@@ -190,7 +191,29 @@ plugin_ext_sources = [
     'octoprint_octolapse/data/lib/c/utilities.cpp',
     'octoprint_octolapse/data/lib/c/trigger_position.cpp',
     'octoprint_octolapse/data/lib/c/gcode_comment_processor.cpp',
-    'octoprint_octolapse/data/lib/c/extruder.cpp'
+    'octoprint_octolapse/data/lib/c/extruder.cpp',
+    'octoprint_octolapse/data/lib/c/gcode_file_source.cpp',
+    'octoprint_octolapse/data/lib/c/binary_stream.cpp',
+    'octoprint_octolapse/data/lib/c/snapshot_plan_cache.cpp',
+    'octoprint_octolapse/data/lib/c/position_trace.cpp',
+    'octoprint_octolapse/data/lib/c/snapshot_trigger.cpp',
+    'octoprint_octolapse/data/lib/c/snapshot_gcode_generator.cpp',
+    'octoprint_octolapse/data/lib/c/slicer_settings_extractor.cpp',
+    'octoprint_octolapse/data/lib/c/processing_stats.cpp',
+    'octoprint_octolapse/data/lib/c/position_checkpoint.cpp',
+    'octoprint_octolapse/data/lib/c/processor_state.cpp',
+    'octoprint_octolapse/data/lib/c/position_handle.cpp',
+    'octoprint_octolapse/data/lib/c/async_tracker.cpp',
+    'octoprint_octolapse/data/lib/c/gcode_arc.cpp',
+    'octoprint_octolapse/data/lib/c/plan_cursor.cpp',
+    'octoprint_octolapse/data/lib/c/print_time_estimator.cpp',
+    'octoprint_octolapse/data/lib/c/stabilization_smart_timer.cpp',
+    'octoprint_octolapse/data/lib/c/gcode_decompression.cpp',
+    'octoprint_octolapse/data/lib/c/gcode_input_stream.cpp',
+    'octoprint_octolapse/data/lib/c/processing_progress.cpp',
+    'octoprint_octolapse/data/lib/c/toolpath_recorder.cpp',
+    'octoprint_octolapse/data/lib/c/snapshot_plan_queue.cpp',
+    'octoprint_octolapse/data/lib/c/plan_pipeline.cpp'
 ]
 cpp_gcode_parser = Extension(
     'GcodePositionProcessor',